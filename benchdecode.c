@@ -0,0 +1,1105 @@
+/*
+** Description
+** -----------
+** 	Microbenchmarks of the kernels that decode and format the scan
+** 	results. Each runs a kernel over the same inputs repeatedly and
+** 	prints one line:
+**
+** 		kernel=<name> case=<input> rows=<count> bytes=<bytes>
+** 		secs=<wall time> nsrow=<ns per row> mbps=<MB/s>
+**
+** 	The kernels are
+**
+** 		dlen	- ex_display_dlen() of a column, per datatype
+** 		dtfmt	- logtransfer_dt_fmt() of a value, per date and time
+** 			  datatype; 'bytes' is the text formatted
+** 		header	- logtransfer_display_header() of a record, per
+** 			  operation; 'bytes' is the text formatted
+** 		fetch	- handle_logtransfer_scan_results(), and so
+** 			  logtransfer_fetch_data(), over a capture with the
+** 			  text display off; 'bytes' is the native row values
+** 		display	- the same with the text display on
+**
+** 	The fetch and display kernels run over synthetic captures, one per
+** 	operation shape (begin, insert, delete and update transactions of a
+** 	mixed row) and one per datatype (inserts of rows of 8 columns of
+** 	it), and over the recorded captures named on the command line. They
+** 	are served by the Client-Library stand-in of ltreplay.c, so their
+** 	times include its conversions instead of the SAP libraries'. The
+** 	text display goes to a scratch file, whose size gives the bytes
+** 	formatted; it is emptied between passes, outside the timing.
+**
+** 	The program is linked with logtransfer.c, its main() renamed.
+**
+** 	Usage: benchdecode [directory [rows [capture ...]]]
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltxact.h"
+#include "ltcompact.h"
+#include "ltbatch.h"
+#include "ltcapture.h"
+#include "ltout.h"
+
+/*
+** Transactions in each synthetic capture.
+*/
+#define BENCH_XACTS	1000
+
+/*
+** Headers displayed between emptyings of the scratch file.
+*/
+#define BENCH_CHUNK	256
+
+/*
+** Columns of an image row of a single datatype.
+*/
+#define BENCH_TYPECOLS	8
+
+/*
+** The operation records of the scan results, as the server describes
+** them: the operation, the session id, the status, the log position and
+** the user, table and owner names. A commit has the commit time in
+** place of the table name.
+*/
+#define BENCH_OPCOLS	10
+#define BENCH_ENDCOLS	9
+
+/*
+** A column of the synthetic captures.
+*/
+typedef struct _bench_col
+{
+	CS_CHAR		*name;
+	CS_INT		datatype;
+	CS_INT		maxlength;
+	CS_INT		precision;
+	CS_INT		scale;
+} BENCH_COL;
+
+CS_STATIC BENCH_COL Bench_opcols[BENCH_OPCOLS] = {
+	{ "operation",	CS_CHAR_TYPE,		20,	0,	0 },
+	{ "xactpage",	CS_INT_TYPE,		4,	0,	0 },
+	{ "xactrow",	CS_INT_TYPE,		4,	0,	0 },
+	{ "status",	CS_CHAR_TYPE,		10,	0,	0 },
+	{ "page",	CS_INT_TYPE,		4,	0,	0 },
+	{ "row",	CS_INT_TYPE,		4,	0,	0 },
+	{ "spare",	CS_CHAR_TYPE,		10,	0,	0 },
+	{ "user",	CS_CHAR_TYPE,		30,	0,	0 },
+	{ "table",	CS_CHAR_TYPE,		30,	0,	0 },
+	{ "owner",	CS_CHAR_TYPE,		30,	0,	0 },
+};
+
+CS_STATIC BENCH_COL Bench_endcols[BENCH_ENDCOLS] = {
+	{ "operation",	CS_CHAR_TYPE,		20,	0,	0 },
+	{ "xactpage",	CS_INT_TYPE,		4,	0,	0 },
+	{ "xactrow",	CS_INT_TYPE,		4,	0,	0 },
+	{ "status",	CS_CHAR_TYPE,		10,	0,	0 },
+	{ "page",	CS_INT_TYPE,		4,	0,	0 },
+	{ "row",	CS_INT_TYPE,		4,	0,	0 },
+	{ "spare",	CS_CHAR_TYPE,		10,	0,	0 },
+	{ "user",	CS_CHAR_TYPE,		30,	0,	0 },
+	{ "committime",	CS_DATETIME_TYPE,	8,	0,	0 },
+};
+
+/*
+** The mixed row of the operation shapes.
+*/
+CS_STATIC BENCH_COL Bench_mixed[] = {
+	{ "id",		CS_INT_TYPE,		4,	0,	0 },
+	{ "name",	CS_VARCHAR_TYPE,	40,	0,	0 },
+	{ "amount",	CS_NUMERIC_TYPE,	35,	18,	2 },
+	{ "ts",		CS_DATETIME_TYPE,	8,	0,	0 },
+	{ "price",	CS_MONEY_TYPE,		8,	0,	0 },
+	{ "hash",	CS_VARBINARY_TYPE,	16,	0,	0 },
+	{ "label",	CS_UNICHAR_TYPE,	40,	0,	0 },
+	{ "story",	CS_TEXT_TYPE,		32768,	0,	0 },
+};
+
+/*
+** The datatypes benchmarked on their own.
+*/
+CS_STATIC BENCH_COL Bench_types[] = {
+	{ "char",	CS_CHAR_TYPE,		30,	0,	0 },
+	{ "varchar",	CS_VARCHAR_TYPE,	200,	0,	0 },
+	{ "int",	CS_INT_TYPE,		4,	0,	0 },
+	{ "bigint",	CS_BIGINT_TYPE,		8,	0,	0 },
+	{ "float",	CS_FLOAT_TYPE,		8,	0,	0 },
+	{ "numeric",	CS_NUMERIC_TYPE,	35,	18,	4 },
+	{ "money",	CS_MONEY_TYPE,		8,	0,	0 },
+	{ "datetime",	CS_DATETIME_TYPE,	8,	0,	0 },
+	{ "bigdatetime", CS_BIGDATETIME_TYPE,	8,	0,	0 },
+	{ "binary",	CS_BINARY_TYPE,		16,	0,	0 },
+	{ "unichar",	CS_UNICHAR_TYPE,	40,	0,	0 },
+	{ "text",	CS_TEXT_TYPE,		32768,	0,	0 },
+};
+
+/*
+** The date and time datatypes of logtransfer_dt_fmt().
+*/
+CS_STATIC BENCH_COL Bench_dates[] = {
+	{ "datetime",	CS_DATETIME_TYPE,	8,	0,	0 },
+	{ "datetime4",	CS_DATETIME4_TYPE,	4,	0,	0 },
+	{ "date",	CS_DATE_TYPE,		4,	0,	0 },
+	{ "time",	CS_TIME_TYPE,		4,	0,	0 },
+	{ "bigdatetime", CS_BIGDATETIME_TYPE,	8,	0,	0 },
+	{ "bigtime",	CS_BIGTIME_TYPE,	8,	0,	0 },
+};
+
+/*
+** The operation shapes: the operation records of a transaction, between
+** its begin and commit, each followed by an image of the row.
+*/
+typedef struct _bench_shape
+{
+	CS_CHAR		*name;
+	CS_CHAR		*ops[2];
+	CS_CHAR		*status;
+} BENCH_SHAPE;
+
+CS_STATIC BENCH_SHAPE Bench_shapes[] = {
+	{ "begin",	{ NULL,	NULL },	"0" },
+	{ "insert",	{ "4",	NULL },	"0" },
+	{ "delete",	{ "5",	NULL },	"0" },
+	{ "update",	{ "5",	"4" },	"4" },
+};
+
+/*
+** The globals and routines of logtransfer.c benchmarked.
+*/
+extern CS_CONTEXT	*Cs_context;
+extern CS_BOOL		Ex_display;
+extern CS_INT		Ex_compact_keycols;
+extern CS_INT		Ex_batch_xacts;
+extern CS_INT		Ex_batch_bytes;
+extern CS_INT		Ex_batch_delay;
+extern LT_XACT_INDEX	Lt_open_xacts;
+extern LT_COMPACT	Lt_compact;
+extern LT_BATCHER	Lt_batcher;
+
+extern CS_RETCODE CS_PUBLIC handle_logtransfer_scan_results(CS_COMMAND *cmd);
+extern CS_RETCODE CS_PUBLIC logtransfer_display_header(CS_INT numcols,
+						       CS_DATAFMT orig_columns[],
+						       CS_DATAFMT columns[],
+						       CS_CHAR *operation,
+						       CS_CHAR *status);
+extern CS_RETCODE logtransfer_dt_fmt(CS_VOID *val, CS_CHAR *out_buf,
+				     CS_INT bufSize, CS_INT date_type);
+
+/*
+** Where the results are printed, stdout being the scratch file.
+*/
+CS_STATIC FILE *Bench_out;
+
+/*
+** Keeps the results of the kernels from being optimized away.
+*/
+CS_STATIC volatile CS_INT Bench_sink;
+
+/*
+** bench_now()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Read the monotonic clock.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	The time in seconds.
+*/
+
+CS_STATIC double
+bench_now(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+** bench_report()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Print the result of a run.
+**
+** Parameters:
+** 	kernel		- The kernel.
+** 	name		- The input.
+** 	rows		- Rows, or calls, run.
+** 	bytes		- Bytes decoded or formatted.
+** 	secs		- Wall time.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+bench_report(CS_CHAR *kernel, CS_CHAR *name, CS_BIGINT rows, CS_BIGINT bytes,
+	     double secs)
+{
+	if (secs <= 0)
+	{
+		secs = 1e-9;
+	}
+	fprintf(Bench_out,
+		"kernel=%s case=%s rows=%lld bytes=%lld secs=%.3f nsrow=%.1f mbps=%.1f\n",
+		kernel, name, (long long)rows, (long long)bytes, secs,
+		(rows > 0) ? secs * 1e9 / rows : 0.0,
+		bytes / secs / (1024.0 * 1024.0));
+	fflush(Bench_out);
+}
+
+/*
+** bench_scratch()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Return the bytes of text displayed since the last call, and empty
+** 	the scratch file they went to.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	The length of the scratch file.
+*/
+
+CS_STATIC CS_BIGINT
+bench_scratch(void)
+{
+	off_t	off;
+
+	lt_out_flush();
+	off = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+	if (ftruncate(STDOUT_FILENO, 0) != 0 ||
+	    lseek(STDOUT_FILENO, 0, SEEK_SET) < 0)
+	{
+		ex_error("bench_scratch: emptying the scratch file failed");
+	}
+	return (off < 0) ? 0 : (CS_BIGINT)off;
+}
+
+/*
+** bench_fmt()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Describe a column as ct_describe() would.
+**
+** Parameters:
+** 	col		- The column.
+** 	fmt		- Set to its description.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+bench_fmt(BENCH_COL *col, CS_DATAFMT *fmt)
+{
+	memset(fmt, 0, sizeof (*fmt));
+	strncpy(fmt->name, col->name, sizeof (fmt->name) - 1);
+	fmt->namelen = (CS_INT)strlen(fmt->name);
+	fmt->datatype = col->datatype;
+	fmt->format = CS_FMT_UNUSED;
+	fmt->maxlength = col->maxlength;
+	fmt->precision = col->precision;
+	fmt->scale = col->scale;
+	fmt->status = CS_CANBENULL;
+}
+
+/*
+** bench_value()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Make the native value of a column, varying with 'n'.
+**
+** Parameters:
+** 	fmt		- The column description.
+** 	n		- The row number.
+** 	buf		- The value, at least fmt->maxlength bytes.
+**
+** Returns:
+** 	The length of the value.
+*/
+
+CS_STATIC CS_INT
+bench_value(CS_DATAFMT *fmt, CS_INT n, CS_BYTE *buf)
+{
+	CS_NUMERIC	num;
+	CS_MONEY	mny;
+	CS_DATETIME	dt;
+	CS_DATETIME4	dt4;
+	CS_USMALLINT	uni[20];
+	CS_UBIGINT	ubig;
+	CS_BIGINT	big;
+	CS_FLOAT	flt;
+	CS_INT		val;
+	CS_INT		len;
+	CS_INT		i;
+
+	switch ((int)fmt->datatype)
+	{
+		case CS_CHAR_TYPE:
+		case CS_VARCHAR_TYPE:
+			len = snprintf((CS_CHAR *)buf, fmt->maxlength, "value %d", n);
+			return MIN(len, fmt->maxlength - 1);
+
+		case CS_TEXT_TYPE:
+			len = 64 + n % 1024;
+			memset(buf, 'a' + n % 26, len);
+			return len;
+
+		case CS_INT_TYPE:
+		case CS_DATE_TYPE:
+			val = n;
+			memcpy(buf, &val, sizeof (val));
+			return sizeof (val);
+
+		case CS_TIME_TYPE:
+			val = (n * 301) % (300 * 86400);
+			memcpy(buf, &val, sizeof (val));
+			return sizeof (val);
+
+		case CS_BIGINT_TYPE:
+			big = (CS_BIGINT)n * 1000003;
+			memcpy(buf, &big, sizeof (big));
+			return sizeof (big);
+
+		case CS_FLOAT_TYPE:
+			flt = n / 7.0;
+			memcpy(buf, &flt, sizeof (flt));
+			return sizeof (flt);
+
+		case CS_NUMERIC_TYPE:
+		case CS_DECIMAL_TYPE:
+			memset(&num, 0, sizeof (num));
+			num.precision = (CS_BYTE)fmt->precision;
+			num.scale = (CS_BYTE)fmt->scale;
+			num.array[0] = (CS_BYTE)(n & 1);
+			len = 1 + (fmt->precision * 3322 + 7999) / 8000;
+			big = (CS_BIGINT)n * 1000003 + 12345;
+			for (i = len - 1; i > 0 && big > 0; i--)
+			{
+				num.array[i] = (CS_BYTE)(big & 0xff);
+				big >>= 8;
+			}
+			memcpy(buf, &num, sizeof (num));
+			return sizeof (num);
+
+		case CS_MONEY_TYPE:
+			big = (CS_BIGINT)n * 10000 + 1234;
+			mny.mnyhigh = (CS_INT)(big >> 32);
+			mny.mnylow = (CS_UINT)(big & 0xffffffff);
+			memcpy(buf, &mny, sizeof (mny));
+			return sizeof (mny);
+
+		case CS_DATETIME_TYPE:
+			dt.dtdays = 45000 + n % 1000;
+			dt.dttime = (n * 301) % (300 * 86400);
+			memcpy(buf, &dt, sizeof (dt));
+			return sizeof (dt);
+
+		case CS_DATETIME4_TYPE:
+			dt4.days = (CS_USMALLINT)(45000 + n % 1000);
+			dt4.minutes = (CS_USMALLINT)(n % 1440);
+			memcpy(buf, &dt4, sizeof (dt4));
+			return sizeof (dt4);
+
+		case CS_BIGDATETIME_TYPE:
+			ubig = (CS_UBIGINT)63745000000LL * 1000000 +
+			       (CS_UBIGINT)n * 1000003;
+			memcpy(buf, &ubig, sizeof (ubig));
+			return sizeof (ubig);
+
+		case CS_BIGTIME_TYPE:
+			ubig = ((CS_UBIGINT)n * 1000003) % ((CS_UBIGINT)86400 * 1000000);
+			memcpy(buf, &ubig, sizeof (ubig));
+			return sizeof (ubig);
+
+		case CS_BINARY_TYPE:
+		case CS_VARBINARY_TYPE:
+			len = MIN(fmt->maxlength, 16);
+			for (i = 0; i < len; i++)
+			{
+				buf[i] = (CS_BYTE)(n * 31 + i * 7);
+			}
+			return len;
+
+		case CS_UNICHAR_TYPE:
+			len = MIN(fmt->maxlength / (CS_INT)sizeof (uni[0]), 20);
+			for (i = 0; i < len; i++)
+			{
+				uni[i] = (i == 0) ? 0xe9 : (CS_USMALLINT)('0' + (n + i) % 10);
+			}
+			memcpy(buf, uni, len * sizeof (uni[0]));
+			return len * sizeof (uni[0]);
+
+		default:
+			return 0;
+	}
+}
+
+/*
+** bench_put()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Write a result of one row to a capture, as the server returns
+** 	each record of a scan.
+**
+** Parameters:
+** 	out		- The capture.
+** 	numcols		- The number of columns.
+** 	fmt		- The column descriptions.
+** 	coldata		- The values.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure of the capture writer.
+*/
+
+CS_STATIC CS_RETCODE
+bench_put(LT_CAPTURE_OUT *out, CS_INT numcols, CS_DATAFMT *fmt,
+	  EX_COLUMN_DATA *coldata)
+{
+	CS_RETCODE	retcode;
+
+	if ((retcode = lt_capture_put_result(out, CS_ROW_RESULT, 0, numcols,
+					     fmt)) != CS_SUCCEED ||
+	    (retcode = lt_capture_put_row(out, numcols, coldata)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	return lt_capture_put_result(out, CS_CMD_DONE, 0, 0, NULL);
+}
+
+/*
+** bench_op()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Fill in the values of an operation record.
+**
+** Parameters:
+** 	coldata		- The values, each of at least 32 bytes.
+** 	numcols		- BENCH_OPCOLS, or BENCH_ENDCOLS for a commit.
+** 	op		- The operation.
+** 	status		- The status.
+** 	xact		- The transaction number.
+** 	pos		- The log record number.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+bench_op(EX_COLUMN_DATA *coldata, CS_INT numcols, CS_CHAR *op,
+	 CS_CHAR *status, CS_INT xact, CS_INT pos)
+{
+	CS_INT		ints[4];
+	CS_DATETIME	dt;
+	CS_INT		i;
+
+	ints[0] = 1000 + xact;
+	ints[1] = 1;
+	ints[2] = 1000 + pos / 100;
+	ints[3] = pos % 100;
+
+	for (i = 0; i < numcols; i++)
+	{
+		coldata[i].indicator = 0;
+	}
+	coldata[0].valuelen = (CS_INT)strlen(op);
+	memcpy(coldata[0].value, op, coldata[0].valuelen);
+	memcpy(coldata[1].value, &ints[0], sizeof (CS_INT));
+	memcpy(coldata[2].value, &ints[1], sizeof (CS_INT));
+	coldata[1].valuelen = coldata[2].valuelen = sizeof (CS_INT);
+	coldata[3].valuelen = (CS_INT)strlen(status);
+	memcpy(coldata[3].value, status, coldata[3].valuelen);
+	memcpy(coldata[4].value, &ints[2], sizeof (CS_INT));
+	memcpy(coldata[5].value, &ints[3], sizeof (CS_INT));
+	coldata[4].valuelen = coldata[5].valuelen = sizeof (CS_INT);
+	coldata[6].indicator = CS_NULLDATA;
+	coldata[7].valuelen = 2;
+	memcpy(coldata[7].value, "sa", 2);
+	if (numcols == BENCH_ENDCOLS)
+	{
+		dt.dtdays = 45000;
+		dt.dttime = (xact * 301) % (300 * 86400);
+		memcpy(coldata[8].value, &dt, sizeof (dt));
+		coldata[8].valuelen = sizeof (dt);
+		return;
+	}
+	if (strcmp(op, "0") == 0)
+	{
+		coldata[8].indicator = coldata[9].indicator = CS_NULLDATA;
+		return;
+	}
+	coldata[7].indicator = CS_NULLDATA;
+	coldata[8].valuelen = snprintf(coldata[8].value, 32, "table%d", xact % 5);
+	coldata[9].valuelen = 3;
+	memcpy(coldata[9].value, "dbo", 3);
+}
+
+/*
+** bench_make()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Write a synthetic capture of one scan of BENCH_XACTS transactions
+** 	of an operation shape, each changing a row of the columns given.
+**
+** Parameters:
+** 	path		- The capture file.
+** 	shape		- The operation shape.
+** 	cols		- The columns of the row.
+** 	numcols		- The number of columns.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure of the capture writer.
+*/
+
+CS_STATIC CS_RETCODE
+bench_make(CS_CHAR *path, BENCH_SHAPE *shape, BENCH_COL *cols, CS_INT numcols)
+{
+	LT_CAPTURE_OUT	out;
+	CS_DATAFMT	opfmt[BENCH_OPCOLS];
+	CS_DATAFMT	endfmt[BENCH_ENDCOLS];
+	CS_DATAFMT	*fmt;
+	EX_COLUMN_DATA	opdata[BENCH_OPCOLS];
+	EX_COLUMN_DATA	*coldata;
+	CS_CHAR		*values;
+	CS_RETCODE	retcode;
+	CS_INT		maxlen = 32;
+	CS_INT		pos = 0;
+	CS_INT		x;
+	CS_INT		i;
+	CS_INT		j;
+
+	fmt = (CS_DATAFMT *)malloc(numcols * sizeof (CS_DATAFMT));
+	coldata = (EX_COLUMN_DATA *)malloc(numcols * sizeof (EX_COLUMN_DATA));
+	for (i = 0; i < numcols; i++)
+	{
+		maxlen = MAX(maxlen, cols[i].maxlength);
+	}
+	values = (CS_CHAR *)malloc((numcols + BENCH_OPCOLS) * maxlen);
+	if (fmt == NULL || coldata == NULL || values == NULL)
+	{
+		free(fmt);
+		free(coldata);
+		free(values);
+		return CS_MEM_ERROR;
+	}
+	for (i = 0; i < BENCH_OPCOLS; i++)
+	{
+		bench_fmt(&Bench_opcols[i], &opfmt[i]);
+		opdata[i].value = values + i * maxlen;
+	}
+	for (i = 0; i < BENCH_ENDCOLS; i++)
+	{
+		bench_fmt(&Bench_endcols[i], &endfmt[i]);
+	}
+	for (i = 0; i < numcols; i++)
+	{
+		bench_fmt(&cols[i], &fmt[i]);
+		coldata[i].value = values + (BENCH_OPCOLS + i) * maxlen;
+		coldata[i].indicator = 0;
+	}
+
+	if ((retcode = lt_capture_create(path, &out)) != CS_SUCCEED)
+	{
+		free(fmt);
+		free(coldata);
+		free(values);
+		return retcode;
+	}
+	retcode = lt_capture_put_scan(&out);
+	for (x = 0; x < BENCH_XACTS && retcode == CS_SUCCEED; x++)
+	{
+		bench_op(opdata, BENCH_OPCOLS, "0", "0", x, pos++);
+		retcode = bench_put(&out, BENCH_OPCOLS, opfmt, opdata);
+		for (j = 0; j < 2 && shape->ops[j] != NULL &&
+		     retcode == CS_SUCCEED; j++)
+		{
+			bench_op(opdata, BENCH_OPCOLS, shape->ops[j],
+				 shape->status, x, pos++);
+			retcode = bench_put(&out, BENCH_OPCOLS, opfmt, opdata);
+			for (i = 0; i < numcols; i++)
+			{
+				coldata[i].valuelen = bench_value(&fmt[i],
+								  x * numcols + i,
+								  (CS_BYTE *)coldata[i].value);
+			}
+			if (retcode == CS_SUCCEED)
+			{
+				retcode = bench_put(&out, numcols, fmt, coldata);
+			}
+		}
+		if (retcode == CS_SUCCEED)
+		{
+			bench_op(opdata, BENCH_ENDCOLS, "30", "0", x, pos++);
+			retcode = bench_put(&out, BENCH_ENDCOLS, endfmt, opdata);
+		}
+	}
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = lt_capture_put_end(&out, CS_END_RESULTS);
+	}
+	if (lt_capture_close(&out) != CS_SUCCEED && retcode == CS_SUCCEED)
+	{
+		retcode = CS_FAIL;
+	}
+	free(fmt);
+	free(coldata);
+	free(values);
+	return retcode;
+}
+
+/*
+** bench_count()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Count the scans and rows of a capture, and the bytes of its row
+** 	values.
+**
+** Parameters:
+** 	path		- The capture file.
+** 	scans		- Set to the number of scans, at least 1.
+** 	rows		- Set to the number of rows.
+** 	bytes		- Set to the bytes of the row values.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the capture could not be read.
+*/
+
+CS_STATIC CS_RETCODE
+bench_count(CS_CHAR *path, CS_INT *scans, CS_BIGINT *rows, CS_BIGINT *bytes)
+{
+	LT_CAPTURE	cap;
+	LT_CAPTURE_REC	rec;
+	CS_INT		numcols = 0;
+	CS_INT		restype;
+	CS_INT		msgid;
+
+	if (lt_capture_map(path, &cap) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+	*scans = 0;
+	*rows = 0;
+	*bytes = 0;
+	while (lt_capture_next(&cap, &rec) == CS_SUCCEED)
+	{
+		if (rec.type == LT_CAPTURE_SCAN)
+		{
+			(*scans)++;
+		}
+		else if (rec.type == LT_CAPTURE_RESULT &&
+			 lt_capture_result(&rec, &restype, &msgid,
+					   &numcols) != CS_SUCCEED)
+		{
+			numcols = 0;
+		}
+		else if (rec.type == LT_CAPTURE_ROW)
+		{
+			(*rows)++;
+			*bytes += rec.len - numcols * (CS_INT)sizeof (CS_INT);
+		}
+	}
+	lt_capture_unmap(&cap);
+	*scans = MAX(*scans, 1);
+	return CS_SUCCEED;
+}
+
+/*
+** bench_fetch()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Run the scans of a capture through handle_logtransfer_scan_results()
+** 	until at least 'minrows' rows have been fetched, once with the text
+** 	display off and once with it on, and print the timing of each.
+**
+** Parameters:
+** 	path		- The capture file.
+** 	name		- The name of the input.
+** 	minrows		- The rows to fetch at least.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the capture could not be replayed.
+*/
+
+CS_STATIC CS_RETCODE
+bench_fetch(CS_CHAR *path, CS_CHAR *name, CS_BIGINT minrows)
+{
+	CS_CONNECTION	*connection;
+	CS_COMMAND	*cmd;
+	CS_RETCODE	retcode = CS_SUCCEED;
+	CS_BIGINT	rows;
+	CS_BIGINT	bytes;
+	CS_BIGINT	passes;
+	CS_BIGINT	text;
+	CS_BIGINT	p;
+	CS_INT		scans;
+	CS_INT		s;
+	CS_INT		display;
+	double		start;
+	double		secs;
+
+	if (bench_count(path, &scans, &rows, &bytes) != CS_SUCCEED || rows == 0)
+	{
+		ex_error("bench_fetch: the capture has no rows");
+		return CS_FAIL;
+	}
+	passes = MAX((minrows + rows - 1) / rows, 1);
+	if (setenv("LT_REPLAY", path, 1) != 0 ||
+	    ex_connect(Cs_context, &connection, "benchdecode", EX_USERNAME,
+		       EX_PASSWORD, EX_SERVER) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+	if (ct_cmd_alloc(connection, &cmd) != CS_SUCCEED)
+	{
+		ex_con_cleanup(connection, CS_FAIL);
+		return CS_FAIL;
+	}
+
+	for (display = 0; display < 2 && retcode == CS_SUCCEED; display++)
+	{
+		Ex_display = display ? CS_TRUE : CS_FALSE;
+		bench_scratch();
+		secs = 0;
+		text = 0;
+		for (p = 0; p < passes && retcode == CS_SUCCEED; p++)
+		{
+			/*
+			** Reconnecting maps the capture again from its start.
+			*/
+			ct_close(connection, CS_UNUSED);
+			if (ct_connect(connection, NULL, 0) != CS_SUCCEED)
+			{
+				retcode = CS_FAIL;
+				break;
+			}
+			start = bench_now();
+			for (s = 0; s < scans && retcode == CS_SUCCEED; s++)
+			{
+				if ((retcode = ct_command(cmd, CS_LANG_CMD,
+						"dbcc logtransfer('scan', 'normal', '')",
+						CS_NULLTERM, CS_UNUSED)) == CS_SUCCEED &&
+				    (retcode = ct_send(cmd)) == CS_SUCCEED)
+				{
+					retcode = handle_logtransfer_scan_results(cmd);
+				}
+				lt_batch_poll(&Lt_batcher);
+			}
+			lt_out_flush();
+			secs += bench_now() - start;
+			text += bench_scratch();
+		}
+		if (retcode == CS_SUCCEED)
+		{
+			bench_report(display ? "display" : "fetch", name,
+				     rows * passes,
+				     display ? text : bytes * passes,
+				     secs);
+		}
+	}
+
+	lt_batch_flush(&Lt_batcher);
+	ct_cmd_drop(cmd);
+	ex_con_cleanup(connection, CS_SUCCEED);
+	return retcode;
+}
+
+/*
+** bench_dlen()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Time ex_display_dlen() for each datatype.
+**
+** Parameters:
+** 	calls		- The calls per datatype.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+bench_dlen(CS_BIGINT calls)
+{
+	CS_DATAFMT	fmt;
+	CS_BIGINT	n;
+	CS_INT		sum;
+	size_t		i;
+	double		start;
+
+	for (i = 0; i < sizeof (Bench_types) / sizeof (Bench_types[0]); i++)
+	{
+		bench_fmt(&Bench_types[i], &fmt);
+		sum = 0;
+		start = bench_now();
+		for (n = 0; n < calls; n++)
+		{
+			sum += ex_display_dlen(&fmt);
+		}
+		Bench_sink = sum;
+		bench_report("dlen", Bench_types[i].name, calls, 0,
+			     bench_now() - start);
+	}
+}
+
+/*
+** bench_dtfmt()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Time logtransfer_dt_fmt() for each date and time datatype, over
+** 	1024 different values.
+**
+** Parameters:
+** 	calls		- The calls per datatype.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+bench_dtfmt(CS_BIGINT calls)
+{
+	CS_DATAFMT	fmt;
+	CS_BYTE		values[1024][8];
+	CS_CHAR		out_buf[32];
+	CS_BIGINT	bytes;
+	CS_BIGINT	n;
+	size_t		i;
+	int		v;
+	double		start;
+
+	for (i = 0; i < sizeof (Bench_dates) / sizeof (Bench_dates[0]); i++)
+	{
+		bench_fmt(&Bench_dates[i], &fmt);
+		for (v = 0; v < 1024; v++)
+		{
+			bench_value(&fmt, v * 7919, values[v]);
+		}
+		bytes = 0;
+		start = bench_now();
+		for (n = 0; n < calls; n++)
+		{
+			if (logtransfer_dt_fmt(values[n & 1023], out_buf,
+					       sizeof (out_buf),
+					       fmt.datatype) == CS_SUCCEED)
+			{
+				bytes += strlen(out_buf);
+			}
+		}
+		bench_report("dtfmt", Bench_dates[i].name, calls, bytes,
+			     bench_now() - start);
+	}
+}
+
+/*
+** bench_header()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Time logtransfer_display_header() for each operation record and
+** 	for an image of the mixed row, with the columns bound as
+** 	logtransfer_fetch_data() binds them.
+**
+** Parameters:
+** 	calls		- The calls per operation.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+bench_header(CS_BIGINT calls)
+{
+	CS_STATIC struct
+	{
+		CS_CHAR		*name;
+		CS_CHAR		*operation;
+		CS_CHAR		*status;
+		BENCH_COL	*cols;
+		CS_INT		numcols;
+	} ops[] = {
+		{ "begin",	"0",		"0", Bench_opcols,	BENCH_OPCOLS },
+		{ "insert",	"4",		"0", Bench_opcols,	BENCH_OPCOLS },
+		{ "delete",	"5",		"0", Bench_opcols,	BENCH_OPCOLS },
+		{ "update",	"5",		"4", Bench_opcols,	BENCH_OPCOLS },
+		{ "commit",	"30",		"0", Bench_endcols,	BENCH_ENDCOLS },
+		{ "image",	"after image",	"none", Bench_mixed,
+		  sizeof (Bench_mixed) / sizeof (Bench_mixed[0]) },
+	};
+	CS_DATAFMT	orig[BENCH_OPCOLS];
+	CS_DATAFMT	fmt[BENCH_OPCOLS];
+	CS_BIGINT	text;
+	CS_BIGINT	n;
+	CS_BIGINT	k;
+	CS_INT		j;
+	size_t		i;
+	double		start;
+	double		secs;
+
+	for (i = 0; i < sizeof (ops) / sizeof (ops[0]); i++)
+	{
+		for (j = 0; j < ops[i].numcols; j++)
+		{
+			bench_fmt(&ops[i].cols[j], &orig[j]);
+			fmt[j] = orig[j];
+			fmt[j].maxlength = ex_display_dlen(&fmt[j]) + 1;
+			if (fmt[j].datatype != CS_DATETIME_TYPE &&
+			    fmt[j].datatype != CS_BIGDATETIME_TYPE)
+			{
+				fmt[j].datatype = CS_CHAR_TYPE;
+				fmt[j].format = CS_FMT_NULLTERM;
+			}
+		}
+		bench_scratch();
+		secs = 0;
+		text = 0;
+		for (n = 0; n < calls; n += BENCH_CHUNK)
+		{
+			start = bench_now();
+			for (k = n; k < calls && k < n + BENCH_CHUNK; k++)
+			{
+				logtransfer_display_header(ops[i].numcols, orig,
+							   fmt, ops[i].operation,
+							   ops[i].status);
+			}
+			lt_out_flush();
+			secs += bench_now() - start;
+			text += bench_scratch();
+		}
+		bench_report("header", ops[i].name, calls, text, secs);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	CS_CHAR		*dir = (argc > 1) ? argv[1] : ".";
+	CS_BIGINT	rows = (argc > 2) ? atoll(argv[2]) : 200000;
+	CS_CHAR		path[1024];
+	CS_CHAR		name[64];
+	CS_RETCODE	retcode = CS_SUCCEED;
+	size_t		i;
+	int		fd;
+	int		out;
+
+	/*
+	** The text display goes to a scratch file in 'dir', and the
+	** results to what was stdout.
+	*/
+	snprintf(path, sizeof (path), "%s/benchdecode.%d.out", dir,
+		 (int)getpid());
+	if ((out = dup(STDOUT_FILENO)) < 0 ||
+	    (Bench_out = fdopen(out, "w")) == NULL ||
+	    (fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0 ||
+	    dup2(fd, STDOUT_FILENO) < 0)
+	{
+		ex_error("benchdecode: opening the scratch file failed");
+		return EX_EXIT_FAIL;
+	}
+	close(fd);
+	unlink(path);
+
+	lt_xact_init(&Lt_open_xacts);
+	lt_compact_init(&Lt_compact, Ex_compact_keycols);
+	lt_batch_init(&Lt_batcher, NULL, Ex_batch_xacts, Ex_batch_bytes,
+		      Ex_batch_delay);
+	if (ex_init(&Cs_context) != CS_SUCCEED)
+	{
+		return EX_EXIT_FAIL;
+	}
+
+	bench_dlen(rows * 10);
+	bench_dtfmt(rows);
+	bench_header(rows);
+
+	snprintf(path, sizeof (path), "%s/benchdecode.%d.capture", dir,
+		 (int)getpid());
+	for (i = 0; i < sizeof (Bench_shapes) / sizeof (Bench_shapes[0]) &&
+	     retcode == CS_SUCCEED; i++)
+	{
+		if ((retcode = bench_make(path, &Bench_shapes[i], Bench_mixed,
+					  sizeof (Bench_mixed) /
+					  sizeof (Bench_mixed[0]))) == CS_SUCCEED)
+		{
+			retcode = bench_fetch(path, Bench_shapes[i].name, rows);
+		}
+		unlink(path);
+	}
+	for (i = 0; i < sizeof (Bench_types) / sizeof (Bench_types[0]) &&
+	     retcode == CS_SUCCEED; i++)
+	{
+		BENCH_COL	cols[BENCH_TYPECOLS];
+		int		j;
+
+		for (j = 0; j < BENCH_TYPECOLS; j++)
+		{
+			cols[j] = Bench_types[i];
+		}
+		snprintf(name, sizeof (name), "insert-%s", Bench_types[i].name);
+		if ((retcode = bench_make(path, &Bench_shapes[1], cols,
+					  BENCH_TYPECOLS)) == CS_SUCCEED)
+		{
+			retcode = bench_fetch(path, name, rows);
+		}
+		unlink(path);
+	}
+	for (i = 3; i < (size_t)argc && retcode == CS_SUCCEED; i++)
+	{
+		retcode = bench_fetch(argv[i], argv[i], rows);
+	}
+
+	lt_batch_cleanup(&Lt_batcher);
+	ex_ctx_cleanup(Cs_context, retcode);
+	return (retcode == CS_SUCCEED) ? EX_EXIT_SUCCEED : EX_EXIT_FAIL;
+}
@@ -0,0 +1,873 @@
+/*
+** Description
+** -----------
+** 	End-to-end benchmark of the capture pipeline. It feeds a synthetic
+** 	change stream through the scan loop, logtransfer_fetch_data(), the
+** 	transaction assembly and batching, and a null or batch file sink,
+** 	and prints one line:
+**
+** 		tables=<count> width=<bytes> lob=<percent> xact=<changes>
+** 		update=<percent> sink=<null|file> events=<row changes>
+** 		xacts=<count> inbytes=<row value bytes> outbytes=<sink bytes>
+** 		secs=<wall time> eventsps=<events/s> mbps=<input MB/s>
+** 		cpuus=<CPU microseconds per event> maxrsskb=<peak RSS>
+** 		trace=<off|usdt|cycles>
+**
+** 	'trace' is the build of the tracepoints of lttrace.h, so that their
+** 	cost shows as the difference between builds. A build that counts
+** 	them adds the line of lt_trace_report().
+**
+** 	The stream is a run of transactions of 'xact' changes each, to
+** 	'tables' tables chosen at random. A change is an update, as a
+** 	before and an after image, for 'update' percent of them, and an
+** 	insert otherwise. A row is two int columns and varchar columns
+** 	making up 'width' bytes, and a text column which is null, or
+** 	'lobsize' bytes long for 'lob' percent of the rows.
+**
+** 	The result source is the Client-Library stand-in of ltreplay.c. The
+** 	stream is written to capture files of about BENCH_SEGMENT events,
+** 	split into scans of BENCH_SCANRECS log records as "numrecs" splits
+** 	them, and each file is replayed before the next is written. Only the
+** 	replay is timed, and the CPU time is that of the replay, sink
+** 	threads included. The peak RSS includes the capture being replayed,
+** 	which is mapped.
+**
+** 	The program is linked with logtransfer.c, its main() renamed.
+**
+** 	Usage: benchpipe [-d directory] [-n events] [-t tables] [-w width]
+** 		[-l lob percent] [-b lobsize] [-x xact size]
+** 		[-u update percent] [-s null|file] [-v]
+**
+** 	-v displays the scanned records, to /dev/null, as logtransfer does.
+** 	The result is printed to stdout.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltxact.h"
+#include "ltcompact.h"
+#include "ltbatch.h"
+#include "ltsink.h"
+#include "ltdict.h"
+#include "ltcapture.h"
+#include "ltout.h"
+#include "lttrace.h"
+
+/*
+** Events per capture file, and log records per scan.
+*/
+#define BENCH_SEGMENT	16384
+#define BENCH_SCANRECS	1000
+
+/*
+** Width of the varchar columns of a row.
+*/
+#define BENCH_VARCHAR	200
+
+/*
+** The operation records of the scan results, as in benchdecode.c.
+*/
+#define BENCH_OPCOLS	10
+#define BENCH_ENDCOLS	9
+
+/*
+** The workload, and the state of its generator.
+*/
+typedef struct _bench_gen
+{
+	CS_INT		tables;
+	CS_INT		width;
+	CS_INT		lob;
+	CS_INT		lobsize;
+	CS_INT		xactsize;
+	CS_INT		update;
+	CS_UINT		seed;
+	CS_INT		xact;
+	CS_INT		pos;
+	CS_INT		recs;
+	CS_INT		scans;
+	CS_BIGINT	events;
+	CS_BIGINT	bytes;
+	CS_INT		numcols;
+	CS_DATAFMT	opfmt[BENCH_OPCOLS];
+	CS_DATAFMT	endfmt[BENCH_ENDCOLS];
+	CS_DATAFMT	*fmt;
+	EX_COLUMN_DATA	opdata[BENCH_OPCOLS];
+	EX_COLUMN_DATA	*coldata;
+	CS_CHAR		*values;
+} BENCH_GEN;
+
+/*
+** The globals and routines of logtransfer.c driven.
+*/
+extern CS_CONTEXT	*Cs_context;
+extern CS_BOOL		Ex_display;
+extern CS_INT		Ex_compact_keycols;
+extern CS_INT		Ex_batch_xacts;
+extern CS_INT		Ex_batch_bytes;
+extern CS_INT		Ex_batch_delay;
+extern LT_XACT_INDEX	Lt_open_xacts;
+extern LT_COMPACT	Lt_compact;
+extern LT_SINK		*Lt_sink;
+extern LT_BATCHER	Lt_batcher;
+
+extern CS_RETCODE CS_PUBLIC handle_logtransfer_scan_results(CS_COMMAND *cmd);
+
+/*
+** Where the result is printed, stdout going to /dev/null.
+*/
+CS_STATIC FILE *Bench_out;
+
+/*
+** bench_now()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Read the monotonic clock.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	The time in seconds.
+*/
+
+CS_STATIC double
+bench_now(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+** bench_cpu()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Read the user and system CPU time of the process, all its threads.
+**
+** Parameters:
+** 	maxrss		- Set to the peak RSS in KB, or NULL.
+**
+** Returns:
+** 	The CPU time in seconds.
+*/
+
+CS_STATIC double
+bench_cpu(CS_BIGINT *maxrss)
+{
+	struct rusage	ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	if (maxrss != NULL)
+	{
+		*maxrss = ru.ru_maxrss;
+	}
+	return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+	       ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+/*
+** bench_rand()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Draw the next number from the generator's seed.
+**
+** Parameters:
+** 	gen		- The generator.
+** 	n		- The upper bound.
+**
+** Returns:
+** 	A number from 0 to n - 1.
+*/
+
+CS_STATIC CS_INT
+bench_rand(BENCH_GEN *gen, CS_INT n)
+{
+	gen->seed = gen->seed * 1103515245 + 12345;
+	return (CS_INT)((gen->seed >> 8) % (CS_UINT)n);
+}
+
+/*
+** bench_col()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Describe a column as ct_describe() would.
+**
+** Parameters:
+** 	fmt		- Set to the description.
+** 	name		- The column name.
+** 	datatype	- The datatype.
+** 	maxlength	- The maximum length.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+bench_col(CS_DATAFMT *fmt, CS_CHAR *name, CS_INT datatype, CS_INT maxlength)
+{
+	memset(fmt, 0, sizeof (*fmt));
+	strncpy(fmt->name, name, sizeof (fmt->name) - 1);
+	fmt->namelen = (CS_INT)strlen(fmt->name);
+	fmt->datatype = datatype;
+	fmt->format = CS_FMT_UNUSED;
+	fmt->maxlength = maxlength;
+	fmt->status = CS_CANBENULL;
+}
+
+/*
+** bench_gen_init()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Set up the column descriptions and value buffers of the generator,
+** 	its workload being set.
+**
+** Parameters:
+** 	gen		- The generator.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR.
+*/
+
+CS_STATIC CS_RETCODE
+bench_gen_init(BENCH_GEN *gen)
+{
+	CS_CHAR		name[32];
+	CS_INT		nvarchar;
+	CS_INT		maxlen;
+	CS_INT		i;
+
+	nvarchar = MAX((gen->width - 8 + BENCH_VARCHAR - 1) / BENCH_VARCHAR, 1);
+	gen->numcols = 2 + nvarchar + 1;
+	maxlen = MAX(gen->lobsize, BENCH_VARCHAR);
+	gen->fmt = (CS_DATAFMT *)malloc(gen->numcols * sizeof (CS_DATAFMT));
+	gen->coldata = (EX_COLUMN_DATA *)malloc(gen->numcols *
+						sizeof (EX_COLUMN_DATA));
+	gen->values = (CS_CHAR *)malloc(BENCH_OPCOLS * 32 +
+					(gen->numcols - 1) * BENCH_VARCHAR +
+					maxlen);
+	if (gen->fmt == NULL || gen->coldata == NULL || gen->values == NULL)
+	{
+		return CS_MEM_ERROR;
+	}
+
+	bench_col(&gen->opfmt[0], "operation", CS_CHAR_TYPE, 20);
+	bench_col(&gen->opfmt[1], "xactpage", CS_INT_TYPE, 4);
+	bench_col(&gen->opfmt[2], "xactrow", CS_INT_TYPE, 4);
+	bench_col(&gen->opfmt[3], "status", CS_CHAR_TYPE, 10);
+	bench_col(&gen->opfmt[4], "page", CS_INT_TYPE, 4);
+	bench_col(&gen->opfmt[5], "row", CS_INT_TYPE, 4);
+	bench_col(&gen->opfmt[6], "spare", CS_CHAR_TYPE, 10);
+	bench_col(&gen->opfmt[7], "user", CS_CHAR_TYPE, 30);
+	bench_col(&gen->opfmt[8], "table", CS_CHAR_TYPE, 30);
+	bench_col(&gen->opfmt[9], "owner", CS_CHAR_TYPE, 30);
+	memcpy(gen->endfmt, gen->opfmt, 8 * sizeof (CS_DATAFMT));
+	bench_col(&gen->endfmt[8], "committime", CS_DATETIME_TYPE, 8);
+	for (i = 0; i < BENCH_OPCOLS; i++)
+	{
+		gen->opdata[i].value = gen->values + i * 32;
+	}
+
+	bench_col(&gen->fmt[0], "id", CS_INT_TYPE, 4);
+	bench_col(&gen->fmt[1], "version", CS_INT_TYPE, 4);
+	for (i = 0; i < nvarchar; i++)
+	{
+		snprintf(name, sizeof (name), "c%d", (int)i);
+		bench_col(&gen->fmt[2 + i], name, CS_VARCHAR_TYPE, BENCH_VARCHAR);
+	}
+	bench_col(&gen->fmt[gen->numcols - 1], "story", CS_TEXT_TYPE, 32768);
+	for (i = 0; i < gen->numcols; i++)
+	{
+		gen->coldata[i].value = gen->values + BENCH_OPCOLS * 32 +
+					i * BENCH_VARCHAR;
+		gen->coldata[i].indicator = 0;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** bench_gen_cleanup()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Free the generator's column descriptions and value buffers.
+**
+** Parameters:
+** 	gen		- The generator.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+bench_gen_cleanup(BENCH_GEN *gen)
+{
+	free(gen->fmt);
+	free(gen->coldata);
+	free(gen->values);
+}
+
+/*
+** bench_put()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Write a log record, a result of one row, to a capture. Once the scan
+** 	holds BENCH_SCANRECS records, an operation record ends it and starts
+** 	the next one; an image stays in the scan of its operation.
+**
+** Parameters:
+** 	gen		- The generator.
+** 	out		- The capture.
+** 	numcols		- The number of columns.
+** 	fmt		- The column descriptions.
+** 	coldata		- The values.
+** 	image		- Whether the record is an image.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure of the capture writer.
+*/
+
+CS_STATIC CS_RETCODE
+bench_put(BENCH_GEN *gen, LT_CAPTURE_OUT *out, CS_INT numcols,
+	  CS_DATAFMT *fmt, EX_COLUMN_DATA *coldata, CS_BOOL image)
+{
+	CS_RETCODE	retcode;
+
+	if (gen->recs >= BENCH_SCANRECS && !image)
+	{
+		if ((retcode = lt_capture_put_end(out, CS_END_RESULTS)) != CS_SUCCEED ||
+		    (retcode = lt_capture_put_scan(out)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+		gen->recs = 0;
+		gen->scans++;
+	}
+	gen->recs++;
+	if ((retcode = lt_capture_put_result(out, CS_ROW_RESULT, 0, numcols,
+					     fmt)) != CS_SUCCEED ||
+	    (retcode = lt_capture_put_row(out, numcols, coldata)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	return lt_capture_put_result(out, CS_CMD_DONE, 0, 0, NULL);
+}
+
+/*
+** bench_op()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Write an operation record of the current transaction.
+**
+** Parameters:
+** 	gen		- The generator.
+** 	out		- The capture.
+** 	op		- The operation.
+** 	status		- The status.
+** 	table		- The table changed, or -1.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure of the capture writer.
+*/
+
+CS_STATIC CS_RETCODE
+bench_op(BENCH_GEN *gen, LT_CAPTURE_OUT *out, CS_CHAR *op, CS_CHAR *status,
+	 CS_INT table)
+{
+	EX_COLUMN_DATA	*coldata = gen->opdata;
+	CS_INT		numcols;
+	CS_INT		ints[4];
+	CS_DATETIME	dt;
+	CS_INT		i;
+
+	numcols = (strcmp(op, "30") == 0) ? BENCH_ENDCOLS : BENCH_OPCOLS;
+	ints[0] = 1000 + gen->xact / 100;
+	ints[1] = gen->xact % 100;
+	ints[2] = 1000 + gen->pos / 100;
+	ints[3] = gen->pos % 100;
+	gen->pos++;
+
+	for (i = 0; i < numcols; i++)
+	{
+		coldata[i].indicator = 0;
+	}
+	coldata[0].valuelen = (CS_INT)strlen(op);
+	memcpy(coldata[0].value, op, coldata[0].valuelen);
+	memcpy(coldata[1].value, &ints[0], sizeof (CS_INT));
+	memcpy(coldata[2].value, &ints[1], sizeof (CS_INT));
+	coldata[1].valuelen = coldata[2].valuelen = sizeof (CS_INT);
+	coldata[3].valuelen = (CS_INT)strlen(status);
+	memcpy(coldata[3].value, status, coldata[3].valuelen);
+	memcpy(coldata[4].value, &ints[2], sizeof (CS_INT));
+	memcpy(coldata[5].value, &ints[3], sizeof (CS_INT));
+	coldata[4].valuelen = coldata[5].valuelen = sizeof (CS_INT);
+	coldata[6].indicator = CS_NULLDATA;
+	coldata[7].valuelen = 2;
+	memcpy(coldata[7].value, "sa", 2);
+	if (numcols == BENCH_ENDCOLS)
+	{
+		dt.dtdays = 45000 + gen->xact / 86400;
+		dt.dttime = (gen->xact % 86400) * 300;
+		memcpy(coldata[8].value, &dt, sizeof (dt));
+		coldata[8].valuelen = sizeof (dt);
+		return bench_put(gen, out, numcols, gen->endfmt, coldata, CS_FALSE);
+	}
+	if (table < 0)
+	{
+		coldata[8].indicator = coldata[9].indicator = CS_NULLDATA;
+	}
+	else
+	{
+		coldata[7].indicator = CS_NULLDATA;
+		coldata[8].valuelen = snprintf(coldata[8].value, 32, "table%d",
+					       (int)table);
+		coldata[9].valuelen = 3;
+		memcpy(coldata[9].value, "dbo", 3);
+	}
+	return bench_put(gen, out, numcols, gen->opfmt, coldata, CS_FALSE);
+}
+
+/*
+** bench_image()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Write an image of a row.
+**
+** Parameters:
+** 	gen		- The generator.
+** 	out		- The capture.
+** 	id		- The row id.
+** 	version		- The version of the row.
+** 	lob		- Whether its text column is set.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure of the capture writer.
+*/
+
+CS_STATIC CS_RETCODE
+bench_image(BENCH_GEN *gen, LT_CAPTURE_OUT *out, CS_INT id, CS_INT version,
+	    CS_BOOL lob)
+{
+	EX_COLUMN_DATA	*coldata = gen->coldata;
+	CS_INT		left = MAX(gen->width - 8, 0);
+	CS_INT		last = gen->numcols - 1;
+	CS_INT		i;
+
+	memcpy(coldata[0].value, &id, sizeof (CS_INT));
+	memcpy(coldata[1].value, &version, sizeof (CS_INT));
+	coldata[0].valuelen = coldata[1].valuelen = sizeof (CS_INT);
+	for (i = 2; i < last; i++)
+	{
+		coldata[i].valuelen = MIN(left, BENCH_VARCHAR);
+		memset(coldata[i].value, 'a' + (id + i) % 26, coldata[i].valuelen);
+		left -= coldata[i].valuelen;
+	}
+	if (lob)
+	{
+		coldata[last].indicator = 0;
+		coldata[last].valuelen = gen->lobsize;
+		memset(coldata[last].value, 'A' + id % 26, gen->lobsize);
+	}
+	else
+	{
+		coldata[last].indicator = CS_NULLDATA;
+		coldata[last].valuelen = 0;
+	}
+	for (i = 0; i < gen->numcols; i++)
+	{
+		gen->bytes += coldata[i].valuelen;
+	}
+	return bench_put(gen, out, gen->numcols, gen->fmt, coldata, CS_TRUE);
+}
+
+/*
+** bench_gen_segment()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Write the next transactions of the stream to a capture file, until
+** 	it holds 'events' changes.
+**
+** Parameters:
+** 	gen		- The generator.
+** 	path		- The capture file.
+** 	events		- The changes to write, at least.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure of the capture writer. gen->scans is
+** 	set to the number of scans in the file.
+*/
+
+CS_STATIC CS_RETCODE
+bench_gen_segment(BENCH_GEN *gen, CS_CHAR *path, CS_BIGINT events)
+{
+	LT_CAPTURE_OUT	out;
+	CS_RETCODE	retcode;
+	CS_BIGINT	done = 0;
+	CS_INT		table;
+	CS_INT		id;
+	CS_INT		c;
+
+	if ((retcode = lt_capture_create(path, &out)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	gen->recs = 0;
+	gen->scans = 1;
+	retcode = lt_capture_put_scan(&out);
+	while (done < events && retcode == CS_SUCCEED)
+	{
+		retcode = bench_op(gen, &out, "0", "0", -1);
+		for (c = 0; c < gen->xactsize && retcode == CS_SUCCEED; c++)
+		{
+			table = bench_rand(gen, gen->tables);
+			id = bench_rand(gen, 1000000);
+			if (bench_rand(gen, 100) < gen->update)
+			{
+				if ((retcode = bench_op(gen, &out, "5", "4",
+							table)) == CS_SUCCEED &&
+				    (retcode = bench_image(gen, &out, id, 1,
+							   bench_rand(gen, 100) < gen->lob)) == CS_SUCCEED &&
+				    (retcode = bench_op(gen, &out, "4", "4",
+							table)) == CS_SUCCEED)
+				{
+					retcode = bench_image(gen, &out, id, 2,
+							      bench_rand(gen, 100) < gen->lob);
+				}
+			}
+			else if ((retcode = bench_op(gen, &out, "4", "0",
+						     table)) == CS_SUCCEED)
+			{
+				retcode = bench_image(gen, &out, id, 1,
+						      bench_rand(gen, 100) < gen->lob);
+			}
+			done++;
+		}
+		if (retcode == CS_SUCCEED)
+		{
+			retcode = bench_op(gen, &out, "30", "0", -1);
+		}
+		gen->xact++;
+	}
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = lt_capture_put_end(&out, CS_END_RESULTS);
+	}
+	if (lt_capture_close(&out) != CS_SUCCEED && retcode == CS_SUCCEED)
+	{
+		retcode = CS_FAIL;
+	}
+	gen->events += done;
+	return retcode;
+}
+
+/*
+** bench_scan()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Run the scans of a capture file through the pipeline, as the scans
+** 	of DoLogtransfer() do.
+**
+** Parameters:
+** 	connection	- The connection.
+** 	cmd		- The command.
+** 	path		- The capture file.
+** 	scans		- The number of scans in it.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure of the scan.
+*/
+
+CS_STATIC CS_RETCODE
+bench_scan(CS_CONNECTION *connection, CS_COMMAND *cmd, CS_CHAR *path,
+	   CS_INT scans)
+{
+	CS_RETCODE	retcode = CS_SUCCEED;
+	CS_INT		s;
+
+	/*
+	** Reconnecting maps the capture named by LT_REPLAY.
+	*/
+	ct_close(connection, CS_UNUSED);
+	if (setenv("LT_REPLAY", path, 1) != 0 ||
+	    ct_connect(connection, NULL, 0) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+	for (s = 0; s < scans && retcode == CS_SUCCEED; s++)
+	{
+		if ((retcode = ct_command(cmd, CS_LANG_CMD,
+					  "dbcc logtransfer('scan', 'continue', '')",
+					  CS_NULLTERM, CS_UNUSED)) == CS_SUCCEED &&
+		    (retcode = ct_send(cmd)) == CS_SUCCEED &&
+		    (retcode = handle_logtransfer_scan_results(cmd)) == CS_SUCCEED)
+		{
+			retcode = lt_batch_poll(&Lt_batcher);
+		}
+	}
+	return retcode;
+}
+
+int
+main(int argc, char *argv[])
+{
+	BENCH_GEN	gen;
+	CS_CHAR		*dir = ".";
+	CS_CHAR		*sinkname = "null";
+	CS_BIGINT	events = 1000000;
+	CS_CHAR		path[1024];
+	CS_CHAR		outpath[1024];
+	CS_CHAR		dictpath[1100];
+	CS_CONNECTION	*connection = NULL;
+	CS_COMMAND	*cmd = NULL;
+	CS_RETCODE	retcode;
+	CS_BIGINT	outbytes = 0;
+	CS_BIGINT	maxrss;
+	CS_BOOL		display = CS_FALSE;
+	struct stat	st;
+	double		secs = 0;
+	double		cpu = 0;
+	double		start;
+	double		startcpu;
+	int		fd;
+	int		c;
+
+	memset(&gen, 0, sizeof (gen));
+	gen.tables = 50;
+	gen.width = 200;
+	gen.lob = 5;
+	gen.lobsize = 4096;
+	gen.xactsize = 10;
+	gen.update = 30;
+	gen.seed = 1;
+	while ((c = getopt(argc, argv, "d:n:t:w:l:b:x:u:s:v")) != -1)
+	{
+		switch (c)
+		{
+			case 'd':
+				dir = optarg;
+				break;
+
+			case 'n':
+				events = atoll(optarg);
+				break;
+
+			case 't':
+				gen.tables = atoi(optarg);
+				break;
+
+			case 'w':
+				gen.width = atoi(optarg);
+				break;
+
+			case 'l':
+				gen.lob = atoi(optarg);
+				break;
+
+			case 'b':
+				gen.lobsize = atoi(optarg);
+				break;
+
+			case 'x':
+				gen.xactsize = atoi(optarg);
+				break;
+
+			case 'u':
+				gen.update = atoi(optarg);
+				break;
+
+			case 's':
+				sinkname = optarg;
+				break;
+
+			case 'v':
+				display = CS_TRUE;
+				break;
+
+			default:
+				fprintf(stderr, "usage: benchpipe [-d directory] [-n events] [-t tables] [-w width] [-l lob percent] [-b lobsize] [-x xact size] [-u update percent] [-s null|file] [-v]\n");
+				return EX_EXIT_FAIL;
+		}
+	}
+	if (events <= 0 || gen.tables <= 0 || gen.width < 8 || gen.lobsize <= 0 ||
+	    gen.lobsize > LT_CAPTURE_MAXBIND || gen.xactsize <= 0 ||
+	    (strcmp(sinkname, "null") != 0 && strcmp(sinkname, "file") != 0))
+	{
+		fprintf(stderr, "benchpipe: invalid workload\n");
+		return EX_EXIT_FAIL;
+	}
+	if (bench_gen_init(&gen) != CS_SUCCEED)
+	{
+		ex_error("benchpipe: malloc() failed");
+		return EX_EXIT_FAIL;
+	}
+
+	/*
+	** The text display, if any, goes to /dev/null, and the result to
+	** what was stdout.
+	*/
+	Ex_display = display;
+	if ((fd = dup(STDOUT_FILENO)) < 0 ||
+	    (Bench_out = fdopen(fd, "w")) == NULL ||
+	    (fd = open("/dev/null", O_WRONLY)) < 0 ||
+	    dup2(fd, STDOUT_FILENO) < 0)
+	{
+		ex_error("benchpipe: redirecting stdout failed");
+		return EX_EXIT_FAIL;
+	}
+	close(fd);
+
+	snprintf(path, sizeof (path), "%s/benchpipe.%d.capture", dir,
+		 (int)getpid());
+	snprintf(outpath, sizeof (outpath), "%s/benchpipe.%d.changes", dir,
+		 (int)getpid());
+	snprintf(dictpath, sizeof (dictpath), "%s.dict", outpath);
+	Lt_sink = NULL;
+	if (strcmp(sinkname, "file") == 0 &&
+	    (lt_dict_open(dictpath) != CS_SUCCEED ||
+	     lt_sink_file_open(outpath, &Lt_sink) != CS_SUCCEED))
+	{
+		return EX_EXIT_FAIL;
+	}
+	lt_xact_init(&Lt_open_xacts);
+	lt_compact_init(&Lt_compact, Ex_compact_keycols);
+	lt_batch_init(&Lt_batcher, Lt_sink, Ex_batch_xacts, Ex_batch_bytes,
+		      Ex_batch_delay);
+	if (ex_init(&Cs_context) != CS_SUCCEED)
+	{
+		return EX_EXIT_FAIL;
+	}
+
+	/*
+	** The first segment is written before connecting, as connecting
+	** maps it.
+	*/
+	retcode = bench_gen_segment(&gen, path, MIN(events, BENCH_SEGMENT));
+	if (retcode == CS_SUCCEED &&
+	    (setenv("LT_REPLAY", path, 1) != 0 ||
+	     ex_connect(Cs_context, &connection, "benchpipe", EX_USERNAME,
+			EX_PASSWORD, EX_SERVER) != CS_SUCCEED ||
+	     ct_cmd_alloc(connection, &cmd) != CS_SUCCEED))
+	{
+		retcode = CS_FAIL;
+	}
+	while (retcode == CS_SUCCEED)
+	{
+		start = bench_now();
+		startcpu = bench_cpu(NULL);
+		retcode = bench_scan(connection, cmd, path, gen.scans);
+		cpu += bench_cpu(NULL) - startcpu;
+		secs += bench_now() - start;
+		if (retcode != CS_SUCCEED || gen.events >= events)
+		{
+			break;
+		}
+		retcode = bench_gen_segment(&gen, path,
+					    MIN(events - gen.events, BENCH_SEGMENT));
+	}
+
+	/*
+	** The output is complete once the last batch is written.
+	*/
+	if (retcode == CS_SUCCEED)
+	{
+		start = bench_now();
+		startcpu = bench_cpu(NULL);
+		retcode = lt_batch_sync(&Lt_batcher);
+		cpu += bench_cpu(NULL) - startcpu;
+		secs += bench_now() - start;
+	}
+	bench_cpu(&maxrss);
+	if (Lt_sink != NULL)
+	{
+		Lt_sink->close(Lt_sink);
+		lt_dict_close();
+		if (stat(outpath, &st) == 0)
+		{
+			outbytes = st.st_size;
+		}
+		unlink(outpath);
+		unlink(dictpath);
+	}
+	unlink(path);
+
+	if (retcode == CS_SUCCEED)
+	{
+		if (secs <= 0)
+		{
+			secs = 1e-9;
+		}
+		fprintf(Bench_out, "tables=%d width=%d lob=%d xact=%d update=%d sink=%s events=%lld xacts=%d inbytes=%lld outbytes=%lld secs=%.3f eventsps=%.0f mbps=%.1f cpuus=%.2f maxrsskb=%lld trace=%s\n",
+			(int)gen.tables, (int)gen.width, (int)gen.lob,
+			(int)gen.xactsize, (int)gen.update, sinkname,
+			(long long)gen.events, (int)gen.xact,
+			(long long)gen.bytes, (long long)outbytes, secs,
+			gen.events / secs,
+			gen.bytes / secs / (1024.0 * 1024.0),
+			cpu * 1e6 / gen.events, (long long)maxrss, LT_TRACE_MODE);
+		lt_trace_report(Bench_out);
+	}
+	else
+	{
+		ex_error("benchpipe: the pipeline failed");
+	}
+
+	if (cmd != NULL)
+	{
+		ct_cmd_drop(cmd);
+	}
+	if (connection != NULL)
+	{
+		ex_con_cleanup(connection, retcode);
+	}
+	ex_ctx_cleanup(Cs_context, retcode);
+	lt_batch_cleanup(&Lt_batcher);
+	lt_xact_cleanup(&Lt_open_xacts);
+	lt_compact_cleanup(&Lt_compact);
+	lt_dict_cleanup();
+	bench_gen_cleanup(&gen);
+	return (retcode == CS_SUCCEED) ? EX_EXIT_SUCCEED : EX_EXIT_FAIL;
+}
@@ -0,0 +1,339 @@
+/*
+** Description
+** -----------
+** 	Benchmark of the batch file sinks on local disk. It writes the same
+** 	stream of batches, at a range of batch sizes, through
+**
+** 		write	- writev() of each batch, and an fdatasync() after
+** 			  every 'syncbytes' bytes, both on the calling thread
+** 		uring	- the io_uring sink of lturing.c, syncing as often
+**
+** 	and prints one line per run:
+**
+** 		sink=<name> batch=<bytes> total=<bytes> secs=<wall time>
+** 		mbps=<MB/s> usbatch=<microseconds per batch>
+**
+** 	The time includes the final sync, so both sinks leave the same data
+** 	on disk.
+**
+** 	Usage: benchsink [directory [total MB [sync MB]]]
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/uio.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltbatch.h"
+#include "ltsink.h"
+#include "lturing.h"
+
+/*
+** Batch sizes benchmarked.
+*/
+CS_STATIC CS_INT Bench_sizes[] = { 4096, 16384, 65536, 262144, 1048576 };
+
+/*
+** State of the write()+fsync sink.
+*/
+typedef struct _bench_sink
+{
+	LT_SINK		sink;
+	int		fd;
+	LT_BUF		header;
+	CS_BIGINT	unsynced;
+	CS_BIGINT	syncbytes;
+} BENCH_SINK;
+
+/*
+** bench_write()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Write a batch with writev(), and fdatasync() after every 'syncbytes'
+** 	bytes.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	batch		- The batch to write.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a write failed.
+*/
+
+CS_STATIC CS_RETCODE
+bench_write(LT_SINK *sink, LT_BATCH *batch)
+{
+	BENCH_SINK	*bs = (BENCH_SINK *)sink->ctx;
+	struct iovec	iov[2];
+	ssize_t		len;
+
+	bs->header.len = 0;
+	if (lt_sink_encode(&bs->header, batch) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+	iov[0].iov_base = bs->header.data;
+	iov[0].iov_len = bs->header.len;
+	iov[1].iov_base = batch->changes.data;
+	iov[1].iov_len = batch->changes.len;
+	len = writev(bs->fd, iov, 2);
+	if (len != (ssize_t)(iov[0].iov_len + iov[1].iov_len))
+	{
+		ex_error("bench_write: writev() failed");
+		return CS_FAIL;
+	}
+	bs->unsynced += len;
+	if (bs->unsynced >= bs->syncbytes)
+	{
+		bs->unsynced = 0;
+		if (fdatasync(bs->fd) != 0)
+		{
+			ex_error("bench_write: fdatasync() failed");
+			return CS_FAIL;
+		}
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** bench_sync()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	fdatasync() the file.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if fdatasync() failed.
+*/
+
+CS_STATIC CS_RETCODE
+bench_sync(LT_SINK *sink)
+{
+	BENCH_SINK	*bs = (BENCH_SINK *)sink->ctx;
+
+	bs->unsynced = 0;
+	return (fdatasync(bs->fd) == 0) ? CS_SUCCEED : CS_FAIL;
+}
+
+/*
+** bench_close()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Close the file and free the sink.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if close() failed.
+*/
+
+CS_STATIC CS_RETCODE
+bench_close(LT_SINK *sink)
+{
+	BENCH_SINK	*bs = (BENCH_SINK *)sink->ctx;
+	CS_RETCODE	retcode;
+
+	retcode = (close(bs->fd) == 0) ? CS_SUCCEED : CS_FAIL;
+	lt_buf_free(&bs->header);
+	free(bs);
+	return retcode;
+}
+
+/*
+** bench_open()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Open a write()+fsync sink.
+**
+** Parameters:
+** 	path		- Path of the file.
+** 	syncbytes	- Bytes written between fsyncs.
+** 	sink		- Set to the new sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the file could not be opened.
+*/
+
+CS_STATIC CS_RETCODE
+bench_open(CS_CHAR *path, CS_INT syncbytes, LT_SINK **sink)
+{
+	BENCH_SINK	*bs;
+
+	bs = (BENCH_SINK *)calloc(1, sizeof (BENCH_SINK));
+	if (bs == NULL)
+	{
+		return CS_MEM_ERROR;
+	}
+	bs->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if (bs->fd < 0)
+	{
+		ex_error("bench_open: open() failed");
+		free(bs);
+		return CS_FAIL;
+	}
+	bs->syncbytes = syncbytes;
+	bs->sink.name = "write";
+	bs->sink.write = bench_write;
+	bs->sink.close = bench_close;
+	bs->sink.sync = bench_sync;
+	bs->sink.ctx = bs;
+	*sink = &bs->sink;
+	return CS_SUCCEED;
+}
+
+/*
+** bench_now()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Read the monotonic clock.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	The time in seconds.
+*/
+
+CS_STATIC double
+bench_now(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+** bench_run()
+**
+** Type of function:
+** 	benchmark internal api
+**
+** Purpose:
+** 	Write 'total' bytes of batches of 'size' bytes through a sink, sync
+** 	it, and print the timing.
+**
+** Parameters:
+** 	sink		- The sink; it is closed.
+** 	size		- Bytes of changes per batch.
+** 	total		- Bytes to write.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a write failed.
+*/
+
+CS_STATIC CS_RETCODE
+bench_run(LT_SINK *sink, CS_INT size, CS_BIGINT total)
+{
+	LT_BATCH_XACT	xact;
+	LT_BATCH	batch;
+	CS_CHAR		*name = sink->name;
+	CS_BIGINT	nbatches;
+	CS_BIGINT	i;
+	double		start;
+	double		secs;
+
+	memset(&batch, 0, sizeof (batch));
+	if (lt_buf_reserve(&batch.changes, size) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+	memset(batch.changes.data, 'x', size);
+	batch.changes.len = size;
+	batch.xacts = &xact;
+	batch.nxacts = 1;
+	batch.nchanges = 1;
+	memset(&xact, 0, sizeof (xact));
+	xact.nchanges = 1;
+	xact.len = size;
+
+	nbatches = (total + size - 1) / size;
+	start = bench_now();
+	for (i = 0; i < nbatches; i++)
+	{
+		xact.xactid = (CS_UBIGINT)i * 2 + 1;
+		xact.commitpos = batch.lastpos = (CS_UBIGINT)i * 2 + 2;
+		if (sink->write(sink, &batch) != CS_SUCCEED ||
+		    (sink->poll != NULL && sink->poll(sink) != CS_SUCCEED))
+		{
+			sink->close(sink);
+			lt_buf_free(&batch.changes);
+			return CS_FAIL;
+		}
+	}
+	if (sink->sync(sink) != CS_SUCCEED || sink->close(sink) != CS_SUCCEED)
+	{
+		lt_buf_free(&batch.changes);
+		return CS_FAIL;
+	}
+	secs = bench_now() - start;
+
+	printf("sink=%s batch=%d total=%lld secs=%.3f mbps=%.1f usbatch=%.2f\n",
+	       name, (int)size, (long long)(nbatches * size), secs,
+	       nbatches * size / secs / (1024.0 * 1024.0),
+	       secs * 1e6 / nbatches);
+	fflush(stdout);
+	lt_buf_free(&batch.changes);
+	return CS_SUCCEED;
+}
+
+int
+main(int argc, char *argv[])
+{
+	CS_CHAR		*dir = (argc > 1) ? argv[1] : ".";
+	CS_BIGINT	total = (argc > 2) ? atoll(argv[2]) : 256;
+	CS_INT		syncbytes = (argc > 3) ? atoi(argv[3]) : 8;
+	CS_CHAR		path[1024];
+	LT_SINK		*sink;
+	size_t		i;
+	int		pass;
+
+	total *= 1024 * 1024;
+	syncbytes *= 1024 * 1024;
+	snprintf(path, sizeof (path), "%s/benchsink.%d.changes", dir,
+		 (int)getpid());
+
+	for (i = 0; i < sizeof (Bench_sizes) / sizeof (Bench_sizes[0]); i++)
+	{
+		for (pass = 0; pass < 2; pass++)
+		{
+			unlink(path);
+			if (((pass == 0) ? bench_open(path, syncbytes, &sink) :
+			     lt_uring_open(path, 1024 * 1024, syncbytes, &sink))
+				!= CS_SUCCEED ||
+			    bench_run(sink, Bench_sizes[i], total) != CS_SUCCEED)
+			{
+				unlink(path);
+				return EX_EXIT_FAIL;
+			}
+		}
+	}
+	unlink(path);
+	return EX_EXIT_SUCCEED;
+}
@@ -51,6 +51,8 @@
 #include <ctpublic.h>
 #include "example.h"
 #include "exutils.h"
+#include "ltout.h"
+#include "ltlog.h"
 
 /* 
 ** The macro PARTIAL_TEXT to enable partial text update is defined at the
@@ -169,35 +171,25 @@ ex_display_header(CS_INT numcols, CS_DATAFMT columns[])
 {
 	CS_INT		i;
 	CS_INT		l;
-	CS_INT		j;
 	CS_INT		disp_len;
 
-	fputc('\n', stdout);
+	lt_out_putc('\n');
 	for (i = 0; i < numcols; i++)
 	{
 		disp_len = ex_display_dlen(&columns[i]);
-		fprintf(stdout, "%s", columns[i].name);
-		fflush(stdout);
+		lt_out_puts(columns[i].name);
 		l = disp_len - strlen(columns[i].name);
-		for (j = 0; j < l; j++)
-		{
-			fputc(' ', stdout);
-			fflush(stdout);
-		}
+		lt_out_pad(' ', l);
 	}
-	fputc('\n', stdout);
-	fflush(stdout);
+	lt_out_putc('\n');
 	for (i = 0; i < numcols; i++)
 	{
 		disp_len = ex_display_dlen(&columns[i]);
 		l = disp_len - 1;
-		for (j = 0; j < l; j++)
-		{
-			fputc('-', stdout);
-		}
-		fputc(' ', stdout);
+		lt_out_pad('-', l);
+		lt_out_putc(' ');
 	}
-	fputc('\n', stdout);
+	lt_out_putc('\n');
 
 	return CS_SUCCEED;
 }
@@ -229,7 +221,6 @@ ex_display_column(CS_CONTEXT *context, CS_DATAFMT *colfmt, CS_VOID *data,
 	CS_INT		olen;
 	CS_CHAR		wbuf[MAX_CHAR_BUF];
 	CS_BOOL		res;
-	CS_INT		i;
 	CS_INT		disp_len;
 	CS_SMALLINT	indi;
 
@@ -280,19 +271,10 @@ ex_display_column(CS_CONTEXT *context, CS_DATAFMT *colfmt, CS_VOID *data,
 		}
 	}
 
-	for (i = 0; i < olen; i++)
-	{
-		fprintf(stdout, "%c", wbuf[i]);
-	}
-
-	fflush(stdout);
+	lt_out_write(wbuf, olen);
 
 	disp_len = ex_display_dlen(colfmt);
-	for (i = 0; i < (disp_len - olen); i++)
-	{
-		fputc(' ', stdout);
-	}
-	fflush(stdout);
+	lt_out_pad(' ', disp_len - olen);
 	
 	return CS_SUCCEED;
 }
@@ -304,7 +286,7 @@ ex_display_column(CS_CONTEXT *context, CS_DATAFMT *colfmt, CS_VOID *data,
 ** 	example program utility api
 **
 ** Purpose:
-** 	Reports a string message to EX_STANDARD_OUT.
+** 	Reports a string message to EX_STANDARD_OUT, through the logger.
 **
 ** Returns:
 ** 	nothing
@@ -316,8 +298,7 @@ ex_display_column(CS_CONTEXT *context, CS_DATAFMT *colfmt, CS_VOID *data,
 CS_VOID CS_PUBLIC
 ex_msg(char *msg)
 {
-    fprintf(EX_STANDARD_OUT, "MESSAGE: %s\n", msg);
-    fflush(EX_STANDARD_OUT);
+    lt_log(LT_LOG_INFO, "%s", msg);
 }
 
 /*****************************************************************************
@@ -345,6 +326,8 @@ ex_msg(char *msg)
 CS_VOID CS_PUBLIC
 ex_panic(char *msg)
 {
+	lt_log_flush();
+	lt_out_flush();
 	fprintf(EX_ERROR_OUT, "ex_panic: FATAL ERROR: %s\n", msg);
 	fflush(EX_ERROR_OUT);
 	exit(EX_EXIT_FAIL);
@@ -357,7 +340,7 @@ ex_panic(char *msg)
 ** 	example program utility api
 **
 ** Purpose:
-** 	Reports a string message to EX_ERROR_OUT.
+** 	Reports a string message to EX_ERROR_OUT, through the logger.
 **
 ** Returns:
 ** 	nothing
@@ -369,8 +352,7 @@ ex_panic(char *msg)
 CS_VOID CS_PUBLIC
 ex_error(char *msg)
 {
-	fprintf(EX_ERROR_OUT, "ERROR: %s\n", msg);
-	fflush(EX_ERROR_OUT);
+	lt_log(LT_LOG_ERROR, "%s", msg);
 }
 
 /*****************************************************************************
@@ -410,6 +392,7 @@ ex_clientmsg_cb(CS_CONTEXT *context, CS_CONNECTION *connection, CS_CLIENTMSG *er
 		return CS_SUCCEED;
 	}
 	
+	lt_out_flush();
 	fprintf(EX_ERROR_OUT, "\nOpen Client Message:\n");
 	fprintf(EX_ERROR_OUT, "Message number: LAYER = (%d) ORIGIN = (%d) ",
 		CS_LAYER(errmsg->msgnumber), CS_ORIGIN(errmsg->msgnumber));
@@ -453,6 +436,7 @@ ex_servermsg_cb(CS_CONTEXT *context, CS_CONNECTION *connection, CS_SERVERMSG *sr
 		return CS_SUCCEED;
 	}
 	 
+	lt_out_flush();
 	fprintf(EX_ERROR_OUT, "\nServer message:\n");
 	fprintf(EX_ERROR_OUT, "Message number: %d, Severity %d, ",
 		srvmsg->msgnumber, srvmsg->severity);
@@ -728,7 +712,7 @@ ex_connect(CS_CONTEXT *context, CS_CONNECTION **connection, CS_CHAR *appname,
 			CS_PARTIAL_TEXT, &partial, CS_UNUSED, NULL))
 			!= CS_SUCCEED)
 		{
-			printf("ct_con_props(partial update) failed\n");
+			ex_error("ct_con_props(partial update) failed");
 		}
 	}
 #endif /* PARTIAL_TEXT */
@@ -1157,8 +1141,7 @@ ex_fetch_data(CS_COMMAND *cmd)
 		*/
 		if (retcode == CS_ROW_FAIL)
 		{
-			fprintf(stdout, "Error on row %d.\n", row_count);
-			fflush(stdout);
+			lt_out_printf("Error on row %d.\n", row_count);
 		}
 
 		/*
@@ -1170,8 +1153,7 @@ ex_fetch_data(CS_COMMAND *cmd)
 			/*
 			** Display the column value
 			*/
-			fprintf(stdout, "%s", coldata[i].value);
-			fflush(stdout);
+			lt_out_puts(coldata[i].value);
 
 			/*
 			** If not last column, Print out spaces between this
@@ -1181,14 +1163,10 @@ ex_fetch_data(CS_COMMAND *cmd)
 			{
 				disp_len = ex_display_dlen(&datafmt[i]);
 				disp_len -= coldata[i].valuelen - 1;
-				for (j = 0; j < disp_len; j++)
-				{
-					fputc(' ', stdout);
-				}
+				lt_out_pad(' ', disp_len);
 			}
 		} 
-		fprintf(stdout, "\n");
-		fflush(stdout);
+		lt_out_putc('\n');
 	}
 
 	/*
@@ -1211,8 +1189,8 @@ ex_fetch_data(CS_COMMAND *cmd)
 			/*
 			** Everything went fine.
 			*/
-			fprintf(stdout, "All done processing rows.\n");
-			fflush(stdout);
+			lt_out_puts("All done processing rows.\n");
+			lt_out_flush();
 			retcode = CS_SUCCEED;
 			break;
 
@@ -1431,15 +1409,15 @@ ex_handle_results(CS_COMMAND *cmd)
 			switch ((int)res_type)
 			{
 			  case  CS_ROW_RESULT:
-				fprintf(stdout, "\nROW RESULTS\n");
+				lt_out_puts("\nROW RESULTS\n");
 				break;
 
 			  case  CS_PARAM_RESULT:
-				fprintf(stdout, "\nPARAMETER RESULTS\n");
+				lt_out_puts("\nPARAMETER RESULTS\n");
 				break;
 
 			  case  CS_STATUS_RESULT:
-				fprintf(stdout, "\nSTATUS RESULTS\n");
+				lt_out_puts("\nSTATUS RESULTS\n");
 				break;
 			}
 	
@@ -1465,7 +1443,7 @@ ex_handle_results(CS_COMMAND *cmd)
 				ex_error("ex_handle_results: ct_res_info(msgtype) failed");
 				return retcode;
 			}
-			fprintf(stdout, "ct_result returned CS_MSG_RESULT where msg id = %d.\n",
+			lt_out_printf("ct_result returned CS_MSG_RESULT where msg id = %d.\n",
 				 msg_id);
 			break;
 
@@ -21,9 +21,32 @@
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <time.h>
 #include <ctpublic.h>
 #include "example.h"
 #include "exutils.h"
+#include "ltxact.h"
+#include "ltckpt.h"
+#include "ltcompact.h"
+#include "ltbatch.h"
+#include "ltsink.h"
+#include "ltarrow.h"
+#include "ltjson.h"
+#include "ltsegment.h"
+#include "ltring.h"
+#include "ltserver.h"
+#include "ltshard.h"
+#include "lturing.h"
+#include "ltdurable.h"
+#include "ltdict.h"
+#include "ltcapture.h"
+#include "ltout.h"
+#include "lthist.h"
+#include "ltmetrics.h"
+#include "ltlag.h"
+#include "ltbacklog.h"
+#include "lttrace.h"
+#include "ltlog.h"
 
 /*****************************************************************************
 ** 
@@ -48,6 +71,7 @@
 #define OPERATION_BEFORE_AND_AFTER_IMAGE "before & after image"
 #define OPERATION_ALLOC "13"  // Allocate page
 #define OPERATION_CHECKPOINT "17"
+#define OPERATION_SAVEPT "18"  // Savepoint (SAVEXACT)
 #define OPERATION_DEALLOC "21"  // Deallocate page
 #define OPERATION_CLEAR "26"
 #define OPERATION_ENDXACT "30"
@@ -78,6 +102,279 @@ CS_CHAR *Ex_password = EX_PASSWORD;
 #define	GET_CS_CONTEXT	Cs_context
 CS_CONTEXT		*Cs_context;
 
+/*
+** In-flight transaction checkpoint. The transactions still open, with the
+** changes they have buffered, are written to Ex_ckpt_path between scans
+** at most every Ex_ckpt_interval seconds, and reloaded on startup.
+** Checkpointing is off unless Ex_ckpt_path is set to a file name, such as
+** "logtransfer.ckpt".
+*/
+CS_CHAR *Ex_ckpt_path = NULL;
+CS_INT  Ex_ckpt_interval = 60;
+
+/*
+** Net-change compaction. When Ex_compact is set, the changes of each
+** committed transaction are folded into their net effect per row, a row
+** being identified by the first Ex_compact_keycols columns of its image.
+** When Ex_compact_batch is set, so are the changes of all the
+** transactions of an output batch, which then goes out as one
+** transaction.
+*/
+CS_BOOL Ex_compact = CS_FALSE;
+CS_BOOL Ex_compact_batch = CS_FALSE;
+CS_INT  Ex_compact_keycols = 1;
+
+/*
+** Output of committed transactions. They are gathered into batches that
+** are appended to Ex_output_path, a batch closing after Ex_batch_xacts
+** transactions, Ex_batch_bytes bytes of changes or Ex_batch_delay
+** milliseconds, whichever comes first. They are discarded unless
+** Ex_output_path is set, for instance to "logtransfer.changes".
+** Ex_output_format selects the format: "binary" for the
+** batch file of ltsink.c, "arrow" for one Arrow IPC stream per table,
+** named after Ex_output_path, "json" for JSON Lines, one object per
+** row change ("-" as Ex_output_path writes them to stdout), "segment"
+** for compressed segment files named after Ex_output_path, each rolled
+** over after Ex_segment_bytes bytes or Ex_segment_secs seconds, "ring"
+** for a shared memory ring buffer of Ex_ring_bytes bytes at
+** Ex_output_path, read in place by consumers on the same host, or
+** "server" to serve them to consumers connecting to Ex_output_path, a
+** Unix socket path or "tcp:[host:]port", from a replay buffer of
+** Ex_server_bytes bytes, or "shard" to route the changes by table to
+** Ex_shard_count files named after Ex_output_path, each written by its
+** own thread with up to Ex_shard_queue bytes queued for it, or "uring"
+** for the batch file written through io_uring from registered buffers of
+** Ex_uring_bytes bytes, with an fdatasync every Ex_uring_sync_bytes.
+** Table, owner and user names are written once, to the dictionary file
+** named after Ex_output_path with ".dict" appended, and referred to by id
+** in every format but "json", "arrow" and "server".
+**
+** The batch delay is checked as rows arrive and between result sets, so
+** while the log is quiet a batch can be held for up to Ex_scan_timeout
+** seconds past it.
+*/
+CS_CHAR *Ex_output_path = NULL;
+CS_CHAR *Ex_output_format = "binary";
+CS_INT  Ex_batch_xacts = 1000;
+CS_INT  Ex_batch_bytes = 1024 * 1024;
+CS_INT  Ex_batch_delay = 100;
+CS_INT  Ex_segment_bytes = 64 * 1024 * 1024;
+CS_INT  Ex_segment_secs = 3600;
+CS_INT  Ex_ring_bytes = 16 * 1024 * 1024;
+CS_INT  Ex_server_bytes = 64 * 1024 * 1024;
+CS_INT  Ex_shard_count = 8;
+CS_INT  Ex_shard_queue = 16 * 1024 * 1024;
+CS_INT  Ex_uring_bytes = 1024 * 1024;
+CS_INT  Ex_uring_sync_bytes = 8 * 1024 * 1024;
+
+/*
+** Group fsync of the output files. They are synced together
+** Ex_fsync_interval milliseconds after a write, or once Ex_fsync_bytes
+** bytes have been written, by a thread of their own started only when
+** Ex_output_path is set. A checkpoint is
+** only written, and the truncation point only advanced, once the
+** output before it is on disk. Set Ex_fsync_interval to 0 to leave the
+** output to the page cache.
+*/
+CS_INT  Ex_fsync_interval = 200;
+CS_INT  Ex_fsync_bytes = 8 * 1024 * 1024;
+
+/*
+** Set Ex_display to CS_FALSE to skip the aligned text display of the
+** scanned log records, when only the output sink is wanted.
+*/
+CS_BOOL Ex_display = CS_TRUE;
+
+/*
+** Recording of the scans. Set Ex_capture_path to record the results of
+** every scan, with their column descriptions and native row values, to a
+** capture file that logtransfer_replay serves its scans from. Values
+** longer than LT_CAPTURE_MAXBIND bytes are truncated.
+*/
+CS_CHAR *Ex_capture_path = NULL;
+
+/*
+** Scan qualifiers. A scan returns once it has scanned Ex_scan_numrecs log
+** records, or after Ex_scan_timeout seconds with those there are. The
+** latency of each stage of the scans, printed at exit and kept in the
+** metrics, shows which of them bounds the round trip.
+*/
+CS_INT  Ex_scan_numrecs = 1000;
+CS_INT  Ex_scan_timeout = 15;
+
+/*
+** Metrics. Set Ex_metrics_address to "[host:]port" to serve the metrics
+** as Prometheus text over HTTP at "/metrics", on the loopback address
+** unless a host is given. Set Ex_stats_interval to a number of seconds,
+** such as 10, to write a stats line of their rates to stderr that often;
+** it is 0, for none, by default.
+*/
+CS_CHAR *Ex_metrics_address = NULL;
+CS_INT  Ex_stats_interval = 0;
+
+/*
+** Logging. Messages below Ex_log_level are dropped; LT_LOG_DEBUG shows
+** every command sent, scans included. The others are queued and written
+** by a thread of their own every Ex_log_interval milliseconds, warnings
+** and errors at once. The same message is let through Ex_log_burst times
+** per Ex_log_window seconds, and the repeats past that are counted; set
+** Ex_log_burst to 0 for no limit.
+*/
+CS_INT  Ex_log_level = LT_LOG_INFO;
+CS_INT  Ex_log_interval = 100;
+CS_INT  Ex_log_burst = 10;
+CS_INT  Ex_log_window = 60;
+
+/*
+** Replication lag. Each committed transaction is stamped when it is
+** captured and when it is emitted, and its lag from the commit time of
+** its ENDXACT record is kept in the metrics. The server's clock is read
+** with getdate() before a scan at most every Ex_clock_probe_interval
+** seconds, to correct ours to it; set it to 0 to take the clocks to
+** agree.
+*/
+CS_INT  Ex_clock_probe_interval = 60;
+
+/*
+** Log backlog. Every Ex_backlog_interval seconds the end of the log is
+** read before a scan, over the scan's connection, to estimate the log left
+** to scan and the time to catch up with it. Once the backlog reaches
+** Ex_catchup_pages pages the scans are switched to Ex_catchup_numrecs
+** records each, and back to Ex_scan_numrecs once it is down to
+** Ex_latency_pages. This is off unless Ex_backlog_interval is set to a
+** number of seconds, such as 30.
+*/
+CS_INT  Ex_backlog_interval = 0;
+CS_INT  Ex_catchup_pages = 10000;
+CS_INT  Ex_latency_pages = 1000;
+CS_INT  Ex_catchup_numrecs = 20000;
+
+/*
+** Transactions that have begun but not yet ended in the log scanned so far,
+** and the position of the last log record processed.
+*/
+LT_XACT_INDEX		Lt_open_xacts;
+LT_LOGPOS		Lt_scan_pos;
+time_t			Lt_last_ckpt;
+
+/*
+** Set once a scan has failed, or a record of one could not be assembled
+** or written out: the scan position may then be past changes that were
+** lost, so nothing is checkpointed from then on.
+*/
+CS_BOOL			Lt_scan_failed;
+
+/*
+** The scan position restored from the checkpoint. A restart rescans from
+** the truncation point, and until the scan is past this position again
+** the records it returns were processed before the checkpoint: only
+** those of the restored open transactions are fed to the assembler, and
+** the scan position is not moved back. Positions are compared in scan
+** order from 'Lt_resume_base', the first record rescanned, which holds
+** once the log wraps: the truncation point the rescan starts from is
+** never moved past the scan position.
+*/
+LT_LOGPOS		Lt_resume_pos;
+CS_UBIGINT		Lt_resume_base;
+CS_BOOL			Lt_resuming;
+CS_BOOL			Lt_resume_based;
+LT_COMPACT		Lt_compact;
+LT_SINK			*Lt_sink;
+LT_BATCHER		Lt_batcher;
+LT_CAPTURE_OUT		Lt_capture;
+CS_BOOL			Lt_capturing;
+time_t			Lt_last_probe;
+CS_INT			Lt_tuning = LT_BACKLOG_LATENCY;
+
+/*
+** The operation record whose row images are expected next.
+*/
+#define LT_OP_NONE	0
+#define LT_DTBUF_LEN	32
+
+/*
+** The most columns logtransfer_select_row() fetches.
+*/
+#define LT_SELECT_MAXCOLS	4
+
+/*
+** The character string a null column is bound as.
+*/
+#define LT_NULL_STRING	"NULL"
+
+struct
+{
+    CS_INT      op;
+    LT_LOGPOS   xactid;
+    LT_LOGPOS   pos;
+    CS_UINT     tableid;
+    CS_UINT     ownerid;
+} Lt_pending;
+
+/*
+** Metrics of the scan, registered by logtransfer_metrics_init().
+*/
+struct
+{
+    LT_METRIC       scans;
+    LT_METRIC       rows;
+    LT_METRIC       bytes;
+    LT_METRIC       xacts;
+    LT_METRIC       changes;
+    LT_METRIC       empty;
+    LT_METRIC       open;
+    LT_METRIC       command_errors;
+    LT_METRIC       row_errors;
+    LT_METRIC       assemble_errors;
+    LT_METRIC       capture_errors;
+    LT_METRIC_HIST  scan_time;
+    LT_METRIC_HIST  first_time;
+    LT_METRIC_HIST  stream_time;
+    LT_METRIC_HIST  wait_time;
+    LT_METRIC_HIST  decode_time;
+    LT_METRIC_HIST  sink_time;
+    LT_METRIC_HIST  xact_size;
+} Lt_stats;
+
+/*
+** Timing of the scan in progress, by lt_clock_usec(): when it was sent,
+** when its first result and its first row came back, the time spent in
+** ct_results() and ct_fetch() since the first result, and the time the
+** batcher had spent writing when the results started.
+*/
+struct
+{
+    CS_BIGINT   sent;
+    CS_BIGINT   first;
+    CS_BIGINT   firstrow;
+    CS_BIGINT   wait;
+    CS_BIGINT   busy;
+} Lt_scan_time;
+
+/*
+** The operations whose results are ignored, with the name they are
+** reported by and the count of them.
+*/
+struct
+{
+    CS_CHAR     *op;
+    CS_CHAR     *name;
+    CS_CHAR     *labels;
+    LT_METRIC   count;
+} Lt_ignored[] =
+{
+    { OPERATION_BT_INSERT, "BT_INSERT", "op=\"BT_INSERT\"" },
+    { OPERATION_BT_DELETE, "BT_DELETE", "op=\"BT_DELETE\"" },
+    { OPERATION_DEALLOC, "DEALLOC", "op=\"DEALLOC\"" },
+    { OPERATION_ALLOC, "ALLOC", "op=\"ALLOC\"" },
+    { OPERATION_CHECKPOINT, "CHECKPOINT", "op=\"CHECKPOINT\"" },
+    { OPERATION_50, "operation 50", "op=\"50\"" },
+    { OPERATION_58, "operation 58", "op=\"58\"" },
+    { OPERATION_59, "operation 59", "op=\"59\"" }
+};
+
+#define LT_NIGNORED	(CS_INT)(sizeof (Lt_ignored) / sizeof (Lt_ignored[0]))
+
 /*
 ** Prototypes for routines in the example code.
 */
@@ -87,8 +384,10 @@ CS_STATIC CS_RETCODE DoLogtransfer(CS_CONNECTION *connection,
                                    CS_CHAR *qualifier,
                                    CS_CHAR *parm);
 CS_RETCODE CS_PUBLIC handle_logtransfer_scan_results(CS_COMMAND *cmd);
+CS_STATIC CS_RETCODE logtransfer_scan_results(CS_COMMAND *cmd);
 CS_STATIC CS_RETCODE DoDML(CS_CONNECTION *connection, CS_CHAR *dml);
 CS_RETCODE CS_PUBLIC logtransfer_fetch_data(CS_COMMAND *cmd,
+                                            CS_INT res_type,
                                             CS_CHAR *operation,
                                             CS_CHAR *status);
 CS_RETCODE CS_PUBLIC logtransfer_display_header(CS_INT numcols,
@@ -98,6 +397,46 @@ CS_RETCODE CS_PUBLIC logtransfer_display_header(CS_INT numcols,
                                                 CS_CHAR *status);
 CS_RETCODE logtransfer_dt_fmt(CS_VOID *val, CS_CHAR *out_buf,
                               CS_INT bufSize, CS_INT date_type);
+CS_STATIC CS_BOOL logtransfer_logpos(EX_COLUMN_DATA coldata[], CS_INT num_cols,
+                                     CS_INT col, LT_LOGPOS *pos);
+CS_STATIC CS_BOOL logtransfer_resumed(LT_LOGPOS *xactid, LT_LOGPOS *pos);
+CS_STATIC CS_VOID logtransfer_advance(LT_LOGPOS *pos);
+CS_STATIC CS_RETCODE logtransfer_assemble_row(CS_CHAR *operation, CS_INT row,
+                                              CS_INT num_cols,
+                                              CS_DATAFMT orig_datafmt[],
+                                              EX_COLUMN_DATA coldata[]);
+CS_STATIC CS_RETCODE logtransfer_commit_xact(LT_XACT *xact,
+                                             LT_LOGPOS *commitpos,
+                                             CS_BIGINT committime);
+CS_STATIC CS_RETCODE logtransfer_dt_epoch(CS_VOID *val, CS_INT date_type,
+                                          CS_BIGINT *usec);
+CS_STATIC CS_RETCODE logtransfer_checkpoint(CS_BOOL force);
+CS_STATIC CS_BOOL logtransfer_unacked(CS_UBIGINT *unacked);
+CS_STATIC CS_VOID logtransfer_report_lowwater(CS_VOID);
+CS_STATIC CS_VOID logtransfer_report_fsync(CS_VOID);
+CS_STATIC CS_RETCODE logtransfer_fetch_row(CS_COMMAND *cmd, CS_INT num_cols,
+                                           CS_DATAFMT orig_datafmt[],
+                                           CS_DATAFMT datafmt[],
+                                           EX_COLUMN_DATA coldata[],
+                                           EX_COLUMN_DATA rawdata[],
+                                           CS_INT *rows_read);
+CS_STATIC CS_VOID logtransfer_capture_result(CS_INT res_type, CS_INT msg_id);
+CS_STATIC CS_VOID logtransfer_capture_stop(CS_VOID);
+CS_STATIC CS_VOID logtransfer_metrics_init(CS_VOID);
+CS_STATIC CS_RETCODE logtransfer_results(CS_COMMAND *cmd, CS_INT *res_type);
+CS_STATIC CS_BIGINT logtransfer_scan_waited(CS_BIGINT start);
+CS_STATIC CS_VOID logtransfer_scan_timed(CS_VOID);
+CS_STATIC CS_VOID logtransfer_report_scans(CS_VOID);
+CS_STATIC CS_RETCODE logtransfer_select_row(CS_CONNECTION *connection,
+                                            CS_CHAR *sql, CS_INT numcols,
+                                            CS_DATAFMT datafmt[],
+                                            CS_VOID *values[], CS_BIGINT *sent,
+                                            CS_BIGINT *received);
+CS_STATIC CS_RETCODE logtransfer_probe_clock(CS_CONNECTION *connection);
+CS_STATIC CS_RETCODE logtransfer_probe_backlog(CS_VOID *ctx, CS_UINT *endpage,
+                                               CS_INT *pagesize);
+CS_STATIC CS_RETCODE logtransfer_tune(CS_CONNECTION *connection);
+CS_STATIC CS_VOID logtransfer_report_lag(CS_VOID);
 
 /*
 ** main()
@@ -118,9 +457,122 @@ main(int argc, char *argv[])
 {
 	CS_CONNECTION	*connection;
 	CS_RETCODE	retcode;
+	CS_UBIGINT	unacked;
+
+	lt_out_puts("LOGTRANSFER Example\n");
+	lt_out_flush();
+
+	if (lt_log_start(Ex_log_level, Ex_log_interval, Ex_log_burst,
+			 Ex_log_window) != CS_SUCCEED)
+	{
+		ex_panic("starting the logger thread failed");
+	}
+	logtransfer_metrics_init();
+	lt_lag_init();
+	lt_trace_init();
+	if (lt_metrics_start(Ex_metrics_address, Ex_stats_interval) != CS_SUCCEED)
+	{
+		ex_panic("starting the metrics thread failed");
+	}
+	lt_xact_init(&Lt_open_xacts);
+	lt_compact_init(&Lt_compact, Ex_compact_keycols);
+	if (Ex_output_path != NULL)
+	{
+		if (Ex_fsync_interval > 0 &&
+		    lt_durable_start(Ex_fsync_interval, Ex_fsync_bytes) != CS_SUCCEED)
+		{
+			ex_panic("starting the output syncer failed");
+		}
+
+		/*
+		** The binary formats carry name ids, which their consumers
+		** look up in the dictionary side file; JSON and Arrow spell
+		** the names out, and the server streams the dictionary.
+		*/
+		if (strcmp(Ex_output_format, "arrow") != 0 &&
+		    strcmp(Ex_output_format, "json") != 0 &&
+		    strcmp(Ex_output_format, "server") != 0)
+		{
+			CS_CHAR	dictpath[EX_MAXSTRINGLEN];
+
+			snprintf(dictpath, sizeof (dictpath), "%s.dict",
+				 Ex_output_path);
+			if (lt_dict_open(dictpath) != CS_SUCCEED)
+			{
+				ex_panic("opening the name dictionary failed");
+			}
+		}
+		if (strcmp(Ex_output_format, "arrow") == 0)
+		{
+			retcode = lt_arrow_open(Ex_output_path, &Lt_sink);
+		}
+		else if (strcmp(Ex_output_format, "json") == 0)
+		{
+			retcode = lt_json_open(Ex_output_path, &Lt_sink);
+		}
+		else if (strcmp(Ex_output_format, "segment") == 0)
+		{
+			retcode = lt_segment_open(Ex_output_path, Ex_segment_bytes,
+						  Ex_segment_secs, &Lt_sink);
+		}
+		else if (strcmp(Ex_output_format, "ring") == 0)
+		{
+			retcode = lt_ring_open(Ex_output_path, Ex_ring_bytes, &Lt_sink);
+		}
+		else if (strcmp(Ex_output_format, "server") == 0)
+		{
+			retcode = lt_server_open(Ex_output_path, Ex_server_bytes,
+						 &Lt_sink);
+		}
+		else if (strcmp(Ex_output_format, "shard") == 0)
+		{
+			retcode = lt_shard_open(Ex_output_path, Ex_shard_count,
+						Ex_shard_queue, &Lt_sink);
+		}
+		else if (strcmp(Ex_output_format, "uring") == 0)
+		{
+			retcode = lt_uring_open(Ex_output_path, Ex_uring_bytes,
+						Ex_uring_sync_bytes, &Lt_sink);
+		}
+		else
+		{
+			retcode = lt_sink_file_open(Ex_output_path, &Lt_sink);
+		}
+		if (retcode != CS_SUCCEED)
+		{
+			ex_panic("opening the output sink failed");
+		}
+	}
+	lt_batch_init(&Lt_batcher, Lt_sink, Ex_batch_xacts, Ex_batch_bytes,
+		      Ex_batch_delay);
+	if (Ex_compact_batch)
+	{
+		Lt_batcher.compact = &Lt_compact;
+	}
+	if (Ex_ckpt_path != NULL)
+	{
+		CS_BOOL	loaded;
+
+		if (lt_ckpt_load(Ex_ckpt_path, &Lt_open_xacts, &Lt_scan_pos,
+				 &loaded) == CS_SUCCEED && loaded)
+		{
+			lt_out_printf("Restored %d open transactions, scan position page %u, record %u.\n",
+				Lt_open_xacts.count, Lt_scan_pos.page, Lt_scan_pos.row);
+			lt_out_flush();
+			Lt_resume_pos = Lt_scan_pos;
+			Lt_resuming = (LT_LOGPOS_KEY(Lt_scan_pos) != 0);
+		}
+		Lt_last_ckpt = time(NULL);
+	}
 
-	fprintf(stdout, "LOGTRANSFER Example\n");
-	fflush(stdout);
+	if (Ex_capture_path != NULL)
+	{
+		if (lt_capture_create(Ex_capture_path, &Lt_capture) != CS_SUCCEED)
+		{
+			ex_panic("creating the capture file failed");
+		}
+		Lt_capturing = CS_TRUE;
+	}
 
 	/* 
 	** Allocate a Cs_context structure and initialize Client-Library
@@ -219,7 +671,10 @@ main(int argc, char *argv[])
     */
     if (retcode == CS_SUCCEED)
     {
-        retcode = DoLogtransfer(connection, "setqual", "numrecs", "1000");
+        CS_CHAR numrecs[16];
+
+        sprintf(numrecs, "%d", Ex_scan_numrecs);
+        retcode = DoLogtransfer(connection, "setqual", "numrecs", numrecs);
     }
 
     /*
@@ -235,7 +690,21 @@ main(int argc, char *argv[])
     */
     if (retcode == CS_SUCCEED)
     {
-        retcode = DoLogtransfer(connection, "setqual", "timeout", "15");
+        CS_CHAR timeout[16];
+
+        sprintf(timeout, "%d", Ex_scan_timeout);
+        retcode = DoLogtransfer(connection, "setqual", "timeout", timeout);
+    }
+
+    /*
+    ** Estimate the backlog, probing between the scans on their own
+    ** connection.
+    */
+    if ((retcode == CS_SUCCEED) && (Ex_backlog_interval > 0))
+    {
+        (void)lt_backlog_start(logtransfer_probe_backlog, connection,
+                               Ex_backlog_interval, Ex_catchup_pages,
+                               Ex_latency_pages);
     }
 
     /*
@@ -620,29 +1089,50 @@ main(int argc, char *argv[])
     }
 
     /*
-    ** Advance truncation point.
+    ** Advance truncation point, once the output is on disk, and only
+    ** if its consumers have acknowledged all of it: the transactions
+    ** they have yet to acknowledge must stay in the log to be sent
+    ** again.
     */
     if (retcode == CS_SUCCEED)
     {
-        retcode = DoDML(connection, "dbcc gettrunc");
+        retcode = lt_batch_sync(&Lt_batcher);
     }
     if (retcode == CS_SUCCEED)
     {
-        retcode = DoDML(connection, "dbcc settrunc(ltm, ignore)");
+        retcode = lt_durable_wait(Lt_batcher.written);
     }
-    if (retcode == CS_SUCCEED)
+    if ((retcode == CS_SUCCEED) && logtransfer_unacked(&unacked))
     {
-        retcode = DoDML(connection, "dump tran lobs with no_log");
+        lt_out_printf("Not truncating the log: transaction page %u, record %u "
+                "is not acknowledged.\n",
+                LT_LOGPOS_PAGE(unacked), LT_LOGPOS_ROW(unacked));
     }
-    if (retcode == CS_SUCCEED)
+    else
     {
-        retcode = DoDML(connection, "dbcc settrunc(ltm, valid)");
+        if (retcode == CS_SUCCEED)
+        {
+            retcode = DoDML(connection, "dbcc gettrunc");
+        }
+        if (retcode == CS_SUCCEED)
+        {
+            retcode = DoDML(connection, "dbcc settrunc(ltm, ignore)");
+        }
+        if (retcode == CS_SUCCEED)
+        {
+            retcode = DoDML(connection, "dump tran lobs with no_log");
+        }
+        if (retcode == CS_SUCCEED)
+        {
+            retcode = DoDML(connection, "dbcc settrunc(ltm, valid)");
+        }
     }
 
 	/*
 	** Deallocate the allocated structures, close the connection,
 	** and exit Client-Library.
 	*/
+	lt_backlog_stop();
 	if (connection != NULL)
 	{
 		retcode = ex_con_cleanup(connection, retcode);
@@ -653,6 +1143,31 @@ main(int argc, char *argv[])
 		retcode = ex_ctx_cleanup(GET_CS_CONTEXT, retcode);
 	}
 
+	lt_batch_sync(&Lt_batcher);
+	logtransfer_checkpoint(CS_TRUE);
+	if (Lt_sink != NULL)
+	{
+		Lt_sink->close(Lt_sink);
+	}
+	lt_dict_close();
+	if (Lt_capturing)
+	{
+		lt_capture_close(&Lt_capture);
+	}
+	lt_durable_stop();
+	lt_log_flush();
+	logtransfer_report_fsync();
+	logtransfer_report_scans();
+	logtransfer_report_lag();
+	lt_metrics_stop();
+	lt_log_stop();
+	lt_batch_cleanup(&Lt_batcher);
+	lt_xact_cleanup(&Lt_open_xacts);
+	lt_compact_cleanup(&Lt_compact);
+	lt_dict_cleanup();
+	lt_out_flush();
+	lt_trace_report(lt_out_claimed() ? EX_ERROR_OUT : EX_STANDARD_OUT);
+
 	return (retcode == CS_SUCCEED) ? EX_EXIT_SUCCEED : EX_EXIT_FAIL;
 }
 
@@ -831,7 +1346,8 @@ InstallNulls(CS_CONTEXT *context)
 	datafmt.status = CS_FMT_UNUSED;
 	datafmt.locale = NULL;
 	
-	return cs_setnull(context, &datafmt, "NULL", strlen("NULL"));
+	return cs_setnull(context, &datafmt, LT_NULL_STRING,
+			  strlen(LT_NULL_STRING));
 }
 
 /*
@@ -882,8 +1398,7 @@ BuildLogTransferCommand(CS_COMMAND *cmd, CS_CHAR *operation, CS_CHAR *qualifier,
         return -1;
     }
 
-    ex_msg("Attempting command:");
-    ex_msg(tmpbuf);
+    lt_log(LT_LOG_DEBUG, "Attempting command: %s", tmpbuf);
 
     /*
     ** Build the command for our `dbcc logtransfer` execution.
@@ -921,36 +1436,88 @@ DoLogtransfer(CS_CONNECTION *connection, CS_CHAR *operation, CS_CHAR *qualifier,
 {
 	CS_RETCODE	retcode;
 	CS_COMMAND	*cmd;
+	CS_BIGINT	start;
+	CS_BIGINT	busy;
+
+	if (strcasecmp(operation, "scan") == 0)
+	{
+		logtransfer_probe_clock(connection);
+		lt_backlog_poll();
+		logtransfer_tune(connection);
+	}
 
 	if ((retcode = ct_cmd_alloc(connection, &cmd)) != CS_SUCCEED)
 	{
 		ex_error("DoLogtransfer: ct_cmd_alloc() failed");
+		LT_METRIC_ADD(&Lt_stats.command_errors, 1);
 		return retcode;
 	}
 
 	if ((retcode = BuildLogTransferCommand(cmd, operation, qualifier, parm)) != CS_SUCCEED)
 	{
 		ex_error("DoLogtransfer: BuildLogTransferCommand() failed");
+		LT_METRIC_ADD(&Lt_stats.command_errors, 1);
 		return retcode;
 	}
 
 	/*
 	** Send the command to the server 
 	*/
+	start = lt_clock_usec();
 	if (ct_send(cmd) != CS_SUCCEED)
 	{
 		ex_error("DoLogtransfer: ct_send() failed");
+		LT_METRIC_ADD(&Lt_stats.command_errors, 1);
 		return retcode;
 	}
 
     if(strcasecmp(operation, "scan") != 0) {
         retcode = ex_handle_results(cmd);
     } else {
+        if (Lt_capturing && (lt_capture_put_scan(&Lt_capture) != CS_SUCCEED)) {
+            logtransfer_capture_stop();
+        }
+        LT_METRIC_ADD(&Lt_stats.scans, 1);
+        LT_TRACE_BEGIN(scan, Lt_scan_pos.page);
+        Lt_scan_time.sent = start;
+        busy = Lt_batcher.busy;
         retcode = handle_logtransfer_scan_results(cmd);
+        LT_METRIC_OBSERVE(&Lt_stats.scan_time, lt_clock_usec() - start);
+        if (Lt_scan_time.first != 0) {
+            LT_METRIC_OBSERVE(&Lt_stats.first_time, Lt_scan_time.first - start);
+        }
+        if (Lt_capturing &&
+            (lt_capture_put_end(&Lt_capture, (retcode == CS_SUCCEED) ?
+                                CS_END_RESULTS : CS_FAIL) != CS_SUCCEED)) {
+            logtransfer_capture_stop();
+        }
+        if (retcode == CS_SUCCEED && Lt_scan_failed) {
+            retcode = CS_FAIL;
+        }
+        if (retcode == CS_SUCCEED) {
+            lt_backlog_scanned(Lt_scan_pos.page);
+            logtransfer_report_lowwater();
+            retcode = lt_batch_poll(&Lt_batcher);
+            LT_METRIC_OBSERVE(&Lt_stats.sink_time, Lt_batcher.busy - busy);
+        }
+
+        /*
+        ** The batch a sink failed to write is kept, and the scan stops
+        ** here rather than checkpoint past it.
+        */
+        if (retcode == CS_SUCCEED) {
+            retcode = logtransfer_checkpoint(CS_FALSE);
+        } else {
+            Lt_scan_failed = CS_TRUE;
+        }
+        LT_METRIC_SET(&Lt_stats.open, Lt_open_xacts.count);
+        LT_TRACE_END(scan, retcode);
     }
     if (retcode != CS_SUCCEED) {
         CS_CHAR     tmpbuf[EX_MAXSTRINGLEN];
 
+        LT_METRIC_ADD(&Lt_stats.command_errors, 1);
+
         sprintf(tmpbuf, "DoLogtransfer: handling results failed with operation=<%s>, qualifier=<%s>, parm=<%s>.",
                 operation, qualifier, parm);
         ex_error(tmpbuf);
@@ -963,15 +1530,31 @@ DoLogtransfer(CS_CONNECTION *connection, CS_CHAR *operation, CS_CHAR *qualifier,
 /*
 ** handle_logtransfer_scan_results
 **
-** logtransfer results processing.
+** logtransfer results processing, through the "results" tracepoint.
 */
 CS_RETCODE CS_PUBLIC
 handle_logtransfer_scan_results(CS_COMMAND *cmd)
+{
+    CS_RETCODE retcode;
+
+    LT_TRACE_BEGIN(results, Lt_scan_pos.page);
+    retcode = logtransfer_scan_results(cmd);
+    LT_TRACE_END(results, retcode);
+    return retcode;
+}
+
+/*
+** logtransfer_scan_results
+**
+** logtransfer results processing.
+*/
+CS_STATIC CS_RETCODE
+logtransfer_scan_results(CS_COMMAND *cmd)
 {
     CS_RETCODE retcode;
     CS_INT res_type;
     CS_SMALLINT msg_id;
-    CS_CHAR operation[20];
+    CS_CHAR operation[sizeof(OPERATION_BEFORE_AND_AFTER_IMAGE)];
     CS_CHAR status[20];
 
     /*
@@ -979,7 +1562,11 @@ handle_logtransfer_scan_results(CS_COMMAND *cmd)
     */
     strcpy(operation, OPERATION_NONE);
     strcpy(status, STATUS_NONE);
-    while ((retcode = ct_results(cmd, &res_type)) == CS_SUCCEED)
+    Lt_scan_time.first = 0;
+    Lt_scan_time.firstrow = 0;
+    Lt_scan_time.wait = 0;
+    Lt_scan_time.busy = Lt_batcher.busy;
+    while ((retcode = logtransfer_results(cmd, &res_type)) == CS_SUCCEED)
     {
         switch ((int)res_type)
         {
@@ -992,22 +1579,25 @@ handle_logtransfer_scan_results(CS_COMMAND *cmd)
                 switch ((int)res_type)
                 {
                     case  CS_ROW_RESULT:
-                        fprintf(stdout, "\nROW RESULTS\n");
+                        lt_out_puts("\nROW RESULTS\n");
                         break;
 
                     case  CS_PARAM_RESULT:
-                        fprintf(stdout, "\nPARAMETER RESULTS\n");
+                        lt_out_puts("\nPARAMETER RESULTS\n");
                         break;
 
                     case  CS_STATUS_RESULT:
-                        fprintf(stdout, "\nSTATUS RESULTS\n");
+                        lt_out_puts("\nSTATUS RESULTS\n");
                         break;
                 }
 
                 /*
                 ** All three of these result types are fetchable.
                 */
-                retcode = logtransfer_fetch_data(cmd, &operation[0], &status[0]);
+                LT_TRACE_BEGIN(fetch, res_type);
+                retcode = logtransfer_fetch_data(cmd, res_type, &operation[0],
+                                                 &status[0]);
+                LT_TRACE_END(fetch, retcode);
                 if (retcode != CS_SUCCEED)
                 {
                     ex_error("handle_logtransfer_scan_results: logtransfer_fetch_data() failed");
@@ -1026,20 +1616,23 @@ handle_logtransfer_scan_results(CS_COMMAND *cmd)
                     ex_error("handle_logtransfer_scan_results: ct_res_info(msgtype) failed");
                     return retcode;
                 }
-                fprintf(stdout, "ct_result returned CS_MSG_RESULT where msg id = %d.\n",
+                lt_out_printf("ct_result returned CS_MSG_RESULT where msg id = %d.\n",
                         msg_id);
+                logtransfer_capture_result(res_type, msg_id);
                 break;
 
             case CS_CMD_SUCCEED:
                 /*
                 ** This means no rows were returned.
                 */
+                logtransfer_capture_result(res_type, 0);
                 break;
 
             case CS_CMD_DONE:
                 /*
                 ** Done with result set.
                 */
+                logtransfer_capture_result(res_type, 0);
                 break;
 
             case CS_CMD_FAIL:
@@ -1047,6 +1640,7 @@ handle_logtransfer_scan_results(CS_COMMAND *cmd)
                 ** The server encountered an error while
                 ** processing our command.
                 */
+                logtransfer_capture_result(res_type, 0);
                 ex_error("handle_logtransfer_scan_results: ct_results returned CS_CMD_FAIL.");
                 return CS_FAIL;
                 break;
@@ -1071,6 +1665,7 @@ handle_logtransfer_scan_results(CS_COMMAND *cmd)
             /*
             ** Everything went fine.
             */
+            logtransfer_scan_timed();
             retcode = CS_SUCCEED;
             break;
 
@@ -1113,8 +1708,13 @@ handle_logtransfer_scan_results(CS_COMMAND *cmd)
 **	column, and that name used instead. The compute example program has
 **	code which demonstrates this.
 **
+**	While a capture is being recorded, the columns are bound in their
+**	native formats instead, so that their values can be recorded as
+**	the server sent them, and are converted by logtransfer_fetch_row().
+**
 ** Parameters:
 **	cmd - Pointer to command structure
+**	res_type - The result type returned by ct_results()
 **
 ** Return:
 **	CS_MEM_ERROR	If an memory allocation failed.
@@ -1125,7 +1725,8 @@ handle_logtransfer_scan_results(CS_COMMAND *cmd)
 **
 */
 CS_RETCODE CS_PUBLIC
-logtransfer_fetch_data(CS_COMMAND *cmd, CS_CHAR *operation, CS_CHAR *status)
+logtransfer_fetch_data(CS_COMMAND *cmd, CS_INT res_type, CS_CHAR *operation,
+                       CS_CHAR *status)
 {
     CS_RETCODE		retcode;
     CS_INT			num_cols;
@@ -1136,7 +1737,9 @@ logtransfer_fetch_data(CS_COMMAND *cmd, CS_CHAR *operation, CS_CHAR *status)
     CS_INT			disp_len;
     CS_DATAFMT		*datafmt;
     CS_DATAFMT		*orig_datafmt;
+    CS_DATAFMT		rawfmt;
     EX_COLUMN_DATA		*coldata;
+    EX_COLUMN_DATA		*rawdata = NULL;
 
     /*
     ** Find out how many columns there are in this result set.
@@ -1193,6 +1796,22 @@ logtransfer_fetch_data(CS_COMMAND *cmd, CS_CHAR *operation, CS_CHAR *status)
         return CS_MEM_ERROR;
     }
 
+    /*
+    ** While recording, 'rawdata' holds the native values of the columns.
+    */
+    if (Lt_capturing)
+    {
+        rawdata = (EX_COLUMN_DATA *)calloc(num_cols, sizeof (EX_COLUMN_DATA));
+        if (rawdata == NULL)
+        {
+            ex_error("logtransfer_fetch_data: 4 malloc() failed");
+            free(coldata);
+            free(datafmt);
+            free(orig_datafmt);
+            return CS_MEM_ERROR;
+        }
+    }
+
     /*
     ** Loop through the columns getting a description of each one
     ** and binding each one to a program variable.
@@ -1266,11 +1885,31 @@ logtransfer_fetch_data(CS_COMMAND *cmd, CS_CHAR *operation, CS_CHAR *status)
         }
 
         /*
-        ** Now bind.
+        ** Now bind. While recording, bind the native value, up to
+        ** LT_CAPTURE_MAXBIND bytes of it.
         */
-        retcode = ct_bind(cmd, (i + 1), &datafmt[i],
-                          coldata[i].value, &coldata[i].valuelen,
-                          (CS_SMALLINT *)&coldata[i].indicator);
+        if (rawdata != NULL)
+        {
+            STRUCTASSIGN(rawfmt, orig_datafmt[i]);
+            rawfmt.maxlength = MAX(MIN(rawfmt.maxlength, LT_CAPTURE_MAXBIND), 1);
+            rawfmt.format = CS_FMT_UNUSED;
+            rawdata[i].value = (CS_CHAR *)malloc(rawfmt.maxlength);
+            if (rawdata[i].value == NULL)
+            {
+                ex_error("logtransfer_fetch_data: malloc() failed");
+                retcode = CS_MEM_ERROR;
+                break;
+            }
+            retcode = ct_bind(cmd, (i + 1), &rawfmt,
+                              rawdata[i].value, &rawdata[i].valuelen,
+                              (CS_SMALLINT *)&rawdata[i].indicator);
+        }
+        else
+        {
+            retcode = ct_bind(cmd, (i + 1), &datafmt[i],
+                              coldata[i].value, &coldata[i].valuelen,
+                              (CS_SMALLINT *)&coldata[i].indicator);
+        }
         if (retcode != CS_SUCCEED)
         {
             ex_error("logtransfer_fetch_data: ct_bind() failed");
@@ -1278,12 +1917,27 @@ logtransfer_fetch_data(CS_COMMAND *cmd, CS_CHAR *operation, CS_CHAR *status)
         }
     }
 
+    if ((retcode == CS_SUCCEED) && Lt_capturing &&
+        (lt_capture_put_result(&Lt_capture, res_type, 0, num_cols,
+                               orig_datafmt) != CS_SUCCEED))
+    {
+        logtransfer_capture_stop();
+    }
+
     if (retcode != CS_SUCCEED)
     {
         for (j = 0; j < i; j++)
         {
             free(coldata[j].value);
         }
+        if (rawdata != NULL)
+        {
+            for (j = 0; j < num_cols; j++)
+            {
+                free(rawdata[j].value);
+            }
+            free(rawdata);
+        }
         free(coldata);
         free(datafmt);
         free(orig_datafmt);
@@ -1294,26 +1948,17 @@ logtransfer_fetch_data(CS_COMMAND *cmd, CS_CHAR *operation, CS_CHAR *status)
     ** Fetch the first row since the column headers will depend upon the
     ** operation type.
     */
-    retcode = ct_fetch(cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
-                       &rows_read);
-
-    if((strcmp(coldata[0].value, OPERATION_BT_INSERT) == 0) ||
-       (strcmp(coldata[0].value, OPERATION_BT_DELETE) == 0) ||
-       (strcmp(coldata[0].value, OPERATION_DEALLOC) == 0) ||
-       (strcmp(coldata[0].value, OPERATION_ALLOC) == 0) ||
-       (strcmp(coldata[0].value, OPERATION_CHECKPOINT) == 0) ||
-       (strcmp(coldata[0].value, OPERATION_50) == 0) ||
-       (strcmp(coldata[0].value, OPERATION_58) == 0) ||
-       (strcmp(coldata[0].value, OPERATION_59) == 0)) {
-        fprintf(stdout, "Ignoring results for <%s>.\n",
-                (strcmp(coldata[0].value, OPERATION_BT_INSERT) == 0) ? "BT_INSERT" :
-                (strcmp(coldata[0].value, OPERATION_BT_DELETE) == 0) ? "BT_DELETE" :
-                (strcmp(coldata[0].value, OPERATION_DEALLOC) == 0) ? "DEALLOC" :
-                (strcmp(coldata[0].value, OPERATION_ALLOC) == 0) ?  "ALLOC" :
-                (strcmp(coldata[0].value, OPERATION_CHECKPOINT) == 0) ?  "CHECKPOINT" :
-                (strcmp(coldata[0].value, OPERATION_50) == 0) ?  "operation 50" :
-                (strcmp(coldata[0].value, OPERATION_58) == 0) ?  "operation 58" : "operation 59");
-        fflush(stdout);
+    retcode = logtransfer_fetch_row(cmd, num_cols, orig_datafmt, datafmt,
+                                    coldata, rawdata, &rows_read);
+
+    for(i = 0; i < LT_NIGNORED; i++) {
+        if(strcmp(coldata[0].value, Lt_ignored[i].op) == 0) {
+            break;
+        }
+    }
+    if(i < LT_NIGNORED) {
+        lt_out_printf("Ignoring results for <%s>.\n", Lt_ignored[i].name);
+        LT_METRIC_ADD(&Lt_ignored[i].count, 1);
 
         /*
         ** Ignore some operations.
@@ -1334,6 +1979,7 @@ logtransfer_fetch_data(CS_COMMAND *cmd, CS_CHAR *operation, CS_CHAR *status)
            (strcmp(operation, OPERATION_ENDXACT) == 0) ||
            (strcmp(operation, OPERATION_BEFORE_AND_AFTER_IMAGE) == 0) ||
            (strcmp(operation, OPERATION_BEFORE_IMAGE) == 0) ||
+           (strcmp(operation, OPERATION_SAVEPT) == 0) ||
            (strcmp(operation, OPERATION_CLEAR) == 0)) {
             strcpy(operation, coldata[0].value);
         } else if(strcmp(operation, OPERATION_INSERT) == 0) {
@@ -1359,7 +2005,9 @@ logtransfer_fetch_data(CS_COMMAND *cmd, CS_CHAR *operation, CS_CHAR *status)
             /*
             ** Display column header
             */
-            logtransfer_display_header(num_cols, orig_datafmt, datafmt, operation, status);
+            if(Ex_display) {
+                logtransfer_display_header(num_cols, orig_datafmt, datafmt, operation, status);
+            }
 
             /*
             ** Fetch the rows.  Loop while ct_fetch() returns CS_SUCCEED or
@@ -1375,8 +2023,17 @@ logtransfer_fetch_data(CS_COMMAND *cmd, CS_CHAR *operation, CS_CHAR *status)
                 ** Check if we hit a recoverable error.
                 */
                 if(retcode == CS_ROW_FAIL) {
-                    fprintf(stdout, "Error on row %d.\n", row_count);
-                    fflush(stdout);
+                    lt_out_printf("Error on row %d.\n", row_count);
+                    LT_METRIC_ADD(&Lt_stats.row_errors, 1);
+                }
+                else if(logtransfer_assemble_row(operation, row_count, num_cols,
+                                                 orig_datafmt, coldata) != CS_SUCCEED) {
+                    ex_error("logtransfer_fetch_data: logtransfer_assemble_row() failed");
+                    LT_METRIC_ADD(&Lt_stats.assemble_errors, 1);
+                    Lt_scan_failed = CS_TRUE;
+                }
+                if(!Ex_display) {
+                    continue;
                 }
 
                 /*
@@ -1398,12 +2055,11 @@ logtransfer_fetch_data(CS_COMMAND *cmd, CS_CHAR *operation, CS_CHAR *status)
                                                      &out_buf[0], 22,
                                                      datafmt[i].datatype);
                         if(retcode == CS_SUCCEED) {
-                            fprintf(stdout, "%s", out_buf);
+                            lt_out_puts(out_buf);
                         }
                     } else {
-                        fprintf(stdout, "%s", coldata[i].value);
+                        lt_out_puts(coldata[i].value);
                     }
-                    fflush(stdout);
 
                     /*
                     ** If not last column, Print out spaces between this
@@ -1412,17 +2068,16 @@ logtransfer_fetch_data(CS_COMMAND *cmd, CS_CHAR *operation, CS_CHAR *status)
                     if(i != num_cols - 1) {
                         disp_len = ex_display_dlen(&datafmt[i]);
                         disp_len -= coldata[i].valuelen - 1;
-                        for(j = 0; j < disp_len; j++) {
-                            fputc(' ', stdout);
-                        }
+                        lt_out_pad(' ', disp_len);
                     }
                 }
-                fprintf(stdout, "\n");
-                fflush(stdout);
-            } while(((retcode = ct_fetch(cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
-                                         &rows_read)) == CS_SUCCEED) ||
+                lt_out_putc('\n');
+            } while(((retcode = logtransfer_fetch_row(cmd, num_cols,
+                                                      orig_datafmt, datafmt,
+                                                      coldata, rawdata,
+                                                      &rows_read)) == CS_SUCCEED) ||
                     (retcode == CS_ROW_FAIL));
-        } else {
+        } else if(Ex_display) {
             ex_display_header(num_cols, datafmt);
         }
     }
@@ -1434,6 +2089,14 @@ logtransfer_fetch_data(CS_COMMAND *cmd, CS_CHAR *operation, CS_CHAR *status)
     {
         free(coldata[i].value);
     }
+    if (rawdata != NULL)
+    {
+        for (i = 0; i < num_cols; i++)
+        {
+            free(rawdata[i].value);
+        }
+        free(rawdata);
+    }
     free(coldata);
     free(datafmt);
     free(orig_datafmt);
@@ -1448,8 +2111,10 @@ logtransfer_fetch_data(CS_COMMAND *cmd, CS_CHAR *operation, CS_CHAR *status)
             /*
             ** Everything went fine.
             */
-            fprintf(stdout, "All done processing rows.\n");
-            fflush(stdout);
+            if(Ex_display) {
+                lt_out_puts("All done processing rows.\n");
+            }
+            lt_out_flush();
             retcode = CS_SUCCEED;
             break;
 
@@ -1472,75 +2137,1389 @@ logtransfer_fetch_data(CS_COMMAND *cmd, CS_CHAR *operation, CS_CHAR *status)
 }
 
 /*
-** logtransfer_display_header()
+** logtransfer_logpos()
 **
 ** Type of function:
-** example program api
+** 	logtransfer program internal api
 **
 ** Purpose:
+** 	Read a log position from a pair of page and record columns.
 **
-** Returns:
-** Nothing.
+** Parameters:
+** 	coldata		- The bound column values of the row.
+** 	num_cols	- The number of columns in the row.
+** 	col		- Index of the page column; the record column follows.
+** 	pos		- Set to the position read.
 **
-** Side Effects:
-** None
+** Return:
+**	CS_TRUE if the row has the columns, CS_FALSE otherwise.
 */
-CS_RETCODE CS_PUBLIC
-logtransfer_display_header(CS_INT numcols, CS_DATAFMT orig_columns[],
-                           CS_DATAFMT columns[], CS_CHAR* operation, CS_CHAR *status)
+
+CS_STATIC CS_BOOL
+logtransfer_logpos(EX_COLUMN_DATA coldata[], CS_INT num_cols, CS_INT col,
+                   LT_LOGPOS *pos)
 {
-    CS_INT		i;
-    CS_INT		l;
-    CS_INT		j;
-    CS_INT		disp_len;
+    if(col + 1 >= num_cols) {
+        return CS_FALSE;
+    }
+    pos->page = (CS_UINT)strtoul(coldata[col].value, NULL, 10);
+    pos->row = (CS_UINT)strtoul(coldata[col + 1].value, NULL, 10);
+    return CS_TRUE;
+}
+
+/*
+** logtransfer_resumed()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Tell whether a record rescanned after a restart was processed before
+** 	the checkpoint and belongs to a transaction that has since ended, so
+** 	that it is to be dropped. The first record past the restored scan
+** 	position ends the rescan.
+**
+** Parameters:
+** 	xactid		- Position of the record's BEGINXACT.
+** 	pos		- Position of the record.
+**
+** Return:
+**	CS_TRUE to drop the record, CS_FALSE to process it.
+*/
+
+CS_STATIC CS_BOOL
+logtransfer_resumed(LT_LOGPOS *xactid, LT_LOGPOS *pos)
+{
+    CS_UBIGINT  key = LT_LOGPOS_KEY(*pos);
+
+    if(!Lt_resuming) {
+        return CS_FALSE;
+    }
+    if(!Lt_resume_based) {
+        Lt_resume_base = key;
+        Lt_resume_based = CS_TRUE;
+    }
+    if(LT_LOGPOS_SCAN(key, Lt_resume_base) >
+       LT_LOGPOS_SCAN(LT_LOGPOS_KEY(Lt_resume_pos), Lt_resume_base)) {
+        Lt_resuming = CS_FALSE;
+        Lt_resume_based = CS_FALSE;
+        return CS_FALSE;
+    }
+    return (lt_xact_find(&Lt_open_xacts, xactid) == NULL);
+}
+
+/*
+** logtransfer_advance()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Advance the scan position to a record processed, unless the rescan
+** 	after a restart has not yet reached the restored position.
+**
+** Parameters:
+** 	pos		- Position of the record.
+**
+** Return:
+**	Nothing.
+*/
+
+CS_STATIC CS_VOID
+logtransfer_advance(LT_LOGPOS *pos)
+{
+    if(!Lt_resuming) {
+        Lt_scan_pos = *pos;
+    }
+}
+
+/*
+** logtransfer_assemble_row()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Feed a fetched row to the transaction assembler.
+**
+** 	A BEGINXACT row opens a transaction and an ENDXACT row closes it;
+** 	both identify the transaction by their "sessionid page" and
+** 	"sessionid record" columns. An INSERT, DELETE or TEXTINSERT row is
+** 	held as pending until its image rows arrive in the following result
+** 	set, each of which is buffered as one row change of the pending
+** 	operation's transaction. A SAVEPOINT row marks the transaction's
+** 	change buffer, and a compensation (CLEAR) row rolls it back to the
+** 	mark preceding the undone record. Every record carrying a log
+** 	position advances the scan position. After a restart, the records
+** 	up to the restored scan position are dropped unless they belong to
+** 	a restored open transaction.
+**
+** Parameters:
+** 	operation	- The operation of the current result set.
+** 	row		- Number of the row within the result set, from 1.
+** 	num_cols	- The number of columns in the row.
+** 	orig_datafmt	- The column descriptions as returned by the server.
+** 	coldata		- The bound column values of the row.
+**
+** Return:
+**	CS_SUCCEED, or the failure code of the assembler.
+*/
+
+CS_STATIC CS_RETCODE
+logtransfer_assemble_row(CS_CHAR *operation, CS_INT row, CS_INT num_cols,
+                         CS_DATAFMT orig_datafmt[], EX_COLUMN_DATA coldata[])
+{
+    static LT_COLUMN    *columns = NULL;
+    static CS_CHAR      *dtbuf = NULL;
+    static CS_INT       maxcols = 0;
+    LT_XACT             *xact;
+    LT_LOGPOS           xactid;
+    LT_LOGPOS           pos;
+    LT_LOGPOS           undone;
+    LT_CHANGE           change;
+    CS_BIGINT           committime;
+    CS_INT              i;
 
     /*
-    ** Row preamble.
+    ** Operation records.
     */
-    fputc('\n', stdout);
     if(strcmp(operation, OPERATION_BEGINXACT) == 0) {
-        fprintf(stdout, "BEGIN XACT");
-    }
-    else if(strcmp(operation, OPERATION_INSERT) == 0) {
-        if(strcmp(status, STATUS_UPDATE) == 0) {
-            fprintf(stdout, "UPDATE");
+        if(!logtransfer_logpos(coldata, num_cols, 1, &xactid) ||
+           logtransfer_resumed(&xactid, &xactid)) {
+            return CS_SUCCEED;
         }
-        else {
-            fprintf(stdout, "INSERT");
+        logtransfer_advance(&xactid);
+        if(lt_xact_begin(&Lt_open_xacts, &xactid, &xact) != CS_SUCCEED) {
+            return CS_MEM_ERROR;
         }
+        if((num_cols > 7) &&
+           ((CS_SMALLINT)coldata[7].indicator != CS_NULLDATA)) {
+            return lt_dict_intern(coldata[7].value, strlen(coldata[7].value),
+                                  &xact->userid);
+        }
+        return CS_SUCCEED;
     }
-    else if(strcmp(operation, OPERATION_AFTER_IMAGE) == 0) {
-        fprintf(stdout, "AFTER IMAGE");
-    }
-    else if(strcmp(operation, OPERATION_TEXT) == 0) {
-        fprintf(stdout, "TEXTINSERT");
-    }
-    else if(strcmp(operation, OPERATION_TEXT_AFTER) == 0) {
-        fprintf(stdout, "Text column AFTER image");
-    }
-    else if(strcmp(operation, OPERATION_ENDXACT) == 0) {
-        fprintf(stdout, "COMMIT XACT");
-    }
-    else if(strcmp(operation, OPERATION_DELETE) == 0) {
-        if(strcmp(status, STATUS_UPDATE) == 0) {
-            fprintf(stdout, "UPDATE");
+    if(strcmp(operation, OPERATION_ENDXACT) == 0) {
+        if(!logtransfer_logpos(coldata, num_cols, 1, &xactid)) {
+            return CS_SUCCEED;
         }
-        else {
-            fprintf(stdout, "DELETE");
+        if(!logtransfer_logpos(coldata, num_cols, 4, &pos)) {
+            pos = Lt_scan_pos;
         }
+        if(logtransfer_resumed(&xactid, &pos)) {
+            return CS_SUCCEED;
+        }
+        logtransfer_advance(&pos);
+        committime = 0;
+        if((num_cols > 8) &&
+           ((CS_SMALLINT)coldata[8].indicator != CS_NULLDATA)) {
+            logtransfer_dt_epoch(coldata[8].value, orig_datafmt[8].datatype,
+                                 &committime);
+        }
+        if((lt_xact_end(&Lt_open_xacts, &xactid, &xact) != CS_SUCCEED) ||
+           (xact == NULL)) {
+            return CS_SUCCEED;
+        }
+        return logtransfer_commit_xact(xact, &pos, committime);
+    }
+    if((strcmp(operation, OPERATION_INSERT) == 0) ||
+       (strcmp(operation, OPERATION_DELETE) == 0) ||
+       (strcmp(operation, OPERATION_TEXT) == 0)) {
+        Lt_pending.op = LT_OP_NONE;
+        if(!logtransfer_logpos(coldata, num_cols, 1, &Lt_pending.xactid)) {
+            return CS_SUCCEED;
+        }
+        if(strcmp(operation, OPERATION_TEXT) == 0) {
+            if(!logtransfer_logpos(coldata, num_cols, 3, &Lt_pending.pos)) {
+                return CS_SUCCEED;
+            }
+            Lt_pending.op = LT_OP_TEXT;
+            Lt_pending.tableid = 0;
+            Lt_pending.ownerid = 0;
+        } else {
+            if((num_cols < 10) ||
+               !logtransfer_logpos(coldata, num_cols, 4, &Lt_pending.pos)) {
+                return CS_SUCCEED;
+            }
+            if(strcmp(coldata[3].value, STATUS_UPDATE) == 0) {
+                Lt_pending.op = (strcmp(operation, OPERATION_INSERT) == 0) ?
+                                LT_OP_UPDATE_AFTER : LT_OP_UPDATE_BEFORE;
+            } else {
+                Lt_pending.op = (strcmp(operation, OPERATION_INSERT) == 0) ?
+                                LT_OP_INSERT : LT_OP_DELETE;
+            }
+            if((lt_dict_intern(coldata[8].value, strlen(coldata[8].value),
+                               &Lt_pending.tableid) != CS_SUCCEED) ||
+               (lt_dict_intern(coldata[9].value, strlen(coldata[9].value),
+                               &Lt_pending.ownerid) != CS_SUCCEED)) {
+                Lt_pending.op = LT_OP_NONE;
+                return CS_MEM_ERROR;
+            }
+        }
+        if(logtransfer_resumed(&Lt_pending.xactid, &Lt_pending.pos)) {
+            Lt_pending.op = LT_OP_NONE;
+            return CS_SUCCEED;
+        }
+        logtransfer_advance(&Lt_pending.pos);
+        return CS_SUCCEED;
+    }
+    if(strcmp(operation, OPERATION_SAVEPT) == 0) {
+        /*
+        ** The mark is placed at the savepoint record's own position,
+        ** which precedes every change made after the savepoint. Like
+        ** ENDXACT, it carries its position at "log page" and "log
+        ** record"; a row without them is placed after the last record
+        ** processed.
+        */
+        if(!logtransfer_logpos(coldata, num_cols, 1, &xactid)) {
+            return CS_SUCCEED;
+        }
+        if(!logtransfer_logpos(coldata, num_cols, 4, &pos)) {
+            pos = Lt_scan_pos;
+        }
+        if(logtransfer_resumed(&xactid, &pos) ||
+           (lt_xact_adopt(&Lt_open_xacts, &xactid, &xact) != CS_SUCCEED)) {
+            return CS_SUCCEED;
+        }
+        logtransfer_advance(&pos);
+        return lt_xact_savepoint(xact, &pos);
+    }
+    if(strcmp(operation, OPERATION_CLEAR) == 0) {
+        /*
+        ** A compensation record, undoing the record at "clear page" and
+        ** "clear record" as part of a rollback.
+        */
+        if(!logtransfer_logpos(coldata, num_cols, 1, &xactid) ||
+           !logtransfer_logpos(coldata, num_cols, 3, &undone) ||
+           !logtransfer_logpos(coldata, num_cols, 7, &pos)) {
+            return CS_SUCCEED;
+        }
+        if(logtransfer_resumed(&xactid, &pos)) {
+            return CS_SUCCEED;
+        }
+        logtransfer_advance(&pos);
+        if((xact = lt_xact_find(&Lt_open_xacts, &xactid)) != NULL) {
+            lt_xact_rollback(xact, &pos, &undone);
+        }
+        return CS_SUCCEED;
+    }
+
+    /*
+    ** Image records of the pending operation.
+    */
+    if(((strcmp(operation, OPERATION_AFTER_IMAGE) != 0) &&
+        (strcmp(operation, OPERATION_BEFORE_IMAGE) != 0) &&
+        (strcmp(operation, OPERATION_BEFORE_AND_AFTER_IMAGE) != 0) &&
+        (strcmp(operation, OPERATION_TEXT_AFTER) != 0)) ||
+       (Lt_pending.op == LT_OP_NONE)) {
+        return CS_SUCCEED;
+    }
+
+    if(num_cols > maxcols) {
+        free(columns);
+        free(dtbuf);
+        columns = (LT_COLUMN *)malloc(num_cols * sizeof (LT_COLUMN));
+        dtbuf = (CS_CHAR *)malloc(num_cols * LT_DTBUF_LEN);
+        if((columns == NULL) || (dtbuf == NULL)) {
+            ex_error("logtransfer_assemble_row: malloc() failed");
+            free(columns);
+            free(dtbuf);
+            columns = NULL;
+            dtbuf = NULL;
+            maxcols = 0;
+            return CS_MEM_ERROR;
+        }
+        maxcols = num_cols;
+    }
+
+    for(i = 0; i < num_cols; i++) {
+        columns[i].name = orig_datafmt[i].name;
+        columns[i].namelen = strlen(orig_datafmt[i].name);
+        columns[i].datatype = orig_datafmt[i].datatype;
+        columns[i].indicator = ((CS_SMALLINT)coldata[i].indicator == CS_NULLDATA) ?
+                               CS_NULLDATA : 0;
+        if((orig_datafmt[i].datatype == CS_DATETIME_TYPE) ||
+           (orig_datafmt[i].datatype == CS_DATETIME4_TYPE) ||
+           (orig_datafmt[i].datatype == CS_TIME_TYPE) ||
+           (orig_datafmt[i].datatype == CS_BIGDATETIME_TYPE) ||
+           (orig_datafmt[i].datatype == CS_BIGTIME_TYPE)) {
+            columns[i].value = &dtbuf[i * LT_DTBUF_LEN];
+            columns[i].value[0] = '\0';
+            if(columns[i].indicator != CS_NULLDATA) {
+                logtransfer_dt_fmt(coldata[i].value, columns[i].value,
+                                   LT_DTBUF_LEN, orig_datafmt[i].datatype);
+            }
+        } else {
+            columns[i].value = coldata[i].value;
+        }
+        columns[i].valuelen = strlen(columns[i].value);
+    }
+
+    /*
+    ** The second image of an update's BEFORE & AFTER result set is the
+    ** after image.
+    */
+    change.op = Lt_pending.op;
+    if((change.op == LT_OP_UPDATE_BEFORE) && (row > 1)) {
+        change.op = LT_OP_UPDATE_AFTER;
+    }
+    change.xactid = LT_LOGPOS_KEY(Lt_pending.xactid);
+    change.pos = LT_LOGPOS_KEY(Lt_pending.pos);
+    change.tableid = Lt_pending.tableid;
+    change.ownerid = Lt_pending.ownerid;
+    change.numcols = num_cols;
+    change.columns = columns;
+
+    /*
+    ** A transaction that began before the scan did is opened on its
+    ** first change, as older than those the scan saw begin; its earlier
+    ** changes are not available.
+    */
+    if(lt_xact_adopt(&Lt_open_xacts, &Lt_pending.xactid, &xact) != CS_SUCCEED) {
+        return CS_MEM_ERROR;
+    }
+    return lt_xact_append(xact, &change);
+}
+
+/*
+** logtransfer_commit_xact()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Hand off a committed transaction to the output batch, compacting
+** 	its changes first if Ex_compact is set, and free it. Transactions
+** 	left without changes, such as rolled back ones, are not output.
+**
+** Parameters:
+** 	xact		- The transaction, removed from the open index.
+** 	commitpos	- Position of the ENDXACT record.
+** 	committime	- Commit time, in microseconds since the epoch.
+**
+** Return:
+**	CS_SUCCEED, or the failure code of the compaction or the output.
+*/
+
+CS_STATIC CS_RETCODE
+logtransfer_commit_xact(LT_XACT *xact, LT_LOGPOS *commitpos,
+                        CS_BIGINT committime)
+{
+    static LT_BUF   net = { NULL, 0, 0 };
+    LT_BUF          tmp;
+    CS_RETCODE      retcode = CS_SUCCEED;
+    CS_INT          nchanges;
+
+    if(Ex_compact && (xact->nchanges > 1)) {
+        net.len = 0;
+        retcode = lt_compact_run(&Lt_compact, &xact->changes, &net, &nchanges);
+        if(retcode == CS_SUCCEED) {
+            lt_log(LT_LOG_DEBUG,
+                   "Transaction page %u, record %u: %d changes compacted to %d.",
+                   xact->begin.page, xact->begin.row, xact->nchanges, nchanges);
+            tmp = xact->changes;
+            xact->changes = net;
+            xact->nchanges = nchanges;
+            net = tmp;
+        }
+    }
+
+    if((retcode == CS_SUCCEED) && (xact->nchanges > 0)) {
+        LT_METRIC_ADD(&Lt_stats.xacts, 1);
+        LT_METRIC_ADD(&Lt_stats.changes, xact->nchanges);
+        LT_METRIC_OBSERVE(&Lt_stats.xact_size, xact->nchanges);
+        retcode = lt_batch_add(&Lt_batcher, LT_LOGPOS_KEY(xact->begin),
+                               LT_LOGPOS_KEY(*commitpos), committime,
+                               xact->userid, &xact->changes, xact->nchanges);
+    } else if(retcode == CS_SUCCEED) {
+        LT_METRIC_ADD(&Lt_stats.empty, 1);
+    }
+
+    lt_xact_free(xact);
+    return retcode;
+}
+
+/*
+** logtransfer_checkpoint()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Checkpoint the in-flight transactions and the scan position, if a
+** 	checkpoint file is configured and Ex_ckpt_interval seconds have
+** 	passed since the last checkpoint. Called between scans, when no
+** 	operation is pending its images. Every transaction committed up to
+** 	the scan position must be on disk first, so there is none after a
+** 	failed scan or while the output batch cannot be written.
+**
+** Parameters:
+** 	force		- CS_TRUE to checkpoint regardless of the interval.
+**
+** Return:
+**	CS_SUCCEED, or CS_FAIL if the checkpoint could not be written.
+*/
+
+CS_STATIC CS_RETCODE
+logtransfer_checkpoint(CS_BOOL force)
+{
+    CS_RETCODE  retcode;
+    time_t      now;
+
+    if(Ex_ckpt_path == NULL) {
+        return CS_SUCCEED;
+    }
+    if(Lt_scan_failed) {
+        ex_error("logtransfer_checkpoint: not checkpointing past a failed scan");
+        return CS_FAIL;
+    }
+
+    now = time(NULL);
+    if(!force && (now - Lt_last_ckpt < Ex_ckpt_interval)) {
+        return CS_SUCCEED;
+    }
+
+    /*
+    ** Transactions committed past the checkpointed scan position must
+    ** be written out, and on disk, first, as they are no longer open.
+    */
+    if((retcode = lt_batch_sync(&Lt_batcher)) != CS_SUCCEED) {
+        return retcode;
+    }
+    if(Lt_batcher.batch.nxacts > 0) {
+        return CS_FAIL;
+    }
+    if((retcode = lt_durable_wait(Lt_batcher.written)) != CS_SUCCEED) {
+        return retcode;
+    }
+
+    retcode = lt_ckpt_write(Ex_ckpt_path, &Lt_open_xacts, &Lt_scan_pos);
+    if(retcode == CS_SUCCEED) {
+        Lt_last_ckpt = now;
+    }
+    return retcode;
+}
+
+/*
+** logtransfer_unacked()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Find the oldest committed transaction the output sink holds that
+** 	its consumers have not acknowledged, counting the ones not yet
+** 	written out. Only sinks that take acknowledgements hold any. They
+** 	all began before the scan position, so they are compared in scan
+** 	order back from it.
+**
+** Parameters:
+** 	unacked		- Set to the BEGINXACT position of the transaction.
+**
+** Return:
+**	CS_TRUE if there is one, CS_FALSE otherwise.
+*/
+
+CS_STATIC CS_BOOL
+logtransfer_unacked(CS_UBIGINT *unacked)
+{
+    CS_UBIGINT  base = LT_LOGPOS_KEY(Lt_scan_pos) + 1;
+    CS_UBIGINT  key;
+    CS_BOOL     found;
+    CS_INT      i;
+
+    if(Lt_sink == NULL || Lt_sink->lowwater == NULL) {
+        return CS_FALSE;
+    }
+    found = Lt_sink->lowwater(Lt_sink, base, unacked);
+    for(i = 0; i < Lt_batcher.batch.nxacts; i++) {
+        key = Lt_batcher.batch.xacts[i].xactid;
+        if(!found ||
+           LT_LOGPOS_SCAN(key, base) < LT_LOGPOS_SCAN(*unacked, base)) {
+            *unacked = key;
+            found = CS_TRUE;
+        }
+    }
+    return found;
+}
+
+/*
+** logtransfer_report_lowwater()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Report the oldest open transaction, the safe truncation and restart
+** 	point for the log scanned so far. If the output sink holds committed
+** 	transactions its consumers have not acknowledged, also report the
+** 	oldest of those and the ones not yet written out, which hold the
+** 	truncation point back as well, and how far the output is on disk.
+**
+** Return:
+**	Nothing.
+*/
+
+CS_STATIC CS_VOID
+logtransfer_report_lowwater(CS_VOID)
+{
+    LT_LOGPOS   oldest;
+    CS_UBIGINT  key;
+    CS_UBIGINT  unacked;
+
+    if(lt_xact_lowwater(&Lt_open_xacts, &oldest)) {
+        lt_out_printf("Oldest open transaction: page %u, record %u (%d open).\n",
+                oldest.page, oldest.row, Lt_open_xacts.count);
+    } else {
+        lt_out_puts("No open transactions.\n");
+    }
+
+    if(logtransfer_unacked(&unacked)) {
+        lt_out_printf("Oldest unacknowledged transaction: page %u, record %u.\n",
+                LT_LOGPOS_PAGE(unacked), LT_LOGPOS_ROW(unacked));
+    }
+
+    if(Lt_sink != NULL && Ex_fsync_interval > 0) {
+        key = lt_durable_position();
+        if(key != 0) {
+            lt_out_printf("Output on disk through commit: page %u, record %u.\n",
+                    LT_LOGPOS_PAGE(key), LT_LOGPOS_ROW(key));
+        }
+    }
+    lt_out_flush();
+}
+
+/*
+** logtransfer_report_fsync()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Report the number and latency of the group fsyncs of the output.
+**
+** Return:
+**	Nothing.
+*/
+
+CS_STATIC CS_VOID
+logtransfer_report_fsync(CS_VOID)
+{
+    LT_HIST     hist;
+
+    lt_durable_hist(&hist);
+    if(hist.count == 0) {
+        return;
+    }
+    lt_out_printf("Output fsyncs: %llu, latency p50 %llu us, p99 %llu us, max %llu us.\n",
+            (unsigned long long)hist.count,
+            (unsigned long long)lt_hist_quantile(&hist, 0.5),
+            (unsigned long long)lt_hist_quantile(&hist, 0.99),
+            (unsigned long long)hist.max);
+    lt_out_flush();
+}
+
+/*
+** logtransfer_metrics_init()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Register the metrics of the scan: the scans issued and how long
+** 	they took, the rows and bytes fetched, the results ignored per
+** 	operation, the transactions assembled and their sizes, the open
+** 	transactions, and the errors per stage.
+**
+** Return:
+**	Nothing.
+*/
+
+CS_STATIC CS_VOID
+logtransfer_metrics_init(CS_VOID)
+{
+    CS_INT      i;
+
+    lt_metrics_counter(&Lt_stats.scans, "lt_scans_total",
+                       "Log transfer scans issued.", NULL, "scans");
+    lt_metrics_histogram(&Lt_stats.scan_time, "lt_scan_duration_seconds",
+                         "Time from sending a scan to the end of its results.",
+                         NULL, "scan_us", 1000000);
+    lt_metrics_histogram(&Lt_stats.first_time, "lt_scan_first_result_seconds",
+                         "Time from sending a scan to its first result.",
+                         NULL, "first_us", 1000000);
+    lt_metrics_histogram(&Lt_stats.stream_time, "lt_scan_rows_seconds",
+                         "Time from the first row of a scan to the end of its results.",
+                         NULL, "rows_us", 1000000);
+    lt_metrics_histogram(&Lt_stats.wait_time, "lt_scan_wait_seconds",
+                         "Time a scan spent in ct_results() and ct_fetch() after its first result.",
+                         NULL, "wait_us", 1000000);
+    lt_metrics_histogram(&Lt_stats.decode_time, "lt_scan_decode_seconds",
+                         "Time a scan spent decoding, displaying and assembling its results.",
+                         NULL, "decode_us", 1000000);
+    lt_metrics_histogram(&Lt_stats.sink_time, "lt_scan_sink_seconds",
+                         "Time a scan spent writing batches to the output sink.",
+                         NULL, "sink_us", 1000000);
+    lt_metrics_counter(&Lt_stats.rows, "lt_rows_fetched_total",
+                       "Rows fetched from the scan results.", NULL, "rows");
+    lt_metrics_counter(&Lt_stats.bytes, "lt_fetched_bytes_total",
+                       "Bytes of the column values fetched, as bound.",
+                       NULL, "bytes");
+    for(i = 0; i < LT_NIGNORED; i++) {
+        lt_metrics_counter(&Lt_ignored[i].count, "lt_results_ignored_total",
+                           "Results ignored, by the operation of their log record.",
+                           Lt_ignored[i].labels, NULL);
+    }
+    lt_metrics_counter(&Lt_stats.xacts, "lt_transactions_total",
+                       "Committed transactions assembled with changes.",
+                       NULL, "xacts");
+    lt_metrics_counter(&Lt_stats.empty, "lt_transactions_empty_total",
+                       "Committed transactions assembled without changes.",
+                       NULL, NULL);
+    lt_metrics_counter(&Lt_stats.changes, "lt_changes_total",
+                       "Row changes of the committed transactions assembled.",
+                       NULL, "changes");
+    lt_metrics_histogram(&Lt_stats.xact_size, "lt_transaction_changes",
+                         "Row changes per committed transaction.",
+                         NULL, NULL, 1);
+    lt_metrics_gauge(&Lt_stats.open, "lt_open_transactions",
+                     "Transactions open at the end of the last scan.",
+                     NULL, "open", 1);
+    lt_metrics_counter(&Lt_stats.command_errors, "lt_errors_total",
+                       "Errors, by the stage they stopped.",
+                       "stage=\"command\"", "errors");
+    lt_metrics_counter(&Lt_stats.row_errors, "lt_errors_total",
+                       "Errors, by the stage they stopped.",
+                       "stage=\"row\"", "errors");
+    lt_metrics_counter(&Lt_stats.assemble_errors, "lt_errors_total",
+                       "Errors, by the stage they stopped.",
+                       "stage=\"assemble\"", "errors");
+    lt_metrics_counter(&Lt_stats.capture_errors, "lt_errors_total",
+                       "Errors, by the stage they stopped.",
+                       "stage=\"capture\"", "errors");
+    for(i = 0; i < LT_LOG_NLEVELS; i++) {
+        lt_metrics_counter(&Lt_log_messages[i], "lt_log_messages_total",
+                           "Messages logged, by level.",
+                           Lt_log_labels[i], NULL);
+    }
+    lt_metrics_counter(&Lt_log_suppressed, "lt_log_suppressed_total",
+                       "Repeated messages suppressed by the rate limit.",
+                       NULL, NULL);
+    lt_metrics_counter(&Lt_log_dropped, "lt_log_dropped_total",
+                       "Messages dropped because the log queue was full.",
+                       NULL, NULL);
+}
+
+/*
+** logtransfer_results()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Call ct_results() for the scan, timing it.
+**
+** Parameters:
+**	cmd		- The command.
+**	res_type	- Set to the result type.
+**
+** Return:
+**	The result of ct_results().
+*/
+
+CS_STATIC CS_RETCODE
+logtransfer_results(CS_COMMAND *cmd, CS_INT *res_type)
+{
+    CS_BIGINT   start;
+    CS_RETCODE  retcode;
+
+    start = lt_clock_usec();
+    retcode = ct_results(cmd, res_type);
+    logtransfer_scan_waited(start);
+    return retcode;
+}
+
+/*
+** logtransfer_scan_waited()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Account for a call to ct_results() or ct_fetch() that has returned:
+** 	the first one ends the wait for the server, and the time in the
+** 	ones after it is added to the scan's wait.
+**
+** Parameters:
+**	start		- When the call was made.
+**
+** Return:
+**	The time it returned.
+*/
+
+CS_STATIC CS_BIGINT
+logtransfer_scan_waited(CS_BIGINT start)
+{
+    CS_BIGINT   now;
+
+    now = lt_clock_usec();
+    if(Lt_scan_time.first == 0) {
+        Lt_scan_time.first = now;
+    } else {
+        Lt_scan_time.wait += now - start;
+    }
+    return now;
+}
+
+/*
+** logtransfer_scan_timed()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Record the stages of a scan whose results have ended: from its
+** 	first row to the end, the time waited on Client-Library, and the
+** 	time left to decoding, the batches written meanwhile set apart.
+**
+** Return:
+**	Nothing.
+*/
+
+CS_STATIC CS_VOID
+logtransfer_scan_timed(CS_VOID)
+{
+    CS_BIGINT   now;
+    CS_BIGINT   decode;
+
+    if(Lt_scan_time.first == 0) {
+        return;
+    }
+    now = lt_clock_usec();
+    if(Lt_scan_time.firstrow != 0) {
+        LT_METRIC_OBSERVE(&Lt_stats.stream_time, now - Lt_scan_time.firstrow);
+    }
+    decode = now - Lt_scan_time.first - Lt_scan_time.wait -
+             (Lt_batcher.busy - Lt_scan_time.busy);
+    LT_METRIC_OBSERVE(&Lt_stats.wait_time, Lt_scan_time.wait);
+    LT_METRIC_OBSERVE(&Lt_stats.decode_time, MAX(decode, 0));
+}
+
+/*
+** logtransfer_report_scans()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Report the latency of each stage of the scans: the wait for the
+** 	first result, which holds the server's scan and its poll timeout,
+** 	the rows through to the end of the results, the time in
+** 	Client-Library after the first result, our decoding, and the
+** 	writing of the output. Point out scans that mostly waited out the
+** 	timeout.
+**
+** Return:
+**	Nothing.
+*/
+
+CS_STATIC CS_VOID
+logtransfer_report_scans(CS_VOID)
+{
+    LT_METRIC_HIST  *stages[5];
+    CS_CHAR         *names[5];
+    LT_HIST         *hist;
+    CS_UBIGINT      first;
+    CS_INT          i;
+
+    if(Lt_stats.scan_time.hist.count == 0) {
+        return;
+    }
+    hist = (LT_HIST *)malloc(sizeof (LT_HIST));
+    if(hist == NULL) {
+        ex_error("logtransfer_report_scans: malloc() failed");
+        return;
+    }
+
+    stages[0] = &Lt_stats.first_time;
+    names[0] = "first result";
+    stages[1] = &Lt_stats.stream_time;
+    names[1] = "rows";
+    stages[2] = &Lt_stats.wait_time;
+    names[2] = "Client-Library";
+    stages[3] = &Lt_stats.decode_time;
+    names[3] = "decode";
+    stages[4] = &Lt_stats.sink_time;
+    names[4] = "sink";
+
+    lt_out_printf("Scans: %llu, latency p50/p99/max in us:",
+            (unsigned long long)Lt_stats.scan_time.hist.count);
+    for(i = 0; i < 5; i++) {
+        lt_hist_snapshot(hist, &stages[i]->hist);
+        lt_out_printf("%s %s %llu/%llu/%llu", (i == 0) ? "" : ",", names[i],
+                (unsigned long long)lt_hist_quantile(hist, 0.5),
+                (unsigned long long)lt_hist_quantile(hist, 0.99),
+                (unsigned long long)hist->max);
+    }
+    lt_out_puts(".\n");
+
+    lt_hist_snapshot(hist, &Lt_stats.first_time.hist);
+    first = lt_hist_quantile(hist, 0.5);
+    if((Ex_scan_timeout > 0) && (first >= (CS_UBIGINT)Ex_scan_timeout * 900000)) {
+        lt_out_printf("Most scans waited out the %d s timeout for their first result; "
+                "a lower Ex_scan_timeout returns the changes of a quiet log sooner.\n",
+                Ex_scan_timeout);
+    }
+    lt_out_flush();
+    free(hist);
+}
+
+/*
+** logtransfer_select_row()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Run a query that returns a single row, and fetch its first columns
+** 	into the values given, converted to the datatypes of 'datafmt'.
+**
+** Parameters:
+** 	connection	- Pointer to CS_CONNECTION structure.
+** 	sql		- The query.
+** 	numcols		- The number of columns fetched, up to
+** 			  LT_SELECT_MAXCOLS.
+** 	datafmt		- The formats the columns are fetched as.
+** 	values		- The buffers they are fetched into.
+** 	sent		- Set to when the query was sent, by
+** 			  lt_lag_wallclock().
+** 	received	- Set to when the row came back, or 0 if no row
+** 			  came back without a null value.
+**
+** Return:
+**	CS_SUCCEED, or CS_FAIL if the query failed.
+*/
+
+CS_STATIC CS_RETCODE
+logtransfer_select_row(CS_CONNECTION *connection, CS_CHAR *sql, CS_INT numcols,
+                       CS_DATAFMT datafmt[], CS_VOID *values[],
+                       CS_BIGINT *sent, CS_BIGINT *received)
+{
+    CS_COMMAND  *cmd;
+    CS_SMALLINT indicator[LT_SELECT_MAXCOLS];
+    CS_INT      res_type;
+    CS_INT      count;
+    CS_INT      i;
+    CS_BOOL     nulls;
+    CS_RETCODE  retcode;
+    CS_RETCODE  query_code = CS_SUCCEED;
+
+    *received = 0;
+    if((retcode = ct_cmd_alloc(connection, &cmd)) != CS_SUCCEED) {
+        ex_error("logtransfer_select_row: ct_cmd_alloc() failed");
+        return CS_FAIL;
+    }
+    if((retcode = ct_command(cmd, CS_LANG_CMD, sql, CS_NULLTERM,
+                             CS_UNUSED)) != CS_SUCCEED) {
+        ex_error("logtransfer_select_row: ct_command() failed");
+        (void)ct_cmd_drop(cmd);
+        return CS_FAIL;
+    }
+    *sent = lt_lag_wallclock();
+    if((retcode = ct_send(cmd)) != CS_SUCCEED) {
+        ex_error("logtransfer_select_row: ct_send() failed");
+        (void)ct_cmd_drop(cmd);
+        return CS_FAIL;
+    }
+
+    while((retcode = ct_results(cmd, &res_type)) == CS_SUCCEED) {
+        switch((int)res_type) {
+            case CS_ROW_RESULT:
+                for(i = 0; (i < numcols) && (query_code == CS_SUCCEED); i++) {
+                    if(ct_bind(cmd, i + 1, &datafmt[i], values[i], NULL,
+                               &indicator[i]) != CS_SUCCEED) {
+                        query_code = CS_FAIL;
+                    }
+                }
+                if(query_code != CS_SUCCEED) {
+                    break;
+                }
+                while(ct_fetch(cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+                               &count) == CS_SUCCEED) {
+                    for(i = 0, nulls = CS_FALSE; i < numcols; i++) {
+                        nulls |= ((CS_SMALLINT)indicator[i] == CS_NULLDATA);
+                    }
+                    if((*received == 0) && !nulls) {
+                        *received = lt_lag_wallclock();
+                    }
+                }
+                break;
+
+            case CS_CMD_FAIL:
+                query_code = CS_FAIL;
+                break;
+
+            default:
+                break;
+        }
+        if(query_code == CS_FAIL) {
+            if(ct_cancel(NULL, cmd, CS_CANCEL_ALL) != CS_SUCCEED) {
+                ex_error("logtransfer_select_row: ct_cancel() failed");
+            }
+            break;
+        }
+    }
+    (void)ct_cmd_drop(cmd);
+
+    if((query_code != CS_SUCCEED) ||
+       ((retcode != CS_END_RESULTS) && (retcode != CS_SUCCEED))) {
+        ex_error("logtransfer_select_row: The following command caused an error:");
+        ex_error(sql);
+        return CS_FAIL;
+    }
+    return CS_SUCCEED;
+}
+
+/*
+** logtransfer_probe_clock()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Read the server's clock with getdate(), for the lag measurement to
+** 	correct ours to it, if Ex_clock_probe_interval seconds have passed
+** 	since the last probe. A probe that fails leaves the correction as
+** 	it was.
+**
+** Parameters:
+** 	connection	- Pointer to CS_CONNECTION structure.
+**
+** Return:
+**	CS_SUCCEED, or CS_FAIL if the probe failed.
+*/
+
+CS_STATIC CS_RETCODE
+logtransfer_probe_clock(CS_CONNECTION *connection)
+{
+    CS_DATAFMT  datafmt;
+    CS_DATETIME servertime;
+    CS_VOID     *values[1];
+    CS_BIGINT   sent;
+    CS_BIGINT   received;
+    CS_BIGINT   usec;
+    time_t      now;
+
+    now = time(NULL);
+    if((Ex_clock_probe_interval <= 0) ||
+       ((Lt_last_probe != 0) && (now - Lt_last_probe < Ex_clock_probe_interval))) {
+        return CS_SUCCEED;
+    }
+    Lt_last_probe = now;
+
+    memset(&datafmt, 0, sizeof (datafmt));
+    datafmt.datatype = CS_DATETIME_TYPE;
+    datafmt.format = CS_FMT_UNUSED;
+    datafmt.maxlength = sizeof (servertime);
+    datafmt.count = 1;
+    values[0] = &servertime;
+    if(logtransfer_select_row(connection, "select getdate()", 1, &datafmt,
+                              values, &sent, &received) != CS_SUCCEED) {
+        return CS_FAIL;
+    }
+
+    /*
+    ** getdate() is read about as the row is sent, so it is put at the
+    ** midpoint of the round trip.
+    */
+    if((received != 0) &&
+       (logtransfer_dt_epoch(&servertime, CS_DATETIME_TYPE, &usec) == CS_SUCCEED)) {
+        lt_lag_probe(usec, sent, received);
+    }
+    return CS_SUCCEED;
+}
+
+/*
+** logtransfer_probe_backlog()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Read the page at the end of the log of Ex_dbname, the root page of
+** 	syslogs, and the size of a page, for the backlog estimator. Called
+** 	between scans, on the scan's connection.
+**
+** Parameters:
+** 	ctx		- Pointer to the CS_CONNECTION structure.
+** 	endpage		- Set to the page at the end of the log.
+** 	pagesize	- Set to the bytes of a page.
+**
+** Return:
+**	CS_SUCCEED, or CS_FAIL if the probe failed.
+*/
+
+CS_STATIC CS_RETCODE
+logtransfer_probe_backlog(CS_VOID *ctx, CS_UINT *endpage, CS_INT *pagesize)
+{
+    CS_CHAR     sql[EX_MAXSTRINGLEN];
+    CS_DATAFMT  datafmt[2];
+    CS_VOID     *values[2];
+    CS_INT      root;
+    CS_BIGINT   sent;
+    CS_BIGINT   received;
+    CS_INT      i;
+
+    sprintf(sql, "select loginfo(db_id('%.*s'), 'root_page'), @@maxpagesize",
+            EX_MAXSTRINGLEN - 100, Ex_dbname);
+    memset(datafmt, 0, sizeof (datafmt));
+    for(i = 0; i < 2; i++) {
+        datafmt[i].datatype = CS_INT_TYPE;
+        datafmt[i].format = CS_FMT_UNUSED;
+        datafmt[i].maxlength = sizeof (CS_INT);
+        datafmt[i].count = 1;
+    }
+    values[0] = &root;
+    values[1] = pagesize;
+    if(logtransfer_select_row((CS_CONNECTION *)ctx, sql, 2, datafmt, values,
+                              &sent, &received) != CS_SUCCEED) {
+        return CS_FAIL;
+    }
+    if(received == 0) {
+        ex_error("logtransfer_probe_backlog: no end of the log returned");
+        return CS_FAIL;
+    }
+    *endpage = (CS_UINT)root;
+    return CS_SUCCEED;
+}
+
+/*
+** logtransfer_tune()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Switch the scans to the tuning the backlog calls for, if they are
+** 	not on it: Ex_catchup_numrecs records per scan to catch up, or
+** 	Ex_scan_numrecs for low latency. Called before a scan.
+**
+** Parameters:
+** 	connection	- Pointer to CS_CONNECTION structure.
+**
+** Return:
+**	CS_SUCCEED, or the failure code of the setqual command.
+*/
+
+CS_STATIC CS_RETCODE
+logtransfer_tune(CS_CONNECTION *connection)
+{
+    LT_BACKLOG_EST  est;
+    CS_CHAR         numrecs[16];
+    CS_CHAR         eta[32];
+    CS_INT          mode;
+    CS_RETCODE      retcode;
+
+    mode = lt_backlog_mode();
+    if(mode == Lt_tuning) {
+        return CS_SUCCEED;
+    }
+    sprintf(numrecs, "%d", (mode == LT_BACKLOG_CATCHUP) ?
+            Ex_catchup_numrecs : Ex_scan_numrecs);
+    if((retcode = DoLogtransfer(connection, "setqual", "numrecs",
+                                numrecs)) != CS_SUCCEED) {
+        return retcode;
+    }
+    Lt_tuning = mode;
+
+    if(lt_backlog_estimate(&est)) {
+        if(est.eta >= 0) {
+            sprintf(eta, "%lld s", (long long)est.eta);
+        } else {
+            strcpy(eta, "none");
+        }
+        lt_out_printf("Log backlog %lld pages, %lld bytes, catch-up ETA %s: "
+                "%s tuning, %s records per scan.\n",
+                (long long)est.pages, (long long)est.bytes, eta,
+                (mode == LT_BACKLOG_CATCHUP) ? "catch-up" : "low latency",
+                numrecs);
+    }
+    return CS_SUCCEED;
+}
+
+/*
+** logtransfer_report_lag()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Report the lag of the transactions from their commit to their
+** 	capture and to their emission, and the skew of the server's clock
+** 	it was corrected for.
+**
+** Return:
+**	Nothing.
+*/
+
+CS_STATIC CS_VOID
+logtransfer_report_lag(CS_VOID)
+{
+    LT_HIST     *hists;
+    CS_BIGINT   skew;
+    CS_BIGINT   rtt;
+
+    hists = (LT_HIST *)malloc(2 * sizeof (LT_HIST));
+    if(hists == NULL) {
+        ex_error("logtransfer_report_lag: malloc() failed");
+        return;
+    }
+    lt_lag_hist(&hists[0], &hists[1]);
+    if(hists[0].count > 0) {
+        lt_out_printf("Lag from commit, p50/p99/max in us: capture %llu/%llu/%llu, emit %llu/%llu/%llu.\n",
+                (unsigned long long)lt_hist_quantile(&hists[0], 0.5),
+                (unsigned long long)lt_hist_quantile(&hists[0], 0.99),
+                (unsigned long long)hists[0].max,
+                (unsigned long long)lt_hist_quantile(&hists[1], 0.5),
+                (unsigned long long)lt_hist_quantile(&hists[1], 0.99),
+                (unsigned long long)hists[1].max);
+        if(lt_lag_skew(&skew, &rtt)) {
+            lt_out_printf("Server clock skew %lld us, give or take %lld us.\n",
+                    (long long)skew, (long long)(rtt / 2));
+        }
+        lt_out_flush();
+    }
+    free(hists);
+}
+
+/*
+** logtransfer_fetch_row()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Fetch the next row of a result. While a capture is being recorded,
+** 	the row is fetched into the native values in 'rawdata', recorded,
+** 	and then converted into 'coldata' as ct_bind() would have
+** 	converted it for the formats in 'datafmt'.
+**
+** Parameters:
+**	cmd		- The command.
+**	num_cols	- The number of columns.
+**	orig_datafmt	- The column descriptions.
+**	datafmt		- The formats the columns are displayed in.
+**	coldata		- The displayed values.
+**	rawdata		- The native values, or NULL if the columns are
+**			  bound to 'coldata'.
+**	rows_read	- Set to the number of rows fetched.
+**
+** Return:
+**	The result of ct_fetch(), or CS_ROW_FAIL if a value could not be
+**	converted.
+*/
+
+CS_STATIC CS_RETCODE
+logtransfer_fetch_row(CS_COMMAND *cmd, CS_INT num_cols,
+                      CS_DATAFMT orig_datafmt[], CS_DATAFMT datafmt[],
+                      EX_COLUMN_DATA coldata[], EX_COLUMN_DATA rawdata[],
+                      CS_INT *rows_read)
+{
+    CS_RETCODE      retcode;
+    CS_DATAFMT      srcfmt;
+    EX_COLUMN_DATA  *values;
+    CS_BIGINT       start;
+    CS_BIGINT       now;
+    CS_INT          len;
+    CS_INT          i;
+
+    start = lt_clock_usec();
+    retcode = ct_fetch(cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED, rows_read);
+    now = logtransfer_scan_waited(start);
+    if(retcode != CS_SUCCEED && retcode != CS_ROW_FAIL) {
+        return retcode;
+    }
+    if(Lt_scan_time.firstrow == 0) {
+        Lt_scan_time.firstrow = now;
+    }
+
+    /*
+    ** The bytes fetched are those of the values as bound.
+    */
+    values = (rawdata != NULL) ? rawdata : coldata;
+    for(i = 0, len = 0; i < num_cols; i++) {
+        if((CS_SMALLINT)values[i].indicator != CS_NULLDATA) {
+            len += values[i].valuelen;
+        }
+    }
+    LT_METRIC_ADD(&Lt_stats.rows, *rows_read);
+    LT_METRIC_ADD(&Lt_stats.bytes, len);
+    if(rawdata == NULL) {
+        return retcode;
+    }
+
+    if(Lt_capturing &&
+       (lt_capture_put_row(&Lt_capture, num_cols, rawdata) != CS_SUCCEED)) {
+        logtransfer_capture_stop();
+    }
+
+    for(i = 0; i < num_cols; i++) {
+        coldata[i].indicator = rawdata[i].indicator;
+        if((CS_SMALLINT)rawdata[i].indicator == CS_NULLDATA) {
+            if(datafmt[i].datatype == CS_CHAR_TYPE) {
+                len = MIN((CS_INT)strlen(LT_NULL_STRING), datafmt[i].maxlength - 1);
+                memcpy(coldata[i].value, LT_NULL_STRING, len);
+                coldata[i].value[len] = '\0';
+                coldata[i].valuelen = len + 1;
+            }
+            else {
+                memset(coldata[i].value, 0, datafmt[i].maxlength);
+                coldata[i].valuelen = 0;
+            }
+        }
+        else if(datafmt[i].datatype != CS_CHAR_TYPE) {
+            /*
+            ** The date and time columns are displayed from their
+            ** native values.
+            */
+            len = MIN(rawdata[i].valuelen, datafmt[i].maxlength);
+            memcpy(coldata[i].value, rawdata[i].value, len);
+            coldata[i].valuelen = len;
+        }
+        else {
+            STRUCTASSIGN(srcfmt, orig_datafmt[i]);
+            srcfmt.maxlength = rawdata[i].valuelen;
+            if(cs_convert(Cs_context, &srcfmt, rawdata[i].value, &datafmt[i],
+                          coldata[i].value, &coldata[i].valuelen) != CS_SUCCEED) {
+                coldata[i].value[0] = '\0';
+                coldata[i].valuelen = 1;
+                retcode = CS_ROW_FAIL;
+            }
+        }
+    }
+
+    return retcode;
+}
+
+/*
+** logtransfer_capture_result()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Record a result without columns of the scan being captured.
+**
+** Parameters:
+**	res_type	- The result type returned by ct_results().
+**	msg_id		- The message id of a CS_MSG_RESULT, otherwise 0.
+**
+** Return:
+**	Nothing.
+*/
+
+CS_STATIC CS_VOID
+logtransfer_capture_result(CS_INT res_type, CS_INT msg_id)
+{
+    if(Lt_capturing &&
+       (lt_capture_put_result(&Lt_capture, res_type, msg_id, 0, NULL) != CS_SUCCEED)) {
+        logtransfer_capture_stop();
     }
-    else if(strcmp(operation, OPERATION_BEFORE_AND_AFTER_IMAGE) == 0) {
-        fprintf(stdout, "BEFORE & AFTER images");
-    }
-    else if(strcmp(operation, OPERATION_BEFORE_IMAGE) == 0) {
-        fprintf(stdout, "BEFORE IMAGE");
-    }
-    else if(strcmp(operation, OPERATION_CLEAR) == 0) {
-        fprintf(stdout, "CLEAR");
-    }
-    fflush(stdout);
+}
+
+/*
+** logtransfer_capture_stop()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Stop recording after the capture file could not be written. The
+** 	scans go on without it.
+**
+** Return:
+**	Nothing.
+*/
+
+CS_STATIC CS_VOID
+logtransfer_capture_stop(CS_VOID)
+{
+    ex_error("logtransfer: writing the capture file failed, recording stopped");
+    LT_METRIC_ADD(&Lt_stats.capture_errors, 1);
+    lt_capture_close(&Lt_capture);
+    Lt_capturing = CS_FALSE;
+}
+
+/*
+** logtransfer_display_header()
+**
+** Type of function:
+** example program api
+**
+** Purpose:
+**
+** Returns:
+** Nothing.
+**
+** Side Effects:
+** None
+*/
+CS_RETCODE CS_PUBLIC
+logtransfer_display_header(CS_INT numcols, CS_DATAFMT orig_columns[],
+                           CS_DATAFMT columns[], CS_CHAR* operation, CS_CHAR *status)
+{
+    CS_INT		i;
+    CS_INT		l;
+    CS_INT		disp_len;
 
-    fputc('\n', stdout);
+    /*
+    ** Row preamble.
+    */
+    lt_out_putc('\n');
+    if(strcmp(operation, OPERATION_BEGINXACT) == 0) {
+        lt_out_puts("BEGIN XACT");
+    }
+    else if(strcmp(operation, OPERATION_INSERT) == 0) {
+        if(strcmp(status, STATUS_UPDATE) == 0) {
+            lt_out_puts("UPDATE");
+        }
+        else {
+            lt_out_puts("INSERT");
+        }
+    }
+    else if(strcmp(operation, OPERATION_AFTER_IMAGE) == 0) {
+        lt_out_puts("AFTER IMAGE");
+    }
+    else if(strcmp(operation, OPERATION_TEXT) == 0) {
+        lt_out_puts("TEXTINSERT");
+    }
+    else if(strcmp(operation, OPERATION_TEXT_AFTER) == 0) {
+        lt_out_puts("Text column AFTER image");
+    }
+    else if(strcmp(operation, OPERATION_ENDXACT) == 0) {
+        lt_out_puts("COMMIT XACT");
+    }
+    else if(strcmp(operation, OPERATION_DELETE) == 0) {
+        if(strcmp(status, STATUS_UPDATE) == 0) {
+            lt_out_puts("UPDATE");
+        }
+        else {
+            lt_out_puts("DELETE");
+        }
+    }
+    else if(strcmp(operation, OPERATION_BEFORE_AND_AFTER_IMAGE) == 0) {
+        lt_out_puts("BEFORE & AFTER images");
+    }
+    else if(strcmp(operation, OPERATION_BEFORE_IMAGE) == 0) {
+        lt_out_puts("BEFORE IMAGE");
+    }
+    else if(strcmp(operation, OPERATION_CLEAR) == 0) {
+        lt_out_puts("CLEAR");
+    }
+    else if(strcmp(operation, OPERATION_SAVEPT) == 0) {
+        lt_out_puts("SAVEPOINT");
+    }
+    lt_out_putc('\n');
     for (i = 0; i < numcols; i++)
     {
         switch (i)
@@ -1602,7 +3581,8 @@ logtransfer_display_header(CS_INT numcols, CS_DATAFMT orig_columns[],
             {
                 if((strcmp(operation, OPERATION_INSERT) == 0) ||
                    (strcmp(operation, OPERATION_DELETE) == 0) ||
-                   (strcmp(operation, OPERATION_ENDXACT) == 0)) {
+                   (strcmp(operation, OPERATION_ENDXACT) == 0) ||
+                   (strcmp(operation, OPERATION_SAVEPT) == 0)) {
                     strncpy(columns[i].name, "log page",
                             sizeof(columns[i].name) - 1);
                 }
@@ -1621,7 +3601,8 @@ logtransfer_display_header(CS_INT numcols, CS_DATAFMT orig_columns[],
             {
                 if((strcmp(operation, OPERATION_INSERT) == 0) ||
                    (strcmp(operation, OPERATION_DELETE) == 0) ||
-                   (strcmp(operation, OPERATION_ENDXACT) == 0)) {
+                   (strcmp(operation, OPERATION_ENDXACT) == 0) ||
+                   (strcmp(operation, OPERATION_SAVEPT) == 0)) {
                     strncpy(columns[i].name, "log record",
                             sizeof(columns[i].name) - 1);
                 }
@@ -1701,17 +3682,11 @@ logtransfer_display_header(CS_INT numcols, CS_DATAFMT orig_columns[],
         columns[i].name[sizeof(columns[i].name) - 1] = 0x00;
 
         disp_len = ex_display_dlen(&columns[i]);
-        fprintf(stdout, "%s", columns[i].name);
-        fflush(stdout);
+        lt_out_puts(columns[i].name);
         l = disp_len - strlen(columns[i].name);
-        for (j = 0; j < l; j++)
-        {
-            fputc(' ', stdout);
-            fflush(stdout);
-        }
+        lt_out_pad(' ', l);
     }
-    fputc('\n', stdout);
-    fflush(stdout);
+    lt_out_putc('\n');
 
     for (i = 0; i < numcols; i++)
     {
@@ -1719,29 +3694,20 @@ logtransfer_display_header(CS_INT numcols, CS_DATAFMT orig_columns[],
 
         disp_len = 23;
         snprintf(metadata, 23, "%s(%d)", DTIDNames(orig_columns[i].datatype), orig_columns[i].maxlength);
-        fprintf(stdout, "%s", metadata);
-        fflush(stdout);
+        lt_out_puts(metadata);
         l = disp_len - strlen(metadata);
-        for (j = 0; j < l; j++)
-        {
-            fputc(' ', stdout);
-            fflush(stdout);
-        }
+        lt_out_pad(' ', l);
     }
-    fputc('\n', stdout);
-    fflush(stdout);
+    lt_out_putc('\n');
 
     for (i = 0; i < numcols; i++)
     {
         disp_len = ex_display_dlen(&columns[i]);
         l = disp_len - 1;
-        for (j = 0; j < l; j++)
-        {
-            fputc('-', stdout);
-        }
-        fputc(' ', stdout);
+        lt_out_pad('-', l);
+        lt_out_putc(' ');
     }
-    fputc('\n', stdout);
+    lt_out_putc('\n');
 
     return CS_SUCCEED;
 }
@@ -1815,6 +3781,60 @@ logtransfer_dt_fmt(CS_VOID *val, CS_CHAR *out_buf, CS_INT bufSize, CS_INT date_t
     return CS_SUCCEED;
 }
 
+/*
+** logtransfer_dt_epoch()
+**
+** Type of function:
+** 	logtransfer program internal api
+**
+** Purpose:
+** 	Convert a datetime value to microseconds since the epoch, taking
+** 	the server's local time as UTC.
+**
+** Parameters:
+** 	val		- The datetime value.
+** 	date_type	- Its datatype.
+** 	usec		- Set to the converted value.
+**
+** Return:
+**	CS_SUCCEED, or the failure code of cs_dt_crack().
+*/
+
+CS_STATIC CS_RETCODE
+logtransfer_dt_epoch(CS_VOID *val, CS_INT date_type, CS_BIGINT *usec)
+{
+    CS_RETCODE  retcode;
+    CS_DATEREC  cracked;
+    CS_BIGINT   y;
+    CS_BIGINT   m;
+    CS_BIGINT   days;
+
+    if((retcode = cs_dt_crack(GET_CS_CONTEXT, date_type, val, &cracked))
+       != CS_SUCCEED) {
+        ex_error("logtransfer_dt_epoch: cs_dt_crack() failed");
+        return retcode;
+    }
+
+    /*
+    ** Days since 1970-01-01 of the civil date, with March as the first
+    ** month of the year so the leap day falls last.
+    */
+    y = cracked.dateyear - ((cracked.datemonth < 2) ? 1 : 0);
+    m = (cracked.datemonth + 10) % 12;
+    days = 365 * y + y / 4 - y / 100 + y / 400 + (153 * m + 2) / 5 +
+           (cracked.datedmonth - 1) - 719468;
+
+    *usec = ((days * 24 + cracked.datehour) * 60 + cracked.dateminute) * 60 +
+            cracked.datesecond;
+    *usec *= 1000000;
+    if((date_type == CS_BIGDATETIME_TYPE) || (date_type == CS_BIGTIME_TYPE)) {
+        *usec += cracked.datesecfrac;
+    } else {
+        *usec += (CS_BIGINT)cracked.datemsecond * 1000;
+    }
+    return CS_SUCCEED;
+}
+
 /*
 ** DoDML()
 **
@@ -1846,8 +3866,7 @@ DoDML(CS_CONNECTION *connection, CS_CHAR *dml)
         return retcode;
     }
 
-    ex_msg("Attempting command:");
-    ex_msg(dml);
+    lt_log(LT_LOG_DEBUG, "Attempting command: %s", dml);
 
     /*
     ** Build the command for our `SELECT` execution.
@@ -0,0 +1,1439 @@
+/*
+** Description
+** -----------
+** 	This file implements the Arrow IPC stream sink. The row changes of
+** 	each batch are appended column by column to per-table builders, and
+** 	every table changed in the batch is written out as one Arrow record
+** 	batch on its own IPC stream, "<prefix>.<owner>.<table>.arrows".
+** 	A stream path that names an existing FIFO is written to as is;
+** 	otherwise an existing file is never overwritten, and a numbered
+** 	name is picked instead.
+**
+** 	Every schema starts with the metadata columns _op (utf8), _xact_id
+** 	and _log_pos (uint64) and _commit_time (timestamp, microseconds),
+** 	followed by the table's columns with types mapped from the server
+** 	datatypes in the change. Integer, float and bit columns become
+** 	Arrow integers, floats and booleans; everything else is utf8 in
+** 	its character representation. Text changes, which carry no table,
+** 	are not written.
+**
+** 	The flatbuffer metadata is built front to back: each table is
+** 	preceded by its vtable, and every child object is written after the
+** 	field that refers to it, which is patched once its position is
+** 	known.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltbatch.h"
+#include "ltarrow.h"
+#include "ltdurable.h"
+
+/*
+** Arrow format constants.
+*/
+#define LT_ARROW_CONTINUATION	0xffffffff
+#define LT_ARROW_V5		4
+#define LT_ARROW_MSG_SCHEMA	1
+#define LT_ARROW_MSG_BATCH	3
+#define LT_ARROW_TYPE_INT	2
+#define LT_ARROW_TYPE_FLOAT	3
+#define LT_ARROW_TYPE_UTF8	5
+#define LT_ARROW_TYPE_BOOL	6
+#define LT_ARROW_TYPE_TIMESTAMP	10
+#define LT_ARROW_SINGLE		1
+#define LT_ARROW_DOUBLE		2
+#define LT_ARROW_MICROSECOND	2
+
+#define LT_ARROW_ALIGN(_n)	(((_n) + 7) & ~7)
+#define LT_ARROW_MAXFILES	1000
+
+#ifndef IOV_MAX
+#define IOV_MAX			1024
+#endif
+
+/*
+** State of an Arrow sink.
+*/
+typedef struct _lt_arrow_sink
+{
+	LT_SINK		sink;
+	CS_CHAR		*prefix;
+	LT_ARROW_TABLE	*tables;
+	LT_BUF		meta;
+	LT_COLUMN	*columns;
+	CS_INT		maxcols;
+	struct iovec	*iov;
+	CS_INT		maxiov;
+} LT_ARROW_SINK;
+
+CS_STATIC CS_BYTE Lt_arrow_zeros[8];
+
+/*****************************************************************************
+**
+** flatbuffer functions
+**
+*****************************************************************************/
+
+#define LT_FB_SET(_fb, _pos, _v)	memcpy((_fb)->data + (_pos), &(_v), sizeof (_v))
+
+/*
+** lt_fb_pad()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Append zeros until 'extra' bytes past the end of the buffer would
+** 	be aligned to 'align'.
+**
+** Parameters:
+** 	fb		- The flatbuffer being built.
+** 	align		- The alignment, a power of two.
+** 	extra		- Bytes to be written before the aligned position.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_fb_pad(LT_BUF *fb, CS_INT align, CS_INT extra)
+{
+	CS_INT		n;
+
+	n = (align - ((fb->len + extra) & (align - 1))) & (align - 1);
+	return (n > 0) ? lt_buf_append(fb, Lt_arrow_zeros, n) : CS_SUCCEED;
+}
+
+/*
+** lt_fb_table()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Append a zero filled table and its vtable. Fields are laid out
+** 	largest first so each is aligned to its size.
+**
+** Parameters:
+** 	fb		- The flatbuffer being built.
+** 	nfields		- Number of fields in the table's schema.
+** 	sizes		- Size of each field, 0 for an absent one.
+** 	pos		- Set to the position of each field.
+** 	table		- Set to the position of the table.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_fb_table(LT_BUF *fb, CS_INT nfields, CS_INT sizes[], CS_INT pos[],
+	    CS_INT *table)
+{
+	CS_RETCODE	retcode;
+	CS_USMALLINT	vt[16];
+	CS_INT		size;
+	CS_INT		off = 4;
+	CS_INT		vtpos;
+	CS_INT		soff;
+	CS_INT		i;
+
+	for (size = 8; size > 0; size /= 2)
+	{
+		for (i = 0; i < nfields; i++)
+		{
+			if (sizes[i] == size)
+			{
+				off = (off + size - 1) & ~(size - 1);
+				vt[2 + i] = (CS_USMALLINT)off;
+				off += size;
+			}
+			else if (sizes[i] == 0)
+			{
+				vt[2 + i] = 0;
+			}
+		}
+	}
+	vt[0] = (CS_USMALLINT)((2 + nfields) * sizeof (CS_USMALLINT));
+	vt[1] = (CS_USMALLINT)off;
+
+	if ((retcode = lt_fb_pad(fb, 2, 0)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	vtpos = fb->len;
+	if ((retcode = lt_buf_append(fb, vt, vt[0])) != CS_SUCCEED ||
+	    (retcode = lt_fb_pad(fb, 8, 0)) != CS_SUCCEED ||
+	    (retcode = lt_buf_reserve(fb, off)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	*table = fb->len;
+	memset(fb->data + fb->len, 0, off);
+	fb->len += off;
+
+	soff = *table - vtpos;
+	LT_FB_SET(fb, *table, soff);
+	for (i = 0; i < nfields; i++)
+	{
+		pos[i] = (vt[2 + i] == 0) ? 0 : *table + vt[2 + i];
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_fb_ref()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Point the offset field at 'field' to the object at 'target', which
+** 	lies after it.
+**
+** Parameters:
+** 	fb		- The flatbuffer being built.
+** 	field		- Position of the offset field.
+** 	target		- Position of the object.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_fb_ref(LT_BUF *fb, CS_INT field, CS_INT target)
+{
+	CS_UINT		uoff;
+
+	uoff = (CS_UINT)(target - field);
+	LT_FB_SET(fb, field, uoff);
+}
+
+/*
+** lt_fb_vector()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Append a zero filled vector.
+**
+** Parameters:
+** 	fb		- The flatbuffer being built.
+** 	count		- Number of elements.
+** 	elemsize	- Size of an element.
+** 	vec		- Set to the position of the vector; its first
+** 			  element is at 'vec' + 4.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_fb_vector(LT_BUF *fb, CS_INT count, CS_INT elemsize, CS_INT *vec)
+{
+	CS_RETCODE	retcode;
+	CS_UINT		u32 = (CS_UINT)count;
+
+	if ((retcode = lt_fb_pad(fb, (elemsize > 4) ? 8 : 4, 4)) != CS_SUCCEED ||
+	    (retcode = lt_buf_reserve(fb, 4 + count * elemsize)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	*vec = fb->len;
+	LT_FB_SET(fb, fb->len, u32);
+	memset(fb->data + fb->len + 4, 0, count * elemsize);
+	fb->len += 4 + count * elemsize;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_fb_string()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Append a string.
+**
+** Parameters:
+** 	fb		- The flatbuffer being built.
+** 	str		- The null terminated string.
+** 	pos		- Set to the position of the string.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_fb_string(LT_BUF *fb, CS_CHAR *str, CS_INT *pos)
+{
+	CS_RETCODE	retcode;
+	CS_UINT		len = (CS_UINT)strlen(str);
+
+	if ((retcode = lt_fb_pad(fb, 4, 0)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	*pos = fb->len;
+	if ((retcode = lt_buf_append(fb, &len, sizeof (len))) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	return lt_buf_append(fb, str, len + 1);
+}
+
+/*
+** lt_fb_message()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Start a flatbuffer with a Message root table.
+**
+** Parameters:
+** 	fb		- The flatbuffer, emptied first.
+** 	type		- The message header type.
+** 	bodylen		- Length of the message body.
+** 	header		- Set to the position of the header offset field.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_fb_message(LT_BUF *fb, CS_INT type, CS_BIGINT bodylen, CS_INT *header)
+{
+	CS_RETCODE	retcode;
+	CS_INT		sizes[4] = { 2, 1, 4, 8 };
+	CS_INT		pos[4];
+	CS_INT		table;
+	CS_UINT		root = 0;
+	CS_SMALLINT	version = LT_ARROW_V5;
+	CS_BYTE		u8 = (CS_BYTE)type;
+
+	fb->len = 0;
+	if ((retcode = lt_buf_append(fb, &root, sizeof (root))) != CS_SUCCEED ||
+	    (retcode = lt_fb_table(fb, 4, sizes, pos, &table)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	lt_fb_ref(fb, 0, table);
+	LT_FB_SET(fb, pos[0], version);
+	LT_FB_SET(fb, pos[1], u8);
+	LT_FB_SET(fb, pos[3], bodylen);
+	*header = pos[2];
+	return CS_SUCCEED;
+}
+
+/*****************************************************************************
+**
+** column builder functions
+**
+*****************************************************************************/
+
+/*
+** lt_arrow_coltype()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Set the Arrow type of a column from its server datatype.
+**
+** Parameters:
+** 	col		- The column.
+** 	datatype	- The server datatype.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_arrow_coltype(LT_ARROW_COL *col, CS_INT datatype)
+{
+	col->type = LT_ARROW_INT;
+	col->is_signed = CS_TRUE;
+	switch ((int)datatype)
+	{
+	  case CS_TINYINT_TYPE:
+		col->width = 1;
+		col->is_signed = CS_FALSE;
+		break;
+	  case CS_SMALLINT_TYPE:
+		col->width = 2;
+		break;
+	  case CS_USMALLINT_TYPE:
+		col->width = 2;
+		col->is_signed = CS_FALSE;
+		break;
+	  case CS_INT_TYPE:
+		col->width = 4;
+		break;
+	  case CS_UINT_TYPE:
+		col->width = 4;
+		col->is_signed = CS_FALSE;
+		break;
+	  case CS_BIGINT_TYPE:
+		col->width = 8;
+		break;
+	  case CS_UBIGINT_TYPE:
+		col->width = 8;
+		col->is_signed = CS_FALSE;
+		break;
+	  case CS_REAL_TYPE:
+		col->type = LT_ARROW_FLOAT;
+		col->width = 4;
+		break;
+	  case CS_FLOAT_TYPE:
+		col->type = LT_ARROW_FLOAT;
+		col->width = 8;
+		break;
+	  case CS_BIT_TYPE:
+		col->type = LT_ARROW_BOOL;
+		col->width = 0;
+		break;
+	  default:
+		col->type = LT_ARROW_UTF8;
+		col->width = 0;
+		break;
+	}
+}
+
+/*
+** lt_arrow_reset()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Empty the column builders of a table after a record batch.
+**
+** Parameters:
+** 	tbl		- The table.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_arrow_reset(LT_ARROW_TABLE *tbl)
+{
+	CS_RETCODE	retcode;
+	CS_INT		zero = 0;
+	CS_INT		i;
+
+	tbl->nrows = 0;
+	for (i = 0; i < tbl->ncols; i++)
+	{
+		tbl->cols[i].validity.len = 0;
+		tbl->cols[i].values.len = 0;
+		tbl->cols[i].offsets.len = 0;
+		tbl->cols[i].nulls = 0;
+		if (tbl->cols[i].type == LT_ARROW_UTF8 &&
+		    (retcode = lt_buf_append(&tbl->cols[i].offsets, &zero,
+				sizeof (zero))) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_arrow_bit()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Append a bit to a bitmap holding 'n' bits.
+**
+** Parameters:
+** 	bits		- The bitmap.
+** 	n		- Number of bits already in it.
+** 	set		- CS_TRUE to append a 1.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_arrow_bit(LT_BUF *bits, CS_INT n, CS_BOOL set)
+{
+	CS_RETCODE	retcode;
+	CS_BYTE		zero = 0;
+
+	if ((n & 7) == 0 &&
+	    (retcode = lt_buf_append(bits, &zero, 1)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	if (set)
+	{
+		bits->data[n >> 3] |= (CS_BYTE)(1 << (n & 7));
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_arrow_append()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Append one value to a column. Integer and float values are parsed
+** 	from their character representation.
+**
+** Parameters:
+** 	col		- The column.
+** 	n		- Number of values already in the column.
+** 	value		- The value, or NULL for a null.
+** 	len		- Length of the value.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_arrow_append(LT_ARROW_COL *col, CS_INT n, CS_CHAR *value, CS_INT len)
+{
+	CS_RETCODE	retcode;
+	CS_CHAR		num[64];
+	CS_BIGINT	i64 = 0;
+	CS_UBIGINT	u64 = 0;
+	CS_INT		i32;
+	CS_SMALLINT	i16;
+	CS_BYTE		i8;
+	CS_REAL		f32;
+	CS_FLOAT	f64 = 0;
+
+	if ((retcode = lt_arrow_bit(&col->validity, n, value != NULL)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	if (value == NULL)
+	{
+		col->nulls++;
+		len = 0;
+	}
+
+	if (col->type == LT_ARROW_UTF8)
+	{
+		if (len > 0 &&
+		    (retcode = lt_buf_append(&col->values, value, len)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+		i32 = col->values.len;
+		return lt_buf_append(&col->offsets, &i32, sizeof (i32));
+	}
+	if (col->type == LT_ARROW_BOOL)
+	{
+		return lt_arrow_bit(&col->values, n,
+			value != NULL && len > 0 && value[0] != '0');
+	}
+
+	/*
+	** Numbers are converted from a null terminated copy.
+	*/
+	if (value != NULL)
+	{
+		if (len >= (CS_INT)sizeof (num))
+		{
+			len = sizeof (num) - 1;
+		}
+		memcpy(num, value, len);
+		num[len] = '\0';
+		if (col->type == LT_ARROW_FLOAT)
+		{
+			f64 = strtod(num, NULL);
+		}
+		else if (col->is_signed)
+		{
+			i64 = strtoll(num, NULL, 10);
+		}
+		else
+		{
+			u64 = strtoull(num, NULL, 10);
+			i64 = (CS_BIGINT)u64;
+		}
+	}
+
+	if (col->type == LT_ARROW_FLOAT)
+	{
+		if (col->width == 4)
+		{
+			f32 = (CS_REAL)f64;
+			return lt_buf_append(&col->values, &f32, sizeof (f32));
+		}
+		return lt_buf_append(&col->values, &f64, sizeof (f64));
+	}
+	switch (col->width)
+	{
+	  case 1:
+		i8 = (CS_BYTE)i64;
+		return lt_buf_append(&col->values, &i8, sizeof (i8));
+	  case 2:
+		i16 = (CS_SMALLINT)i64;
+		return lt_buf_append(&col->values, &i16, sizeof (i16));
+	  case 4:
+		i32 = (CS_INT)i64;
+		return lt_buf_append(&col->values, &i32, sizeof (i32));
+	}
+	return lt_buf_append(&col->values, &i64, sizeof (i64));
+}
+
+/*****************************************************************************
+**
+** stream functions
+**
+*****************************************************************************/
+
+/*
+** lt_arrow_writev()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Write an iovec array whole, in chunks of at most IOV_MAX entries,
+** 	resuming after short writes. The array is modified.
+**
+** Parameters:
+** 	fd		- The file descriptor.
+** 	iov		- The iovec array.
+** 	iovcnt		- Number of entries.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a write failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_arrow_writev(int fd, struct iovec *iov, CS_INT iovcnt)
+{
+	ssize_t		n;
+
+	while (iovcnt > 0)
+	{
+		n = writev(fd, iov, (iovcnt > IOV_MAX) ? IOV_MAX : iovcnt);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			ex_error("lt_arrow_writev: writev() failed");
+			return CS_FAIL;
+		}
+		while (iovcnt > 0 && (size_t)n >= iov->iov_len)
+		{
+			n -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0)
+		{
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_arrow_iov()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Add a buffer, and the padding to its 8 byte aligned length, to the
+** 	sink's iovec array.
+**
+** Parameters:
+** 	as		- The sink.
+** 	n		- Pointer to the number of entries in use.
+** 	data		- The buffer.
+** 	len		- Its length.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_arrow_iov(LT_ARROW_SINK *as, CS_INT *n, CS_VOID *data, CS_INT len)
+{
+	struct iovec	*iov;
+	CS_INT		max;
+
+	if (*n + 2 > as->maxiov)
+	{
+		max = (as->maxiov == 0) ? 64 : as->maxiov * 2;
+		iov = (struct iovec *)realloc(as->iov, max * sizeof (struct iovec));
+		if (iov == NULL)
+		{
+			ex_error("lt_arrow_iov: realloc() failed");
+			return CS_MEM_ERROR;
+		}
+		as->iov = iov;
+		as->maxiov = max;
+	}
+	if (len > 0)
+	{
+		as->iov[*n].iov_base = data;
+		as->iov[*n].iov_len = len;
+		(*n)++;
+	}
+	if (LT_ARROW_ALIGN(len) > len)
+	{
+		as->iov[*n].iov_base = Lt_arrow_zeros;
+		as->iov[*n].iov_len = LT_ARROW_ALIGN(len) - len;
+		(*n)++;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_arrow_message()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Frame the flatbuffer in the sink's metadata buffer as an
+** 	encapsulated IPC message, and add it to the sink's iovec array.
+**
+** Parameters:
+** 	as		- The sink.
+** 	n		- Pointer to the number of entries in use.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_arrow_message(LT_ARROW_SINK *as, CS_INT *n)
+{
+	CS_RETCODE	retcode;
+	CS_UINT		prefix[2];
+
+	if ((retcode = lt_fb_pad(&as->meta, 8, 0)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	prefix[0] = LT_ARROW_CONTINUATION;
+	prefix[1] = (CS_UINT)as->meta.len;
+	if ((retcode = lt_buf_reserve(&as->meta, sizeof (prefix))) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	memmove(as->meta.data + sizeof (prefix), as->meta.data, as->meta.len);
+	memcpy(as->meta.data, prefix, sizeof (prefix));
+	as->meta.len += sizeof (prefix);
+	return lt_arrow_iov(as, n, as->meta.data, as->meta.len);
+}
+
+/*
+** lt_arrow_schema()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Write the schema message that starts a table's stream.
+**
+** Parameters:
+** 	as		- The sink.
+** 	tbl		- The table.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a realloc failed, or CS_FAIL if the
+** 	write failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_arrow_schema(LT_ARROW_SINK *as, LT_ARROW_TABLE *tbl)
+{
+	LT_BUF		*fb = &as->meta;
+	LT_ARROW_COL	*col;
+	CS_RETCODE	retcode;
+	CS_INT		header;
+	CS_INT		table;
+	CS_INT		fields;
+	CS_INT		sizes[6];
+	CS_INT		pos[6];
+	CS_INT		tpos[2];
+	CS_INT		str;
+	CS_INT		vec;
+	CS_INT		i;
+	CS_INT		n = 0;
+	CS_INT		i32;
+	CS_SMALLINT	i16;
+	CS_BYTE		u8;
+
+	if ((retcode = lt_fb_message(fb, LT_ARROW_MSG_SCHEMA, 0,
+			&header)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	/*
+	** Schema { endianness, fields }
+	*/
+	sizes[0] = 2;
+	sizes[1] = 4;
+	if ((retcode = lt_fb_table(fb, 2, sizes, pos, &table)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	lt_fb_ref(fb, header, table);
+	i32 = pos[1];
+	if ((retcode = lt_fb_vector(fb, tbl->ncols, 4, &fields)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	lt_fb_ref(fb, i32, fields);
+
+	for (i = 0; i < tbl->ncols; i++)
+	{
+		col = &tbl->cols[i];
+
+		/*
+		** Field { name, nullable, type_type, type, dictionary,
+		** children }
+		*/
+		sizes[0] = 4;
+		sizes[1] = 1;
+		sizes[2] = 1;
+		sizes[3] = 4;
+		sizes[4] = 0;
+		sizes[5] = 4;
+		if ((retcode = lt_fb_table(fb, 6, sizes, pos, &table)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+		lt_fb_ref(fb, fields + 4 + i * 4, table);
+		u8 = 1;
+		LT_FB_SET(fb, pos[1], u8);
+		switch (col->type)
+		{
+		  case LT_ARROW_INT:
+			u8 = LT_ARROW_TYPE_INT;
+			break;
+		  case LT_ARROW_FLOAT:
+			u8 = LT_ARROW_TYPE_FLOAT;
+			break;
+		  case LT_ARROW_BOOL:
+			u8 = LT_ARROW_TYPE_BOOL;
+			break;
+		  case LT_ARROW_TIMESTAMP:
+			u8 = LT_ARROW_TYPE_TIMESTAMP;
+			break;
+		  default:
+			u8 = LT_ARROW_TYPE_UTF8;
+			break;
+		}
+		LT_FB_SET(fb, pos[2], u8);
+
+		if ((retcode = lt_fb_string(fb, col->name, &str)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+		lt_fb_ref(fb, pos[0], str);
+
+		/*
+		** The type table: Int { bitWidth, is_signed },
+		** FloatingPoint { precision }, Timestamp { unit }, or an
+		** empty Utf8 or Bool.
+		*/
+		sizes[0] = sizes[1] = 0;
+		if (col->type == LT_ARROW_INT)
+		{
+			sizes[0] = 4;
+			sizes[1] = 1;
+		}
+		else if (col->type == LT_ARROW_FLOAT ||
+			 col->type == LT_ARROW_TIMESTAMP)
+		{
+			sizes[0] = 2;
+		}
+		if ((retcode = lt_fb_table(fb, 2, sizes, tpos, &str)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+		lt_fb_ref(fb, pos[3], str);
+		if (col->type == LT_ARROW_INT)
+		{
+			i32 = col->width * 8;
+			LT_FB_SET(fb, tpos[0], i32);
+			u8 = (CS_BYTE)col->is_signed;
+			LT_FB_SET(fb, tpos[1], u8);
+		}
+		else if (col->type == LT_ARROW_FLOAT)
+		{
+			i16 = (col->width == 4) ? LT_ARROW_SINGLE : LT_ARROW_DOUBLE;
+			LT_FB_SET(fb, tpos[0], i16);
+		}
+		else if (col->type == LT_ARROW_TIMESTAMP)
+		{
+			i16 = LT_ARROW_MICROSECOND;
+			LT_FB_SET(fb, tpos[0], i16);
+		}
+
+		/*
+		** Readers require the children vector, even empty.
+		*/
+		if ((retcode = lt_fb_vector(fb, 0, 4, &vec)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+		lt_fb_ref(fb, pos[5], vec);
+	}
+
+	if ((retcode = lt_arrow_message(as, &n)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	return lt_arrow_writev(tbl->fd, as->iov, n);
+}
+
+/*
+** lt_arrow_batch()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Write the rows accumulated for a table as one record batch message,
+** 	and empty its builders.
+**
+** Parameters:
+** 	as		- The sink.
+** 	tbl		- The table.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a realloc failed, or CS_FAIL if the
+** 	write failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_arrow_batch(LT_ARROW_SINK *as, LT_ARROW_TABLE *tbl)
+{
+	LT_BUF		*fb = &as->meta;
+	LT_ARROW_COL	*col;
+	CS_RETCODE	retcode;
+	CS_INT		header;
+	CS_INT		table;
+	CS_INT		nodes;
+	CS_INT		buffers;
+	CS_INT		nbufs = 0;
+	CS_INT		sizes[3];
+	CS_INT		pos[3];
+	CS_INT		i;
+	CS_INT		b;
+	CS_INT		n = 0;
+	CS_BIGINT	body = 0;
+	CS_BIGINT	node[2];
+	CS_BIGINT	buf[2];
+	LT_BUF		*bufs[3];
+
+	for (i = 0; i < tbl->ncols; i++)
+	{
+		nbufs += (tbl->cols[i].type == LT_ARROW_UTF8) ? 3 : 2;
+	}
+
+	/*
+	** Size the body: every buffer padded to 8 bytes.
+	*/
+	for (i = 0; i < tbl->ncols; i++)
+	{
+		col = &tbl->cols[i];
+		bufs[0] = &col->validity;
+		bufs[1] = (col->type == LT_ARROW_UTF8) ? &col->offsets : &col->values;
+		bufs[2] = &col->values;
+		for (b = 0; b < ((col->type == LT_ARROW_UTF8) ? 3 : 2); b++)
+		{
+			body += LT_ARROW_ALIGN(bufs[b]->len);
+		}
+	}
+
+	if ((retcode = lt_fb_message(fb, LT_ARROW_MSG_BATCH, body,
+			&header)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	/*
+	** RecordBatch { length, nodes, buffers }
+	*/
+	sizes[0] = 8;
+	sizes[1] = 4;
+	sizes[2] = 4;
+	if ((retcode = lt_fb_table(fb, 3, sizes, pos, &table)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	lt_fb_ref(fb, header, table);
+	node[0] = tbl->nrows;
+	LT_FB_SET(fb, pos[0], node[0]);
+	if ((retcode = lt_fb_vector(fb, tbl->ncols, 16, &nodes)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	lt_fb_ref(fb, pos[1], nodes);
+	if ((retcode = lt_fb_vector(fb, nbufs, 16, &buffers)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	lt_fb_ref(fb, pos[2], buffers);
+
+	body = 0;
+	nbufs = 0;
+	for (i = 0; i < tbl->ncols; i++)
+	{
+		col = &tbl->cols[i];
+		node[0] = tbl->nrows;
+		node[1] = col->nulls;
+		memcpy(fb->data + nodes + 4 + i * 16, node, sizeof (node));
+
+		bufs[0] = &col->validity;
+		bufs[1] = (col->type == LT_ARROW_UTF8) ? &col->offsets : &col->values;
+		bufs[2] = &col->values;
+		for (b = 0; b < ((col->type == LT_ARROW_UTF8) ? 3 : 2); b++)
+		{
+			buf[0] = body;
+			buf[1] = bufs[b]->len;
+			memcpy(fb->data + buffers + 4 + nbufs * 16, buf, sizeof (buf));
+			nbufs++;
+			body += LT_ARROW_ALIGN(bufs[b]->len);
+		}
+	}
+
+	/*
+	** Write the message and the body buffers in one go.
+	*/
+	if ((retcode = lt_arrow_message(as, &n)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	for (i = 0; i < tbl->ncols; i++)
+	{
+		col = &tbl->cols[i];
+		bufs[0] = &col->validity;
+		bufs[1] = (col->type == LT_ARROW_UTF8) ? &col->offsets : &col->values;
+		bufs[2] = &col->values;
+		for (b = 0; b < ((col->type == LT_ARROW_UTF8) ? 3 : 2); b++)
+		{
+			if ((retcode = lt_arrow_iov(as, &n, bufs[b]->data,
+					bufs[b]->len)) != CS_SUCCEED)
+			{
+				return retcode;
+			}
+		}
+	}
+
+	if ((retcode = lt_arrow_writev(tbl->fd, as->iov, n)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	return lt_arrow_reset(tbl);
+}
+
+/*
+** lt_arrow_open_stream()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Open the stream file of a table: the FIFO at its path if there is
+** 	one, otherwise a new file at the path or at the first free
+** 	numbered variant of it.
+**
+** Parameters:
+** 	as		- The sink.
+** 	tbl		- The table.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if no file could be opened.
+*/
+
+CS_STATIC CS_RETCODE
+lt_arrow_open_stream(LT_ARROW_SINK *as, LT_ARROW_TABLE *tbl)
+{
+	CS_CHAR		path[CS_MAX_CHAR * 3];
+	struct stat	st;
+	CS_INT		i;
+
+	snprintf(path, sizeof (path), "%s.%s.%s.arrows", as->prefix,
+		 tbl->owner, tbl->table);
+	if (stat(path, &st) == 0 && S_ISFIFO(st.st_mode))
+	{
+		tbl->fd = open(path, O_WRONLY);
+		return (tbl->fd < 0) ? CS_FAIL : CS_SUCCEED;
+	}
+
+	for (i = 1; i <= LT_ARROW_MAXFILES; i++)
+	{
+		tbl->fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+		if (tbl->fd >= 0)
+		{
+			return lt_durable_track(tbl->fd);
+		}
+		if (errno != EEXIST)
+		{
+			break;
+		}
+		snprintf(path, sizeof (path), "%s.%s.%s.%d.arrows", as->prefix,
+			 tbl->owner, tbl->table, i);
+	}
+	ex_error("lt_arrow_open_stream: open() failed");
+	return CS_FAIL;
+}
+
+/*
+** lt_arrow_table()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Find the stream of a change's table, creating it, with its schema
+** 	taken from the change, the first time the table is seen.
+**
+** Parameters:
+** 	as		- The sink.
+** 	change		- The change.
+** 	tbl		- Set to the table.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a malloc failed, or CS_FAIL if the
+** 	stream could not be started.
+*/
+
+CS_STATIC CS_RETCODE
+lt_arrow_table(LT_ARROW_SINK *as, LT_CHANGE *change, LT_ARROW_TABLE **tbl)
+{
+	static CS_CHAR	*metanames[LT_ARROW_METACOLS] =
+		{ "_op", "_xact_id", "_log_pos", "_commit_time" };
+	LT_ARROW_TABLE	*t;
+	LT_ARROW_COL	*col;
+	CS_RETCODE	retcode;
+	CS_INT		i;
+
+	for (t = as->tables; t != NULL; t = t->next)
+	{
+		if (t->tableid == change->tableid &&
+		    t->ownerid == change->ownerid)
+		{
+			*tbl = t;
+			return CS_SUCCEED;
+		}
+	}
+
+	t = (LT_ARROW_TABLE *)calloc(1, sizeof (LT_ARROW_TABLE));
+	if (t == NULL ||
+	    (t->table = (CS_CHAR *)calloc(1, change->tablelen + 1)) == NULL ||
+	    (t->owner = (CS_CHAR *)calloc(1, change->ownerlen + 1)) == NULL ||
+	    (t->cols = (LT_ARROW_COL *)calloc(LT_ARROW_METACOLS +
+		change->numcols, sizeof (LT_ARROW_COL))) == NULL)
+	{
+		ex_error("lt_arrow_table: calloc() failed");
+		if (t != NULL)
+		{
+			free(t->table);
+			free(t->owner);
+			free(t);
+		}
+		return CS_MEM_ERROR;
+	}
+	t->tableid = change->tableid;
+	t->ownerid = change->ownerid;
+	memcpy(t->table, change->table, change->tablelen);
+	memcpy(t->owner, change->owner, change->ownerlen);
+	t->ncols = LT_ARROW_METACOLS + change->numcols;
+	t->fd = -1;
+	t->next = as->tables;
+	as->tables = t;
+
+	for (i = 0; i < t->ncols; i++)
+	{
+		col = &t->cols[i];
+		if (i < LT_ARROW_METACOLS)
+		{
+			col->name = strdup(metanames[i]);
+			col->type = LT_ARROW_INT;
+			col->width = 8;
+			col->is_signed = CS_FALSE;
+		}
+		else
+		{
+			col->name = (CS_CHAR *)calloc(1,
+				change->columns[i - LT_ARROW_METACOLS].namelen + 1);
+			if (col->name != NULL)
+			{
+				memcpy(col->name,
+				       change->columns[i - LT_ARROW_METACOLS].name,
+				       change->columns[i - LT_ARROW_METACOLS].namelen);
+			}
+			lt_arrow_coltype(col,
+				change->columns[i - LT_ARROW_METACOLS].datatype);
+		}
+		if (col->name == NULL)
+		{
+			ex_error("lt_arrow_table: malloc() failed");
+			return CS_MEM_ERROR;
+		}
+	}
+	t->cols[0].type = LT_ARROW_UTF8;
+	t->cols[3].type = LT_ARROW_TIMESTAMP;
+	t->cols[3].is_signed = CS_TRUE;
+
+	if ((retcode = lt_arrow_reset(t)) != CS_SUCCEED ||
+	    (retcode = lt_arrow_open_stream(as, t)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	*tbl = t;
+	return lt_arrow_schema(as, t);
+}
+
+/*****************************************************************************
+**
+** sink functions
+**
+*****************************************************************************/
+
+/*
+** lt_arrow_write()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	Append the changes of a batch to their tables, and write one record
+** 	batch for every table changed.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	batch		- The batch.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a realloc failed, or CS_FAIL if a write
+** 	failed or a change is malformed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_arrow_write(LT_SINK *sink, LT_BATCH *batch)
+{
+	LT_ARROW_SINK	*as = (LT_ARROW_SINK *)sink->ctx;
+	LT_BATCH_XACT	*bx;
+	LT_ARROW_TABLE	*tbl;
+	LT_COLUMN	*c;
+	LT_CHANGE	change;
+	CS_RETCODE	retcode;
+	CS_CHAR		*opname;
+	CS_INT		x;
+	CS_INT		off;
+	CS_INT		len;
+	CS_INT		i;
+
+	for (x = 0; x < batch->nxacts; x++)
+	{
+		bx = &batch->xacts[x];
+		for (off = bx->offset; off < bx->offset + bx->len; off += len)
+		{
+			len = lt_change_decode(batch->changes.data + off,
+				bx->offset + bx->len - off, &change,
+				&as->columns, &as->maxcols);
+			if (len == 0)
+			{
+				ex_error("lt_arrow_write: malformed change");
+				return CS_FAIL;
+			}
+			if (change.op == LT_OP_TEXT || change.tableid == 0)
+			{
+				continue;
+			}
+			if ((retcode = lt_arrow_table(as, &change, &tbl)) != CS_SUCCEED)
+			{
+				return retcode;
+			}
+			if (change.numcols != tbl->ncols - LT_ARROW_METACOLS)
+			{
+				tbl->skipped++;
+				continue;
+			}
+
+			opname = lt_change_opname(change.op);
+			if ((retcode = lt_arrow_append(&tbl->cols[0], tbl->nrows,
+					opname, strlen(opname))) != CS_SUCCEED ||
+			    (retcode = lt_arrow_bit(&tbl->cols[1].validity,
+					tbl->nrows, CS_TRUE)) != CS_SUCCEED ||
+			    (retcode = lt_buf_append(&tbl->cols[1].values,
+					&change.xactid, 8)) != CS_SUCCEED ||
+			    (retcode = lt_arrow_bit(&tbl->cols[2].validity,
+					tbl->nrows, CS_TRUE)) != CS_SUCCEED ||
+			    (retcode = lt_buf_append(&tbl->cols[2].values,
+					&change.pos, 8)) != CS_SUCCEED ||
+			    (retcode = lt_arrow_bit(&tbl->cols[3].validity,
+					tbl->nrows, bx->committime != 0)) != CS_SUCCEED ||
+			    (retcode = lt_buf_append(&tbl->cols[3].values,
+					&bx->committime, 8)) != CS_SUCCEED)
+			{
+				return retcode;
+			}
+			if (bx->committime == 0)
+			{
+				tbl->cols[3].nulls++;
+			}
+
+			for (i = 0; i < change.numcols; i++)
+			{
+				c = &change.columns[i];
+				retcode = lt_arrow_append(
+					&tbl->cols[LT_ARROW_METACOLS + i],
+					tbl->nrows,
+					(c->indicator == CS_NULLDATA) ? NULL : c->value,
+					c->valuelen);
+				if (retcode != CS_SUCCEED)
+				{
+					return retcode;
+				}
+			}
+			tbl->nrows++;
+		}
+	}
+
+	for (tbl = as->tables; tbl != NULL; tbl = tbl->next)
+	{
+		if (tbl->nrows > 0 &&
+		    (retcode = lt_arrow_batch(as, tbl)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_arrow_close()
+**
+** Type of function:
+** 	Arrow sink internal api
+**
+** Purpose:
+** 	End every table's stream, close the files and free the sink.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a stream could not be ended.
+*/
+
+CS_STATIC CS_RETCODE
+lt_arrow_close(LT_SINK *sink)
+{
+	LT_ARROW_SINK	*as = (LT_ARROW_SINK *)sink->ctx;
+	LT_ARROW_TABLE	*tbl;
+	CS_RETCODE	retcode = CS_SUCCEED;
+	CS_UINT		eos[2] = { LT_ARROW_CONTINUATION, 0 };
+	CS_INT		i;
+
+	while ((tbl = as->tables) != NULL)
+	{
+		as->tables = tbl->next;
+		if (tbl->skipped > 0)
+		{
+			fprintf(EX_ERROR_OUT, "lt_arrow_close: %llu changes to %s.%s did not match its schema and were skipped.\n",
+				(unsigned long long)tbl->skipped, tbl->owner, tbl->table);
+		}
+		if (tbl->fd >= 0)
+		{
+			if (write(tbl->fd, eos, sizeof (eos)) != sizeof (eos))
+			{
+				ex_error("lt_arrow_close: failed to end stream");
+				retcode = CS_FAIL;
+			}
+			lt_durable_untrack(tbl->fd);
+			if (close(tbl->fd) != 0)
+			{
+				ex_error("lt_arrow_close: close() failed");
+				retcode = CS_FAIL;
+			}
+		}
+		for (i = 0; i < tbl->ncols; i++)
+		{
+			free(tbl->cols[i].name);
+			lt_buf_free(&tbl->cols[i].validity);
+			lt_buf_free(&tbl->cols[i].values);
+			lt_buf_free(&tbl->cols[i].offsets);
+		}
+		free(tbl->cols);
+		free(tbl->table);
+		free(tbl->owner);
+		free(tbl);
+	}
+
+	lt_buf_free(&as->meta);
+	free(as->columns);
+	free(as->iov);
+	free(as->prefix);
+	free(as);
+	return retcode;
+}
+
+/*
+** lt_arrow_open()
+**
+** Type of function:
+** 	Arrow sink api
+**
+** Purpose:
+** 	Create an Arrow IPC stream sink. Streams are opened as tables are
+** 	first seen.
+**
+** Parameters:
+** 	prefix		- Path prefix of the stream files.
+** 	sink		- Set to the new sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a malloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_arrow_open(CS_CHAR *prefix, LT_SINK **sink)
+{
+	LT_ARROW_SINK	*as;
+
+	as = (LT_ARROW_SINK *)calloc(1, sizeof (LT_ARROW_SINK));
+	if (as == NULL || (as->prefix = strdup(prefix)) == NULL)
+	{
+		ex_error("lt_arrow_open: malloc() failed");
+		free(as);
+		return CS_MEM_ERROR;
+	}
+
+	as->sink.name = "arrow";
+	as->sink.write = lt_arrow_write;
+	as->sink.close = lt_arrow_close;
+	as->sink.ctx = as;
+	*sink = &as->sink;
+	return CS_SUCCEED;
+}
@@ -0,0 +1,82 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	Arrow IPC stream sink in ltarrow.c.
+**
+*/
+
+#ifndef __LTARROW_H__
+#define __LTARROW_H__
+
+#include "ltbatch.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** Arrow physical types the server datatypes are mapped to.
+*/
+#define LT_ARROW_UTF8		1
+#define LT_ARROW_INT		2
+#define LT_ARROW_FLOAT		3
+#define LT_ARROW_BOOL		4
+#define LT_ARROW_TIMESTAMP	5
+
+/*
+** Number of metadata columns leading every table's schema: operation,
+** transaction id, log position and commit time.
+*/
+#define LT_ARROW_METACOLS	4
+
+/*
+** One column being accumulated. 'validity' is the validity bitmap and
+** 'values' the value buffer, or the value bitmap of a boolean column;
+** 'offsets' holds the value offsets of a string column.
+*/
+typedef struct _lt_arrow_col
+{
+	CS_CHAR		*name;
+	CS_INT		type;
+	CS_INT		width;
+	CS_BOOL		is_signed;
+	LT_BUF		validity;
+	LT_BUF		values;
+	LT_BUF		offsets;
+	CS_INT		nulls;
+} LT_ARROW_COL;
+
+/*
+** The stream of one table, found by the dictionary ids of its owner and
+** name. Its schema is set from the first change seen for the table;
+** changes that do not match it are skipped.
+*/
+typedef struct _lt_arrow_table
+{
+	CS_UINT			ownerid;
+	CS_UINT			tableid;
+	CS_CHAR			*owner;
+	CS_CHAR			*table;
+	int			fd;
+	CS_INT			ncols;
+	LT_ARROW_COL		*cols;
+	CS_INT			nrows;
+	CS_UBIGINT		skipped;
+	struct _lt_arrow_table	*next;
+} LT_ARROW_TABLE;
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltarrow.c */
+extern CS_RETCODE CS_PUBLIC lt_arrow_open(
+	CS_CHAR *prefix,
+	LT_SINK **sink
+	);
+
+#endif /* __LTARROW_H__ */
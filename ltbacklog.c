@@ -0,0 +1,388 @@
+/*
+** Description
+** -----------
+** 	This file estimates the backlog of the scan: the log between the
+** 	position it has scanned to and the end of the log, and how long it
+** 	will take to catch up. The scan thread polls the estimator before
+** 	each scan, and every 'interval' seconds it reads the end of the log
+** 	through a probe the caller provides, which queries the server over
+** 	the scan's own connection; Client-Library is only ever called from
+** 	that one thread. The scan reports the page it has reached after
+** 	each scan.
+**
+** 	The backlog is the distance in page ids, taken to grow along the
+** 	log. Once the log wraps onto pages freed by truncation they do not,
+** 	and such probes are left out. The rates at which the scan goes
+** 	through the log and the log grows are taken between probes, and
+** 	averaged with a weight of LT_BACKLOG_WEIGHT for the latest; the
+** 	scan catches up at the difference.
+**
+** 	The backlog calls for the catch-up tuning once it reaches 'catchup'
+** 	pages, and for the low latency tuning again once it is down to
+** 	'latency' pages; in between, the tuning stays as it was.
+**
+** 	The estimator is optional: until lt_backlog_start() is called the
+** 	low latency tuning is called for and there is no estimate.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltbatch.h"
+#include "lthist.h"
+#include "ltmetrics.h"
+#include "ltbacklog.h"
+
+/*
+** The estimator, used by the scan thread alone. 'lastprobe' is when the
+** end of the log was last probed. 'valid' is set once there is an
+** estimate, 'rated' once it has rates.
+*/
+CS_STATIC struct
+{
+	CS_BOOL			started;
+	LT_BACKLOG_PROBE	probe;
+	CS_VOID			*ctx;
+	CS_INT			interval;
+	CS_INT			catchup;
+	CS_INT			latency;
+	CS_UINT			scanpage;
+	CS_INT			mode;
+	CS_BOOL			valid;
+	CS_BOOL			rated;
+	LT_BACKLOG_EST		est;
+	CS_BIGINT		lasttime;
+	CS_UINT			lastend;
+	CS_UINT			lastscan;
+	time_t			lastprobe;
+} Lt_backlog;
+
+/*
+** Metrics of the estimate.
+*/
+CS_STATIC LT_METRIC	Lt_backlog_pages;
+CS_STATIC LT_METRIC	Lt_backlog_bytes;
+CS_STATIC LT_METRIC	Lt_backlog_scanrate;
+CS_STATIC LT_METRIC	Lt_backlog_growth;
+CS_STATIC LT_METRIC	Lt_backlog_eta;
+CS_STATIC LT_METRIC	Lt_backlog_mode;
+CS_STATIC LT_METRIC	Lt_backlog_errors;
+
+/*****************************************************************************
+**
+** private functions
+**
+*****************************************************************************/
+
+/*
+** lt_backlog_rate()
+**
+** Type of function:
+** 	backlog estimator internal api
+**
+** Purpose:
+** 	Fold the rate between the last two probes into an average rate.
+**
+** Parameters:
+** 	rate		- The average rate.
+** 	sample		- The rate between the last two probes.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_backlog_rate(double *rate, double sample)
+{
+	*rate = Lt_backlog.rated ? LT_BACKLOG_WEIGHT * sample +
+		(1 - LT_BACKLOG_WEIGHT) * *rate : sample;
+}
+
+/*
+** lt_backlog_update()
+**
+** Type of function:
+** 	backlog estimator internal api
+**
+** Purpose:
+** 	Estimate the backlog from a probe of the end of the log.
+**
+** Parameters:
+** 	endpage		- The page at the end of the log.
+** 	pagesize	- The bytes of a log page.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_backlog_update(CS_UINT endpage, CS_INT pagesize)
+{
+	LT_BACKLOG_EST	*est = &Lt_backlog.est;
+	CS_UINT		scanpage;
+	CS_BIGINT	now;
+	double		secs;
+	double		net;
+
+	now = lt_clock_usec();
+	scanpage = Lt_backlog.scanpage;
+	if (scanpage == 0 || endpage < scanpage)
+	{
+		Lt_backlog.lasttime = 0;
+		return;
+	}
+
+	if (Lt_backlog.lasttime != 0 && now > Lt_backlog.lasttime &&
+	    endpage >= Lt_backlog.lastend && scanpage >= Lt_backlog.lastscan)
+	{
+		secs = (now - Lt_backlog.lasttime) / 1000000.0;
+		lt_backlog_rate(&est->scanrate,
+				(scanpage - Lt_backlog.lastscan) / secs);
+		lt_backlog_rate(&est->growth,
+				(endpage - Lt_backlog.lastend) / secs);
+		Lt_backlog.rated = CS_TRUE;
+	}
+	Lt_backlog.lasttime = now;
+	Lt_backlog.lastend = endpage;
+	Lt_backlog.lastscan = scanpage;
+
+	est->endpage = endpage;
+	est->pages = endpage - scanpage;
+	est->bytes = est->pages * pagesize;
+	net = est->scanrate - est->growth;
+	if (est->pages == 0)
+	{
+		est->eta = 0;
+	}
+	else
+	{
+		est->eta = (Lt_backlog.rated && net > 0) ?
+			(CS_BIGINT)(est->pages / net) : -1;
+	}
+	if (est->pages >= Lt_backlog.catchup)
+	{
+		est->mode = LT_BACKLOG_CATCHUP;
+	}
+	else if (est->pages <= Lt_backlog.latency)
+	{
+		est->mode = LT_BACKLOG_LATENCY;
+	}
+	Lt_backlog.valid = CS_TRUE;
+	Lt_backlog.mode = est->mode;
+
+	LT_METRIC_SET(&Lt_backlog_pages, est->pages);
+	LT_METRIC_SET(&Lt_backlog_bytes, est->bytes);
+	LT_METRIC_SET(&Lt_backlog_scanrate, est->scanrate * 1000);
+	LT_METRIC_SET(&Lt_backlog_growth, est->growth * 1000);
+	LT_METRIC_SET(&Lt_backlog_eta, est->eta);
+	LT_METRIC_SET(&Lt_backlog_mode, est->mode);
+}
+
+/*****************************************************************************
+**
+** public functions
+**
+*****************************************************************************/
+
+/*
+** lt_backlog_start()
+**
+** Type of function:
+** 	backlog estimator api
+**
+** Purpose:
+** 	Register the metrics of the estimate and start probing the end of
+** 	the log, at the next poll.
+**
+** Parameters:
+** 	probe		- The probe of the end of the log.
+** 	ctx		- The probe's own state.
+** 	interval	- Seconds between probes.
+** 	catchup		- Pages of backlog from which the catch-up tuning
+** 			  is called for.
+** 	latency		- Pages of backlog up to which the low latency
+** 			  tuning is called for again.
+**
+** Returns:
+** 	CS_SUCCEED
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_backlog_start(LT_BACKLOG_PROBE probe, CS_VOID *ctx, CS_INT interval,
+		 CS_INT catchup, CS_INT latency)
+{
+	if (Lt_backlog.started)
+	{
+		return CS_SUCCEED;
+	}
+	Lt_backlog.probe = probe;
+	Lt_backlog.ctx = ctx;
+	Lt_backlog.interval = MAX(interval, 1);
+	Lt_backlog.catchup = catchup;
+	Lt_backlog.latency = latency;
+	Lt_backlog.lastprobe = 0;
+
+	lt_metrics_gauge(&Lt_backlog_pages, "lt_log_backlog_pages",
+			 "Log pages between the scan position and the end of the log.",
+			 NULL, "backlog_pages", 1);
+	lt_metrics_gauge(&Lt_backlog_bytes, "lt_log_backlog_bytes",
+			 "Bytes of log between the scan position and the end of the log.",
+			 NULL, NULL, 1);
+	lt_metrics_gauge(&Lt_backlog_scanrate, "lt_log_scan_pages_per_second",
+			 "Log pages the scan goes through per second.",
+			 NULL, NULL, 1000);
+	lt_metrics_gauge(&Lt_backlog_growth, "lt_log_growth_pages_per_second",
+			 "Log pages appended to the log per second.",
+			 NULL, NULL, 1000);
+	lt_metrics_gauge(&Lt_backlog_eta, "lt_catchup_eta_seconds",
+			 "Time for the scan to reach the end of the log, or -1 if it is not gaining on it.",
+			 NULL, "eta_s", 1);
+	lt_metrics_gauge(&Lt_backlog_mode, "lt_catchup_mode",
+			 "1 while the backlog calls for the catch-up tuning, 0 for low latency.",
+			 NULL, NULL, 1);
+	lt_metrics_counter(&Lt_backlog_errors, "lt_errors_total",
+			   "Errors, by the stage they stopped.",
+			   "stage=\"backlog\"", "errors");
+
+	Lt_backlog.started = CS_TRUE;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_backlog_stop()
+**
+** Type of function:
+** 	backlog estimator api
+**
+** Purpose:
+** 	Stop probing the end of the log. The last estimate is kept.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_backlog_stop(CS_VOID)
+{
+	Lt_backlog.started = CS_FALSE;
+}
+
+/*
+** lt_backlog_poll()
+**
+** Type of function:
+** 	backlog estimator api
+**
+** Purpose:
+** 	Probe the end of the log and update the estimate, if 'interval'
+** 	seconds have passed since the last probe. Called by the scan thread
+** 	between scans, while the connection the probe uses is idle.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure code of the probe.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_backlog_poll(CS_VOID)
+{
+	CS_UINT		endpage;
+	CS_INT		pagesize;
+	CS_RETCODE	retcode;
+	time_t		now;
+
+	now = time(NULL);
+	if (!Lt_backlog.started || ((Lt_backlog.lastprobe != 0) &&
+	    (now - Lt_backlog.lastprobe < Lt_backlog.interval)))
+	{
+		return CS_SUCCEED;
+	}
+	Lt_backlog.lastprobe = now;
+
+	if ((retcode = Lt_backlog.probe(Lt_backlog.ctx, &endpage,
+					&pagesize)) != CS_SUCCEED)
+	{
+		LT_METRIC_ADD(&Lt_backlog_errors, 1);
+		return retcode;
+	}
+	lt_backlog_update(endpage, pagesize);
+	return CS_SUCCEED;
+}
+
+/*
+** lt_backlog_scanned()
+**
+** Type of function:
+** 	backlog estimator api
+**
+** Purpose:
+** 	Report the page the scan has reached.
+**
+** Parameters:
+** 	page		- The page of the last log record scanned.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_backlog_scanned(CS_UINT page)
+{
+	Lt_backlog.scanpage = page;
+}
+
+/*
+** lt_backlog_mode()
+**
+** Type of function:
+** 	backlog estimator api
+**
+** Purpose:
+** 	Get the tuning the backlog calls for.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	LT_BACKLOG_LATENCY or LT_BACKLOG_CATCHUP.
+*/
+
+CS_INT CS_PUBLIC
+lt_backlog_mode(CS_VOID)
+{
+	return Lt_backlog.mode;
+}
+
+/*
+** lt_backlog_estimate()
+**
+** Type of function:
+** 	backlog estimator api
+**
+** Purpose:
+** 	Get the latest estimate of the backlog.
+**
+** Parameters:
+** 	est		- Set to the estimate.
+**
+** Returns:
+** 	CS_TRUE, or CS_FALSE if there is no estimate yet.
+*/
+
+CS_BOOL CS_PUBLIC
+lt_backlog_estimate(LT_BACKLOG_EST *est)
+{
+	*est = Lt_backlog.est;
+	return Lt_backlog.valid;
+}
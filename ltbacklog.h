@@ -0,0 +1,86 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the log
+** 	backlog estimator in ltbacklog.c.
+**
+*/
+
+#ifndef __LTBACKLOG_H__
+#define __LTBACKLOG_H__
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** The tuning the backlog calls for: low latency while the scan keeps up
+** with the log, catch-up while it is far behind.
+*/
+#define LT_BACKLOG_LATENCY	0
+#define LT_BACKLOG_CATCHUP	1
+
+/*
+** Weight of the latest probe in the rates.
+*/
+#define LT_BACKLOG_WEIGHT	0.5
+
+/*
+** A probe of the end of the log. It sets 'endpage' to the page at the end
+** of the log and 'pagesize' to the bytes of a log page, and returns
+** CS_SUCCEED, or a failure code if the end could not be read. 'ctx' is
+** the probe's own state.
+*/
+typedef CS_RETCODE (*LT_BACKLOG_PROBE)(CS_VOID *ctx, CS_UINT *endpage,
+				       CS_INT *pagesize);
+
+/*
+** An estimate of the backlog. 'pages' and 'bytes' are the log between the
+** scan position and 'endpage', the end of the log; 'scanrate' and 'growth'
+** are the pages per second the scan goes through and the log grows by;
+** 'eta' is the seconds the scan takes to reach the end at those rates, or
+** -1 if it is not gaining on it. 'mode' is the tuning called for.
+*/
+typedef struct _lt_backlog_est
+{
+	CS_UINT		endpage;
+	CS_BIGINT	pages;
+	CS_BIGINT	bytes;
+	double		scanrate;
+	double		growth;
+	CS_BIGINT	eta;
+	CS_INT		mode;
+} LT_BACKLOG_EST;
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltbacklog.c */
+extern CS_RETCODE CS_PUBLIC lt_backlog_start(
+	LT_BACKLOG_PROBE probe,
+	CS_VOID *ctx,
+	CS_INT interval,
+	CS_INT catchup,
+	CS_INT latency
+	);
+extern CS_VOID CS_PUBLIC lt_backlog_stop(
+	CS_VOID
+	);
+extern CS_RETCODE CS_PUBLIC lt_backlog_poll(
+	CS_VOID
+	);
+extern CS_VOID CS_PUBLIC lt_backlog_scanned(
+	CS_UINT page
+	);
+extern CS_INT CS_PUBLIC lt_backlog_mode(
+	CS_VOID
+	);
+extern CS_BOOL CS_PUBLIC lt_backlog_estimate(
+	LT_BACKLOG_EST *est
+	);
+
+#endif /* __LTBACKLOG_H__ */
@@ -0,0 +1,461 @@
+/*
+** Description
+** -----------
+** 	This file gathers committed transactions into output batches, so a
+** 	sink is called once per batch rather than once per transaction. A
+** 	batch closes when it reaches a number of transactions, a number of
+** 	bytes of changes, or a maximum delay since its first transaction.
+**
+** 	The delay is checked whenever a transaction is added and whenever
+** 	the caller polls, which the scan does between result sets; a batch
+** 	can therefore stay open past its delay while no row arrives, for up
+** 	to the time a scan waits for the log to grow.
+**
+** 	A batch the sink fails to write is kept, whole, to be written again
+** 	by the next flush; the transactions added meanwhile join it.
+**
+** 	Optionally, a batch is compacted as it closes: the changes of all
+** 	its transactions are folded into their net effect per row by
+** 	ltcompact.c, and written as one transaction. This saves the
+** 	consumers the rows changed and changed back within a batch, at the
+** 	cost of the transaction boundaries inside it.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltbatch.h"
+#include "ltdurable.h"
+#include "ltdict.h"
+#include "lthist.h"
+#include "ltmetrics.h"
+#include "ltlag.h"
+#include "lttrace.h"
+
+/*
+** Metrics of the batches written, and of the sink failing to.
+*/
+CS_STATIC LT_METRIC	Lt_batch_written;
+CS_STATIC LT_METRIC	Lt_batch_xacts;
+CS_STATIC LT_METRIC	Lt_batch_bytes;
+CS_STATIC LT_METRIC	Lt_batch_errors;
+
+/*****************************************************************************
+**
+** batch functions
+**
+*****************************************************************************/
+
+/*
+** lt_clock_usec()
+**
+** Type of function:
+** 	group-commit batching api
+**
+** Purpose:
+** 	Read the monotonic clock.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Microseconds since an arbitrary fixed point.
+*/
+
+CS_BIGINT CS_PUBLIC
+lt_clock_usec(CS_VOID)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (CS_BIGINT)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+** lt_batch_due()
+**
+** Type of function:
+** 	group-commit batching internal api
+**
+** Purpose:
+** 	Tell whether the open batch has been open for the maximum delay.
+**
+** Parameters:
+** 	batcher		- Pointer to the group-commit state.
+**
+** Returns:
+** 	CS_TRUE or CS_FALSE.
+*/
+
+CS_STATIC CS_BOOL
+lt_batch_due(LT_BATCHER *batcher)
+{
+	return (batcher->batch.nxacts > 0 && batcher->maxdelay > 0 &&
+		lt_clock_usec() - batcher->opened >=
+		(CS_BIGINT)batcher->maxdelay * 1000);
+}
+
+/*
+** lt_batch_compact()
+**
+** Type of function:
+** 	group-commit batching internal api
+**
+** Purpose:
+** 	Fold the transactions of the open batch into one, holding the net
+** 	effect of their changes. The BEGINXACT, capture time and user are
+** 	those of the first transaction, or no user if they differ, and the
+** 	commit those of the last.
+**
+** Parameters:
+** 	batcher		- Pointer to the group-commit state.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a realloc failed, or CS_FAIL if a
+** 	change is malformed; the batch is left as it was on failure.
+*/
+
+CS_STATIC CS_RETCODE
+lt_batch_compact(LT_BATCHER *batcher)
+{
+	LT_BATCH	*batch = &batcher->batch;
+	LT_BATCH_XACT	*first = &batch->xacts[0];
+	LT_BATCH_XACT	*last = &batch->xacts[batch->nxacts - 1];
+	LT_BUF		tmp;
+	CS_RETCODE	retcode;
+	CS_INT		nchanges;
+	CS_INT		i;
+
+	batcher->net.len = 0;
+	retcode = lt_compact_run(batcher->compact, &batch->changes,
+		&batcher->net, &nchanges);
+	if (retcode != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	for (i = 1; i < batch->nxacts; i++)
+	{
+		if (batch->xacts[i].userid != first->userid)
+		{
+			first->userid = 0;
+		}
+	}
+	first->commitpos = last->commitpos;
+	first->committime = last->committime;
+	first->offset = 0;
+	first->len = batcher->net.len;
+	first->nchanges = nchanges;
+	batch->nxacts = 1;
+	batch->nchanges = nchanges;
+
+	tmp = batch->changes;
+	batch->changes = batcher->net;
+	batcher->net = tmp;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_batch_init()
+**
+** Type of function:
+** 	group-commit batching api
+**
+** Purpose:
+** 	Initialize the group-commit state. A limit of 0 or less is not
+** 	applied.
+**
+** Parameters:
+** 	batcher		- Pointer to the group-commit state.
+** 	sink		- The sink batches are written to.
+** 	maxxacts	- Transactions after which a batch closes.
+** 	maxbytes	- Bytes of changes after which a batch closes.
+** 	maxdelay	- Milliseconds after which a batch closes.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_batch_init(LT_BATCHER *batcher, LT_SINK *sink, CS_INT maxxacts,
+	      CS_INT maxbytes, CS_INT maxdelay)
+{
+	memset(batcher, 0, sizeof (*batcher));
+	batcher->sink = sink;
+	batcher->maxxacts = maxxacts;
+	batcher->maxbytes = maxbytes;
+	batcher->maxdelay = maxdelay;
+
+	lt_metrics_counter(&Lt_batch_written, "lt_batches_written_total",
+			   "Batches written to the output sink.", NULL, "batches");
+	lt_metrics_counter(&Lt_batch_xacts, "lt_output_transactions_total",
+			   "Transactions written to the output sink.", NULL, NULL);
+	lt_metrics_counter(&Lt_batch_bytes, "lt_output_bytes_total",
+			   "Bytes of encoded changes written to the output sink.",
+			   NULL, "out_bytes");
+	lt_metrics_counter(&Lt_batch_errors, "lt_errors_total",
+			   "Errors, by the stage they stopped.",
+			   "stage=\"output\"", "errors");
+}
+
+/*
+** lt_batch_add()
+**
+** Type of function:
+** 	group-commit batching api
+**
+** Purpose:
+** 	Add a committed transaction to the open batch, stamped with its
+** 	capture time, and write the batch if that closes it.
+**
+** Parameters:
+** 	batcher		- Pointer to the group-commit state.
+** 	xactid		- The transaction's BEGINXACT position.
+** 	commitpos	- The transaction's ENDXACT position.
+** 	committime	- The commit time, in microseconds since the epoch.
+** 	userid		- Id of the transaction's user name, or 0.
+** 	changes		- The transaction's encoded changes.
+** 	nchanges	- The number of changes.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a realloc failed, or the failure code
+** 	of the sink.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_batch_add(LT_BATCHER *batcher, CS_UBIGINT xactid, CS_UBIGINT commitpos,
+	     CS_BIGINT committime, CS_UINT userid, LT_BUF *changes,
+	     CS_INT nchanges)
+{
+	LT_BATCH	*batch = &batcher->batch;
+	LT_BATCH_XACT	*bx;
+	CS_RETCODE	retcode;
+	CS_INT		max;
+
+	if (batch->nxacts == batch->maxxacts)
+	{
+		max = (batch->maxxacts == 0) ? 64 : batch->maxxacts * 2;
+		bx = (LT_BATCH_XACT *)realloc(batch->xacts,
+			max * sizeof (LT_BATCH_XACT));
+		if (bx == NULL)
+		{
+			ex_error("lt_batch_add: realloc() failed");
+			return CS_MEM_ERROR;
+		}
+		batch->xacts = bx;
+		batch->maxxacts = max;
+	}
+
+	bx = &batch->xacts[batch->nxacts];
+	bx->xactid = xactid;
+	bx->commitpos = commitpos;
+	bx->committime = committime;
+	lt_lag_captured(bx);
+	bx->userid = userid;
+	bx->offset = batch->changes.len;
+	bx->len = changes->len;
+	bx->nchanges = nchanges;
+	if (changes->len > 0 && (retcode = lt_buf_append(&batch->changes,
+			changes->data, changes->len)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	if (batch->nxacts++ == 0)
+	{
+		batcher->opened = lt_clock_usec();
+	}
+	batch->nchanges += nchanges;
+	batch->lastpos = commitpos;
+
+	if ((batcher->maxxacts > 0 && batch->nxacts >= batcher->maxxacts) ||
+	    (batcher->maxbytes > 0 && batch->changes.len >= batcher->maxbytes) ||
+	    lt_batch_due(batcher))
+	{
+		return lt_batch_flush(batcher);
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_batch_poll()
+**
+** Type of function:
+** 	group-commit batching api
+**
+** Purpose:
+** 	Write the open batch if it has been open for the maximum delay, and
+** 	poll the sink.
+**
+** Parameters:
+** 	batcher		- Pointer to the group-commit state.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure code of the sink.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_batch_poll(LT_BATCHER *batcher)
+{
+	CS_RETCODE	retcode;
+
+	if (batcher->sink != NULL && batcher->sink->poll != NULL &&
+	    (retcode = batcher->sink->poll(batcher->sink)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	if (!lt_batch_due(batcher))
+	{
+		return CS_SUCCEED;
+	}
+	return lt_batch_flush(batcher);
+}
+
+/*
+** lt_batch_flush()
+**
+** Type of function:
+** 	group-commit batching api
+**
+** Purpose:
+** 	Close the open batch, if any, compacting it if set to, and write it
+** 	to the sink. Once it is written its transactions are stamped with
+** 	their emission time, and the batch is emptied; if the sink fails it
+** 	is kept for the next flush to retry.
+**
+** Parameters:
+** 	batcher		- Pointer to the group-commit state.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure code of the sink.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_batch_flush(LT_BATCHER *batcher)
+{
+	LT_BATCH	*batch = &batcher->batch;
+	CS_RETCODE	retcode = CS_SUCCEED;
+	CS_BIGINT	start;
+
+	if (batch->nxacts == 0)
+	{
+		return CS_SUCCEED;
+	}
+	start = lt_clock_usec();
+
+	if (batcher->compact != NULL && batch->nxacts > 1)
+	{
+		retcode = lt_batch_compact(batcher);
+	}
+
+	/*
+	** The names the batch refers to go out ahead of it.
+	*/
+	if (retcode == CS_SUCCEED && batcher->sink != NULL &&
+	    (retcode = lt_dict_flush()) == CS_SUCCEED)
+	{
+		LT_TRACE_BEGIN(sink, batch->nxacts);
+		retcode = batcher->sink->write(batcher->sink, batch);
+		LT_TRACE_END(sink, retcode);
+	}
+	if (retcode == CS_SUCCEED)
+	{
+		batcher->written = batch->lastpos;
+		batcher->nbatches++;
+		LT_METRIC_ADD(&Lt_batch_written, 1);
+		LT_METRIC_ADD(&Lt_batch_xacts, batch->nxacts);
+		LT_METRIC_ADD(&Lt_batch_bytes, batch->changes.len);
+		lt_lag_emitted(batch);
+
+		/*
+		** A sink writing in the background has written the batch only
+		** once it has synced; until then it counts as bytes only, as
+		** it always does for a sink keeping it in memory.
+		*/
+		lt_durable_written((batcher->sink == NULL ||
+				    (batcher->sink->sync == NULL &&
+				     !batcher->sink->inmemory)) ? batch->lastpos : 0,
+				   batch->changes.len);
+	}
+	else
+	{
+		LT_METRIC_ADD(&Lt_batch_errors, 1);
+		batcher->busy += lt_clock_usec() - start;
+		return retcode;
+	}
+	batcher->busy += lt_clock_usec() - start;
+
+	batch->changes.len = 0;
+	batch->nxacts = 0;
+	batch->nchanges = 0;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_batch_sync()
+**
+** Type of function:
+** 	group-commit batching api
+**
+** Purpose:
+** 	Write the open batch, if any, and wait until the sink has written
+** 	out every batch it was given.
+**
+** Parameters:
+** 	batcher		- Pointer to the group-commit state.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure code of the sink.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_batch_sync(LT_BATCHER *batcher)
+{
+	CS_RETCODE	retcode;
+
+	if ((retcode = lt_batch_flush(batcher)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	if (batcher->sink != NULL && batcher->sink->sync != NULL)
+	{
+		if ((retcode = batcher->sink->sync(batcher->sink)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+		lt_durable_written(batcher->written, 0);
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_batch_cleanup()
+**
+** Type of function:
+** 	group-commit batching api
+**
+** Purpose:
+** 	Release the memory held by the group-commit state. The open batch
+** 	is discarded; flush it first to keep it.
+**
+** Parameters:
+** 	batcher		- Pointer to the group-commit state.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_batch_cleanup(LT_BATCHER *batcher)
+{
+	lt_buf_free(&batcher->batch.changes);
+	free(batcher->batch.xacts);
+	memset(&batcher->batch, 0, sizeof (batcher->batch));
+	lt_buf_free(&batcher->net);
+}
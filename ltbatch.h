@@ -0,0 +1,156 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	group-commit batching of committed transactions in ltbatch.c, and
+** 	the output sink interface batches are written through.
+**
+*/
+
+#ifndef __LTBATCH_H__
+#define __LTBATCH_H__
+
+#include "ltchange.h"
+#include "ltcompact.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** One committed transaction in a batch. Its changes are the 'len' bytes
+** at 'offset' in the batch's change buffer. 'commitpos' is the position of
+** the ENDXACT record and 'committime' the commit time from it, in
+** microseconds since the epoch by the server's clock, or 0 if unknown.
+** 'capturetime' and 'emittime' are when the transaction was added to the
+** batch and when the batch was written, by our clock corrected to the
+** server's in ltlag.c; 'emittime' is 0 until then. 'userid' is the id of
+** the user name from the BEGINXACT record in the name dictionary of
+** ltdict.c, or 0 if unknown.
+*/
+typedef struct _lt_batch_xact
+{
+	CS_UBIGINT	xactid;
+	CS_UBIGINT	commitpos;
+	CS_BIGINT	committime;
+	CS_BIGINT	capturetime;
+	CS_BIGINT	emittime;
+	CS_UINT		userid;
+	CS_INT		offset;
+	CS_INT		len;
+	CS_INT		nchanges;
+} LT_BATCH_XACT;
+
+/*
+** A batch of committed transactions, in commit order. 'lastpos' is the
+** commit position of the last of them.
+*/
+typedef struct _lt_batch
+{
+	LT_BUF		changes;
+	LT_BATCH_XACT	*xacts;
+	CS_INT		nxacts;
+	CS_INT		maxxacts;
+	CS_INT		nchanges;
+	CS_UBIGINT	lastpos;
+} LT_BATCH;
+
+/*
+** An output sink. 'write' is called once per closed batch and must
+** write it out whole, 'close' once when the program is done with the
+** sink. 'ctx' is the sink's own state.
+**
+** 'poll', 'sync' and 'lowwater' are optional. 'poll' is called whenever
+** the batcher is polled, for a sink with work of its own between batches.
+** 'sync' waits until the batches written to a sink that writes them out
+** in the background are out. 'lowwater' sets the BEGINXACT key of the
+** oldest transaction the sink still holds for its consumers, in scan
+** order from 'base' (see LT_LOGPOS_SCAN in ltxact.h), and returns
+** CS_FALSE if there is none.
+**
+** 'inmemory' is set by a sink that hands the batches to its consumers in
+** memory rather than writing them to files. Its batches are never on
+** disk, so they are left out of the durable position of ltdurable.c, and
+** nothing waits for them to get there.
+*/
+typedef struct _lt_sink
+{
+	CS_CHAR		*name;
+	CS_RETCODE	(*write)(struct _lt_sink *sink, LT_BATCH *batch);
+	CS_RETCODE	(*close)(struct _lt_sink *sink);
+	CS_RETCODE	(*poll)(struct _lt_sink *sink);
+	CS_RETCODE	(*sync)(struct _lt_sink *sink);
+	CS_BOOL		(*lowwater)(struct _lt_sink *sink, CS_UBIGINT base,
+				    CS_UBIGINT *key);
+	CS_BOOL		inmemory;
+	CS_VOID		*ctx;
+} LT_SINK;
+
+/*
+** Group-commit state. The open batch is closed and written to 'sink'
+** once it holds 'maxxacts' transactions or 'maxbytes' bytes of changes,
+** or 'maxdelay' milliseconds after its first transaction was added.
+** 'written' is the commit position of the last batch written, and 'busy'
+** the microseconds spent writing batches to the sink.
+**
+** If 'compact' is set, a batch of several transactions is folded into
+** the net effect of all of them per row before it is written, through
+** 'compact' into 'net', and goes out as a single transaction: its
+** BEGINXACT is that of the first, and its commit that of the last.
+*/
+typedef struct _lt_batcher
+{
+	LT_BATCH	batch;
+	LT_SINK		*sink;
+	CS_INT		maxxacts;
+	CS_INT		maxbytes;
+	CS_INT		maxdelay;
+	CS_BIGINT	opened;
+	CS_UBIGINT	written;
+	CS_UBIGINT	nbatches;
+	CS_BIGINT	busy;
+	LT_COMPACT	*compact;
+	LT_BUF		net;
+} LT_BATCHER;
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltbatch.c */
+extern CS_VOID CS_PUBLIC lt_batch_init(
+	LT_BATCHER *batcher,
+	LT_SINK *sink,
+	CS_INT maxxacts,
+	CS_INT maxbytes,
+	CS_INT maxdelay
+	);
+extern CS_RETCODE CS_PUBLIC lt_batch_add(
+	LT_BATCHER *batcher,
+	CS_UBIGINT xactid,
+	CS_UBIGINT commitpos,
+	CS_BIGINT committime,
+	CS_UINT userid,
+	LT_BUF *changes,
+	CS_INT nchanges
+	);
+extern CS_RETCODE CS_PUBLIC lt_batch_poll(
+	LT_BATCHER *batcher
+	);
+extern CS_RETCODE CS_PUBLIC lt_batch_flush(
+	LT_BATCHER *batcher
+	);
+extern CS_RETCODE CS_PUBLIC lt_batch_sync(
+	LT_BATCHER *batcher
+	);
+extern CS_VOID CS_PUBLIC lt_batch_cleanup(
+	LT_BATCHER *batcher
+	);
+extern CS_BIGINT CS_PUBLIC lt_clock_usec(
+	CS_VOID
+	);
+
+#endif /* __LTBATCH_H__ */
@@ -0,0 +1,651 @@
+/*
+** Description
+** -----------
+** 	This file implements the capture files of scan results. A capture
+** 	holds, for each scan command, the results ct_results() returned,
+** 	the column descriptions of the fetchable ones and their rows in
+** 	the native form the server sent them, laid out as described in
+** 	ltcapture.h. A capture is written through a buffer flushed at the
+** 	end of each scan, so recording costs the scan a copy of each row,
+** 	and read mapped into memory, so it can be replayed as fast as it
+** 	can be decoded.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltcapture.h"
+
+#define LT_PUT(_p, _v)	(memcpy((_p), &(_v), sizeof (_v)), (_p) += sizeof (_v))
+#define LT_GET(_p, _v)	(memcpy(&(_v), (_p), sizeof (_v)), (_p) += sizeof (_v))
+
+/*****************************************************************************
+**
+** private functions
+**
+*****************************************************************************/
+
+/*
+** lt_capture_put()
+**
+** Type of function:
+** 	capture file internal api
+**
+** Purpose:
+** 	Start a record in the buffer of a capture being written, making
+** 	room for its payload.
+**
+** Parameters:
+** 	out		- The capture.
+** 	type		- The record type.
+** 	len		- Length of the payload.
+**
+** Returns:
+** 	Where to write the payload, or NULL if a realloc failed.
+*/
+
+CS_STATIC CS_BYTE *
+lt_capture_put(LT_CAPTURE_OUT *out, CS_INT type, CS_INT len)
+{
+	CS_BYTE		*p;
+	CS_UINT		u32 = (CS_UINT)len;
+	CS_USMALLINT	u16 = (CS_USMALLINT)type;
+	CS_USMALLINT	unused = 0;
+
+	if (lt_buf_reserve(&out->buf, LT_CAPTURE_HDRLEN + len) != CS_SUCCEED)
+	{
+		return NULL;
+	}
+	p = out->buf.data + out->buf.len;
+	LT_PUT(p, u32);
+	LT_PUT(p, u16);
+	LT_PUT(p, unused);
+	out->buf.len += LT_CAPTURE_HDRLEN + len;
+	return p;
+}
+
+/*****************************************************************************
+**
+** public functions
+**
+*****************************************************************************/
+
+/*
+** lt_capture_map()
+**
+** Type of function:
+** 	capture file api
+**
+** Purpose:
+** 	Map a capture file for reading, positioned at its first record.
+**
+** Parameters:
+** 	path		- Path of the file.
+** 	cap		- The capture to set up.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the file could not be mapped or is not
+** 	a capture file.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_capture_map(CS_CHAR *path, LT_CAPTURE *cap)
+{
+	struct stat	st;
+	CS_UINT		magic;
+	int		fd;
+
+	memset(cap, 0, sizeof (LT_CAPTURE));
+	if ((fd = open(path, O_RDONLY)) < 0)
+	{
+		ex_error("lt_capture_map: open() failed");
+		return CS_FAIL;
+	}
+	if (fstat(fd, &st) != 0)
+	{
+		ex_error("lt_capture_map: fstat() failed");
+		close(fd);
+		return CS_FAIL;
+	}
+	if (st.st_size < (off_t)sizeof (magic))
+	{
+		ex_error("lt_capture_map: not a capture file");
+		close(fd);
+		return CS_FAIL;
+	}
+	cap->data = (CS_BYTE *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+				    fd, 0);
+	close(fd);
+	if (cap->data == (CS_BYTE *)MAP_FAILED)
+	{
+		ex_error("lt_capture_map: mmap() failed");
+		cap->data = NULL;
+		return CS_FAIL;
+	}
+	cap->len = st.st_size;
+	memcpy(&magic, cap->data, sizeof (magic));
+	if (magic != LT_CAPTURE_MAGIC)
+	{
+		ex_error("lt_capture_map: not a capture file");
+		lt_capture_unmap(cap);
+		return CS_FAIL;
+	}
+	madvise(cap->data, cap->len, MADV_SEQUENTIAL);
+	cap->off = sizeof (magic);
+	return CS_SUCCEED;
+}
+
+/*
+** lt_capture_unmap()
+**
+** Type of function:
+** 	capture file api
+**
+** Purpose:
+** 	Unmap a capture file. Does nothing if it is not mapped.
+**
+** Parameters:
+** 	cap		- The capture.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_capture_unmap(LT_CAPTURE *cap)
+{
+	if (cap->data != NULL)
+	{
+		munmap(cap->data, cap->len);
+	}
+	memset(cap, 0, sizeof (LT_CAPTURE));
+}
+
+/*
+** lt_capture_next()
+**
+** Type of function:
+** 	capture file api
+**
+** Purpose:
+** 	Read the next record of a capture. The payload is left in the
+** 	mapping, and stays valid until the capture is unmapped.
+**
+** Parameters:
+** 	cap		- The capture.
+** 	rec		- Set to the record.
+**
+** Returns:
+** 	CS_SUCCEED, CS_END_DATA at the end of the capture, or CS_FAIL if
+** 	its last record is incomplete.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_capture_next(LT_CAPTURE *cap, LT_CAPTURE_REC *rec)
+{
+	CS_BYTE		*p;
+	CS_UINT		len;
+	CS_USMALLINT	type;
+
+	if (cap->off >= cap->len)
+	{
+		return CS_END_DATA;
+	}
+	if (cap->len - cap->off < LT_CAPTURE_HDRLEN)
+	{
+		ex_error("lt_capture_next: incomplete record");
+		return CS_FAIL;
+	}
+	p = cap->data + cap->off;
+	LT_GET(p, len);
+	LT_GET(p, type);
+	if (len > 0x7fffffff ||
+	    (CS_BIGINT)len > cap->len - cap->off - LT_CAPTURE_HDRLEN)
+	{
+		ex_error("lt_capture_next: incomplete record");
+		return CS_FAIL;
+	}
+	rec->type = type;
+	rec->data = cap->data + cap->off + LT_CAPTURE_HDRLEN;
+	rec->len = (CS_INT)len;
+	cap->off += LT_CAPTURE_HDRLEN + len;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_capture_result()
+**
+** Type of function:
+** 	capture file api
+**
+** Purpose:
+** 	Decode the result type, message id and number of columns of a
+** 	result record.
+**
+** Parameters:
+** 	rec		- The record.
+** 	restype		- Set to the result type.
+** 	msgid		- Set to the message id.
+** 	numcols		- Set to the number of columns.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the record is malformed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_capture_result(LT_CAPTURE_REC *rec, CS_INT *restype, CS_INT *msgid,
+		  CS_INT *numcols)
+{
+	CS_BYTE		*p = rec->data;
+
+	if (rec->type != LT_CAPTURE_RESULT || rec->len < LT_CAPTURE_RESULTLEN)
+	{
+		ex_error("lt_capture_result: malformed result record");
+		return CS_FAIL;
+	}
+	LT_GET(p, *restype);
+	LT_GET(p, *msgid);
+	LT_GET(p, *numcols);
+	if (*numcols < 0)
+	{
+		ex_error("lt_capture_result: malformed result record");
+		return CS_FAIL;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_capture_columns()
+**
+** Type of function:
+** 	capture file api
+**
+** Purpose:
+** 	Decode the column descriptions of a result record. Names longer
+** 	than a CS_DATAFMT holds are truncated.
+**
+** Parameters:
+** 	rec		- The record.
+** 	numcols		- The number of columns, as decoded by
+** 			  lt_capture_result().
+** 	datafmt		- Array of 'numcols' descriptions to set.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the record is malformed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_capture_columns(LT_CAPTURE_REC *rec, CS_INT numcols, CS_DATAFMT *datafmt)
+{
+	CS_BYTE		*p = rec->data + LT_CAPTURE_RESULTLEN;
+	CS_BYTE		*end = rec->data + rec->len;
+	CS_INT		namelen;
+	CS_INT		i;
+
+	for (i = 0; i < numcols; i++)
+	{
+		if (end - p < LT_CAPTURE_COLLEN)
+		{
+			ex_error("lt_capture_columns: malformed result record");
+			return CS_FAIL;
+		}
+		memset(&datafmt[i], 0, sizeof (CS_DATAFMT));
+		LT_GET(p, datafmt[i].datatype);
+		LT_GET(p, datafmt[i].format);
+		LT_GET(p, datafmt[i].maxlength);
+		LT_GET(p, datafmt[i].scale);
+		LT_GET(p, datafmt[i].precision);
+		LT_GET(p, datafmt[i].status);
+		LT_GET(p, datafmt[i].usertype);
+		LT_GET(p, namelen);
+		if (namelen < 0 || namelen > end - p)
+		{
+			ex_error("lt_capture_columns: malformed result record");
+			return CS_FAIL;
+		}
+		datafmt[i].namelen = MIN(namelen, CS_MAX_CHAR - 1);
+		memcpy(datafmt[i].name, p, datafmt[i].namelen);
+		datafmt[i].name[datafmt[i].namelen] = '\0';
+		datafmt[i].count = 1;
+		p += namelen;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_capture_row()
+**
+** Type of function:
+** 	capture file api
+**
+** Purpose:
+** 	Decode the column values of a row record. The values point into
+** 	the record.
+**
+** Parameters:
+** 	rec		- The record.
+** 	numcols		- The number of columns of its result.
+** 	values		- Array of 'numcols' values to set.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the record is malformed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_capture_row(LT_CAPTURE_REC *rec, CS_INT numcols, LT_CAPTURE_VALUE *values)
+{
+	CS_BYTE		*p = rec->data;
+	CS_BYTE		*end = rec->data + rec->len;
+	CS_INT		i;
+
+	for (i = 0; i < numcols; i++)
+	{
+		if (end - p < (CS_INT)sizeof (CS_INT))
+		{
+			ex_error("lt_capture_row: malformed row record");
+			return CS_FAIL;
+		}
+		LT_GET(p, values[i].len);
+		values[i].data = p;
+		if (values[i].len == CS_NULLDATA)
+		{
+			continue;
+		}
+		if (values[i].len < 0 || values[i].len > end - p)
+		{
+			ex_error("lt_capture_row: malformed row record");
+			return CS_FAIL;
+		}
+		p += values[i].len;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_capture_create()
+**
+** Type of function:
+** 	capture file api
+**
+** Purpose:
+** 	Create a capture file to write, replacing any file at the path.
+**
+** Parameters:
+** 	path		- Path of the file.
+** 	out		- The capture to set up.
+**
+** Returns:
+** 	CS_SUCCEED, CS_FAIL if the file could not be created, or
+** 	CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_capture_create(CS_CHAR *path, LT_CAPTURE_OUT *out)
+{
+	CS_UINT		magic = LT_CAPTURE_MAGIC;
+
+	memset(out, 0, sizeof (LT_CAPTURE_OUT));
+	if ((out->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+	{
+		ex_error("lt_capture_create: open() failed");
+		return CS_FAIL;
+	}
+	if (lt_buf_append(&out->buf, &magic, sizeof (magic)) != CS_SUCCEED)
+	{
+		close(out->fd);
+		out->fd = -1;
+		return CS_MEM_ERROR;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_capture_put_scan()
+**
+** Type of function:
+** 	capture file api
+**
+** Purpose:
+** 	Write a scan record, starting the results of a scan command.
+**
+** Parameters:
+** 	out		- The capture.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_capture_put_scan(LT_CAPTURE_OUT *out)
+{
+	return (lt_capture_put(out, LT_CAPTURE_SCAN, 0) != NULL) ?
+		CS_SUCCEED : CS_MEM_ERROR;
+}
+
+/*
+** lt_capture_put_result()
+**
+** Type of function:
+** 	capture file api
+**
+** Purpose:
+** 	Write a result record.
+**
+** Parameters:
+** 	out		- The capture.
+** 	restype		- The result type.
+** 	msgid		- The message id of a CS_MSG_RESULT, 0 otherwise.
+** 	numcols		- The number of columns, 0 unless the result is
+** 			  fetchable.
+** 	datafmt		- The descriptions of the columns, as returned by
+** 			  ct_describe().
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_capture_put_result(LT_CAPTURE_OUT *out, CS_INT restype, CS_INT msgid,
+		      CS_INT numcols, CS_DATAFMT *datafmt)
+{
+	CS_BYTE		*p;
+	CS_INT		len = LT_CAPTURE_RESULTLEN;
+	CS_INT		namelen;
+	CS_INT		i;
+
+	for (i = 0; i < numcols; i++)
+	{
+		len += LT_CAPTURE_COLLEN + strlen(datafmt[i].name);
+	}
+	if ((p = lt_capture_put(out, LT_CAPTURE_RESULT, len)) == NULL)
+	{
+		return CS_MEM_ERROR;
+	}
+	LT_PUT(p, restype);
+	LT_PUT(p, msgid);
+	LT_PUT(p, numcols);
+	for (i = 0; i < numcols; i++)
+	{
+		namelen = strlen(datafmt[i].name);
+		LT_PUT(p, datafmt[i].datatype);
+		LT_PUT(p, datafmt[i].format);
+		LT_PUT(p, datafmt[i].maxlength);
+		LT_PUT(p, datafmt[i].scale);
+		LT_PUT(p, datafmt[i].precision);
+		LT_PUT(p, datafmt[i].status);
+		LT_PUT(p, datafmt[i].usertype);
+		LT_PUT(p, namelen);
+		memcpy(p, datafmt[i].name, namelen);
+		p += namelen;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_capture_put_row()
+**
+** Type of function:
+** 	capture file api
+**
+** Purpose:
+** 	Write a row record of the last result written.
+**
+** Parameters:
+** 	out		- The capture.
+** 	numcols		- The number of columns.
+** 	coldata		- The columns, bound in their native formats.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_capture_put_row(LT_CAPTURE_OUT *out, CS_INT numcols,
+		   EX_COLUMN_DATA *coldata)
+{
+	CS_BYTE		*p;
+	CS_INT		len = numcols * sizeof (CS_INT);
+	CS_INT		null = CS_NULLDATA;
+	CS_INT		i;
+
+	for (i = 0; i < numcols; i++)
+	{
+		if ((CS_SMALLINT)coldata[i].indicator != CS_NULLDATA)
+		{
+			len += coldata[i].valuelen;
+		}
+	}
+	if ((p = lt_capture_put(out, LT_CAPTURE_ROW, len)) == NULL)
+	{
+		return CS_MEM_ERROR;
+	}
+	for (i = 0; i < numcols; i++)
+	{
+		if ((CS_SMALLINT)coldata[i].indicator == CS_NULLDATA)
+		{
+			LT_PUT(p, null);
+			continue;
+		}
+		LT_PUT(p, coldata[i].valuelen);
+		memcpy(p, coldata[i].value, coldata[i].valuelen);
+		p += coldata[i].valuelen;
+	}
+	if (out->buf.len >= LT_CAPTURE_FLUSHLEN)
+	{
+		return lt_capture_flush(out);
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_capture_put_end()
+**
+** Type of function:
+** 	capture file api
+**
+** Purpose:
+** 	Write an end record, ending the results of a scan command, and
+** 	flush the capture.
+**
+** Parameters:
+** 	out		- The capture.
+** 	retcode		- The return code that ended the results.
+**
+** Returns:
+** 	CS_SUCCEED, CS_FAIL if the write failed, or CS_MEM_ERROR if a
+** 	realloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_capture_put_end(LT_CAPTURE_OUT *out, CS_RETCODE retcode)
+{
+	CS_BYTE		*p;
+
+	if ((p = lt_capture_put(out, LT_CAPTURE_END, sizeof (retcode))) == NULL)
+	{
+		return CS_MEM_ERROR;
+	}
+	LT_PUT(p, retcode);
+	return lt_capture_flush(out);
+}
+
+/*
+** lt_capture_flush()
+**
+** Type of function:
+** 	capture file api
+**
+** Purpose:
+** 	Write out the buffered records of a capture.
+**
+** Parameters:
+** 	out		- The capture.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the write failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_capture_flush(LT_CAPTURE_OUT *out)
+{
+	CS_INT		off;
+	ssize_t		n;
+
+	for (off = 0; off < out->buf.len; off += n)
+	{
+		n = write(out->fd, out->buf.data + off, out->buf.len - off);
+		if (n < 0 && errno == EINTR)
+		{
+			n = 0;
+		}
+		else if (n <= 0)
+		{
+			ex_error("lt_capture_flush: write() failed");
+			return CS_FAIL;
+		}
+	}
+	out->buf.len = 0;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_capture_close()
+**
+** Type of function:
+** 	capture file api
+**
+** Purpose:
+** 	Flush and close a capture being written.
+**
+** Parameters:
+** 	out		- The capture.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the write or the close failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_capture_close(LT_CAPTURE_OUT *out)
+{
+	CS_RETCODE	retcode;
+
+	retcode = lt_capture_flush(out);
+	if (close(out->fd) != 0 && retcode == CS_SUCCEED)
+	{
+		ex_error("lt_capture_close: close() failed");
+		retcode = CS_FAIL;
+	}
+	lt_buf_free(&out->buf);
+	out->fd = -1;
+	return retcode;
+}
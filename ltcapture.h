@@ -0,0 +1,172 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the scan
+** 	result capture files in ltcapture.c.
+**
+*/
+
+#ifndef __LTCAPTURE_H__
+#define __LTCAPTURE_H__
+
+#include "ltchange.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** A capture file starts with LT_CAPTURE_MAGIC, followed by records laid
+** out as:
+**
+** 	CS_UINT		length of the payload
+** 	CS_USMALLINT	record type
+** 	CS_USMALLINT	unused
+** 	payload
+**
+** in the byte order of the machine that wrote it.
+*/
+#define LT_CAPTURE_MAGIC	0x3143544c	/* "LTC1" */
+#define LT_CAPTURE_HDRLEN	8
+
+/*
+** Record types and their payloads:
+**
+** LT_CAPTURE_SCAN	The start of a scan command's results. No payload.
+**
+** LT_CAPTURE_RESULT	A result returned by ct_results(): the CS_INT result
+** 			type, a CS_INT message id for CS_MSG_RESULT and 0
+** 			otherwise, and the CS_INT number of columns, which is
+** 			0 unless the result is fetchable. Each column follows
+** 			as the CS_INT datatype, format, maxlength, scale,
+** 			precision, status and usertype of its CS_DATAFMT, the
+** 			CS_INT length of its name and the name.
+**
+** LT_CAPTURE_ROW	A row of the last fetchable result. Each column
+** 			follows as its CS_INT length, CS_NULLDATA if it is
+** 			null, and its native bytes.
+**
+** LT_CAPTURE_END	The end of a scan command's results: the CS_RETCODE
+** 			that ended them.
+*/
+#define LT_CAPTURE_SCAN		1
+#define LT_CAPTURE_RESULT	2
+#define LT_CAPTURE_ROW		3
+#define LT_CAPTURE_END		4
+
+#define LT_CAPTURE_RESULTLEN	12
+#define LT_CAPTURE_COLLEN	32
+
+/*
+** A capture being written is flushed once LT_CAPTURE_FLUSHLEN bytes are
+** buffered, and at the end of each scan. Values are recorded up to
+** LT_CAPTURE_MAXBIND bytes long.
+*/
+#define LT_CAPTURE_FLUSHLEN	(1024 * 1024)
+#define LT_CAPTURE_MAXBIND	(1024 * 1024)
+
+/*
+** A capture file mapped for reading. 'off' is the offset of the next
+** record.
+*/
+typedef struct _lt_capture
+{
+	CS_BYTE		*data;
+	CS_BIGINT	len;
+	CS_BIGINT	off;
+} LT_CAPTURE;
+
+/*
+** A capture file being written.
+*/
+typedef struct _lt_capture_out
+{
+	int		fd;
+	LT_BUF		buf;
+} LT_CAPTURE_OUT;
+
+/*
+** One record, 'len' bytes of payload at 'data'.
+*/
+typedef struct _lt_capture_rec
+{
+	CS_INT		type;
+	CS_BYTE		*data;
+	CS_INT		len;
+} LT_CAPTURE_REC;
+
+/*
+** One column value of a row record. 'len' is CS_NULLDATA for a null.
+*/
+typedef struct _lt_capture_value
+{
+	CS_BYTE		*data;
+	CS_INT		len;
+} LT_CAPTURE_VALUE;
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltcapture.c */
+extern CS_RETCODE CS_PUBLIC lt_capture_map(
+	CS_CHAR *path,
+	LT_CAPTURE *cap
+	);
+extern CS_VOID CS_PUBLIC lt_capture_unmap(
+	LT_CAPTURE *cap
+	);
+extern CS_RETCODE CS_PUBLIC lt_capture_next(
+	LT_CAPTURE *cap,
+	LT_CAPTURE_REC *rec
+	);
+extern CS_RETCODE CS_PUBLIC lt_capture_result(
+	LT_CAPTURE_REC *rec,
+	CS_INT *restype,
+	CS_INT *msgid,
+	CS_INT *numcols
+	);
+extern CS_RETCODE CS_PUBLIC lt_capture_columns(
+	LT_CAPTURE_REC *rec,
+	CS_INT numcols,
+	CS_DATAFMT *datafmt
+	);
+extern CS_RETCODE CS_PUBLIC lt_capture_row(
+	LT_CAPTURE_REC *rec,
+	CS_INT numcols,
+	LT_CAPTURE_VALUE *values
+	);
+extern CS_RETCODE CS_PUBLIC lt_capture_create(
+	CS_CHAR *path,
+	LT_CAPTURE_OUT *out
+	);
+extern CS_RETCODE CS_PUBLIC lt_capture_put_scan(
+	LT_CAPTURE_OUT *out
+	);
+extern CS_RETCODE CS_PUBLIC lt_capture_put_result(
+	LT_CAPTURE_OUT *out,
+	CS_INT restype,
+	CS_INT msgid,
+	CS_INT numcols,
+	CS_DATAFMT *datafmt
+	);
+extern CS_RETCODE CS_PUBLIC lt_capture_put_row(
+	LT_CAPTURE_OUT *out,
+	CS_INT numcols,
+	EX_COLUMN_DATA *coldata
+	);
+extern CS_RETCODE CS_PUBLIC lt_capture_put_end(
+	LT_CAPTURE_OUT *out,
+	CS_RETCODE retcode
+	);
+extern CS_RETCODE CS_PUBLIC lt_capture_flush(
+	LT_CAPTURE_OUT *out
+	);
+extern CS_RETCODE CS_PUBLIC lt_capture_close(
+	LT_CAPTURE_OUT *out
+	);
+
+#endif /* __LTCAPTURE_H__ */
@@ -0,0 +1,415 @@
+/*
+** Description
+** -----------
+** 	This file encodes row changes into a compact, self-delimiting
+** 	binary record, and decodes them back without copying.
+**
+** 	A record is laid out as:
+**
+** 		CS_UINT		record length, this header included
+** 		CS_USMALLINT	operation
+** 		CS_USMALLINT	number of columns
+** 		CS_UBIGINT	transaction id (BEGINXACT position)
+** 		CS_UBIGINT	log record position
+** 		CS_UINT		table name id
+** 		CS_UINT		table owner id
+**
+** 	followed by, for each column:
+**
+** 		CS_USMALLINT	column name length
+** 		CS_USMALLINT	unused
+** 		CS_INT		server datatype
+** 		CS_INT		value length, -1 for a null column
+** 		column name, value
+**
+** 	Integers are in host byte order; records are meant for this host's
+** 	own buffers and files. The names are ids in the name dictionary of
+** 	ltdict.c, which must hold them when the record is decoded.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltdict.h"
+
+#define LT_CHANGE_HDRLEN	32
+#define LT_COLUMN_HDRLEN	12
+
+/*****************************************************************************
+**
+** buffer functions
+**
+*****************************************************************************/
+
+/*
+** lt_buf_reserve()
+**
+** Type of function:
+** 	change encoding api
+**
+** Purpose:
+** 	Make room for at least 'len' more bytes in the buffer, doubling its
+** 	size as needed.
+**
+** Parameters:
+** 	buf		- Pointer to the buffer.
+** 	len		- Number of bytes about to be appended.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_buf_reserve(LT_BUF *buf, CS_INT len)
+{
+	CS_INT		size;
+	CS_BYTE		*data;
+
+	if (buf->len + len <= buf->size)
+	{
+		return CS_SUCCEED;
+	}
+
+	size = (buf->size == 0) ? EX_BUFSIZE : buf->size;
+	while (size < buf->len + len)
+	{
+		size *= 2;
+	}
+
+	data = (CS_BYTE *)realloc(buf->data, size);
+	if (data == NULL)
+	{
+		ex_error("lt_buf_reserve: realloc() failed");
+		return CS_MEM_ERROR;
+	}
+	buf->data = data;
+	buf->size = size;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_buf_append()
+**
+** Type of function:
+** 	change encoding api
+**
+** Purpose:
+** 	Append bytes to the buffer.
+**
+** Parameters:
+** 	buf		- Pointer to the buffer.
+** 	data		- The bytes to append.
+** 	len		- Number of bytes to append.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_buf_append(LT_BUF *buf, CS_VOID *data, CS_INT len)
+{
+	CS_RETCODE	retcode;
+
+	if ((retcode = lt_buf_reserve(buf, len)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_buf_free()
+**
+** Type of function:
+** 	change encoding api
+**
+** Purpose:
+** 	Release the memory held by the buffer and empty it.
+**
+** Parameters:
+** 	buf		- Pointer to the buffer.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_buf_free(LT_BUF *buf)
+{
+	free(buf->data);
+	buf->data = NULL;
+	buf->len = 0;
+	buf->size = 0;
+}
+
+/*****************************************************************************
+**
+** change functions
+**
+*****************************************************************************/
+
+#define LT_PUT(_p, _v)	(memcpy((_p), &(_v), sizeof (_v)), (_p) += sizeof (_v))
+#define LT_GET(_p, _v)	(memcpy(&(_v), (_p), sizeof (_v)), (_p) += sizeof (_v))
+
+/*
+** lt_change_encode()
+**
+** Type of function:
+** 	change encoding api
+**
+** Purpose:
+** 	Append the encoded form of a row change to a buffer.
+**
+** Parameters:
+** 	buf		- Pointer to the buffer.
+** 	change		- The change to encode.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_change_encode(LT_BUF *buf, LT_CHANGE *change)
+{
+	CS_RETCODE	retcode;
+	CS_UINT		reclen;
+	CS_USMALLINT	u16;
+	CS_INT		i32;
+	CS_INT		i;
+	CS_BYTE		*p;
+	LT_COLUMN	*col;
+
+	reclen = LT_CHANGE_HDRLEN;
+	for (i = 0; i < change->numcols; i++)
+	{
+		col = &change->columns[i];
+		reclen += LT_COLUMN_HDRLEN + col->namelen;
+		if (col->indicator != CS_NULLDATA)
+		{
+			reclen += col->valuelen;
+		}
+	}
+
+	if ((retcode = lt_buf_reserve(buf, reclen)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	p = buf->data + buf->len;
+	LT_PUT(p, reclen);
+	u16 = (CS_USMALLINT)change->op;
+	LT_PUT(p, u16);
+	u16 = (CS_USMALLINT)change->numcols;
+	LT_PUT(p, u16);
+	LT_PUT(p, change->xactid);
+	LT_PUT(p, change->pos);
+	LT_PUT(p, change->tableid);
+	LT_PUT(p, change->ownerid);
+
+	for (i = 0; i < change->numcols; i++)
+	{
+		col = &change->columns[i];
+		u16 = (CS_USMALLINT)col->namelen;
+		LT_PUT(p, u16);
+		u16 = 0;
+		LT_PUT(p, u16);
+		LT_PUT(p, col->datatype);
+		i32 = (col->indicator == CS_NULLDATA) ? -1 : col->valuelen;
+		LT_PUT(p, i32);
+		memcpy(p, col->name, col->namelen);
+		p += col->namelen;
+		if (i32 > 0)
+		{
+			memcpy(p, col->value, i32);
+			p += i32;
+		}
+	}
+
+	buf->len += reclen;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_change_decode()
+**
+** Type of function:
+** 	change encoding api
+**
+** Purpose:
+** 	Decode the record at the start of 'data'. The column names and
+** 	values in the decoded change point into 'data', which must outlive
+** 	them, and the table and owner names into the name dictionary. The
+** 	column array is grown as needed and may be reused across calls.
+**
+** Parameters:
+** 	data		- The encoded record.
+** 	len		- Number of bytes available at 'data'.
+** 	change		- Filled in with the decoded change.
+** 	columns		- Pointer to the column array, initially NULL.
+** 	maxcols		- Pointer to the size of the column array, initially 0.
+**
+** Returns:
+** 	The length of the record, or 0 if it is truncated or malformed, or
+** 	names an id missing from the dictionary.
+*/
+
+CS_INT CS_PUBLIC
+lt_change_decode(CS_BYTE *data, CS_INT len, LT_CHANGE *change,
+		 LT_COLUMN **columns, CS_INT *maxcols)
+{
+	CS_UINT		reclen;
+	CS_USMALLINT	u16;
+	CS_INT		i32;
+	CS_INT		i;
+	CS_BYTE		*p = data;
+	CS_BYTE		*end;
+	LT_COLUMN	*col;
+
+	if (len < LT_CHANGE_HDRLEN)
+	{
+		return 0;
+	}
+	LT_GET(p, reclen);
+	if (reclen < LT_CHANGE_HDRLEN || reclen > (CS_UINT)len)
+	{
+		return 0;
+	}
+	end = data + reclen;
+
+	LT_GET(p, u16);
+	change->op = u16;
+	LT_GET(p, u16);
+	change->numcols = u16;
+	LT_GET(p, change->xactid);
+	LT_GET(p, change->pos);
+	LT_GET(p, change->tableid);
+	LT_GET(p, change->ownerid);
+	if ((change->table = lt_dict_name(change->tableid,
+			&change->tablelen)) == NULL ||
+	    (change->owner = lt_dict_name(change->ownerid,
+			&change->ownerlen)) == NULL)
+	{
+		return 0;
+	}
+
+	if (change->numcols > *maxcols)
+	{
+		col = (LT_COLUMN *)realloc(*columns,
+			change->numcols * sizeof (LT_COLUMN));
+		if (col == NULL)
+		{
+			ex_error("lt_change_decode: realloc() failed");
+			return 0;
+		}
+		*columns = col;
+		*maxcols = change->numcols;
+	}
+	change->columns = *columns;
+
+	for (i = 0; i < change->numcols; i++)
+	{
+		col = &change->columns[i];
+		if (p + LT_COLUMN_HDRLEN > end)
+		{
+			return 0;
+		}
+		LT_GET(p, u16);
+		col->namelen = u16;
+		LT_GET(p, u16);
+		LT_GET(p, col->datatype);
+		LT_GET(p, i32);
+		col->indicator = (i32 < 0) ? CS_NULLDATA : 0;
+		col->valuelen = (i32 < 0) ? 0 : i32;
+		if (p + col->namelen + col->valuelen > end)
+		{
+			return 0;
+		}
+		col->name = (CS_CHAR *)p;
+		p += col->namelen;
+		col->value = (CS_CHAR *)p;
+		p += col->valuelen;
+	}
+
+	return (CS_INT)reclen;
+}
+
+/*
+** lt_change_position()
+**
+** Type of function:
+** 	change encoding api
+**
+** Purpose:
+** 	Read the log record position of the record at the start of 'data'
+** 	without decoding it, to step through a buffer of records.
+**
+** Parameters:
+** 	data		- The encoded record.
+** 	len		- Number of bytes available at 'data'.
+** 	pos		- Set to the log record position.
+**
+** Returns:
+** 	The length of the record, or 0 if it is truncated or malformed.
+*/
+
+CS_INT CS_PUBLIC
+lt_change_position(CS_BYTE *data, CS_INT len, CS_UBIGINT *pos)
+{
+	CS_UINT		reclen;
+	CS_BYTE		*p = data;
+
+	if (len < LT_CHANGE_HDRLEN)
+	{
+		return 0;
+	}
+	LT_GET(p, reclen);
+	if (reclen < LT_CHANGE_HDRLEN || reclen > (CS_UINT)len)
+	{
+		return 0;
+	}
+	p += 2 * sizeof (CS_USMALLINT) + sizeof (CS_UBIGINT);
+	LT_GET(p, *pos);
+	return (CS_INT)reclen;
+}
+
+/*
+** lt_change_opname()
+**
+** Type of function:
+** 	change encoding api
+**
+** Purpose:
+** 	Return the display name of a row change operation.
+**
+** Parameters:
+** 	op		- The operation.
+**
+** Returns:
+** 	Operation name.
+*/
+
+CS_CHAR * CS_PUBLIC
+lt_change_opname(CS_INT op)
+{
+	switch (op)
+	{
+		case LT_OP_INSERT:
+			return "INSERT";
+		case LT_OP_DELETE:
+			return "DELETE";
+		case LT_OP_UPDATE_BEFORE:
+			return "UPDATE BEFORE";
+		case LT_OP_UPDATE_AFTER:
+			return "UPDATE AFTER";
+		case LT_OP_TEXT:
+			return "TEXT";
+	}
+	return "UNKNOWN";
+}
@@ -0,0 +1,112 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the row
+** 	change encoding in ltchange.c.
+**
+*/
+
+#ifndef __LTCHANGE_H__
+#define __LTCHANGE_H__
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** Row change operations.
+*/
+#define LT_OP_INSERT		1
+#define LT_OP_DELETE		2
+#define LT_OP_UPDATE_BEFORE	3
+#define LT_OP_UPDATE_AFTER	4
+#define LT_OP_TEXT		5
+
+/*
+** A growable byte buffer.
+*/
+typedef struct _lt_buf
+{
+	CS_BYTE		*data;
+	CS_INT		len;
+	CS_INT		size;
+} LT_BUF;
+
+/*
+** One column of a row image. 'value' is the character representation of
+** the column, 'valuelen' bytes long and not null terminated. 'indicator'
+** is CS_NULLDATA for a null column.
+*/
+typedef struct _lt_column
+{
+	CS_CHAR		*name;
+	CS_INT		namelen;
+	CS_INT		datatype;
+	CS_INT		indicator;
+	CS_CHAR		*value;
+	CS_INT		valuelen;
+} LT_COLUMN;
+
+/*
+** One row change. 'xactid' is the BEGINXACT position of the transaction
+** making the change and 'pos' the position of the log record. 'tableid'
+** and 'ownerid' are the ids of the table and owner names in the name
+** dictionary of ltdict.c; only they are encoded, and decoding looks the
+** names up.
+*/
+typedef struct _lt_change
+{
+	CS_INT		op;
+	CS_UBIGINT	xactid;
+	CS_UBIGINT	pos;
+	CS_UINT		tableid;
+	CS_UINT		ownerid;
+	CS_CHAR		*table;
+	CS_INT		tablelen;
+	CS_CHAR		*owner;
+	CS_INT		ownerlen;
+	CS_INT		numcols;
+	LT_COLUMN	*columns;
+} LT_CHANGE;
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltchange.c */
+extern CS_RETCODE CS_PUBLIC lt_buf_reserve(
+	LT_BUF *buf,
+	CS_INT len
+	);
+extern CS_RETCODE CS_PUBLIC lt_buf_append(
+	LT_BUF *buf,
+	CS_VOID *data,
+	CS_INT len
+	);
+extern CS_VOID CS_PUBLIC lt_buf_free(
+	LT_BUF *buf
+	);
+extern CS_RETCODE CS_PUBLIC lt_change_encode(
+	LT_BUF *buf,
+	LT_CHANGE *change
+	);
+extern CS_INT CS_PUBLIC lt_change_decode(
+	CS_BYTE *data,
+	CS_INT len,
+	LT_CHANGE *change,
+	LT_COLUMN **columns,
+	CS_INT *maxcols
+	);
+extern CS_INT CS_PUBLIC lt_change_position(
+	CS_BYTE *data,
+	CS_INT len,
+	CS_UBIGINT *pos
+	);
+extern CS_CHAR * CS_PUBLIC lt_change_opname(
+	CS_INT op
+	);
+
+#endif /* __LTCHANGE_H__ */
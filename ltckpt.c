@@ -0,0 +1,326 @@
+/*
+** Description
+** -----------
+** 	This file writes and reloads checkpoints of the transactions that are
+** 	still in flight, together with the position the scan has reached.
+**
+** 	Without a checkpoint a restart must rescan from the BEGINXACT of the
+** 	oldest open transaction to rebuild the changes it has buffered, which
+** 	under a long running transaction can be a great deal of log. With
+** 	one, the buffered changes are reloaded and the rescan only has to
+** 	catch up from the checkpointed scan position.
+**
+** 	A checkpoint file is laid out as:
+**
+** 		LT_CKPT_MAGIC
+** 		CS_UBIGINT	scan position
+** 		CS_UINT		number of transactions
+** 		CS_UINT		length of the name dictionary
+** 		the name dictionary, as a block of entries of ltdict.c
+**
+** 	followed by, for each open transaction, oldest first:
+**
+** 		CS_UBIGINT	BEGINXACT position
+** 		CS_UINT		number of buffered changes
+** 		CS_UINT		length of the buffered changes
+** 		CS_UINT		number of savepoint marks
+** 		CS_UINT		user name id
+** 		the buffered changes, as encoded by ltchange.c
+** 		the savepoint marks, each a CS_UBIGINT position, a
+** 		CS_UINT offset and a CS_UINT number of changes
+**
+** 	and closed by LT_CKPT_TRAILER. It is written to a temporary file,
+** 	synced and renamed over the previous checkpoint, so a crash while
+** 	checkpointing leaves the previous one intact.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltxact.h"
+#include "ltdict.h"
+#include "ltckpt.h"
+
+/*****************************************************************************
+**
+** checkpoint functions
+**
+*****************************************************************************/
+
+/*
+** lt_ckpt_write_xact()
+**
+** lt_xact_walk() callback writing one open transaction.
+*/
+CS_STATIC CS_RETCODE
+lt_ckpt_write_xact(LT_XACT *xact, CS_VOID *arg)
+{
+	FILE		*fp = (FILE *)arg;
+	CS_UBIGINT	key;
+	CS_UINT		u32;
+	CS_INT		i;
+
+	key = LT_LOGPOS_KEY(xact->begin);
+	fwrite(&key, sizeof (key), 1, fp);
+	u32 = (CS_UINT)xact->nchanges;
+	fwrite(&u32, sizeof (u32), 1, fp);
+	u32 = (CS_UINT)xact->changes.len;
+	fwrite(&u32, sizeof (u32), 1, fp);
+	u32 = (CS_UINT)xact->nsavepts;
+	fwrite(&u32, sizeof (u32), 1, fp);
+	fwrite(&xact->userid, sizeof (xact->userid), 1, fp);
+	if (xact->changes.len > 0)
+	{
+		fwrite(xact->changes.data, xact->changes.len, 1, fp);
+	}
+	for (i = 0; i < xact->nsavepts; i++)
+	{
+		fwrite(&xact->savepts[i].pos, sizeof (CS_UBIGINT), 1, fp);
+		u32 = (CS_UINT)xact->savepts[i].offset;
+		fwrite(&u32, sizeof (u32), 1, fp);
+		u32 = (CS_UINT)xact->savepts[i].nchanges;
+		fwrite(&u32, sizeof (u32), 1, fp);
+	}
+
+	return ferror(fp) ? CS_FAIL : CS_SUCCEED;
+}
+
+/*
+** lt_ckpt_write()
+**
+** Type of function:
+** 	checkpoint api
+**
+** Purpose:
+** 	Write a checkpoint of every open transaction and the scan position.
+**
+** Parameters:
+** 	path		- Name of the checkpoint file.
+** 	index		- Pointer to the open transaction index.
+** 	scanpos		- Position of the last log record processed.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the checkpoint could not be written.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_ckpt_write(CS_CHAR *path, LT_XACT_INDEX *index, LT_LOGPOS *scanpos)
+{
+	CS_CHAR		tmppath[EX_MAXSTRINGLEN];
+	FILE		*fp;
+	LT_BUF		dict;
+	CS_UBIGINT	key;
+	CS_UINT		u32;
+	CS_RETCODE	retcode;
+
+	/*
+	** The buffered changes refer to names by their ids, so the whole
+	** dictionary goes with them.
+	*/
+	memset(&dict, 0, sizeof (dict));
+	if ((retcode = lt_dict_encode(&dict, 0)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	snprintf(tmppath, sizeof (tmppath), "%s.tmp", path);
+	if ((fp = fopen(tmppath, "wb")) == NULL)
+	{
+		ex_error("lt_ckpt_write: fopen() failed");
+		lt_buf_free(&dict);
+		return CS_FAIL;
+	}
+
+	fwrite(LT_CKPT_MAGIC, LT_CKPT_MAGICLEN, 1, fp);
+	key = LT_LOGPOS_KEY(*scanpos);
+	fwrite(&key, sizeof (key), 1, fp);
+	u32 = (CS_UINT)index->count;
+	fwrite(&u32, sizeof (u32), 1, fp);
+	u32 = (CS_UINT)dict.len;
+	fwrite(&u32, sizeof (u32), 1, fp);
+	if (dict.len > 0)
+	{
+		fwrite(dict.data, dict.len, 1, fp);
+	}
+	lt_buf_free(&dict);
+
+	retcode = lt_xact_walk(index, lt_ckpt_write_xact, (CS_VOID *)fp);
+	fwrite(LT_CKPT_TRAILER, LT_CKPT_MAGICLEN, 1, fp);
+
+	if (retcode != CS_SUCCEED || fflush(fp) != 0 || ferror(fp) ||
+	    fsync(fileno(fp)) != 0)
+	{
+		ex_error("lt_ckpt_write: writing the checkpoint failed");
+		fclose(fp);
+		unlink(tmppath);
+		return CS_FAIL;
+	}
+	fclose(fp);
+
+	if (rename(tmppath, path) != 0)
+	{
+		ex_error("lt_ckpt_write: rename() failed");
+		unlink(tmppath);
+		return CS_FAIL;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_ckpt_load()
+**
+** Type of function:
+** 	checkpoint api
+**
+** Purpose:
+** 	Reload a checkpoint into an empty open transaction index, and its
+** 	names into the name dictionary. Reloaded transactions are marked
+** 	restored as of the checkpointed scan position, so that what the
+** 	rescan replays for them up to there is not applied twice.
+**
+** Parameters:
+** 	path		- Name of the checkpoint file.
+** 	index		- Pointer to the open transaction index.
+** 	scanpos		- Set to the checkpointed scan position.
+** 	loaded		- Set to CS_TRUE if a checkpoint was loaded, CS_FALSE
+** 			  if there was none.
+**
+** Returns:
+** 	CS_SUCCEED, CS_FAIL if the checkpoint is damaged, or CS_MEM_ERROR.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_ckpt_load(CS_CHAR *path, LT_XACT_INDEX *index, LT_LOGPOS *scanpos,
+	     CS_BOOL *loaded)
+{
+	FILE		*fp;
+	CS_CHAR		magic[LT_CKPT_MAGICLEN];
+	CS_UBIGINT	key;
+	CS_UINT		nxacts;
+	CS_UINT		nchanges;
+	CS_UINT		nsavepts;
+	CS_UINT		len;
+	CS_UINT		u32;
+	CS_UINT		i;
+	CS_UINT		j;
+	CS_BYTE		*dict;
+	LT_LOGPOS	begin;
+	LT_XACT		*xact;
+	CS_RETCODE	retcode = CS_SUCCEED;
+
+	*loaded = CS_FALSE;
+	if ((fp = fopen(path, "rb")) == NULL)
+	{
+		return CS_SUCCEED;
+	}
+
+	if (fread(magic, LT_CKPT_MAGICLEN, 1, fp) != 1 ||
+	    memcmp(magic, LT_CKPT_MAGIC, LT_CKPT_MAGICLEN) != 0 ||
+	    fread(&key, sizeof (key), 1, fp) != 1 ||
+	    fread(&nxacts, sizeof (nxacts), 1, fp) != 1 ||
+	    fread(&len, sizeof (len), 1, fp) != 1)
+	{
+		ex_error("lt_ckpt_load: bad checkpoint header");
+		fclose(fp);
+		return CS_FAIL;
+	}
+	scanpos->page = LT_LOGPOS_PAGE(key);
+	scanpos->row = LT_LOGPOS_ROW(key);
+
+	if (len > 0)
+	{
+		if ((dict = (CS_BYTE *)malloc(len)) == NULL)
+		{
+			ex_error("lt_ckpt_load: malloc() failed");
+			fclose(fp);
+			return CS_MEM_ERROR;
+		}
+		if (fread(dict, len, 1, fp) != 1 ||
+		    lt_dict_load(dict, len) != (CS_INT)len)
+		{
+			retcode = CS_FAIL;
+		}
+		free(dict);
+	}
+
+	for (i = 0; i < nxacts && retcode == CS_SUCCEED; i++)
+	{
+		if (fread(&key, sizeof (key), 1, fp) != 1 ||
+		    fread(&nchanges, sizeof (nchanges), 1, fp) != 1 ||
+		    fread(&len, sizeof (len), 1, fp) != 1 ||
+		    fread(&nsavepts, sizeof (nsavepts), 1, fp) != 1 ||
+		    fread(&u32, sizeof (u32), 1, fp) != 1)
+		{
+			retcode = CS_FAIL;
+			break;
+		}
+
+		begin.page = LT_LOGPOS_PAGE(key);
+		begin.row = LT_LOGPOS_ROW(key);
+		if ((retcode = lt_xact_begin(index, &begin, &xact)) != CS_SUCCEED)
+		{
+			break;
+		}
+		xact->userid = u32;
+		if ((retcode = lt_buf_reserve(&xact->changes, len)) != CS_SUCCEED)
+		{
+			break;
+		}
+		if (len > 0 && fread(xact->changes.data, len, 1, fp) != 1)
+		{
+			retcode = CS_FAIL;
+			break;
+		}
+		xact->changes.len = len;
+		xact->nchanges = nchanges;
+		if ((retcode = lt_xact_reindex(xact)) != CS_SUCCEED)
+		{
+			break;
+		}
+
+		for (j = 0; j < nsavepts && retcode == CS_SUCCEED; j++)
+		{
+			if (fread(&key, sizeof (key), 1, fp) != 1 ||
+			    fread(&len, sizeof (len), 1, fp) != 1 ||
+			    fread(&u32, sizeof (u32), 1, fp) != 1 ||
+			    u32 > (CS_UINT)xact->nchanges)
+			{
+				retcode = CS_FAIL;
+				break;
+			}
+			begin.page = LT_LOGPOS_PAGE(key);
+			begin.row = LT_LOGPOS_ROW(key);
+			if ((retcode = lt_xact_savepoint(xact, &begin)) == CS_SUCCEED)
+			{
+				xact->savepts[xact->nsavepts - 1].offset = len;
+				xact->savepts[xact->nsavepts - 1].nchanges = u32;
+			}
+		}
+
+		xact->last = *scanpos;
+		xact->restored = CS_TRUE;
+	}
+
+	if (retcode == CS_SUCCEED &&
+	    (fread(magic, LT_CKPT_MAGICLEN, 1, fp) != 1 ||
+	     memcmp(magic, LT_CKPT_TRAILER, LT_CKPT_MAGICLEN) != 0))
+	{
+		retcode = CS_FAIL;
+	}
+	fclose(fp);
+
+	if (retcode != CS_SUCCEED)
+	{
+		ex_error("lt_ckpt_load: damaged checkpoint ignored");
+		lt_xact_cleanup(index);
+		return retcode;
+	}
+
+	*loaded = CS_TRUE;
+	return CS_SUCCEED;
+}
@@ -0,0 +1,40 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	in-flight transaction checkpoints in ltckpt.c.
+**
+*/
+
+#ifndef __LTCKPT_H__
+#define __LTCKPT_H__
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+#define LT_CKPT_MAGIC		"LTCKPT03"
+#define LT_CKPT_TRAILER		"LTCKPTND"
+#define LT_CKPT_MAGICLEN	8
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltckpt.c */
+extern CS_RETCODE CS_PUBLIC lt_ckpt_write(
+	CS_CHAR *path,
+	LT_XACT_INDEX *index,
+	LT_LOGPOS *scanpos
+	);
+extern CS_RETCODE CS_PUBLIC lt_ckpt_load(
+	CS_CHAR *path,
+	LT_XACT_INDEX *index,
+	LT_LOGPOS *scanpos,
+	CS_BOOL *loaded
+	);
+
+#endif /* __LTCKPT_H__ */
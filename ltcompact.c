@@ -0,0 +1,734 @@
+/*
+** Description
+** -----------
+** 	This file folds a buffer of encoded row changes into their net
+** 	effect per row. Changes are keyed by the name ids of their table and
+** 	owner and the values of the leading key columns of their row image,
+** 	looked up in an open-addressing hash table over the key bytes.
+**
+** 	For each key, an insert followed by a delete cancels out, a chain of
+** 	updates collapses into one update from the first before image to the
+** 	last after image, a delete followed by an insert becomes an update,
+** 	and an update followed by a delete becomes a delete of the original
+** 	row. An update that changes the key is treated as a delete of the
+** 	old key and an insert of the new one.
+**
+** 	Net changes are written in the order each key was first changed.
+** 	A text change carries no key: it belongs to the row changed by the
+** 	transaction's change before it, and is written after that row's net
+** 	change, or dropped with the row if the row ends up deleted or never
+** 	there. Text changes without such a row, and changes without enough
+** 	columns to form a key, are passed through in place.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltcompact.h"
+
+/*
+** Net change of a key.
+*/
+#define LT_NET_NONE	0	/* not changed yet */
+#define LT_NET_ABSENT	1	/* inserted, then deleted */
+#define LT_NET_INSERT	2
+#define LT_NET_UPDATE	3
+#define LT_NET_DELETE	4
+
+#define LT_COMPACT_MINSLOTS	64
+#define LT_FNV_OFFSET		0xcbf29ce484222325ULL
+#define LT_FNV_PRIME		0x100000001b3ULL
+
+/*****************************************************************************
+**
+** private functions
+**
+*****************************************************************************/
+
+/*
+** lt_compact_grow()
+**
+** Type of function:
+** 	net-change compaction internal api
+**
+** Purpose:
+** 	Grow an array to hold at least 'count' elements.
+**
+** Parameters:
+** 	array		- Pointer to the array.
+** 	max		- Pointer to the number of elements allocated.
+** 	count		- Number of elements needed.
+** 	size		- Size of an element.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_compact_grow(CS_VOID **array, CS_INT *max, CS_INT count, CS_INT size)
+{
+	CS_INT		newmax;
+	CS_VOID		*p;
+
+	if (count <= *max)
+	{
+		return CS_SUCCEED;
+	}
+	newmax = (*max == 0) ? LT_COMPACT_MINSLOTS : *max;
+	while (newmax < count)
+	{
+		newmax *= 2;
+	}
+	p = realloc(*array, newmax * size);
+	if (p == NULL)
+	{
+		ex_error("lt_compact_grow: realloc() failed");
+		return CS_MEM_ERROR;
+	}
+	*array = p;
+	*max = newmax;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_compact_order()
+**
+** Type of function:
+** 	net-change compaction internal api
+**
+** Purpose:
+** 	Append an item to the output order.
+**
+** Parameters:
+** 	compact		- Pointer to the compaction state.
+** 	item		- Entry index, or -2 - offset of a passed through record.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_compact_order(LT_COMPACT *compact, CS_INT item)
+{
+	CS_RETCODE	retcode;
+
+	retcode = lt_compact_grow((CS_VOID **)&compact->order,
+		&compact->maxorder, compact->norder + 1, sizeof (CS_INT));
+	if (retcode != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	compact->order[compact->norder++] = item;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_compact_lookup()
+**
+** Type of function:
+** 	net-change compaction internal api
+**
+** Purpose:
+** 	Find the entry for the key of a row change, adding one if the key
+** 	has not been seen yet.
+**
+** Parameters:
+** 	compact		- Pointer to the compaction state.
+** 	change		- The decoded row change.
+** 	entry		- Set to the index of the entry.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_compact_lookup(LT_COMPACT *compact, LT_CHANGE *change, CS_INT *entry)
+{
+	CS_RETCODE		retcode;
+	CS_INT			keyoff;
+	CS_INT			keylen;
+	CS_INT			i32;
+	CS_INT			i;
+	CS_INT			slot;
+	CS_UBIGINT		hash;
+	CS_BYTE			*key;
+	LT_COLUMN		*col;
+	LT_COMPACT_ENTRY	*e;
+
+	/*
+	** Build the key at the end of the key arena; it is kept only if it
+	** turns out to be new.
+	*/
+	keyoff = compact->keys.len;
+	if ((retcode = lt_buf_append(&compact->keys, &change->tableid,
+			sizeof (change->tableid))) != CS_SUCCEED ||
+	    (retcode = lt_buf_append(&compact->keys, &change->ownerid,
+			sizeof (change->ownerid))) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	for (i = 0; i < compact->keycols; i++)
+	{
+		col = &change->columns[i];
+		i32 = (col->indicator == CS_NULLDATA) ? -1 : col->valuelen;
+		if ((retcode = lt_buf_append(&compact->keys, &i32,
+				sizeof (i32))) != CS_SUCCEED ||
+		    (i32 > 0 && (retcode = lt_buf_append(&compact->keys,
+				col->value, i32)) != CS_SUCCEED))
+		{
+			return retcode;
+		}
+	}
+	key = compact->keys.data + keyoff;
+	keylen = compact->keys.len - keyoff;
+
+	hash = LT_FNV_OFFSET;
+	for (i = 0; i < keylen; i++)
+	{
+		hash = (hash ^ key[i]) * LT_FNV_PRIME;
+	}
+
+	slot = (CS_INT)(hash & (CS_UBIGINT)(compact->nslots - 1));
+	while (compact->slots[slot] >= 0)
+	{
+		e = &compact->entries[compact->slots[slot]];
+		if (e->hash == hash && e->keylen == keylen &&
+		    memcmp(compact->keys.data + e->keyoff, key, keylen) == 0)
+		{
+			compact->keys.len = keyoff;
+			*entry = compact->slots[slot];
+			return CS_SUCCEED;
+		}
+		slot = (slot + 1) & (compact->nslots - 1);
+	}
+
+	retcode = lt_compact_grow((CS_VOID **)&compact->entries,
+		&compact->maxentries, compact->nentries + 1,
+		sizeof (LT_COMPACT_ENTRY));
+	if (retcode != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	e = &compact->entries[compact->nentries];
+	e->hash = hash;
+	e->keyoff = keyoff;
+	e->keylen = keylen;
+	e->net = LT_NET_NONE;
+	e->before = -1;
+	e->after = -1;
+	e->text = -1;
+	e->lasttext = -1;
+	compact->slots[slot] = compact->nentries;
+	*entry = compact->nentries++;
+	return lt_compact_order(compact, *entry);
+}
+
+/*
+** lt_compact_fold()
+**
+** Type of function:
+** 	net-change compaction internal api
+**
+** Purpose:
+** 	Fold one row change into the net change of its key.
+**
+** Parameters:
+** 	e		- The entry of the key.
+** 	net		- LT_NET_INSERT, LT_NET_UPDATE or LT_NET_DELETE.
+** 	before		- Offset of the record with the before image, or -1.
+** 	after		- Offset of the record with the after image, or -1.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_compact_fold(LT_COMPACT_ENTRY *e, CS_INT net, CS_INT before, CS_INT after)
+{
+	switch (net)
+	{
+	  case LT_NET_INSERT:
+		/*
+		** A row deleted and inserted again was updated.
+		*/
+		e->net = (e->net == LT_NET_DELETE || e->net == LT_NET_UPDATE) ?
+			LT_NET_UPDATE : LT_NET_INSERT;
+		e->after = after;
+		break;
+
+	  case LT_NET_UPDATE:
+		if (e->net == LT_NET_NONE)
+		{
+			e->net = LT_NET_UPDATE;
+			e->before = before;
+		}
+		else if (e->net == LT_NET_ABSENT)
+		{
+			e->net = LT_NET_INSERT;
+		}
+		else if (e->net == LT_NET_DELETE)
+		{
+			e->net = LT_NET_UPDATE;
+		}
+		e->after = after;
+		break;
+
+	  case LT_NET_DELETE:
+		if (e->net == LT_NET_NONE)
+		{
+			e->net = LT_NET_DELETE;
+			e->before = before;
+		}
+		else if (e->net == LT_NET_INSERT || e->net == LT_NET_ABSENT)
+		{
+			e->net = LT_NET_ABSENT;
+		}
+		else
+		{
+			e->net = LT_NET_DELETE;
+		}
+		e->after = -1;
+		break;
+	}
+}
+
+/*
+** lt_compact_text()
+**
+** Type of function:
+** 	net-change compaction internal api
+**
+** Purpose:
+** 	Hold a text record with the net change of its row.
+**
+** Parameters:
+** 	compact		- Pointer to the compaction state.
+** 	e		- The entry of the row.
+** 	off		- Offset of the text record.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_compact_text(LT_COMPACT *compact, LT_COMPACT_ENTRY *e, CS_INT off)
+{
+	CS_RETCODE	retcode;
+	CS_INT		t = compact->ntexts;
+
+	retcode = lt_compact_grow((CS_VOID **)&compact->texts,
+		&compact->maxtexts, t + 1, sizeof (LT_COMPACT_TEXT));
+	if (retcode != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	compact->texts[t].off = off;
+	compact->texts[t].next = -1;
+	if (e->lasttext >= 0)
+	{
+		compact->texts[e->lasttext].next = t;
+	}
+	else
+	{
+		e->text = t;
+	}
+	e->lasttext = t;
+	compact->ntexts++;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_compact_move_texts()
+**
+** Type of function:
+** 	net-change compaction internal api
+**
+** Purpose:
+** 	Carry the text records of a row whose key an update changed over to
+** 	its new key, ahead of any the new key holds.
+**
+** Parameters:
+** 	compact		- Pointer to the compaction state.
+** 	from		- The entry of the old key.
+** 	to		- The entry of the new key.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_compact_move_texts(LT_COMPACT *compact, LT_COMPACT_ENTRY *from,
+		      LT_COMPACT_ENTRY *to)
+{
+	if (from->text < 0)
+	{
+		return;
+	}
+	compact->texts[from->lasttext].next = to->text;
+	if (to->text < 0)
+	{
+		to->lasttext = from->lasttext;
+	}
+	to->text = from->text;
+	from->text = -1;
+	from->lasttext = -1;
+}
+
+/*
+** lt_compact_emit()
+**
+** Type of function:
+** 	net-change compaction internal api
+**
+** Purpose:
+** 	Append an input record to the output, as the given operation.
+**
+** Parameters:
+** 	compact		- Pointer to the compaction state.
+** 	in		- The input buffer.
+** 	off		- Offset of the record in the input buffer.
+** 	op		- Operation of the output record, or 0 to keep it.
+** 	out		- The output buffer.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a realloc failed, or CS_FAIL if the
+** 	record is malformed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_compact_emit(LT_COMPACT *compact, LT_BUF *in, CS_INT off, CS_INT op,
+		LT_BUF *out)
+{
+	LT_CHANGE	change;
+
+	if (lt_change_decode(in->data + off, in->len - off, &change,
+			&compact->columns, &compact->maxcols) == 0)
+	{
+		return CS_FAIL;
+	}
+	if (op != 0)
+	{
+		change.op = op;
+	}
+	return lt_change_encode(out, &change);
+}
+
+/*****************************************************************************
+**
+** public functions
+**
+*****************************************************************************/
+
+/*
+** lt_compact_init()
+**
+** Type of function:
+** 	net-change compaction api
+**
+** Purpose:
+** 	Initialize the compaction state.
+**
+** Parameters:
+** 	compact		- Pointer to the compaction state.
+** 	keycols		- Number of leading columns of a row image that
+** 			  make up its key.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_compact_init(LT_COMPACT *compact, CS_INT keycols)
+{
+	memset(compact, 0, sizeof (*compact));
+	compact->keycols = keycols;
+}
+
+/*
+** lt_compact_run()
+**
+** Type of function:
+** 	net-change compaction api
+**
+** Purpose:
+** 	Append the net effect of the row changes in 'in' to 'out'. 'in' may
+** 	hold the changes of one transaction or of several committed ones,
+** 	in commit order.
+**
+** Parameters:
+** 	compact		- Pointer to the compaction state.
+** 	in		- The encoded row changes.
+** 	out		- Buffer the net changes are appended to.
+** 	nchanges	- Set to the number of changes appended.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a realloc failed, or CS_FAIL if a
+** 	record is malformed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_compact_run(LT_COMPACT *compact, LT_BUF *in, LT_BUF *out,
+	       CS_INT *nchanges)
+{
+	CS_RETCODE		retcode;
+	CS_INT			nrecs;
+	CS_INT			nslots;
+	CS_INT			off;
+	CS_INT			next;
+	CS_INT			len;
+	CS_INT			eb;
+	CS_INT			ea;
+	CS_INT			row;
+	CS_INT			i;
+	CS_INT			t;
+	CS_UINT			reclen;
+	CS_UBIGINT		rowxact = 0;
+	LT_CHANGE		change;
+	LT_COMPACT_ENTRY	*e;
+
+	*nchanges = 0;
+	compact->nentries = 0;
+	compact->norder = 0;
+	compact->ntexts = 0;
+	compact->keys.len = 0;
+
+	/*
+	** Size the hash table to keep it at most half full.
+	*/
+	nrecs = 0;
+	for (off = 0; off + (CS_INT)sizeof (reclen) <= in->len; off += reclen)
+	{
+		memcpy(&reclen, in->data + off, sizeof (reclen));
+		if (reclen == 0)
+		{
+			return CS_FAIL;
+		}
+		nrecs++;
+	}
+	for (nslots = LT_COMPACT_MINSLOTS; nslots < nrecs * 2; nslots *= 2)
+		;
+	if (nslots > compact->nslots)
+	{
+		free(compact->slots);
+		compact->slots = (CS_INT *)malloc(nslots * sizeof (CS_INT));
+		if (compact->slots == NULL)
+		{
+			ex_error("lt_compact_run: malloc() failed");
+			compact->nslots = 0;
+			return CS_MEM_ERROR;
+		}
+		compact->nslots = nslots;
+	}
+	for (i = 0; i < compact->nslots; i++)
+	{
+		compact->slots[i] = -1;
+	}
+
+	/*
+	** Fold every change into the net change of its key. 'row' is the
+	** entry of the row the last change of transaction 'rowxact' was
+	** made to, which its text changes go with, or -1.
+	*/
+	row = -1;
+	for (off = 0; off < in->len; off = next)
+	{
+		len = lt_change_decode(in->data + off, in->len - off, &change,
+			&compact->columns, &compact->maxcols);
+		if (len == 0)
+		{
+			return CS_FAIL;
+		}
+		next = off + len;
+
+		if (change.op == LT_OP_TEXT && row >= 0 &&
+		    change.xactid == rowxact)
+		{
+			retcode = lt_compact_text(compact,
+				&compact->entries[row], off);
+		}
+		else if (change.op == LT_OP_TEXT)
+		{
+			retcode = lt_compact_order(compact, -2 - off);
+		}
+		else if (change.op == LT_OP_UPDATE_AFTER ||
+		    compact->keycols <= 0 || change.numcols < compact->keycols)
+		{
+			retcode = lt_compact_order(compact, -2 - off);
+			row = -1;
+		}
+		else if (change.op == LT_OP_INSERT)
+		{
+			if ((retcode = lt_compact_lookup(compact, &change,
+					&ea)) == CS_SUCCEED)
+			{
+				lt_compact_fold(&compact->entries[ea],
+					LT_NET_INSERT, -1, off);
+				row = ea;
+			}
+		}
+		else if (change.op == LT_OP_DELETE)
+		{
+			if ((retcode = lt_compact_lookup(compact, &change,
+					&eb)) == CS_SUCCEED)
+			{
+				/*
+				** The text of a deleted row goes with it.
+				*/
+				e = &compact->entries[eb];
+				lt_compact_fold(e, LT_NET_DELETE, off, -1);
+				e->text = -1;
+				e->lasttext = -1;
+				row = -1;
+			}
+		}
+		else
+		{
+			/*
+			** An update's before image; its after image follows.
+			*/
+			if ((retcode = lt_compact_lookup(compact, &change,
+					&eb)) != CS_SUCCEED)
+			{
+				return retcode;
+			}
+			len = lt_change_decode(in->data + next, in->len - next,
+				&change, &compact->columns, &compact->maxcols);
+			if (len == 0 || change.op != LT_OP_UPDATE_AFTER ||
+			    change.numcols < compact->keycols)
+			{
+				/*
+				** Without its after image the key's net
+				** change is unknown; keep the before image
+				** as it is.
+				*/
+				retcode = lt_compact_order(compact, -2 - off);
+				row = -1;
+			}
+			else if ((retcode = lt_compact_lookup(compact, &change,
+					&ea)) == CS_SUCCEED)
+			{
+				if (ea == eb)
+				{
+					lt_compact_fold(&compact->entries[eb],
+						LT_NET_UPDATE, off, next);
+				}
+				else
+				{
+					lt_compact_fold(&compact->entries[eb],
+						LT_NET_DELETE, off, -1);
+					lt_compact_fold(&compact->entries[ea],
+						LT_NET_INSERT, -1, next);
+					lt_compact_move_texts(compact,
+						&compact->entries[eb],
+						&compact->entries[ea]);
+				}
+				next += len;
+				row = ea;
+			}
+		}
+		if (retcode != CS_SUCCEED)
+		{
+			return retcode;
+		}
+		rowxact = change.xactid;
+	}
+
+	/*
+	** Write the net changes out.
+	*/
+	for (i = 0; i < compact->norder; i++)
+	{
+		if (compact->order[i] < -1)
+		{
+			retcode = lt_compact_emit(compact, in,
+				-2 - compact->order[i], 0, out);
+			*nchanges += 1;
+			if (retcode != CS_SUCCEED)
+			{
+				return retcode;
+			}
+			continue;
+		}
+
+		e = &compact->entries[compact->order[i]];
+		switch (e->net)
+		{
+		  case LT_NET_INSERT:
+			retcode = lt_compact_emit(compact, in, e->after,
+				LT_OP_INSERT, out);
+			*nchanges += 1;
+			break;
+
+		  case LT_NET_DELETE:
+			retcode = lt_compact_emit(compact, in, e->before,
+				LT_OP_DELETE, out);
+			*nchanges += 1;
+			break;
+
+		  case LT_NET_UPDATE:
+			if ((retcode = lt_compact_emit(compact, in, e->before,
+					LT_OP_UPDATE_BEFORE, out)) == CS_SUCCEED)
+			{
+				retcode = lt_compact_emit(compact, in,
+					e->after, LT_OP_UPDATE_AFTER, out);
+			}
+			*nchanges += 2;
+			break;
+
+		  default:
+			retcode = CS_SUCCEED;
+			break;
+		}
+
+		/*
+		** The row's text goes with it, unless it is gone.
+		*/
+		for (t = e->text; t >= 0 && retcode == CS_SUCCEED &&
+		     (e->net == LT_NET_INSERT || e->net == LT_NET_UPDATE);
+		     t = compact->texts[t].next)
+		{
+			retcode = lt_compact_emit(compact, in,
+				compact->texts[t].off, 0, out);
+			*nchanges += 1;
+		}
+		if (retcode != CS_SUCCEED)
+		{
+			return retcode;
+		}
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** lt_compact_cleanup()
+**
+** Type of function:
+** 	net-change compaction api
+**
+** Purpose:
+** 	Release the memory held by the compaction state.
+**
+** Parameters:
+** 	compact		- Pointer to the compaction state.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_compact_cleanup(LT_COMPACT *compact)
+{
+	free(compact->slots);
+	free(compact->entries);
+	free(compact->order);
+	free(compact->texts);
+	free(compact->columns);
+	lt_buf_free(&compact->keys);
+	lt_compact_init(compact, compact->keycols);
+}
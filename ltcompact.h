@@ -0,0 +1,92 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	net-change compaction in ltcompact.c.
+**
+*/
+
+#ifndef __LTCOMPACT_H__
+#define __LTCOMPACT_H__
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** One row key seen by the compaction: its net change so far, and the
+** records holding the before and after images of that change. 'text' and
+** 'lasttext' are the first and last of the text records written for the
+** row, chained through 'texts' of the compaction state, or -1.
+*/
+typedef struct _lt_compact_entry
+{
+	CS_UBIGINT	hash;
+	CS_INT		keyoff;
+	CS_INT		keylen;
+	CS_INT		net;
+	CS_INT		before;
+	CS_INT		after;
+	CS_INT		text;
+	CS_INT		lasttext;
+} LT_COMPACT_ENTRY;
+
+/*
+** A text record held with the net change of its row: its offset in the
+** input, and the index of the row's next text record, or -1.
+*/
+typedef struct _lt_compact_text
+{
+	CS_INT		off;
+	CS_INT		next;
+} LT_COMPACT_TEXT;
+
+/*
+** Reusable compaction state. 'slots' is an open-addressing hash table of
+** indexes into 'entries', -1 when empty. 'order' lists, in input order,
+** the first appearance of every key as an entry index, and every record
+** that is passed through as is as -2 - its offset. 'texts' holds the text
+** records of the entries.
+*/
+typedef struct _lt_compact
+{
+	CS_INT			keycols;
+	CS_INT			*slots;
+	CS_INT			nslots;
+	LT_COMPACT_ENTRY	*entries;
+	CS_INT			nentries;
+	CS_INT			maxentries;
+	CS_INT			*order;
+	CS_INT			norder;
+	CS_INT			maxorder;
+	LT_COMPACT_TEXT		*texts;
+	CS_INT			ntexts;
+	CS_INT			maxtexts;
+	LT_BUF			keys;
+	LT_COLUMN		*columns;
+	CS_INT			maxcols;
+} LT_COMPACT;
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltcompact.c */
+extern CS_VOID CS_PUBLIC lt_compact_init(
+	LT_COMPACT *compact,
+	CS_INT keycols
+	);
+extern CS_RETCODE CS_PUBLIC lt_compact_run(
+	LT_COMPACT *compact,
+	LT_BUF *in,
+	LT_BUF *out,
+	CS_INT *nchanges
+	);
+extern CS_VOID CS_PUBLIC lt_compact_cleanup(
+	LT_COMPACT *compact
+	);
+
+#endif /* __LTCOMPACT_H__ */
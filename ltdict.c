@@ -0,0 +1,724 @@
+/*
+** Description
+** -----------
+** 	This file implements the name dictionary. The table, owner and user
+** 	names the log records carry are interned once, each given a small
+** 	integer id counting up from 1, and the row changes carry the ids
+** 	instead of the names. Id 0 stands for the empty name. Names are
+** 	looked up in an open-addressing hash table over their FNV-1a hash.
+**
+** 	Consumers of the binary output resolve the ids from the dictionary
+** 	side file, to which the entries added since the last batch are
+** 	appended, in blocks laid out as described in ltdict.h, before each
+** 	batch is written. The file is reloaded when it is opened, so a name
+** 	keeps its id from one run to the next.
+**
+** 	The dictionary is used from the scanning thread only.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltdurable.h"
+#include "ltdict.h"
+
+#define LT_DICT_MINSLOTS	256
+
+#define LT_PUT(_p, _v)	(memcpy((_p), &(_v), sizeof (_v)), (_p) += sizeof (_v))
+#define LT_GET(_p, _v)	(memcpy(&(_v), (_p), sizeof (_v)), (_p) += sizeof (_v))
+
+/*
+** The dictionary. 'entries' is indexed by id and holds 'count' of them,
+** the empty name included; 'slots' holds the ids of the names by hash,
+** 0 marking a free slot. 'fd' is the side file, to which the entries
+** before 'flushed' have been written.
+*/
+CS_STATIC struct
+{
+	LT_DICT_ENTRY	*entries;
+	CS_UINT		count;
+	CS_UINT		max;
+	CS_UINT		*slots;
+	CS_UINT		nslots;
+	CS_BOOL		opened;
+	int		fd;
+	CS_UINT		flushed;
+	LT_BUF		out;
+} Lt_dict;
+
+/*****************************************************************************
+**
+** private functions
+**
+*****************************************************************************/
+
+/*
+** lt_dict_hash()
+**
+** Type of function:
+** 	name dictionary internal api
+**
+** Purpose:
+** 	Hash a name.
+**
+** Parameters:
+** 	name		- The name, not null terminated.
+** 	len		- Length of the name.
+**
+** Returns:
+** 	The FNV-1a hash of the name.
+*/
+
+CS_STATIC CS_UINT
+lt_dict_hash(CS_CHAR *name, CS_INT len)
+{
+	CS_UINT		h = 2166136261U;
+	CS_INT		i;
+
+	for (i = 0; i < len; i++)
+	{
+		h = (h ^ (CS_BYTE)name[i]) * 16777619U;
+	}
+	return h;
+}
+
+/*
+** lt_dict_rehash()
+**
+** Type of function:
+** 	name dictionary internal api
+**
+** Purpose:
+** 	Rebuild the hash table with room for 'nslots' names.
+**
+** Parameters:
+** 	nslots		- Number of slots, a power of two.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a calloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_dict_rehash(CS_UINT nslots)
+{
+	CS_UINT		*slots;
+	CS_UINT		id;
+	CS_UINT		s;
+
+	slots = (CS_UINT *)calloc(nslots, sizeof (CS_UINT));
+	if (slots == NULL)
+	{
+		ex_error("lt_dict_rehash: calloc() failed");
+		return CS_MEM_ERROR;
+	}
+	for (id = 1; id < Lt_dict.count; id++)
+	{
+		s = Lt_dict.entries[id].hash & (nslots - 1);
+		while (slots[s] != 0)
+		{
+			s = (s + 1) & (nslots - 1);
+		}
+		slots[s] = id;
+	}
+	free(Lt_dict.slots);
+	Lt_dict.slots = slots;
+	Lt_dict.nslots = nslots;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_dict_find()
+**
+** Type of function:
+** 	name dictionary internal api
+**
+** Purpose:
+** 	Look up a name.
+**
+** Parameters:
+** 	name		- The name, not null terminated.
+** 	len		- Length of the name.
+** 	hash		- Hash of the name.
+**
+** Returns:
+** 	The id of the name, or 0 if it is not in the dictionary.
+*/
+
+CS_STATIC CS_UINT
+lt_dict_find(CS_CHAR *name, CS_INT len, CS_UINT hash)
+{
+	LT_DICT_ENTRY	*e;
+	CS_UINT		s;
+
+	if (Lt_dict.nslots == 0)
+	{
+		return 0;
+	}
+	for (s = hash & (Lt_dict.nslots - 1); Lt_dict.slots[s] != 0;
+	     s = (s + 1) & (Lt_dict.nslots - 1))
+	{
+		e = &Lt_dict.entries[Lt_dict.slots[s]];
+		if (e->hash == hash && e->len == len &&
+		    memcmp(e->name, name, len) == 0)
+		{
+			return Lt_dict.slots[s];
+		}
+	}
+	return 0;
+}
+
+/*
+** lt_dict_set()
+**
+** Type of function:
+** 	name dictionary internal api
+**
+** Purpose:
+** 	Give a name an id: the next id, which adds it, or an existing one,
+** 	whose name it replaces.
+**
+** Parameters:
+** 	id		- The id, at most the next one.
+** 	name		- The name, not null terminated.
+** 	len		- Length of the name.
+**
+** Returns:
+** 	CS_SUCCEED, CS_FAIL if the id is out of range, or CS_MEM_ERROR if
+** 	a malloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_dict_set(CS_UINT id, CS_CHAR *name, CS_INT len)
+{
+	LT_DICT_ENTRY	*entries;
+	LT_DICT_ENTRY	*e;
+	CS_CHAR		*copy;
+	CS_UINT		max;
+	CS_UINT		s;
+
+	if (Lt_dict.count == 0)
+	{
+		Lt_dict.count = 1;
+	}
+	if (id == 0 || id > Lt_dict.count || len <= 0 || len > LT_DICT_MAXNAME)
+	{
+		return CS_FAIL;
+	}
+	if (id == Lt_dict.count && Lt_dict.count >= Lt_dict.max)
+	{
+		max = (Lt_dict.max == 0) ? LT_DICT_MINSLOTS / 2 : Lt_dict.max * 2;
+		entries = (LT_DICT_ENTRY *)realloc(Lt_dict.entries,
+			max * sizeof (LT_DICT_ENTRY));
+		if (entries == NULL)
+		{
+			ex_error("lt_dict_set: realloc() failed");
+			return CS_MEM_ERROR;
+		}
+		memset(&entries[Lt_dict.max], 0,
+		       (max - Lt_dict.max) * sizeof (LT_DICT_ENTRY));
+		entries[0].name = "";
+		Lt_dict.entries = entries;
+		Lt_dict.max = max;
+	}
+	if ((copy = (CS_CHAR *)malloc(len + 1)) == NULL)
+	{
+		ex_error("lt_dict_set: malloc() failed");
+		return CS_MEM_ERROR;
+	}
+	memcpy(copy, name, len);
+	copy[len] = '\0';
+
+	e = &Lt_dict.entries[id];
+	if (id < Lt_dict.count)
+	{
+		/*
+		** A name replaced under its id moves in the hash table.
+		*/
+		free(e->name);
+		e->name = copy;
+		e->len = len;
+		e->hash = lt_dict_hash(name, len);
+		return lt_dict_rehash(Lt_dict.nslots);
+	}
+
+	if ((Lt_dict.count + 1) * 2 > Lt_dict.nslots &&
+	    lt_dict_rehash((Lt_dict.nslots == 0) ? LT_DICT_MINSLOTS :
+			   Lt_dict.nslots * 2) != CS_SUCCEED)
+	{
+		free(copy);
+		return CS_MEM_ERROR;
+	}
+	e->name = copy;
+	e->len = len;
+	e->hash = lt_dict_hash(name, len);
+	Lt_dict.count++;
+	for (s = e->hash & (Lt_dict.nslots - 1); Lt_dict.slots[s] != 0;
+	     s = (s + 1) & (Lt_dict.nslots - 1))
+	{
+		;
+	}
+	Lt_dict.slots[s] = id;
+	return CS_SUCCEED;
+}
+
+/*****************************************************************************
+**
+** dictionary functions
+**
+*****************************************************************************/
+
+/*
+** lt_dict_intern()
+**
+** Type of function:
+** 	name dictionary api
+**
+** Purpose:
+** 	Get the id of a name, adding it to the dictionary if it is new.
+**
+** Parameters:
+** 	name		- The name, not null terminated.
+** 	len		- Length of the name.
+** 	id		- Set to the id of the name.
+**
+** Returns:
+** 	CS_SUCCEED, CS_FAIL if the name is too long, or CS_MEM_ERROR if a
+** 	malloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_dict_intern(CS_CHAR *name, CS_INT len, CS_UINT *id)
+{
+	CS_RETCODE	retcode;
+
+	if (len <= 0)
+	{
+		*id = 0;
+		return CS_SUCCEED;
+	}
+	if ((*id = lt_dict_find(name, len, lt_dict_hash(name, len))) != 0)
+	{
+		return CS_SUCCEED;
+	}
+	if (len > LT_DICT_MAXNAME)
+	{
+		ex_error("lt_dict_intern: name too long");
+		return CS_FAIL;
+	}
+	*id = (Lt_dict.count == 0) ? 1 : Lt_dict.count;
+	if ((retcode = lt_dict_set(*id, name, len)) != CS_SUCCEED)
+	{
+		*id = 0;
+	}
+	return retcode;
+}
+
+/*
+** lt_dict_name()
+**
+** Type of function:
+** 	name dictionary api
+**
+** Purpose:
+** 	Look up the name of an id. The name is null terminated and stays
+** 	valid until the dictionary is cleaned up or the id reloaded.
+**
+** Parameters:
+** 	id		- The id.
+** 	len		- Set to the length of the name.
+**
+** Returns:
+** 	The name, or NULL if the id is not in the dictionary.
+*/
+
+CS_CHAR * CS_PUBLIC
+lt_dict_name(CS_UINT id, CS_INT *len)
+{
+	if (id == 0)
+	{
+		*len = 0;
+		return "";
+	}
+	if (id >= Lt_dict.count)
+	{
+		return NULL;
+	}
+	*len = Lt_dict.entries[id].len;
+	return Lt_dict.entries[id].name;
+}
+
+/*
+** lt_dict_count()
+**
+** Type of function:
+** 	name dictionary api
+**
+** Purpose:
+** 	Get the number of ids in use, which is also the next id.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	The number of ids, counting the empty name.
+*/
+
+CS_UINT CS_PUBLIC
+lt_dict_count(CS_VOID)
+{
+	return (Lt_dict.count == 0) ? 1 : Lt_dict.count;
+}
+
+/*
+** lt_dict_encode()
+**
+** Type of function:
+** 	name dictionary api
+**
+** Purpose:
+** 	Append a block of the entries from id 'from' on to a buffer.
+** 	Nothing is appended if there are none.
+**
+** Parameters:
+** 	buf		- Pointer to the buffer.
+** 	from		- The first id, 0 or 1 for the whole dictionary.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_dict_encode(LT_BUF *buf, CS_UINT from)
+{
+	LT_DICT_ENTRY	*e;
+	CS_RETCODE	retcode;
+	CS_UINT		u32;
+	CS_USMALLINT	u16;
+	CS_UINT		len = 0;
+	CS_UINT		id;
+	CS_BYTE		*p;
+
+	from = (from == 0) ? 1 : from;
+	if (from >= Lt_dict.count)
+	{
+		return CS_SUCCEED;
+	}
+	for (id = from; id < Lt_dict.count; id++)
+	{
+		len += LT_DICT_ENTLEN + Lt_dict.entries[id].len;
+	}
+	if ((retcode = lt_buf_reserve(buf, LT_DICT_HDRLEN + len)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	p = buf->data + buf->len;
+	u32 = LT_DICT_MAGIC;
+	LT_PUT(p, u32);
+	u32 = Lt_dict.count - from;
+	LT_PUT(p, u32);
+	LT_PUT(p, len);
+	for (id = from; id < Lt_dict.count; id++)
+	{
+		e = &Lt_dict.entries[id];
+		LT_PUT(p, id);
+		u16 = (CS_USMALLINT)e->len;
+		LT_PUT(p, u16);
+		u16 = 0;
+		LT_PUT(p, u16);
+		memcpy(p, e->name, e->len);
+		p += e->len;
+	}
+	buf->len += LT_DICT_HDRLEN + len;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_dict_load()
+**
+** Type of function:
+** 	name dictionary api
+**
+** Purpose:
+** 	Load the block of entries at the start of 'data' into the
+** 	dictionary, giving each name the id it was written with. An id
+** 	already in use takes the name loaded for it.
+**
+** Parameters:
+** 	data		- The block.
+** 	len		- Number of bytes available at 'data'.
+**
+** Returns:
+** 	The length of the block, or 0 if it is truncated or malformed, or
+** 	could not be loaded.
+*/
+
+CS_INT CS_PUBLIC
+lt_dict_load(CS_BYTE *data, CS_INT len)
+{
+	CS_UINT		magic;
+	CS_UINT		count;
+	CS_UINT		blocklen;
+	CS_UINT		id;
+	CS_USMALLINT	namelen;
+	CS_USMALLINT	u16;
+	CS_UINT		i;
+	CS_BYTE		*p = data;
+	CS_BYTE		*end;
+
+	if (len < LT_DICT_HDRLEN)
+	{
+		return 0;
+	}
+	LT_GET(p, magic);
+	LT_GET(p, count);
+	LT_GET(p, blocklen);
+	if (magic != LT_DICT_MAGIC ||
+	    blocklen > (CS_UINT)(len - LT_DICT_HDRLEN))
+	{
+		return 0;
+	}
+	end = p + blocklen;
+
+	for (i = 0; i < count; i++)
+	{
+		if (p + LT_DICT_ENTLEN > end)
+		{
+			return 0;
+		}
+		LT_GET(p, id);
+		LT_GET(p, namelen);
+		LT_GET(p, u16);
+		if (p + namelen > end ||
+		    lt_dict_set(id, (CS_CHAR *)p, namelen) != CS_SUCCEED)
+		{
+			return 0;
+		}
+		p += namelen;
+	}
+	return (p == end) ? (CS_INT)(LT_DICT_HDRLEN + blocklen) : 0;
+}
+
+/*****************************************************************************
+**
+** side file functions
+**
+*****************************************************************************/
+
+/*
+** lt_dict_open()
+**
+** Type of function:
+** 	name dictionary api
+**
+** Purpose:
+** 	Open the dictionary side file, creating it if needed, and load the
+** 	entries already in it. A block left incomplete by a crash is cut
+** 	off.
+**
+** Parameters:
+** 	path		- Name of the file.
+**
+** Returns:
+** 	CS_SUCCEED, CS_FAIL if the file could not be opened or read, or
+** 	CS_MEM_ERROR if a malloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_dict_open(CS_CHAR *path)
+{
+	struct stat	st;
+	CS_BYTE		*data = NULL;
+	CS_UINT		before = lt_dict_count();
+	CS_INT		off = 0;
+	CS_INT		len;
+	ssize_t		n;
+	int		fd;
+
+	if ((fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644)) < 0)
+	{
+		ex_error("lt_dict_open: open() failed");
+		return CS_FAIL;
+	}
+	if (fstat(fd, &st) != 0 || st.st_size > 0x7fffffff)
+	{
+		ex_error("lt_dict_open: fstat() failed");
+		close(fd);
+		return CS_FAIL;
+	}
+	if (st.st_size > 0)
+	{
+		if ((data = (CS_BYTE *)malloc(st.st_size)) == NULL)
+		{
+			ex_error("lt_dict_open: malloc() failed");
+			close(fd);
+			return CS_MEM_ERROR;
+		}
+		for (len = 0; len < (CS_INT)st.st_size; len += n)
+		{
+			n = pread(fd, data + len, st.st_size - len, len);
+			if (n <= 0)
+			{
+				ex_error("lt_dict_open: read() failed");
+				free(data);
+				close(fd);
+				return CS_FAIL;
+			}
+		}
+		while (off < len && (n = lt_dict_load(data + off, len - off)) > 0)
+		{
+			off += n;
+		}
+		free(data);
+		if (off < len && ftruncate(fd, off) != 0)
+		{
+			ex_error("lt_dict_open: ftruncate() failed");
+			close(fd);
+			return CS_FAIL;
+		}
+	}
+	if (lt_durable_track(fd) != CS_SUCCEED)
+	{
+		close(fd);
+		return CS_FAIL;
+	}
+
+	/*
+	** The names loaded from the file are in it already. Should names
+	** have been interned before it was opened, the whole dictionary is
+	** written with the next batch.
+	*/
+	Lt_dict.fd = fd;
+	Lt_dict.opened = CS_TRUE;
+	Lt_dict.flushed = (before > 1) ? 1 : lt_dict_count();
+	return CS_SUCCEED;
+}
+
+/*
+** lt_dict_flush()
+**
+** Type of function:
+** 	name dictionary api
+**
+** Purpose:
+** 	Append the entries added since the last flush to the side file.
+** 	Does nothing if it is not open.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	CS_SUCCEED, CS_FAIL if the write failed, or CS_MEM_ERROR if a
+** 	realloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_dict_flush(CS_VOID)
+{
+	CS_RETCODE	retcode;
+	CS_INT		off;
+	ssize_t		n;
+
+	if (!Lt_dict.opened || Lt_dict.flushed >= lt_dict_count())
+	{
+		return CS_SUCCEED;
+	}
+	Lt_dict.out.len = 0;
+	if ((retcode = lt_dict_encode(&Lt_dict.out, Lt_dict.flushed)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	for (off = 0; off < Lt_dict.out.len; off += n)
+	{
+		n = write(Lt_dict.fd, Lt_dict.out.data + off, Lt_dict.out.len - off);
+		if (n < 0 && errno == EINTR)
+		{
+			n = 0;
+		}
+		else if (n <= 0)
+		{
+			ex_error("lt_dict_flush: write() failed");
+			return CS_FAIL;
+		}
+	}
+	lt_durable_written(0, Lt_dict.out.len);
+	Lt_dict.flushed = lt_dict_count();
+	return CS_SUCCEED;
+}
+
+/*
+** lt_dict_close()
+**
+** Type of function:
+** 	name dictionary api
+**
+** Purpose:
+** 	Flush and close the side file, if it is open.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the flush or close failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_dict_close(CS_VOID)
+{
+	CS_RETCODE	retcode;
+
+	if (!Lt_dict.opened)
+	{
+		return CS_SUCCEED;
+	}
+	retcode = lt_dict_flush();
+	lt_durable_untrack(Lt_dict.fd);
+	if (close(Lt_dict.fd) != 0 && retcode == CS_SUCCEED)
+	{
+		ex_error("lt_dict_close: close() failed");
+		retcode = CS_FAIL;
+	}
+	Lt_dict.opened = CS_FALSE;
+	lt_buf_free(&Lt_dict.out);
+	return retcode;
+}
+
+/*
+** lt_dict_cleanup()
+**
+** Type of function:
+** 	name dictionary api
+**
+** Purpose:
+** 	Free the dictionary. Every id is forgotten.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_dict_cleanup(CS_VOID)
+{
+	CS_UINT		id;
+
+	for (id = 1; id < Lt_dict.count; id++)
+	{
+		free(Lt_dict.entries[id].name);
+	}
+	free(Lt_dict.entries);
+	free(Lt_dict.slots);
+	lt_buf_free(&Lt_dict.out);
+	memset(&Lt_dict, 0, sizeof (Lt_dict));
+}
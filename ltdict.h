@@ -0,0 +1,90 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the name
+** 	dictionary in ltdict.c.
+**
+*/
+
+#ifndef __LTDICT_H__
+#define __LTDICT_H__
+
+#include "ltchange.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** A block of dictionary entries is laid out as:
+**
+** 	CS_UINT		LT_DICT_MAGIC
+** 	CS_UINT		number of entries
+** 	CS_UINT		length of the entries
+**
+** followed by, for each entry:
+**
+** 	CS_UINT		id
+** 	CS_USMALLINT	name length
+** 	CS_USMALLINT	unused
+** 	name
+**
+** Id 0 is the empty name and is never written.
+*/
+#define LT_DICT_MAGIC		0x3144544c	/* "LTD1" */
+#define LT_DICT_HDRLEN		12
+#define LT_DICT_ENTLEN		8
+#define LT_DICT_MAXNAME		0xffff
+
+/*
+** One name. 'hash' is its FNV-1a hash.
+*/
+typedef struct _lt_dict_entry
+{
+	CS_CHAR		*name;
+	CS_INT		len;
+	CS_UINT		hash;
+} LT_DICT_ENTRY;
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltdict.c */
+extern CS_RETCODE CS_PUBLIC lt_dict_intern(
+	CS_CHAR *name,
+	CS_INT len,
+	CS_UINT *id
+	);
+extern CS_CHAR * CS_PUBLIC lt_dict_name(
+	CS_UINT id,
+	CS_INT *len
+	);
+extern CS_UINT CS_PUBLIC lt_dict_count(
+	CS_VOID
+	);
+extern CS_RETCODE CS_PUBLIC lt_dict_encode(
+	LT_BUF *buf,
+	CS_UINT from
+	);
+extern CS_INT CS_PUBLIC lt_dict_load(
+	CS_BYTE *data,
+	CS_INT len
+	);
+extern CS_RETCODE CS_PUBLIC lt_dict_open(
+	CS_CHAR *path
+	);
+extern CS_RETCODE CS_PUBLIC lt_dict_flush(
+	CS_VOID
+	);
+extern CS_RETCODE CS_PUBLIC lt_dict_close(
+	CS_VOID
+	);
+extern CS_VOID CS_PUBLIC lt_dict_cleanup(
+	CS_VOID
+	);
+
+#endif /* __LTDICT_H__ */
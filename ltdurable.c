@@ -0,0 +1,669 @@
+/*
+** Description
+** -----------
+** 	This file implements the durability layer of the output sinks. The
+** 	sinks register the files they write; the batcher reports the commit
+** 	position of each batch once it has been written to them. A syncer
+** 	thread fdatasync()s all the files together once 'maxbytes' bytes
+** 	have been written since the last sync, or 'interval' milliseconds
+** 	after the first write since then, so a single sync covers many
+** 	batches and the scan does not wait for it.
+**
+** 	The position reported before a sync is durable once it completes.
+** 	The durable position only ever advances. The checkpoint waits for it
+** 	to reach the position it saves, and truncation for the position it
+** 	truncates to. The latency of every sync is kept in a histogram.
+**
+** 	A sink unregisters a file before closing it. The layer keeps a
+** 	descriptor of its own for the file until it has been synced once
+** 	more, so data written just before the close is covered as well.
+**
+** 	The layer is optional: until lt_durable_start() is called all of
+** 	its functions do nothing, and every position is durable at once.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "lthist.h"
+#include "ltdurable.h"
+
+/*
+** The durability layer. 'lock' guards everything below it. 'written' is
+** the position of the last batch written and 'unsynced' the bytes written
+** since the last sync began; 'durable' is the position known to be on
+** disk, and 'error' the errno of the first failed sync.
+*/
+CS_STATIC struct
+{
+	CS_BOOL			started;
+	pthread_t		thread;
+	pthread_mutex_t		lock;
+	pthread_cond_t		work;
+	pthread_cond_t		done;
+	CS_INT			interval;
+	CS_INT			maxbytes;
+	LT_DURABLE_FILE		*files;
+	CS_INT			nfiles;
+	CS_INT			maxfiles;
+	CS_UBIGINT		written;
+	CS_BIGINT		unsynced;
+	CS_UBIGINT		durable;
+	CS_BOOL			requested;
+	CS_BOOL			stop;
+	int			error;
+	LT_HIST			hist;
+} Lt_durable;
+
+/*****************************************************************************
+**
+** private functions
+**
+*****************************************************************************/
+
+/*
+** lt_durable_pending()
+**
+** Type of function:
+** 	durability layer internal api
+**
+** Purpose:
+** 	Tell whether there is anything to sync. Called with the lock held.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	CS_TRUE if there is, CS_FALSE otherwise.
+*/
+
+CS_STATIC CS_BOOL
+lt_durable_pending(CS_VOID)
+{
+	CS_INT		i;
+
+	if (Lt_durable.written > Lt_durable.durable || Lt_durable.unsynced > 0)
+	{
+		return CS_TRUE;
+	}
+	for (i = 0; i < Lt_durable.nfiles; i++)
+	{
+		if (Lt_durable.files[i].retired)
+		{
+			return CS_TRUE;
+		}
+	}
+	return CS_FALSE;
+}
+
+/*
+** lt_durable_await()
+**
+** Type of function:
+** 	durability layer internal api
+**
+** Purpose:
+** 	Wait until a sync is due: when asked for, once 'maxbytes' bytes are
+** 	unsynced, 'interval' milliseconds after there first was something to
+** 	sync, or on stop. Called with the lock held.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_durable_await(CS_VOID)
+{
+	struct timespec	deadline;
+	CS_BOOL		timed = CS_FALSE;
+
+	while (!Lt_durable.stop && !Lt_durable.requested &&
+	       Lt_durable.unsynced < Lt_durable.maxbytes)
+	{
+		if (!lt_durable_pending())
+		{
+			pthread_cond_wait(&Lt_durable.work, &Lt_durable.lock);
+			continue;
+		}
+		if (!timed)
+		{
+			clock_gettime(CLOCK_MONOTONIC, &deadline);
+			deadline.tv_sec += Lt_durable.interval / 1000;
+			deadline.tv_nsec += (Lt_durable.interval % 1000) * 1000000L;
+			if (deadline.tv_nsec >= 1000000000L)
+			{
+				deadline.tv_sec++;
+				deadline.tv_nsec -= 1000000000L;
+			}
+			timed = CS_TRUE;
+		}
+		if (pthread_cond_timedwait(&Lt_durable.work, &Lt_durable.lock,
+					   &deadline) == ETIMEDOUT)
+		{
+			break;
+		}
+	}
+}
+
+/*
+** lt_durable_syncer()
+**
+** Type of function:
+** 	durability layer internal api
+**
+** Purpose:
+** 	The syncer thread: whenever a sync is due, fdatasync() every file
+** 	registered, outside the lock, then advance the durable position and
+** 	close the descriptors of the files retired before the sync. On stop
+** 	it syncs a last time.
+**
+** Parameters:
+** 	arg		- Unused.
+**
+** Returns:
+** 	NULL.
+*/
+
+CS_STATIC CS_VOID *
+lt_durable_syncer(CS_VOID *arg)
+{
+	struct timespec	t0;
+	struct timespec	t1;
+	CS_UBIGINT	target;
+	CS_BOOL		stop;
+	CS_INT		maxfds = 0;
+	CS_INT		nfds;
+	CS_INT		i;
+	CS_INT		j;
+	int		*fds = NULL;
+	int		*grown;
+	int		error;
+
+	pthread_mutex_lock(&Lt_durable.lock);
+	for (;;)
+	{
+		lt_durable_await();
+		stop = Lt_durable.stop;
+		target = Lt_durable.written;
+		Lt_durable.requested = CS_FALSE;
+		Lt_durable.unsynced = 0;
+
+		/*
+		** Files retired by now get their last sync in this round; their
+		** sinks' descriptors are marked as gone.
+		*/
+		if (Lt_durable.nfiles > maxfds)
+		{
+			grown = (int *)realloc(fds, Lt_durable.nfiles * sizeof (int));
+			if (grown == NULL)
+			{
+				Lt_durable.error = (Lt_durable.error != 0) ?
+					Lt_durable.error : ENOMEM;
+				pthread_cond_broadcast(&Lt_durable.done);
+				break;
+			}
+			fds = grown;
+			maxfds = Lt_durable.nfiles;
+		}
+		for (nfds = 0; nfds < Lt_durable.nfiles; nfds++)
+		{
+			fds[nfds] = Lt_durable.files[nfds].dup;
+			if (Lt_durable.files[nfds].retired)
+			{
+				Lt_durable.files[nfds].fd = -1;
+			}
+		}
+		pthread_mutex_unlock(&Lt_durable.lock);
+
+		error = 0;
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for (i = 0; i < nfds; i++)
+		{
+			if (fdatasync(fds[i]) != 0 && error == 0)
+			{
+				error = errno;
+			}
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+
+		pthread_mutex_lock(&Lt_durable.lock);
+		if (nfds > 0)
+		{
+			lt_hist_record(&Lt_durable.hist,
+				(CS_UBIGINT)((t1.tv_sec - t0.tv_sec) * 1000000LL +
+					     (t1.tv_nsec - t0.tv_nsec) / 1000));
+		}
+		if (error != 0)
+		{
+			Lt_durable.error = (Lt_durable.error != 0) ?
+				Lt_durable.error : error;
+		}
+		else if (target > Lt_durable.durable)
+		{
+			Lt_durable.durable = target;
+		}
+		for (i = j = 0; i < Lt_durable.nfiles; i++)
+		{
+			if (Lt_durable.files[i].fd < 0)
+			{
+				close(Lt_durable.files[i].dup);
+				continue;
+			}
+			Lt_durable.files[j++] = Lt_durable.files[i];
+		}
+		Lt_durable.nfiles = j;
+		pthread_cond_broadcast(&Lt_durable.done);
+		if (stop)
+		{
+			break;
+		}
+	}
+	pthread_mutex_unlock(&Lt_durable.lock);
+	free(fds);
+	return NULL;
+}
+
+/*
+** lt_durable_failed()
+**
+** Type of function:
+** 	durability layer internal api
+**
+** Purpose:
+** 	Report a failed sync.
+**
+** Parameters:
+** 	error		- Its errno.
+**
+** Returns:
+** 	CS_FAIL.
+*/
+
+CS_STATIC CS_RETCODE
+lt_durable_failed(int error)
+{
+	CS_CHAR		msg[EX_MAXSTRINGLEN];
+
+	sprintf(msg, "lt_durable: syncing the output failed: %s",
+		strerror(error));
+	ex_error(msg);
+	return CS_FAIL;
+}
+
+/*****************************************************************************
+**
+** public functions
+**
+*****************************************************************************/
+
+/*
+** lt_durable_start()
+**
+** Type of function:
+** 	durability layer api
+**
+** Purpose:
+** 	Start the syncer thread. Called before the sink is opened.
+**
+** Parameters:
+** 	interval	- Milliseconds after a write by which it is synced.
+** 	maxbytes	- Bytes written after which a sync starts at once.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the thread could not be started.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_durable_start(CS_INT interval, CS_INT maxbytes)
+{
+	pthread_condattr_t	attr;
+
+	if (Lt_durable.started)
+	{
+		return CS_SUCCEED;
+	}
+	memset(&Lt_durable, 0, sizeof (Lt_durable));
+	Lt_durable.interval = interval;
+	Lt_durable.maxbytes = maxbytes;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_mutex_init(&Lt_durable.lock, NULL);
+	pthread_cond_init(&Lt_durable.work, &attr);
+	pthread_cond_init(&Lt_durable.done, NULL);
+	pthread_condattr_destroy(&attr);
+
+	if (pthread_create(&Lt_durable.thread, NULL, lt_durable_syncer,
+			   NULL) != 0)
+	{
+		ex_error("lt_durable_start: pthread_create() failed");
+		pthread_mutex_destroy(&Lt_durable.lock);
+		pthread_cond_destroy(&Lt_durable.work);
+		pthread_cond_destroy(&Lt_durable.done);
+		return CS_FAIL;
+	}
+	Lt_durable.started = CS_TRUE;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_durable_stop()
+**
+** Type of function:
+** 	durability layer api
+**
+** Purpose:
+** 	Sync the files a last time and stop the syncer thread. Called after
+** 	the sink is closed.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a sync failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_durable_stop(CS_VOID)
+{
+	CS_INT		i;
+	int		error;
+
+	if (!Lt_durable.started)
+	{
+		return CS_SUCCEED;
+	}
+
+	pthread_mutex_lock(&Lt_durable.lock);
+	Lt_durable.stop = CS_TRUE;
+	pthread_cond_signal(&Lt_durable.work);
+	pthread_mutex_unlock(&Lt_durable.lock);
+	pthread_join(Lt_durable.thread, NULL);
+
+	for (i = 0; i < Lt_durable.nfiles; i++)
+	{
+		close(Lt_durable.files[i].dup);
+	}
+	free(Lt_durable.files);
+	Lt_durable.files = NULL;
+	Lt_durable.nfiles = Lt_durable.maxfiles = 0;
+	pthread_mutex_destroy(&Lt_durable.lock);
+	pthread_cond_destroy(&Lt_durable.work);
+	pthread_cond_destroy(&Lt_durable.done);
+	Lt_durable.started = CS_FALSE;
+
+	error = Lt_durable.error;
+	return (error != 0) ? lt_durable_failed(error) : CS_SUCCEED;
+}
+
+/*
+** lt_durable_track()
+**
+** Type of function:
+** 	durability layer api
+**
+** Purpose:
+** 	Register a file a sink has opened for writing, so that it is synced.
+**
+** Parameters:
+** 	fd		- The sink's descriptor of the file.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a realloc failed, or CS_FAIL if dup()
+** 	failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_durable_track(int fd)
+{
+	LT_DURABLE_FILE	*files;
+	CS_INT		max;
+	int		dupfd;
+
+	if (!Lt_durable.started)
+	{
+		return CS_SUCCEED;
+	}
+	if ((dupfd = dup(fd)) < 0)
+	{
+		ex_error("lt_durable_track: dup() failed");
+		return CS_FAIL;
+	}
+
+	pthread_mutex_lock(&Lt_durable.lock);
+	if (Lt_durable.nfiles == Lt_durable.maxfiles)
+	{
+		max = (Lt_durable.maxfiles == 0) ? 16 : Lt_durable.maxfiles * 2;
+		files = (LT_DURABLE_FILE *)realloc(Lt_durable.files,
+			max * sizeof (LT_DURABLE_FILE));
+		if (files == NULL)
+		{
+			pthread_mutex_unlock(&Lt_durable.lock);
+			close(dupfd);
+			ex_error("lt_durable_track: realloc() failed");
+			return CS_MEM_ERROR;
+		}
+		Lt_durable.files = files;
+		Lt_durable.maxfiles = max;
+	}
+	Lt_durable.files[Lt_durable.nfiles].fd = fd;
+	Lt_durable.files[Lt_durable.nfiles].dup = dupfd;
+	Lt_durable.files[Lt_durable.nfiles].retired = CS_FALSE;
+	Lt_durable.nfiles++;
+	pthread_mutex_unlock(&Lt_durable.lock);
+	return CS_SUCCEED;
+}
+
+/*
+** lt_durable_untrack()
+**
+** Type of function:
+** 	durability layer api
+**
+** Purpose:
+** 	Unregister a file before the sink closes it. It is synced once more
+** 	and then forgotten.
+**
+** Parameters:
+** 	fd		- The sink's descriptor of the file.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_durable_untrack(int fd)
+{
+	CS_INT		i;
+
+	if (!Lt_durable.started)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&Lt_durable.lock);
+	for (i = 0; i < Lt_durable.nfiles; i++)
+	{
+		if (Lt_durable.files[i].fd == fd && !Lt_durable.files[i].retired)
+		{
+			Lt_durable.files[i].retired = CS_TRUE;
+			pthread_cond_signal(&Lt_durable.work);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&Lt_durable.lock);
+}
+
+/*
+** lt_durable_written()
+**
+** Type of function:
+** 	durability layer api
+**
+** Purpose:
+** 	Record that the batches up to a commit position have been written to
+** 	the files, or that more bytes have.
+**
+** Parameters:
+** 	pos		- The commit position, or 0 to count the bytes only.
+** 	bytes		- Bytes written.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_durable_written(CS_UBIGINT pos, CS_INT bytes)
+{
+	CS_BOOL		idle;
+
+	if (!Lt_durable.started)
+	{
+		Lt_durable.written = (pos > Lt_durable.written) ?
+			pos : Lt_durable.written;
+		return;
+	}
+
+	pthread_mutex_lock(&Lt_durable.lock);
+	idle = !lt_durable_pending();
+	if (pos > Lt_durable.written)
+	{
+		Lt_durable.written = pos;
+	}
+	Lt_durable.unsynced += bytes;
+	if (Lt_durable.nfiles == 0)
+	{
+		/*
+		** A sink with no files has nothing to sync.
+		*/
+		Lt_durable.durable = Lt_durable.written;
+		Lt_durable.unsynced = 0;
+	}
+	else if (idle || Lt_durable.unsynced >= Lt_durable.maxbytes)
+	{
+		/*
+		** The syncer only needs waking to start its interval, or to
+		** cut it short.
+		*/
+		pthread_cond_signal(&Lt_durable.work);
+	}
+	pthread_mutex_unlock(&Lt_durable.lock);
+}
+
+/*
+** lt_durable_wait()
+**
+** Type of function:
+** 	durability layer api
+**
+** Purpose:
+** 	Wait until a commit position is durable, asking for a sync now
+** 	rather than at the end of the interval. A position past the last
+** 	one written is waited for up to that one.
+**
+** Parameters:
+** 	pos		- The commit position.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a sync failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_durable_wait(CS_UBIGINT pos)
+{
+	int		error;
+
+	if (!Lt_durable.started)
+	{
+		return CS_SUCCEED;
+	}
+
+	pthread_mutex_lock(&Lt_durable.lock);
+	while (Lt_durable.error == 0 && Lt_durable.durable < pos &&
+	       Lt_durable.durable < Lt_durable.written)
+	{
+		Lt_durable.requested = CS_TRUE;
+		pthread_cond_signal(&Lt_durable.work);
+		pthread_cond_wait(&Lt_durable.done, &Lt_durable.lock);
+	}
+	error = Lt_durable.error;
+	pthread_mutex_unlock(&Lt_durable.lock);
+
+	return (error != 0) ? lt_durable_failed(error) : CS_SUCCEED;
+}
+
+/*
+** lt_durable_position()
+**
+** Type of function:
+** 	durability layer api
+**
+** Purpose:
+** 	Get the durable position.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	The commit position of the last batch known to be on disk, 0 if
+** 	there is none, or of the last one written if the layer is not
+** 	started.
+*/
+
+CS_UBIGINT CS_PUBLIC
+lt_durable_position(CS_VOID)
+{
+	CS_UBIGINT	pos;
+
+	if (!Lt_durable.started)
+	{
+		return Lt_durable.written;
+	}
+
+	pthread_mutex_lock(&Lt_durable.lock);
+	pos = Lt_durable.durable;
+	pthread_mutex_unlock(&Lt_durable.lock);
+	return pos;
+}
+
+/*
+** lt_durable_hist()
+**
+** Type of function:
+** 	durability layer api
+**
+** Purpose:
+** 	Copy the histogram of sync latencies, in microseconds. It is kept
+** 	after lt_durable_stop(), for a last report.
+**
+** Parameters:
+** 	hist		- Set to the histogram.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_durable_hist(LT_HIST *hist)
+{
+	if (!Lt_durable.started)
+	{
+		memcpy(hist, &Lt_durable.hist, sizeof (LT_HIST));
+		return;
+	}
+
+	pthread_mutex_lock(&Lt_durable.lock);
+	memcpy(hist, &Lt_durable.hist, sizeof (LT_HIST));
+	pthread_mutex_unlock(&Lt_durable.lock);
+}
@@ -0,0 +1,65 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	group fsync durability layer in ltdurable.c.
+**
+*/
+
+#ifndef __LTDURABLE_H__
+#define __LTDURABLE_H__
+
+#include "lthist.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** A file written by a sink. 'dup' is the durability layer's own
+** descriptor for it, which stays open until the file has been synced a
+** last time after the sink is done with it and sets 'retired'.
+*/
+typedef struct _lt_durable_file
+{
+	int		fd;
+	int		dup;
+	CS_BOOL		retired;
+} LT_DURABLE_FILE;
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltdurable.c */
+extern CS_RETCODE CS_PUBLIC lt_durable_start(
+	CS_INT interval,
+	CS_INT maxbytes
+	);
+extern CS_RETCODE CS_PUBLIC lt_durable_stop(
+	CS_VOID
+	);
+extern CS_RETCODE CS_PUBLIC lt_durable_track(
+	int fd
+	);
+extern CS_VOID CS_PUBLIC lt_durable_untrack(
+	int fd
+	);
+extern CS_VOID CS_PUBLIC lt_durable_written(
+	CS_UBIGINT pos,
+	CS_INT bytes
+	);
+extern CS_RETCODE CS_PUBLIC lt_durable_wait(
+	CS_UBIGINT pos
+	);
+extern CS_UBIGINT CS_PUBLIC lt_durable_position(
+	CS_VOID
+	);
+extern CS_VOID CS_PUBLIC lt_durable_hist(
+	LT_HIST *hist
+	);
+
+#endif /* __LTDURABLE_H__ */
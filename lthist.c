@@ -0,0 +1,279 @@
+/*
+** Description
+** -----------
+** 	This file implements fixed-bucket, log-linear latency histograms.
+** 	Recording a value is a count of leading zeros and an increment, so
+** 	they are cheap enough for the hot paths; quantiles are read off the
+** 	bucket bounds. A histogram is not locked: its owner records into it
+** 	from one thread, or under its own lock, or with
+** 	lt_hist_record_atomic() from any thread while another reads it
+** 	with lt_hist_snapshot().
+**
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "lthist.h"
+
+/*
+** lt_hist_bucket()
+**
+** Type of function:
+** 	histogram internal api
+**
+** Purpose:
+** 	Find the bucket of a value.
+**
+** Parameters:
+** 	value		- The value.
+**
+** Returns:
+** 	The bucket number.
+*/
+
+CS_STATIC CS_INT
+lt_hist_bucket(CS_UBIGINT value)
+{
+	CS_INT		k;
+
+	if (value < LT_HIST_SUB)
+	{
+		return (CS_INT)value;
+	}
+	k = 63 - __builtin_clzll(value);
+	return (k - LT_HIST_SUBBITS + 1) * LT_HIST_SUB +
+		(CS_INT)((value >> (k - LT_HIST_SUBBITS)) & (LT_HIST_SUB - 1));
+}
+
+/*
+** lt_hist_bound()
+**
+** Type of function:
+** 	histogram api
+**
+** Purpose:
+** 	Get the largest value a bucket holds.
+**
+** Parameters:
+** 	bucket		- The bucket number.
+**
+** Returns:
+** 	The value.
+*/
+
+CS_UBIGINT CS_PUBLIC
+lt_hist_bound(CS_INT bucket)
+{
+	CS_INT		k;
+	CS_UBIGINT	low;
+
+	if (bucket < LT_HIST_SUB)
+	{
+		return (CS_UBIGINT)bucket;
+	}
+	k = bucket / LT_HIST_SUB + LT_HIST_SUBBITS - 1;
+	low = (CS_UBIGINT)(LT_HIST_SUB + bucket % LT_HIST_SUB) <<
+		(k - LT_HIST_SUBBITS);
+	return low + (((CS_UBIGINT)1 << (k - LT_HIST_SUBBITS)) - 1);
+}
+
+/*
+** lt_hist_reset()
+**
+** Type of function:
+** 	histogram api
+**
+** Purpose:
+** 	Empty a histogram.
+**
+** Parameters:
+** 	hist		- The histogram.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_hist_reset(LT_HIST *hist)
+{
+	memset(hist, 0, sizeof (LT_HIST));
+}
+
+/*
+** lt_hist_record()
+**
+** Type of function:
+** 	histogram api
+**
+** Purpose:
+** 	Record a value.
+**
+** Parameters:
+** 	hist		- The histogram.
+** 	value		- The value.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_hist_record(LT_HIST *hist, CS_UBIGINT value)
+{
+	hist->counts[lt_hist_bucket(value)]++;
+	hist->count++;
+	hist->sum += value;
+	if (value > hist->max)
+	{
+		hist->max = value;
+	}
+}
+
+/*
+** lt_hist_record_atomic()
+**
+** Type of function:
+** 	histogram api
+**
+** Purpose:
+** 	Record a value with atomic updates, for a histogram recorded into
+** 	from several threads or read while it is.
+**
+** Parameters:
+** 	hist		- The histogram.
+** 	value		- The value.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_hist_record_atomic(LT_HIST *hist, CS_UBIGINT value)
+{
+	CS_UBIGINT	max;
+
+	__atomic_fetch_add(&hist->counts[lt_hist_bucket(value)], 1,
+			   __ATOMIC_RELAXED);
+	__atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&hist->sum, value, __ATOMIC_RELAXED);
+	max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+	while (value > max &&
+	       !__atomic_compare_exchange_n(&hist->max, &max, value, 1,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+		;
+	}
+}
+
+/*
+** lt_hist_snapshot()
+**
+** Type of function:
+** 	histogram api
+**
+** Purpose:
+** 	Copy a histogram recorded into with lt_hist_record_atomic(). The
+** 	copy is not taken at a single instant, so its count may be a few
+** 	values apart from its buckets.
+**
+** Parameters:
+** 	hist		- Set to the copy.
+** 	from		- The histogram.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_hist_snapshot(LT_HIST *hist, LT_HIST *from)
+{
+	CS_INT		i;
+
+	for (i = 0; i < LT_HIST_NBUCKETS; i++)
+	{
+		hist->counts[i] = __atomic_load_n(&from->counts[i],
+						  __ATOMIC_RELAXED);
+	}
+	hist->count = __atomic_load_n(&from->count, __ATOMIC_RELAXED);
+	hist->sum = __atomic_load_n(&from->sum, __ATOMIC_RELAXED);
+	hist->max = __atomic_load_n(&from->max, __ATOMIC_RELAXED);
+}
+
+/*
+** lt_hist_merge()
+**
+** Type of function:
+** 	histogram api
+**
+** Purpose:
+** 	Add the values of a histogram to another.
+**
+** Parameters:
+** 	hist		- The histogram added to.
+** 	from		- The histogram added.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_hist_merge(LT_HIST *hist, LT_HIST *from)
+{
+	CS_INT		i;
+
+	for (i = 0; i < LT_HIST_NBUCKETS; i++)
+	{
+		hist->counts[i] += from->counts[i];
+	}
+	hist->count += from->count;
+	hist->sum += from->sum;
+	if (from->max > hist->max)
+	{
+		hist->max = from->max;
+	}
+}
+
+/*
+** lt_hist_quantile()
+**
+** Type of function:
+** 	histogram api
+**
+** Purpose:
+** 	Estimate a quantile, as the bound of the bucket it falls in, capped
+** 	at the largest value recorded.
+**
+** Parameters:
+** 	hist		- The histogram.
+** 	q		- The quantile, from 0 to 1.
+**
+** Returns:
+** 	The value, or 0 if the histogram is empty.
+*/
+
+CS_UBIGINT CS_PUBLIC
+lt_hist_quantile(LT_HIST *hist, double q)
+{
+	CS_UBIGINT	rank;
+	CS_UBIGINT	seen = 0;
+	CS_UBIGINT	bound;
+	CS_INT		i;
+
+	if (hist->count == 0)
+	{
+		return 0;
+	}
+	rank = (CS_UBIGINT)(q * hist->count + 0.5);
+	rank = (rank < 1) ? 1 : rank;
+	for (i = 0; i < LT_HIST_NBUCKETS; i++)
+	{
+		if ((seen += hist->counts[i]) >= rank)
+		{
+			bound = lt_hist_bound(i);
+			return (bound < hist->max) ? bound : hist->max;
+		}
+	}
+	return hist->max;
+}
@@ -0,0 +1,71 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	latency histograms in lthist.c.
+**
+*/
+
+#ifndef __LTHIST_H__
+#define __LTHIST_H__
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** Values below LT_HIST_SUB have a bucket each; above, every power of two
+** is split into LT_HIST_SUB buckets, so a bucket is within 1/LT_HIST_SUB
+** of the values it holds, as in an HDR histogram.
+*/
+#define LT_HIST_SUBBITS		4
+#define LT_HIST_SUB		(1 << LT_HIST_SUBBITS)
+#define LT_HIST_NBUCKETS	((64 - LT_HIST_SUBBITS + 1) * LT_HIST_SUB)
+
+/*
+** A histogram of unsigned values, typically microseconds.
+*/
+typedef struct _lt_hist
+{
+	CS_UBIGINT	counts[LT_HIST_NBUCKETS];
+	CS_UBIGINT	count;
+	CS_UBIGINT	sum;
+	CS_UBIGINT	max;
+} LT_HIST;
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* lthist.c */
+extern CS_VOID CS_PUBLIC lt_hist_reset(
+	LT_HIST *hist
+	);
+extern CS_VOID CS_PUBLIC lt_hist_record(
+	LT_HIST *hist,
+	CS_UBIGINT value
+	);
+extern CS_VOID CS_PUBLIC lt_hist_record_atomic(
+	LT_HIST *hist,
+	CS_UBIGINT value
+	);
+extern CS_VOID CS_PUBLIC lt_hist_snapshot(
+	LT_HIST *hist,
+	LT_HIST *from
+	);
+extern CS_VOID CS_PUBLIC lt_hist_merge(
+	LT_HIST *hist,
+	LT_HIST *from
+	);
+extern CS_UBIGINT CS_PUBLIC lt_hist_quantile(
+	LT_HIST *hist,
+	double q
+	);
+extern CS_UBIGINT CS_PUBLIC lt_hist_bound(
+	CS_INT bucket
+	);
+
+#endif /* __LTHIST_H__ */
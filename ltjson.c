@@ -0,0 +1,795 @@
+/*
+** Description
+** -----------
+** 	This file implements the JSON Lines sink, which writes one JSON
+** 	object per row change:
+**
+** 	{"table":"t","owner":"dbo","op":"update","xact":{"page":1,"row":2},
+** 	 "pos":{"page":3,"row":4},"commit_time":"2024-01-31T12:00:00.000000",
+** 	 "user":"sa","before":{"id":1,"c":"x"},"after":{"id":1,"c":"y"}}
+**
+** 	An insert has only "after", a delete only "before", and an update
+** 	both, from its before and after image records. A text change has
+** 	"column" and "value" in place of the images. Integer and float
+** 	columns are written as JSON numbers, bit columns as booleans and
+** 	everything else as strings. The commit time is the server's, as
+** 	given in the log, and the user the one who began the transaction,
+** 	when its BEGINXACT was scanned.
+**
+** 	A batch is formatted into one buffer and written with a single call;
+** 	a path of "-" writes to stdout, which the sink then claims from the
+** 	buffered output writer: the text the program prints goes to stderr,
+** 	and stdout carries the JSON lines only.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctpublic.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltxact.h"
+#include "ltbatch.h"
+#include "ltout.h"
+#include "ltdict.h"
+#include "ltjson.h"
+#include "ltdurable.h"
+
+/*
+** State of a JSON Lines sink. 'fd' is -1 when writing to stdout.
+*/
+typedef struct _lt_json_sink
+{
+	LT_SINK		sink;
+	int		fd;
+	LT_BUF		out;
+	LT_COLUMN	*columns;
+	CS_INT		maxcols;
+	LT_COLUMN	*before;
+	CS_INT		maxbefore;
+} LT_JSON_SINK;
+
+/*
+** SWAR helpers over 8 bytes at a time.
+*/
+#define LT_ONES		0x0101010101010101ULL
+#define LT_HIGHS	0x8080808080808080ULL
+#define LT_HASZERO(_w)	(((_w) - LT_ONES) & ~(_w) & LT_HIGHS)
+#define LT_HASBYTE(_w, _c)	LT_HASZERO((_w) ^ (LT_ONES * (_c)))
+#define LT_HASLESS(_w, _n)	(((_w) - LT_ONES * (_n)) & ~(_w) & LT_HIGHS)
+
+CS_STATIC CS_CHAR Lt_hex[] = "0123456789abcdef";
+
+/*****************************************************************************
+**
+** escaping functions
+**
+*****************************************************************************/
+
+/*
+** lt_json_utf8len()
+**
+** Type of function:
+** 	JSON sink internal api
+**
+** Purpose:
+** 	Return the length of the well-formed UTF-8 sequence starting at
+** 	'p', or 0 if it is not one.
+**
+** Parameters:
+** 	p		- Start of the sequence; its first byte is >= 0x80.
+** 	len		- Number of bytes available.
+**
+** Returns:
+** 	2 to 4, or 0.
+*/
+
+CS_STATIC CS_INT
+lt_json_utf8len(CS_BYTE *p, CS_INT len)
+{
+	CS_INT		n;
+	CS_INT		i;
+
+	if (p[0] >= 0xc2 && p[0] <= 0xdf)
+	{
+		n = 2;
+	}
+	else if (p[0] >= 0xe0 && p[0] <= 0xef)
+	{
+		n = 3;
+	}
+	else if (p[0] >= 0xf0 && p[0] <= 0xf4)
+	{
+		n = 4;
+	}
+	else
+	{
+		return 0;
+	}
+	if (n > len)
+	{
+		return 0;
+	}
+	for (i = 1; i < n; i++)
+	{
+		if ((p[i] & 0xc0) != 0x80)
+		{
+			return 0;
+		}
+	}
+
+	/*
+	** Reject overlong forms, surrogates and code points past U+10FFFF.
+	*/
+	if ((p[0] == 0xe0 && p[1] < 0xa0) || (p[0] == 0xed && p[1] >= 0xa0) ||
+	    (p[0] == 0xf0 && p[1] < 0x90) || (p[0] == 0xf4 && p[1] >= 0x90))
+	{
+		return 0;
+	}
+	return n;
+}
+
+/*
+** lt_json_escape()
+**
+** Type of function:
+** 	JSON sink api
+**
+** Purpose:
+** 	Append a string to a buffer as a quoted JSON string.
+**
+** 	Clean runs of printable ASCII are found 16 bytes at a time with SSE2
+** 	where available, else 8 at a time in a 64 bit word, and copied as
+** 	is. Quotes, backslashes and control characters are escaped; well
+** 	formed UTF-8 is copied, and any other byte is taken as Latin-1 and
+** 	written as a \u escape.
+**
+** Parameters:
+** 	out		- The buffer.
+** 	str		- The string.
+** 	len		- Its length.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_json_escape(LT_BUF *out, CS_CHAR *str, CS_INT len)
+{
+	CS_RETCODE	retcode;
+	CS_BYTE		*s = (CS_BYTE *)str;
+	CS_BYTE		*end = s + len;
+	CS_CHAR		*d;
+	CS_UBIGINT	w;
+	CS_INT		n;
+	CS_BYTE		c;
+#ifdef __SSE2__
+	__m128i		v;
+	__m128i		quote = _mm_set1_epi8('"');
+	__m128i		bslash = _mm_set1_epi8('\\');
+	__m128i		space = _mm_set1_epi8(' ');
+#endif
+
+	/*
+	** At worst every byte becomes a six character \u escape.
+	*/
+	if ((retcode = lt_buf_reserve(out, len * 6 + 2)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	d = (CS_CHAR *)out->data + out->len;
+	*d++ = '"';
+
+	while (s < end)
+	{
+#ifdef __SSE2__
+		/*
+		** Bytes of 0x80 and up compare as negative, so the signed
+		** compare against a space catches them with the controls.
+		*/
+		while (end - s >= 16)
+		{
+			v = _mm_loadu_si128((__m128i *)s);
+			if (_mm_movemask_epi8(_mm_or_si128(
+				_mm_cmplt_epi8(v, space),
+				_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+					     _mm_cmpeq_epi8(v, bslash)))) != 0)
+			{
+				break;
+			}
+			_mm_storeu_si128((__m128i *)d, v);
+			s += 16;
+			d += 16;
+		}
+#endif
+		while (end - s >= 8)
+		{
+			memcpy(&w, s, 8);
+			if (((w & LT_HIGHS) | LT_HASLESS(w, 0x20) |
+			     LT_HASBYTE(w, '"') | LT_HASBYTE(w, '\\')) != 0)
+			{
+				break;
+			}
+			memcpy(d, s, 8);
+			s += 8;
+			d += 8;
+		}
+		if (s == end)
+		{
+			break;
+		}
+
+		/*
+		** One byte at a time up to the next clean word.
+		*/
+		c = *s;
+		if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\')
+		{
+			*d++ = (CS_CHAR)c;
+			s++;
+			continue;
+		}
+		if (c >= 0x80)
+		{
+			if ((n = lt_json_utf8len(s, end - s)) > 0)
+			{
+				memcpy(d, s, n);
+				s += n;
+				d += n;
+				continue;
+			}
+		}
+		else
+		{
+			switch (c)
+			{
+			  case '"':
+			  case '\\':
+				*d++ = '\\';
+				*d++ = (CS_CHAR)c;
+				s++;
+				continue;
+			  case '\n':
+				*d++ = '\\';
+				*d++ = 'n';
+				s++;
+				continue;
+			  case '\r':
+				*d++ = '\\';
+				*d++ = 'r';
+				s++;
+				continue;
+			  case '\t':
+				*d++ = '\\';
+				*d++ = 't';
+				s++;
+				continue;
+			}
+		}
+		*d++ = '\\';
+		*d++ = 'u';
+		*d++ = '0';
+		*d++ = '0';
+		*d++ = Lt_hex[c >> 4];
+		*d++ = Lt_hex[c & 0xf];
+		s++;
+	}
+
+	*d++ = '"';
+	out->len = d - (CS_CHAR *)out->data;
+	return CS_SUCCEED;
+}
+
+/*****************************************************************************
+**
+** formatting functions
+**
+*****************************************************************************/
+
+/*
+** lt_json_isnumber()
+**
+** Type of function:
+** 	JSON sink internal api
+**
+** Purpose:
+** 	Tell whether a value is a valid JSON number.
+**
+** Parameters:
+** 	s		- The value.
+** 	len		- Its length.
+**
+** Returns:
+** 	CS_TRUE or CS_FALSE.
+*/
+
+CS_STATIC CS_BOOL
+lt_json_isnumber(CS_CHAR *s, CS_INT len)
+{
+	CS_INT		i = 0;
+	CS_INT		digits;
+
+	if (i < len && s[i] == '-')
+	{
+		i++;
+	}
+	if (i >= len || s[i] < '0' || s[i] > '9' ||
+	    (s[i] == '0' && i + 1 < len && s[i + 1] >= '0' && s[i + 1] <= '9'))
+	{
+		return CS_FALSE;
+	}
+	while (i < len && s[i] >= '0' && s[i] <= '9')
+	{
+		i++;
+	}
+	if (i < len && s[i] == '.')
+	{
+		for (i++, digits = 0; i < len && s[i] >= '0' && s[i] <= '9'; i++)
+		{
+			digits++;
+		}
+		if (digits == 0)
+		{
+			return CS_FALSE;
+		}
+	}
+	if (i < len && (s[i] == 'e' || s[i] == 'E'))
+	{
+		i++;
+		if (i < len && (s[i] == '+' || s[i] == '-'))
+		{
+			i++;
+		}
+		for (digits = 0; i < len && s[i] >= '0' && s[i] <= '9'; i++)
+		{
+			digits++;
+		}
+		if (digits == 0)
+		{
+			return CS_FALSE;
+		}
+	}
+	return (i == len);
+}
+
+/*
+** lt_json_value()
+**
+** Type of function:
+** 	JSON sink internal api
+**
+** Purpose:
+** 	Append a column value in the JSON form its datatype calls for.
+**
+** Parameters:
+** 	out		- The buffer.
+** 	col		- The column.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_json_value(LT_BUF *out, LT_COLUMN *col)
+{
+	if (col->indicator == CS_NULLDATA)
+	{
+		return lt_buf_append(out, "null", 4);
+	}
+	switch ((int)col->datatype)
+	{
+	  case CS_TINYINT_TYPE:
+	  case CS_SMALLINT_TYPE:
+	  case CS_USMALLINT_TYPE:
+	  case CS_INT_TYPE:
+	  case CS_UINT_TYPE:
+	  case CS_BIGINT_TYPE:
+	  case CS_UBIGINT_TYPE:
+	  case CS_REAL_TYPE:
+	  case CS_FLOAT_TYPE:
+		if (lt_json_isnumber(col->value, col->valuelen))
+		{
+			return lt_buf_append(out, col->value, col->valuelen);
+		}
+		break;
+	  case CS_BIT_TYPE:
+		if (col->valuelen > 0 && col->value[0] != '0')
+		{
+			return lt_buf_append(out, "true", 4);
+		}
+		return lt_buf_append(out, "false", 5);
+	}
+	return lt_json_escape(out, col->value, col->valuelen);
+}
+
+/*
+** lt_json_image()
+**
+** Type of function:
+** 	JSON sink internal api
+**
+** Purpose:
+** 	Append a row image as a "name":{column:value,...} member.
+**
+** Parameters:
+** 	out		- The buffer.
+** 	name		- The member name, with its leading comma and quotes.
+** 	columns		- The columns of the image.
+** 	numcols		- The number of columns.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_json_image(LT_BUF *out, CS_CHAR *name, LT_COLUMN *columns, CS_INT numcols)
+{
+	CS_RETCODE	retcode;
+	CS_INT		i;
+
+	if ((retcode = lt_buf_append(out, name, strlen(name))) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	for (i = 0; i < numcols; i++)
+	{
+		if ((retcode = lt_buf_append(out, (i == 0) ? "{" : ",",
+				1)) != CS_SUCCEED ||
+		    (retcode = lt_json_escape(out, columns[i].name,
+				columns[i].namelen)) != CS_SUCCEED ||
+		    (retcode = lt_buf_append(out, ":", 1)) != CS_SUCCEED ||
+		    (retcode = lt_json_value(out, &columns[i])) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+	}
+	return lt_buf_append(out, (numcols == 0) ? "{}" : "}",
+		(numcols == 0) ? 2 : 1);
+}
+
+/*
+** lt_json_event()
+**
+** Type of function:
+** 	JSON sink internal api
+**
+** Purpose:
+** 	Append the JSON object of one row change.
+**
+** Parameters:
+** 	js		- The sink.
+** 	bx		- The change's transaction.
+** 	change		- The change, or the after image of an update.
+** 	before		- The before image of an update, or NULL.
+** 	nbefore		- Number of columns in 'before'.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_json_event(LT_JSON_SINK *js, LT_BATCH_XACT *bx, LT_CHANGE *change,
+	      LT_COLUMN *before, CS_INT nbefore)
+{
+	LT_BUF		*out = &js->out;
+	CS_RETCODE	retcode;
+	CS_CHAR		head[256];
+	CS_CHAR		*op;
+	CS_CHAR		*user;
+	CS_INT		n;
+	time_t		secs;
+	struct tm	tm;
+
+	switch (change->op)
+	{
+	  case LT_OP_INSERT:
+		op = "insert";
+		break;
+	  case LT_OP_DELETE:
+		op = "delete";
+		break;
+	  case LT_OP_TEXT:
+		op = "text";
+		break;
+	  default:
+		op = "update";
+		break;
+	}
+
+	if ((retcode = lt_buf_append(out, "{\"table\":", 9)) != CS_SUCCEED ||
+	    (retcode = lt_json_escape(out, change->table,
+			change->tablelen)) != CS_SUCCEED ||
+	    (retcode = lt_buf_append(out, ",\"owner\":", 9)) != CS_SUCCEED ||
+	    (retcode = lt_json_escape(out, change->owner,
+			change->ownerlen)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	n = snprintf(head, sizeof (head),
+		",\"op\":\"%s\",\"xact\":{\"page\":%u,\"row\":%u},"
+		"\"pos\":{\"page\":%u,\"row\":%u}",
+		op, LT_LOGPOS_PAGE(change->xactid), LT_LOGPOS_ROW(change->xactid),
+		LT_LOGPOS_PAGE(change->pos), LT_LOGPOS_ROW(change->pos));
+	if ((retcode = lt_buf_append(out, head, n)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	if (bx->committime != 0)
+	{
+		secs = (time_t)(bx->committime / 1000000);
+		gmtime_r(&secs, &tm);
+		n = snprintf(head, sizeof (head),
+			",\"commit_time\":\"%04d-%02d-%02dT%02d:%02d:%02d.%06d\"",
+			tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+			tm.tm_min, tm.tm_sec, (int)(bx->committime % 1000000));
+		if ((retcode = lt_buf_append(out, head, n)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+	}
+	if (bx->userid != 0 &&
+	    (user = lt_dict_name(bx->userid, &n)) != NULL &&
+	    ((retcode = lt_buf_append(out, ",\"user\":", 8)) != CS_SUCCEED ||
+	     (retcode = lt_json_escape(out, user, n)) != CS_SUCCEED))
+	{
+		return retcode;
+	}
+
+	if (change->op == LT_OP_TEXT)
+	{
+		if (change->numcols > 0 &&
+		    ((retcode = lt_buf_append(out, ",\"column\":", 10)) != CS_SUCCEED ||
+		     (retcode = lt_json_escape(out, change->columns[0].name,
+				change->columns[0].namelen)) != CS_SUCCEED ||
+		     (retcode = lt_buf_append(out, ",\"value\":", 9)) != CS_SUCCEED ||
+		     (retcode = lt_json_value(out, &change->columns[0])) != CS_SUCCEED))
+		{
+			return retcode;
+		}
+	}
+	else
+	{
+		if (before != NULL &&
+		    (retcode = lt_json_image(out, ",\"before\":", before,
+				nbefore)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+		if (change->op != LT_OP_DELETE && change->op != LT_OP_UPDATE_BEFORE &&
+		    (retcode = lt_json_image(out, ",\"after\":", change->columns,
+				change->numcols)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+	}
+	return lt_buf_append(out, "}\n", 2);
+}
+
+/*****************************************************************************
+**
+** sink functions
+**
+*****************************************************************************/
+
+/*
+** lt_json_write()
+**
+** Type of function:
+** 	JSON sink internal api
+**
+** Purpose:
+** 	Format the changes of a batch and write them out in one call.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	batch		- The batch.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a realloc failed, or CS_FAIL if the
+** 	write failed or a change is malformed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_json_write(LT_SINK *sink, LT_BATCH *batch)
+{
+	LT_JSON_SINK	*js = (LT_JSON_SINK *)sink->ctx;
+	LT_BATCH_XACT	*bx;
+	LT_CHANGE	change;
+	LT_CHANGE	after;
+	CS_RETCODE	retcode;
+	CS_INT		x;
+	CS_INT		off;
+	CS_INT		end;
+	CS_INT		len;
+	CS_INT		alen;
+	CS_BYTE		*p;
+	ssize_t		n;
+
+	js->out.len = 0;
+	for (x = 0; x < batch->nxacts; x++)
+	{
+		bx = &batch->xacts[x];
+		end = bx->offset + bx->len;
+		for (off = bx->offset; off < end; off += len)
+		{
+			len = lt_change_decode(batch->changes.data + off, end - off,
+				&change, &js->columns, &js->maxcols);
+			if (len == 0)
+			{
+				ex_error("lt_json_write: malformed change");
+				return CS_FAIL;
+			}
+
+			if (change.op == LT_OP_DELETE)
+			{
+				retcode = lt_json_event(js, bx, &change,
+					change.columns, change.numcols);
+			}
+			else if (change.op != LT_OP_UPDATE_BEFORE)
+			{
+				retcode = lt_json_event(js, bx, &change, NULL, 0);
+			}
+			else
+			{
+				/*
+				** Pair the before image with the after image
+				** following it, decoded into a second array.
+				*/
+				alen = (off + len < end) ? lt_change_decode(
+					batch->changes.data + off + len,
+					end - off - len, &after, &js->before,
+					&js->maxbefore) : 0;
+				if (alen > 0 && after.op == LT_OP_UPDATE_AFTER)
+				{
+					retcode = lt_json_event(js, bx, &after,
+						change.columns, change.numcols);
+					len += alen;
+				}
+				else
+				{
+					retcode = lt_json_event(js, bx, &change,
+						change.columns, change.numcols);
+				}
+			}
+			if (retcode != CS_SUCCEED)
+			{
+				return retcode;
+			}
+		}
+	}
+
+	if (js->fd < 0)
+	{
+		return lt_out_data(js->out.data, js->out.len);
+	}
+
+	p = js->out.data;
+	len = js->out.len;
+	while (len > 0)
+	{
+		n = write(js->fd, p, len);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			ex_error("lt_json_write: write() failed");
+			return CS_FAIL;
+		}
+		p += n;
+		len -= n;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_json_close()
+**
+** Type of function:
+** 	JSON sink internal api
+**
+** Purpose:
+** 	Close the file and free the sink.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the close failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_json_close(LT_SINK *sink)
+{
+	LT_JSON_SINK	*js = (LT_JSON_SINK *)sink->ctx;
+	CS_RETCODE	retcode = CS_SUCCEED;
+
+	if (js->fd >= 0)
+	{
+		lt_durable_untrack(js->fd);
+	}
+	if (js->fd >= 0 && close(js->fd) != 0)
+	{
+		ex_error("lt_json_close: close() failed");
+		retcode = CS_FAIL;
+	}
+	lt_buf_free(&js->out);
+	free(js->columns);
+	free(js->before);
+	free(js);
+	return retcode;
+}
+
+/*
+** lt_json_open()
+**
+** Type of function:
+** 	JSON sink api
+**
+** Purpose:
+** 	Open a JSON Lines sink appending to 'path', or writing to stdout if
+** 	'path' is "-".
+**
+** Parameters:
+** 	path		- Path of the output file.
+** 	sink		- Set to the new sink.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a malloc failed, or CS_FAIL if the file
+** 	could not be opened.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_json_open(CS_CHAR *path, LT_SINK **sink)
+{
+	LT_JSON_SINK	*js;
+
+	js = (LT_JSON_SINK *)calloc(1, sizeof (LT_JSON_SINK));
+	if (js == NULL)
+	{
+		ex_error("lt_json_open: calloc() failed");
+		return CS_MEM_ERROR;
+	}
+
+	js->fd = -1;
+	if (strcmp(path, "-") != 0)
+	{
+		js->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+		if (js->fd < 0)
+		{
+			ex_error("lt_json_open: open() failed");
+			free(js);
+			return CS_FAIL;
+		}
+		if (lt_durable_track(js->fd) != CS_SUCCEED)
+		{
+			close(js->fd);
+			free(js);
+			return CS_FAIL;
+		}
+	}
+	else if (lt_out_claim() != CS_SUCCEED)
+	{
+		ex_error("lt_json_open: writing out the text output failed");
+		free(js);
+		return CS_FAIL;
+	}
+
+	js->sink.name = "json";
+	js->sink.write = lt_json_write;
+	js->sink.close = lt_json_close;
+	js->sink.ctx = js;
+	*sink = &js->sink;
+	return CS_SUCCEED;
+}
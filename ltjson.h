@@ -0,0 +1,30 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	JSON Lines sink in ltjson.c.
+**
+*/
+
+#ifndef __LTJSON_H__
+#define __LTJSON_H__
+
+#include "ltbatch.h"
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltjson.c */
+extern CS_RETCODE CS_PUBLIC lt_json_escape(
+	LT_BUF *out,
+	CS_CHAR *str,
+	CS_INT len
+	);
+extern CS_RETCODE CS_PUBLIC lt_json_open(
+	CS_CHAR *path,
+	LT_SINK **sink
+	);
+
+#endif /* __LTJSON_H__ */
@@ -0,0 +1,349 @@
+/*
+** Description
+** -----------
+** 	This file measures the replication lag of the committed
+** 	transactions: from their commit on the server to their capture by
+** 	the scan, and from their commit to their emission, once the batch
+** 	holding them has been written to the output sink. Each transaction
+** 	is stamped with both times, and the lags are kept as gauges of the
+** 	latest transaction and as histograms.
+**
+** 	The commit time of the ENDXACT record is by the server's clock, in
+** 	its local time, so our clock is corrected to the server's before the
+** 	two are compared. The caller probes the server's getdate() now and
+** 	then; the offset of the server's clock is its time less the midpoint
+** 	of the probe's round trip, and is off by at most half the round
+** 	trip. Of the last LT_LAG_PROBES probes, the one with the shortest
+** 	round trip is used.
+**
+** 	Until a probe has been made the clocks are taken to agree.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltbatch.h"
+#include "lthist.h"
+#include "ltmetrics.h"
+#include "ltlag.h"
+
+/*
+** The lag measurement. 'skew' is the server's clock less ours, in
+** microseconds, and 'rtt' the round trip of the probe it is from; it is
+** set by the thread probing and read by the others. 'skews' and 'rtts'
+** are the last probes, 'nprobes' the number made.
+*/
+CS_STATIC struct
+{
+	CS_BIGINT	skew;
+	CS_BIGINT	rtt;
+	CS_BIGINT	skews[LT_LAG_PROBES];
+	CS_BIGINT	rtts[LT_LAG_PROBES];
+	CS_INT		nprobes;
+	LT_METRIC	capture;
+	LT_METRIC	emit;
+	LT_METRIC	skewgauge;
+	LT_METRIC	rttgauge;
+	LT_METRIC_HIST	capturehist;
+	LT_METRIC_HIST	emithist;
+} Lt_lag;
+
+/*****************************************************************************
+**
+** private functions
+**
+*****************************************************************************/
+
+/*
+** lt_lag_since()
+**
+** Type of function:
+** 	lag measurement internal api
+**
+** Purpose:
+** 	Get the time from a commit to a later event, none if the clocks
+** 	disagree by more than the event's lead.
+**
+** Parameters:
+** 	committime	- The commit time, by the server's clock.
+** 	when		- The time of the event, by the server's clock.
+**
+** Returns:
+** 	The lag in microseconds.
+*/
+
+CS_STATIC CS_BIGINT
+lt_lag_since(CS_BIGINT committime, CS_BIGINT when)
+{
+	return (when > committime) ? when - committime : 0;
+}
+
+/*****************************************************************************
+**
+** lag functions
+**
+*****************************************************************************/
+
+/*
+** lt_lag_init()
+**
+** Type of function:
+** 	lag measurement api
+**
+** Purpose:
+** 	Register the lag metrics.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_lag_init(CS_VOID)
+{
+	lt_metrics_gauge(&Lt_lag.capture, "lt_capture_lag_seconds",
+			 "Time from the commit of the last transaction captured to its capture.",
+			 NULL, NULL, 1000000);
+	lt_metrics_gauge(&Lt_lag.emit, "lt_emit_lag_seconds",
+			 "Time from the commit of the last transaction emitted to its emission.",
+			 NULL, NULL, 1000000);
+	lt_metrics_histogram(&Lt_lag.capturehist, "lt_commit_to_capture_seconds",
+			     "Time from the commit of a transaction to its capture by the scan.",
+			     NULL, "capture_lag_us", 1000000);
+	lt_metrics_histogram(&Lt_lag.emithist, "lt_commit_to_emit_seconds",
+			     "Time from the commit of a transaction to its batch being written.",
+			     NULL, "emit_lag_us", 1000000);
+	lt_metrics_gauge(&Lt_lag.skewgauge, "lt_server_clock_skew_seconds",
+			 "The server's clock less ours, by the best recent getdate() probe.",
+			 NULL, NULL, 1000000);
+	lt_metrics_gauge(&Lt_lag.rttgauge, "lt_server_clock_probe_seconds",
+			 "Round trip of the getdate() probe the clock skew is from.",
+			 NULL, NULL, 1000000);
+}
+
+/*
+** lt_lag_wallclock()
+**
+** Type of function:
+** 	lag measurement api
+**
+** Purpose:
+** 	Read our real-time clock.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Microseconds since the epoch.
+*/
+
+CS_BIGINT CS_PUBLIC
+lt_lag_wallclock(CS_VOID)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (CS_BIGINT)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+** lt_lag_probe()
+**
+** Type of function:
+** 	lag measurement api
+**
+** Purpose:
+** 	Account for a probe of the server's clock, and correct our clock by
+** 	the probe with the shortest round trip of the latest. Only one
+** 	thread at a time may probe.
+**
+** Parameters:
+** 	servertime	- The server's time, in microseconds since the
+** 			  epoch taking its local time as UTC.
+** 	sent		- When the probe was sent, by lt_lag_wallclock().
+** 	received	- When its result came back, by lt_lag_wallclock().
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_lag_probe(CS_BIGINT servertime, CS_BIGINT sent, CS_BIGINT received)
+{
+	CS_INT		i;
+	CS_INT		n;
+	CS_INT		best;
+
+	i = Lt_lag.nprobes++ % LT_LAG_PROBES;
+	Lt_lag.rtts[i] = MAX(received - sent, 0);
+	Lt_lag.skews[i] = servertime - (sent + Lt_lag.rtts[i] / 2);
+
+	n = MIN(Lt_lag.nprobes, LT_LAG_PROBES);
+	for (best = 0, i = 1; i < n; i++)
+	{
+		if (Lt_lag.rtts[i] < Lt_lag.rtts[best])
+		{
+			best = i;
+		}
+	}
+	__atomic_store_n(&Lt_lag.skew, Lt_lag.skews[best], __ATOMIC_RELAXED);
+	__atomic_store_n(&Lt_lag.rtt, Lt_lag.rtts[best], __ATOMIC_RELAXED);
+	LT_METRIC_SET(&Lt_lag.skewgauge, Lt_lag.skews[best]);
+	LT_METRIC_SET(&Lt_lag.rttgauge, Lt_lag.rtts[best]);
+}
+
+/*
+** lt_lag_now()
+**
+** Type of function:
+** 	lag measurement api
+**
+** Purpose:
+** 	Read our real-time clock, corrected to the server's.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Microseconds since the epoch, by the server's clock.
+*/
+
+CS_BIGINT CS_PUBLIC
+lt_lag_now(CS_VOID)
+{
+	return lt_lag_wallclock() +
+		__atomic_load_n(&Lt_lag.skew, __ATOMIC_RELAXED);
+}
+
+/*
+** lt_lag_captured()
+**
+** Type of function:
+** 	lag measurement api
+**
+** Purpose:
+** 	Stamp a transaction with its capture time, and record its lag if
+** 	its commit time is known.
+**
+** Parameters:
+** 	bx		- The transaction.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_lag_captured(LT_BATCH_XACT *bx)
+{
+	CS_BIGINT	lag;
+
+	bx->capturetime = lt_lag_now();
+	bx->emittime = 0;
+	if (bx->committime == 0)
+	{
+		return;
+	}
+	lag = lt_lag_since(bx->committime, bx->capturetime);
+	LT_METRIC_SET(&Lt_lag.capture, lag);
+	LT_METRIC_OBSERVE(&Lt_lag.capturehist, lag);
+}
+
+/*
+** lt_lag_emitted()
+**
+** Type of function:
+** 	lag measurement api
+**
+** Purpose:
+** 	Stamp the transactions of a batch just written with their emission
+** 	time, and record the lag of those whose commit time is known.
+**
+** Parameters:
+** 	batch		- The batch.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_lag_emitted(LT_BATCH *batch)
+{
+	LT_BATCH_XACT	*bx;
+	CS_BIGINT	now;
+	CS_BIGINT	lag = -1;
+	CS_INT		i;
+
+	now = lt_lag_now();
+	for (i = 0; i < batch->nxacts; i++)
+	{
+		bx = &batch->xacts[i];
+		bx->emittime = now;
+		if (bx->committime != 0)
+		{
+			lag = lt_lag_since(bx->committime, now);
+			LT_METRIC_OBSERVE(&Lt_lag.emithist, lag);
+		}
+	}
+	if (lag >= 0)
+	{
+		LT_METRIC_SET(&Lt_lag.emit, lag);
+	}
+}
+
+/*
+** lt_lag_skew()
+**
+** Type of function:
+** 	lag measurement api
+**
+** Purpose:
+** 	Get the offset of the server's clock from ours.
+**
+** Parameters:
+** 	skew		- Set to the server's clock less ours, in
+** 			  microseconds.
+** 	rtt		- Set to the round trip of the probe it is from.
+**
+** Returns:
+** 	CS_TRUE, or CS_FALSE if no probe has been made.
+*/
+
+CS_BOOL CS_PUBLIC
+lt_lag_skew(CS_BIGINT *skew, CS_BIGINT *rtt)
+{
+	*skew = __atomic_load_n(&Lt_lag.skew, __ATOMIC_RELAXED);
+	*rtt = __atomic_load_n(&Lt_lag.rtt, __ATOMIC_RELAXED);
+	return (Lt_lag.nprobes > 0);
+}
+
+/*
+** lt_lag_hist()
+**
+** Type of function:
+** 	lag measurement api
+**
+** Purpose:
+** 	Copy the histograms of the lags.
+**
+** Parameters:
+** 	capture		- Set to the histogram of the commit to capture lag.
+** 	emit		- Set to the histogram of the commit to emit lag.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_lag_hist(LT_HIST *capture, LT_HIST *emit)
+{
+	lt_hist_snapshot(capture, &Lt_lag.capturehist.hist);
+	lt_hist_snapshot(emit, &Lt_lag.emithist.hist);
+}
@@ -0,0 +1,63 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	replication lag measurement in ltlag.c.
+**
+*/
+
+#ifndef __LTLAG_H__
+#define __LTLAG_H__
+
+#include "ltchange.h"
+#include "ltbatch.h"
+#include "lthist.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** Number of the latest clock probes the offset of the server's clock is
+** taken from.
+*/
+#define LT_LAG_PROBES	8
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltlag.c */
+extern CS_VOID CS_PUBLIC lt_lag_init(
+	CS_VOID
+	);
+extern CS_BIGINT CS_PUBLIC lt_lag_wallclock(
+	CS_VOID
+	);
+extern CS_VOID CS_PUBLIC lt_lag_probe(
+	CS_BIGINT servertime,
+	CS_BIGINT sent,
+	CS_BIGINT received
+	);
+extern CS_BIGINT CS_PUBLIC lt_lag_now(
+	CS_VOID
+	);
+extern CS_VOID CS_PUBLIC lt_lag_captured(
+	LT_BATCH_XACT *bx
+	);
+extern CS_VOID CS_PUBLIC lt_lag_emitted(
+	LT_BATCH *batch
+	);
+extern CS_BOOL CS_PUBLIC lt_lag_skew(
+	CS_BIGINT *skew,
+	CS_BIGINT *rtt
+	);
+extern CS_VOID CS_PUBLIC lt_lag_hist(
+	LT_HIST *capture,
+	LT_HIST *emit
+	);
+
+#endif /* __LTLAG_H__ */
@@ -0,0 +1,752 @@
+/*
+** Description
+** -----------
+** 	This file implements the logger behind ex_msg() and ex_error(). A
+** 	message is formatted by the thread logging it into a slot of a
+** 	bounded queue, claimed with a compare-and-swap, and a logger thread
+** 	writes the queue out every 'interval' milliseconds, with one write
+** 	per stream. Logging a message below LT_LOG_WARN thus makes no system
+** 	call; a warning or an error wakes the logger thread at once. The
+** 	messages of a stream keep their order, but are no longer ordered
+** 	with the display output of ltout.c.
+**
+** 	The same message logged more than 'burst' times in a 'window' of
+** 	seconds is suppressed for the rest of the window; the next one to
+** 	get through tells how many repeats were left out. A message that
+** 	finds the queue full is dropped and counted, unless it is a warning
+** 	or an error, which is then written at once.
+**
+** 	The logger is optional: until lt_log_start() is called, and after
+** 	lt_log_stop(), each message is written as it is logged.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltout.h"
+#include "ltlog.h"
+
+/*
+** An entry of the rate limit table packs the hash of a message, the
+** window it was last seen in and the times it was logged in it.
+*/
+#define LT_LOG_MAXBURST		0xfff
+#define LT_LOG_RATE(_h, _w, _n)	(((CS_UBIGINT)(_h) << 32) | \
+	(((CS_UBIGINT)(_w) & 0xfffff) << 12) | (CS_UBIGINT)(_n))
+#define LT_LOG_RATEHASH(_r)	((CS_UINT)((_r) >> 32))
+#define LT_LOG_RATEWINDOW(_r)	(((_r) >> 12) & 0xfffff)
+#define LT_LOG_RATECOUNT(_r)	((CS_INT)((_r) & LT_LOG_MAXBURST))
+
+/*
+** The counters of the messages logged, by level, and of those left out.
+*/
+LT_METRIC Lt_log_messages[LT_LOG_NLEVELS];
+LT_METRIC Lt_log_suppressed;
+LT_METRIC Lt_log_dropped;
+CS_CHAR *Lt_log_labels[LT_LOG_NLEVELS] =
+{
+	"level=\"debug\"",
+	"level=\"info\"",
+	"level=\"warn\"",
+	"level=\"error\""
+};
+
+/*
+** The prefix of the messages of each level.
+*/
+CS_STATIC CS_CHAR *Lt_log_prefix[LT_LOG_NLEVELS] =
+{
+	"DEBUG",
+	"MESSAGE",
+	"WARNING",
+	"ERROR"
+};
+
+/*
+** The level below which messages are dropped.
+*/
+CS_STATIC CS_INT Lt_log_level = LT_LOG_INFO;
+
+/*
+** The logger. 'tail' is the next position of the queue to claim, and
+** 'head' the next one the logger thread writes out; 'lock' guards the
+** fields after it. 'drained' is the position written out through, for
+** lt_log_flush(). 'rate' and 'repeats' are the rate limit table and the
+** repeats suppressed by each entry.
+*/
+CS_STATIC struct
+{
+	CS_BOOL			started;
+	pthread_t		thread;
+	CS_INT			interval;
+	CS_INT			burst;
+	CS_INT			window;
+	CS_UBIGINT		tail;
+	CS_UBIGINT		head;
+	pthread_mutex_t		lock;
+	pthread_cond_t		work;
+	pthread_cond_t		done;
+	CS_UBIGINT		drained;
+	CS_BOOL			requested;
+	CS_BOOL			stop;
+	CS_UBIGINT		rate[LT_LOG_RATESLOTS];
+	CS_BIGINT		repeats[LT_LOG_RATESLOTS];
+	LT_LOG_SLOT		slots[LT_LOG_SLOTS];
+} Lt_log;
+
+/*****************************************************************************
+**
+** private functions
+**
+*****************************************************************************/
+
+/*
+** lt_log_print()
+**
+** Type of function:
+** 	logger internal api
+**
+** Purpose:
+** 	Write a message at once.
+**
+** Parameters:
+** 	level		- Its level.
+** 	text		- Its text.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_log_print(CS_INT level, CS_CHAR *text)
+{
+	FILE		*stream;
+
+	stream = (level >= LT_LOG_WARN || lt_out_claimed()) ?
+		EX_ERROR_OUT : EX_STANDARD_OUT;
+	if (!__atomic_load_n(&Lt_log.started, __ATOMIC_ACQUIRE))
+	{
+		lt_out_flush();
+	}
+	fprintf(stream, "%s: %s\n", Lt_log_prefix[level], text);
+	fflush(stream);
+}
+
+/*
+** lt_log_hash()
+**
+** Type of function:
+** 	logger internal api
+**
+** Purpose:
+** 	Hash the text of a message, with FNV-1a.
+**
+** Parameters:
+** 	text		- The text.
+** 	len		- Its length.
+**
+** Returns:
+** 	The hash.
+*/
+
+CS_STATIC CS_UINT
+lt_log_hash(CS_CHAR *text, CS_INT len)
+{
+	CS_UINT		hash = 2166136261U;
+	CS_INT		i;
+
+	for (i = 0; i < len; i++)
+	{
+		hash = (hash ^ (CS_BYTE)text[i]) * 16777619U;
+	}
+	return hash;
+}
+
+/*
+** lt_log_limit()
+**
+** Type of function:
+** 	logger internal api
+**
+** Purpose:
+** 	Count a message against the rate limit.
+**
+** Parameters:
+** 	hash		- The hash of its text.
+** 	same		- Set to CS_TRUE if the repeats returned were of
+** 			  this message, CS_FALSE if of another one that
+** 			  had the same entry.
+**
+** Returns:
+** 	-1 if the message is to be suppressed, otherwise the repeats
+** 	suppressed since the last one of the entry that got through.
+*/
+
+CS_STATIC CS_BIGINT
+lt_log_limit(CS_UINT hash, CS_BOOL *same)
+{
+	struct timespec	ts;
+	CS_UBIGINT	*rate;
+	CS_UBIGINT	old;
+	CS_UBIGINT	new;
+	CS_UBIGINT	window;
+	CS_INT		i;
+
+#ifdef CLOCK_MONOTONIC_COARSE
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+	window = (CS_UBIGINT)ts.tv_sec / Lt_log.window;
+
+	i = hash % LT_LOG_RATESLOTS;
+	rate = &Lt_log.rate[i];
+	old = __atomic_load_n(rate, __ATOMIC_RELAXED);
+	do
+	{
+		if (LT_LOG_RATEWINDOW(old) != (window & 0xfffff))
+		{
+			new = LT_LOG_RATE(hash, window, 1);
+		}
+		else if (LT_LOG_RATEHASH(old) != hash)
+		{
+			/*
+			** A message repeated in this window keeps its entry
+			** from those sharing it, which go unlimited.
+			*/
+			if (LT_LOG_RATECOUNT(old) > 1)
+			{
+				return 0;
+			}
+			new = LT_LOG_RATE(hash, window, 1);
+		}
+		else
+		{
+			if (LT_LOG_RATECOUNT(old) >= Lt_log.burst)
+			{
+				__atomic_fetch_add(&Lt_log.repeats[i], 1,
+						   __ATOMIC_RELAXED);
+				LT_METRIC_ADD(&Lt_log_suppressed, 1);
+				return -1;
+			}
+			new = old + 1;
+		}
+	} while (!__atomic_compare_exchange_n(rate, &old, new, CS_TRUE,
+					      __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
+
+	if (LT_LOG_RATECOUNT(new) != 1)
+	{
+		return 0;
+	}
+	*same = (LT_LOG_RATEHASH(old) == hash);
+	return __atomic_exchange_n(&Lt_log.repeats[i], 0, __ATOMIC_RELAXED);
+}
+
+/*
+** lt_log_wake()
+**
+** Type of function:
+** 	logger internal api
+**
+** Purpose:
+** 	Have the logger thread write the queue out now.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_log_wake(CS_VOID)
+{
+	pthread_mutex_lock(&Lt_log.lock);
+	Lt_log.requested = CS_TRUE;
+	pthread_cond_signal(&Lt_log.work);
+	pthread_mutex_unlock(&Lt_log.lock);
+}
+
+/*
+** lt_log_put()
+**
+** Type of function:
+** 	logger internal api
+**
+** Purpose:
+** 	Queue a message, or write it at once if the logger thread is not
+** 	running.
+**
+** Parameters:
+** 	level		- Its level.
+** 	text		- Its text, of less than LT_LOG_MSGLEN bytes.
+** 	len		- Its length.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_log_put(CS_INT level, CS_CHAR *text, CS_INT len)
+{
+	LT_LOG_SLOT	*slot;
+	CS_UBIGINT	pos;
+	CS_UBIGINT	seq;
+
+	if (!__atomic_load_n(&Lt_log.started, __ATOMIC_ACQUIRE))
+	{
+		lt_log_print(level, text);
+		return;
+	}
+
+	/*
+	** Claim the slot at the tail once the logger thread has taken what
+	** it held the last time around.
+	*/
+	pos = __atomic_load_n(&Lt_log.tail, __ATOMIC_RELAXED);
+	for (;;)
+	{
+		slot = &Lt_log.slots[pos & (LT_LOG_SLOTS - 1)];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if (seq == pos)
+		{
+			if (__atomic_compare_exchange_n(&Lt_log.tail, &pos,
+							pos + 1, CS_TRUE,
+							__ATOMIC_RELAXED,
+							__ATOMIC_RELAXED))
+			{
+				break;
+			}
+		}
+		else if ((CS_BIGINT)(seq - pos) < 0)
+		{
+			if (level >= LT_LOG_WARN)
+			{
+				lt_log_print(level, text);
+			}
+			else
+			{
+				LT_METRIC_ADD(&Lt_log_dropped, 1);
+			}
+			lt_log_wake();
+			return;
+		}
+		else
+		{
+			pos = __atomic_load_n(&Lt_log.tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	slot->level = level;
+	memcpy(slot->text, text, len + 1);
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+	if (level >= LT_LOG_WARN ||
+	    pos + 1 - __atomic_load_n(&Lt_log.head, __ATOMIC_RELAXED) >=
+	    LT_LOG_SLOTS / 2)
+	{
+		lt_log_wake();
+	}
+}
+
+/*
+** lt_log_drain()
+**
+** Type of function:
+** 	logger internal api
+**
+** Purpose:
+** 	Write out the messages queued, up to the first slot still being
+** 	filled, and flush the streams written to. Called by one thread at
+** 	a time.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_log_drain(CS_VOID)
+{
+	LT_LOG_SLOT	*slot;
+	CS_UBIGINT	pos;
+	CS_BOOL		out = CS_FALSE;
+	CS_BOOL		err = CS_FALSE;
+
+	pos = __atomic_load_n(&Lt_log.head, __ATOMIC_RELAXED);
+	for (;; pos++)
+	{
+		slot = &Lt_log.slots[pos & (LT_LOG_SLOTS - 1)];
+		if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+		{
+			break;
+		}
+		if (slot->level >= LT_LOG_WARN || lt_out_claimed())
+		{
+			fprintf(EX_ERROR_OUT, "%s: %s\n",
+				Lt_log_prefix[slot->level], slot->text);
+			err = CS_TRUE;
+		}
+		else
+		{
+			fprintf(EX_STANDARD_OUT, "%s: %s\n",
+				Lt_log_prefix[slot->level], slot->text);
+			out = CS_TRUE;
+		}
+		__atomic_store_n(&slot->seq, pos + LT_LOG_SLOTS,
+				 __ATOMIC_RELEASE);
+	}
+	__atomic_store_n(&Lt_log.head, pos, __ATOMIC_RELAXED);
+
+	if (out)
+	{
+		fflush(EX_STANDARD_OUT);
+	}
+	if (err)
+	{
+		fflush(EX_ERROR_OUT);
+	}
+}
+
+/*
+** lt_log_await()
+**
+** Type of function:
+** 	logger internal api
+**
+** Purpose:
+** 	Wait until the queue is due to be written out: when asked for,
+** 	'interval' milliseconds after the last time, or on stop. Called with
+** 	the lock held.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_log_await(CS_VOID)
+{
+	struct timespec	deadline;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += Lt_log.interval / 1000;
+	deadline.tv_nsec += (Lt_log.interval % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+	while (!Lt_log.stop && !Lt_log.requested)
+	{
+		if (pthread_cond_timedwait(&Lt_log.work, &Lt_log.lock,
+					   &deadline) == ETIMEDOUT)
+		{
+			break;
+		}
+	}
+}
+
+/*
+** lt_log_writer()
+**
+** Type of function:
+** 	logger internal api
+**
+** Purpose:
+** 	The logger thread: whenever the queue is due, write it out, outside
+** 	the lock. On stop it writes it out a last time.
+**
+** Parameters:
+** 	arg		- Unused.
+**
+** Returns:
+** 	NULL.
+*/
+
+CS_STATIC CS_VOID *
+lt_log_writer(CS_VOID *arg)
+{
+	CS_BOOL		stop;
+
+	pthread_mutex_lock(&Lt_log.lock);
+	for (;;)
+	{
+		lt_log_await();
+		stop = Lt_log.stop;
+		Lt_log.requested = CS_FALSE;
+		pthread_mutex_unlock(&Lt_log.lock);
+
+		lt_log_drain();
+
+		pthread_mutex_lock(&Lt_log.lock);
+		Lt_log.drained = __atomic_load_n(&Lt_log.head, __ATOMIC_RELAXED);
+		pthread_cond_broadcast(&Lt_log.done);
+		if (stop)
+		{
+			break;
+		}
+	}
+	pthread_mutex_unlock(&Lt_log.lock);
+	return NULL;
+}
+
+/*****************************************************************************
+**
+** public functions
+**
+*****************************************************************************/
+
+/*
+** lt_log_start()
+**
+** Type of function:
+** 	logger api
+**
+** Purpose:
+** 	Set the level and the rate limit, and start the logger thread.
+**
+** Parameters:
+** 	level		- The level below which messages are dropped.
+** 	interval	- Milliseconds between the writes of the queue.
+** 	burst		- Times the same message may be logged in a window,
+** 			  or 0 for no limit.
+** 	window		- Seconds of a window.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the thread could not be started.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_log_start(CS_INT level, CS_INT interval, CS_INT burst, CS_INT window)
+{
+	pthread_condattr_t	attr;
+	CS_INT			i;
+
+	if (Lt_log.started)
+	{
+		return CS_SUCCEED;
+	}
+	memset(&Lt_log, 0, sizeof (Lt_log));
+	for (i = 0; i < LT_LOG_SLOTS; i++)
+	{
+		Lt_log.slots[i].seq = i;
+	}
+	Lt_log_level = MAX(MIN(level, LT_LOG_ERROR), LT_LOG_DEBUG);
+	Lt_log.interval = MAX(interval, 1);
+	Lt_log.burst = MIN(MAX(burst, 0), LT_LOG_MAXBURST);
+	Lt_log.window = MAX(window, 1);
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_mutex_init(&Lt_log.lock, NULL);
+	pthread_cond_init(&Lt_log.work, &attr);
+	pthread_cond_init(&Lt_log.done, NULL);
+	pthread_condattr_destroy(&attr);
+
+	if (pthread_create(&Lt_log.thread, NULL, lt_log_writer, NULL) != 0)
+	{
+		pthread_mutex_destroy(&Lt_log.lock);
+		pthread_cond_destroy(&Lt_log.work);
+		pthread_cond_destroy(&Lt_log.done);
+		lt_log(LT_LOG_ERROR, "lt_log_start: pthread_create() failed");
+		return CS_FAIL;
+	}
+	__atomic_store_n(&Lt_log.started, CS_TRUE, __ATOMIC_RELEASE);
+	return CS_SUCCEED;
+}
+
+/*
+** lt_log_stop()
+**
+** Type of function:
+** 	logger api
+**
+** Purpose:
+** 	Write the queue out a last time and stop the logger thread; the
+** 	messages logged after are written at once. Called once the other
+** 	threads have stopped.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_log_stop(CS_VOID)
+{
+	if (!Lt_log.started)
+	{
+		return;
+	}
+
+	__atomic_store_n(&Lt_log.started, CS_FALSE, __ATOMIC_RELEASE);
+	pthread_mutex_lock(&Lt_log.lock);
+	Lt_log.stop = CS_TRUE;
+	pthread_cond_signal(&Lt_log.work);
+	pthread_mutex_unlock(&Lt_log.lock);
+	pthread_join(Lt_log.thread, NULL);
+
+	/*
+	** Messages queued by a thread that saw the logger running just
+	** before the stop.
+	*/
+	lt_log_drain();
+
+	pthread_mutex_destroy(&Lt_log.lock);
+	pthread_cond_destroy(&Lt_log.work);
+	pthread_cond_destroy(&Lt_log.done);
+}
+
+/*
+** lt_log_flush()
+**
+** Type of function:
+** 	logger api
+**
+** Purpose:
+** 	Wait until the messages queued so far have been written out, as
+** 	before the program exits on an error.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_log_flush(CS_VOID)
+{
+	CS_UBIGINT	target;
+
+	if (!__atomic_load_n(&Lt_log.started, __ATOMIC_ACQUIRE))
+	{
+		return;
+	}
+
+	target = __atomic_load_n(&Lt_log.tail, __ATOMIC_RELAXED);
+	pthread_mutex_lock(&Lt_log.lock);
+	while (Lt_log.drained < target && !Lt_log.stop)
+	{
+		Lt_log.requested = CS_TRUE;
+		pthread_cond_signal(&Lt_log.work);
+		pthread_cond_wait(&Lt_log.done, &Lt_log.lock);
+	}
+	pthread_mutex_unlock(&Lt_log.lock);
+}
+
+/*
+** lt_log_enabled()
+**
+** Type of function:
+** 	logger api
+**
+** Purpose:
+** 	Tell whether messages of a level are logged, to skip building the
+** 	text of those that are not.
+**
+** Parameters:
+** 	level		- The level.
+**
+** Returns:
+** 	CS_TRUE if they are, CS_FALSE otherwise.
+*/
+
+CS_BOOL CS_PUBLIC
+lt_log_enabled(CS_INT level)
+{
+	return (level >= Lt_log_level);
+}
+
+/*
+** lt_log()
+**
+** Type of function:
+** 	logger api
+**
+** Purpose:
+** 	Log a message: DEBUG and MESSAGE lines go to EX_STANDARD_OUT,
+** 	WARNING and ERROR lines to EX_ERROR_OUT. While an output sink has
+** 	claimed stdout, all of them go to EX_ERROR_OUT.
+**
+** Parameters:
+** 	level		- Its level, LT_LOG_DEBUG to LT_LOG_ERROR.
+** 	fmt		- A printf() format, and its arguments.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_log(CS_INT level, CS_CHAR *fmt, ...)
+{
+	CS_CHAR		text[LT_LOG_MSGLEN];
+	CS_CHAR		note[LT_LOG_MSGLEN];
+	CS_BIGINT	repeats;
+	CS_BOOL		same = CS_TRUE;
+	va_list		ap;
+	int		len;
+
+	level = MAX(MIN(level, LT_LOG_ERROR), LT_LOG_DEBUG);
+	if (!lt_log_enabled(level))
+	{
+		return;
+	}
+
+	va_start(ap, fmt);
+	len = vsnprintf(text, sizeof (text), fmt, ap);
+	va_end(ap);
+	if (len < 0)
+	{
+		return;
+	}
+	if (len >= (int)sizeof (text))
+	{
+		len = sizeof (text) - 1;
+		memcpy(text + len - 3, "...", 3);
+	}
+
+	if (Lt_log.burst > 0)
+	{
+		if ((repeats = lt_log_limit(lt_log_hash(text, len), &same)) < 0)
+		{
+			return;
+		}
+		if (repeats > 0 && same)
+		{
+			snprintf(note, sizeof (note), " [%lld repeats suppressed]",
+				 (long long)repeats);
+			if (len + strlen(note) < sizeof (text))
+			{
+				strcpy(text + len, note);
+				len += strlen(note);
+			}
+		}
+		else if (repeats > 0)
+		{
+			snprintf(note, sizeof (note),
+				 "%lld repeats of other messages were suppressed",
+				 (long long)repeats);
+			lt_log_put(level, note, strlen(note));
+		}
+	}
+
+	LT_METRIC_ADD(&Lt_log_messages[level], 1);
+	lt_log_put(level, text, len);
+}
@@ -0,0 +1,100 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	leveled, asynchronous logger in ltlog.c.
+**
+*/
+
+#ifndef __LTLOG_H__
+#define __LTLOG_H__
+
+#include "ltchange.h"
+#include "lthist.h"
+#include "ltmetrics.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** Log levels. Messages below the level set are dropped before they are
+** formatted.
+*/
+#define LT_LOG_DEBUG		0
+#define LT_LOG_INFO		1
+#define LT_LOG_WARN		2
+#define LT_LOG_ERROR		3
+#define LT_LOG_NLEVELS		4
+
+/*
+** Slots of the message queue, a power of two, and the bytes of a message
+** in one; longer messages are cut short and end in "...".
+*/
+#define LT_LOG_SLOTS		1024
+#define LT_LOG_MSGLEN		512
+
+/*
+** Slots of the table of recent messages the rate limit is kept in.
+*/
+#define LT_LOG_RATESLOTS	256
+
+/*
+** A slot of the message queue. 'seq' tells whose turn it is: a writer may
+** fill the slot when it equals the queue position being claimed, and the
+** logger thread may take the message once it is one past it.
+*/
+typedef struct _lt_log_slot
+{
+	CS_UBIGINT	seq;
+	CS_INT		level;
+	CS_CHAR		text[LT_LOG_MSGLEN];
+} LT_LOG_SLOT;
+
+#ifdef __GNUC__
+#define LT_LOG_PRINTF_ATTR	__attribute__((format(printf, 2, 3)))
+#else
+#define LT_LOG_PRINTF_ATTR
+#endif
+
+/*****************************************************************************
+**
+** data shared with the metrics
+**
+*****************************************************************************/
+/* ltlog.c */
+extern LT_METRIC Lt_log_messages[LT_LOG_NLEVELS];
+extern LT_METRIC Lt_log_suppressed;
+extern LT_METRIC Lt_log_dropped;
+extern CS_CHAR *Lt_log_labels[LT_LOG_NLEVELS];
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltlog.c */
+extern CS_RETCODE CS_PUBLIC lt_log_start(
+	CS_INT level,
+	CS_INT interval,
+	CS_INT burst,
+	CS_INT window
+	);
+extern CS_VOID CS_PUBLIC lt_log_stop(
+	CS_VOID
+	);
+extern CS_VOID CS_PUBLIC lt_log_flush(
+	CS_VOID
+	);
+extern CS_BOOL CS_PUBLIC lt_log_enabled(
+	CS_INT level
+	);
+extern CS_VOID CS_PUBLIC lt_log(
+	CS_INT level,
+	CS_CHAR *fmt,
+	...
+	) LT_LOG_PRINTF_ATTR;
+
+#endif /* __LTLOG_H__ */
@@ -0,0 +1,325 @@
+/*
+** Description
+** -----------
+** 	This file implements a fast LZ77 block codec producing the LZ4 block
+** 	format, so blocks can also be read with any LZ4 implementation's
+** 	block decoder.
+**
+** 	A block is a series of sequences, each a token byte whose high and
+** 	low nibbles are a literal length and a match length less 4, a length
+** 	of 15 continuing in following bytes of up to 255 each, then the
+** 	literals, then a 2 byte little endian match offset. The last
+** 	sequence has literals only; a match never starts in the last 12
+** 	bytes nor covers the last 5.
+**
+** 	The compressor finds matches through a hash table of the positions
+** 	of 4 byte sequences, and steps faster over input that does not
+** 	match.
+**
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctpublic.h>
+#include "ltlz.h"
+
+#define LT_LZ_MINMATCH		4
+#define LT_LZ_LASTLITERALS	5
+#define LT_LZ_MFLIMIT		12
+#define LT_LZ_MAXOFFSET		65535
+#define LT_LZ_HASHBITS		12
+#define LT_LZ_SKIPTRIGGER	6
+
+#define LT_LZ_HASH(_v)	(((_v) * 2654435761U) >> (32 - LT_LZ_HASHBITS))
+
+/*****************************************************************************
+**
+** codec functions
+**
+*****************************************************************************/
+
+/*
+** lt_lz_read32()
+**
+** Type of function:
+** 	block compression internal api
+**
+** Purpose:
+** 	Read 4 unaligned bytes.
+**
+** Parameters:
+** 	p		- The bytes.
+**
+** Returns:
+** 	Their value.
+*/
+
+CS_STATIC CS_UINT
+lt_lz_read32(CS_BYTE *p)
+{
+	CS_UINT		v;
+
+	memcpy(&v, p, sizeof (v));
+	return v;
+}
+
+/*
+** lt_lz_putlen()
+**
+** Type of function:
+** 	block compression internal api
+**
+** Purpose:
+** 	Write the continuation bytes of a length of 15 or more.
+**
+** Parameters:
+** 	op		- Where to write them.
+** 	len		- The length, less the 15 held in the token.
+**
+** Returns:
+** 	The position after them.
+*/
+
+CS_STATIC CS_BYTE *
+lt_lz_putlen(CS_BYTE *op, CS_INT len)
+{
+	while (len >= 255)
+	{
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = (CS_BYTE)len;
+	return op;
+}
+
+/*
+** lt_lz_compress()
+**
+** Type of function:
+** 	block compression api
+**
+** Purpose:
+** 	Compress a block.
+**
+** Parameters:
+** 	src		- The input.
+** 	srclen		- Its length.
+** 	dst		- The output buffer.
+** 	dstlen		- Its size; LT_LZ_BOUND(srclen) always suffices.
+**
+** Returns:
+** 	The compressed length, or 0 if it does not fit in 'dstlen'.
+*/
+
+CS_INT CS_PUBLIC
+lt_lz_compress(CS_BYTE *src, CS_INT srclen, CS_BYTE *dst, CS_INT dstlen)
+{
+	CS_UINT		table[1 << LT_LZ_HASHBITS];
+	CS_BYTE		*ip = src;
+	CS_BYTE		*anchor = src;
+	CS_BYTE		*iend = src + srclen;
+	CS_BYTE		*mflimit = iend - LT_LZ_MFLIMIT;
+	CS_BYTE		*matchlimit = iend - LT_LZ_LASTLITERALS;
+	CS_BYTE		*op = dst;
+	CS_BYTE		*oend = dst + dstlen;
+	CS_BYTE		*ref;
+	CS_BYTE		*token;
+	CS_UINT		h;
+	CS_INT		lit;
+	CS_INT		mlen;
+	CS_INT		misses = 0;
+
+	memset(table, 0, sizeof (table));
+	if (srclen >= LT_LZ_MFLIMIT + 1)
+	{
+		ip++;
+		while (ip < mflimit)
+		{
+			h = LT_LZ_HASH(lt_lz_read32(ip));
+			ref = src + table[h];
+			table[h] = (CS_UINT)(ip - src);
+			if (ip - ref > LT_LZ_MAXOFFSET ||
+			    lt_lz_read32(ref) != lt_lz_read32(ip))
+			{
+				ip += 1 + (misses++ >> LT_LZ_SKIPTRIGGER);
+				continue;
+			}
+			misses = 0;
+
+			/*
+			** Extend the match backwards over the pending
+			** literals, then forwards.
+			*/
+			while (ip > anchor && ref > src && ip[-1] == ref[-1])
+			{
+				ip--;
+				ref--;
+			}
+			mlen = LT_LZ_MINMATCH;
+			while (ip + mlen < matchlimit && ip[mlen] == ref[mlen])
+			{
+				mlen++;
+			}
+
+			lit = ip - anchor;
+			if (op + 1 + lit + lit / 255 + 2 + 1 + mlen / 255 +
+			    1 + LT_LZ_LASTLITERALS > oend)
+			{
+				return 0;
+			}
+			token = op++;
+			if (lit >= 15)
+			{
+				*token = 15 << 4;
+				op = lt_lz_putlen(op, lit - 15);
+			}
+			else
+			{
+				*token = (CS_BYTE)(lit << 4);
+			}
+			memcpy(op, anchor, lit);
+			op += lit;
+			*op++ = (CS_BYTE)((ip - ref) & 0xff);
+			*op++ = (CS_BYTE)((ip - ref) >> 8);
+			if (mlen - LT_LZ_MINMATCH >= 15)
+			{
+				*token |= 15;
+				op = lt_lz_putlen(op, mlen - LT_LZ_MINMATCH - 15);
+			}
+			else
+			{
+				*token |= (CS_BYTE)(mlen - LT_LZ_MINMATCH);
+			}
+
+			ip += mlen;
+			anchor = ip;
+			if (ip - 2 > src && ip - 2 < mflimit)
+			{
+				table[LT_LZ_HASH(lt_lz_read32(ip - 2))] =
+					(CS_UINT)(ip - 2 - src);
+			}
+		}
+	}
+
+	lit = iend - anchor;
+	if (op + 1 + lit + lit / 255 + 1 > oend)
+	{
+		return 0;
+	}
+	if (lit >= 15)
+	{
+		*op++ = 15 << 4;
+		op = lt_lz_putlen(op, lit - 15);
+	}
+	else
+	{
+		*op++ = (CS_BYTE)(lit << 4);
+	}
+	memcpy(op, anchor, lit);
+	op += lit;
+	return op - dst;
+}
+
+/*
+** lt_lz_decompress()
+**
+** Type of function:
+** 	block compression api
+**
+** Purpose:
+** 	Decompress a block, checking every length and offset against the
+** 	bounds of the input and output.
+**
+** Parameters:
+** 	src		- The compressed block.
+** 	srclen		- Its length.
+** 	dst		- The output buffer.
+** 	dstlen		- Its size.
+**
+** Returns:
+** 	The decompressed length, or -1 if the block is malformed or does
+** 	not fit in 'dstlen'.
+*/
+
+CS_INT CS_PUBLIC
+lt_lz_decompress(CS_BYTE *src, CS_INT srclen, CS_BYTE *dst, CS_INT dstlen)
+{
+	CS_BYTE		*ip = src;
+	CS_BYTE		*iend = src + srclen;
+	CS_BYTE		*op = dst;
+	CS_BYTE		*oend = dst + dstlen;
+	CS_BYTE		*ref;
+	CS_BYTE		token;
+	CS_INT		len;
+	CS_INT		off;
+	CS_BYTE		b;
+
+	while (ip < iend)
+	{
+		token = *ip++;
+		len = token >> 4;
+		if (len == 15)
+		{
+			do
+			{
+				if (ip >= iend)
+				{
+					return -1;
+				}
+				b = *ip++;
+				len += b;
+			} while (b == 255);
+		}
+		if (len > iend - ip || len > oend - op)
+		{
+			return -1;
+		}
+		memcpy(op, ip, len);
+		ip += len;
+		op += len;
+		if (ip == iend)
+		{
+			break;
+		}
+
+		if (iend - ip < 2)
+		{
+			return -1;
+		}
+		off = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (off == 0 || off > op - dst)
+		{
+			return -1;
+		}
+		len = token & 15;
+		if (len == 15)
+		{
+			do
+			{
+				if (ip >= iend)
+				{
+					return -1;
+				}
+				b = *ip++;
+				len += b;
+			} while (b == 255);
+		}
+		len += LT_LZ_MINMATCH;
+		if (len > oend - op)
+		{
+			return -1;
+		}
+
+		/*
+		** The match may overlap its own output, so copy forwards
+		** a byte at a time.
+		*/
+		ref = op - off;
+		while (len-- > 0)
+		{
+			*op++ = *ref++;
+		}
+	}
+	return op - dst;
+}
@@ -0,0 +1,42 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	block compression codec in ltlz.c.
+**
+*/
+
+#ifndef __LTLZ_H__
+#define __LTLZ_H__
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** Largest compressed size of 'n' bytes of input.
+*/
+#define LT_LZ_BOUND(_n)		((_n) + (_n) / 255 + 16)
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltlz.c */
+extern CS_INT CS_PUBLIC lt_lz_compress(
+	CS_BYTE *src,
+	CS_INT srclen,
+	CS_BYTE *dst,
+	CS_INT dstlen
+	);
+extern CS_INT CS_PUBLIC lt_lz_decompress(
+	CS_BYTE *src,
+	CS_INT srclen,
+	CS_BYTE *dst,
+	CS_INT dstlen
+	);
+
+#endif /* __LTLZ_H__ */
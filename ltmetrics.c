@@ -0,0 +1,1000 @@
+/*
+** Description
+** -----------
+** 	This file implements the metrics registry: counters, gauges and
+** 	histograms that the scan and the sinks update as they go, and that
+** 	are read without stopping them. The metrics are structures owned by
+** 	their modules, registered once and never removed; their values are
+** 	only ever updated with atomic operations, so updating one is a
+** 	single atomic add or store and neither updates nor reads take a
+** 	lock. Only registration does, against other registrations.
+**
+** 	A thread of its own serves the registry as Prometheus text to HTTP
+** 	clients on a local TCP port, and writes a stats line to EX_ERROR_OUT
+** 	at a fixed interval: the rate of each counter over the interval,
+** 	the value of each gauge, and the median and 99th percentile of the
+** 	values each histogram recorded over the interval.
+**
+** 	The thread is optional: until lt_metrics_start() is called the
+** 	metrics are still kept, and lt_metrics_format() can read them.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltbatch.h"
+#include "lthist.h"
+#include "ltmetrics.h"
+
+#define LT_METRICS_HOST		"127.0.0.1"
+#define LT_METRICS_BACKLOG	16
+#define LT_METRICS_LINELEN	512
+
+/*
+** The registry. 'lock' serializes registrations, which append to the
+** list at 'head' through 'tail'; readers follow the list without it.
+** The rest is the state of the metrics thread: 'wake' is a pipe that
+** wakes it to stop, and 'laststats' the time of the last stats line.
+*/
+CS_STATIC struct
+{
+	LT_METRIC		*head;
+	LT_METRIC		**tail;
+	pthread_mutex_t		lock;
+	CS_BOOL			started;
+	pthread_t		thread;
+	int			listenfd;
+	int			wake[2];
+	CS_INT			interval;
+	CS_BIGINT		laststats;
+} Lt_metrics = { NULL, &Lt_metrics.head, PTHREAD_MUTEX_INITIALIZER };
+
+/*****************************************************************************
+**
+** private functions
+**
+*****************************************************************************/
+
+/*
+** lt_metrics_register()
+**
+** Type of function:
+** 	metrics registry internal api
+**
+** Purpose:
+** 	Fill in a metric and append it to the registry, unless it is there
+** 	already.
+**
+** Parameters:
+** 	metric		- The metric.
+** 	type		- LT_METRIC_COUNTER, LT_METRIC_GAUGE or
+** 			  LT_METRIC_HISTOGRAM.
+** 	name		- Its name.
+** 	help		- Its help text.
+** 	labels		- Its label pairs, or NULL.
+** 	stat		- Its key in the stats line, or NULL.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_metrics_register(LT_METRIC *metric, CS_INT type, CS_CHAR *name,
+		    CS_CHAR *help, CS_CHAR *labels, CS_CHAR *stat)
+{
+	pthread_mutex_lock(&Lt_metrics.lock);
+	if (metric->registered)
+	{
+		pthread_mutex_unlock(&Lt_metrics.lock);
+		return;
+	}
+	metric->type = type;
+	metric->name = name;
+	metric->help = help;
+	metric->labels = labels;
+	metric->stat = stat;
+	metric->last = __atomic_load_n(&metric->value, __ATOMIC_RELAXED);
+	metric->registered = CS_TRUE;
+	metric->next = NULL;
+
+	/*
+	** The metric is filled in before readers can reach it.
+	*/
+	__atomic_store_n(Lt_metrics.tail, metric, __ATOMIC_RELEASE);
+	Lt_metrics.tail = &metric->next;
+	pthread_mutex_unlock(&Lt_metrics.lock);
+}
+
+/*
+** lt_metrics_first()
+**
+** Type of function:
+** 	metrics registry internal api
+**
+** Purpose:
+** 	Get the first metric of the registry.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	The metric, or NULL if there is none.
+*/
+
+CS_STATIC LT_METRIC *
+lt_metrics_first(CS_VOID)
+{
+	return __atomic_load_n(&Lt_metrics.head, __ATOMIC_ACQUIRE);
+}
+
+/*
+** lt_metrics_next()
+**
+** Type of function:
+** 	metrics registry internal api
+**
+** Purpose:
+** 	Get the metric registered after another.
+**
+** Parameters:
+** 	metric		- The metric.
+**
+** Returns:
+** 	The next metric, or NULL if there is none.
+*/
+
+CS_STATIC LT_METRIC *
+lt_metrics_next(LT_METRIC *metric)
+{
+	return __atomic_load_n(&metric->next, __ATOMIC_ACQUIRE);
+}
+
+/*
+** lt_metrics_seen()
+**
+** Type of function:
+** 	metrics registry internal api
+**
+** Purpose:
+** 	Tell whether a metric registered before another has the same name,
+** 	or the same stats line key.
+**
+** Parameters:
+** 	metric		- The metric.
+** 	bystat		- CS_TRUE to compare the keys, CS_FALSE the names.
+**
+** Returns:
+** 	CS_TRUE if one has, CS_FALSE otherwise.
+*/
+
+CS_STATIC CS_BOOL
+lt_metrics_seen(LT_METRIC *metric, CS_BOOL bystat)
+{
+	LT_METRIC	*m;
+
+	for (m = lt_metrics_first(); m != metric; m = lt_metrics_next(m))
+	{
+		if (bystat ? (m->stat != NULL && strcmp(m->stat, metric->stat) == 0) :
+			     (strcmp(m->name, metric->name) == 0))
+		{
+			return CS_TRUE;
+		}
+	}
+	return CS_FALSE;
+}
+
+/*
+** lt_metrics_printf()
+**
+** Type of function:
+** 	metrics registry internal api
+**
+** Purpose:
+** 	Append formatted text to a buffer.
+**
+** Parameters:
+** 	buf		- The buffer.
+** 	fmt		- The format, as for printf(), of at most
+** 			  LT_METRICS_LINELEN bytes of text.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if the buffer could not grow.
+*/
+
+CS_STATIC CS_RETCODE
+lt_metrics_printf(LT_BUF *buf, CS_CHAR *fmt, ...)
+{
+	CS_CHAR		line[LT_METRICS_LINELEN];
+	va_list		ap;
+	int		len;
+
+	va_start(ap, fmt);
+	len = vsnprintf(line, sizeof (line), fmt, ap);
+	va_end(ap);
+	if (len < 0)
+	{
+		return CS_SUCCEED;
+	}
+	return lt_buf_append(buf, line, MIN(len, (int)sizeof (line) - 1));
+}
+
+/*
+** lt_metrics_sample()
+**
+** Type of function:
+** 	metrics registry internal api
+**
+** Purpose:
+** 	Append the samples of one metric in the Prometheus text format.
+**
+** Parameters:
+** 	buf		- The buffer.
+** 	metric		- The metric.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if the buffer could not grow.
+*/
+
+CS_STATIC CS_RETCODE
+lt_metrics_sample(LT_BUF *buf, LT_METRIC *metric)
+{
+	LT_HIST		*hist;
+	CS_CHAR		*labels;
+	CS_CHAR		*sep;
+	CS_UBIGINT	cum = 0;
+	CS_INT		i = 0;
+	CS_INT		k;
+	CS_RETCODE	retcode;
+
+	labels = (metric->labels != NULL) ? metric->labels : "";
+	if (metric->type == LT_METRIC_GAUGE && metric->scale != 1)
+	{
+		return lt_metrics_printf(buf, "%s%s%s%s %.9g\n", metric->name,
+			(*labels != '\0') ? "{" : "", labels,
+			(*labels != '\0') ? "}" : "",
+			(double)__atomic_load_n(&metric->value,
+						__ATOMIC_RELAXED) / metric->scale);
+	}
+	if (metric->type != LT_METRIC_HISTOGRAM)
+	{
+		return lt_metrics_printf(buf, "%s%s%s%s %lld\n", metric->name,
+			(*labels != '\0') ? "{" : "", labels,
+			(*labels != '\0') ? "}" : "",
+			(long long)__atomic_load_n(&metric->value,
+						   __ATOMIC_RELAXED));
+	}
+
+	hist = (LT_HIST *)malloc(sizeof (LT_HIST));
+	if (hist == NULL)
+	{
+		ex_error("lt_metrics_sample: malloc() failed");
+		return CS_MEM_ERROR;
+	}
+	lt_hist_snapshot(hist, metric->hist);
+	sep = (*labels != '\0') ? "," : "";
+
+	/*
+	** The buckets below 2^k hold exactly the values below it.
+	*/
+	retcode = CS_SUCCEED;
+	for (k = 0; k <= LT_METRICS_TOPBIT && retcode == CS_SUCCEED; k++)
+	{
+		while (i < LT_HIST_NBUCKETS &&
+		       lt_hist_bound(i) < ((CS_UBIGINT)1 << k))
+		{
+			cum += hist->counts[i++];
+		}
+		retcode = lt_metrics_printf(buf, "%s_bucket{%s%sle=\"%.9g\"} %llu\n",
+			metric->name, labels, sep,
+			(double)((CS_UBIGINT)1 << k) / metric->scale,
+			(unsigned long long)cum);
+	}
+	while (i < LT_HIST_NBUCKETS)
+	{
+		cum += hist->counts[i++];
+	}
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = lt_metrics_printf(buf,
+			"%s_bucket{%s%sle=\"+Inf\"} %llu\n"
+			"%s_sum%s%s%s %.9g\n"
+			"%s_count%s%s%s %llu\n",
+			metric->name, labels, sep, (unsigned long long)cum,
+			metric->name, (*labels != '\0') ? "{" : "", labels,
+			(*labels != '\0') ? "}" : "",
+			(double)hist->sum / metric->scale,
+			metric->name, (*labels != '\0') ? "{" : "", labels,
+			(*labels != '\0') ? "}" : "",
+			(unsigned long long)cum);
+	}
+	free(hist);
+	return retcode;
+}
+
+/*
+** lt_metrics_interval()
+**
+** Type of function:
+** 	metrics registry internal api
+**
+** Purpose:
+** 	Add the values a histogram metric recorded since the last stats
+** 	line to a histogram, and remember its values for the next line.
+**
+** Parameters:
+** 	metric		- The metric.
+** 	snap		- Scratch space for a copy of its histogram.
+** 	delta		- The histogram added to.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_metrics_interval(LT_METRIC *metric, LT_HIST *snap, LT_HIST *delta)
+{
+	CS_UBIGINT	n;
+	CS_UBIGINT	top = 0;
+	CS_INT		i;
+
+	lt_hist_snapshot(snap, metric->hist);
+	for (i = 0; i < LT_HIST_NBUCKETS; i++)
+	{
+		n = snap->counts[i] - metric->lasthist->counts[i];
+		if (n > 0)
+		{
+			delta->counts[i] += n;
+			top = lt_hist_bound(i);
+		}
+	}
+	delta->count += snap->count - metric->lasthist->count;
+	delta->sum += snap->sum - metric->lasthist->sum;
+
+	/*
+	** The largest value of the interval is only known to its bucket.
+	*/
+	top = MIN(top, snap->max);
+	delta->max = MAX(delta->max, top);
+	memcpy(metric->lasthist, snap, sizeof (LT_HIST));
+}
+
+/*
+** lt_metrics_listen()
+**
+** Type of function:
+** 	metrics registry internal api
+**
+** Purpose:
+** 	Create the non-blocking listening socket of the HTTP endpoint.
+**
+** Parameters:
+** 	address		- "[host:]port", the host being the loopback address
+** 			  unless given.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the socket could not be set up.
+*/
+
+CS_STATIC CS_RETCODE
+lt_metrics_listen(CS_CHAR *address)
+{
+	struct sockaddr_in	sin;
+	CS_CHAR			host[64];
+	CS_CHAR			*colon;
+	int			on = 1;
+
+	strcpy(host, LT_METRICS_HOST);
+	if ((colon = strrchr(address, ':')) != NULL)
+	{
+		if (colon - address >= (int)sizeof (host))
+		{
+			ex_error("lt_metrics_listen: bad address");
+			return CS_FAIL;
+		}
+		memcpy(host, address, colon - address);
+		host[colon - address] = '\0';
+		address = colon + 1;
+	}
+	memset(&sin, 0, sizeof (sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons((unsigned short)atoi(address));
+	if (inet_pton(AF_INET, host, &sin.sin_addr) != 1)
+	{
+		ex_error("lt_metrics_listen: bad address");
+		return CS_FAIL;
+	}
+	Lt_metrics.listenfd = socket(AF_INET, SOCK_STREAM, 0);
+	if (Lt_metrics.listenfd < 0 ||
+	    setsockopt(Lt_metrics.listenfd, SOL_SOCKET, SO_REUSEADDR, &on,
+			sizeof (on)) != 0 ||
+	    bind(Lt_metrics.listenfd, (struct sockaddr *)&sin,
+		 sizeof (sin)) != 0)
+	{
+		ex_error("lt_metrics_listen: bind() failed");
+		return CS_FAIL;
+	}
+	if (listen(Lt_metrics.listenfd, LT_METRICS_BACKLOG) != 0)
+	{
+		ex_error("lt_metrics_listen: listen() failed");
+		return CS_FAIL;
+	}
+	fcntl(Lt_metrics.listenfd, F_SETFL,
+	      fcntl(Lt_metrics.listenfd, F_GETFL) | O_NONBLOCK);
+	return CS_SUCCEED;
+}
+
+/*
+** lt_metrics_serve()
+**
+** Type of function:
+** 	metrics registry internal api
+**
+** Purpose:
+** 	Answer one HTTP request on a connection, and close it. "GET /metrics"
+** 	and "GET /" are answered with the registry, anything else with an
+** 	error status. A client has LT_METRICS_REQSECS seconds to send its
+** 	request.
+**
+** Parameters:
+** 	fd		- The connection.
+** 	buf		- Buffer for the response.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_metrics_serve(int fd, LT_BUF *buf)
+{
+	struct timeval	tv;
+	CS_CHAR		req[LT_METRICS_REQLEN + 1];
+	CS_CHAR		method[16];
+	CS_CHAR		path[256];
+	CS_CHAR		header[256];
+	CS_CHAR		*status = "200 OK";
+	CS_INT		len = 0;
+	CS_INT		hlen;
+	CS_INT		off;
+	ssize_t		n;
+
+	tv.tv_sec = LT_METRICS_REQSECS;
+	tv.tv_usec = 0;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof (tv));
+
+	/*
+	** Only the request line matters; the headers are read through the
+	** blank line ending them, as far as they fit.
+	*/
+	while (len < LT_METRICS_REQLEN)
+	{
+		n = recv(fd, req + len, LT_METRICS_REQLEN - len, 0);
+		if (n <= 0)
+		{
+			break;
+		}
+		len += (CS_INT)n;
+		req[len] = '\0';
+		if (strstr(req, "\r\n\r\n") != NULL || strstr(req, "\n\n") != NULL)
+		{
+			break;
+		}
+	}
+	req[len] = '\0';
+	if (sscanf(req, "%15s %255s", method, path) != 2)
+	{
+		close(fd);
+		return;
+	}
+
+	buf->len = 0;
+	if (strcmp(method, "GET") != 0)
+	{
+		status = "405 Method Not Allowed";
+	}
+	else if (strcmp(path, "/metrics") != 0 && strcmp(path, "/") != 0)
+	{
+		status = "404 Not Found";
+	}
+	else if (lt_metrics_format(buf) != CS_SUCCEED)
+	{
+		status = "500 Internal Server Error";
+		buf->len = 0;
+	}
+	hlen = snprintf(header, sizeof (header),
+		"HTTP/1.0 %s\r\n"
+		"Content-Type: text/plain; version=0.0.4\r\n"
+		"Content-Length: %d\r\n"
+		"Connection: close\r\n\r\n", status, buf->len);
+
+	if (send(fd, header, hlen, MSG_NOSIGNAL) == hlen)
+	{
+		for (off = 0; off < buf->len; off += (CS_INT)n)
+		{
+			n = send(fd, buf->data + off, buf->len - off, MSG_NOSIGNAL);
+			if (n <= 0)
+			{
+				break;
+			}
+		}
+	}
+	close(fd);
+}
+
+/*
+** lt_metrics_close()
+**
+** Type of function:
+** 	metrics registry internal api
+**
+** Purpose:
+** 	Close the listening socket and the wake pipe.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_metrics_close(CS_VOID)
+{
+	if (Lt_metrics.listenfd >= 0)
+	{
+		close(Lt_metrics.listenfd);
+		Lt_metrics.listenfd = -1;
+	}
+	close(Lt_metrics.wake[0]);
+	close(Lt_metrics.wake[1]);
+}
+
+/*
+** lt_metrics_report()
+**
+** Type of function:
+** 	metrics registry internal api
+**
+** Purpose:
+** 	Write the stats line for the interval since the last one.
+**
+** Parameters:
+** 	buf		- Buffer for the line.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_metrics_report(LT_BUF *buf)
+{
+	CS_BIGINT	now;
+
+	now = lt_clock_usec();
+	buf->len = 0;
+	if (lt_metrics_stats(buf, now - Lt_metrics.laststats) == CS_SUCCEED)
+	{
+		fprintf(EX_ERROR_OUT, "%.*s", buf->len, (char *)buf->data);
+		fflush(EX_ERROR_OUT);
+	}
+	Lt_metrics.laststats = now;
+}
+
+/*
+** lt_metrics_thread()
+**
+** Type of function:
+** 	metrics registry internal api
+**
+** Purpose:
+** 	The metrics thread: serve HTTP clients as they connect, and write a
+** 	stats line every 'interval' seconds, until woken to stop.
+**
+** Parameters:
+** 	arg		- Unused.
+**
+** Returns:
+** 	NULL.
+*/
+
+CS_STATIC CS_VOID *
+lt_metrics_thread(CS_VOID *arg)
+{
+	struct pollfd	pfds[2];
+	LT_BUF		buf = { NULL, 0, 0 };
+	CS_BIGINT	due;
+	CS_BIGINT	now;
+	int		timeout;
+	int		fd;
+	int		n;
+
+	pfds[0].fd = Lt_metrics.wake[0];
+	pfds[0].events = POLLIN;
+	pfds[1].fd = Lt_metrics.listenfd;
+	pfds[1].events = POLLIN;
+	n = (Lt_metrics.listenfd >= 0) ? 2 : 1;
+
+	for (;;)
+	{
+		timeout = -1;
+		if (Lt_metrics.interval > 0)
+		{
+			due = Lt_metrics.laststats +
+				(CS_BIGINT)Lt_metrics.interval * 1000000;
+			now = lt_clock_usec();
+			timeout = (due > now) ? (int)((due - now + 999) / 1000) : 0;
+		}
+		pfds[0].revents = pfds[1].revents = 0;
+		if (poll(pfds, n, timeout) < 0 && errno != EINTR)
+		{
+			ex_error("lt_metrics_thread: poll() failed");
+			break;
+		}
+		if (pfds[0].revents != 0)
+		{
+			break;
+		}
+		if (n > 1 && (pfds[1].revents & POLLIN) &&
+		    (fd = accept(Lt_metrics.listenfd, NULL, NULL)) >= 0)
+		{
+			lt_metrics_serve(fd, &buf);
+		}
+		if (Lt_metrics.interval > 0 &&
+		    lt_clock_usec() >= Lt_metrics.laststats +
+				       (CS_BIGINT)Lt_metrics.interval * 1000000)
+		{
+			lt_metrics_report(&buf);
+		}
+	}
+	lt_buf_free(&buf);
+	return NULL;
+}
+
+/*****************************************************************************
+**
+** public functions
+**
+*****************************************************************************/
+
+/*
+** lt_metrics_counter()
+**
+** Type of function:
+** 	metrics registry api
+**
+** Purpose:
+** 	Register a counter. Registering a metric again does nothing.
+**
+** Parameters:
+** 	metric		- The counter.
+** 	name		- Its name, ending in "_total".
+** 	help		- Its help text.
+** 	labels		- Its label pairs, or NULL.
+** 	stat		- Its key in the stats line, or NULL.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_metrics_counter(LT_METRIC *metric, CS_CHAR *name, CS_CHAR *help,
+		   CS_CHAR *labels, CS_CHAR *stat)
+{
+	lt_metrics_register(metric, LT_METRIC_COUNTER, name, help, labels, stat);
+}
+
+/*
+** lt_metrics_gauge()
+**
+** Type of function:
+** 	metrics registry api
+**
+** Purpose:
+** 	Register a gauge. Registering a metric again does nothing.
+**
+** Parameters:
+** 	metric		- The gauge.
+** 	name		- Its name.
+** 	help		- Its help text.
+** 	labels		- Its label pairs, or NULL.
+** 	stat		- Its key in the stats line, or NULL. The line shows
+** 			  the value in the units set.
+** 	scale		- The units set per unit exposed.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_metrics_gauge(LT_METRIC *metric, CS_CHAR *name, CS_CHAR *help,
+		 CS_CHAR *labels, CS_CHAR *stat, double scale)
+{
+	if (!metric->registered)
+	{
+		metric->scale = (scale > 0) ? scale : 1;
+	}
+	lt_metrics_register(metric, LT_METRIC_GAUGE, name, help, labels, stat);
+}
+
+/*
+** lt_metrics_histogram()
+**
+** Type of function:
+** 	metrics registry api
+**
+** Purpose:
+** 	Register a histogram. Registering a metric again does nothing.
+**
+** Parameters:
+** 	metric		- The histogram.
+** 	name		- Its name.
+** 	help		- Its help text.
+** 	labels		- Its label pairs, or NULL.
+** 	stat		- Its key in the stats line, or NULL. The line shows
+** 			  the quantiles in the units recorded.
+** 	scale		- The units recorded per unit exposed.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_metrics_histogram(LT_METRIC_HIST *metric, CS_CHAR *name, CS_CHAR *help,
+		     CS_CHAR *labels, CS_CHAR *stat, double scale)
+{
+	if (!metric->metric.registered)
+	{
+		metric->metric.hist = &metric->hist;
+		metric->metric.lasthist = &metric->last;
+		metric->metric.scale = (scale > 0) ? scale : 1;
+		lt_hist_snapshot(&metric->last, &metric->hist);
+	}
+	lt_metrics_register(&metric->metric, LT_METRIC_HISTOGRAM, name, help,
+			    labels, stat);
+}
+
+/*
+** lt_metrics_format()
+**
+** Type of function:
+** 	metrics registry api
+**
+** Purpose:
+** 	Append the registry to a buffer in the Prometheus text format, the
+** 	metrics sharing a name grouped under one help and type line.
+**
+** Parameters:
+** 	buf		- The buffer.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if the buffer could not grow.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_metrics_format(LT_BUF *buf)
+{
+	LT_METRIC	*metric;
+	LT_METRIC	*m;
+	CS_RETCODE	retcode = CS_SUCCEED;
+
+	for (metric = lt_metrics_first(); metric != NULL && retcode == CS_SUCCEED;
+	     metric = lt_metrics_next(metric))
+	{
+		if (lt_metrics_seen(metric, CS_FALSE))
+		{
+			continue;
+		}
+		retcode = lt_metrics_printf(buf, "# HELP %s %s\n# TYPE %s %s\n",
+			metric->name, metric->help, metric->name,
+			(metric->type == LT_METRIC_COUNTER) ? "counter" :
+			(metric->type == LT_METRIC_GAUGE) ? "gauge" : "histogram");
+		for (m = metric; m != NULL && retcode == CS_SUCCEED;
+		     m = lt_metrics_next(m))
+		{
+			if (strcmp(m->name, metric->name) == 0)
+			{
+				retcode = lt_metrics_sample(buf, m);
+			}
+		}
+	}
+	return retcode;
+}
+
+/*
+** lt_metrics_stats()
+**
+** Type of function:
+** 	metrics registry api
+**
+** Purpose:
+** 	Append the stats line for the interval since the last one to a
+** 	buffer: for each stats key, the rate per second of its counters,
+** 	the value of its gauges, or the median and 99th percentile of the
+** 	values its histograms recorded. The metrics thread calls it; only
+** 	one thread may.
+**
+** Parameters:
+** 	buf		- The buffer.
+** 	usecs		- Length of the interval in microseconds.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if memory ran out.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_metrics_stats(LT_BUF *buf, CS_BIGINT usecs)
+{
+	LT_METRIC	*metric;
+	LT_METRIC	*m;
+	LT_HIST		*hists;
+	CS_BIGINT	sum;
+	CS_BIGINT	value;
+	double		secs;
+	CS_RETCODE	retcode;
+
+	hists = (LT_HIST *)malloc(2 * sizeof (LT_HIST));
+	if (hists == NULL)
+	{
+		ex_error("lt_metrics_stats: malloc() failed");
+		return CS_MEM_ERROR;
+	}
+	secs = (usecs > 0) ? usecs / 1000000.0 : 1;
+	retcode = lt_metrics_printf(buf, "stats:");
+
+	for (metric = lt_metrics_first(); metric != NULL && retcode == CS_SUCCEED;
+	     metric = lt_metrics_next(metric))
+	{
+		if (metric->stat == NULL || lt_metrics_seen(metric, CS_TRUE))
+		{
+			continue;
+		}
+		sum = 0;
+		lt_hist_reset(&hists[1]);
+		for (m = metric; m != NULL; m = lt_metrics_next(m))
+		{
+			if (m->stat == NULL || strcmp(m->stat, metric->stat) != 0)
+			{
+				continue;
+			}
+			if (m->type == LT_METRIC_HISTOGRAM)
+			{
+				lt_metrics_interval(m, &hists[0], &hists[1]);
+				continue;
+			}
+			value = __atomic_load_n(&m->value, __ATOMIC_RELAXED);
+			sum += (m->type == LT_METRIC_COUNTER) ? value - m->last : value;
+			m->last = value;
+		}
+		if (metric->type == LT_METRIC_COUNTER)
+		{
+			retcode = lt_metrics_printf(buf, " %s=%.1f/s", metric->stat,
+						    sum / secs);
+		}
+		else if (metric->type == LT_METRIC_GAUGE)
+		{
+			retcode = lt_metrics_printf(buf, " %s=%lld", metric->stat,
+						    (long long)sum);
+		}
+		else
+		{
+			retcode = lt_metrics_printf(buf, " %s_p50=%llu %s_p99=%llu",
+				metric->stat,
+				(unsigned long long)lt_hist_quantile(&hists[1], 0.5),
+				metric->stat,
+				(unsigned long long)lt_hist_quantile(&hists[1], 0.99));
+		}
+	}
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = lt_metrics_printf(buf, "\n");
+	}
+	free(hists);
+	return retcode;
+}
+
+/*
+** lt_metrics_start()
+**
+** Type of function:
+** 	metrics registry api
+**
+** Purpose:
+** 	Start the metrics thread, serving the registry over HTTP at an
+** 	address and writing a stats line at an interval. Does nothing if
+** 	neither is wanted.
+**
+** Parameters:
+** 	address		- "[host:]port" to listen on, or NULL.
+** 	interval	- Seconds between stats lines, or 0 for none.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the socket could not be set up or the
+** 	thread started.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_metrics_start(CS_CHAR *address, CS_INT interval)
+{
+	if (Lt_metrics.started || (address == NULL && interval <= 0))
+	{
+		return CS_SUCCEED;
+	}
+	Lt_metrics.listenfd = -1;
+	Lt_metrics.interval = interval;
+	Lt_metrics.laststats = lt_clock_usec();
+	if (pipe(Lt_metrics.wake) != 0)
+	{
+		ex_error("lt_metrics_start: pipe() failed");
+		return CS_FAIL;
+	}
+	if (address != NULL && lt_metrics_listen(address) != CS_SUCCEED)
+	{
+		lt_metrics_close();
+		return CS_FAIL;
+	}
+	if (pthread_create(&Lt_metrics.thread, NULL, lt_metrics_thread,
+			   NULL) != 0)
+	{
+		ex_error("lt_metrics_start: pthread_create() failed");
+		lt_metrics_close();
+		return CS_FAIL;
+	}
+	Lt_metrics.started = CS_TRUE;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_metrics_stop()
+**
+** Type of function:
+** 	metrics registry api
+**
+** Purpose:
+** 	Stop the metrics thread, and write a last stats line for the
+** 	interval since the one before. The metrics are kept.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_metrics_stop(CS_VOID)
+{
+	LT_BUF		buf = { NULL, 0, 0 };
+
+	if (!Lt_metrics.started)
+	{
+		return;
+	}
+	if (write(Lt_metrics.wake[1], "", 1) != 1)
+	{
+		ex_error("lt_metrics_stop: write() failed");
+	}
+	pthread_join(Lt_metrics.thread, NULL);
+	lt_metrics_close();
+	Lt_metrics.started = CS_FALSE;
+
+	if (Lt_metrics.interval > 0)
+	{
+		lt_metrics_report(&buf);
+	}
+	lt_buf_free(&buf);
+}
@@ -0,0 +1,137 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	metrics registry in ltmetrics.c.
+**
+*/
+
+#ifndef __LTMETRICS_H__
+#define __LTMETRICS_H__
+
+#include "ltchange.h"
+#include "lthist.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** Metric types.
+*/
+#define LT_METRIC_COUNTER	1
+#define LT_METRIC_GAUGE		2
+#define LT_METRIC_HISTOGRAM	3
+
+/*
+** A histogram is exposed with a bucket at every power of two of its unit,
+** from 1 to 2^LT_METRICS_TOPBIT.
+*/
+#define LT_METRICS_TOPBIT	36
+
+/*
+** Size of an HTTP request read, and seconds a client may take to send it.
+*/
+#define LT_METRICS_REQLEN	4096
+#define LT_METRICS_REQSECS	2
+
+/*
+** One metric. 'name' and 'help' are its Prometheus name and help text;
+** 'labels' is its label pairs, as in 'op="13"', or NULL. Metrics sharing
+** a name differ in their labels. 'stat' is its key in the stats line, or
+** NULL to leave it out; the metrics sharing a key are summed there.
+**
+** 'value' is the count or the gauge. It is updated with atomic
+** operations, so any thread may update it while the registry is read.
+** 'hist' is the histogram of a histogram metric. A histogram or a gauge
+** is recorded in units of which 'scale' make one exposed unit, such as
+** 1000000 for microseconds exposed as seconds. 'last' and 'lasthist' are the values at the last
+** stats line, kept by the metrics thread.
+*/
+typedef struct _lt_metric
+{
+	CS_INT			type;
+	CS_CHAR			*name;
+	CS_CHAR			*help;
+	CS_CHAR			*labels;
+	CS_CHAR			*stat;
+	CS_BIGINT		value;
+	LT_HIST			*hist;
+	LT_HIST			*lasthist;
+	double			scale;
+	CS_BIGINT		last;
+	CS_BOOL			registered;
+	struct _lt_metric	*next;
+} LT_METRIC;
+
+/*
+** A histogram metric, with the storage of its histograms.
+*/
+typedef struct _lt_metric_hist
+{
+	LT_METRIC	metric;
+	LT_HIST		hist;
+	LT_HIST		last;
+} LT_METRIC_HIST;
+
+/*
+** Update a counter or a gauge.
+*/
+#define LT_METRIC_ADD(_m, _n)	__atomic_fetch_add(&(_m)->value, \
+	(CS_BIGINT)(_n), __ATOMIC_RELAXED)
+#define LT_METRIC_SET(_m, _v)	__atomic_store_n(&(_m)->value, \
+	(CS_BIGINT)(_v), __ATOMIC_RELAXED)
+
+/*
+** Record a value in a histogram metric.
+*/
+#define LT_METRIC_OBSERVE(_h, _v)	lt_hist_record_atomic(&(_h)->hist, \
+	(CS_UBIGINT)(_v))
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltmetrics.c */
+extern CS_VOID CS_PUBLIC lt_metrics_counter(
+	LT_METRIC *metric,
+	CS_CHAR *name,
+	CS_CHAR *help,
+	CS_CHAR *labels,
+	CS_CHAR *stat
+	);
+extern CS_VOID CS_PUBLIC lt_metrics_gauge(
+	LT_METRIC *metric,
+	CS_CHAR *name,
+	CS_CHAR *help,
+	CS_CHAR *labels,
+	CS_CHAR *stat,
+	double scale
+	);
+extern CS_VOID CS_PUBLIC lt_metrics_histogram(
+	LT_METRIC_HIST *metric,
+	CS_CHAR *name,
+	CS_CHAR *help,
+	CS_CHAR *labels,
+	CS_CHAR *stat,
+	double scale
+	);
+extern CS_RETCODE CS_PUBLIC lt_metrics_format(
+	LT_BUF *buf
+	);
+extern CS_RETCODE CS_PUBLIC lt_metrics_stats(
+	LT_BUF *buf,
+	CS_BIGINT usecs
+	);
+extern CS_RETCODE CS_PUBLIC lt_metrics_start(
+	CS_CHAR *address,
+	CS_INT interval
+	);
+extern CS_VOID CS_PUBLIC lt_metrics_stop(
+	CS_VOID
+	);
+
+#endif /* __LTMETRICS_H__ */
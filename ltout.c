@@ -0,0 +1,469 @@
+/*
+** Description
+** -----------
+** 	This file buffers the text output written to stdout. Columns are
+** 	copied and padded into one buffer, which is drained with writev()
+** 	when it fills up and at the explicit flush points: the end of each
+** 	result set, before a message is printed, and at exit.
+**
+** 	Everything the programs print to stdout while the buffer may hold
+** 	data must go through here, or be preceded by lt_out_flush(), to
+** 	keep the output in order. The writer is used from one thread only.
+**
+** 	An output sink writing its data to stdout claims it first: from then
+** 	on the text goes to stderr, and stdout carries the sink's data only.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltout.h"
+
+/*
+** The output buffer.
+*/
+CS_STATIC struct
+{
+	CS_CHAR		data[LT_OUT_BUFSIZE];
+	CS_INT		len;
+	CS_BOOL		registered;
+	CS_BOOL		claimed;
+} Lt_out;
+
+/*****************************************************************************
+**
+** private functions
+**
+*****************************************************************************/
+
+/*
+** lt_out_atexit()
+**
+** atexit() handler draining what is left in the buffer.
+*/
+CS_STATIC CS_VOID
+lt_out_atexit(CS_VOID)
+{
+	lt_out_flush();
+}
+
+/*
+** lt_out_writev()
+**
+** Type of function:
+** 	buffered output internal api
+**
+** Purpose:
+** 	Write all of an I/O vector to a file descriptor, in as few writev()
+** 	calls as the kernel allows.
+**
+** Parameters:
+** 	fd		- The file descriptor.
+** 	v		- The I/O vector; it is updated as it is written.
+** 	iovcnt		- Its number of entries.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the write failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_out_writev(int fd, struct iovec *v, CS_INT iovcnt)
+{
+	ssize_t		n;
+
+	while (iovcnt > 0)
+	{
+		n = writev(fd, v, iovcnt);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return CS_FAIL;
+		}
+		while (iovcnt > 0 && (size_t)n >= v->iov_len)
+		{
+			n -= v->iov_len;
+			v++;
+			iovcnt--;
+		}
+		if (iovcnt > 0)
+		{
+			v->iov_base = (char *)v->iov_base + n;
+			v->iov_len -= n;
+		}
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_out_drain()
+**
+** Type of function:
+** 	buffered output internal api
+**
+** Purpose:
+** 	Write the buffer, followed by 'len' bytes at 'data', to stdout, or
+** 	to stderr once a sink has claimed stdout, and empty the buffer.
+**
+** Parameters:
+** 	data		- Bytes to write after the buffer, or NULL.
+** 	len		- Number of bytes at 'data'.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the write failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_out_drain(CS_VOID *data, CS_INT len)
+{
+	struct iovec	iov[2];
+	CS_INT		iovcnt = 0;
+
+	if (Lt_out.len > 0)
+	{
+		iov[iovcnt].iov_base = Lt_out.data;
+		iov[iovcnt].iov_len = Lt_out.len;
+		iovcnt++;
+	}
+	if (len > 0)
+	{
+		iov[iovcnt].iov_base = data;
+		iov[iovcnt].iov_len = len;
+		iovcnt++;
+	}
+	Lt_out.len = 0;
+
+	if (!Lt_out.registered)
+	{
+		Lt_out.registered = CS_TRUE;
+		atexit(lt_out_atexit);
+	}
+	return lt_out_writev(lt_out_claimed() ? STDERR_FILENO : STDOUT_FILENO,
+			     iov, iovcnt);
+}
+
+/*****************************************************************************
+**
+** public functions
+**
+*****************************************************************************/
+
+/*
+** lt_out_write()
+**
+** Type of function:
+** 	buffered output api
+**
+** Purpose:
+** 	Write bytes to the output.
+**
+** Parameters:
+** 	data		- The bytes to write.
+** 	len		- Number of bytes to write.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if draining the buffer failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_out_write(CS_VOID *data, CS_INT len)
+{
+	CS_RETCODE	retcode;
+
+	if (len <= 0)
+	{
+		return CS_SUCCEED;
+	}
+	if (len <= LT_OUT_BUFSIZE - Lt_out.len)
+	{
+		memcpy(Lt_out.data + Lt_out.len, data, len);
+		Lt_out.len += len;
+		return CS_SUCCEED;
+	}
+
+	/*
+	** Large writes go out straight from the caller's memory.
+	*/
+	if (len >= LT_OUT_BUFSIZE / 4)
+	{
+		return lt_out_drain(data, len);
+	}
+	if ((retcode = lt_out_drain(NULL, 0)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	memcpy(Lt_out.data, data, len);
+	Lt_out.len = len;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_out_puts()
+**
+** Type of function:
+** 	buffered output api
+**
+** Purpose:
+** 	Write a null terminated string to the output.
+**
+** Parameters:
+** 	str		- The string.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if draining the buffer failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_out_puts(CS_CHAR *str)
+{
+	return lt_out_write(str, strlen(str));
+}
+
+/*
+** lt_out_putc()
+**
+** Type of function:
+** 	buffered output api
+**
+** Purpose:
+** 	Write one character to the output.
+**
+** Parameters:
+** 	c		- The character.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if draining the buffer failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_out_putc(CS_INT c)
+{
+	CS_RETCODE	retcode;
+
+	if (Lt_out.len == LT_OUT_BUFSIZE &&
+	    (retcode = lt_out_drain(NULL, 0)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	Lt_out.data[Lt_out.len++] = (CS_CHAR)c;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_out_pad()
+**
+** Type of function:
+** 	buffered output api
+**
+** Purpose:
+** 	Write a character to the output 'count' times.
+**
+** Parameters:
+** 	c		- The character.
+** 	count		- How many times to write it; nothing is written if
+** 			  it is 0 or less.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if draining the buffer failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_out_pad(CS_INT c, CS_INT count)
+{
+	CS_RETCODE	retcode;
+	CS_INT		n;
+
+	while (count > 0)
+	{
+		if (Lt_out.len == LT_OUT_BUFSIZE &&
+		    (retcode = lt_out_drain(NULL, 0)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+		n = LT_OUT_BUFSIZE - Lt_out.len;
+		if (n > count)
+		{
+			n = count;
+		}
+		memset(Lt_out.data + Lt_out.len, c, n);
+		Lt_out.len += n;
+		count -= n;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_out_printf()
+**
+** Type of function:
+** 	buffered output api
+**
+** Purpose:
+** 	Format a string into the output.
+**
+** Parameters:
+** 	fmt		- printf() format.
+** 	...		- Its arguments.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a malloc failed, or CS_FAIL if draining
+** 	the buffer failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_out_printf(CS_CHAR *fmt, ...)
+{
+	CS_RETCODE	retcode;
+	CS_CHAR		*tmp;
+	CS_INT		n;
+	va_list		ap;
+
+	va_start(ap, fmt);
+	n = vsnprintf(Lt_out.data + Lt_out.len, LT_OUT_BUFSIZE - Lt_out.len,
+		fmt, ap);
+	va_end(ap);
+	if (n < 0)
+	{
+		return CS_FAIL;
+	}
+	if (n < LT_OUT_BUFSIZE - Lt_out.len)
+	{
+		Lt_out.len += n;
+		return CS_SUCCEED;
+	}
+
+	/*
+	** It did not fit: format it on its own and write that.
+	*/
+	tmp = (CS_CHAR *)malloc(n + 1);
+	if (tmp == NULL)
+	{
+		ex_error("lt_out_printf: malloc() failed");
+		return CS_MEM_ERROR;
+	}
+	va_start(ap, fmt);
+	vsnprintf(tmp, n + 1, fmt, ap);
+	va_end(ap);
+	retcode = lt_out_write(tmp, n);
+	free(tmp);
+	return retcode;
+}
+
+/*
+** lt_out_flush()
+**
+** Type of function:
+** 	buffered output api
+**
+** Purpose:
+** 	Write out everything buffered.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the write failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_out_flush(CS_VOID)
+{
+	if (Lt_out.len == 0)
+	{
+		return CS_SUCCEED;
+	}
+	return lt_out_drain(NULL, 0);
+}
+
+/*
+** lt_out_claim()
+**
+** Type of function:
+** 	buffered output api
+**
+** Purpose:
+** 	Claim stdout for the data of an output sink. What the buffer holds
+** 	is written out first; the text written after goes to stderr.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the write failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_out_claim(CS_VOID)
+{
+	CS_RETCODE	retcode;
+
+	retcode = lt_out_flush();
+	__atomic_store_n(&Lt_out.claimed, CS_TRUE, __ATOMIC_RELEASE);
+	return retcode;
+}
+
+/*
+** lt_out_claimed()
+**
+** Type of function:
+** 	buffered output api
+**
+** Purpose:
+** 	Tell whether a sink has claimed stdout, and text meant for it must
+** 	go to stderr instead. The logger thread asks too.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	CS_TRUE or CS_FALSE.
+*/
+
+CS_BOOL CS_PUBLIC
+lt_out_claimed(CS_VOID)
+{
+	return __atomic_load_n(&Lt_out.claimed, __ATOMIC_ACQUIRE);
+}
+
+/*
+** lt_out_data()
+**
+** Type of function:
+** 	buffered output api
+**
+** Purpose:
+** 	Write the data of the sink that claimed stdout to it, after the
+** 	text buffered so far, unbuffered.
+**
+** Parameters:
+** 	data		- The bytes to write.
+** 	len		- Number of bytes to write.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a write failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_out_data(CS_VOID *data, CS_INT len)
+{
+	struct iovec	iov;
+	CS_RETCODE	retcode;
+
+	if ((retcode = lt_out_flush()) != CS_SUCCEED || len <= 0)
+	{
+		return retcode;
+	}
+	iov.iov_base = data;
+	iov.iov_len = len;
+	return lt_out_writev(STDOUT_FILENO, &iov, 1);
+}
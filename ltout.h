@@ -0,0 +1,68 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	buffered text output writer in ltout.c.
+**
+*/
+
+#ifndef __LTOUT_H__
+#define __LTOUT_H__
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** Size of the output buffer. Writes of at least a quarter of it bypass
+** the buffer and are drained together with it in one writev() call.
+*/
+#define LT_OUT_BUFSIZE		(64 * 1024)
+
+#ifdef __GNUC__
+#define LT_OUT_PRINTF_ATTR	__attribute__((format(printf, 1, 2)))
+#else
+#define LT_OUT_PRINTF_ATTR
+#endif
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltout.c */
+extern CS_RETCODE CS_PUBLIC lt_out_write(
+	CS_VOID *data,
+	CS_INT len
+	);
+extern CS_RETCODE CS_PUBLIC lt_out_puts(
+	CS_CHAR *str
+	);
+extern CS_RETCODE CS_PUBLIC lt_out_putc(
+	CS_INT c
+	);
+extern CS_RETCODE CS_PUBLIC lt_out_pad(
+	CS_INT c,
+	CS_INT count
+	);
+extern CS_RETCODE CS_PUBLIC lt_out_printf(
+	CS_CHAR *fmt,
+	...
+	) LT_OUT_PRINTF_ATTR;
+extern CS_RETCODE CS_PUBLIC lt_out_flush(
+	CS_VOID
+	);
+extern CS_RETCODE CS_PUBLIC lt_out_claim(
+	CS_VOID
+	);
+extern CS_BOOL CS_PUBLIC lt_out_claimed(
+	CS_VOID
+	);
+extern CS_RETCODE CS_PUBLIC lt_out_data(
+	CS_VOID *data,
+	CS_INT len
+	);
+
+#endif /* __LTOUT_H__ */
@@ -0,0 +1,1994 @@
+/*
+** Description
+** -----------
+** 	This file is a stand-in for Client-Library and CS-Library, linked
+** 	in their place to run logtransfer without a server. It implements
+** 	the ct_* and cs_* routines the program calls, with the same
+** 	prototypes, and serves the results of each `dbcc logtransfer` scan
+** 	command from a capture file (see ltcapture.h), recorded from a
+** 	server or written by a generator. Every other command succeeds
+** 	without results.
+**
+** 	The capture is mapped when the connection is opened. It is read
+** 	from the path in the LT_REPLAY environment variable, or from
+** 	LT_REPLAY_PATH. Each scan command is served the results of the
+** 	next scan recorded; once they run out, scans return no results.
+**
+** 	Rows are converted to their bound formats as Client-Library would:
+** 	to null terminated or padded strings, or copied in their native
+** 	form. The conversions to strings cover the datatypes a scan
+** 	returns, with Client-Library's default formats; others fail to
+** 	bind. Message callbacks are accepted but never called.
+**
+** 	There is one connection, and its commands are processed one at a
+** 	time, so the replay state is not locked.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltcapture.h"
+
+#define LT_REPLAY_ENV		"LT_REPLAY"
+#define LT_REPLAY_PATH		"logtransfer.capture"
+#define LT_REPLAY_SCANCMD	"dbcc logtransfer('scan'"
+#define LT_REPLAY_TMPLEN	128
+#define LT_REPLAY_NULLLEN	64
+
+/*
+** Days from 0000-01-01 to 1970-01-01, and from 1900-01-01 to 1970-01-01.
+*/
+#define LT_REPLAY_DAYS0000	719528
+#define LT_REPLAY_DAYS1900	25567
+
+#define LT_REPLAY_USDAY		((CS_BIGINT)86400 * 1000000)
+
+#define LT_GET(_p, _v)	(memcpy(&(_v), (_p), sizeof (_v)), (_p) += sizeof (_v))
+
+/*
+** A column bound by ct_bind().
+*/
+typedef struct _lt_replay_bind
+{
+	CS_BOOL		bound;
+	CS_DATAFMT	datafmt;
+	CS_VOID		*buf;
+	CS_INT		*copied;
+	CS_SMALLINT	*indicator;
+} LT_REPLAY_BIND;
+
+/*
+** A command. 'captured' is set for a scan served from the capture, and
+** 'step' counts the results returned by a command that is not. The
+** current result is described by 'restype', 'msgid' and the 'numcols'
+** columns of 'datafmt'; 'fetchable' is set until its rows are fetched or
+** cancelled.
+*/
+typedef struct _lt_replay_cmd
+{
+	CS_BOOL		scan;
+	CS_BOOL		sent;
+	CS_BOOL		captured;
+	CS_BOOL		done;
+	CS_INT		step;
+	CS_INT		restype;
+	CS_INT		msgid;
+	CS_BOOL		fetchable;
+	CS_INT		numcols;
+	CS_INT		maxcols;
+	CS_INT		rowcount;
+	CS_DATAFMT	*datafmt;
+	LT_REPLAY_BIND	*binds;
+	LT_CAPTURE_VALUE *values;
+} LT_REPLAY_CMD;
+
+/*
+** The replay state, whose address also serves as the context and the
+** connection handle. 'nullchar' is the string a null is bound as.
+*/
+CS_STATIC struct
+{
+	LT_CAPTURE	cap;
+	CS_BOOL		mapped;
+	CS_CHAR		nullchar[LT_REPLAY_NULLLEN];
+	CS_INT		nullcharlen;
+} Lt_replay;
+
+CS_STATIC CS_CHAR *Lt_replay_months[] =
+{
+	"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+	"Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+/*****************************************************************************
+**
+** private functions
+**
+*****************************************************************************/
+
+/*
+** lt_replay_next()
+**
+** Type of function:
+** 	replay internal api
+**
+** Purpose:
+** 	Read the next record of the capture. An incomplete record ends
+** 	the capture.
+**
+** Parameters:
+** 	rec		- Set to the record.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_END_DATA at the end of the capture.
+*/
+
+CS_STATIC CS_RETCODE
+lt_replay_next(LT_CAPTURE_REC *rec)
+{
+	CS_RETCODE	retcode;
+
+	if (!Lt_replay.mapped)
+	{
+		return CS_END_DATA;
+	}
+	if ((retcode = lt_capture_next(&Lt_replay.cap, rec)) == CS_FAIL)
+	{
+		Lt_replay.cap.off = Lt_replay.cap.len;
+		retcode = CS_END_DATA;
+	}
+	return retcode;
+}
+
+/*
+** lt_replay_skip()
+**
+** Type of function:
+** 	replay internal api
+**
+** Purpose:
+** 	Skip the unfetched rows of the current result, or with 'all' set,
+** 	the rest of the results of a captured scan.
+**
+** Parameters:
+** 	cmd		- The command.
+** 	all		- Skip all the results.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_replay_skip(LT_REPLAY_CMD *cmd, CS_BOOL all)
+{
+	LT_CAPTURE_REC	rec;
+	CS_BIGINT	off;
+
+	cmd->fetchable = CS_FALSE;
+	if (!cmd->captured || cmd->done)
+	{
+		return;
+	}
+	for (;;)
+	{
+		off = Lt_replay.cap.off;
+		if (lt_replay_next(&rec) != CS_SUCCEED)
+		{
+			break;
+		}
+		if (rec.type == LT_CAPTURE_ROW)
+		{
+			continue;
+		}
+		if (!all || rec.type == LT_CAPTURE_SCAN)
+		{
+			Lt_replay.cap.off = off;
+			break;
+		}
+		if (rec.type == LT_CAPTURE_END)
+		{
+			break;
+		}
+	}
+	if (all)
+	{
+		cmd->done = CS_TRUE;
+	}
+}
+
+/*
+** lt_replay_result()
+**
+** Type of function:
+** 	replay internal api
+**
+** Purpose:
+** 	Make a result record the current result of a command.
+**
+** Parameters:
+** 	cmd		- The command.
+** 	rec		- The record.
+**
+** Returns:
+** 	CS_SUCCEED, CS_FAIL if the record is malformed, or CS_MEM_ERROR
+** 	if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_replay_result(LT_REPLAY_CMD *cmd, LT_CAPTURE_REC *rec)
+{
+	CS_DATAFMT	*datafmt;
+	LT_REPLAY_BIND	*binds;
+	LT_CAPTURE_VALUE *values;
+	CS_INT		numcols;
+
+	if (lt_capture_result(rec, &cmd->restype, &cmd->msgid,
+			      &numcols) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+	if (numcols > cmd->maxcols)
+	{
+		datafmt = (CS_DATAFMT *)realloc(cmd->datafmt,
+						numcols * sizeof (CS_DATAFMT));
+		if (datafmt != NULL)
+		{
+			cmd->datafmt = datafmt;
+		}
+		binds = (LT_REPLAY_BIND *)realloc(cmd->binds,
+						  numcols * sizeof (LT_REPLAY_BIND));
+		if (binds != NULL)
+		{
+			cmd->binds = binds;
+		}
+		values = (LT_CAPTURE_VALUE *)realloc(cmd->values,
+						     numcols * sizeof (LT_CAPTURE_VALUE));
+		if (values != NULL)
+		{
+			cmd->values = values;
+		}
+		if (datafmt == NULL || binds == NULL || values == NULL)
+		{
+			ex_error("ct_results: realloc() failed");
+			return CS_MEM_ERROR;
+		}
+		cmd->maxcols = numcols;
+	}
+	if (lt_capture_columns(rec, numcols, cmd->datafmt) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+	if (numcols > 0)
+	{
+		memset(cmd->binds, 0, numcols * sizeof (LT_REPLAY_BIND));
+	}
+	cmd->numcols = numcols;
+	cmd->fetchable = (numcols > 0);
+	cmd->rowcount = 0;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_replay_class()
+**
+** Type of function:
+** 	replay internal api
+**
+** Purpose:
+** 	Classify a datatype for conversion.
+**
+** Parameters:
+** 	datatype	- The datatype.
+**
+** Returns:
+** 	'c' for character types, 'b' for binary types, 'u' for Unicode
+** 	types, and 0 for the others.
+*/
+
+CS_STATIC CS_INT
+lt_replay_class(CS_INT datatype)
+{
+	switch ((int)datatype)
+	{
+		case CS_CHAR_TYPE:
+		case CS_VARCHAR_TYPE:
+		case CS_LONGCHAR_TYPE:
+		case CS_TEXT_TYPE:
+		case CS_XML_TYPE:
+			return 'c';
+
+		case CS_BINARY_TYPE:
+		case CS_VARBINARY_TYPE:
+		case CS_LONGBINARY_TYPE:
+		case CS_IMAGE_TYPE:
+			return 'b';
+
+		case CS_UNICHAR_TYPE:
+		case CS_UNITEXT_TYPE:
+			return 'u';
+
+		default:
+			return 0;
+	}
+}
+
+/*
+** lt_replay_numlen()
+**
+** Type of function:
+** 	replay internal api
+**
+** Purpose:
+** 	Get the number of bytes of a CS_NUMERIC array used at a
+** 	precision: a sign byte, and enough bytes for 10^precision - 1.
+**
+** Parameters:
+** 	precision	- The precision.
+**
+** Returns:
+** 	The number of bytes.
+*/
+
+CS_STATIC CS_INT
+lt_replay_numlen(CS_INT precision)
+{
+	precision = MAX(MIN(precision, CS_MAX_PREC), 1);
+	return MIN(1 + (precision * 3322 + 7999) / 8000, CS_MAX_NUMLEN);
+}
+
+/*
+** lt_replay_civil()
+**
+** Type of function:
+** 	replay internal api
+**
+** Purpose:
+** 	Set the date fields of a cracked date from a day number.
+**
+** Parameters:
+** 	days		- Days since 1970-01-01.
+** 	rec		- The cracked date.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_replay_civil(CS_BIGINT days, CS_DATEREC *rec)
+{
+	CS_BIGINT	z = days + 719468;
+	CS_BIGINT	era;
+	CS_BIGINT	doe;
+	CS_BIGINT	yoe;
+	CS_BIGINT	doy;
+	CS_BIGINT	mp;
+	CS_BIGINT	y;
+	CS_BIGINT	jan1;
+
+	/*
+	** Civil date of a day, with March as the first month of the year
+	** so the leap day falls last.
+	*/
+	era = ((z >= 0) ? z : z - 146096) / 146097;
+	doe = z - era * 146097;
+	yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	mp = (5 * doy + 2) / 153;
+	y = yoe + era * 400 + ((mp >= 10) ? 1 : 0);
+
+	rec->dateyear = (CS_INT)y;
+	rec->datemonth = (CS_INT)((mp < 10) ? mp + 2 : mp - 10);
+	rec->datedmonth = (CS_INT)(doy - (153 * mp + 2) / 5 + 1);
+
+	/*
+	** The day of 1 January of the year, counted the same way.
+	*/
+	y--;
+	era = ((y >= 0) ? y : y - 399) / 400;
+	yoe = y - era * 400;
+	jan1 = era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + 306 - 719468;
+	rec->datedyear = (CS_INT)(days - jan1 + 1);
+	rec->datedweek = (CS_INT)(((days % 7) + 11) % 7);
+}
+
+/*
+** lt_replay_crack()
+**
+** Type of function:
+** 	replay internal api
+**
+** Purpose:
+** 	Crack a date or time value into its parts.
+**
+** Parameters:
+** 	datatype	- The datatype of the value.
+** 	value		- The value, in native form.
+** 	rec		- The cracked date.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the datatype is not a date or time.
+*/
+
+CS_STATIC CS_RETCODE
+lt_replay_crack(CS_INT datatype, CS_VOID *value, CS_DATEREC *rec)
+{
+	CS_DATETIME	dt;
+	CS_DATETIME4	dt4;
+	CS_INT		i;
+	CS_UBIGINT	big;
+	CS_BIGINT	days = -LT_REPLAY_DAYS1900;
+	CS_BIGINT	usecs;
+
+	switch ((int)datatype)
+	{
+		case CS_DATETIME_TYPE:
+			memcpy(&dt, value, sizeof (dt));
+			days += dt.dtdays;
+			usecs = (CS_BIGINT)(dt.dttime / 300) * 1000000 +
+				(((dt.dttime % 300) * 10 + 1) / 3) * 1000;
+			break;
+
+		case CS_DATETIME4_TYPE:
+			memcpy(&dt4, value, sizeof (dt4));
+			days += dt4.days;
+			usecs = (CS_BIGINT)dt4.minutes * 60 * 1000000;
+			break;
+
+		case CS_DATE_TYPE:
+			memcpy(&i, value, sizeof (i));
+			days += i;
+			usecs = 0;
+			break;
+
+		case CS_TIME_TYPE:
+			memcpy(&i, value, sizeof (i));
+			usecs = (CS_BIGINT)(i / 300) * 1000000 +
+				(((i % 300) * 10 + 1) / 3) * 1000;
+			break;
+
+		case CS_BIGDATETIME_TYPE:
+			memcpy(&big, value, sizeof (big));
+			days = (CS_BIGINT)(big / LT_REPLAY_USDAY) -
+				LT_REPLAY_DAYS0000;
+			usecs = (CS_BIGINT)(big % LT_REPLAY_USDAY);
+			break;
+
+		case CS_BIGTIME_TYPE:
+			memcpy(&big, value, sizeof (big));
+			usecs = (CS_BIGINT)(big % LT_REPLAY_USDAY);
+			break;
+
+		default:
+			return CS_FAIL;
+	}
+
+	memset(rec, 0, sizeof (CS_DATEREC));
+	lt_replay_civil(days, rec);
+	rec->datehour = (CS_INT)(usecs / ((CS_BIGINT)3600 * 1000000));
+	rec->dateminute = (CS_INT)(usecs / (60 * 1000000) % 60);
+	rec->datesecond = (CS_INT)(usecs / 1000000 % 60);
+	rec->datesecfrac = (CS_INT)(usecs % 1000000);
+	rec->datemsecond = rec->datesecfrac / 1000;
+	rec->datesecprec = 6;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_replay_numeric()
+**
+** Type of function:
+** 	replay internal api
+**
+** Purpose:
+** 	Format a numeric or decimal value.
+**
+** Parameters:
+** 	value		- The value, in native form.
+** 	len		- Its length.
+** 	out		- Buffer of LT_REPLAY_TMPLEN bytes for the string.
+**
+** Returns:
+** 	The length of the string.
+*/
+
+CS_STATIC CS_INT
+lt_replay_numeric(CS_BYTE *value, CS_INT len, CS_CHAR *out)
+{
+	CS_NUMERIC	num;
+	CS_BYTE		mag[CS_MAX_NUMLEN];
+	CS_CHAR		digits[CS_MAX_PREC + 2];
+	CS_INT		nbytes;
+	CS_INT		ndigits = 0;
+	CS_INT		scale;
+	CS_INT		rem;
+	CS_INT		i;
+	CS_INT		n = 0;
+	CS_BOOL		zero;
+
+	memset(&num, 0, sizeof (num));
+	memcpy(&num, value, MIN(len, (CS_INT)sizeof (num)));
+	nbytes = lt_replay_numlen(num.precision) - 1;
+	scale = MIN((CS_INT)num.scale, CS_MAX_PREC);
+	memcpy(mag, &num.array[1], nbytes);
+
+	/*
+	** Peel off the decimal digits, least significant first, by long
+	** division of the base 256 magnitude.
+	*/
+	do
+	{
+		rem = 0;
+		zero = CS_TRUE;
+		for (i = 0; i < nbytes; i++)
+		{
+			rem = rem * 256 + mag[i];
+			mag[i] = (CS_BYTE)(rem / 10);
+			rem %= 10;
+			zero = zero && (mag[i] == 0);
+		}
+		digits[ndigits++] = (CS_CHAR)('0' + rem);
+	} while (!zero && ndigits < CS_MAX_PREC + 1);
+	while (ndigits <= scale)
+	{
+		digits[ndigits++] = '0';
+	}
+
+	if (num.array[0] != 0)
+	{
+		for (i = 0; i < ndigits && digits[i] == '0'; i++)
+			;
+		if (i < ndigits)
+		{
+			out[n++] = '-';
+		}
+	}
+	for (i = ndigits - 1; i >= 0; i--)
+	{
+		out[n++] = digits[i];
+		if (i == scale && scale > 0)
+		{
+			out[n++] = '.';
+		}
+	}
+	return n;
+}
+
+/*
+** lt_replay_format()
+**
+** Type of function:
+** 	replay internal api
+**
+** Purpose:
+** 	Format a value of a fixed length datatype as a string.
+**
+** Parameters:
+** 	datatype	- The datatype of the value.
+** 	value		- The value, in native form.
+** 	len		- Its length.
+** 	out		- Buffer of LT_REPLAY_TMPLEN bytes for the string.
+**
+** Returns:
+** 	The length of the string, or -1 if the datatype cannot be
+** 	converted.
+*/
+
+CS_STATIC CS_INT
+lt_replay_format(CS_INT datatype, CS_BYTE *value, CS_INT len, CS_CHAR *out)
+{
+	CS_BYTE		bytes[sizeof (CS_UBIGINT)];
+	CS_TINYINT	tinyint;
+	CS_SMALLINT	smallint;
+	CS_USMALLINT	usmallint;
+	CS_INT		i;
+	CS_UINT		ui;
+	CS_BIGINT	bigint;
+	CS_UBIGINT	ubigint;
+	CS_REAL		real;
+	CS_FLOAT	flt;
+	CS_MONEY	money;
+	CS_MONEY4	money4;
+	CS_DATEREC	rec;
+	CS_INT		hour;
+
+	/*
+	** Read the fixed length values from a copy, which is aligned and
+	** zero filled should the value be short.
+	*/
+	memset(bytes, 0, sizeof (bytes));
+	memcpy(bytes, value, MIN(len, (CS_INT)sizeof (bytes)));
+
+	switch ((int)datatype)
+	{
+		case CS_TINYINT_TYPE:
+		case CS_BIT_TYPE:
+			memcpy(&tinyint, bytes, sizeof (tinyint));
+			return snprintf(out, LT_REPLAY_TMPLEN, "%u", tinyint);
+
+		case CS_SMALLINT_TYPE:
+			memcpy(&smallint, bytes, sizeof (smallint));
+			return snprintf(out, LT_REPLAY_TMPLEN, "%d", smallint);
+
+		case CS_USMALLINT_TYPE:
+			memcpy(&usmallint, bytes, sizeof (usmallint));
+			return snprintf(out, LT_REPLAY_TMPLEN, "%u", usmallint);
+
+		case CS_INT_TYPE:
+			memcpy(&i, bytes, sizeof (i));
+			return snprintf(out, LT_REPLAY_TMPLEN, "%d", i);
+
+		case CS_UINT_TYPE:
+			memcpy(&ui, bytes, sizeof (ui));
+			return snprintf(out, LT_REPLAY_TMPLEN, "%u", ui);
+
+		case CS_BIGINT_TYPE:
+			memcpy(&bigint, bytes, sizeof (bigint));
+			return snprintf(out, LT_REPLAY_TMPLEN, "%lld",
+					(long long)bigint);
+
+		case CS_UBIGINT_TYPE:
+			memcpy(&ubigint, bytes, sizeof (ubigint));
+			return snprintf(out, LT_REPLAY_TMPLEN, "%llu",
+					(unsigned long long)ubigint);
+
+		case CS_REAL_TYPE:
+			memcpy(&real, bytes, sizeof (real));
+			return snprintf(out, LT_REPLAY_TMPLEN, "%.7g", real);
+
+		case CS_FLOAT_TYPE:
+			memcpy(&flt, bytes, sizeof (flt));
+			return snprintf(out, LT_REPLAY_TMPLEN, "%.15g", flt);
+
+		case CS_MONEY_TYPE:
+		case CS_MONEY4_TYPE:
+			/*
+			** Money is held in ten thousandths, and shown rounded
+			** to hundredths.
+			*/
+			if (datatype == CS_MONEY_TYPE)
+			{
+				memcpy(&money, bytes, sizeof (money));
+				bigint = (CS_BIGINT)(((CS_UBIGINT)(CS_UINT)money.mnyhigh << 32) |
+						     money.mnylow);
+			}
+			else
+			{
+				memcpy(&money4, bytes, sizeof (money4));
+				bigint = money4.mny4;
+			}
+			bigint = (bigint < 0) ? (bigint - 50) / 100 : (bigint + 50) / 100;
+			ubigint = (CS_UBIGINT)((bigint < 0) ? -bigint : bigint);
+			return snprintf(out, LT_REPLAY_TMPLEN, "%s%llu.%02llu",
+					(bigint < 0) ? "-" : "",
+					(unsigned long long)(ubigint / 100),
+					(unsigned long long)(ubigint % 100));
+
+		case CS_NUMERIC_TYPE:
+		case CS_DECIMAL_TYPE:
+			return lt_replay_numeric(value, len, out);
+
+		case CS_DATETIME_TYPE:
+		case CS_DATETIME4_TYPE:
+		case CS_DATE_TYPE:
+		case CS_TIME_TYPE:
+		case CS_BIGDATETIME_TYPE:
+		case CS_BIGTIME_TYPE:
+			lt_replay_crack(datatype, bytes, &rec);
+			hour = (rec.datehour % 12 == 0) ? 12 : rec.datehour % 12;
+			if (datatype == CS_DATE_TYPE)
+			{
+				return snprintf(out, LT_REPLAY_TMPLEN, "%s %2d %4d",
+						Lt_replay_months[rec.datemonth],
+						rec.datedmonth, rec.dateyear);
+			}
+			if (datatype == CS_TIME_TYPE || datatype == CS_BIGTIME_TYPE)
+			{
+				return snprintf(out, LT_REPLAY_TMPLEN, "%2d:%02d%s",
+						hour, rec.dateminute,
+						(rec.datehour < 12) ? "AM" : "PM");
+			}
+			return snprintf(out, LT_REPLAY_TMPLEN, "%s %2d %4d %2d:%02d%s",
+					Lt_replay_months[rec.datemonth],
+					rec.datedmonth, rec.dateyear, hour,
+					rec.dateminute,
+					(rec.datehour < 12) ? "AM" : "PM");
+
+		default:
+			return -1;
+	}
+}
+
+/*
+** lt_replay_hex()
+**
+** Type of function:
+** 	replay internal api
+**
+** Purpose:
+** 	Write a binary value as hex digits, without a 0x prefix, as far as
+** 	they fit.
+**
+** Parameters:
+** 	value		- The value.
+** 	len		- Its length.
+** 	out		- Buffer for the digits.
+** 	room		- Size of the buffer.
+**
+** Returns:
+** 	The number of digits written.
+*/
+
+CS_STATIC CS_INT
+lt_replay_hex(CS_BYTE *value, CS_INT len, CS_CHAR *out, CS_INT room)
+{
+	CS_STATIC CS_CHAR hex[] = "0123456789abcdef";
+	CS_INT		i;
+
+	len = MIN(len, room / 2);
+	for (i = 0; i < len; i++)
+	{
+		out[2 * i] = hex[value[i] >> 4];
+		out[2 * i + 1] = hex[value[i] & 0x0f];
+	}
+	return 2 * len;
+}
+
+/*
+** lt_replay_utf8()
+**
+** Type of function:
+** 	replay internal api
+**
+** Purpose:
+** 	Write a UTF-16 value as UTF-8, as far as it fits. Unpaired
+** 	surrogates are written as '?'.
+**
+** Parameters:
+** 	value		- The value, in native byte order.
+** 	len		- Its length in bytes.
+** 	out		- Buffer for the string.
+** 	room		- Size of the buffer.
+** 	truncated	- Set if it did not fit.
+**
+** Returns:
+** 	The number of bytes written.
+*/
+
+CS_STATIC CS_INT
+lt_replay_utf8(CS_BYTE *value, CS_INT len, CS_CHAR *out, CS_INT room,
+	       CS_BOOL *truncated)
+{
+	CS_USMALLINT	unit;
+	CS_USMALLINT	low;
+	CS_UINT		c;
+	CS_INT		i;
+	CS_INT		n = 0;
+	CS_INT		need;
+
+	*truncated = CS_FALSE;
+	for (i = 0; i + 1 < len; i += 2)
+	{
+		memcpy(&unit, value + i, sizeof (unit));
+		c = unit;
+		if (c >= 0xd800 && c < 0xdc00 && i + 3 < len)
+		{
+			memcpy(&low, value + i + 2, sizeof (low));
+			if (low >= 0xdc00 && low < 0xe000)
+			{
+				c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+				i += 2;
+			}
+		}
+		if (c >= 0xd800 && c < 0xe000)
+		{
+			c = '?';
+		}
+		need = (c < 0x80) ? 1 : (c < 0x800) ? 2 : (c < 0x10000) ? 3 : 4;
+		if (n + need > room)
+		{
+			*truncated = CS_TRUE;
+			break;
+		}
+		switch (need)
+		{
+			case 1:
+				out[n++] = (CS_CHAR)c;
+				break;
+
+			case 2:
+				out[n++] = (CS_CHAR)(0xc0 | (c >> 6));
+				out[n++] = (CS_CHAR)(0x80 | (c & 0x3f));
+				break;
+
+			case 3:
+				out[n++] = (CS_CHAR)(0xe0 | (c >> 12));
+				out[n++] = (CS_CHAR)(0x80 | ((c >> 6) & 0x3f));
+				out[n++] = (CS_CHAR)(0x80 | (c & 0x3f));
+				break;
+
+			default:
+				out[n++] = (CS_CHAR)(0xf0 | (c >> 18));
+				out[n++] = (CS_CHAR)(0x80 | ((c >> 12) & 0x3f));
+				out[n++] = (CS_CHAR)(0x80 | ((c >> 6) & 0x3f));
+				out[n++] = (CS_CHAR)(0x80 | (c & 0x3f));
+				break;
+		}
+	}
+	return n;
+}
+
+/*
+** lt_replay_convert()
+**
+** Type of function:
+** 	replay internal api
+**
+** Purpose:
+** 	Convert a value to a destination format, as ct_bind() and
+** 	cs_convert() do: to a string, formatted as the destination
+** 	format says, or copied if the destination is of the same type, or
+** 	both are binary. Values are truncated to the destination length.
+**
+** Parameters:
+** 	srctype		- The datatype of the value.
+** 	src		- The value, in native form.
+** 	srclen		- Its length.
+** 	destfmt		- The destination format.
+** 	dest		- The destination.
+** 	outlen		- Set to the length of the destination, including
+** 			  a null terminator.
+** 	truncated	- Set if the value was truncated.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the conversion is not supported.
+*/
+
+CS_STATIC CS_RETCODE
+lt_replay_convert(CS_INT srctype, CS_BYTE *src, CS_INT srclen,
+		  CS_DATAFMT *destfmt, CS_VOID *dest, CS_INT *outlen,
+		  CS_BOOL *truncated)
+{
+	CS_CHAR		tmp[LT_REPLAY_TMPLEN];
+	CS_CHAR		*out = (CS_CHAR *)dest;
+	CS_INT		srcclass = lt_replay_class(srctype);
+	CS_INT		room;
+	CS_INT		n;
+
+	*truncated = CS_FALSE;
+	if (lt_replay_class(destfmt->datatype) != 'c')
+	{
+		if (destfmt->datatype != srctype &&
+		    (srcclass != 'b' ||
+		     lt_replay_class(destfmt->datatype) != 'b'))
+		{
+			return CS_FAIL;
+		}
+		n = MIN(srclen, MAX(destfmt->maxlength, 0));
+		memcpy(dest, src, n);
+		*truncated = (n < srclen);
+		*outlen = n;
+		return CS_SUCCEED;
+	}
+
+	room = destfmt->maxlength;
+	if (destfmt->format & CS_FMT_NULLTERM)
+	{
+		room--;
+	}
+	room = MAX(room, 0);
+
+	switch (srcclass)
+	{
+		case 'c':
+			n = MIN(srclen, room);
+			memcpy(out, src, n);
+			*truncated = (n < srclen);
+			break;
+
+		case 'b':
+			n = lt_replay_hex(src, srclen, out, room);
+			*truncated = (n < 2 * srclen);
+			break;
+
+		case 'u':
+			n = lt_replay_utf8(src, srclen, out, room, truncated);
+			break;
+
+		default:
+			if ((n = lt_replay_format(srctype, src, srclen, tmp)) < 0)
+			{
+				return CS_FAIL;
+			}
+			*truncated = (n > room);
+			n = MIN(n, room);
+			memcpy(out, tmp, n);
+			break;
+	}
+
+	if (destfmt->format & CS_FMT_NULLTERM)
+	{
+		out[n++] = '\0';
+	}
+	else if (destfmt->format & (CS_FMT_PADBLANK | CS_FMT_PADNULL))
+	{
+		memset(out + n, (destfmt->format & CS_FMT_PADBLANK) ? ' ' : '\0',
+		       room - n);
+		n = room;
+	}
+	*outlen = n;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_replay_will_convert()
+**
+** Type of function:
+** 	replay internal api
+**
+** Purpose:
+** 	Check whether lt_replay_convert() supports a conversion.
+**
+** Parameters:
+** 	srctype		- The source datatype.
+** 	desttype	- The destination datatype.
+**
+** Returns:
+** 	CS_TRUE or CS_FALSE.
+*/
+
+CS_STATIC CS_BOOL
+lt_replay_will_convert(CS_INT srctype, CS_INT desttype)
+{
+	CS_CHAR		tmp[LT_REPLAY_TMPLEN];
+	CS_BYTE		zero[sizeof (CS_NUMERIC)];
+
+	if (srctype == desttype ||
+	    (lt_replay_class(srctype) == 'b' && lt_replay_class(desttype) == 'b'))
+	{
+		return CS_TRUE;
+	}
+	if (lt_replay_class(desttype) != 'c')
+	{
+		return CS_FALSE;
+	}
+	memset(zero, 0, sizeof (zero));
+	return (lt_replay_class(srctype) != 0 ||
+		lt_replay_format(srctype, zero, sizeof (zero), tmp) >= 0);
+}
+
+/*****************************************************************************
+**
+** Client-Library routines
+**
+*****************************************************************************/
+
+/*
+** ct_init()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Initialize Client-Library for a context. Nothing to do.
+**
+** Parameters:
+** 	context		- The context.
+** 	version		- The Client-Library version.
+**
+** Returns:
+** 	CS_SUCCEED.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_init(CS_CONTEXT *context, CS_INT version)
+{
+	return CS_SUCCEED;
+}
+
+/*
+** ct_exit()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Exit Client-Library for a context, closing the capture should the
+** 	connection still be open.
+**
+** Parameters:
+** 	context		- The context.
+** 	option		- CS_UNUSED or CS_FORCE_EXIT.
+**
+** Returns:
+** 	CS_SUCCEED.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_exit(CS_CONTEXT *context, CS_INT option)
+{
+	if (Lt_replay.mapped)
+	{
+		lt_capture_unmap(&Lt_replay.cap);
+		Lt_replay.mapped = CS_FALSE;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** ct_config()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Set or get a context property. The properties are ignored.
+**
+** Parameters:
+** 	context		- The context.
+** 	action		- CS_SET, CS_GET or CS_CLEAR.
+** 	property	- The property.
+** 	buf		- The value.
+** 	buflen		- Length of the value.
+** 	outlen		- Set to the length of a value got.
+**
+** Returns:
+** 	CS_SUCCEED for CS_SET and CS_CLEAR, CS_FAIL for CS_GET.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_config(CS_CONTEXT *context, CS_INT action, CS_INT property, CS_VOID *buf,
+	  CS_INT buflen, CS_INT *outlen)
+{
+	return (action == CS_GET) ? CS_FAIL : CS_SUCCEED;
+}
+
+/*
+** ct_callback()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Install a callback. The replay has no messages to report, so it
+** 	is never called.
+**
+** Parameters:
+** 	context		- The context, or NULL.
+** 	connection	- The connection, or NULL.
+** 	action		- CS_SET or CS_GET.
+** 	type		- The type of callback.
+** 	func		- The callback.
+**
+** Returns:
+** 	CS_SUCCEED.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_callback(CS_CONTEXT *context, CS_CONNECTION *connection, CS_INT action,
+	    CS_INT type, CS_VOID *func)
+{
+	return CS_SUCCEED;
+}
+
+/*
+** ct_debug()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Manage debug options. There are none.
+**
+** Parameters:
+** 	context		- The context, or NULL.
+** 	connection	- The connection, or NULL.
+** 	operation	- The operation.
+** 	flag		- The debug flags.
+** 	filename	- A protocol file name.
+** 	fnamelen	- Length of the file name.
+**
+** Returns:
+** 	CS_SUCCEED.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_debug(CS_CONTEXT *context, CS_CONNECTION *connection, CS_INT operation,
+	 CS_INT flag, CS_CHAR *filename, CS_INT fnamelen)
+{
+	return CS_SUCCEED;
+}
+
+/*
+** ct_con_alloc()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Allocate the connection.
+**
+** Parameters:
+** 	context		- The context.
+** 	connection	- Set to the connection.
+**
+** Returns:
+** 	CS_SUCCEED.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_con_alloc(CS_CONTEXT *context, CS_CONNECTION **connection)
+{
+	*connection = (CS_CONNECTION *)&Lt_replay;
+	return CS_SUCCEED;
+}
+
+/*
+** ct_con_props()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Set or get a connection property. The properties are ignored.
+**
+** Parameters:
+** 	connection	- The connection.
+** 	action		- CS_SET, CS_GET or CS_CLEAR.
+** 	property	- The property.
+** 	buf		- The value.
+** 	buflen		- Length of the value.
+** 	outlen		- Set to the length of a value got.
+**
+** Returns:
+** 	CS_SUCCEED for CS_SET and CS_CLEAR, CS_FAIL for CS_GET.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_con_props(CS_CONNECTION *connection, CS_INT action, CS_INT property,
+	     CS_VOID *buf, CS_INT buflen, CS_INT *outlen)
+{
+	return (action == CS_GET) ? CS_FAIL : CS_SUCCEED;
+}
+
+/*
+** ct_connect()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Open the connection, which maps the capture. The server name is
+** 	ignored.
+**
+** Parameters:
+** 	connection	- The connection.
+** 	server_name	- The server name.
+** 	snamelen	- Length of the server name.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the capture could not be mapped.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_connect(CS_CONNECTION *connection, CS_CHAR *server_name, CS_INT snamelen)
+{
+	CS_CHAR		*path;
+
+	if ((path = getenv(LT_REPLAY_ENV)) == NULL || *path == '\0')
+	{
+		path = LT_REPLAY_PATH;
+	}
+	if (Lt_replay.mapped)
+	{
+		lt_capture_unmap(&Lt_replay.cap);
+	}
+	if (lt_capture_map(path, &Lt_replay.cap) != CS_SUCCEED)
+	{
+		ex_error("ct_connect: mapping the capture failed");
+		Lt_replay.mapped = CS_FALSE;
+		return CS_FAIL;
+	}
+	Lt_replay.mapped = CS_TRUE;
+	return CS_SUCCEED;
+}
+
+/*
+** ct_close()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Close the connection, which unmaps the capture.
+**
+** Parameters:
+** 	connection	- The connection.
+** 	option		- CS_UNUSED or CS_FORCE_CLOSE.
+**
+** Returns:
+** 	CS_SUCCEED.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_close(CS_CONNECTION *connection, CS_INT option)
+{
+	if (Lt_replay.mapped)
+	{
+		lt_capture_unmap(&Lt_replay.cap);
+		Lt_replay.mapped = CS_FALSE;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** ct_con_drop()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Drop the connection. Nothing to do.
+**
+** Parameters:
+** 	connection	- The connection.
+**
+** Returns:
+** 	CS_SUCCEED.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_con_drop(CS_CONNECTION *connection)
+{
+	return CS_SUCCEED;
+}
+
+/*
+** ct_cmd_alloc()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Allocate a command.
+**
+** Parameters:
+** 	connection	- The connection.
+** 	cmdptr		- Set to the command.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if calloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_cmd_alloc(CS_CONNECTION *connection, CS_COMMAND **cmdptr)
+{
+	LT_REPLAY_CMD	*cmd;
+
+	if ((cmd = (LT_REPLAY_CMD *)calloc(1, sizeof (LT_REPLAY_CMD))) == NULL)
+	{
+		ex_error("ct_cmd_alloc: calloc() failed");
+		return CS_MEM_ERROR;
+	}
+	*cmdptr = (CS_COMMAND *)cmd;
+	return CS_SUCCEED;
+}
+
+/*
+** ct_cmd_drop()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Free a command.
+**
+** Parameters:
+** 	cmdptr		- The command.
+**
+** Returns:
+** 	CS_SUCCEED.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_cmd_drop(CS_COMMAND *cmdptr)
+{
+	LT_REPLAY_CMD	*cmd = (LT_REPLAY_CMD *)cmdptr;
+
+	free(cmd->datafmt);
+	free(cmd->binds);
+	free(cmd->values);
+	free(cmd);
+	return CS_SUCCEED;
+}
+
+/*
+** ct_command()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Initiate a command. Only `dbcc logtransfer` scans are told apart;
+** 	the text of other commands is ignored.
+**
+** Parameters:
+** 	cmdptr		- The command.
+** 	type		- The type of command.
+** 	buf		- The command text.
+** 	buflen		- Length of the text, or CS_NULLTERM.
+** 	option		- Command options.
+**
+** Returns:
+** 	CS_SUCCEED.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_command(CS_COMMAND *cmdptr, CS_INT type, CS_CHAR *buf, CS_INT buflen,
+	   CS_INT option)
+{
+	LT_REPLAY_CMD	*cmd = (LT_REPLAY_CMD *)cmdptr;
+	CS_INT		len = (CS_INT)strlen(LT_REPLAY_SCANCMD);
+
+	if (buflen == CS_NULLTERM)
+	{
+		buflen = (CS_INT)strlen(buf);
+	}
+	cmd->scan = (type == CS_LANG_CMD && buflen >= len &&
+		     strncasecmp(buf, LT_REPLAY_SCANCMD, len) == 0);
+	cmd->sent = CS_FALSE;
+	return CS_SUCCEED;
+}
+
+/*
+** ct_send()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Send a command. A scan is positioned at the results of the next
+** 	scan of the capture, skipping what the previous scan did not read.
+**
+** Parameters:
+** 	cmdptr		- The command.
+**
+** Returns:
+** 	CS_SUCCEED.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_send(CS_COMMAND *cmdptr)
+{
+	LT_REPLAY_CMD	*cmd = (LT_REPLAY_CMD *)cmdptr;
+	LT_CAPTURE_REC	rec;
+	CS_BIGINT	off = Lt_replay.cap.off;
+
+	cmd->sent = CS_TRUE;
+	cmd->captured = CS_FALSE;
+	cmd->done = CS_FALSE;
+	cmd->fetchable = CS_FALSE;
+	cmd->numcols = 0;
+	cmd->step = 0;
+	if (!cmd->scan)
+	{
+		return CS_SUCCEED;
+	}
+
+	/*
+	** Skip what the previous scan left of its results, up to the next
+	** scan record. A capture written without scan records is served as
+	** one scan.
+	*/
+	while (lt_replay_next(&rec) == CS_SUCCEED)
+	{
+		if (rec.type == LT_CAPTURE_SCAN)
+		{
+			cmd->captured = CS_TRUE;
+			break;
+		}
+		if (off == (CS_BIGINT)sizeof (CS_UINT))
+		{
+			Lt_replay.cap.off = off;
+			cmd->captured = CS_TRUE;
+			break;
+		}
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** ct_results()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Set up the next result of a command. A scan returns the results
+** 	captured, skipping the unfetched rows of the previous one; other
+** 	commands return CS_CMD_SUCCEED and CS_CMD_DONE.
+**
+** Parameters:
+** 	cmdptr		- The command.
+** 	result_type	- Set to the type of the result.
+**
+** Returns:
+** 	CS_SUCCEED, CS_END_RESULTS when there are no more results, or the
+** 	failure code the captured results ended with.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_results(CS_COMMAND *cmdptr, CS_INT *result_type)
+{
+	LT_REPLAY_CMD	*cmd = (LT_REPLAY_CMD *)cmdptr;
+	LT_CAPTURE_REC	rec;
+	CS_RETCODE	retcode;
+	CS_BIGINT	off;
+	CS_BYTE		*p;
+
+	if (!cmd->sent)
+	{
+		ex_error("ct_results: no command sent");
+		return CS_FAIL;
+	}
+	if (cmd->done)
+	{
+		return CS_END_RESULTS;
+	}
+	if (!cmd->captured)
+	{
+		switch (cmd->step++)
+		{
+			case 0:
+				*result_type = CS_CMD_SUCCEED;
+				return CS_SUCCEED;
+
+			case 1:
+				*result_type = CS_CMD_DONE;
+				return CS_SUCCEED;
+
+			default:
+				cmd->done = CS_TRUE;
+				return CS_END_RESULTS;
+		}
+	}
+
+	if (cmd->fetchable)
+	{
+		lt_replay_skip(cmd, CS_FALSE);
+	}
+	for (;;)
+	{
+		off = Lt_replay.cap.off;
+		if (lt_replay_next(&rec) != CS_SUCCEED)
+		{
+			cmd->done = CS_TRUE;
+			return CS_END_RESULTS;
+		}
+		switch (rec.type)
+		{
+			case LT_CAPTURE_RESULT:
+				if ((retcode = lt_replay_result(cmd, &rec)) != CS_SUCCEED)
+				{
+					return retcode;
+				}
+				*result_type = cmd->restype;
+				return CS_SUCCEED;
+
+			case LT_CAPTURE_END:
+				cmd->done = CS_TRUE;
+				if (rec.len < (CS_INT)sizeof (CS_RETCODE))
+				{
+					return CS_END_RESULTS;
+				}
+				p = rec.data;
+				LT_GET(p, retcode);
+				return retcode;
+
+			case LT_CAPTURE_SCAN:
+				Lt_replay.cap.off = off;
+				cmd->done = CS_TRUE;
+				return CS_END_RESULTS;
+
+			default:
+				/*
+				** Rows of a result not fetchable, and records
+				** of types added since, are skipped.
+				*/
+				break;
+		}
+	}
+}
+
+/*
+** ct_res_info()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Get information about the current result: its number of columns
+** 	(CS_NUMDATA), its message id (CS_MSGTYPE), or the number of rows
+** 	fetched (CS_ROW_COUNT).
+**
+** Parameters:
+** 	cmdptr		- The command.
+** 	type		- The information to get.
+** 	buf		- Set to the information.
+** 	buflen		- Length of the buffer.
+** 	outlen		- Set to the length of the information.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL for other information.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_res_info(CS_COMMAND *cmdptr, CS_INT type, CS_VOID *buf, CS_INT buflen,
+	    CS_INT *outlen)
+{
+	LT_REPLAY_CMD	*cmd = (LT_REPLAY_CMD *)cmdptr;
+	CS_SMALLINT	msgid;
+
+	switch ((int)type)
+	{
+		case CS_NUMDATA:
+			memcpy(buf, &cmd->numcols, sizeof (CS_INT));
+			break;
+
+		case CS_ROW_COUNT:
+			memcpy(buf, &cmd->rowcount, sizeof (CS_INT));
+			break;
+
+		case CS_MSGTYPE:
+			msgid = (CS_SMALLINT)cmd->msgid;
+			memcpy(buf, &msgid, sizeof (msgid));
+			if (outlen != NULL)
+			{
+				*outlen = sizeof (msgid);
+			}
+			return CS_SUCCEED;
+
+		default:
+			ex_error("ct_res_info: unsupported type");
+			return CS_FAIL;
+	}
+	if (outlen != NULL)
+	{
+		*outlen = sizeof (CS_INT);
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** ct_describe()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Describe a column of the current result, as captured.
+**
+** Parameters:
+** 	cmdptr		- The command.
+** 	item		- The column number, from 1.
+** 	datafmt		- Set to the description.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if there is no such column.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_describe(CS_COMMAND *cmdptr, CS_INT item, CS_DATAFMT *datafmt)
+{
+	LT_REPLAY_CMD	*cmd = (LT_REPLAY_CMD *)cmdptr;
+
+	if (item < 1 || item > cmd->numcols)
+	{
+		ex_error("ct_describe: no such column");
+		return CS_FAIL;
+	}
+	memcpy(datafmt, &cmd->datafmt[item - 1], sizeof (CS_DATAFMT));
+	return CS_SUCCEED;
+}
+
+/*
+** ct_bind()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Bind a column of the current result to program variables.
+**
+** Parameters:
+** 	cmdptr		- The command.
+** 	item		- The column number, from 1.
+** 	datafmt		- The format to bind to.
+** 	buf		- The variable for the value.
+** 	copied		- The variable for the length of the value, or NULL.
+** 	indicator	- The variable for the indicator, or NULL.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if there is no such column or its value
+** 	cannot be converted to the format.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_bind(CS_COMMAND *cmdptr, CS_INT item, CS_DATAFMT *datafmt, CS_VOID *buf,
+	CS_INT *copied, CS_SMALLINT *indicator)
+{
+	LT_REPLAY_CMD	*cmd = (LT_REPLAY_CMD *)cmdptr;
+	LT_REPLAY_BIND	*bind;
+
+	if (item < 1 || item > cmd->numcols)
+	{
+		ex_error("ct_bind: no such column");
+		return CS_FAIL;
+	}
+	if (!lt_replay_will_convert(cmd->datafmt[item - 1].datatype,
+				    datafmt->datatype))
+	{
+		ex_error("ct_bind: unsupported conversion");
+		return CS_FAIL;
+	}
+	bind = &cmd->binds[item - 1];
+	memcpy(&bind->datafmt, datafmt, sizeof (CS_DATAFMT));
+	bind->buf = buf;
+	bind->copied = copied;
+	bind->indicator = indicator;
+	bind->bound = CS_TRUE;
+	return CS_SUCCEED;
+}
+
+/*
+** ct_fetch()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Fetch the next row of the current result into the bound
+** 	variables. A null is bound as the string installed by
+** 	cs_setnull(), or as zeroes. A truncated value's indicator is set
+** 	to its length.
+**
+** Parameters:
+** 	cmdptr		- The command.
+** 	type		- CS_UNUSED.
+** 	offset		- CS_UNUSED.
+** 	option		- CS_UNUSED.
+** 	rows_read	- Set to the number of rows fetched, or NULL.
+**
+** Returns:
+** 	CS_SUCCEED, CS_ROW_FAIL if a value was truncated, CS_END_DATA when
+** 	there are no more rows, or CS_FAIL if the result is not fetchable
+** 	or the row is malformed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_fetch(CS_COMMAND *cmdptr, CS_INT type, CS_INT offset, CS_INT option,
+	 CS_INT *rows_read)
+{
+	LT_REPLAY_CMD	*cmd = (LT_REPLAY_CMD *)cmdptr;
+	LT_REPLAY_BIND	*bind;
+	LT_CAPTURE_VALUE *value;
+	LT_CAPTURE_REC	rec;
+	CS_RETCODE	retcode = CS_SUCCEED;
+	CS_BIGINT	off;
+	CS_BOOL		truncated;
+	CS_INT		outlen;
+	CS_INT		i;
+
+	if (rows_read != NULL)
+	{
+		*rows_read = 0;
+	}
+	if (!cmd->fetchable)
+	{
+		return (cmd->numcols > 0) ? CS_END_DATA : CS_FAIL;
+	}
+	off = Lt_replay.cap.off;
+	if (lt_replay_next(&rec) != CS_SUCCEED)
+	{
+		cmd->fetchable = CS_FALSE;
+		return CS_END_DATA;
+	}
+	if (rec.type != LT_CAPTURE_ROW)
+	{
+		Lt_replay.cap.off = off;
+		cmd->fetchable = CS_FALSE;
+		return CS_END_DATA;
+	}
+	if (lt_capture_row(&rec, cmd->numcols, cmd->values) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+
+	for (i = 0; i < cmd->numcols; i++)
+	{
+		bind = &cmd->binds[i];
+		value = &cmd->values[i];
+		if (!bind->bound)
+		{
+			continue;
+		}
+		outlen = 0;
+		truncated = CS_FALSE;
+		if (value->len == CS_NULLDATA)
+		{
+			if (lt_replay_class(bind->datafmt.datatype) == 'c')
+			{
+				lt_replay_convert(CS_CHAR_TYPE,
+						  (CS_BYTE *)Lt_replay.nullchar,
+						  Lt_replay.nullcharlen,
+						  &bind->datafmt, bind->buf,
+						  &outlen, &truncated);
+			}
+			else
+			{
+				memset(bind->buf, 0, MAX(bind->datafmt.maxlength, 0));
+			}
+		}
+		else
+		{
+			lt_replay_convert(cmd->datafmt[i].datatype, value->data,
+					  value->len, &bind->datafmt, bind->buf,
+					  &outlen, &truncated);
+		}
+		if (bind->copied != NULL)
+		{
+			*bind->copied = outlen;
+		}
+		if (bind->indicator != NULL)
+		{
+			*bind->indicator = (value->len == CS_NULLDATA) ? CS_NULLDATA :
+				truncated ? (CS_SMALLINT)MIN(value->len, 0x7fff) : 0;
+		}
+		if (truncated)
+		{
+			retcode = CS_ROW_FAIL;
+		}
+	}
+
+	cmd->rowcount++;
+	if (rows_read != NULL)
+	{
+		*rows_read = 1;
+	}
+	return retcode;
+}
+
+/*
+** ct_cancel()
+**
+** Type of function:
+** 	replay Client-Library api
+**
+** Purpose:
+** 	Cancel the current result of a command, or all its results.
+**
+** Parameters:
+** 	connection	- The connection, or NULL.
+** 	cmdptr		- The command, or NULL.
+** 	type		- CS_CANCEL_CURRENT, CS_CANCEL_ALL or
+** 			  CS_CANCEL_ATTN.
+**
+** Returns:
+** 	CS_SUCCEED.
+*/
+
+CS_RETCODE CS_PUBLIC
+ct_cancel(CS_CONNECTION *connection, CS_COMMAND *cmdptr, CS_INT type)
+{
+	LT_REPLAY_CMD	*cmd = (LT_REPLAY_CMD *)cmdptr;
+
+	if (cmd == NULL || !cmd->sent)
+	{
+		return CS_SUCCEED;
+	}
+	if (type == CS_CANCEL_CURRENT)
+	{
+		lt_replay_skip(cmd, CS_FALSE);
+	}
+	else
+	{
+		lt_replay_skip(cmd, CS_TRUE);
+		cmd->done = CS_TRUE;
+	}
+	return CS_SUCCEED;
+}
+
+/*****************************************************************************
+**
+** CS-Library routines
+**
+*****************************************************************************/
+
+/*
+** cs_ctx_alloc()
+**
+** Type of function:
+** 	replay CS-Library api
+**
+** Purpose:
+** 	Allocate the context.
+**
+** Parameters:
+** 	version		- The CS-Library version.
+** 	context		- Set to the context.
+**
+** Returns:
+** 	CS_SUCCEED.
+*/
+
+CS_RETCODE CS_PUBLIC
+cs_ctx_alloc(CS_INT version, CS_CONTEXT **context)
+{
+	Lt_replay.nullcharlen = 0;
+	*context = (CS_CONTEXT *)&Lt_replay;
+	return CS_SUCCEED;
+}
+
+/*
+** cs_ctx_drop()
+**
+** Type of function:
+** 	replay CS-Library api
+**
+** Purpose:
+** 	Drop the context. Nothing to do.
+**
+** Parameters:
+** 	context		- The context.
+**
+** Returns:
+** 	CS_SUCCEED.
+*/
+
+CS_RETCODE CS_PUBLIC
+cs_ctx_drop(CS_CONTEXT *context)
+{
+	return CS_SUCCEED;
+}
+
+/*
+** cs_setnull()
+**
+** Type of function:
+** 	replay CS-Library api
+**
+** Purpose:
+** 	Set the value a null is bound as. Only the character null is kept;
+** 	nulls of other types are bound as zeroes.
+**
+** Parameters:
+** 	context		- The context.
+** 	datafmt		- The datatype.
+** 	buf		- The null value.
+** 	buflen		- Its length.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a character null is too long.
+*/
+
+CS_RETCODE CS_PUBLIC
+cs_setnull(CS_CONTEXT *context, CS_DATAFMT *datafmt, CS_VOID *buf,
+	   CS_INT buflen)
+{
+	if (lt_replay_class(datafmt->datatype) != 'c')
+	{
+		return CS_SUCCEED;
+	}
+	if (buf == NULL)
+	{
+		buflen = 0;
+	}
+	if (buflen < 0 || buflen > LT_REPLAY_NULLLEN)
+	{
+		ex_error("cs_setnull: null value too long");
+		return CS_FAIL;
+	}
+	memcpy(Lt_replay.nullchar, buf, buflen);
+	Lt_replay.nullcharlen = buflen;
+	return CS_SUCCEED;
+}
+
+/*
+** cs_will_convert()
+**
+** Type of function:
+** 	replay CS-Library api
+**
+** Purpose:
+** 	Check whether a conversion is supported.
+**
+** Parameters:
+** 	context		- The context.
+** 	srctype		- The source datatype.
+** 	desttype	- The destination datatype.
+** 	result		- Set to CS_TRUE or CS_FALSE.
+**
+** Returns:
+** 	CS_SUCCEED.
+*/
+
+CS_RETCODE CS_PUBLIC
+cs_will_convert(CS_CONTEXT *context, CS_INT srctype, CS_INT desttype,
+		CS_BOOL *result)
+{
+	*result = lt_replay_will_convert(srctype, desttype);
+	return CS_SUCCEED;
+}
+
+/*
+** cs_convert()
+**
+** Type of function:
+** 	replay CS-Library api
+**
+** Purpose:
+** 	Convert a value from one format to another.
+**
+** Parameters:
+** 	context		- The context.
+** 	srcfmt		- The source format; 'maxlength' is the length of
+** 			  the value.
+** 	srcdata		- The value.
+** 	destfmt		- The destination format.
+** 	destdata	- The destination.
+** 	outlen		- Set to the length of the destination, or NULL.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the conversion is not supported or the
+** 	value was truncated.
+*/
+
+CS_RETCODE CS_PUBLIC
+cs_convert(CS_CONTEXT *context, CS_DATAFMT *srcfmt, CS_VOID *srcdata,
+	   CS_DATAFMT *destfmt, CS_VOID *destdata, CS_INT *outlen)
+{
+	CS_BOOL		truncated;
+	CS_INT		len;
+
+	if (lt_replay_convert(srcfmt->datatype, (CS_BYTE *)srcdata,
+			      srcfmt->maxlength, destfmt, destdata, &len,
+			      &truncated) != CS_SUCCEED || truncated)
+	{
+		return CS_FAIL;
+	}
+	if (outlen != NULL)
+	{
+		*outlen = len;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** cs_dt_crack()
+**
+** Type of function:
+** 	replay CS-Library api
+**
+** Purpose:
+** 	Crack a date or time value into its parts.
+**
+** Parameters:
+** 	context		- The context.
+** 	datetype	- The datatype of the value.
+** 	dateval		- The value.
+** 	daterec		- Set to the parts.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the datatype is not a date or time.
+*/
+
+CS_RETCODE CS_PUBLIC
+cs_dt_crack(CS_CONTEXT *context, CS_INT datetype, CS_VOID *dateval,
+	    CS_DATEREC *daterec)
+{
+	return lt_replay_crack(datetype, dateval, daterec);
+}
@@ -0,0 +1,636 @@
+/*
+** Description
+** -----------
+** 	This file implements the ring buffer sink, which publishes committed
+** 	transactions into a memory mapped file shared with consumers on the
+** 	same host, and the consumer side used to read them.
+**
+** 	The file is an LT_RING_HEADER page followed by the data area, a ring
+** 	of records. Each transaction is one event record whose payload is
+** 	an LT_RING_XACTLEN byte transaction header,
+**
+** 		CS_UBIGINT	BEGINXACT position
+** 		CS_UBIGINT	ENDXACT position
+** 		CS_BIGINT	commit time, microseconds since the epoch
+** 		CS_UINT		number of changes
+** 		CS_UINT		length of the changes
+**
+** 	followed by the changes as encoded by ltchange.c, which consumers
+** 	decode in place. A record never wraps: one that does not fit before
+** 	the end of the data area is preceded by a pad record filling it.
+**
+** 	There is a single producer. It writes the records of a batch, then
+** 	publishes them all by advancing the ring's head. Each consumer owns
+** 	a slot holding its pid and read cursor, and the producer does not
+** 	overwrite data that an attached consumer has not released, waiting
+** 	for it instead. Consumers whose process has exited are detached by
+** 	the producer while it waits. With no consumer attached, old data is
+** 	simply overwritten; a consumer starts at the head when it attaches.
+**
+** 	Reopening an existing ring of the same capacity carries on from its
+** 	head and sequence number, so consumers can outlive the producer.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltbatch.h"
+#include "ltring.h"
+
+#define LT_PUT(_p, _v)	(memcpy((_p), &(_v), sizeof (_v)), (_p) += sizeof (_v))
+
+#define LT_RING_ROUND(_n)	(((_n) + LT_RING_ALIGN - 1) & ~(CS_UBIGINT)(LT_RING_ALIGN - 1))
+#define LT_RING_MINCAPACITY	(64 * 1024)
+
+/*
+** While waiting for consumers, the producer spins LT_RING_SPINS times,
+** then sleeps LT_RING_SLEEP microseconds at a time, and looks for exited
+** consumers every LT_RING_REAP microseconds.
+*/
+#define LT_RING_SPINS		1000
+#define LT_RING_SLEEP		50
+#define LT_RING_REAP		100000
+
+/*
+** State of a ring sink. 'tail' is the position the next record is
+** written at, and 'head' the position last published.
+*/
+typedef struct _lt_ring_sink
+{
+	LT_SINK		sink;
+	int		fd;
+	LT_RING_HEADER	*header;
+	CS_BYTE		*data;
+	size_t		maplen;
+	CS_UBIGINT	capacity;
+	CS_UBIGINT	tail;
+	CS_UBIGINT	head;
+	CS_UBIGINT	seq;
+} LT_RING_SINK;
+
+/*****************************************************************************
+**
+** producer functions
+**
+*****************************************************************************/
+
+/*
+** lt_ring_publish()
+**
+** Type of function:
+** 	ring buffer sink internal api
+**
+** Purpose:
+** 	Make the records written so far visible to consumers.
+**
+** Parameters:
+** 	rs		- The sink.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_ring_publish(LT_RING_SINK *rs)
+{
+	atomic_store_explicit(&rs->header->seq, rs->seq, memory_order_relaxed);
+	atomic_store(&rs->header->head, rs->tail);
+	rs->head = rs->tail;
+}
+
+/*
+** lt_ring_reap()
+**
+** Type of function:
+** 	ring buffer sink internal api
+**
+** Purpose:
+** 	Free the slots of consumers whose process no longer exists.
+**
+** Parameters:
+** 	rs		- The sink.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_ring_reap(LT_RING_SINK *rs)
+{
+	LT_RING_SLOT	*slot;
+	CS_INT		pid;
+	CS_INT		i;
+
+	for (i = 0; i < LT_RING_MAXCONSUMERS; i++)
+	{
+		slot = &rs->header->slots[i];
+		pid = atomic_load(&slot->pid);
+		if (pid > 0 && kill((pid_t)pid, 0) != 0 && errno == ESRCH)
+		{
+			atomic_compare_exchange_strong(&slot->pid, &pid, 0);
+		}
+	}
+}
+
+/*
+** lt_ring_space()
+**
+** Type of function:
+** 	ring buffer sink internal api
+**
+** Purpose:
+** 	Wait until 'need' bytes can be written at the tail without
+** 	overwriting data an attached consumer has not released, or that
+** 	has not been published. Records written but not yet published are
+** 	published before waiting, so consumers can make progress.
+**
+** Parameters:
+** 	rs		- The sink.
+** 	need		- Number of bytes to be written.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_ring_space(LT_RING_SINK *rs, CS_UBIGINT need)
+{
+	LT_RING_SLOT	*slot;
+	CS_UBIGINT	min;
+	CS_UBIGINT	cursor;
+	CS_BIGINT	reaped = 0;
+	CS_INT		spins = 0;
+	CS_INT		i;
+	struct timespec	ts;
+
+	if (rs->tail + need - rs->head > rs->capacity)
+	{
+		lt_ring_publish(rs);
+	}
+
+	for (;;)
+	{
+		min = rs->head;
+		for (i = 0; i < LT_RING_MAXCONSUMERS; i++)
+		{
+			slot = &rs->header->slots[i];
+			if (atomic_load(&slot->pid) > 0)
+			{
+				cursor = atomic_load(&slot->cursor);
+				if (cursor < min)
+				{
+					min = cursor;
+				}
+			}
+		}
+		if (rs->tail + need - min <= rs->capacity)
+		{
+			return;
+		}
+
+		if (rs->head != rs->tail)
+		{
+			lt_ring_publish(rs);
+		}
+		if (spins < LT_RING_SPINS)
+		{
+			spins++;
+			sched_yield();
+			continue;
+		}
+		if (lt_clock_usec() - reaped >= LT_RING_REAP)
+		{
+			lt_ring_reap(rs);
+			reaped = lt_clock_usec();
+		}
+		ts.tv_sec = 0;
+		ts.tv_nsec = LT_RING_SLEEP * 1000;
+		nanosleep(&ts, NULL);
+	}
+}
+
+/*
+** lt_ring_write()
+**
+** Type of function:
+** 	ring buffer sink internal api
+**
+** Purpose:
+** 	Write each transaction of a batch as an event record, then publish
+** 	them together.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	batch		- The batch to write.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a transaction is too large for the ring.
+*/
+
+CS_STATIC CS_RETCODE
+lt_ring_write(LT_SINK *sink, LT_BATCH *batch)
+{
+	LT_RING_SINK	*rs = (LT_RING_SINK *)sink->ctx;
+	LT_BATCH_XACT	*bx;
+	LT_RING_RECORD	*rec;
+	CS_UBIGINT	total;
+	CS_UBIGINT	pad;
+	CS_UBIGINT	off;
+	CS_UINT		u32;
+	CS_INT		i;
+	CS_BYTE		*p;
+
+	for (i = 0; i < batch->nxacts; i++)
+	{
+		bx = &batch->xacts[i];
+		total = sizeof (LT_RING_RECORD) +
+			LT_RING_ROUND(LT_RING_XACTLEN + (CS_UBIGINT)bx->len);
+		if (total > rs->capacity / 2)
+		{
+			ex_error("lt_ring_write: transaction too large for the ring");
+			return CS_FAIL;
+		}
+
+		off = rs->tail & (rs->capacity - 1);
+		pad = (off + total > rs->capacity) ? rs->capacity - off : 0;
+		lt_ring_space(rs, pad + total);
+		if (pad > 0)
+		{
+			rec = (LT_RING_RECORD *)(rs->data + off);
+			rec->len = (CS_UINT)(pad - sizeof (LT_RING_RECORD));
+			rec->type = LT_RING_PAD;
+			rec->seq = 0;
+			rs->tail += pad;
+			off = 0;
+		}
+
+		rec = (LT_RING_RECORD *)(rs->data + off);
+		rec->len = (CS_UINT)(LT_RING_XACTLEN + bx->len);
+		rec->type = LT_RING_EVENT;
+		rec->seq = ++rs->seq;
+		p = (CS_BYTE *)(rec + 1);
+		LT_PUT(p, bx->xactid);
+		LT_PUT(p, bx->commitpos);
+		LT_PUT(p, bx->committime);
+		u32 = (CS_UINT)bx->nchanges;
+		LT_PUT(p, u32);
+		u32 = (CS_UINT)bx->len;
+		LT_PUT(p, u32);
+		memcpy(p, batch->changes.data + bx->offset, bx->len);
+		rs->tail += total;
+	}
+
+	lt_ring_publish(rs);
+	return CS_SUCCEED;
+}
+
+/*
+** lt_ring_close()
+**
+** Type of function:
+** 	ring buffer sink internal api
+**
+** Purpose:
+** 	Unmap the ring and free the sink. The file is left for consumers
+** 	to drain.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the close failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_ring_close(LT_SINK *sink)
+{
+	LT_RING_SINK	*rs = (LT_RING_SINK *)sink->ctx;
+	CS_RETCODE	retcode = CS_SUCCEED;
+
+	munmap(rs->header, rs->maplen);
+	if (close(rs->fd) != 0)
+	{
+		ex_error("lt_ring_close: close() failed");
+		retcode = CS_FAIL;
+	}
+	free(rs);
+	return retcode;
+}
+
+/*
+** lt_ring_open()
+**
+** Type of function:
+** 	ring buffer sink api
+**
+** Purpose:
+** 	Open a ring buffer sink on the file 'path', creating it if needed.
+** 	An existing ring of the same capacity is carried on; any other file
+** 	is reinitialized.
+**
+** Parameters:
+** 	path		- Path of the ring file.
+** 	capacity	- Size of the data area in bytes, rounded up to a
+** 			  power of 2 of at least 64K.
+** 	sink		- Set to the new sink.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a malloc failed, or CS_FAIL if the file
+** 	could not be set up.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_ring_open(CS_CHAR *path, CS_INT capacity, LT_SINK **sink)
+{
+	LT_RING_SINK	*rs;
+	LT_RING_HEADER	old;
+	struct stat	st;
+	CS_BOOL		reuse;
+	CS_UBIGINT	cap;
+
+	for (cap = LT_RING_MINCAPACITY; cap < (CS_UBIGINT)capacity; cap *= 2)
+	{
+		;
+	}
+
+	rs = (LT_RING_SINK *)calloc(1, sizeof (LT_RING_SINK));
+	if (rs == NULL)
+	{
+		ex_error("lt_ring_open: calloc() failed");
+		return CS_MEM_ERROR;
+	}
+	rs->capacity = cap;
+	rs->maplen = LT_RING_DATAOFF + cap;
+
+	rs->fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (rs->fd < 0 || fstat(rs->fd, &st) != 0)
+	{
+		ex_error("lt_ring_open: open() failed");
+		goto error;
+	}
+	reuse = ((size_t)st.st_size == rs->maplen &&
+		 pread(rs->fd, &old, sizeof (old), 0) == sizeof (old) &&
+		 old.magic == LT_RING_MAGIC && old.version == LT_RING_VERSION &&
+		 old.capacity == cap);
+	if (!reuse && (ftruncate(rs->fd, 0) != 0 ||
+		       ftruncate(rs->fd, rs->maplen) != 0))
+	{
+		ex_error("lt_ring_open: ftruncate() failed");
+		goto error;
+	}
+
+	rs->header = (LT_RING_HEADER *)mmap(NULL, rs->maplen,
+		PROT_READ | PROT_WRITE, MAP_SHARED, rs->fd, 0);
+	if (rs->header == (LT_RING_HEADER *)MAP_FAILED)
+	{
+		ex_error("lt_ring_open: mmap() failed");
+		rs->header = NULL;
+		goto error;
+	}
+	rs->data = (CS_BYTE *)rs->header + LT_RING_DATAOFF;
+
+	if (reuse)
+	{
+		rs->head = rs->tail = atomic_load(&rs->header->head);
+		rs->seq = atomic_load(&rs->header->seq);
+		lt_ring_reap(rs);
+	}
+	else
+	{
+		/*
+		** The file is all zeroes: the ring is empty and every slot
+		** free. The magic is set last, for consumers to attach.
+		*/
+		rs->header->version = LT_RING_VERSION;
+		rs->header->capacity = cap;
+		atomic_thread_fence(memory_order_release);
+		rs->header->magic = LT_RING_MAGIC;
+	}
+
+	rs->sink.name = "ring";
+	rs->sink.write = lt_ring_write;
+	rs->sink.close = lt_ring_close;
+	rs->sink.inmemory = CS_TRUE;
+	rs->sink.ctx = rs;
+	*sink = &rs->sink;
+	return CS_SUCCEED;
+
+error:
+	if (rs->fd >= 0)
+	{
+		close(rs->fd);
+	}
+	free(rs);
+	return CS_FAIL;
+}
+
+/*****************************************************************************
+**
+** consumer functions
+**
+*****************************************************************************/
+
+/*
+** lt_ring_attach()
+**
+** Type of function:
+** 	ring buffer consumer api
+**
+** Purpose:
+** 	Map the ring file 'path' and claim a consumer slot, starting at the
+** 	ring's head.
+**
+** Parameters:
+** 	path		- Path of the ring file.
+** 	reader		- The consumer state to fill in.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the file is not a ring or no slot is
+** 	free.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_ring_attach(CS_CHAR *path, LT_RING_READER *reader)
+{
+	LT_RING_HEADER	*header;
+	LT_RING_SLOT	*slot;
+	struct stat	st;
+	CS_UBIGINT	head;
+	CS_INT		idle;
+	int		fd;
+	CS_INT		i;
+
+	memset(reader, 0, sizeof (*reader));
+	fd = open(path, O_RDWR);
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < LT_RING_DATAOFF)
+	{
+		ex_error("lt_ring_attach: not a ring file");
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		return CS_FAIL;
+	}
+	header = (LT_RING_HEADER *)mmap(NULL, st.st_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (header == (LT_RING_HEADER *)MAP_FAILED)
+	{
+		ex_error("lt_ring_attach: mmap() failed");
+		return CS_FAIL;
+	}
+	if (header->magic != LT_RING_MAGIC ||
+	    header->version != LT_RING_VERSION ||
+	    LT_RING_DATAOFF + header->capacity != (CS_UBIGINT)st.st_size)
+	{
+		ex_error("lt_ring_attach: not a ring file");
+		munmap(header, st.st_size);
+		return CS_FAIL;
+	}
+	atomic_thread_fence(memory_order_acquire);
+
+	for (i = 0; i < LT_RING_MAXCONSUMERS; i++)
+	{
+		idle = 0;
+		if (atomic_compare_exchange_strong(&header->slots[i].pid, &idle, -1))
+		{
+			break;
+		}
+	}
+	if (i == LT_RING_MAXCONSUMERS)
+	{
+		ex_error("lt_ring_attach: no free consumer slot");
+		munmap(header, st.st_size);
+		return CS_FAIL;
+	}
+
+	/*
+	** Once the slot is live, move the cursor up to the head until the
+	** head is seen not to have moved past it: the producer can only
+	** have overwritten data behind the head it had published.
+	*/
+	slot = &header->slots[i];
+	head = atomic_load(&header->head);
+	atomic_store(&slot->cursor, head);
+	atomic_store(&slot->pid, (CS_INT)getpid());
+	while (atomic_load(&header->head) != head)
+	{
+		head = atomic_load(&header->head);
+		atomic_store(&slot->cursor, head);
+	}
+
+	reader->header = header;
+	reader->data = (CS_BYTE *)header + LT_RING_DATAOFF;
+	reader->maplen = st.st_size;
+	reader->slot = i;
+	reader->pos = head;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_ring_read()
+**
+** Type of function:
+** 	ring buffer consumer api
+**
+** Purpose:
+** 	Return the next published event, in place. Its payload stays valid
+** 	until lt_ring_release() is called past it.
+**
+** Parameters:
+** 	reader		- The consumer.
+** 	data		- Set to the event's payload.
+** 	len		- Set to its length.
+** 	seq		- Set to its sequence number.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_END_DATA if no event is available.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_ring_read(LT_RING_READER *reader, CS_BYTE **data, CS_INT *len,
+	     CS_UBIGINT *seq)
+{
+	LT_RING_RECORD	*rec;
+	CS_UBIGINT	head;
+
+	head = atomic_load_explicit(&reader->header->head, memory_order_acquire);
+	while (reader->pos < head)
+	{
+		rec = (LT_RING_RECORD *)(reader->data +
+			(reader->pos & (reader->header->capacity - 1)));
+		reader->pos += sizeof (LT_RING_RECORD) + LT_RING_ROUND(rec->len);
+		if (rec->type == LT_RING_EVENT)
+		{
+			*data = (CS_BYTE *)(rec + 1);
+			*len = (CS_INT)rec->len;
+			*seq = rec->seq;
+			return CS_SUCCEED;
+		}
+	}
+	return CS_END_DATA;
+}
+
+/*
+** lt_ring_release()
+**
+** Type of function:
+** 	ring buffer consumer api
+**
+** Purpose:
+** 	Publish the consumer's cursor past the events it has read, letting
+** 	the producer reuse their space.
+**
+** Parameters:
+** 	reader		- The consumer.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_ring_release(LT_RING_READER *reader)
+{
+	atomic_store_explicit(&reader->header->slots[reader->slot].cursor,
+		reader->pos, memory_order_release);
+}
+
+/*
+** lt_ring_detach()
+**
+** Type of function:
+** 	ring buffer consumer api
+**
+** Purpose:
+** 	Free the consumer's slot and unmap the ring.
+**
+** Parameters:
+** 	reader		- The consumer.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_ring_detach(LT_RING_READER *reader)
+{
+	if (reader->header != NULL)
+	{
+		atomic_store(&reader->header->slots[reader->slot].pid, 0);
+		munmap(reader->header, reader->maplen);
+		reader->header = NULL;
+	}
+}
@@ -0,0 +1,128 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	shared memory ring buffer sink and its consumer side in ltring.c.
+**
+*/
+
+#ifndef __LTRING_H__
+#define __LTRING_H__
+
+#include <stdatomic.h>
+#include "ltbatch.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+#define LT_RING_MAGIC		0x3152544c	/* "LTR1" */
+#define LT_RING_VERSION		1
+
+/*
+** The data area starts one page into the file. Records are aligned to,
+** and their headers are, LT_RING_ALIGN bytes.
+*/
+#define LT_RING_DATAOFF		4096
+#define LT_RING_ALIGN		16
+#define LT_RING_MAXCONSUMERS	16
+
+/*
+** Record types. A pad record fills the end of the data area when the
+** next record does not fit before it wraps.
+*/
+#define LT_RING_EVENT		1
+#define LT_RING_PAD		2
+
+/*
+** Length of the transaction header leading each event: BEGINXACT and
+** ENDXACT positions, commit time, number and length of the changes.
+*/
+#define LT_RING_XACTLEN		32
+
+/*
+** A consumer slot. 'pid' is 0 for a free slot and -1 while it is being
+** claimed; 'cursor' is the ring position up to which the consumer is
+** done with the data. Each slot has a cache line of its own.
+*/
+typedef struct _lt_ring_slot
+{
+	_Atomic CS_INT		pid;
+	CS_INT			pad0;
+	_Atomic CS_UBIGINT	cursor;
+	CS_BYTE			pad1[48];
+} LT_RING_SLOT;
+
+/*
+** The header of the ring file. Ring positions grow without wrapping;
+** a position's offset in the data area is the position modulo the
+** capacity, a power of 2. 'head' is the position up to which records
+** are published, and is only advanced by the producer.
+*/
+typedef struct _lt_ring_header
+{
+	CS_UINT			magic;
+	CS_UINT			version;
+	CS_UBIGINT		capacity;
+	CS_BYTE			pad0[48];
+	_Atomic CS_UBIGINT	head;
+	_Atomic CS_UBIGINT	seq;
+	CS_BYTE			pad1[48];
+	LT_RING_SLOT		slots[LT_RING_MAXCONSUMERS];
+} LT_RING_HEADER;
+
+/*
+** The header of a record. 'len' is the length of the payload following
+** it, and 'seq' the event's sequence number, counting from 1.
+*/
+typedef struct _lt_ring_record
+{
+	CS_UINT			len;
+	CS_UINT			type;
+	CS_UBIGINT		seq;
+} LT_RING_RECORD;
+
+/*
+** A consumer attached to a ring. 'pos' is the position of the next
+** record to read; 'cursor' is published up to it by lt_ring_release().
+*/
+typedef struct _lt_ring_reader
+{
+	LT_RING_HEADER		*header;
+	CS_BYTE			*data;
+	size_t			maplen;
+	CS_INT			slot;
+	CS_UBIGINT		pos;
+} LT_RING_READER;
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltring.c */
+extern CS_RETCODE CS_PUBLIC lt_ring_open(
+	CS_CHAR *path,
+	CS_INT capacity,
+	LT_SINK **sink
+	);
+extern CS_RETCODE CS_PUBLIC lt_ring_attach(
+	CS_CHAR *path,
+	LT_RING_READER *reader
+	);
+extern CS_RETCODE CS_PUBLIC lt_ring_read(
+	LT_RING_READER *reader,
+	CS_BYTE **data,
+	CS_INT *len,
+	CS_UBIGINT *seq
+	);
+extern CS_VOID CS_PUBLIC lt_ring_release(
+	LT_RING_READER *reader
+	);
+extern CS_VOID CS_PUBLIC lt_ring_detach(
+	LT_RING_READER *reader
+	);
+
+#endif /* __LTRING_H__ */
@@ -0,0 +1,752 @@
+/*
+** Description
+** -----------
+** 	This file implements the segment sink, which appends batches of
+** 	committed transactions to a series of compressed, append-only
+** 	segment files, "<prefix>.<number>.lts". A segment is closed and the
+** 	next one started once it holds a number of bytes or has been open
+** 	for a number of seconds, checked when a batch is written; a new
+** 	segment is only created when a batch arrives for it. Existing
+** 	segments are never overwritten: numbering resumes past them.
+**
+** 	A segment is laid out as:
+**
+** 		CS_UINT		LT_SEGMENT_MAGIC
+** 		CS_UINT		LT_SEGMENT_VERSION
+** 		CS_BIGINT	creation time, microseconds since the epoch
+**
+** 	followed by one block per batch:
+**
+** 		CS_UINT		LT_SEGMENT_BLOCK_MAGIC
+** 		CS_UINT		flags
+** 		CS_UINT		length of the batch
+** 		CS_UINT		length of the block data
+** 		CS_UBIGINT	commit position of the first transaction
+** 		CS_UBIGINT	commit position of the last transaction
+**
+** 	whose data is the batch, laid out as by ltsink.c, compressed with
+** 	the codec of ltlz.c, or stored as is if LT_SEGMENT_STORED is set.
+**
+** 	A closed segment ends with a footer: an index entry per block,
+**
+** 		CS_UBIGINT	offset of the block
+** 		CS_UBIGINT	commit position of the first transaction
+** 		CS_UBIGINT	commit position of the last transaction
+** 		CS_BIGINT	commit time of the first transaction
+** 		CS_BIGINT	commit time of the last transaction
+**
+** 	and a trailer:
+**
+** 		CS_UBIGINT	commit position of the first transaction
+** 		CS_UBIGINT	commit position of the last transaction
+** 		CS_BIGINT	commit time of the first transaction
+** 		CS_BIGINT	commit time of the last transaction
+** 		CS_UBIGINT	offset of the index
+** 		CS_UINT		number of blocks
+** 		CS_UINT		LT_SEGMENT_FOOTER_MAGIC
+**
+** 	A reader finds the range of a segment in its last 48 bytes. A
+** 	segment left without a footer by a crash can still be read block by
+** 	block from its start. lt_segment_map() and lt_segment_next() read
+** 	the blocks of a segment back in order.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltbatch.h"
+#include "ltsink.h"
+#include "ltlz.h"
+#include "ltsegment.h"
+#include "ltdurable.h"
+
+#define LT_PUT(_p, _v)	(memcpy((_p), &(_v), sizeof (_v)), (_p) += sizeof (_v))
+#define LT_GET(_p, _v)	(memcpy(&(_v), (_p), sizeof (_v)), (_p) += sizeof (_v))
+
+#define LT_SEGMENT_MAXNUM	999999
+
+/*
+** State of a segment sink. 'fd' is -1 between segments; 'offset' is the
+** length of the open segment and 'opened' when it was created, by the
+** monotonic clock.
+*/
+typedef struct _lt_segment_sink
+{
+	LT_SINK			sink;
+	CS_CHAR			*prefix;
+	CS_CHAR			*path;
+	CS_INT			maxbytes;
+	CS_INT			maxsecs;
+	int			fd;
+	CS_INT			number;
+	CS_BIGINT		opened;
+	CS_BIGINT		offset;
+	CS_UINT			nblocks;
+	LT_SEGMENT_RANGE	range;
+	LT_BUF			raw;
+	LT_BUF			block;
+	LT_BUF			index;
+} LT_SEGMENT_SINK;
+
+/*****************************************************************************
+**
+** segment functions
+**
+*****************************************************************************/
+
+/*
+** lt_segment_writeall()
+**
+** Type of function:
+** 	segment sink internal api
+**
+** Purpose:
+** 	Write a buffer out whole, resuming after a short write.
+**
+** Parameters:
+** 	fd		- The file.
+** 	data		- The bytes to write.
+** 	len		- Their length.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the write failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_segment_writeall(int fd, CS_BYTE *data, CS_INT len)
+{
+	ssize_t		n;
+
+	while (len > 0)
+	{
+		n = write(fd, data, len);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			ex_error("lt_segment_writeall: write() failed");
+			return CS_FAIL;
+		}
+		data += n;
+		len -= n;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_segment_start()
+**
+** Type of function:
+** 	segment sink internal api
+**
+** Purpose:
+** 	Create the next segment and write its header.
+**
+** Parameters:
+** 	ss		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if no segment could be created.
+*/
+
+CS_STATIC CS_RETCODE
+lt_segment_start(LT_SEGMENT_SINK *ss)
+{
+	CS_BYTE		header[LT_SEGMENT_HDRLEN];
+	CS_BYTE		*p = header;
+	CS_UINT		u32;
+	CS_BIGINT	now;
+	struct timespec	ts;
+
+	while (++ss->number <= LT_SEGMENT_MAXNUM)
+	{
+		sprintf(ss->path, "%s.%06d.lts", ss->prefix, (int)ss->number);
+		ss->fd = open(ss->path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+		if (ss->fd >= 0 || errno != EEXIST)
+		{
+			break;
+		}
+	}
+	if (ss->fd < 0)
+	{
+		ex_error("lt_segment_start: open() failed");
+		return CS_FAIL;
+	}
+	if (lt_durable_track(ss->fd) != CS_SUCCEED)
+	{
+		close(ss->fd);
+		ss->fd = -1;
+		return CS_FAIL;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	now = (CS_BIGINT)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	u32 = LT_SEGMENT_MAGIC;
+	LT_PUT(p, u32);
+	u32 = LT_SEGMENT_VERSION;
+	LT_PUT(p, u32);
+	LT_PUT(p, now);
+	if (lt_segment_writeall(ss->fd, header, LT_SEGMENT_HDRLEN) != CS_SUCCEED)
+	{
+		lt_durable_untrack(ss->fd);
+		close(ss->fd);
+		ss->fd = -1;
+		return CS_FAIL;
+	}
+
+	ss->opened = lt_clock_usec();
+	ss->offset = LT_SEGMENT_HDRLEN;
+	ss->nblocks = 0;
+	ss->index.len = 0;
+	memset(&ss->range, 0, sizeof (ss->range));
+	return CS_SUCCEED;
+}
+
+/*
+** lt_segment_finish()
+**
+** Type of function:
+** 	segment sink internal api
+**
+** Purpose:
+** 	Write the footer of the open segment and close it.
+**
+** Parameters:
+** 	ss		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a realloc failed, or CS_FAIL if the
+** 	write or close failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_segment_finish(LT_SEGMENT_SINK *ss)
+{
+	CS_RETCODE	retcode;
+	CS_UBIGINT	u64;
+	CS_UINT		u32;
+	CS_BYTE		*p;
+
+	if ((retcode = lt_buf_reserve(&ss->index,
+			LT_SEGMENT_FOOTERLEN)) == CS_SUCCEED)
+	{
+		p = ss->index.data + ss->index.len;
+		LT_PUT(p, ss->range.firstpos);
+		LT_PUT(p, ss->range.lastpos);
+		LT_PUT(p, ss->range.firsttime);
+		LT_PUT(p, ss->range.lasttime);
+		u64 = (CS_UBIGINT)ss->offset;
+		LT_PUT(p, u64);
+		LT_PUT(p, ss->nblocks);
+		u32 = LT_SEGMENT_FOOTER_MAGIC;
+		LT_PUT(p, u32);
+		ss->index.len = p - ss->index.data;
+		retcode = lt_segment_writeall(ss->fd, ss->index.data,
+			ss->index.len);
+	}
+
+	lt_durable_untrack(ss->fd);
+	if (close(ss->fd) != 0 && retcode == CS_SUCCEED)
+	{
+		ex_error("lt_segment_finish: close() failed");
+		retcode = CS_FAIL;
+	}
+	ss->fd = -1;
+	return retcode;
+}
+
+/*****************************************************************************
+**
+** sink functions
+**
+*****************************************************************************/
+
+/*
+** lt_segment_write()
+**
+** Type of function:
+** 	segment sink internal api
+**
+** Purpose:
+** 	Append a batch to the open segment as one block, first rolling over
+** 	to a new segment if the open one is full or old enough. The block
+** 	is stored uncompressed when compressing would not shrink it.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	batch		- The batch to write.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a realloc failed, or CS_FAIL if a write
+** 	failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_segment_write(LT_SINK *sink, LT_BATCH *batch)
+{
+	LT_SEGMENT_SINK	*ss = (LT_SEGMENT_SINK *)sink->ctx;
+	LT_BATCH_XACT	*first = &batch->xacts[0];
+	LT_BATCH_XACT	*last = &batch->xacts[batch->nxacts - 1];
+	CS_RETCODE	retcode;
+	CS_UBIGINT	u64;
+	CS_UINT		u32;
+	CS_UINT		flags;
+	CS_INT		len;
+	CS_BYTE		*p;
+
+	if (ss->fd >= 0 &&
+	    ((ss->maxbytes > 0 && ss->offset >= ss->maxbytes) ||
+	     (ss->maxsecs > 0 &&
+	      lt_clock_usec() - ss->opened >= (CS_BIGINT)ss->maxsecs * 1000000)))
+	{
+		if ((retcode = lt_segment_finish(ss)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+	}
+	if (ss->fd < 0 && (retcode = lt_segment_start(ss)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	ss->raw.len = 0;
+	if ((retcode = lt_sink_encode(&ss->raw, batch)) != CS_SUCCEED ||
+	    (batch->changes.len > 0 &&
+	     (retcode = lt_buf_append(&ss->raw, batch->changes.data,
+			batch->changes.len)) != CS_SUCCEED))
+	{
+		return retcode;
+	}
+
+	ss->block.len = 0;
+	if ((retcode = lt_buf_reserve(&ss->block,
+			LT_SEGMENT_BLOCKLEN + ss->raw.len)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	p = ss->block.data;
+	len = lt_lz_compress(ss->raw.data, ss->raw.len, p + LT_SEGMENT_BLOCKLEN,
+		ss->raw.len - 1);
+	flags = 0;
+	if (len == 0)
+	{
+		memcpy(p + LT_SEGMENT_BLOCKLEN, ss->raw.data, ss->raw.len);
+		len = ss->raw.len;
+		flags = LT_SEGMENT_STORED;
+	}
+
+	/*
+	** The block header is filled in last, over the space left for it.
+	*/
+	u32 = LT_SEGMENT_BLOCK_MAGIC;
+	LT_PUT(p, u32);
+	LT_PUT(p, flags);
+	u32 = (CS_UINT)ss->raw.len;
+	LT_PUT(p, u32);
+	u32 = (CS_UINT)len;
+	LT_PUT(p, u32);
+	LT_PUT(p, first->commitpos);
+	LT_PUT(p, batch->lastpos);
+	ss->block.len = LT_SEGMENT_BLOCKLEN + len;
+
+	if ((retcode = lt_buf_reserve(&ss->index,
+			LT_SEGMENT_INDEXLEN)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	if ((retcode = lt_segment_writeall(ss->fd, ss->block.data,
+			ss->block.len)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	p = ss->index.data + ss->index.len;
+	u64 = (CS_UBIGINT)ss->offset;
+	LT_PUT(p, u64);
+	LT_PUT(p, first->commitpos);
+	LT_PUT(p, batch->lastpos);
+	LT_PUT(p, first->committime);
+	LT_PUT(p, last->committime);
+	ss->index.len = p - ss->index.data;
+
+	if (ss->nblocks++ == 0)
+	{
+		ss->range.firstpos = first->commitpos;
+		ss->range.firsttime = first->committime;
+	}
+	ss->range.lastpos = batch->lastpos;
+	ss->range.lasttime = last->committime;
+	ss->offset += ss->block.len;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_segment_close()
+**
+** Type of function:
+** 	segment sink internal api
+**
+** Purpose:
+** 	Finish the open segment, if any, and free the sink.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure code of finishing the segment.
+*/
+
+CS_STATIC CS_RETCODE
+lt_segment_close(LT_SINK *sink)
+{
+	LT_SEGMENT_SINK	*ss = (LT_SEGMENT_SINK *)sink->ctx;
+	CS_RETCODE	retcode = CS_SUCCEED;
+
+	if (ss->fd >= 0)
+	{
+		retcode = lt_segment_finish(ss);
+	}
+	lt_buf_free(&ss->raw);
+	lt_buf_free(&ss->block);
+	lt_buf_free(&ss->index);
+	free(ss->path);
+	free(ss);
+	return retcode;
+}
+
+/*
+** lt_segment_open()
+**
+** Type of function:
+** 	segment sink api
+**
+** Purpose:
+** 	Open a segment sink writing "<prefix>.<number>.lts" files. A limit
+** 	of 0 or less is not applied.
+**
+** Parameters:
+** 	prefix		- Path prefix of the segment files.
+** 	maxbytes	- Bytes after which a segment is closed.
+** 	maxsecs		- Seconds after which a segment is closed.
+** 	sink		- Set to the new sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a malloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_segment_open(CS_CHAR *prefix, CS_INT maxbytes, CS_INT maxsecs,
+		LT_SINK **sink)
+{
+	LT_SEGMENT_SINK	*ss;
+
+	ss = (LT_SEGMENT_SINK *)calloc(1, sizeof (LT_SEGMENT_SINK));
+	if (ss == NULL ||
+	    (ss->path = (CS_CHAR *)malloc(strlen(prefix) + 16)) == NULL)
+	{
+		ex_error("lt_segment_open: malloc() failed");
+		free(ss);
+		return CS_MEM_ERROR;
+	}
+
+	ss->prefix = prefix;
+	ss->maxbytes = maxbytes;
+	ss->maxsecs = maxsecs;
+	ss->fd = -1;
+	ss->sink.name = "segment";
+	ss->sink.write = lt_segment_write;
+	ss->sink.close = lt_segment_close;
+	ss->sink.ctx = ss;
+	*sink = &ss->sink;
+	return CS_SUCCEED;
+}
+
+/*****************************************************************************
+**
+** reader functions
+**
+*****************************************************************************/
+
+/*
+** lt_segment_unmap()
+**
+** Type of function:
+** 	segment reader api
+**
+** Purpose:
+** 	Unmap a segment. Does nothing if it is not mapped.
+**
+** Parameters:
+** 	rd		- The reader.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_segment_unmap(LT_SEGMENT_READER *rd)
+{
+	if (rd->data != NULL)
+	{
+		munmap(rd->data, rd->len);
+	}
+	memset(rd, 0, sizeof (LT_SEGMENT_READER));
+}
+
+/*
+** lt_segment_map()
+**
+** Type of function:
+** 	segment reader api
+**
+** Purpose:
+** 	Map a segment for reading, positioned at its first block, and read
+** 	its trailer if it has one.
+**
+** Parameters:
+** 	path		- Path of the segment.
+** 	rd		- The reader to set up.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the file could not be mapped or is not
+** 	a segment.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_segment_map(CS_CHAR *path, LT_SEGMENT_READER *rd)
+{
+	struct stat	st;
+	CS_UBIGINT	index;
+	CS_UINT		magic;
+	CS_UINT		version;
+	CS_UINT		nblocks;
+	CS_BYTE		*p;
+	int		fd;
+
+	memset(rd, 0, sizeof (LT_SEGMENT_READER));
+	if ((fd = open(path, O_RDONLY)) < 0)
+	{
+		ex_error("lt_segment_map: open() failed");
+		return CS_FAIL;
+	}
+	if (fstat(fd, &st) != 0)
+	{
+		ex_error("lt_segment_map: fstat() failed");
+		close(fd);
+		return CS_FAIL;
+	}
+	if (st.st_size < LT_SEGMENT_HDRLEN)
+	{
+		ex_error("lt_segment_map: not a segment");
+		close(fd);
+		return CS_FAIL;
+	}
+	rd->data = (CS_BYTE *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+				   fd, 0);
+	close(fd);
+	if (rd->data == (CS_BYTE *)MAP_FAILED)
+	{
+		ex_error("lt_segment_map: mmap() failed");
+		rd->data = NULL;
+		return CS_FAIL;
+	}
+	rd->len = st.st_size;
+	p = rd->data;
+	LT_GET(p, magic);
+	LT_GET(p, version);
+	if (magic != LT_SEGMENT_MAGIC || version != LT_SEGMENT_VERSION)
+	{
+		ex_error("lt_segment_map: not a segment");
+		lt_segment_unmap(rd);
+		return CS_FAIL;
+	}
+	rd->off = LT_SEGMENT_HDRLEN;
+	rd->end = rd->len;
+
+	/*
+	** Without a trailer that agrees with the length of the file, the
+	** segment was left open and is read to its end.
+	*/
+	if (rd->len < LT_SEGMENT_HDRLEN + LT_SEGMENT_FOOTERLEN)
+	{
+		return CS_SUCCEED;
+	}
+	p = rd->data + rd->len - LT_SEGMENT_FOOTERLEN + 32;
+	LT_GET(p, index);
+	LT_GET(p, nblocks);
+	LT_GET(p, magic);
+	if (magic != LT_SEGMENT_FOOTER_MAGIC || index < LT_SEGMENT_HDRLEN ||
+	    index + (CS_UBIGINT)nblocks * LT_SEGMENT_INDEXLEN +
+	    LT_SEGMENT_FOOTERLEN != (CS_UBIGINT)rd->len)
+	{
+		return CS_SUCCEED;
+	}
+	p = rd->data + rd->len - LT_SEGMENT_FOOTERLEN;
+	LT_GET(p, rd->range.firstpos);
+	LT_GET(p, rd->range.lastpos);
+	LT_GET(p, rd->range.firsttime);
+	LT_GET(p, rd->range.lasttime);
+	rd->end = (CS_BIGINT)index;
+	rd->nblocks = nblocks;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_segment_next()
+**
+** Type of function:
+** 	segment reader api
+**
+** Purpose:
+** 	Read the next block of a segment, decompressing it into a buffer.
+** 	The buffer then holds the batch, laid out as by ltsink.c, whose
+** 	positions are checked against the block header.
+**
+** Parameters:
+** 	rd		- The reader.
+** 	raw		- Set to the batch.
+**
+** Returns:
+** 	CS_SUCCEED, CS_END_DATA after the last block, CS_MEM_ERROR if a
+** 	realloc failed, or CS_FAIL if the block is incomplete or malformed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_segment_next(LT_SEGMENT_READER *rd, LT_BUF *raw)
+{
+	CS_RETCODE	retcode;
+	CS_UBIGINT	firstpos;
+	CS_UBIGINT	lastpos;
+	CS_UBIGINT	pos;
+	CS_UINT		magic;
+	CS_UINT		flags;
+	CS_UINT		rawlen;
+	CS_UINT		len;
+	CS_UINT		nxacts;
+	CS_BYTE		*p;
+
+	if (rd->off >= rd->end)
+	{
+		return CS_END_DATA;
+	}
+	if (rd->end - rd->off < LT_SEGMENT_BLOCKLEN)
+	{
+		ex_error("lt_segment_next: incomplete block");
+		return CS_FAIL;
+	}
+	p = rd->data + rd->off;
+	LT_GET(p, magic);
+	LT_GET(p, flags);
+	LT_GET(p, rawlen);
+	LT_GET(p, len);
+	LT_GET(p, firstpos);
+	LT_GET(p, lastpos);
+	if (magic != LT_SEGMENT_BLOCK_MAGIC || rawlen > 0x7fffffff ||
+	    rawlen < LT_SINK_HDRLEN)
+	{
+		ex_error("lt_segment_next: malformed block");
+		return CS_FAIL;
+	}
+	if ((CS_BIGINT)len > rd->end - rd->off - LT_SEGMENT_BLOCKLEN)
+	{
+		ex_error("lt_segment_next: incomplete block");
+		return CS_FAIL;
+	}
+
+	raw->len = 0;
+	if ((retcode = lt_buf_reserve(raw, (CS_INT)rawlen)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	if (flags & LT_SEGMENT_STORED)
+	{
+		if (len != rawlen)
+		{
+			ex_error("lt_segment_next: malformed block");
+			return CS_FAIL;
+		}
+		memcpy(raw->data, p, len);
+	}
+	else if (lt_lz_decompress(p, (CS_INT)len, raw->data,
+			(CS_INT)rawlen) != (CS_INT)rawlen)
+	{
+		ex_error("lt_segment_next: malformed block");
+		return CS_FAIL;
+	}
+	raw->len = (CS_INT)rawlen;
+
+	p = raw->data;
+	LT_GET(p, magic);
+	LT_GET(p, nxacts);
+	p = raw->data + LT_SINK_HDRLEN - sizeof (pos);
+	LT_GET(p, pos);
+	if (magic != LT_SINK_MAGIC || nxacts == 0 || pos != lastpos ||
+	    (CS_UBIGINT)nxacts * LT_SINK_XACTLEN > rawlen - LT_SINK_HDRLEN)
+	{
+		ex_error("lt_segment_next: malformed block");
+		return CS_FAIL;
+	}
+	p = raw->data + LT_SINK_HDRLEN + sizeof (pos);
+	LT_GET(p, pos);
+	if (pos != firstpos)
+	{
+		ex_error("lt_segment_next: malformed block");
+		return CS_FAIL;
+	}
+	rd->off += LT_SEGMENT_BLOCKLEN + len;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_segment_index()
+**
+** Type of function:
+** 	segment reader api
+**
+** Purpose:
+** 	Look up an entry of the index of a closed segment.
+**
+** Parameters:
+** 	rd		- The reader.
+** 	n		- Number of the block, from 0.
+** 	offset		- Set to the offset of the block.
+** 	range		- Set to the range of the block.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the segment has no such block in its
+** 	index.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_segment_index(LT_SEGMENT_READER *rd, CS_UINT n, CS_BIGINT *offset,
+		 LT_SEGMENT_RANGE *range)
+{
+	CS_UBIGINT	u64;
+	CS_BYTE		*p;
+
+	if (n >= rd->nblocks)
+	{
+		return CS_FAIL;
+	}
+	p = rd->data + rd->end + (CS_BIGINT)n * LT_SEGMENT_INDEXLEN;
+	LT_GET(p, u64);
+	LT_GET(p, range->firstpos);
+	LT_GET(p, range->lastpos);
+	LT_GET(p, range->firsttime);
+	LT_GET(p, range->lasttime);
+	*offset = (CS_BIGINT)u64;
+	return CS_SUCCEED;
+}
@@ -0,0 +1,92 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	rotating compressed segment sink in ltsegment.c, and its reader.
+**
+*/
+
+#ifndef __LTSEGMENT_H__
+#define __LTSEGMENT_H__
+
+#include "ltbatch.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+#define LT_SEGMENT_MAGIC	0x3153544c	/* "LTS1" */
+#define LT_SEGMENT_BLOCK_MAGIC	0x3142534c	/* "LSB1" */
+#define LT_SEGMENT_FOOTER_MAGIC	0x3146534c	/* "LSF1" */
+#define LT_SEGMENT_VERSION	1
+
+#define LT_SEGMENT_HDRLEN	16
+#define LT_SEGMENT_BLOCKLEN	32
+#define LT_SEGMENT_INDEXLEN	40
+#define LT_SEGMENT_FOOTERLEN	48
+
+/*
+** Block flags: the block data is stored uncompressed.
+*/
+#define LT_SEGMENT_STORED	0x1
+
+/*
+** Range of commit positions and times covered by a block or a segment.
+*/
+typedef struct _lt_segment_range
+{
+	CS_UBIGINT	firstpos;
+	CS_UBIGINT	lastpos;
+	CS_BIGINT	firsttime;
+	CS_BIGINT	lasttime;
+} LT_SEGMENT_RANGE;
+
+/*
+** A segment mapped for reading. 'off' is the offset of the next block
+** and 'end' that of the index, or the length of a segment left without
+** a footer. 'nblocks' and 'range' are from the trailer, and 0 without
+** one.
+*/
+typedef struct _lt_segment_reader
+{
+	CS_BYTE			*data;
+	CS_BIGINT		len;
+	CS_BIGINT		off;
+	CS_BIGINT		end;
+	CS_UINT			nblocks;
+	LT_SEGMENT_RANGE	range;
+} LT_SEGMENT_READER;
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltsegment.c */
+extern CS_RETCODE CS_PUBLIC lt_segment_open(
+	CS_CHAR *prefix,
+	CS_INT maxbytes,
+	CS_INT maxsecs,
+	LT_SINK **sink
+	);
+extern CS_RETCODE CS_PUBLIC lt_segment_map(
+	CS_CHAR *path,
+	LT_SEGMENT_READER *rd
+	);
+extern CS_VOID CS_PUBLIC lt_segment_unmap(
+	LT_SEGMENT_READER *rd
+	);
+extern CS_RETCODE CS_PUBLIC lt_segment_next(
+	LT_SEGMENT_READER *rd,
+	LT_BUF *raw
+	);
+extern CS_RETCODE CS_PUBLIC lt_segment_index(
+	LT_SEGMENT_READER *rd,
+	CS_UINT n,
+	CS_BIGINT *offset,
+	LT_SEGMENT_RANGE *range
+	);
+
+#endif /* __LTSEGMENT_H__ */
@@ -0,0 +1,1103 @@
+/*
+** Description
+** -----------
+** 	This file implements the change stream server, a sink serving the
+** 	batches of committed transactions to consumers connecting over a
+** 	Unix domain socket, or a TCP socket given as "tcp:[host:]port" and
+** 	bound to the loopback address unless a host is given. The framing
+** 	and the frame types are described in ltserver.h.
+**
+** 	A consumer is sent the whole name dictionary when it starts, and
+** 	the entries added since ahead of the batches that first use them.
+**
+** 	Every batch is kept in a replay buffer until all the started
+** 	consumers have been sent it and have acknowledged its last commit
+** 	position. When the buffer is over its size and the oldest batch is
+** 	still unacknowledged, writing waits for the consumers, holding back
+** 	the scan. With no consumer started, the oldest batches are simply
+** 	dropped once the buffer is full. A consumer starting from a position
+** 	that has been dropped is refused.
+**
+** 	The server is serviced from the scanning thread: as batches are
+** 	written, when the batcher is polled, and while waiting for acks.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltxact.h"
+#include "ltbatch.h"
+#include "ltsink.h"
+#include "ltdict.h"
+#include "ltserver.h"
+
+#define LT_SERVER_HOST		"127.0.0.1"
+#define LT_SERVER_BACKLOG	16
+#define LT_SERVER_IOV		64
+
+/*
+** Milliseconds to wait at a time for acks when the replay buffer is full,
+** and at most, in total, for the remaining batches to be acknowledged on
+** close.
+*/
+#define LT_SERVER_WAIT		100
+#define LT_SERVER_DRAIN		1000
+
+/*
+** State of a server sink. The replay buffer is a circular array of
+** 'nentries' entries starting at index 'first', whose ids count up from
+** 'firstid'; 'evicted' is the last position of the last entry dropped.
+** The dictionary entries before 'dictsent' are in the replay buffer.
+*/
+typedef struct _lt_server_sink
+{
+	LT_SINK			sink;
+	int			listenfd;
+	CS_CHAR			*unixpath;
+	CS_INT			maxbytes;
+	LT_SERVER_ENTRY		*entries;
+	CS_INT			maxentries;
+	CS_INT			first;
+	CS_INT			nentries;
+	CS_UBIGINT		firstid;
+	CS_BIGINT		bytes;
+	CS_UBIGINT		evicted;
+	LT_SERVER_CLIENT	*clients;
+	CS_INT			nclients;
+	struct pollfd		*pfds;
+	CS_INT			maxpfds;
+	LT_BUF			frame;
+	CS_UINT			dictsent;
+} LT_SERVER_SINK;
+
+#define LT_SERVER_ENTRY_AT(_ss, _id)	(&(_ss)->entries[((_ss)->first + \
+	(CS_INT)((_id) - (_ss)->firstid)) % (_ss)->maxentries])
+
+#define LT_SERVER_PENDING(_ss, _c)	((_c)->started && \
+	((_c)->dictsent < (_c)->dict.len || \
+	 (_c)->next < (_ss)->firstid + (_ss)->nentries))
+
+/*****************************************************************************
+**
+** connection functions
+**
+*****************************************************************************/
+
+/*
+** lt_server_drop()
+**
+** Type of function:
+** 	change stream server internal api
+**
+** Purpose:
+** 	Close a consumer's connection and forget it.
+**
+** Parameters:
+** 	ss		- The sink.
+** 	client		- The consumer.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_server_drop(LT_SERVER_SINK *ss, LT_SERVER_CLIENT *client)
+{
+	LT_SERVER_CLIENT	**pp;
+
+	for (pp = &ss->clients; *pp != NULL; pp = &(*pp)->nextclient)
+	{
+		if (*pp == client)
+		{
+			*pp = client->nextclient;
+			break;
+		}
+	}
+	close(client->fd);
+	lt_buf_free(&client->dict);
+	free(client);
+	ss->nclients--;
+}
+
+/*
+** lt_server_refuse()
+**
+** Type of function:
+** 	change stream server internal api
+**
+** Purpose:
+** 	Send a consumer an error frame, if the socket takes it, and drop it.
+**
+** Parameters:
+** 	ss		- The sink.
+** 	client		- The consumer.
+** 	msg		- The error message.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_server_refuse(LT_SERVER_SINK *ss, LT_SERVER_CLIENT *client, CS_CHAR *msg)
+{
+	CS_BYTE		frame[LT_SERVER_FRAMELEN + EX_MAXSTRINGLEN];
+	CS_UINT		u32;
+	CS_INT		len;
+
+	len = strlen(msg);
+	if (len > EX_MAXSTRINGLEN)
+	{
+		len = EX_MAXSTRINGLEN;
+	}
+	u32 = (CS_UINT)len;
+	memcpy(frame, &u32, sizeof (u32));
+	u32 = LT_SERVER_ERROR;
+	memcpy(frame + 4, &u32, sizeof (u32));
+	memcpy(frame + LT_SERVER_FRAMELEN, msg, len);
+	(void)send(client->fd, frame, LT_SERVER_FRAMELEN + len,
+		MSG_NOSIGNAL | MSG_DONTWAIT);
+	lt_server_drop(ss, client);
+}
+
+/*
+** lt_server_dict_frame()
+**
+** Type of function:
+** 	change stream server internal api
+**
+** Purpose:
+** 	Append a dictionary frame of the entries from id 'from' on to a
+** 	buffer. Nothing is appended if there are none.
+**
+** Parameters:
+** 	buf		- Pointer to the buffer.
+** 	from		- The first id, 0 for the whole dictionary.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_server_dict_frame(LT_BUF *buf, CS_UINT from)
+{
+	CS_RETCODE	retcode;
+	CS_INT		start = buf->len;
+	CS_UINT		u32;
+
+	if ((retcode = lt_buf_reserve(buf, LT_SERVER_FRAMELEN)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	buf->len += LT_SERVER_FRAMELEN;
+	if ((retcode = lt_dict_encode(buf, from)) != CS_SUCCEED)
+	{
+		buf->len = start;
+		return retcode;
+	}
+	if (buf->len == start + LT_SERVER_FRAMELEN)
+	{
+		buf->len = start;
+		return CS_SUCCEED;
+	}
+	u32 = (CS_UINT)(buf->len - start - LT_SERVER_FRAMELEN);
+	memcpy(buf->data + start, &u32, sizeof (u32));
+	u32 = LT_SERVER_DICT;
+	memcpy(buf->data + start + 4, &u32, sizeof (u32));
+	return CS_SUCCEED;
+}
+
+/*
+** lt_server_start()
+**
+** Type of function:
+** 	change stream server internal api
+**
+** Purpose:
+** 	Start streaming to a consumer from the first batch after 'pos'.
+**
+** Parameters:
+** 	ss		- The sink.
+** 	client		- The consumer.
+** 	pos		- The commit position to stream from, exclusive, or 0.
+**
+** Returns:
+** 	CS_TRUE, or CS_FALSE if the consumer was refused and dropped.
+*/
+
+CS_STATIC CS_BOOL
+lt_server_start(LT_SERVER_SINK *ss, LT_SERVER_CLIENT *client, CS_UBIGINT pos)
+{
+	CS_CHAR		msg[EX_MAXSTRINGLEN];
+
+	if (client->started)
+	{
+		lt_server_refuse(ss, client, "already started");
+		return CS_FALSE;
+	}
+	if (pos != 0 && pos < ss->evicted)
+	{
+		sprintf(msg, "position %llu is no longer buffered, batches up to %llu were dropped",
+			(unsigned long long)pos, (unsigned long long)ss->evicted);
+		lt_server_refuse(ss, client, msg);
+		return CS_FALSE;
+	}
+
+	client->dict.len = 0;
+	client->dictsent = 0;
+	if (lt_server_dict_frame(&client->dict, 0) != CS_SUCCEED)
+	{
+		lt_server_refuse(ss, client, "out of memory");
+		return CS_FALSE;
+	}
+
+	client->started = CS_TRUE;
+	client->acked = pos;
+	client->sent = 0;
+	for (client->next = ss->firstid;
+	     client->next < ss->firstid + ss->nentries &&
+	     LT_SERVER_ENTRY_AT(ss, client->next)->lastpos <= pos;
+	     client->next++)
+	{
+		;
+	}
+	return CS_TRUE;
+}
+
+/*
+** lt_server_recv()
+**
+** Type of function:
+** 	change stream server internal api
+**
+** Purpose:
+** 	Read and act on the frames a consumer has sent.
+**
+** Parameters:
+** 	ss		- The sink.
+** 	client		- The consumer.
+**
+** Returns:
+** 	CS_TRUE, or CS_FALSE if the consumer was dropped.
+*/
+
+CS_STATIC CS_BOOL
+lt_server_recv(LT_SERVER_SINK *ss, LT_SERVER_CLIENT *client)
+{
+	CS_UBIGINT	pos;
+	CS_UINT		len;
+	CS_UINT		type;
+	ssize_t		n;
+
+	for (;;)
+	{
+		n = recv(client->fd, client->in + client->inlen,
+			sizeof (client->in) - client->inlen, 0);
+		if (n == 0)
+		{
+			lt_server_drop(ss, client);
+			return CS_FALSE;
+		}
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				return CS_TRUE;
+			}
+			lt_server_drop(ss, client);
+			return CS_FALSE;
+		}
+		client->inlen += n;
+
+		while (client->inlen >= LT_SERVER_FRAMELEN)
+		{
+			memcpy(&len, client->in, sizeof (len));
+			memcpy(&type, client->in + 4, sizeof (type));
+			if (len != sizeof (pos) ||
+			    (type != LT_SERVER_START && type != LT_SERVER_ACK))
+			{
+				lt_server_refuse(ss, client, "malformed frame");
+				return CS_FALSE;
+			}
+			if (client->inlen < LT_SERVER_FRAMELEN + (CS_INT)sizeof (pos))
+			{
+				break;
+			}
+			memcpy(&pos, client->in + LT_SERVER_FRAMELEN, sizeof (pos));
+			client->inlen -= LT_SERVER_FRAMELEN + sizeof (pos);
+			memmove(client->in, client->in + LT_SERVER_FRAMELEN +
+				sizeof (pos), client->inlen);
+
+			if (type == LT_SERVER_START)
+			{
+				if (!lt_server_start(ss, client, pos))
+				{
+					return CS_FALSE;
+				}
+			}
+			else if (pos > client->acked)
+			{
+				client->acked = pos;
+			}
+		}
+	}
+}
+
+/*
+** lt_server_send()
+**
+** Type of function:
+** 	change stream server internal api
+**
+** Purpose:
+** 	Send a consumer the dictionary it started with, then as many of
+** 	its pending batches as its socket takes, several at a time.
+**
+** Parameters:
+** 	ss		- The sink.
+** 	client		- The consumer.
+**
+** Returns:
+** 	CS_TRUE, or CS_FALSE if the consumer was dropped.
+*/
+
+CS_STATIC CS_BOOL
+lt_server_send(LT_SERVER_SINK *ss, LT_SERVER_CLIENT *client)
+{
+	LT_SERVER_ENTRY	*e;
+	struct iovec	iov[LT_SERVER_IOV];
+	struct msghdr	msg;
+	CS_UBIGINT	id;
+	CS_UINT		type;
+	CS_INT		rem;
+	ssize_t		n;
+
+	while (client->started && client->dictsent < client->dict.len)
+	{
+		n = send(client->fd, client->dict.data + client->dictsent,
+			client->dict.len - client->dictsent,
+			MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				return CS_TRUE;
+			}
+			lt_server_drop(ss, client);
+			return CS_FALSE;
+		}
+		if ((client->dictsent += n) == client->dict.len)
+		{
+			lt_buf_free(&client->dict);
+			client->dictsent = 0;
+		}
+	}
+
+	while (LT_SERVER_PENDING(ss, client))
+	{
+		/*
+		** Batches the consumer already has, from the position it
+		** started from or acknowledged, are skipped. Dictionary
+		** entries are not, as later batches may use them.
+		*/
+		e = LT_SERVER_ENTRY_AT(ss, client->next);
+		memcpy(&type, e->frame + 4, sizeof (type));
+		if (client->sent == 0 && e->lastpos <= client->acked &&
+		    type != LT_SERVER_DICT)
+		{
+			client->next++;
+			continue;
+		}
+
+		memset(&msg, 0, sizeof (msg));
+		msg.msg_iov = iov;
+		for (id = client->next; id < ss->firstid + ss->nentries &&
+		     msg.msg_iovlen < LT_SERVER_IOV; id++)
+		{
+			e = LT_SERVER_ENTRY_AT(ss, id);
+			if (id > client->next && e->lastpos <= client->acked)
+			{
+				break;
+			}
+			iov[msg.msg_iovlen].iov_base = e->frame;
+			iov[msg.msg_iovlen].iov_len = e->len;
+			msg.msg_iovlen++;
+		}
+		iov[0].iov_base = (CS_BYTE *)iov[0].iov_base + client->sent;
+		iov[0].iov_len -= client->sent;
+
+		n = sendmsg(client->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				return CS_TRUE;
+			}
+			lt_server_drop(ss, client);
+			return CS_FALSE;
+		}
+
+		while (n > 0)
+		{
+			rem = LT_SERVER_ENTRY_AT(ss, client->next)->len - client->sent;
+			if (n >= rem)
+			{
+				n -= rem;
+				client->next++;
+				client->sent = 0;
+			}
+			else
+			{
+				client->sent += n;
+				n = 0;
+			}
+		}
+	}
+	return CS_TRUE;
+}
+
+/*
+** lt_server_accept()
+**
+** Type of function:
+** 	change stream server internal api
+**
+** Purpose:
+** 	Accept the pending connections.
+**
+** Parameters:
+** 	ss		- The sink.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_server_accept(LT_SERVER_SINK *ss)
+{
+	LT_SERVER_CLIENT	*client;
+	int			fd;
+	int			on = 1;
+
+	while ((fd = accept(ss->listenfd, NULL, NULL)) >= 0)
+	{
+		client = (LT_SERVER_CLIENT *)calloc(1, sizeof (LT_SERVER_CLIENT));
+		if (client == NULL)
+		{
+			ex_error("lt_server_accept: calloc() failed");
+			close(fd);
+			continue;
+		}
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		if (ss->unixpath == NULL)
+		{
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof (on));
+		}
+		client->fd = fd;
+		client->nextclient = ss->clients;
+		ss->clients = client;
+		ss->nclients++;
+	}
+}
+
+/*
+** lt_server_service()
+**
+** Type of function:
+** 	change stream server internal api
+**
+** Purpose:
+** 	Wait up to 'timeout' milliseconds for socket activity, then accept
+** 	connections, read acks and send pending batches.
+**
+** Parameters:
+** 	ss		- The sink.
+** 	timeout		- Milliseconds to wait, or 0 not to.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a realloc failed, or CS_FAIL if poll()
+** 	failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_server_service(LT_SERVER_SINK *ss, CS_INT timeout)
+{
+	LT_SERVER_CLIENT	*client;
+	LT_SERVER_CLIENT	*nextclient;
+	struct pollfd		*pfds;
+	CS_INT			n;
+	CS_INT			i;
+
+	n = ss->nclients + 1;
+	if (n > ss->maxpfds)
+	{
+		pfds = (struct pollfd *)realloc(ss->pfds, n * 2 * sizeof (*pfds));
+		if (pfds == NULL)
+		{
+			ex_error("lt_server_service: realloc() failed");
+			return CS_MEM_ERROR;
+		}
+		ss->pfds = pfds;
+		ss->maxpfds = n * 2;
+	}
+
+	ss->pfds[0].fd = ss->listenfd;
+	ss->pfds[0].events = POLLIN;
+	for (i = 1, client = ss->clients; client != NULL;
+	     i++, client = client->nextclient)
+	{
+		ss->pfds[i].fd = client->fd;
+		ss->pfds[i].events = POLLIN;
+		if (LT_SERVER_PENDING(ss, client))
+		{
+			ss->pfds[i].events |= POLLOUT;
+		}
+	}
+	if (poll(ss->pfds, n, timeout) < 0 && errno != EINTR)
+	{
+		ex_error("lt_server_service: poll() failed");
+		return CS_FAIL;
+	}
+
+	for (i = 1, client = ss->clients; client != NULL; i++, client = nextclient)
+	{
+		nextclient = client->nextclient;
+		if ((ss->pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) &&
+		    !lt_server_recv(ss, client))
+		{
+			continue;
+		}
+		(void)lt_server_send(ss, client);
+	}
+	if (ss->pfds[0].revents & POLLIN)
+	{
+		lt_server_accept(ss);
+	}
+	return CS_SUCCEED;
+}
+
+/*****************************************************************************
+**
+** replay buffer functions
+**
+*****************************************************************************/
+
+/*
+** lt_server_evict()
+**
+** Type of function:
+** 	change stream server internal api
+**
+** Purpose:
+** 	Drop the oldest batches that every started consumer has been sent
+** 	and has acknowledged, or, with no consumer started, those over the
+** 	size of the replay buffer. While the buffer is over its size and
+** 	the oldest batch is unacknowledged, wait for the consumers.
+**
+** Parameters:
+** 	ss		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure code of servicing the sockets.
+*/
+
+CS_STATIC CS_RETCODE
+lt_server_evict(LT_SERVER_SINK *ss)
+{
+	LT_SERVER_ENTRY		*e;
+	LT_SERVER_CLIENT	*client;
+	CS_RETCODE		retcode;
+	CS_BOOL			started;
+	CS_BOOL			acked;
+
+	while (ss->nentries > 0)
+	{
+		e = &ss->entries[ss->first];
+		started = CS_FALSE;
+		acked = CS_TRUE;
+		for (client = ss->clients; client != NULL; client = client->nextclient)
+		{
+			if (client->started)
+			{
+				started = CS_TRUE;
+				if (client->acked < e->lastpos ||
+				    client->next <= ss->firstid)
+				{
+					acked = CS_FALSE;
+				}
+			}
+		}
+
+		if (started ? acked : (ss->bytes > ss->maxbytes))
+		{
+			free(e->frame);
+			ss->bytes -= e->len;
+			ss->evicted = e->lastpos;
+			ss->first = (ss->first + 1) % ss->maxentries;
+			ss->firstid++;
+			ss->nentries--;
+			continue;
+		}
+		if (ss->bytes <= ss->maxbytes || ss->nentries == 1)
+		{
+			break;
+		}
+		if ((retcode = lt_server_service(ss, LT_SERVER_WAIT)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+	}
+	return CS_SUCCEED;
+}
+
+/*****************************************************************************
+**
+** sink functions
+**
+*****************************************************************************/
+
+/*
+** lt_server_append()
+**
+** Type of function:
+** 	change stream server internal api
+**
+** Purpose:
+** 	Add the frame in the sink's frame buffer to the replay buffer, which
+** 	takes over its memory.
+**
+** Parameters:
+** 	ss		- The sink.
+** 	lastpos		- The commit position of the frame's last transaction.
+** 	oldest		- The BEGINXACT key of its oldest transaction.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a malloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_server_append(LT_SERVER_SINK *ss, CS_UBIGINT lastpos, CS_UBIGINT oldest)
+{
+	LT_SERVER_ENTRY	*entries;
+	LT_SERVER_ENTRY	*e;
+	CS_INT		max;
+	CS_INT		i;
+
+	if (ss->nentries == ss->maxentries)
+	{
+		max = (ss->maxentries == 0) ? 64 : ss->maxentries * 2;
+		entries = (LT_SERVER_ENTRY *)malloc(max * sizeof (LT_SERVER_ENTRY));
+		if (entries == NULL)
+		{
+			ex_error("lt_server_append: malloc() failed");
+			return CS_MEM_ERROR;
+		}
+		for (i = 0; i < ss->nentries; i++)
+		{
+			entries[i] = ss->entries[(ss->first + i) % ss->maxentries];
+		}
+		free(ss->entries);
+		ss->entries = entries;
+		ss->maxentries = max;
+		ss->first = 0;
+	}
+
+	e = &ss->entries[(ss->first + ss->nentries) % ss->maxentries];
+	e->frame = ss->frame.data;
+	e->len = ss->frame.len;
+	e->lastpos = lastpos;
+	e->oldest = oldest;
+	memset(&ss->frame, 0, sizeof (ss->frame));
+	ss->nentries++;
+	ss->bytes += e->len;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_server_write()
+**
+** Type of function:
+** 	change stream server internal api
+**
+** Purpose:
+** 	Add a batch to the replay buffer as a frame, preceded by the
+** 	dictionary entries added since the last one, send it to the started
+** 	consumers and drop what has been acknowledged.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	batch		- The batch to write.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a malloc failed, or the failure code
+** 	of servicing the sockets.
+*/
+
+CS_STATIC CS_RETCODE
+lt_server_write(LT_SINK *sink, LT_BATCH *batch)
+{
+	LT_SERVER_SINK	*ss = (LT_SERVER_SINK *)sink->ctx;
+	CS_RETCODE	retcode;
+	CS_UBIGINT	base = batch->lastpos + 1;
+	CS_UBIGINT	oldest;
+	CS_UINT		u32;
+	CS_INT		i;
+
+	/*
+	** Every transaction of the batch began before its last commit.
+	*/
+	oldest = batch->xacts[0].xactid;
+	for (i = 1; i < batch->nxacts; i++)
+	{
+		if (LT_LOGPOS_SCAN(batch->xacts[i].xactid, base) <
+		    LT_LOGPOS_SCAN(oldest, base))
+		{
+			oldest = batch->xacts[i].xactid;
+		}
+	}
+
+	ss->frame.len = 0;
+	if ((retcode = lt_server_dict_frame(&ss->frame,
+			ss->dictsent)) != CS_SUCCEED ||
+	    (ss->frame.len > 0 &&
+	     (retcode = lt_server_append(ss, batch->lastpos,
+			oldest)) != CS_SUCCEED))
+	{
+		return retcode;
+	}
+	ss->dictsent = lt_dict_count();
+
+	ss->frame.len = 0;
+	if ((retcode = lt_buf_reserve(&ss->frame, LT_SERVER_FRAMELEN)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	ss->frame.len = LT_SERVER_FRAMELEN;
+	if ((retcode = lt_sink_encode(&ss->frame, batch)) != CS_SUCCEED ||
+	    (batch->changes.len > 0 &&
+	     (retcode = lt_buf_append(&ss->frame, batch->changes.data,
+			batch->changes.len)) != CS_SUCCEED))
+	{
+		return retcode;
+	}
+	u32 = (CS_UINT)(ss->frame.len - LT_SERVER_FRAMELEN);
+	memcpy(ss->frame.data, &u32, sizeof (u32));
+	u32 = LT_SERVER_BATCH;
+	memcpy(ss->frame.data + 4, &u32, sizeof (u32));
+	if ((retcode = lt_server_append(ss, batch->lastpos, oldest)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	if ((retcode = lt_server_service(ss, 0)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	return lt_server_evict(ss);
+}
+
+/*
+** lt_server_poll()
+**
+** Type of function:
+** 	change stream server internal api
+**
+** Purpose:
+** 	Service the sockets between batches.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure code of servicing the sockets.
+*/
+
+CS_STATIC CS_RETCODE
+lt_server_poll(LT_SINK *sink)
+{
+	LT_SERVER_SINK	*ss = (LT_SERVER_SINK *)sink->ctx;
+	CS_RETCODE	retcode;
+
+	if ((retcode = lt_server_service(ss, 0)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	return lt_server_evict(ss);
+}
+
+/*
+** lt_server_lowwater()
+**
+** Type of function:
+** 	change stream server internal api
+**
+** Purpose:
+** 	Find the oldest transaction still in the replay buffer.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	base		- Key the scan order is taken from.
+** 	key		- Set to its BEGINXACT key, if there is one.
+**
+** Returns:
+** 	CS_TRUE if the replay buffer holds a transaction, CS_FALSE otherwise.
+*/
+
+CS_STATIC CS_BOOL
+lt_server_lowwater(LT_SINK *sink, CS_UBIGINT base, CS_UBIGINT *key)
+{
+	LT_SERVER_SINK	*ss = (LT_SERVER_SINK *)sink->ctx;
+	LT_SERVER_ENTRY	*e;
+	CS_INT		i;
+
+	if (ss->nentries == 0)
+	{
+		return CS_FALSE;
+	}
+	*key = ss->entries[ss->first].oldest;
+	for (i = 1; i < ss->nentries; i++)
+	{
+		e = &ss->entries[(ss->first + i) % ss->maxentries];
+		if (LT_LOGPOS_SCAN(e->oldest, base) <
+		    LT_LOGPOS_SCAN(*key, base))
+		{
+			*key = e->oldest;
+		}
+	}
+	return CS_TRUE;
+}
+
+/*
+** lt_server_close()
+**
+** Type of function:
+** 	change stream server internal api
+**
+** Purpose:
+** 	Give the started consumers a moment to acknowledge the remaining
+** 	batches, then close every connection and free the sink.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED.
+*/
+
+CS_STATIC CS_RETCODE
+lt_server_close(LT_SINK *sink)
+{
+	LT_SERVER_SINK		*ss = (LT_SERVER_SINK *)sink->ctx;
+	LT_SERVER_CLIENT	*client;
+	CS_BIGINT		deadline;
+	CS_BOOL			pending;
+	CS_INT			i;
+
+	deadline = lt_clock_usec() + (CS_BIGINT)LT_SERVER_DRAIN * 1000;
+	do
+	{
+		pending = CS_FALSE;
+		for (client = ss->clients; client != NULL; client = client->nextclient)
+		{
+			if (client->started && ss->nentries > 0 &&
+			    client->acked < LT_SERVER_ENTRY_AT(ss,
+				ss->firstid + ss->nentries - 1)->lastpos)
+			{
+				pending = CS_TRUE;
+			}
+		}
+	} while (pending && lt_clock_usec() < deadline &&
+		 lt_server_service(ss, LT_SERVER_WAIT) == CS_SUCCEED);
+
+	while (ss->clients != NULL)
+	{
+		lt_server_drop(ss, ss->clients);
+	}
+	close(ss->listenfd);
+	if (ss->unixpath != NULL)
+	{
+		unlink(ss->unixpath);
+	}
+	for (i = 0; i < ss->nentries; i++)
+	{
+		free(ss->entries[(ss->first + i) % ss->maxentries].frame);
+	}
+	free(ss->entries);
+	free(ss->pfds);
+	lt_buf_free(&ss->frame);
+	free(ss);
+	return CS_SUCCEED;
+}
+
+/*
+** lt_server_listen()
+**
+** Type of function:
+** 	change stream server internal api
+**
+** Purpose:
+** 	Create the non-blocking listening socket for an address.
+**
+** Parameters:
+** 	ss		- The sink.
+** 	address		- "tcp:[host:]port", or the path of a Unix socket.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the socket could not be set up.
+*/
+
+CS_STATIC CS_RETCODE
+lt_server_listen(LT_SERVER_SINK *ss, CS_CHAR *address)
+{
+	struct sockaddr_in	sin;
+	struct sockaddr_un	sun;
+	struct stat		st;
+	CS_CHAR			host[64];
+	CS_CHAR			*colon;
+	int			on = 1;
+
+	if (strncmp(address, "tcp:", 4) == 0)
+	{
+		address += 4;
+		strcpy(host, LT_SERVER_HOST);
+		if ((colon = strrchr(address, ':')) != NULL)
+		{
+			if (colon - address >= (int)sizeof (host))
+			{
+				ex_error("lt_server_listen: bad address");
+				return CS_FAIL;
+			}
+			memcpy(host, address, colon - address);
+			host[colon - address] = '\0';
+			address = colon + 1;
+		}
+		memset(&sin, 0, sizeof (sin));
+		sin.sin_family = AF_INET;
+		sin.sin_port = htons((unsigned short)atoi(address));
+		if (inet_pton(AF_INET, host, &sin.sin_addr) != 1)
+		{
+			ex_error("lt_server_listen: bad address");
+			return CS_FAIL;
+		}
+		ss->listenfd = socket(AF_INET, SOCK_STREAM, 0);
+		if (ss->listenfd < 0 ||
+		    setsockopt(ss->listenfd, SOL_SOCKET, SO_REUSEADDR, &on,
+				sizeof (on)) != 0 ||
+		    bind(ss->listenfd, (struct sockaddr *)&sin, sizeof (sin)) != 0)
+		{
+			ex_error("lt_server_listen: bind() failed");
+			return CS_FAIL;
+		}
+	}
+	else
+	{
+		if (strlen(address) >= sizeof (sun.sun_path))
+		{
+			ex_error("lt_server_listen: socket path too long");
+			return CS_FAIL;
+		}
+		memset(&sun, 0, sizeof (sun));
+		sun.sun_family = AF_UNIX;
+		strcpy(sun.sun_path, address);
+		if (stat(address, &st) == 0 && S_ISSOCK(st.st_mode))
+		{
+			unlink(address);
+		}
+		ss->listenfd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (ss->listenfd < 0 ||
+		    bind(ss->listenfd, (struct sockaddr *)&sun, sizeof (sun)) != 0)
+		{
+			ex_error("lt_server_listen: bind() failed");
+			return CS_FAIL;
+		}
+		ss->unixpath = address;
+	}
+
+	if (listen(ss->listenfd, LT_SERVER_BACKLOG) != 0)
+	{
+		ex_error("lt_server_listen: listen() failed");
+		return CS_FAIL;
+	}
+	fcntl(ss->listenfd, F_SETFL, fcntl(ss->listenfd, F_GETFL) | O_NONBLOCK);
+	return CS_SUCCEED;
+}
+
+/*
+** lt_server_open()
+**
+** Type of function:
+** 	change stream server api
+**
+** Purpose:
+** 	Open a change stream server listening on 'address'.
+**
+** Parameters:
+** 	address		- "tcp:[host:]port", or the path of a Unix socket.
+** 	maxbytes	- Size of the replay buffer in bytes.
+** 	sink		- Set to the new sink.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a malloc failed, or CS_FAIL if the
+** 	socket could not be set up.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_server_open(CS_CHAR *address, CS_INT maxbytes, LT_SINK **sink)
+{
+	LT_SERVER_SINK	*ss;
+
+	ss = (LT_SERVER_SINK *)calloc(1, sizeof (LT_SERVER_SINK));
+	if (ss == NULL)
+	{
+		ex_error("lt_server_open: calloc() failed");
+		return CS_MEM_ERROR;
+	}
+	ss->listenfd = -1;
+	if (lt_server_listen(ss, address) != CS_SUCCEED)
+	{
+		if (ss->listenfd >= 0)
+		{
+			close(ss->listenfd);
+		}
+		free(ss);
+		return CS_FAIL;
+	}
+
+	ss->maxbytes = maxbytes;
+	ss->sink.name = "server";
+	ss->sink.write = lt_server_write;
+	ss->sink.close = lt_server_close;
+	ss->sink.poll = lt_server_poll;
+	ss->sink.lowwater = lt_server_lowwater;
+	ss->sink.inmemory = CS_TRUE;
+	ss->sink.ctx = ss;
+	*sink = &ss->sink;
+	return CS_SUCCEED;
+}
@@ -0,0 +1,94 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	change stream server sink in ltserver.c.
+**
+*/
+
+#ifndef __LTSERVER_H__
+#define __LTSERVER_H__
+
+#include "ltbatch.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** Frame types. Every frame is a CS_UINT payload length and a CS_UINT
+** type, followed by the payload.
+**
+** 	LT_SERVER_BATCH		server to consumer: a batch, laid out as by
+** 				ltsink.c.
+** 	LT_SERVER_START		consumer to server: a CS_UBIGINT commit
+** 				position to stream from, exclusive, or 0 for
+** 				the oldest batch buffered.
+** 	LT_SERVER_ACK		consumer to server: a CS_UBIGINT commit
+** 				position up to which the consumer is done.
+** 	LT_SERVER_ERROR		server to consumer: a message; the server
+** 				closes the connection after it.
+** 	LT_SERVER_DICT		server to consumer: a block of name
+** 				dictionary entries, laid out as by ltdict.c.
+** 				The whole dictionary is sent first after
+** 				LT_SERVER_START, and the entries a batch
+** 				adds ahead of it.
+*/
+#define LT_SERVER_BATCH		1
+#define LT_SERVER_START		2
+#define LT_SERVER_ACK		3
+#define LT_SERVER_ERROR		4
+#define LT_SERVER_DICT		5
+
+#define LT_SERVER_FRAMELEN	8
+
+/*
+** One batch in the replay buffer: its frame, the commit position of its
+** last transaction, and the BEGINXACT key of its oldest transaction. The
+** dictionary entries added by a batch have an entry of their own ahead
+** of it, with the same positions.
+*/
+typedef struct _lt_server_entry
+{
+	CS_BYTE		*frame;
+	CS_INT		len;
+	CS_UBIGINT	lastpos;
+	CS_UBIGINT	oldest;
+} LT_SERVER_ENTRY;
+
+/*
+** A connected consumer. Until it sends LT_SERVER_START nothing is sent to
+** it. 'next' is the id of the next entry to send, 'sent' the number of
+** its bytes already sent, and 'acked' the position last acknowledged.
+** 'dict' is the frame of the whole dictionary, sent before any entry,
+** of which 'dictsent' bytes have been sent.
+*/
+typedef struct _lt_server_client
+{
+	int				fd;
+	CS_BOOL				started;
+	CS_UBIGINT			acked;
+	CS_UBIGINT			next;
+	CS_INT				sent;
+	LT_BUF				dict;
+	CS_INT				dictsent;
+	CS_BYTE				in[32];
+	CS_INT				inlen;
+	struct _lt_server_client	*nextclient;
+} LT_SERVER_CLIENT;
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltserver.c */
+extern CS_RETCODE CS_PUBLIC lt_server_open(
+	CS_CHAR *address,
+	CS_INT maxbytes,
+	LT_SINK **sink
+	);
+
+#endif /* __LTSERVER_H__ */
@@ -0,0 +1,937 @@
+/*
+** Description
+** -----------
+** 	This file implements the sharded output sink. Every row change is
+** 	routed by a hash of its owner and table name to one of a number of
+** 	shards, each appending to its own file, "<prefix>.<shard>.changes",
+** 	from its own writer thread. A text change goes to the shard of the
+** 	change before it in its transaction. The part of each batch routed
+** 	to a shard is written to its file in the layout of ltsink.c, so a
+** 	transaction whose changes span several shards appears in each of
+** 	them with the changes routed there.
+**
+** 	The commit order across shards is kept in "<prefix>.manifest": for
+** 	each transaction, in commit order, a record of LT_SHARD_RECLEN bytes,
+**
+** 		CS_UBIGINT	BEGINXACT position
+** 		CS_UBIGINT	ENDXACT position
+** 		CS_BIGINT	commit time, microseconds since the epoch
+** 		CS_UINT		number of changes
+** 		CS_UINT		LT_SHARD_MAGIC
+** 		CS_UBIGINT	bit mask of the shards holding its changes
+**
+** 	A batch's transactions are added to the manifest once its parts
+** 	have been written to all their shards, so every transaction in the
+** 	manifest can be found in full in the shard files.
+**
+** 	The scanning thread only routes the changes and queues the parts;
+** 	it waits when a shard has more than a set number of bytes queued.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltxact.h"
+#include "ltbatch.h"
+#include "ltsink.h"
+#include "ltshard.h"
+#include "ltdurable.h"
+
+#define LT_PUT(_p, _v)	(memcpy((_p), &(_v), sizeof (_v)), (_p) += sizeof (_v))
+
+/*
+** State of a sharded sink. 'lock' guards the shard queues, the pending
+** batches and 'error', the errno of the first failed write.
+*/
+typedef struct _lt_shard_sink
+{
+	LT_SINK			sink;
+	CS_INT			nshards;
+	CS_INT			maxqueue;
+	LT_SHARD		*shards;
+	int			manifest;
+	LT_BUF			records;
+	pthread_mutex_t		lock;
+	pthread_cond_t		space;
+	LT_SHARD_PENDING	*pendhead;
+	LT_SHARD_PENDING	*pendtail;
+	CS_BOOL			stop;
+	int			error;
+	LT_SHARD_PART		**parts;
+	CS_INT			*lastxact;
+	LT_COLUMN		*columns;
+	CS_INT			maxcols;
+	LT_SHARD_ROUTE		*routes;
+	CS_UINT			maxroutes;
+} LT_SHARD_SINK;
+
+/*****************************************************************************
+**
+** writer functions
+**
+*****************************************************************************/
+
+/*
+** lt_shard_writev()
+**
+** Type of function:
+** 	sharded sink internal api
+**
+** Purpose:
+** 	Write out an I/O vector whole, resuming after a short write. Run by
+** 	the writer threads, so it reports failure by errno only.
+**
+** Parameters:
+** 	fd		- The file.
+** 	iov		- The I/O vector; it is consumed.
+** 	iovcnt		- Its length.
+**
+** Returns:
+** 	0, or the errno of the failed write.
+*/
+
+CS_STATIC int
+lt_shard_writev(int fd, struct iovec *iov, int iovcnt)
+{
+	ssize_t		n;
+
+	while (iovcnt > 0)
+	{
+		n = writev(fd, iov, iovcnt);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return errno;
+		}
+		while (iovcnt > 0 && (size_t)n >= iov->iov_len)
+		{
+			n -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0)
+		{
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+	return 0;
+}
+
+/*
+** lt_shard_free_part()
+**
+** Type of function:
+** 	sharded sink internal api
+**
+** Purpose:
+** 	Free a part.
+**
+** Parameters:
+** 	part		- The part.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_shard_free_part(LT_SHARD_PART *part)
+{
+	lt_buf_free(&part->batch.changes);
+	free(part->batch.xacts);
+	free(part);
+}
+
+/*
+** lt_shard_manifest()
+**
+** Type of function:
+** 	sharded sink internal api
+**
+** Purpose:
+** 	Add the transactions of the oldest pending batches whose parts have
+** 	all been written to the manifest, in order. Called with the lock
+** 	held, which keeps the manifest in commit order.
+**
+** Parameters:
+** 	ss		- The sink.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_shard_manifest(LT_SHARD_SINK *ss)
+{
+	LT_SHARD_PENDING	*pending;
+	LT_SHARD_XACT		*sx;
+	struct iovec		iov;
+	CS_UINT			u32;
+	CS_INT			i;
+	CS_BYTE			*p;
+	int			error;
+
+	ss->records.len = 0;
+	while ((pending = ss->pendhead) != NULL && pending->remaining == 0)
+	{
+		if (lt_buf_reserve(&ss->records,
+				pending->nxacts * LT_SHARD_RECLEN) != CS_SUCCEED)
+		{
+			if (ss->error == 0)
+			{
+				ss->error = ENOMEM;
+			}
+			break;
+		}
+		p = ss->records.data + ss->records.len;
+		for (i = 0; i < pending->nxacts; i++)
+		{
+			sx = &pending->xacts[i];
+			LT_PUT(p, sx->xactid);
+			LT_PUT(p, sx->commitpos);
+			LT_PUT(p, sx->committime);
+			LT_PUT(p, sx->nchanges);
+			u32 = LT_SHARD_MAGIC;
+			LT_PUT(p, u32);
+			LT_PUT(p, sx->shards);
+		}
+		ss->records.len = p - ss->records.data;
+
+		if ((ss->pendhead = pending->next) == NULL)
+		{
+			ss->pendtail = NULL;
+		}
+		free(pending->xacts);
+		free(pending);
+	}
+
+	if (ss->records.len > 0)
+	{
+		iov.iov_base = ss->records.data;
+		iov.iov_len = ss->records.len;
+		if ((error = lt_shard_writev(ss->manifest, &iov, 1)) != 0 &&
+		    ss->error == 0)
+		{
+			ss->error = error;
+		}
+	}
+}
+
+/*
+** lt_shard_writer()
+**
+** Type of function:
+** 	sharded sink internal api
+**
+** Purpose:
+** 	The writer thread of a shard: write the parts queued for it, in
+** 	order, until the sink is closed.
+**
+** Parameters:
+** 	arg		- The shard.
+**
+** Returns:
+** 	NULL.
+*/
+
+CS_STATIC CS_VOID *
+lt_shard_writer(CS_VOID *arg)
+{
+	LT_SHARD	*shard = (LT_SHARD *)arg;
+	LT_SHARD_SINK	*ss = shard->owner;
+	LT_SHARD_PART	*part;
+	struct iovec	iov[2];
+	int		error;
+
+	pthread_mutex_lock(&ss->lock);
+	for (;;)
+	{
+		while (shard->head == NULL && !ss->stop)
+		{
+			pthread_cond_wait(&shard->work, &ss->lock);
+		}
+		if ((part = shard->head) == NULL)
+		{
+			break;
+		}
+		if ((shard->head = part->next) == NULL)
+		{
+			shard->tail = NULL;
+		}
+		pthread_mutex_unlock(&ss->lock);
+
+		shard->header.len = 0;
+		if (lt_sink_encode(&shard->header, &part->batch) != CS_SUCCEED)
+		{
+			error = ENOMEM;
+		}
+		else
+		{
+			iov[0].iov_base = shard->header.data;
+			iov[0].iov_len = shard->header.len;
+			iov[1].iov_base = part->batch.changes.data;
+			iov[1].iov_len = part->batch.changes.len;
+			error = lt_shard_writev(shard->fd, iov, 2);
+		}
+
+		pthread_mutex_lock(&ss->lock);
+		shard->queued -= part->batch.changes.len;
+		if (error != 0 && ss->error == 0)
+		{
+			ss->error = error;
+		}
+		part->pending->remaining--;
+		lt_shard_manifest(ss);
+		pthread_cond_broadcast(&ss->space);
+		lt_shard_free_part(part);
+	}
+	pthread_mutex_unlock(&ss->lock);
+	return NULL;
+}
+
+/*****************************************************************************
+**
+** routing functions
+**
+*****************************************************************************/
+
+/*
+** lt_shard_hash()
+**
+** Type of function:
+** 	sharded sink internal api
+**
+** Purpose:
+** 	Pick the shard of a table. The shard is a hash of the names, so a
+** 	table keeps its shard from one run to the next, and is remembered
+** 	by the table's name id, so the names are hashed once per table.
+**
+** Parameters:
+** 	ss		- The sink.
+** 	change		- A change to the table.
+**
+** Returns:
+** 	The shard number.
+*/
+
+CS_STATIC CS_INT
+lt_shard_hash(LT_SHARD_SINK *ss, LT_CHANGE *change)
+{
+	LT_SHARD_ROUTE	*routes;
+	LT_SHARD_ROUTE	*r = NULL;
+	CS_UINT		h = 2166136261U;
+	CS_UINT		max;
+	CS_INT		i;
+
+	if (change->tableid >= ss->maxroutes)
+	{
+		for (max = (ss->maxroutes == 0) ? 64 : ss->maxroutes;
+		     max <= change->tableid; max *= 2)
+		{
+			;
+		}
+		routes = (LT_SHARD_ROUTE *)realloc(ss->routes,
+			max * sizeof (LT_SHARD_ROUTE));
+		if (routes != NULL)
+		{
+			memset(&routes[ss->maxroutes], 0,
+			       (max - ss->maxroutes) * sizeof (LT_SHARD_ROUTE));
+			ss->routes = routes;
+			ss->maxroutes = max;
+		}
+	}
+	if (change->tableid < ss->maxroutes)
+	{
+		r = &ss->routes[change->tableid];
+		if (r->shard > 0 && r->ownerid == change->ownerid)
+		{
+			return r->shard - 1;
+		}
+	}
+
+	for (i = 0; i < change->ownerlen; i++)
+	{
+		h = (h ^ (CS_BYTE)change->owner[i]) * 16777619U;
+	}
+	h = (h ^ '.') * 16777619U;
+	for (i = 0; i < change->tablelen; i++)
+	{
+		h = (h ^ (CS_BYTE)change->table[i]) * 16777619U;
+	}
+	i = (CS_INT)(h % (CS_UINT)ss->nshards);
+	if (r != NULL)
+	{
+		r->ownerid = change->ownerid;
+		r->shard = i + 1;
+	}
+	return i;
+}
+
+/*
+** lt_shard_route()
+**
+** Type of function:
+** 	sharded sink internal api
+**
+** Purpose:
+** 	Append a change of a transaction to the part of the batch for its
+** 	shard, starting the part or the transaction in it as needed.
+**
+** Parameters:
+** 	ss		- The sink.
+** 	shard		- The shard number.
+** 	x		- Index of the transaction in the batch.
+** 	bx		- The transaction.
+** 	data		- The encoded change.
+** 	len		- Its length.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a malloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_shard_route(LT_SHARD_SINK *ss, CS_INT shard, CS_INT x, LT_BATCH_XACT *bx,
+	       CS_BYTE *data, CS_INT len)
+{
+	LT_SHARD_PART	*part = ss->parts[shard];
+	LT_BATCH	*batch;
+	LT_BATCH_XACT	*px;
+	CS_RETCODE	retcode;
+	CS_INT		max;
+
+	if (part == NULL)
+	{
+		part = (LT_SHARD_PART *)calloc(1, sizeof (LT_SHARD_PART));
+		if (part == NULL)
+		{
+			ex_error("lt_shard_route: calloc() failed");
+			return CS_MEM_ERROR;
+		}
+		ss->parts[shard] = part;
+		ss->lastxact[shard] = -1;
+	}
+	batch = &part->batch;
+
+	if (ss->lastxact[shard] != x)
+	{
+		if (batch->nxacts == batch->maxxacts)
+		{
+			max = (batch->maxxacts == 0) ? 16 : batch->maxxacts * 2;
+			px = (LT_BATCH_XACT *)realloc(batch->xacts,
+				max * sizeof (LT_BATCH_XACT));
+			if (px == NULL)
+			{
+				ex_error("lt_shard_route: realloc() failed");
+				return CS_MEM_ERROR;
+			}
+			batch->xacts = px;
+			batch->maxxacts = max;
+		}
+		px = &batch->xacts[batch->nxacts++];
+		*px = *bx;
+		px->offset = batch->changes.len;
+		px->len = 0;
+		px->nchanges = 0;
+		batch->lastpos = bx->commitpos;
+		ss->lastxact[shard] = x;
+	}
+
+	if ((retcode = lt_buf_append(&batch->changes, data, len)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	px = &batch->xacts[batch->nxacts - 1];
+	px->len += len;
+	px->nchanges++;
+	batch->nchanges++;
+	return CS_SUCCEED;
+}
+
+/*****************************************************************************
+**
+** sink functions
+**
+*****************************************************************************/
+
+/*
+** lt_shard_failed()
+**
+** Type of function:
+** 	sharded sink internal api
+**
+** Purpose:
+** 	Report a failed write of a writer thread, from the calling thread.
+**
+** Parameters:
+** 	error		- The errno of the failed write.
+**
+** Returns:
+** 	CS_FAIL.
+*/
+
+CS_STATIC CS_RETCODE
+lt_shard_failed(int error)
+{
+	CS_CHAR		msg[EX_MAXSTRINGLEN];
+
+	sprintf(msg, "lt_shard: writing the shards failed: %s", strerror(error));
+	ex_error(msg);
+	return CS_FAIL;
+}
+
+/*
+** lt_shard_write()
+**
+** Type of function:
+** 	sharded sink internal api
+**
+** Purpose:
+** 	Route the changes of a batch to their shards and queue the parts for
+** 	the writer threads, waiting while a shard's queue is full.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	batch		- The batch to write.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a malloc failed, or CS_FAIL if a change
+** 	is malformed or a writer thread has failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_shard_write(LT_SINK *sink, LT_BATCH *batch)
+{
+	LT_SHARD_SINK		*ss = (LT_SHARD_SINK *)sink->ctx;
+	LT_SHARD_PENDING	*pending;
+	LT_SHARD_XACT		*sx;
+	LT_SHARD_PART		*part;
+	LT_SHARD		*shard;
+	LT_BATCH_XACT		*bx;
+	LT_CHANGE		change;
+	CS_RETCODE		retcode = CS_SUCCEED;
+	CS_INT			x;
+	CS_INT			s;
+	CS_INT			off;
+	CS_INT			len;
+	int			error;
+
+	pending = (LT_SHARD_PENDING *)calloc(1, sizeof (LT_SHARD_PENDING));
+	if (pending == NULL || (pending->xacts = (LT_SHARD_XACT *)malloc(
+			batch->nxacts * sizeof (LT_SHARD_XACT))) == NULL)
+	{
+		ex_error("lt_shard_write: malloc() failed");
+		free(pending);
+		return CS_MEM_ERROR;
+	}
+	pending->nxacts = batch->nxacts;
+	memset(ss->parts, 0, ss->nshards * sizeof (LT_SHARD_PART *));
+
+	for (x = 0; x < batch->nxacts && retcode == CS_SUCCEED; x++)
+	{
+		bx = &batch->xacts[x];
+		sx = &pending->xacts[x];
+		sx->xactid = bx->xactid;
+		sx->commitpos = bx->commitpos;
+		sx->committime = bx->committime;
+		sx->nchanges = (CS_UINT)bx->nchanges;
+		sx->shards = 0;
+
+		for (s = 0, off = bx->offset; off < bx->offset + bx->len; off += len)
+		{
+			len = lt_change_decode(batch->changes.data + off,
+				bx->offset + bx->len - off, &change,
+				&ss->columns, &ss->maxcols);
+			if (len == 0)
+			{
+				ex_error("lt_shard_write: malformed change");
+				retcode = CS_FAIL;
+				break;
+			}
+			if (change.tableid != 0)
+			{
+				s = lt_shard_hash(ss, &change);
+			}
+			if ((retcode = lt_shard_route(ss, s, x, bx,
+					batch->changes.data + off, len)) != CS_SUCCEED)
+			{
+				break;
+			}
+			sx->shards |= (CS_UBIGINT)1 << s;
+		}
+	}
+
+	if (retcode != CS_SUCCEED)
+	{
+		for (s = 0; s < ss->nshards; s++)
+		{
+			if (ss->parts[s] != NULL)
+			{
+				lt_shard_free_part(ss->parts[s]);
+			}
+		}
+		free(pending->xacts);
+		free(pending);
+		return retcode;
+	}
+
+	pthread_mutex_lock(&ss->lock);
+	for (s = 0; s < ss->nshards; s++)
+	{
+		if (ss->parts[s] != NULL)
+		{
+			pending->remaining++;
+		}
+	}
+	if (ss->pendtail != NULL)
+	{
+		ss->pendtail->next = pending;
+	}
+	else
+	{
+		ss->pendhead = pending;
+	}
+	ss->pendtail = pending;
+
+	for (s = 0; s < ss->nshards; s++)
+	{
+		if ((part = ss->parts[s]) == NULL)
+		{
+			continue;
+		}
+		shard = &ss->shards[s];
+		while (shard->queued > 0 &&
+		       shard->queued + part->batch.changes.len > ss->maxqueue)
+		{
+			pthread_cond_wait(&ss->space, &ss->lock);
+		}
+		part->pending = pending;
+		if (shard->tail != NULL)
+		{
+			shard->tail->next = part;
+		}
+		else
+		{
+			shard->head = part;
+		}
+		shard->tail = part;
+		shard->queued += part->batch.changes.len;
+		pthread_cond_signal(&shard->work);
+	}
+
+	/*
+	** A batch with no changes at all has no part to complete it.
+	*/
+	lt_shard_manifest(ss);
+	error = ss->error;
+	pthread_mutex_unlock(&ss->lock);
+
+	return (error != 0) ? lt_shard_failed(error) : CS_SUCCEED;
+}
+
+/*
+** lt_shard_sync()
+**
+** Type of function:
+** 	sharded sink internal api
+**
+** Purpose:
+** 	Wait until every batch queued has been written to its shards and
+** 	the manifest.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a writer thread has failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_shard_sync(LT_SINK *sink)
+{
+	LT_SHARD_SINK	*ss = (LT_SHARD_SINK *)sink->ctx;
+	int		error;
+
+	pthread_mutex_lock(&ss->lock);
+	while (ss->pendhead != NULL)
+	{
+		pthread_cond_wait(&ss->space, &ss->lock);
+	}
+	error = ss->error;
+	pthread_mutex_unlock(&ss->lock);
+
+	return (error != 0) ? lt_shard_failed(error) : CS_SUCCEED;
+}
+
+/*
+** lt_shard_lowwater()
+**
+** Type of function:
+** 	sharded sink internal api
+**
+** Purpose:
+** 	Find the oldest transaction not yet written to the manifest.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	base		- Key the scan order is taken from.
+** 	key		- Set to its BEGINXACT key, if there is one.
+**
+** Returns:
+** 	CS_TRUE if a transaction is being written, CS_FALSE otherwise.
+*/
+
+CS_STATIC CS_BOOL
+lt_shard_lowwater(LT_SINK *sink, CS_UBIGINT base, CS_UBIGINT *key)
+{
+	LT_SHARD_SINK		*ss = (LT_SHARD_SINK *)sink->ctx;
+	LT_SHARD_PENDING	*pending;
+	CS_BOOL			found = CS_FALSE;
+	CS_INT			i;
+
+	pthread_mutex_lock(&ss->lock);
+	for (pending = ss->pendhead; pending != NULL; pending = pending->next)
+	{
+		for (i = 0; i < pending->nxacts; i++)
+		{
+			if (!found ||
+			    LT_LOGPOS_SCAN(pending->xacts[i].xactid, base) <
+			    LT_LOGPOS_SCAN(*key, base))
+			{
+				*key = pending->xacts[i].xactid;
+				found = CS_TRUE;
+			}
+		}
+	}
+	pthread_mutex_unlock(&ss->lock);
+	return found;
+}
+
+/*
+** lt_shard_stop()
+**
+** Type of function:
+** 	sharded sink internal api
+**
+** Purpose:
+** 	Stop and join the first 'nthreads' writer threads, then close the
+** 	files and free the sink.
+**
+** Parameters:
+** 	ss		- The sink.
+** 	nthreads	- Number of writer threads started.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a close failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_shard_stop(LT_SHARD_SINK *ss, CS_INT nthreads)
+{
+	CS_RETCODE	retcode = CS_SUCCEED;
+	CS_INT		s;
+
+	pthread_mutex_lock(&ss->lock);
+	ss->stop = CS_TRUE;
+	for (s = 0; s < nthreads; s++)
+	{
+		pthread_cond_signal(&ss->shards[s].work);
+	}
+	pthread_mutex_unlock(&ss->lock);
+
+	for (s = 0; s < ss->nshards; s++)
+	{
+		if (s < nthreads)
+		{
+			pthread_join(ss->shards[s].thread, NULL);
+		}
+		pthread_cond_destroy(&ss->shards[s].work);
+		if (ss->shards[s].fd >= 0)
+		{
+			lt_durable_untrack(ss->shards[s].fd);
+		}
+		if (ss->shards[s].fd >= 0 && close(ss->shards[s].fd) != 0)
+		{
+			ex_error("lt_shard_stop: close() failed");
+			retcode = CS_FAIL;
+		}
+		lt_buf_free(&ss->shards[s].header);
+	}
+	if (ss->manifest >= 0)
+	{
+		lt_durable_untrack(ss->manifest);
+	}
+	if (ss->manifest >= 0 && close(ss->manifest) != 0)
+	{
+		ex_error("lt_shard_stop: close() failed");
+		retcode = CS_FAIL;
+	}
+
+	pthread_mutex_destroy(&ss->lock);
+	pthread_cond_destroy(&ss->space);
+	lt_buf_free(&ss->records);
+	free(ss->shards);
+	free(ss->parts);
+	free(ss->lastxact);
+	free(ss->columns);
+	free(ss->routes);
+	free(ss);
+	return retcode;
+}
+
+/*
+** lt_shard_close()
+**
+** Type of function:
+** 	sharded sink internal api
+**
+** Purpose:
+** 	Wait for the queued batches to be written, then stop the writer
+** 	threads and free the sink.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a write or close failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_shard_close(LT_SINK *sink)
+{
+	LT_SHARD_SINK	*ss = (LT_SHARD_SINK *)sink->ctx;
+	CS_RETCODE	retcode;
+
+	retcode = lt_shard_sync(sink);
+	if (lt_shard_stop(ss, ss->nshards) != CS_SUCCEED)
+	{
+		retcode = CS_FAIL;
+	}
+	return retcode;
+}
+
+/*
+** lt_shard_open()
+**
+** Type of function:
+** 	sharded sink api
+**
+** Purpose:
+** 	Open a sharded sink appending to "<prefix>.<shard>.changes" files
+** 	and "<prefix>.manifest", and start its writer threads.
+**
+** Parameters:
+** 	prefix		- Path prefix of the files.
+** 	nshards		- Number of shards, from 1 to LT_SHARD_MAX.
+** 	maxqueue	- Bytes of changes queued for a shard after which
+** 			  the scan waits for its writer.
+** 	sink		- Set to the new sink.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a malloc failed, or CS_FAIL if a file
+** 	could not be opened or a thread started.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_shard_open(CS_CHAR *prefix, CS_INT nshards, CS_INT maxqueue, LT_SINK **sink)
+{
+	LT_SHARD_SINK	*ss;
+	CS_CHAR		*path;
+	CS_INT		s;
+
+	if (nshards < 1 || nshards > LT_SHARD_MAX)
+	{
+		ex_error("lt_shard_open: bad number of shards");
+		return CS_FAIL;
+	}
+
+	ss = (LT_SHARD_SINK *)calloc(1, sizeof (LT_SHARD_SINK));
+	path = (CS_CHAR *)malloc(strlen(prefix) + 16);
+	if (ss == NULL || path == NULL ||
+	    (ss->shards = (LT_SHARD *)calloc(nshards, sizeof (LT_SHARD))) == NULL ||
+	    (ss->parts = (LT_SHARD_PART **)calloc(nshards,
+			sizeof (LT_SHARD_PART *))) == NULL ||
+	    (ss->lastxact = (CS_INT *)calloc(nshards, sizeof (CS_INT))) == NULL)
+	{
+		ex_error("lt_shard_open: malloc() failed");
+		if (ss != NULL)
+		{
+			free(ss->shards);
+			free(ss->parts);
+		}
+		free(ss);
+		free(path);
+		return CS_MEM_ERROR;
+	}
+
+	ss->nshards = nshards;
+	ss->maxqueue = maxqueue;
+	pthread_mutex_init(&ss->lock, NULL);
+	pthread_cond_init(&ss->space, NULL);
+	for (s = 0; s < nshards; s++)
+	{
+		ss->shards[s].owner = ss;
+		pthread_cond_init(&ss->shards[s].work, NULL);
+		sprintf(path, "%s.%02d.changes", prefix, (int)s);
+		ss->shards[s].fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+	}
+	sprintf(path, "%s.manifest", prefix);
+	ss->manifest = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+	free(path);
+
+	for (s = 0; s < nshards && ss->shards[s].fd >= 0; s++)
+	{
+		;
+	}
+	if (s < nshards || ss->manifest < 0)
+	{
+		ex_error("lt_shard_open: open() failed");
+		lt_shard_stop(ss, 0);
+		return CS_FAIL;
+	}
+	for (s = 0; s < nshards; s++)
+	{
+		if (lt_durable_track(ss->shards[s].fd) != CS_SUCCEED)
+		{
+			lt_shard_stop(ss, 0);
+			return CS_FAIL;
+		}
+	}
+	if (lt_durable_track(ss->manifest) != CS_SUCCEED)
+	{
+		lt_shard_stop(ss, 0);
+		return CS_FAIL;
+	}
+
+	for (s = 0; s < nshards; s++)
+	{
+		if (pthread_create(&ss->shards[s].thread, NULL, lt_shard_writer,
+				&ss->shards[s]) != 0)
+		{
+			ex_error("lt_shard_open: pthread_create() failed");
+			lt_shard_stop(ss, s);
+			return CS_FAIL;
+		}
+	}
+
+	ss->sink.name = "shard";
+	ss->sink.write = lt_shard_write;
+	ss->sink.close = lt_shard_close;
+	ss->sink.sync = lt_shard_sync;
+	ss->sink.lowwater = lt_shard_lowwater;
+	ss->sink.ctx = ss;
+	*sink = &ss->sink;
+	return CS_SUCCEED;
+}
@@ -0,0 +1,104 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	sharded output sink in ltshard.c.
+**
+*/
+
+#ifndef __LTSHARD_H__
+#define __LTSHARD_H__
+
+#include <pthread.h>
+#include "ltbatch.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** Shards are numbered from 0; a manifest record has a bit per shard.
+*/
+#define LT_SHARD_MAX		64
+
+#define LT_SHARD_MAGIC		0x3148534c	/* "LSH1" */
+#define LT_SHARD_RECLEN		40
+
+/*
+** A transaction in the manifest: its positions and commit time, its
+** number of changes, and the shards its changes went to.
+*/
+typedef struct _lt_shard_xact
+{
+	CS_UBIGINT	xactid;
+	CS_UBIGINT	commitpos;
+	CS_BIGINT	committime;
+	CS_UINT		nchanges;
+	CS_UBIGINT	shards;
+} LT_SHARD_XACT;
+
+/*
+** A batch whose parts are being written. Its transactions go to the
+** manifest once 'remaining' parts have all been written.
+*/
+typedef struct _lt_shard_pending
+{
+	LT_SHARD_XACT			*xacts;
+	CS_INT				nxacts;
+	CS_INT				remaining;
+	struct _lt_shard_pending	*next;
+} LT_SHARD_PENDING;
+
+/*
+** The part of a batch holding the changes routed to one shard.
+*/
+typedef struct _lt_shard_part
+{
+	LT_BATCH		batch;
+	LT_SHARD_PENDING	*pending;
+	struct _lt_shard_part	*next;
+} LT_SHARD_PART;
+
+/*
+** The shard a table was routed to, remembered by the dictionary id of
+** its name: 'shard' is the shard number plus one, or 0 if the table has
+** not been routed yet, and 'ownerid' the id of its owner.
+*/
+typedef struct _lt_shard_route
+{
+	CS_UINT			ownerid;
+	CS_INT			shard;
+} LT_SHARD_ROUTE;
+
+/*
+** A shard: its file, its writer thread and the queue of parts waiting
+** for it, holding 'queued' bytes of changes.
+*/
+typedef struct _lt_shard
+{
+	int			fd;
+	pthread_t		thread;
+	pthread_cond_t		work;
+	LT_SHARD_PART		*head;
+	LT_SHARD_PART		*tail;
+	CS_BIGINT		queued;
+	LT_BUF			header;
+	struct _lt_shard_sink	*owner;
+} LT_SHARD;
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltshard.c */
+extern CS_RETCODE CS_PUBLIC lt_shard_open(
+	CS_CHAR *prefix,
+	CS_INT nshards,
+	CS_INT maxqueue,
+	LT_SINK **sink
+	);
+
+#endif /* __LTSHARD_H__ */
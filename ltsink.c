@@ -0,0 +1,300 @@
+/*
+** Description
+** -----------
+** 	This file implements the batch file sink, which appends each batch
+** 	of committed transactions to a file with a single writev() call.
+**
+** 	A batch is laid out as:
+**
+** 		CS_UINT		LT_SINK_MAGIC
+** 		CS_UINT		number of transactions
+** 		CS_UINT		number of changes
+** 		CS_UINT		length of the changes
+** 		CS_UBIGINT	commit position of the last transaction
+**
+** 	followed by, for each transaction in commit order:
+**
+** 		CS_UBIGINT	BEGINXACT position
+** 		CS_UBIGINT	ENDXACT position
+** 		CS_BIGINT	commit time, microseconds since the epoch
+** 		CS_UINT		number of changes
+** 		CS_UINT		length of the changes
+**
+** 	and by the changes of all the transactions, as encoded by
+** 	ltchange.c.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltbatch.h"
+#include "ltsink.h"
+#include "ltdurable.h"
+
+#define LT_PUT(_p, _v)	(memcpy((_p), &(_v), sizeof (_v)), (_p) += sizeof (_v))
+
+/*
+** State of a file sink. 'torn' is set once a failed write left part of a
+** batch in the file that could not be cut off again.
+*/
+typedef struct _lt_file_sink
+{
+	LT_SINK		sink;
+	int		fd;
+	LT_BUF		header;
+	CS_BOOL		torn;
+} LT_FILE_SINK;
+
+/*****************************************************************************
+**
+** file sink functions
+**
+*****************************************************************************/
+
+/*
+** lt_sink_encode()
+**
+** Type of function:
+** 	batch file sink api
+**
+** Purpose:
+** 	Append the header and transaction table of a batch to a buffer, in
+** 	the layout described above. The changes themselves follow them in
+** 	the batch's change buffer.
+**
+** Parameters:
+** 	buf		- The buffer.
+** 	batch		- The batch.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_sink_encode(LT_BUF *buf, LT_BATCH *batch)
+{
+	LT_BATCH_XACT	*bx;
+	CS_RETCODE	retcode;
+	CS_UINT		u32;
+	CS_INT		i;
+	CS_BYTE		*p;
+
+	if ((retcode = lt_buf_reserve(buf, LT_SINK_HDRLEN +
+			batch->nxacts * LT_SINK_XACTLEN)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	p = buf->data + buf->len;
+	u32 = LT_SINK_MAGIC;
+	LT_PUT(p, u32);
+	u32 = (CS_UINT)batch->nxacts;
+	LT_PUT(p, u32);
+	u32 = (CS_UINT)batch->nchanges;
+	LT_PUT(p, u32);
+	u32 = (CS_UINT)batch->changes.len;
+	LT_PUT(p, u32);
+	LT_PUT(p, batch->lastpos);
+	for (i = 0; i < batch->nxacts; i++)
+	{
+		bx = &batch->xacts[i];
+		LT_PUT(p, bx->xactid);
+		LT_PUT(p, bx->commitpos);
+		LT_PUT(p, bx->committime);
+		u32 = (CS_UINT)bx->nchanges;
+		LT_PUT(p, u32);
+		u32 = (CS_UINT)bx->len;
+		LT_PUT(p, u32);
+	}
+	buf->len = p - buf->data;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_sink_file_write()
+**
+** Type of function:
+** 	batch file sink internal api
+**
+** Purpose:
+** 	Append a batch to the file. The header and transaction table are
+** 	built in one buffer and written together with the changes, resuming
+** 	after a short write. If the write fails part way, the file is cut
+** 	back to where the batch began, so that the batcher's retry does not
+** 	follow a torn copy of it; if that fails too, every later write is
+** 	refused.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	batch		- The batch to write.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a realloc failed, or CS_FAIL if the
+** 	write failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_sink_file_write(LT_SINK *sink, LT_BATCH *batch)
+{
+	LT_FILE_SINK	*fs = (LT_FILE_SINK *)sink->ctx;
+	CS_RETCODE	retcode;
+	CS_INT		iovcnt;
+	struct iovec	iov[2];
+	struct iovec	*v;
+	ssize_t		n;
+	off_t		start;
+
+	if (fs->torn)
+	{
+		ex_error("lt_sink_file_write: file ends in a torn batch");
+		return CS_FAIL;
+	}
+	if ((start = lseek(fs->fd, 0, SEEK_END)) < 0)
+	{
+		ex_error("lt_sink_file_write: lseek() failed");
+		return CS_FAIL;
+	}
+
+	fs->header.len = 0;
+	if ((retcode = lt_sink_encode(&fs->header, batch)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	iov[0].iov_base = fs->header.data;
+	iov[0].iov_len = fs->header.len;
+	iov[1].iov_base = batch->changes.data;
+	iov[1].iov_len = batch->changes.len;
+	v = iov;
+	iovcnt = (batch->changes.len > 0) ? 2 : 1;
+
+	while (iovcnt > 0)
+	{
+		n = writev(fs->fd, v, iovcnt);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+		while (iovcnt > 0 && (size_t)n >= v->iov_len)
+		{
+			n -= v->iov_len;
+			v++;
+			iovcnt--;
+		}
+		if (iovcnt > 0)
+		{
+			v->iov_base = (char *)v->iov_base + n;
+			v->iov_len -= n;
+		}
+	}
+
+	if (iovcnt > 0)
+	{
+		ex_error("lt_sink_file_write: writev() failed");
+		if (ftruncate(fs->fd, start) != 0)
+		{
+			ex_error("lt_sink_file_write: ftruncate() failed");
+			fs->torn = CS_TRUE;
+		}
+		return CS_FAIL;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_sink_file_close()
+**
+** Type of function:
+** 	batch file sink internal api
+**
+** Purpose:
+** 	Close the file and free the sink.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the close failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_sink_file_close(LT_SINK *sink)
+{
+	LT_FILE_SINK	*fs = (LT_FILE_SINK *)sink->ctx;
+	CS_RETCODE	retcode = CS_SUCCEED;
+
+	lt_durable_untrack(fs->fd);
+	if (close(fs->fd) != 0)
+	{
+		ex_error("lt_sink_file_close: close() failed");
+		retcode = CS_FAIL;
+	}
+	lt_buf_free(&fs->header);
+	free(fs);
+	return retcode;
+}
+
+/*
+** lt_sink_file_open()
+**
+** Type of function:
+** 	batch file sink api
+**
+** Purpose:
+** 	Open a file sink appending to 'path', creating the file if needed.
+**
+** Parameters:
+** 	path		- Path of the output file.
+** 	sink		- Set to the new sink.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a malloc failed, or CS_FAIL if the file
+** 	could not be opened.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_sink_file_open(CS_CHAR *path, LT_SINK **sink)
+{
+	LT_FILE_SINK	*fs;
+
+	fs = (LT_FILE_SINK *)calloc(1, sizeof (LT_FILE_SINK));
+	if (fs == NULL)
+	{
+		ex_error("lt_sink_file_open: calloc() failed");
+		return CS_MEM_ERROR;
+	}
+
+	fs->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if (fs->fd < 0)
+	{
+		ex_error("lt_sink_file_open: open() failed");
+		free(fs);
+		return CS_FAIL;
+	}
+	if (lt_durable_track(fs->fd) != CS_SUCCEED)
+	{
+		close(fs->fd);
+		free(fs);
+		return CS_FAIL;
+	}
+
+	fs->sink.name = "file";
+	fs->sink.write = lt_sink_file_write;
+	fs->sink.close = lt_sink_file_close;
+	fs->sink.ctx = fs;
+	*sink = &fs->sink;
+	return CS_SUCCEED;
+}
@@ -0,0 +1,39 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	batch file sink in ltsink.c.
+**
+*/
+
+#ifndef __LTSINK_H__
+#define __LTSINK_H__
+
+#include "ltbatch.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+#define LT_SINK_MAGIC		0x3142544c	/* "LTB1" */
+#define LT_SINK_HDRLEN		24
+#define LT_SINK_XACTLEN		32
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltsink.c */
+extern CS_RETCODE CS_PUBLIC lt_sink_encode(
+	LT_BUF *buf,
+	LT_BATCH *batch
+	);
+extern CS_RETCODE CS_PUBLIC lt_sink_file_open(
+	CS_CHAR *path,
+	LT_SINK **sink
+	);
+
+#endif /* __LTSINK_H__ */
@@ -0,0 +1,147 @@
+/*
+** Description
+** -----------
+** 	This file holds the tick counters of the tracepoints of lttrace.h,
+** 	for a build with LT_TRACE_CYCLES. Each tracepoint counts its calls
+** 	and the ticks spent between its begin and its end, in two metrics of
+** 	the registry; the begin tick is kept per thread. In the other builds
+** 	the counters stay at 0 and are neither registered nor reported.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "lthist.h"
+#include "ltmetrics.h"
+#include "lttrace.h"
+
+/*
+** The counters of the tracepoints, in the order of their ids, and the
+** tick at which each was last begun on this thread.
+*/
+LT_TRACE_POINT Lt_trace_points[LT_TRACE_NPOINTS] =
+{
+	{ "scan", "point=\"scan\"" },
+	{ "results", "point=\"results\"" },
+	{ "fetch", "point=\"fetch\"" },
+	{ "sink", "point=\"sink\"" }
+};
+
+__thread CS_BIGINT Lt_trace_start[LT_TRACE_NPOINTS];
+
+/*****************************************************************************
+**
+** trace functions
+**
+*****************************************************************************/
+
+/*
+** lt_trace_init()
+**
+** Type of function:
+** 	tracepoint api
+**
+** Purpose:
+** 	Register the counters of the tracepoints, in a build that counts
+** 	them.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_trace_init(CS_VOID)
+{
+#if defined(LT_TRACE_CYCLES)
+	CS_INT		i;
+
+	for (i = 0; i < LT_TRACE_NPOINTS; i++)
+	{
+		lt_metrics_counter(&Lt_trace_points[i].calls,
+				   "lt_trace_calls_total",
+				   "Calls through a tracepoint.",
+				   Lt_trace_points[i].labels, NULL);
+		lt_metrics_counter(&Lt_trace_points[i].ticks,
+				   "lt_trace_ticks_total",
+				   "Ticks spent in a tracepoint, TSC cycles on x86.",
+				   Lt_trace_points[i].labels, NULL);
+	}
+#endif
+}
+
+/*
+** lt_trace_ticks()
+**
+** Type of function:
+** 	tracepoint api
+**
+** Purpose:
+** 	Read the tick counter where there is no TSC.
+**
+** Parameters:
+** 	None.
+**
+** Returns:
+** 	Nanoseconds since an arbitrary fixed point.
+*/
+
+CS_BIGINT CS_PUBLIC
+lt_trace_ticks(CS_VOID)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (CS_BIGINT)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+** lt_trace_report()
+**
+** Type of function:
+** 	tracepoint api
+**
+** Purpose:
+** 	Write the calls and the mean ticks per call of each tracepoint on
+** 	one line, as "trace=<mode> <point>_calls=<n> <point>_ticks=<n> ...",
+** 	in a build that counts them.
+**
+** Parameters:
+** 	out		- The file written to.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_trace_report(FILE *out)
+{
+#if defined(LT_TRACE_CYCLES)
+	CS_BIGINT	calls;
+	CS_BIGINT	ticks;
+	CS_INT		i;
+
+	fprintf(out, "trace=%s", LT_TRACE_MODE);
+	for (i = 0; i < LT_TRACE_NPOINTS; i++)
+	{
+		calls = __atomic_load_n(&Lt_trace_points[i].calls.value,
+					__ATOMIC_RELAXED);
+		ticks = __atomic_load_n(&Lt_trace_points[i].ticks.value,
+					__ATOMIC_RELAXED);
+		fprintf(out, " %s_calls=%lld %s_ticks=%.0f",
+			Lt_trace_points[i].name, (long long)calls,
+			Lt_trace_points[i].name,
+			(calls > 0) ? (double)ticks / calls : 0.0);
+	}
+	fprintf(out, "\n");
+	fflush(out);
+#endif
+}
@@ -0,0 +1,117 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the tracepoint macros of the hot path,
+** 	and the prototypes for the tick counters of lttrace.c.
+**
+** 	A tracepoint is a pair of LT_TRACE_BEGIN() and LT_TRACE_END() around
+** 	an operation, each with one integer argument. What they compile to
+** 	is chosen at build time, with TRACE in the Makefile:
+**
+** 	(none)		Nothing; the arguments are not evaluated.
+** 	-DLT_TRACE_USDT	USDT probes, "logtransfer:<point>__begin" and
+** 			"logtransfer:<point>__end", for perf and bpftrace.
+** 			Each is a nop until a tracer attaches to it.
+** 			Needs <sys/sdt.h>, from systemtap-sdt-dev.
+** 	-DLT_TRACE_CYCLES
+** 			An in-process collector: the calls and the ticks
+** 			spent in each operation are counted, exposed as
+** 			metrics, and reported at exit. The ticks are TSC
+** 			cycles on x86, nanoseconds elsewhere.
+**
+*/
+
+#ifndef __LTTRACE_H__
+#define __LTTRACE_H__
+
+#include "ltchange.h"
+#include "lthist.h"
+#include "ltmetrics.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** The tracepoints: a scan round trip in DoLogtransfer(), the handling of
+** its results, the fetch of one result set, and a batch written to the
+** sink.
+*/
+#define LT_TRACE_scan		0
+#define LT_TRACE_results	1
+#define LT_TRACE_fetch		2
+#define LT_TRACE_sink		3
+#define LT_TRACE_NPOINTS	4
+
+/*
+** The counters of a tracepoint, kept by the collector.
+*/
+typedef struct _lt_trace_point
+{
+	CS_CHAR		*name;
+	CS_CHAR		*labels;
+	LT_METRIC	calls;
+	LT_METRIC	ticks;
+} LT_TRACE_POINT;
+
+#if defined(LT_TRACE_USDT)
+
+#include <sys/sdt.h>
+
+#define LT_TRACE_MODE	"usdt"
+#define LT_TRACE_BEGIN(_point, _arg)	DTRACE_PROBE1(logtransfer, \
+	_point##__begin, (long)(_arg))
+#define LT_TRACE_END(_point, _arg)	DTRACE_PROBE1(logtransfer, \
+	_point##__end, (long)(_arg))
+
+#elif defined(LT_TRACE_CYCLES)
+
+#define LT_TRACE_MODE	"cycles"
+#if defined(__x86_64__) || defined(__i386__)
+#define LT_TRACE_TICKS()	((CS_BIGINT)__builtin_ia32_rdtsc())
+#else
+#define LT_TRACE_TICKS()	lt_trace_ticks()
+#endif
+#define LT_TRACE_BEGIN(_point, _arg)	\
+	(Lt_trace_start[LT_TRACE_##_point] = LT_TRACE_TICKS())
+#define LT_TRACE_END(_point, _arg)	\
+	(LT_METRIC_ADD(&Lt_trace_points[LT_TRACE_##_point].calls, 1), \
+	 LT_METRIC_ADD(&Lt_trace_points[LT_TRACE_##_point].ticks, \
+		       LT_TRACE_TICKS() - Lt_trace_start[LT_TRACE_##_point]))
+
+#else
+
+#define LT_TRACE_MODE	"off"
+#define LT_TRACE_BEGIN(_point, _arg)	((void)0)
+#define LT_TRACE_END(_point, _arg)	((void)0)
+
+#endif
+
+/*****************************************************************************
+**
+** data shared with the tracepoints
+**
+*****************************************************************************/
+/* lttrace.c */
+extern LT_TRACE_POINT Lt_trace_points[LT_TRACE_NPOINTS];
+extern __thread CS_BIGINT Lt_trace_start[LT_TRACE_NPOINTS];
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* lttrace.c */
+extern CS_VOID CS_PUBLIC lt_trace_init(
+	CS_VOID
+	);
+extern CS_BIGINT CS_PUBLIC lt_trace_ticks(
+	CS_VOID
+	);
+extern CS_VOID CS_PUBLIC lt_trace_report(
+	FILE *out
+	);
+
+#endif /* __LTTRACE_H__ */
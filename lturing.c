@@ -0,0 +1,842 @@
+/*
+** Description
+** -----------
+** 	This file implements the io_uring batch file sink. It writes the
+** 	batch file of ltsink.c, but through an io_uring instance set up with
+** 	the raw system calls, so the scan never waits on the disk unless all
+** 	its buffers are in flight.
+**
+** 	Batches are copied into a fixed set of LT_URING_NBUFS page aligned
+** 	buffers registered with the ring, and each buffer is written with a
+** 	single IORING_OP_WRITE_FIXED at an offset of its own. A buffer is
+** 	submitted once full, or, partly filled, when no write is in flight,
+** 	so small batches are coalesced while the disk is busy. After every
+** 	'syncbytes' bytes submitted an fdatasync is queued behind the writes
+** 	(IOSQE_IO_DRAIN), so the cost of the syncs is spread over the batches
+** 	rather than paid by each of them.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltbatch.h"
+#include "ltsink.h"
+#include "lturing.h"
+#include "ltdurable.h"
+
+/*
+** user_data of the fsync; that of a write is its buffer number.
+*/
+#define LT_URING_SYNCDATA	((__u64)-1)
+
+/*
+** State of an io_uring sink. 'offset' is the file offset of the next
+** buffer submitted and 'synced' the offset up to which the file is known
+** to be on disk. 'shortwrites' counts the writes resubmitted after a short
+** write, which an fsync queued before them does not cover. 'queued'
+** submission entries are filled in but not yet in the ring, and
+** 'tosubmit' are in the ring but not yet taken by the kernel.
+*/
+typedef struct _lt_uring_sink
+{
+	LT_SINK			sink;
+	int			fd;
+	int			ring;
+	CS_VOID			*sqmap;
+	size_t			sqmaplen;
+	CS_VOID			*cqmap;
+	size_t			cqmaplen;
+	struct io_uring_sqe	*sqes;
+	size_t			sqeslen;
+	unsigned		*sqtail;
+	unsigned		sqmask;
+	unsigned		*sqarray;
+	unsigned		*cqhead;
+	unsigned		*cqtail;
+	unsigned		cqmask;
+	struct io_uring_cqe	*cqes;
+	unsigned		queued;
+	unsigned		tosubmit;
+	LT_URING_BUF		bufs[LT_URING_NBUFS];
+	CS_INT			bufsize;
+	CS_INT			cur;
+	CS_INT			inflight;
+	CS_BIGINT		offset;
+	CS_BIGINT		unsynced;
+	CS_BIGINT		syncbytes;
+	CS_BOOL			syncing;
+	CS_BIGINT		syncpos;
+	CS_INT			syncshort;
+	CS_BIGINT		synced;
+	CS_INT			shortwrites;
+	int			error;
+	LT_BUF			header;
+} LT_URING_SINK;
+
+/*****************************************************************************
+**
+** ring functions
+**
+*****************************************************************************/
+
+/*
+** lt_uring_setup()
+**
+** Type of function:
+** 	io_uring sink internal api
+**
+** Purpose:
+** 	Set up the ring and map its queues.
+**
+** Parameters:
+** 	us		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if io_uring is not available.
+*/
+
+CS_STATIC CS_RETCODE
+lt_uring_setup(LT_URING_SINK *us)
+{
+	struct io_uring_params	params;
+	CS_BYTE			*sq;
+	CS_BYTE			*cq;
+
+	memset(&params, 0, sizeof (params));
+	us->ring = (int)syscall(__NR_io_uring_setup, LT_URING_ENTRIES, &params);
+	if (us->ring < 0)
+	{
+		ex_error("lt_uring_setup: io_uring_setup() failed");
+		return CS_FAIL;
+	}
+
+	us->sqmaplen = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+	us->cqmaplen = params.cq_off.cqes +
+		params.cq_entries * sizeof (struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (us->cqmaplen > us->sqmaplen)
+		{
+			us->sqmaplen = us->cqmaplen;
+		}
+		us->cqmaplen = 0;
+	}
+	us->sqeslen = params.sq_entries * sizeof (struct io_uring_sqe);
+
+	us->sqmap = mmap(NULL, us->sqmaplen, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, us->ring, IORING_OFF_SQ_RING);
+	if (us->sqmap == MAP_FAILED)
+	{
+		us->sqmap = NULL;
+		ex_error("lt_uring_setup: mmap() failed");
+		return CS_FAIL;
+	}
+	us->cqmap = us->sqmap;
+	if (us->cqmaplen > 0)
+	{
+		us->cqmap = mmap(NULL, us->cqmaplen, PROT_READ | PROT_WRITE,
+				 MAP_SHARED | MAP_POPULATE, us->ring,
+				 IORING_OFF_CQ_RING);
+		if (us->cqmap == MAP_FAILED)
+		{
+			us->cqmap = NULL;
+			ex_error("lt_uring_setup: mmap() failed");
+			return CS_FAIL;
+		}
+	}
+	us->sqes = (struct io_uring_sqe *)mmap(NULL, us->sqeslen,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			us->ring, IORING_OFF_SQES);
+	if (us->sqes == MAP_FAILED)
+	{
+		us->sqes = NULL;
+		ex_error("lt_uring_setup: mmap() failed");
+		return CS_FAIL;
+	}
+
+	sq = (CS_BYTE *)us->sqmap;
+	cq = (CS_BYTE *)us->cqmap;
+	us->sqtail = (unsigned *)(sq + params.sq_off.tail);
+	us->sqmask = *(unsigned *)(sq + params.sq_off.ring_mask);
+	us->sqarray = (unsigned *)(sq + params.sq_off.array);
+	us->cqhead = (unsigned *)(cq + params.cq_off.head);
+	us->cqtail = (unsigned *)(cq + params.cq_off.tail);
+	us->cqmask = *(unsigned *)(cq + params.cq_off.ring_mask);
+	us->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+	return CS_SUCCEED;
+}
+
+/*
+** lt_uring_sqe()
+**
+** Type of function:
+** 	io_uring sink internal api
+**
+** Purpose:
+** 	Queue a cleared submission entry. The sink never has more entries
+** 	outstanding than the ring holds, so there always is one.
+**
+** Parameters:
+** 	us		- The sink.
+**
+** Returns:
+** 	The entry, to be filled in before the next lt_uring_enter().
+*/
+
+CS_STATIC struct io_uring_sqe *
+lt_uring_sqe(LT_URING_SINK *us)
+{
+	struct io_uring_sqe	*sqe;
+	unsigned		tail;
+	unsigned		idx;
+
+	tail = *us->sqtail + us->queued;
+	idx = tail & us->sqmask;
+	sqe = &us->sqes[idx];
+	memset(sqe, 0, sizeof (*sqe));
+	us->sqarray[idx] = idx;
+	us->queued++;
+	return sqe;
+}
+
+/*
+** lt_uring_submit()
+**
+** Type of function:
+** 	io_uring sink internal api
+**
+** Purpose:
+** 	Queue the write of the unwritten part of a buffer.
+**
+** Parameters:
+** 	us		- The sink.
+** 	i		- The buffer number.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_uring_submit(LT_URING_SINK *us, CS_INT i)
+{
+	LT_URING_BUF		*buf = &us->bufs[i];
+	struct io_uring_sqe	*sqe;
+
+	sqe = lt_uring_sqe(us);
+	sqe->opcode = IORING_OP_WRITE_FIXED;
+	sqe->fd = us->fd;
+	sqe->addr = (__u64)(uintptr_t)(buf->data + buf->done);
+	sqe->len = (__u32)(buf->len - buf->done);
+	sqe->off = (__u64)(buf->offset + buf->done);
+	sqe->buf_index = (__u16)i;
+	sqe->user_data = (__u64)i;
+}
+
+/*
+** lt_uring_fsync()
+**
+** Type of function:
+** 	io_uring sink internal api
+**
+** Purpose:
+** 	Queue an fdatasync behind every write queued so far.
+**
+** Parameters:
+** 	us		- The sink.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_uring_fsync(LT_URING_SINK *us)
+{
+	struct io_uring_sqe	*sqe;
+
+	sqe = lt_uring_sqe(us);
+	sqe->opcode = IORING_OP_FSYNC;
+	sqe->flags = IOSQE_IO_DRAIN;
+	sqe->fd = us->fd;
+	sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+	sqe->user_data = LT_URING_SYNCDATA;
+
+	us->syncing = CS_TRUE;
+	us->syncpos = us->offset;
+	us->syncshort = us->shortwrites;
+	us->unsynced = 0;
+}
+
+/*
+** lt_uring_complete()
+**
+** Type of function:
+** 	io_uring sink internal api
+**
+** Purpose:
+** 	Handle a completion: free a written buffer, resubmit the rest of a
+** 	short write, or advance the synced offset.
+**
+** Parameters:
+** 	us		- The sink.
+** 	cqe		- The completion.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_uring_complete(LT_URING_SINK *us, struct io_uring_cqe *cqe)
+{
+	LT_URING_BUF	*buf;
+	CS_INT		i;
+
+	if (cqe->user_data == LT_URING_SYNCDATA)
+	{
+		us->syncing = CS_FALSE;
+		if (cqe->res < 0)
+		{
+			us->error = (us->error != 0) ? us->error : -cqe->res;
+		}
+		else if (us->shortwrites == us->syncshort)
+		{
+			us->synced = us->syncpos;
+		}
+		return;
+	}
+
+	i = (CS_INT)cqe->user_data;
+	buf = &us->bufs[i];
+	if (cqe->res == -EINTR || cqe->res == -EAGAIN)
+	{
+		lt_uring_submit(us, i);
+		return;
+	}
+	if (cqe->res <= 0)
+	{
+		us->error = (us->error != 0) ? us->error :
+			((cqe->res < 0) ? -cqe->res : EIO);
+	}
+	else if (buf->done + cqe->res < buf->len)
+	{
+		buf->done += cqe->res;
+		us->shortwrites++;
+		lt_uring_submit(us, i);
+		return;
+	}
+	buf->busy = CS_FALSE;
+	us->inflight--;
+}
+
+/*
+** lt_uring_enter()
+**
+** Type of function:
+** 	io_uring sink internal api
+**
+** Purpose:
+** 	Submit the queued entries, optionally wait for a completion, and
+** 	handle the completions there are.
+**
+** Parameters:
+** 	us		- The sink.
+** 	wait		- CS_TRUE to wait for at least one completion.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if io_uring_enter() failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_uring_enter(LT_URING_SINK *us, CS_BOOL wait)
+{
+	unsigned	head;
+	unsigned	tail;
+	int		n;
+
+	if (us->queued > 0)
+	{
+		atomic_store_explicit((_Atomic unsigned *)us->sqtail,
+			*us->sqtail + us->queued, memory_order_release);
+		us->tosubmit += us->queued;
+		us->queued = 0;
+	}
+	if (us->tosubmit > 0 || wait)
+	{
+		do
+		{
+			n = (int)syscall(__NR_io_uring_enter, us->ring,
+				us->tosubmit, wait ? 1 : 0,
+				wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+		} while (n < 0 && errno == EINTR);
+		if (n < 0)
+		{
+			us->error = (us->error != 0) ? us->error : errno;
+			return CS_FAIL;
+		}
+		us->tosubmit -= (unsigned)n;
+	}
+
+	head = *us->cqhead;
+	tail = atomic_load_explicit((_Atomic unsigned *)us->cqtail,
+				    memory_order_acquire);
+	while (head != tail)
+	{
+		lt_uring_complete(us, &us->cqes[head & us->cqmask]);
+		head++;
+	}
+	atomic_store_explicit((_Atomic unsigned *)us->cqhead, head,
+			      memory_order_release);
+	return CS_SUCCEED;
+}
+
+/*****************************************************************************
+**
+** buffer functions
+**
+*****************************************************************************/
+
+/*
+** lt_uring_flush()
+**
+** Type of function:
+** 	io_uring sink internal api
+**
+** Purpose:
+** 	Queue the write of the buffer being filled, and an fsync if enough
+** 	has been written since the last one.
+**
+** Parameters:
+** 	us		- The sink.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+lt_uring_flush(LT_URING_SINK *us)
+{
+	LT_URING_BUF	*buf;
+
+	if (us->cur < 0)
+	{
+		return;
+	}
+	buf = &us->bufs[us->cur];
+	if (buf->len > 0)
+	{
+		buf->offset = us->offset;
+		buf->done = 0;
+		buf->busy = CS_TRUE;
+		us->offset += buf->len;
+		us->unsynced += buf->len;
+		us->inflight++;
+		lt_uring_submit(us, us->cur);
+		us->cur = -1;
+	}
+	if (us->unsynced >= us->syncbytes && !us->syncing)
+	{
+		lt_uring_fsync(us);
+	}
+}
+
+/*
+** lt_uring_put()
+**
+** Type of function:
+** 	io_uring sink internal api
+**
+** Purpose:
+** 	Copy bytes into the buffers, queueing each one as it fills up and
+** 	waiting for a free one when all of them are in flight.
+**
+** Parameters:
+** 	us		- The sink.
+** 	data		- The bytes.
+** 	len		- Their number.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a write failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_uring_put(LT_URING_SINK *us, CS_BYTE *data, CS_INT len)
+{
+	LT_URING_BUF	*buf;
+	CS_INT		n;
+	CS_INT		i;
+
+	while (len > 0)
+	{
+		while (us->cur < 0)
+		{
+			for (i = 0; i < LT_URING_NBUFS && us->bufs[i].busy; i++)
+			{
+				;
+			}
+			if (i < LT_URING_NBUFS)
+			{
+				us->cur = i;
+				us->bufs[i].len = 0;
+			}
+			else if (lt_uring_enter(us, CS_TRUE) != CS_SUCCEED ||
+				 us->error != 0)
+			{
+				return CS_FAIL;
+			}
+		}
+
+		buf = &us->bufs[us->cur];
+		n = us->bufsize - buf->len;
+		n = (len < n) ? len : n;
+		memcpy(buf->data + buf->len, data, n);
+		buf->len += n;
+		data += n;
+		len -= n;
+		if (buf->len == us->bufsize)
+		{
+			lt_uring_flush(us);
+		}
+	}
+	return CS_SUCCEED;
+}
+
+/*****************************************************************************
+**
+** sink functions
+**
+*****************************************************************************/
+
+/*
+** lt_uring_failed()
+**
+** Type of function:
+** 	io_uring sink internal api
+**
+** Purpose:
+** 	Report the first failed operation of the sink.
+**
+** Parameters:
+** 	us		- The sink.
+**
+** Returns:
+** 	CS_FAIL.
+*/
+
+CS_STATIC CS_RETCODE
+lt_uring_failed(LT_URING_SINK *us)
+{
+	CS_CHAR		msg[EX_MAXSTRINGLEN];
+
+	sprintf(msg, "lt_uring: writing the batch file failed: %s",
+		strerror(us->error));
+	ex_error(msg);
+	return CS_FAIL;
+}
+
+/*
+** lt_uring_poll()
+**
+** Type of function:
+** 	io_uring sink internal api
+**
+** Purpose:
+** 	Handle the completions there are and, when no write is in flight,
+** 	queue the partly filled buffer.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a write failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_uring_poll(LT_SINK *sink)
+{
+	LT_URING_SINK	*us = (LT_URING_SINK *)sink->ctx;
+
+	if (lt_uring_enter(us, CS_FALSE) == CS_SUCCEED && us->inflight == 0)
+	{
+		lt_uring_flush(us);
+		lt_uring_enter(us, CS_FALSE);
+	}
+	return (us->error != 0) ? lt_uring_failed(us) : CS_SUCCEED;
+}
+
+/*
+** lt_uring_write()
+**
+** Type of function:
+** 	io_uring sink internal api
+**
+** Purpose:
+** 	Copy a batch into the buffers and queue those that are ready.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	batch		- The batch to write.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a realloc failed, or CS_FAIL if a
+** 	write failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_uring_write(LT_SINK *sink, LT_BATCH *batch)
+{
+	LT_URING_SINK	*us = (LT_URING_SINK *)sink->ctx;
+	CS_RETCODE	retcode;
+
+	us->header.len = 0;
+	if ((retcode = lt_sink_encode(&us->header, batch)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	if (us->error == 0 &&
+	    lt_uring_put(us, us->header.data, us->header.len) == CS_SUCCEED)
+	{
+		lt_uring_put(us, batch->changes.data, batch->changes.len);
+	}
+	if (us->error != 0)
+	{
+		return lt_uring_failed(us);
+	}
+	return lt_uring_poll(sink);
+}
+
+/*
+** lt_uring_sync()
+**
+** Type of function:
+** 	io_uring sink internal api
+**
+** Purpose:
+** 	Write out the buffers and wait until the file is on disk.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a write or fsync failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_uring_sync(LT_SINK *sink)
+{
+	LT_URING_SINK	*us = (LT_URING_SINK *)sink->ctx;
+
+	lt_uring_flush(us);
+	while (us->error == 0 && (us->inflight > 0 || us->synced < us->offset))
+	{
+		if (!us->syncing && us->synced < us->offset)
+		{
+			lt_uring_fsync(us);
+		}
+		if (lt_uring_enter(us, CS_TRUE) != CS_SUCCEED)
+		{
+			break;
+		}
+	}
+	return (us->error != 0) ? lt_uring_failed(us) : CS_SUCCEED;
+}
+
+/*
+** lt_uring_free()
+**
+** Type of function:
+** 	io_uring sink internal api
+**
+** Purpose:
+** 	Tear down the ring, close the file and free the sink.
+**
+** Parameters:
+** 	us		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if closing the file failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_uring_free(LT_URING_SINK *us)
+{
+	CS_RETCODE	retcode = CS_SUCCEED;
+	CS_INT		i;
+
+	if (us->sqes != NULL)
+	{
+		munmap(us->sqes, us->sqeslen);
+	}
+	if (us->cqmap != NULL && us->cqmap != us->sqmap)
+	{
+		munmap(us->cqmap, us->cqmaplen);
+	}
+	if (us->sqmap != NULL)
+	{
+		munmap(us->sqmap, us->sqmaplen);
+	}
+	if (us->ring >= 0)
+	{
+		close(us->ring);
+	}
+	if (us->fd >= 0)
+	{
+		lt_durable_untrack(us->fd);
+	}
+	if (us->fd >= 0 && close(us->fd) != 0)
+	{
+		ex_error("lt_uring_free: close() failed");
+		retcode = CS_FAIL;
+	}
+	for (i = 0; i < LT_URING_NBUFS; i++)
+	{
+		free(us->bufs[i].data);
+	}
+	lt_buf_free(&us->header);
+	free(us);
+	return retcode;
+}
+
+/*
+** lt_uring_close()
+**
+** Type of function:
+** 	io_uring sink internal api
+**
+** Purpose:
+** 	Write out and sync the file, then free the sink.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a write, fsync or close failed.
+*/
+
+CS_STATIC CS_RETCODE
+lt_uring_close(LT_SINK *sink)
+{
+	LT_URING_SINK	*us = (LT_URING_SINK *)sink->ctx;
+	CS_RETCODE	retcode;
+
+	retcode = lt_uring_sync(sink);
+
+	/*
+	** Nothing may still be in flight into the buffers once they are
+	** freed, even after a failure.
+	*/
+	while (us->inflight > 0 || us->syncing)
+	{
+		if (lt_uring_enter(us, CS_TRUE) != CS_SUCCEED)
+		{
+			break;
+		}
+	}
+	if (lt_uring_free(us) != CS_SUCCEED)
+	{
+		retcode = CS_FAIL;
+	}
+	return retcode;
+}
+
+/*
+** lt_uring_open()
+**
+** Type of function:
+** 	io_uring sink api
+**
+** Purpose:
+** 	Open an io_uring sink appending to a batch file.
+**
+** Parameters:
+** 	path		- Path of the file.
+** 	bufsize		- Size of each registered buffer, rounded up to
+** 			  LT_URING_ALIGN.
+** 	syncbytes	- Bytes written between fsyncs.
+** 	sink		- Set to the new sink.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a malloc failed, or CS_FAIL if the file
+** 	could not be opened or io_uring is not available.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_uring_open(CS_CHAR *path, CS_INT bufsize, CS_INT syncbytes, LT_SINK **sink)
+{
+	LT_URING_SINK	*us;
+	struct iovec	iov[LT_URING_NBUFS];
+	CS_INT		i;
+
+	us = (LT_URING_SINK *)calloc(1, sizeof (LT_URING_SINK));
+	if (us == NULL)
+	{
+		ex_error("lt_uring_open: calloc() failed");
+		return CS_MEM_ERROR;
+	}
+	us->ring = -1;
+	us->cur = -1;
+	us->bufsize = (bufsize + LT_URING_ALIGN - 1) & ~(LT_URING_ALIGN - 1);
+	us->syncbytes = syncbytes;
+
+	us->fd = open(path, O_WRONLY | O_CREAT, 0644);
+	if (us->fd < 0 || (us->offset = lseek(us->fd, 0, SEEK_END)) < 0)
+	{
+		ex_error("lt_uring_open: open() failed");
+		lt_uring_free(us);
+		return CS_FAIL;
+	}
+	if (lt_durable_track(us->fd) != CS_SUCCEED)
+	{
+		lt_uring_free(us);
+		return CS_FAIL;
+	}
+	us->synced = us->offset;
+
+	for (i = 0; i < LT_URING_NBUFS; i++)
+	{
+		if (posix_memalign((void **)&us->bufs[i].data, LT_URING_ALIGN,
+				   us->bufsize) != 0)
+		{
+			us->bufs[i].data = NULL;
+			ex_error("lt_uring_open: posix_memalign() failed");
+			lt_uring_free(us);
+			return CS_MEM_ERROR;
+		}
+		iov[i].iov_base = us->bufs[i].data;
+		iov[i].iov_len = us->bufsize;
+	}
+
+	if (lt_uring_setup(us) != CS_SUCCEED)
+	{
+		lt_uring_free(us);
+		return CS_FAIL;
+	}
+	if (syscall(__NR_io_uring_register, us->ring, IORING_REGISTER_BUFFERS,
+		    iov, LT_URING_NBUFS) < 0)
+	{
+		ex_error("lt_uring_open: registering the buffers failed");
+		lt_uring_free(us);
+		return CS_FAIL;
+	}
+
+	us->sink.name = "uring";
+	us->sink.write = lt_uring_write;
+	us->sink.close = lt_uring_close;
+	us->sink.poll = lt_uring_poll;
+	us->sink.sync = lt_uring_sync;
+	us->sink.ctx = us;
+	*sink = &us->sink;
+	return CS_SUCCEED;
+}
@@ -0,0 +1,59 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	io_uring batch file sink in lturing.c.
+**
+*/
+
+#ifndef __LTURING_H__
+#define __LTURING_H__
+
+#include "ltbatch.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** Number of registered buffers, and of submission queue entries: one
+** write per buffer and one fsync at most are in flight at a time.
+*/
+#define LT_URING_NBUFS		8
+#define LT_URING_ENTRIES	16
+
+/*
+** Buffer alignment, and the granularity of the buffer size.
+*/
+#define LT_URING_ALIGN		4096
+
+/*
+** A registered buffer. While it is being filled 'len' bytes of it are
+** used; once submitted, 'done' of them have been written at file offset
+** 'offset'.
+*/
+typedef struct _lt_uring_buf
+{
+	CS_BYTE		*data;
+	CS_INT		len;
+	CS_INT		done;
+	CS_BIGINT	offset;
+	CS_BOOL		busy;
+} LT_URING_BUF;
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* lturing.c */
+extern CS_RETCODE CS_PUBLIC lt_uring_open(
+	CS_CHAR *path,
+	CS_INT bufsize,
+	CS_INT syncbytes,
+	LT_SINK **sink
+	);
+
+#endif /* __LTURING_H__ */
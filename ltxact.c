@@ -0,0 +1,890 @@
+/*
+** Description
+** -----------
+** 	This file keeps track of the transactions seen by the log scan that
+** 	have begun but not yet ended.
+**
+** 	Open transactions are held in an AVL tree ordered by the position of
+** 	their BEGINXACT record, so that both the BEGINXACT and the ENDXACT of
+** 	a transaction cost O(log n). They are also linked in the order the
+** 	scan saw them begin, which is log order even once the log wraps
+** 	onto pages freed by truncation and page ids no longer increase. A
+** 	transaction whose BEGINXACT the scan did not see began before every
+** 	one whose BEGINXACT it did, and is placed ahead of them. The
+** 	first in that order is the oldest open transaction: the point before
+** 	which the log may safely be truncated, and from which a restart must
+** 	rescan. It is republished as the low-water mark after every change
+** 	to the index.
+**
+** 	Each open transaction also buffers the row changes it has made, so
+** 	that they can be released together when the transaction ends and
+** 	checkpointed while it is still in flight. The buffered changes are
+** 	indexed by position and offset, and savepoints are kept as marks into
+** 	the buffer, so that a compensation record or a rollback to a
+** 	savepoint discards only the changes made after it, by truncating the
+** 	buffer without decoding it.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltxact.h"
+
+/*****************************************************************************
+**
+** tree functions
+**
+*****************************************************************************/
+
+#define LT_HEIGHT(_n)	(((_n) == NULL) ? 0 : (_n)->height)
+
+/*
+** lt_xact_cmp()
+**
+** Compare two log positions, returning <0, 0 or >0.
+*/
+CS_STATIC CS_INT
+lt_xact_cmp(LT_LOGPOS *a, LT_LOGPOS *b)
+{
+	CS_UBIGINT	ka = LT_LOGPOS_KEY(*a);
+	CS_UBIGINT	kb = LT_LOGPOS_KEY(*b);
+
+	return (ka < kb) ? -1 : (ka > kb) ? 1 : 0;
+}
+
+CS_STATIC CS_VOID
+lt_xact_fix_height(LT_XACT *node)
+{
+	node->height = MAX(LT_HEIGHT(node->left), LT_HEIGHT(node->right)) + 1;
+}
+
+CS_STATIC LT_XACT *
+lt_xact_rotate_right(LT_XACT *node)
+{
+	LT_XACT		*pivot = node->left;
+
+	node->left = pivot->right;
+	pivot->right = node;
+	lt_xact_fix_height(node);
+	lt_xact_fix_height(pivot);
+	return pivot;
+}
+
+CS_STATIC LT_XACT *
+lt_xact_rotate_left(LT_XACT *node)
+{
+	LT_XACT		*pivot = node->right;
+
+	node->right = pivot->left;
+	pivot->left = node;
+	lt_xact_fix_height(node);
+	lt_xact_fix_height(pivot);
+	return pivot;
+}
+
+/*
+** lt_xact_balance()
+**
+** Restore the AVL invariant at 'node' after one of its subtrees changed
+** height by one. Returns the new root of the subtree.
+*/
+CS_STATIC LT_XACT *
+lt_xact_balance(LT_XACT *node)
+{
+	CS_INT		skew;
+
+	lt_xact_fix_height(node);
+	skew = LT_HEIGHT(node->left) - LT_HEIGHT(node->right);
+
+	if (skew > 1)
+	{
+		if (LT_HEIGHT(node->left->left) < LT_HEIGHT(node->left->right))
+		{
+			node->left = lt_xact_rotate_left(node->left);
+		}
+		return lt_xact_rotate_right(node);
+	}
+	if (skew < -1)
+	{
+		if (LT_HEIGHT(node->right->right) < LT_HEIGHT(node->right->left))
+		{
+			node->right = lt_xact_rotate_right(node->right);
+		}
+		return lt_xact_rotate_left(node);
+	}
+	return node;
+}
+
+CS_STATIC LT_XACT *
+lt_xact_insert(LT_XACT *node, LT_XACT *xact)
+{
+	if (node == NULL)
+	{
+		return xact;
+	}
+	if (lt_xact_cmp(&xact->begin, &node->begin) < 0)
+	{
+		node->left = lt_xact_insert(node->left, xact);
+	}
+	else
+	{
+		node->right = lt_xact_insert(node->right, xact);
+	}
+	return lt_xact_balance(node);
+}
+
+/*
+** lt_xact_unlink_min()
+**
+** Detach the leftmost node of the subtree at 'node' into '*min'.
+*/
+CS_STATIC LT_XACT *
+lt_xact_unlink_min(LT_XACT *node, LT_XACT **min)
+{
+	if (node->left == NULL)
+	{
+		*min = node;
+		return node->right;
+	}
+	node->left = lt_xact_unlink_min(node->left, min);
+	return lt_xact_balance(node);
+}
+
+/*
+** lt_xact_remove()
+**
+** Detach the node positioned at 'begin' into '*found', leaving '*found'
+** untouched if there is none.
+*/
+CS_STATIC LT_XACT *
+lt_xact_remove(LT_XACT *node, LT_LOGPOS *begin, LT_XACT **found)
+{
+	CS_INT		cmp;
+	LT_XACT		*min;
+
+	if (node == NULL)
+	{
+		return NULL;
+	}
+
+	cmp = lt_xact_cmp(begin, &node->begin);
+	if (cmp < 0)
+	{
+		node->left = lt_xact_remove(node->left, begin, found);
+	}
+	else if (cmp > 0)
+	{
+		node->right = lt_xact_remove(node->right, begin, found);
+	}
+	else
+	{
+		*found = node;
+		if (node->right == NULL)
+		{
+			return node->left;
+		}
+		node->right = lt_xact_unlink_min(node->right, &min);
+		min->left = node->left;
+		min->right = node->right;
+		node = min;
+	}
+	return lt_xact_balance(node);
+}
+
+CS_STATIC CS_VOID
+lt_xact_free_tree(LT_XACT *node)
+{
+	if (node != NULL)
+	{
+		lt_xact_free_tree(node->left);
+		lt_xact_free_tree(node->right);
+		lt_xact_free(node);
+	}
+}
+
+/*
+** lt_xact_replayed()
+**
+** While a transaction is marked restored, records at or before 'last' are
+** replays of what the checkpoint already holds. The first record past it
+** ends the replay. Positions are compared in scan order from the
+** BEGINXACT.
+*/
+CS_STATIC CS_BOOL
+lt_xact_replayed(LT_XACT *xact, CS_UBIGINT pos)
+{
+	CS_UBIGINT	base = LT_LOGPOS_KEY(xact->begin);
+
+	if (xact->restored)
+	{
+		if (LT_LOGPOS_SCAN(pos, base) <=
+		    LT_LOGPOS_SCAN(LT_LOGPOS_KEY(xact->last), base))
+		{
+			return CS_TRUE;
+		}
+		xact->restored = CS_FALSE;
+	}
+	return CS_FALSE;
+}
+
+/*
+** lt_xact_publish()
+**
+** Publish the position of the first transaction in scan order as the
+** low-water mark.
+*/
+CS_STATIC CS_VOID
+lt_xact_publish(LT_XACT_INDEX *index)
+{
+	CS_UBIGINT	key = LT_LOGPOS_NONE;
+
+	if (index->oldest != NULL)
+	{
+		key = LT_LOGPOS_KEY(index->oldest->begin);
+	}
+	atomic_store_explicit(&index->lowwater, key, memory_order_release);
+}
+
+/*
+** lt_xact_open()
+**
+** Open a transaction at 'begin', linking it into the scan order list
+** after 'older', or at its head if 'older' is NULL.
+*/
+CS_STATIC CS_RETCODE
+lt_xact_open(LT_XACT_INDEX *index, LT_LOGPOS *begin, LT_XACT *older,
+	     LT_XACT **xact)
+{
+	LT_XACT		*node;
+
+	node = (LT_XACT *)malloc(sizeof (LT_XACT));
+	if (node == NULL)
+	{
+		ex_error("lt_xact_open: malloc() failed");
+		return CS_MEM_ERROR;
+	}
+	memset(node, 0, sizeof (LT_XACT));
+	node->begin = *begin;
+	node->height = 1;
+
+	node->older = older;
+	node->newer = (older != NULL) ? older->newer : index->oldest;
+	if (node->older != NULL)
+	{
+		node->older->newer = node;
+	}
+	else
+	{
+		index->oldest = node;
+	}
+	if (node->newer != NULL)
+	{
+		node->newer->older = node;
+	}
+	else
+	{
+		index->newest = node;
+	}
+
+	index->root = lt_xact_insert(index->root, node);
+	index->count++;
+	lt_xact_publish(index);
+	*xact = node;
+	return CS_SUCCEED;
+}
+
+/*****************************************************************************
+**
+** index functions
+**
+*****************************************************************************/
+
+/*
+** lt_xact_init()
+**
+** Type of function:
+** 	open transaction index api
+**
+** Purpose:
+** 	Initialize an empty open transaction index.
+**
+** Parameters:
+** 	index		- Pointer to the index to initialize.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_xact_init(LT_XACT_INDEX *index)
+{
+	index->root = NULL;
+	index->oldest = NULL;
+	index->newest = NULL;
+	index->adopted = NULL;
+	index->count = 0;
+	atomic_init(&index->lowwater, LT_LOGPOS_NONE);
+}
+
+/*
+** lt_xact_begin()
+**
+** Type of function:
+** 	open transaction index api
+**
+** Purpose:
+** 	Record a BEGINXACT, as the newest open transaction in scan order. A
+** 	transaction that is already open is returned as is, since a rescan
+** 	after a restart replays BEGINXACTs.
+**
+** Parameters:
+** 	index		- Pointer to the open transaction index.
+** 	begin		- Position of the BEGINXACT record.
+** 	xact		- Set to the open transaction. May be NULL.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a malloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_xact_begin(LT_XACT_INDEX *index, LT_LOGPOS *begin, LT_XACT **xact)
+{
+	LT_XACT		*node;
+	CS_RETCODE	retcode;
+
+	if ((node = lt_xact_find(index, begin)) == NULL &&
+	    (retcode = lt_xact_open(index, begin, index->newest,
+				    &node)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	if (xact != NULL)
+	{
+		*xact = node;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_xact_adopt()
+**
+** Type of function:
+** 	open transaction index api
+**
+** Purpose:
+** 	Record a transaction first seen through a record other than its
+** 	BEGINXACT. It began before the scan did, so it is older than every
+** 	transaction whose BEGINXACT the scan saw, and goes ahead of them in
+** 	scan order, after the ones adopted before it. A transaction that is
+** 	already open is returned as is.
+**
+** Parameters:
+** 	index		- Pointer to the open transaction index.
+** 	begin		- Position of the transaction's BEGINXACT record.
+** 	xact		- Set to the open transaction. May be NULL.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a malloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_xact_adopt(LT_XACT_INDEX *index, LT_LOGPOS *begin, LT_XACT **xact)
+{
+	LT_XACT		*node;
+	CS_RETCODE	retcode;
+
+	if ((node = lt_xact_find(index, begin)) == NULL)
+	{
+		if ((retcode = lt_xact_open(index, begin, index->adopted,
+					    &node)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+		index->adopted = node;
+	}
+
+	if (xact != NULL)
+	{
+		*xact = node;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_xact_find()
+**
+** Type of function:
+** 	open transaction index api
+**
+** Purpose:
+** 	Look up an open transaction by the position of its BEGINXACT.
+**
+** Parameters:
+** 	index		- Pointer to the open transaction index.
+** 	begin		- Position of the BEGINXACT record.
+**
+** Returns:
+** 	The open transaction, or NULL if it is not open.
+*/
+
+LT_XACT * CS_PUBLIC
+lt_xact_find(LT_XACT_INDEX *index, LT_LOGPOS *begin)
+{
+	LT_XACT		*node = index->root;
+	CS_INT		cmp;
+
+	while (node != NULL)
+	{
+		cmp = lt_xact_cmp(begin, &node->begin);
+		if (cmp == 0)
+		{
+			break;
+		}
+		node = (cmp < 0) ? node->left : node->right;
+	}
+	return node;
+}
+
+/*
+** lt_xact_add_ref()
+**
+** Index a change at 'offset' in the change buffer as the newest one.
+*/
+CS_STATIC CS_RETCODE
+lt_xact_add_ref(LT_XACT *xact, CS_UBIGINT pos, CS_INT offset)
+{
+	LT_XACT_REF	*refs;
+	CS_INT		size;
+
+	if (xact->nchanges == xact->maxrefs)
+	{
+		size = (xact->maxrefs == 0) ? 16 : xact->maxrefs * 2;
+		refs = (LT_XACT_REF *)realloc(xact->refs,
+			size * sizeof (LT_XACT_REF));
+		if (refs == NULL)
+		{
+			ex_error("lt_xact_add_ref: realloc() failed");
+			return CS_MEM_ERROR;
+		}
+		xact->refs = refs;
+		xact->maxrefs = size;
+	}
+	xact->refs[xact->nchanges].pos = pos;
+	xact->refs[xact->nchanges].offset = offset;
+	xact->nchanges++;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_xact_append()
+**
+** Type of function:
+** 	open transaction index api
+**
+** Purpose:
+** 	Buffer a row change made by an open transaction. Changes replayed
+** 	into a restored transaction are dropped.
+**
+** Parameters:
+** 	xact		- The open transaction.
+** 	change		- The change to buffer.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_xact_append(LT_XACT *xact, LT_CHANGE *change)
+{
+	CS_RETCODE	retcode;
+	CS_INT		offset = xact->changes.len;
+
+	if (lt_xact_replayed(xact, change->pos))
+	{
+		return CS_SUCCEED;
+	}
+
+	if ((retcode = lt_change_encode(&xact->changes, change)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	retcode = lt_xact_add_ref(xact, change->pos, offset);
+	if (retcode != CS_SUCCEED)
+	{
+		xact->changes.len = offset;
+		return retcode;
+	}
+	xact->last.page = LT_LOGPOS_PAGE(change->pos);
+	xact->last.row = LT_LOGPOS_ROW(change->pos);
+	return CS_SUCCEED;
+}
+
+/*
+** lt_xact_reindex()
+**
+** Type of function:
+** 	open transaction index api
+**
+** Purpose:
+** 	Rebuild the index of a transaction's buffered changes after the
+** 	change buffer and 'nchanges' were filled in directly, as when a
+** 	checkpoint is loaded.
+**
+** Parameters:
+** 	xact		- The open transaction.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR if a realloc failed, or CS_FAIL if the
+** 	buffer does not hold 'nchanges' whole changes.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_xact_reindex(LT_XACT *xact)
+{
+	CS_RETCODE	retcode;
+	CS_UBIGINT	changepos;
+	CS_INT		nchanges = xact->nchanges;
+	CS_INT		offset = 0;
+	CS_INT		reclen;
+
+	xact->nchanges = 0;
+	while (offset < xact->changes.len)
+	{
+		reclen = lt_change_position(xact->changes.data + offset,
+			xact->changes.len - offset, &changepos);
+		if (reclen == 0)
+		{
+			break;
+		}
+		retcode = lt_xact_add_ref(xact, changepos, offset);
+		if (retcode != CS_SUCCEED)
+		{
+			return retcode;
+		}
+		offset += reclen;
+	}
+
+	if (offset != xact->changes.len || xact->nchanges != nchanges)
+	{
+		ex_error("lt_xact_reindex: change buffer is corrupt");
+		return CS_FAIL;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_xact_savepoint()
+**
+** Type of function:
+** 	open transaction index api
+**
+** Purpose:
+** 	Take a savepoint mark at the current end of the change buffer.
+**
+** Parameters:
+** 	xact		- The open transaction.
+** 	pos		- Position of the last log record processed before
+** 			  the savepoint.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_xact_savepoint(LT_XACT *xact, LT_LOGPOS *pos)
+{
+	LT_SAVEPT	*savepts;
+	LT_SAVEPT	*mark;
+	CS_INT		size;
+
+	if (lt_xact_replayed(xact, LT_LOGPOS_KEY(*pos)))
+	{
+		return CS_SUCCEED;
+	}
+
+	if (xact->nsavepts == xact->maxsavepts)
+	{
+		size = (xact->maxsavepts == 0) ? 4 : xact->maxsavepts * 2;
+		savepts = (LT_SAVEPT *)realloc(xact->savepts,
+			size * sizeof (LT_SAVEPT));
+		if (savepts == NULL)
+		{
+			ex_error("lt_xact_savepoint: realloc() failed");
+			return CS_MEM_ERROR;
+		}
+		xact->savepts = savepts;
+		xact->maxsavepts = size;
+	}
+
+	mark = &xact->savepts[xact->nsavepts++];
+	mark->pos = LT_LOGPOS_KEY(*pos);
+	mark->offset = xact->changes.len;
+	mark->nchanges = xact->nchanges;
+	return CS_SUCCEED;
+}
+
+/*
+** lt_xact_rollback()
+**
+** Type of function:
+** 	open transaction index api
+**
+** Purpose:
+** 	Apply a compensation log record, discarding the buffered change it
+** 	undoes and every change after it: the buffer is truncated at the
+** 	first change at or past the undone record. Marks taken after the
+** 	undone record are popped, and changes buffered before the newest
+** 	remaining one are kept. The search walks the change index back
+** 	from the newest change, so a record compensating the newest change,
+** 	as rollbacks do, costs O(1). Each mark is popped at most once.
+** 	Positions are compared in scan order from the BEGINXACT, which
+** 	holds once the log wraps during the transaction.
+**
+** Parameters:
+** 	xact		- The open transaction.
+** 	pos		- Position of the compensation log record.
+** 	undone		- Position of the record being compensated.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_xact_rollback(LT_XACT *xact, LT_LOGPOS *pos, LT_LOGPOS *undone)
+{
+	CS_UBIGINT	base = LT_LOGPOS_KEY(xact->begin);
+	CS_UBIGINT	key = LT_LOGPOS_SCAN(LT_LOGPOS_KEY(*undone), base);
+	LT_SAVEPT	*mark;
+	CS_INT		first;
+	CS_INT		n;
+
+	if (lt_xact_replayed(xact, LT_LOGPOS_KEY(*pos)))
+	{
+		return;
+	}
+
+	while (xact->nsavepts > 0)
+	{
+		mark = &xact->savepts[xact->nsavepts - 1];
+		if (LT_LOGPOS_SCAN(mark->pos, base) < key)
+		{
+			break;
+		}
+		xact->nsavepts--;
+	}
+	first = (xact->nsavepts > 0) ?
+		xact->savepts[xact->nsavepts - 1].nchanges : 0;
+
+	n = xact->nchanges;
+	while (n > first && LT_LOGPOS_SCAN(xact->refs[n - 1].pos, base) >= key)
+	{
+		n--;
+	}
+
+	if (n < xact->nchanges)
+	{
+		xact->changes.len = xact->refs[n].offset;
+		xact->nchanges = n;
+		if (n > 0)
+		{
+			xact->last.page = LT_LOGPOS_PAGE(xact->refs[n - 1].pos);
+			xact->last.row = LT_LOGPOS_ROW(xact->refs[n - 1].pos);
+		}
+		else
+		{
+			memset(&xact->last, 0, sizeof (xact->last));
+		}
+	}
+}
+
+/*
+** lt_xact_end()
+**
+** Type of function:
+** 	open transaction index api
+**
+** Purpose:
+** 	Record an ENDXACT, removing the transaction from the index. An
+** 	ENDXACT for a transaction whose BEGINXACT was not seen (it began
+** 	before the scan did) is ignored.
+**
+** Parameters:
+** 	index		- Pointer to the open transaction index.
+** 	begin		- Position of the transaction's BEGINXACT record.
+** 	xact		- Set to the removed transaction, or NULL if it was
+** 			  not open. The caller frees it with lt_xact_free().
+** 			  If 'xact' is NULL the transaction is freed here.
+**
+** Returns:
+** 	CS_SUCCEED
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_xact_end(LT_XACT_INDEX *index, LT_LOGPOS *begin, LT_XACT **xact)
+{
+	LT_XACT		*found = NULL;
+
+	index->root = lt_xact_remove(index->root, begin, &found);
+	if (found != NULL)
+	{
+		found->left = NULL;
+		found->right = NULL;
+		if (found == index->adopted)
+		{
+			index->adopted = found->older;
+		}
+		if (found->older != NULL)
+		{
+			found->older->newer = found->newer;
+		}
+		else
+		{
+			index->oldest = found->newer;
+		}
+		if (found->newer != NULL)
+		{
+			found->newer->older = found->older;
+		}
+		else
+		{
+			index->newest = found->older;
+		}
+		found->older = NULL;
+		found->newer = NULL;
+		index->count--;
+		lt_xact_publish(index);
+	}
+
+	if (xact != NULL)
+	{
+		*xact = found;
+	}
+	else if (found != NULL)
+	{
+		lt_xact_free(found);
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_xact_free()
+**
+** Type of function:
+** 	open transaction index api
+**
+** Purpose:
+** 	Free a transaction removed from the index and its buffered changes.
+**
+** Parameters:
+** 	xact		- The transaction.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_xact_free(LT_XACT *xact)
+{
+	lt_buf_free(&xact->changes);
+	free(xact->refs);
+	free(xact->savepts);
+	free(xact);
+}
+
+/*
+** lt_xact_walk()
+**
+** Type of function:
+** 	open transaction index api
+**
+** Purpose:
+** 	Call 'func' for every open transaction, oldest first in scan order,
+** 	stopping at the first call that does not succeed.
+**
+** Parameters:
+** 	index		- Pointer to the open transaction index.
+** 	func		- Function to call.
+** 	arg		- Passed through to 'func'.
+**
+** Returns:
+** 	CS_SUCCEED, or the first failure returned by 'func'.
+*/
+
+CS_RETCODE CS_PUBLIC
+lt_xact_walk(LT_XACT_INDEX *index, CS_RETCODE (*func)(LT_XACT *xact, CS_VOID *arg),
+	     CS_VOID *arg)
+{
+	LT_XACT		*node;
+	CS_RETCODE	retcode;
+
+	for (node = index->oldest; node != NULL; node = node->newer)
+	{
+		if ((retcode = (*func)(node, arg)) != CS_SUCCEED)
+		{
+			return retcode;
+		}
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** lt_xact_lowwater()
+**
+** Type of function:
+** 	open transaction index api
+**
+** Purpose:
+** 	Read the position of the oldest open transaction. Safe to call from
+** 	any thread; no lock is taken.
+**
+** Parameters:
+** 	index		- Pointer to the open transaction index.
+** 	pos		- Set to the BEGINXACT position of the oldest open
+** 			  transaction, if there is one.
+**
+** Returns:
+** 	CS_TRUE if a transaction is open, CS_FALSE otherwise.
+*/
+
+CS_BOOL CS_PUBLIC
+lt_xact_lowwater(LT_XACT_INDEX *index, LT_LOGPOS *pos)
+{
+	CS_UBIGINT	key;
+
+	key = atomic_load_explicit(&index->lowwater, memory_order_acquire);
+	if (key == LT_LOGPOS_NONE)
+	{
+		return CS_FALSE;
+	}
+	pos->page = LT_LOGPOS_PAGE(key);
+	pos->row = LT_LOGPOS_ROW(key);
+	return CS_TRUE;
+}
+
+/*
+** lt_xact_cleanup()
+**
+** Type of function:
+** 	open transaction index api
+**
+** Purpose:
+** 	Free every transaction still held in the index.
+**
+** Parameters:
+** 	index		- Pointer to the open transaction index.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+lt_xact_cleanup(LT_XACT_INDEX *index)
+{
+	lt_xact_free_tree(index->root);
+	lt_xact_init(index);
+}
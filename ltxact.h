@@ -0,0 +1,192 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	open transaction tracking and assembly in ltxact.c.
+**
+*/
+
+#ifndef __LTXACT_H__
+#define __LTXACT_H__
+
+#include <stdatomic.h>
+#include "ltchange.h"
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** Position of a log record as reported by `dbcc logtransfer`: the log page
+** and the record number on that page. A transaction is identified by the
+** position of its BEGINXACT record, which is what the "sessionid page" and
+** "sessionid record" columns of every record in the transaction carry.
+*/
+typedef struct _lt_logpos
+{
+	CS_UINT		page;
+	CS_UINT		row;
+} LT_LOGPOS;
+
+/*
+** Pack a position into a single ordered 64 bit key, and back.
+*/
+#define LT_LOGPOS_KEY(_p)	(((CS_UBIGINT)(_p).page << 32) | (CS_UBIGINT)(_p).row)
+#define LT_LOGPOS_PAGE(_k)	((CS_UINT)((_k) >> 32))
+#define LT_LOGPOS_ROW(_k)	((CS_UINT)((_k) & 0xffffffff))
+
+/*
+** Map a key to its place in scan order as seen from 'base', a key at or
+** before it in the log. Page ids grow along the log until it wraps onto
+** pages freed by truncation: a key below 'base' was reached after the
+** wrap, and maps past every key at or above it. The log is never freed
+** ahead of the oldest transaction it still holds, so the span compared
+** holds no position twice.
+*/
+#define LT_LOGPOS_SCAN(_k, _base)	((CS_UBIGINT)(_k) - (CS_UBIGINT)(_base))
+
+/*
+** Key published as the low-water mark when no transaction is open.
+*/
+#define LT_LOGPOS_NONE		(~(CS_UBIGINT)0)
+
+/*
+** A savepoint mark: the length of the transaction's change buffer when the
+** savepoint was taken, and 'pos', the position of the last log record
+** processed before it. Rolling back to the savepoint truncates the buffer
+** back to 'offset'.
+*/
+typedef struct _lt_savept
+{
+	CS_UBIGINT		pos;
+	CS_INT			offset;
+	CS_INT			nchanges;
+} LT_SAVEPT;
+
+/*
+** A buffered change, as indexed by its transaction: the position of its
+** log record and its offset in the change buffer.
+*/
+typedef struct _lt_xact_ref
+{
+	CS_UBIGINT		pos;
+	CS_INT			offset;
+} LT_XACT_REF;
+
+/*
+** One open transaction. Nodes are kept in an AVL tree ordered by the
+** position of the BEGINXACT record, and linked by 'older' and 'newer' in
+** the order the scan saw their BEGINXACTs.
+**
+** 'changes' holds the row changes made so far, encoded by ltchange.c, 'refs'
+** indexes them, one entry per change, and 'last' is the position of the
+** newest of them. 'restored' is set while the transaction holds changes
+** reloaded from a checkpoint that the rescan has not yet caught up with;
+** 'last' is then the checkpointed scan position. 'savepts' is the stack of
+** savepoint marks taken, newest last. 'userid' is the id of the user name
+** from the BEGINXACT record in the name dictionary, or 0 if it was not seen.
+*/
+typedef struct _lt_xact
+{
+	LT_LOGPOS		begin;
+	LT_LOGPOS		last;
+	CS_UINT			userid;
+	CS_INT			nchanges;
+	LT_BUF			changes;
+	LT_XACT_REF		*refs;
+	CS_INT			maxrefs;
+	CS_BOOL			restored;
+	LT_SAVEPT		*savepts;
+	CS_INT			nsavepts;
+	CS_INT			maxsavepts;
+	struct _lt_xact		*left;
+	struct _lt_xact		*right;
+	CS_INT			height;
+	struct _lt_xact		*older;
+	struct _lt_xact		*newer;
+} LT_XACT;
+
+/*
+** Index of the transactions that have begun but not yet ended.
+**
+** 'oldest' and 'newest' are the ends of the list of open transactions in
+** scan order. The transactions that began before the scan did lead the
+** list, in the order the scan came upon them, and 'adopted' is the last
+** of those, or NULL. 'lowwater' holds the packed position of the oldest
+** open transaction, or LT_LOGPOS_NONE. It is written only by the scanning
+** thread and may be read from any thread through lt_xact_lowwater()
+** without taking a lock.
+*/
+typedef struct _lt_xact_index
+{
+	LT_XACT			*root;
+	LT_XACT			*oldest;
+	LT_XACT			*newest;
+	LT_XACT			*adopted;
+	CS_INT			count;
+	_Atomic CS_UBIGINT	lowwater;
+} LT_XACT_INDEX;
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* ltxact.c */
+extern CS_VOID CS_PUBLIC lt_xact_init(
+	LT_XACT_INDEX *index
+	);
+extern CS_RETCODE CS_PUBLIC lt_xact_begin(
+	LT_XACT_INDEX *index,
+	LT_LOGPOS *begin,
+	LT_XACT **xact
+	);
+extern CS_RETCODE CS_PUBLIC lt_xact_adopt(
+	LT_XACT_INDEX *index,
+	LT_LOGPOS *begin,
+	LT_XACT **xact
+	);
+extern LT_XACT * CS_PUBLIC lt_xact_find(
+	LT_XACT_INDEX *index,
+	LT_LOGPOS *begin
+	);
+extern CS_RETCODE CS_PUBLIC lt_xact_append(
+	LT_XACT *xact,
+	LT_CHANGE *change
+	);
+extern CS_RETCODE CS_PUBLIC lt_xact_reindex(
+	LT_XACT *xact
+	);
+extern CS_RETCODE CS_PUBLIC lt_xact_savepoint(
+	LT_XACT *xact,
+	LT_LOGPOS *pos
+	);
+extern CS_VOID CS_PUBLIC lt_xact_rollback(
+	LT_XACT *xact,
+	LT_LOGPOS *pos,
+	LT_LOGPOS *undone
+	);
+extern CS_RETCODE CS_PUBLIC lt_xact_end(
+	LT_XACT_INDEX *index,
+	LT_LOGPOS *begin,
+	LT_XACT **xact
+	);
+extern CS_VOID CS_PUBLIC lt_xact_free(
+	LT_XACT *xact
+	);
+extern CS_RETCODE CS_PUBLIC lt_xact_walk(
+	LT_XACT_INDEX *index,
+	CS_RETCODE (*func)(LT_XACT *xact, CS_VOID *arg),
+	CS_VOID *arg
+	);
+extern CS_BOOL CS_PUBLIC lt_xact_lowwater(
+	LT_XACT_INDEX *index,
+	LT_LOGPOS *pos
+	);
+extern CS_VOID CS_PUBLIC lt_xact_cleanup(
+	LT_XACT_INDEX *index
+	);
+
+#endif /* __LTXACT_H__ */
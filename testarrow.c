@@ -0,0 +1,805 @@
+/*
+** Description
+** -----------
+** 	Tests of the Arrow IPC stream sink of ltarrow.c. Two batches of
+** 	changes to a table are written and the stream file read back: a
+** 	schema message with the metadata and table columns, a record batch
+** 	message per batch with its row count, null counts and value
+** 	buffers, and the end of stream marker. The flatbuffer metadata is
+** 	read field by field through the vtables, as any reader would.
+**
+** 	Usage: testarrow
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltbatch.h"
+#include "ltdict.h"
+#include "ltarrow.h"
+#include "testutils.h"
+
+/*
+** Number of columns of the test table, and of its stream schema.
+*/
+#define TEST_NUMCOLS	4
+#define TEST_NFIELDS	(LT_ARROW_METACOLS + TEST_NUMCOLS)
+
+/*
+** Arrow message header and field types, as read back.
+*/
+#define TEST_MSG_SCHEMA	1
+#define TEST_MSG_BATCH	3
+#define TEST_TYPE_INT	2
+#define TEST_TYPE_FLOAT	3
+#define TEST_TYPE_UTF8	5
+#define TEST_TYPE_BOOL	6
+#define TEST_TYPE_TS	10
+
+/*
+** One encapsulated IPC message read back from a stream. 'meta' is its
+** flatbuffer, 'header' the position of the header table in it, and
+** 'body' the body following it.
+*/
+typedef struct _test_msg
+{
+	CS_BYTE		*meta;
+	CS_INT		metalen;
+	CS_INT		type;
+	CS_INT		header;
+	CS_BYTE		*body;
+	CS_BIGINT	bodylen;
+} TEST_MSG;
+
+/*
+** Ids of the names of the test table and its owner.
+*/
+CS_STATIC CS_UINT Test_table;
+CS_STATIC CS_UINT Test_owner;
+
+/*****************************************************************************
+**
+** flatbuffer reading functions
+**
+*****************************************************************************/
+
+/*
+** test_field()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Find a field of a flatbuffer table through its vtable.
+**
+** Parameters:
+** 	msg		- The message the table is in.
+** 	table		- Position of the table.
+** 	field		- Number of the field.
+**
+** Returns:
+** 	The position of the field, or 0 if it is absent or the table
+** 	does not lie within the message.
+*/
+
+CS_STATIC CS_INT
+test_field(TEST_MSG *msg, CS_INT table, CS_INT field)
+{
+	CS_INT		soff;
+	CS_INT		vt;
+	CS_USMALLINT	vtlen;
+	CS_USMALLINT	off;
+
+	if (table <= 0 || table + 4 > msg->metalen)
+	{
+		return 0;
+	}
+	memcpy(&soff, msg->meta + table, 4);
+	vt = table - soff;
+	if (vt < 0 || vt + 4 > msg->metalen)
+	{
+		return 0;
+	}
+	memcpy(&vtlen, msg->meta + vt, 2);
+	if (4 + field * 2 + 2 > vtlen || vt + vtlen > msg->metalen)
+	{
+		return 0;
+	}
+	memcpy(&off, msg->meta + vt + 4 + field * 2, 2);
+	return (off == 0) ? 0 : table + off;
+}
+
+/*
+** test_ref()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Follow an offset field of a flatbuffer table to the table, vector
+** 	or string it refers to.
+**
+** Parameters:
+** 	msg		- The message the table is in.
+** 	table		- Position of the table.
+** 	field		- Number of the field.
+**
+** Returns:
+** 	The position of the object, or 0 if the field is absent or the
+** 	object does not lie within the message.
+*/
+
+CS_STATIC CS_INT
+test_ref(TEST_MSG *msg, CS_INT table, CS_INT field)
+{
+	CS_INT		pos;
+	CS_UINT		off;
+
+	if ((pos = test_field(msg, table, field)) == 0)
+	{
+		return 0;
+	}
+	memcpy(&off, msg->meta + pos, 4);
+	if (off == 0 || pos + (CS_BIGINT)off + 4 > msg->metalen)
+	{
+		return 0;
+	}
+	return pos + off;
+}
+
+/*
+** test_scalar()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Read a scalar field of a flatbuffer table.
+**
+** Parameters:
+** 	msg		- The message the table is in.
+** 	table		- Position of the table.
+** 	field		- Number of the field.
+** 	size		- Size of the field: 1, 2, 4 or 8 bytes.
+**
+** Returns:
+** 	The value, or 0, its default, if the field is absent.
+*/
+
+CS_STATIC CS_BIGINT
+test_scalar(TEST_MSG *msg, CS_INT table, CS_INT field, CS_INT size)
+{
+	CS_INT		pos;
+	CS_BYTE		i8;
+	CS_SMALLINT	i16;
+	CS_INT		i32;
+	CS_BIGINT	i64;
+
+	if ((pos = test_field(msg, table, field)) == 0 ||
+	    pos + size > msg->metalen)
+	{
+		return 0;
+	}
+	switch (size)
+	{
+	  case 1:
+		memcpy(&i8, msg->meta + pos, 1);
+		return i8;
+	  case 2:
+		memcpy(&i16, msg->meta + pos, 2);
+		return i16;
+	  case 4:
+		memcpy(&i32, msg->meta + pos, 4);
+		return i32;
+	}
+	memcpy(&i64, msg->meta + pos, 8);
+	return i64;
+}
+
+/*
+** test_length()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Read the length of a vector or string.
+**
+** Parameters:
+** 	msg		- The message the vector is in.
+** 	vec		- Position of the vector.
+**
+** Returns:
+** 	The number of elements, or -1 if there is no vector.
+*/
+
+CS_STATIC CS_INT
+test_length(TEST_MSG *msg, CS_INT vec)
+{
+	CS_UINT		n;
+
+	if (vec == 0)
+	{
+		return -1;
+	}
+	memcpy(&n, msg->meta + vec, 4);
+	return (CS_INT)n;
+}
+
+/*
+** test_message()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Read the encapsulated IPC message at '*off' of a stream, checking
+** 	its framing, and step past it.
+**
+** Parameters:
+** 	data		- The stream.
+** 	len		- Its length.
+** 	off		- Pointer to the position of the message.
+** 	msg		- Set to the message.
+**
+** Returns:
+** 	CS_TRUE if a message was read, CS_FALSE at the end of stream
+** 	marker or if the message is malformed.
+*/
+
+CS_STATIC CS_BOOL
+test_message(CS_BYTE *data, CS_INT len, CS_INT *off, TEST_MSG *msg)
+{
+	CS_UINT		prefix[2];
+	CS_UINT		root;
+	CS_INT		table;
+
+	memset(msg, 0, sizeof (*msg));
+	if (!TEST_CHECK(*off + 8 <= len))
+	{
+		return CS_FALSE;
+	}
+	memcpy(prefix, data + *off, 8);
+	TEST_CHECK(prefix[0] == 0xffffffff);
+	if (prefix[1] == 0)
+	{
+		*off += 8;
+		return CS_FALSE;
+	}
+	if (!TEST_CHECK(prefix[1] % 8 == 0 && *off + 8 + prefix[1] <= len))
+	{
+		return CS_FALSE;
+	}
+
+	msg->meta = data + *off + 8;
+	msg->metalen = prefix[1];
+	memcpy(&root, msg->meta, 4);
+	table = (CS_INT)root;
+	TEST_CHECK(test_scalar(msg, table, 0, 2) == 4);
+	msg->type = (CS_INT)test_scalar(msg, table, 1, 1);
+	msg->header = test_ref(msg, table, 2);
+	msg->bodylen = test_scalar(msg, table, 3, 8);
+	msg->body = msg->meta + msg->metalen;
+	*off += 8 + msg->metalen;
+	if (!TEST_CHECK(msg->header != 0 && msg->bodylen % 8 == 0 &&
+			*off + msg->bodylen <= len))
+	{
+		return CS_FALSE;
+	}
+	*off += msg->bodylen;
+	return CS_TRUE;
+}
+
+/*****************************************************************************
+**
+** test functions
+**
+*****************************************************************************/
+
+/*
+** test_column()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Fill in a column of a row image.
+**
+** Parameters:
+** 	col		- The column.
+** 	name		- Its name.
+** 	datatype	- Its datatype.
+** 	value		- Its value, or NULL for a null column.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_column(LT_COLUMN *col, CS_CHAR *name, CS_INT datatype, CS_CHAR *value)
+{
+	memset(col, 0, sizeof (*col));
+	col->name = name;
+	col->namelen = strlen(name);
+	col->datatype = datatype;
+	col->indicator = (value == NULL) ? CS_NULLDATA : 0;
+	col->value = value;
+	col->valuelen = (value == NULL) ? 0 : strlen(value);
+}
+
+/*
+** test_row()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Encode a change to the test table, made by record 'row' of page 2
+** 	in the transaction begun on page 1.
+**
+** Parameters:
+** 	changes		- The buffer to encode it into.
+** 	op		- The operation.
+** 	row		- Record number.
+** 	id		- Value of the int column.
+** 	name		- Value of the varchar column, or NULL.
+** 	flag		- Value of the bit column.
+** 	amount		- Value of the float column.
+**
+** Returns:
+** 	The return code of lt_change_encode().
+*/
+
+CS_STATIC CS_RETCODE
+test_row(LT_BUF *changes, CS_INT op, CS_UINT row, CS_CHAR *id,
+	 CS_CHAR *name, CS_CHAR *flag, CS_CHAR *amount)
+{
+	LT_CHANGE	change;
+	LT_COLUMN	cols[TEST_NUMCOLS];
+
+	memset(&change, 0, sizeof (change));
+	change.op = op;
+	change.xactid = ((CS_UBIGINT)1 << 32) | 1;
+	change.pos = ((CS_UBIGINT)2 << 32) | row;
+	change.tableid = Test_table;
+	change.ownerid = Test_owner;
+	change.columns = cols;
+	change.numcols = TEST_NUMCOLS;
+	test_column(&cols[0], "id", CS_INT_TYPE, id);
+	test_column(&cols[1], "name", CS_VARCHAR_TYPE, name);
+	test_column(&cols[2], "flag", CS_BIT_TYPE, flag);
+	test_column(&cols[3], "amount", CS_FLOAT_TYPE, amount);
+	return lt_change_encode(changes, &change);
+}
+
+/*
+** test_write()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Write the changes in a buffer to a sink as one committed
+** 	transaction, and empty the buffer.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	changes		- The encoded changes.
+** 	nchanges	- Their number.
+**
+** Returns:
+** 	The return code of the sink's write().
+*/
+
+CS_STATIC CS_RETCODE
+test_write(LT_SINK *sink, LT_BUF *changes, CS_INT nchanges)
+{
+	LT_BATCH	batch;
+	LT_BATCH_XACT	bx;
+	CS_RETCODE	retcode;
+
+	memset(&bx, 0, sizeof (bx));
+	bx.xactid = ((CS_UBIGINT)1 << 32) | 1;
+	bx.commitpos = ((CS_UBIGINT)3 << 32) | 1;
+	bx.committime = 1700000000000000LL;
+	bx.len = changes->len;
+	bx.nchanges = nchanges;
+
+	memset(&batch, 0, sizeof (batch));
+	batch.changes = *changes;
+	batch.xacts = &bx;
+	batch.nxacts = 1;
+	batch.nchanges = nchanges;
+	batch.lastpos = bx.commitpos;
+	retcode = sink->write(sink, &batch);
+	changes->len = 0;
+	return retcode;
+}
+
+/*
+** test_schema()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Check the schema message of the test table's stream.
+**
+** Parameters:
+** 	msg		- The message.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_schema(TEST_MSG *msg)
+{
+	static CS_CHAR	*names[TEST_NFIELDS] = { "_op", "_xact_id",
+		"_log_pos", "_commit_time", "id", "name", "flag", "amount" };
+	static CS_INT	types[TEST_NFIELDS] = { TEST_TYPE_UTF8,
+		TEST_TYPE_INT, TEST_TYPE_INT, TEST_TYPE_TS, TEST_TYPE_INT,
+		TEST_TYPE_UTF8, TEST_TYPE_BOOL, TEST_TYPE_FLOAT };
+	CS_INT		fields;
+	CS_INT		field;
+	CS_INT		name;
+	CS_INT		type;
+	CS_UINT		off;
+	CS_INT		i;
+
+	TEST_CHECK(msg->type == TEST_MSG_SCHEMA && msg->bodylen == 0);
+	fields = test_ref(msg, msg->header, 1);
+	if (!TEST_CHECK(test_length(msg, fields) == TEST_NFIELDS))
+	{
+		return;
+	}
+	for (i = 0; i < TEST_NFIELDS; i++)
+	{
+		memcpy(&off, msg->meta + fields + 4 + i * 4, 4);
+		field = fields + 4 + i * 4 + off;
+		name = test_ref(msg, field, 0);
+		TEST_CHECK(test_length(msg, name) == (CS_INT)strlen(names[i]) &&
+			   memcmp(msg->meta + name + 4, names[i],
+				  strlen(names[i])) == 0);
+		TEST_CHECK(test_scalar(msg, field, 1, 1) == 1);
+		TEST_CHECK(test_scalar(msg, field, 2, 1) == types[i]);
+		TEST_CHECK(test_length(msg, test_ref(msg, field, 5)) == 0);
+
+		type = test_ref(msg, field, 3);
+		if (i == 1)
+		{
+			TEST_CHECK(test_scalar(msg, type, 0, 4) == 64);
+			TEST_CHECK(test_scalar(msg, type, 1, 1) == 0);
+		}
+		else if (i == 4)
+		{
+			TEST_CHECK(test_scalar(msg, type, 0, 4) == 32);
+			TEST_CHECK(test_scalar(msg, type, 1, 1) == 1);
+		}
+		else if (i == 7)
+		{
+			TEST_CHECK(test_scalar(msg, type, 0, 2) == 2);
+		}
+	}
+}
+
+/*
+** test_buffer()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Find a buffer of a record batch in its body.
+**
+** Parameters:
+** 	msg		- The record batch message.
+** 	buffers		- Position of its buffers vector.
+** 	i		- Number of the buffer.
+** 	len		- Set to the length of the buffer.
+**
+** Returns:
+** 	The start of the buffer, or NULL if it lies outside the body.
+*/
+
+CS_STATIC CS_BYTE *
+test_buffer(TEST_MSG *msg, CS_INT buffers, CS_INT i, CS_BIGINT *len)
+{
+	CS_BIGINT	buf[2];
+
+	memcpy(buf, msg->meta + buffers + 4 + i * 16, sizeof (buf));
+	*len = buf[1];
+	if (buf[0] % 8 != 0 || buf[0] + buf[1] > msg->bodylen)
+	{
+		return NULL;
+	}
+	return msg->body + buf[0];
+}
+
+/*
+** test_batch()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Check a record batch message: its row count, the null counts of
+** 	the columns, and the values of the id, name and amount columns.
+**
+** Parameters:
+** 	msg		- The message.
+** 	nrows		- Number of rows expected.
+** 	ids		- The ids expected.
+** 	names		- The names expected, NULL for a null.
+** 	amounts		- The amounts expected.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_batch(TEST_MSG *msg, CS_INT nrows, CS_INT ids[], CS_CHAR *names[],
+	   CS_FLOAT amounts[])
+{
+	CS_INT		nodes;
+	CS_INT		buffers;
+	CS_BIGINT	node[2];
+	CS_BIGINT	len;
+	CS_BIGINT	vlen;
+	CS_BYTE		*validity;
+	CS_BYTE		*offsets;
+	CS_BYTE		*values;
+	CS_INT		nulls = 0;
+	CS_INT		off[2];
+	CS_INT		i32;
+	CS_FLOAT	f64;
+	CS_INT		n;
+	CS_INT		i;
+
+	TEST_CHECK(msg->type == TEST_MSG_BATCH);
+	TEST_CHECK(test_scalar(msg, msg->header, 0, 8) == nrows);
+	nodes = test_ref(msg, msg->header, 1);
+	buffers = test_ref(msg, msg->header, 2);
+	if (!TEST_CHECK(test_length(msg, nodes) == TEST_NFIELDS) ||
+	    !TEST_CHECK(test_length(msg, buffers) == TEST_NFIELDS * 2 + 2))
+	{
+		return;
+	}
+
+	for (i = 0; i < nrows; i++)
+	{
+		nulls += (names[i] == NULL);
+	}
+	for (i = 0; i < TEST_NFIELDS; i++)
+	{
+		memcpy(node, msg->meta + nodes + 4 + i * 16, sizeof (node));
+		TEST_CHECK(node[0] == nrows);
+		TEST_CHECK(node[1] == ((i == 5) ? nulls : 0));
+	}
+
+	/*
+	** Buffers: _op 0-2, _xact_id 3-4, _log_pos 5-6, _commit_time 7-8,
+	** id 9-10, name 11-13, flag 14-15 and amount 16-17.
+	*/
+	values = test_buffer(msg, buffers, 10, &len);
+	if (TEST_CHECK(values != NULL && len == nrows * 4))
+	{
+		for (i = 0; i < nrows; i++)
+		{
+			memcpy(&i32, values + i * 4, 4);
+			TEST_CHECK(i32 == ids[i]);
+		}
+	}
+
+	validity = test_buffer(msg, buffers, 11, &len);
+	offsets = test_buffer(msg, buffers, 12, &vlen);
+	values = test_buffer(msg, buffers, 13, &len);
+	if (TEST_CHECK(validity != NULL && offsets != NULL && values != NULL &&
+		       vlen == (nrows + 1) * 4))
+	{
+		for (i = 0; i < nrows; i++)
+		{
+			memcpy(off, offsets + i * 4, sizeof (off));
+			TEST_CHECK(((validity[i >> 3] >> (i & 7)) & 1) ==
+				   (names[i] != NULL));
+			if (names[i] == NULL)
+			{
+				TEST_CHECK(off[1] == off[0]);
+				continue;
+			}
+			n = strlen(names[i]);
+			TEST_CHECK(off[1] - off[0] == n && off[1] <= len &&
+				   memcmp(values + off[0], names[i], n) == 0);
+		}
+	}
+
+	values = test_buffer(msg, buffers, 17, &len);
+	if (TEST_CHECK(values != NULL && len == nrows * 8))
+	{
+		for (i = 0; i < nrows; i++)
+		{
+			memcpy(&f64, values + i * 8, 8);
+			TEST_CHECK(f64 == amounts[i]);
+		}
+	}
+}
+
+/*
+** test_stream()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Write two batches to the test table, the second with a change that
+** 	does not match its schema, and read the stream back.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_stream(CS_VOID)
+{
+	static CS_INT	ids1[] = { 1, 2, 1 };
+	static CS_CHAR	*names1[] = { "one", NULL, "one" };
+	static CS_FLOAT	amounts1[] = { 1.5, -2.25, 1.5 };
+	static CS_INT	ids2[] = { 3 };
+	static CS_CHAR	*names2[] = { "three" };
+	static CS_FLOAT	amounts2[] = { 1e10 };
+	LT_SINK		*sink;
+	LT_BUF		changes;
+	LT_CHANGE	change;
+	TEST_MSG	msg;
+	CS_CHAR		prefix[256];
+	CS_CHAR		path[300];
+	CS_BYTE		*data = NULL;
+	CS_INT		len = 0;
+	CS_INT		off = 0;
+	FILE		*fp;
+	long		size;
+
+	test_path("testarrow", prefix, sizeof (prefix));
+	snprintf(path, sizeof (path), "%s.dbo.t.arrows", prefix);
+	remove(path);
+	if (!TEST_CHECK(lt_arrow_open(prefix, &sink) == CS_SUCCEED))
+	{
+		return;
+	}
+
+	memset(&changes, 0, sizeof (changes));
+	TEST_CHECK(test_row(&changes, LT_OP_INSERT, 1, "1", "one", "1",
+			    "1.5") == CS_SUCCEED);
+	TEST_CHECK(test_row(&changes, LT_OP_INSERT, 2, "2", NULL, "0",
+			    "-2.25") == CS_SUCCEED);
+	TEST_CHECK(test_row(&changes, LT_OP_DELETE, 3, "1", "one", "1",
+			    "1.5") == CS_SUCCEED);
+	TEST_CHECK(test_write(sink, &changes, 3) == CS_SUCCEED);
+
+	TEST_CHECK(test_row(&changes, LT_OP_INSERT, 4, "3", "three", "1",
+			    "1e10") == CS_SUCCEED);
+	memset(&change, 0, sizeof (change));
+	change.op = LT_OP_INSERT;
+	change.tableid = Test_table;
+	change.ownerid = Test_owner;
+	TEST_CHECK(lt_change_encode(&changes, &change) == CS_SUCCEED);
+	TEST_CHECK(test_write(sink, &changes, 2) == CS_SUCCEED);
+	TEST_CHECK(sink->close(sink) == CS_SUCCEED);
+	lt_buf_free(&changes);
+
+	if (TEST_CHECK((fp = fopen(path, "rb")) != NULL))
+	{
+		fseek(fp, 0, SEEK_END);
+		size = ftell(fp);
+		rewind(fp);
+		if ((data = (CS_BYTE *)malloc(size)) != NULL &&
+		    fread(data, 1, size, fp) == (size_t)size)
+		{
+			len = (CS_INT)size;
+		}
+		fclose(fp);
+	}
+	remove(path);
+	if (!TEST_CHECK(len > 0))
+	{
+		free(data);
+		return;
+	}
+
+	if (TEST_CHECK(test_message(data, len, &off, &msg)))
+	{
+		test_schema(&msg);
+	}
+	if (TEST_CHECK(test_message(data, len, &off, &msg)))
+	{
+		test_batch(&msg, 3, ids1, names1, amounts1);
+	}
+	if (TEST_CHECK(test_message(data, len, &off, &msg)))
+	{
+		test_batch(&msg, 1, ids2, names2, amounts2);
+	}
+	TEST_CHECK(!test_message(data, len, &off, &msg));
+	TEST_CHECK(off == len);
+	free(data);
+}
+
+/*
+** test_numbered()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	An existing stream file is not overwritten; the stream goes to the
+** 	first free numbered name instead.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_numbered(CS_VOID)
+{
+	LT_SINK		*sink;
+	LT_BUF		changes;
+	CS_CHAR		prefix[256];
+	CS_CHAR		path[300];
+	CS_CHAR		numbered[300];
+	FILE		*fp;
+	long		size = -1;
+
+	test_path("testarrow", prefix, sizeof (prefix));
+	snprintf(path, sizeof (path), "%s.dbo.t.arrows", prefix);
+	snprintf(numbered, sizeof (numbered), "%s.dbo.t.1.arrows", prefix);
+	remove(numbered);
+	if (!TEST_CHECK((fp = fopen(path, "w")) != NULL))
+	{
+		return;
+	}
+	fputs("keep", fp);
+	fclose(fp);
+
+	memset(&changes, 0, sizeof (changes));
+	if (TEST_CHECK(lt_arrow_open(prefix, &sink) == CS_SUCCEED))
+	{
+		TEST_CHECK(test_row(&changes, LT_OP_INSERT, 1, "1", "one", "1",
+				    "1.5") == CS_SUCCEED);
+		TEST_CHECK(test_write(sink, &changes, 1) == CS_SUCCEED);
+		TEST_CHECK(sink->close(sink) == CS_SUCCEED);
+	}
+	lt_buf_free(&changes);
+
+	if (TEST_CHECK((fp = fopen(path, "rb")) != NULL))
+	{
+		fseek(fp, 0, SEEK_END);
+		size = ftell(fp);
+		fclose(fp);
+	}
+	TEST_CHECK(size == 4);
+	TEST_CHECK((fp = fopen(numbered, "rb")) != NULL);
+	if (fp != NULL)
+	{
+		fclose(fp);
+	}
+	remove(path);
+	remove(numbered);
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (lt_dict_intern("t", 1, &Test_table) != CS_SUCCEED ||
+	    lt_dict_intern("dbo", 3, &Test_owner) != CS_SUCCEED)
+	{
+		return EX_EXIT_FAIL;
+	}
+
+	test_stream();
+	test_numbered();
+	return test_done("testarrow");
+}
@@ -0,0 +1,353 @@
+/*
+** Description
+** -----------
+** 	Tests of the group-commit batching of ltbatch.c: batches close on
+** 	their limits and are written whole, and a batch the sink fails to
+** 	write is kept, with the transactions added since, for the next
+** 	flush to retry, without the written position moving past it. A
+** 	batch the file sink writes only part of is cut off the file before
+** 	the retry.
+**
+** 	Usage: testbatch
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltbatch.h"
+#include "ltsink.h"
+#include "testutils.h"
+
+/*
+** A sink recording the batches written to it. The next 'failures'
+** writes fail.
+*/
+typedef struct _test_sink
+{
+	LT_SINK		sink;
+	CS_INT		failures;
+	CS_INT		calls;
+	CS_INT		nbatches;
+	CS_INT		nxacts;
+	CS_INT		bytes;
+	CS_UBIGINT	lastpos;
+	CS_UBIGINT	firstxact;
+} TEST_SINK;
+
+/*
+** test_write()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Record a batch, or fail if the sink is set to.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	batch		- The batch.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL while failures are due.
+*/
+
+CS_STATIC CS_RETCODE
+test_write(LT_SINK *sink, LT_BATCH *batch)
+{
+	TEST_SINK	*ts = (TEST_SINK *)sink->ctx;
+
+	ts->calls++;
+	if (ts->failures > 0)
+	{
+		ts->failures--;
+		return CS_FAIL;
+	}
+	ts->nbatches++;
+	ts->nxacts += batch->nxacts;
+	ts->bytes += batch->changes.len;
+	ts->lastpos = batch->lastpos;
+	ts->firstxact = batch->xacts[0].xactid;
+	return CS_SUCCEED;
+}
+
+/*
+** test_close()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Close the sink; it is not freed.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED
+*/
+
+CS_STATIC CS_RETCODE
+test_close(LT_SINK *sink)
+{
+	return CS_SUCCEED;
+}
+
+/*
+** test_open()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Set up a recording sink.
+**
+** Parameters:
+** 	ts		- The sink's state.
+**
+** Returns:
+** 	The sink.
+*/
+
+CS_STATIC LT_SINK *
+test_open(TEST_SINK *ts)
+{
+	memset(ts, 0, sizeof (*ts));
+	ts->sink.name = "test";
+	ts->sink.write = test_write;
+	ts->sink.close = test_close;
+	ts->sink.ctx = ts;
+	return &ts->sink;
+}
+
+/*
+** test_add()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Add transaction 'n', with 'n' bytes of changes, committed at 'n'.
+**
+** Parameters:
+** 	batcher		- Pointer to the group-commit state.
+** 	n		- Number of the transaction, from 1.
+**
+** Returns:
+** 	The return code of lt_batch_add().
+*/
+
+CS_STATIC CS_RETCODE
+test_add(LT_BATCHER *batcher, CS_INT n)
+{
+	LT_BUF		changes;
+	CS_RETCODE	retcode;
+
+	memset(&changes, 0, sizeof (changes));
+	if (lt_buf_reserve(&changes, n) != CS_SUCCEED)
+	{
+		return CS_MEM_ERROR;
+	}
+	memset(changes.data, 'a' + n % 26, n);
+	changes.len = n;
+	retcode = lt_batch_add(batcher, (CS_UBIGINT)n, (CS_UBIGINT)n, 0, 0,
+			       &changes, 1);
+	lt_buf_free(&changes);
+	return retcode;
+}
+
+/*
+** test_limits()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	A batch closes once it holds the maximum number of transactions,
+** 	or of bytes, and a flush writes what is left.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_limits(CS_VOID)
+{
+	TEST_SINK	ts;
+	LT_BATCHER	batcher;
+	CS_INT		n;
+
+	lt_batch_init(&batcher, test_open(&ts), 3, 0, 0);
+	for (n = 1; n <= 7; n++)
+	{
+		TEST_CHECK(test_add(&batcher, n) == CS_SUCCEED);
+	}
+	TEST_CHECK(ts.nbatches == 2 && ts.nxacts == 6);
+	TEST_CHECK(batcher.written == 6);
+	TEST_CHECK(batcher.batch.nxacts == 1);
+	TEST_CHECK(lt_batch_flush(&batcher) == CS_SUCCEED);
+	TEST_CHECK(ts.nbatches == 3 && ts.nxacts == 7 && ts.bytes == 28);
+	TEST_CHECK(batcher.written == 7 && batcher.nbatches == 3);
+	TEST_CHECK(lt_batch_flush(&batcher) == CS_SUCCEED);
+	TEST_CHECK(ts.calls == 3);
+	lt_batch_cleanup(&batcher);
+
+	lt_batch_init(&batcher, test_open(&ts), 0, 10, 0);
+	for (n = 1; n <= 5; n++)
+	{
+		TEST_CHECK(test_add(&batcher, n) == CS_SUCCEED);
+	}
+	TEST_CHECK(ts.nbatches == 1 && ts.nxacts == 4 && ts.bytes == 10);
+	TEST_CHECK(batcher.batch.nxacts == 1);
+	lt_batch_cleanup(&batcher);
+}
+
+/*
+** test_flush_failure()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	A batch the sink fails to write is kept whole, grows with the
+** 	transactions added meanwhile, and is written by the next flush that
+** 	succeeds; the written position stays behind it until then.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_flush_failure(CS_VOID)
+{
+	TEST_SINK	ts;
+	LT_BATCHER	batcher;
+
+	lt_batch_init(&batcher, test_open(&ts), 2, 0, 0);
+	TEST_CHECK(test_add(&batcher, 1) == CS_SUCCEED);
+	TEST_CHECK(test_add(&batcher, 2) == CS_SUCCEED);
+	TEST_CHECK(batcher.written == 2);
+
+	ts.failures = 2;
+	TEST_CHECK(test_add(&batcher, 3) == CS_SUCCEED);
+	TEST_CHECK(test_add(&batcher, 4) == CS_FAIL);
+	TEST_CHECK(batcher.batch.nxacts == 2 && batcher.batch.changes.len == 7);
+	TEST_CHECK(batcher.written == 2 && batcher.nbatches == 1);
+
+	TEST_CHECK(test_add(&batcher, 5) == CS_FAIL);
+	TEST_CHECK(batcher.batch.nxacts == 3 && batcher.batch.changes.len == 12);
+	TEST_CHECK(batcher.batch.lastpos == 5);
+	TEST_CHECK(batcher.written == 2);
+	TEST_CHECK(ts.nbatches == 1 && ts.calls == 3);
+
+	TEST_CHECK(lt_batch_sync(&batcher) == CS_SUCCEED);
+	TEST_CHECK(ts.nbatches == 2 && ts.nxacts == 5 && ts.bytes == 15);
+	TEST_CHECK(ts.firstxact == 3 && ts.lastpos == 5);
+	TEST_CHECK(batcher.written == 5 && batcher.nbatches == 2);
+	TEST_CHECK(batcher.batch.nxacts == 0 && batcher.batch.changes.len == 0);
+	lt_batch_cleanup(&batcher);
+}
+
+/*
+** test_file_size()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Find the size of a file.
+**
+** Parameters:
+** 	path		- Path of the file.
+**
+** Returns:
+** 	Its size, or -1 if it could not be found.
+*/
+
+CS_STATIC CS_INT
+test_file_size(CS_CHAR *path)
+{
+	struct stat	st;
+
+	return (stat(path, &st) == 0) ? (CS_INT)st.st_size : -1;
+}
+
+/*
+** test_torn_write()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	A batch the file sink writes part of before the write fails, here
+** 	on the file size limit, is cut off the file, and the retry leaves
+** 	it there once, right after the batch before.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_torn_write(CS_VOID)
+{
+	CS_CHAR		path[512];
+	LT_SINK		*sink;
+	LT_BATCHER	batcher;
+	struct rlimit	limit;
+	struct rlimit	saved;
+	CS_UINT		magic = 0;
+	CS_INT		size;
+	FILE		*fp;
+
+	test_path("testbatch.out", path, sizeof (path));
+	remove(path);
+	if (!TEST_CHECK(lt_sink_file_open(path, &sink) == CS_SUCCEED))
+	{
+		return;
+	}
+	lt_batch_init(&batcher, sink, 1, 0, 0);
+	TEST_CHECK(test_add(&batcher, 10) == CS_SUCCEED);
+	size = test_file_size(path);
+	TEST_CHECK(size > 10);
+
+	signal(SIGXFSZ, SIG_IGN);
+	TEST_CHECK(getrlimit(RLIMIT_FSIZE, &saved) == 0);
+	limit = saved;
+	limit.rlim_cur = size + 30;
+	TEST_CHECK(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+	TEST_CHECK(test_add(&batcher, 100) == CS_FAIL);
+	TEST_CHECK(setrlimit(RLIMIT_FSIZE, &saved) == 0);
+	signal(SIGXFSZ, SIG_DFL);
+	TEST_CHECK(test_file_size(path) == size);
+	TEST_CHECK(batcher.batch.nxacts == 1 && batcher.written == 10);
+
+	TEST_CHECK(lt_batch_sync(&batcher) == CS_SUCCEED);
+	TEST_CHECK(test_file_size(path) == size * 2 + 90);
+	if ((fp = fopen(path, "rb")) != NULL)
+	{
+		TEST_CHECK(fseek(fp, size, SEEK_SET) == 0 &&
+			   fread(&magic, sizeof (magic), 1, fp) == 1);
+		fclose(fp);
+	}
+	TEST_CHECK(magic == LT_SINK_MAGIC);
+
+	lt_batch_cleanup(&batcher);
+	TEST_CHECK(sink->close(sink) == CS_SUCCEED);
+	remove(path);
+}
+
+int
+main(int argc, char *argv[])
+{
+	test_limits();
+	test_flush_failure();
+	test_torn_write();
+	return test_done("testbatch");
+}
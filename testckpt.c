@@ -0,0 +1,349 @@
+/*
+** Description
+** -----------
+** 	Tests of the checkpoints of ltckpt.c: the open transactions, their
+** 	buffered changes and savepoints and the scan position are reloaded
+** 	as written, in scan order, and marked restored, so that the rescan
+** 	after a restart does not buffer their changes twice. A missing
+** 	checkpoint loads nothing, and a damaged one fails.
+**
+** 	Usage: testckpt
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltxact.h"
+#include "ltdict.h"
+#include "ltckpt.h"
+#include "testutils.h"
+
+/*
+** Open transactions of the test checkpoint, by BEGINXACT page, in the
+** order they began: the log wraps between the second and the third.
+*/
+CS_STATIC CS_UINT Test_pages[] = { 800, 810, 2 };
+
+#define TEST_NXACTS	(sizeof (Test_pages) / sizeof (Test_pages[0]))
+
+/*
+** Id of the table name of the test changes.
+*/
+CS_STATIC CS_UINT Test_table;
+
+/*
+** test_append()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Buffer an insert of one column, made by the record at 'page' and
+** 	'row'.
+**
+** Parameters:
+** 	xact		- The open transaction.
+** 	page		- Page of the record.
+** 	row		- Record number.
+**
+** Returns:
+** 	The return code of lt_xact_append().
+*/
+
+CS_STATIC CS_RETCODE
+test_append(LT_XACT *xact, CS_UINT page, CS_UINT row)
+{
+	LT_CHANGE	change;
+	LT_COLUMN	column;
+	LT_LOGPOS	pos;
+	CS_CHAR		value[16];
+
+	pos.page = page;
+	pos.row = row;
+	snprintf(value, sizeof (value), "%u.%u", page, row);
+	memset(&column, 0, sizeof (column));
+	column.name = "id";
+	column.namelen = 2;
+	column.datatype = CS_CHAR_TYPE;
+	column.value = value;
+	column.valuelen = strlen(value);
+
+	memset(&change, 0, sizeof (change));
+	change.op = LT_OP_INSERT;
+	change.xactid = LT_LOGPOS_KEY(xact->begin);
+	change.pos = LT_LOGPOS_KEY(pos);
+	change.tableid = Test_table;
+	change.ownerid = Test_table;
+	change.numcols = 1;
+	change.columns = &column;
+	return lt_xact_append(xact, &change);
+}
+
+/*
+** test_build()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Open the test transactions: each buffers 'i' + 1 changes, and the
+** 	second takes a savepoint after its first change.
+**
+** Parameters:
+** 	index		- Pointer to an empty open transaction index.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_build(LT_XACT_INDEX *index)
+{
+	LT_XACT		*xact;
+	LT_LOGPOS	pos;
+	CS_UINT		i;
+	CS_UINT		row;
+
+	for (i = 0; i < TEST_NXACTS; i++)
+	{
+		pos.page = Test_pages[i];
+		pos.row = 0;
+		TEST_CHECK(lt_xact_begin(index, &pos, &xact) == CS_SUCCEED);
+		for (row = 1; row <= i + 1; row++)
+		{
+			TEST_CHECK(test_append(xact, Test_pages[i], row) ==
+				   CS_SUCCEED);
+			if (i == 1 && row == 1)
+			{
+				pos.row = 1;
+				TEST_CHECK(lt_xact_savepoint(xact, &pos) ==
+					   CS_SUCCEED);
+			}
+		}
+	}
+}
+
+/*
+** test_walk_collect()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	lt_xact_walk() callback listing the open transactions.
+**
+** Parameters:
+** 	xact		- The open transaction.
+** 	arg		- Pointer to the next entry of the list.
+**
+** Returns:
+** 	CS_SUCCEED
+*/
+
+CS_STATIC CS_RETCODE
+test_walk_collect(LT_XACT *xact, CS_VOID *arg)
+{
+	LT_XACT		***next = (LT_XACT ***)arg;
+
+	*(*next)++ = xact;
+	return CS_SUCCEED;
+}
+
+/*
+** test_roundtrip()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Write a checkpoint and reload it into an empty index.
+**
+** Parameters:
+** 	path		- Name of the checkpoint file.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_roundtrip(CS_CHAR *path)
+{
+	LT_XACT_INDEX	written;
+	LT_XACT_INDEX	loaded;
+	LT_XACT		*before[TEST_NXACTS];
+	LT_XACT		*after[TEST_NXACTS];
+	LT_XACT		**next;
+	LT_LOGPOS	scanpos;
+	LT_LOGPOS	restored;
+	LT_LOGPOS	oldest;
+	LT_LOGPOS	pos;
+	LT_LOGPOS	undone;
+	CS_BOOL		found;
+	CS_UINT		i;
+
+	lt_xact_init(&written);
+	lt_xact_init(&loaded);
+	test_build(&written);
+	scanpos.page = 3;
+	scanpos.row = 9;
+	TEST_CHECK(lt_ckpt_write(path, &written, &scanpos) == CS_SUCCEED);
+
+	TEST_CHECK(lt_ckpt_load(path, &loaded, &restored, &found) ==
+		   CS_SUCCEED);
+	TEST_CHECK(found);
+	TEST_CHECK(restored.page == scanpos.page && restored.row == scanpos.row);
+	TEST_CHECK(loaded.count == (CS_INT)TEST_NXACTS);
+	TEST_CHECK(lt_xact_lowwater(&loaded, &oldest) &&
+		   oldest.page == Test_pages[0]);
+
+	next = before;
+	(void)lt_xact_walk(&written, test_walk_collect, &next);
+	next = after;
+	(void)lt_xact_walk(&loaded, test_walk_collect, &next);
+	TEST_CHECK(next - after == (CS_INT)TEST_NXACTS);
+	for (i = 0; i < TEST_NXACTS && i < (CS_UINT)(next - after); i++)
+	{
+		TEST_CHECK(after[i]->begin.page == Test_pages[i]);
+		TEST_CHECK(after[i]->nchanges == before[i]->nchanges);
+		TEST_CHECK(after[i]->changes.len == before[i]->changes.len &&
+			   memcmp(after[i]->changes.data, before[i]->changes.data,
+				  before[i]->changes.len) == 0);
+		TEST_CHECK(after[i]->nsavepts == before[i]->nsavepts);
+		TEST_CHECK(after[i]->restored);
+		TEST_CHECK(after[i]->last.page == scanpos.page &&
+			   after[i]->last.row == scanpos.row);
+	}
+	TEST_CHECK(after[1]->nsavepts == 1 &&
+		   after[1]->savepts[0].offset == before[1]->savepts[0].offset &&
+		   after[1]->savepts[0].nchanges == 1);
+
+	/*
+	** The rescan replays the changes up to the scan position, which
+	** are dropped, and goes on past it.
+	*/
+	TEST_CHECK(test_append(after[2], Test_pages[2], 3) == CS_SUCCEED);
+	TEST_CHECK(after[2]->nchanges == 3);
+	TEST_CHECK(after[2]->restored);
+	TEST_CHECK(test_append(after[2], 3, 10) == CS_SUCCEED);
+	TEST_CHECK(after[2]->nchanges == 4);
+	TEST_CHECK(!after[2]->restored);
+
+	/*
+	** A rollback past the scan position to a reloaded mark leaves the
+	** last change before the mark as the newest, from the change index
+	** rebuilt by the load.
+	*/
+	TEST_CHECK(test_append(after[1], 3, 11) == CS_SUCCEED);
+	TEST_CHECK(after[1]->nchanges == 3 && !after[1]->restored);
+	pos.page = 3;
+	pos.row = 12;
+	undone.page = Test_pages[1];
+	undone.row = 2;
+	lt_xact_rollback(after[1], &pos, &undone);
+	TEST_CHECK(after[1]->nchanges == 1 && after[1]->nsavepts == 1);
+	TEST_CHECK(after[1]->changes.len == after[1]->savepts[0].offset);
+	TEST_CHECK(after[1]->last.page == Test_pages[1] &&
+		   after[1]->last.row == 1);
+
+	lt_xact_cleanup(&written);
+	lt_xact_cleanup(&loaded);
+}
+
+/*
+** test_missing()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Loading a checkpoint that does not exist succeeds and loads nothing.
+**
+** Parameters:
+** 	path		- Name of a file that does not exist.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_missing(CS_CHAR *path)
+{
+	LT_XACT_INDEX	index;
+	LT_LOGPOS	scanpos;
+	CS_BOOL		found = CS_TRUE;
+
+	lt_xact_init(&index);
+	unlink(path);
+	TEST_CHECK(lt_ckpt_load(path, &index, &scanpos, &found) == CS_SUCCEED);
+	TEST_CHECK(!found);
+	TEST_CHECK(index.count == 0);
+}
+
+/*
+** test_damaged()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	A checkpoint cut short fails to load.
+**
+** Parameters:
+** 	path		- Name of the checkpoint file.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_damaged(CS_CHAR *path)
+{
+	LT_XACT_INDEX	index;
+	LT_LOGPOS	scanpos;
+	CS_BOOL		found;
+	FILE		*fp;
+	long		size;
+
+	lt_xact_init(&index);
+	test_build(&index);
+	scanpos.page = 3;
+	scanpos.row = 9;
+	TEST_CHECK(lt_ckpt_write(path, &index, &scanpos) == CS_SUCCEED);
+	lt_xact_cleanup(&index);
+
+	if (!TEST_CHECK((fp = fopen(path, "rb")) != NULL))
+	{
+		return;
+	}
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fclose(fp);
+	TEST_CHECK(truncate(path, size - 1) == 0);
+
+	TEST_CHECK(lt_ckpt_load(path, &index, &scanpos, &found) != CS_SUCCEED);
+	lt_xact_cleanup(&index);
+}
+
+int
+main(int argc, char *argv[])
+{
+	CS_CHAR		path[1024];
+
+	if (lt_dict_intern("t", 1, &Test_table) != CS_SUCCEED)
+	{
+		return EX_EXIT_FAIL;
+	}
+	test_path("testckpt.ckpt", path, sizeof (path));
+
+	test_roundtrip(path);
+	test_missing(path);
+	test_damaged(path);
+	unlink(path);
+	return test_done("testckpt");
+}
@@ -0,0 +1,399 @@
+/*
+** Description
+** -----------
+** 	Tests of the net-change compaction of ltcompact.c: changes to the
+** 	same row fold into their net change, and text changes go with the
+** 	row changed before them, dropped with it when it ends up deleted or
+** 	never there. A batch of ltbatch.c set to be compacted is written as
+** 	one transaction holding the net changes of all of its own.
+**
+** 	Usage: testcompact
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltcompact.h"
+#include "ltbatch.h"
+#include "ltdict.h"
+#include "testutils.h"
+
+/*
+** Id of the table and owner names of the test changes.
+*/
+CS_STATIC CS_UINT Test_table;
+
+/*
+** A sink recording the last batch written to it: its transactions, and
+** the list test_list() gives of its changes.
+*/
+typedef struct _test_sink
+{
+	LT_SINK		sink;
+	CS_INT		nbatches;
+	CS_INT		nxacts;
+	LT_BATCH_XACT	xact;
+	CS_INT		nchanges;
+	CS_CHAR		list[256];
+} TEST_SINK;
+
+/*
+** test_add()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Append a change of transaction 1 to a buffer, with a row image of
+** 	the key column "id" and a column "v". A text change has only the
+** 	text, in "v", and no table.
+**
+** Parameters:
+** 	buf		- The buffer.
+** 	op		- The operation.
+** 	key		- The key, or NULL for a text change.
+** 	value		- The value of "v".
+**
+** Returns:
+** 	The return code of lt_change_encode().
+*/
+
+CS_STATIC CS_RETCODE
+test_add(LT_BUF *buf, CS_INT op, CS_CHAR *key, CS_CHAR *value)
+{
+	LT_CHANGE	change;
+	LT_COLUMN	cols[2];
+	LT_COLUMN	*col = cols;
+
+	memset(&change, 0, sizeof (change));
+	memset(cols, 0, sizeof (cols));
+	change.op = op;
+	change.xactid = 1;
+	change.pos = buf->len + 1;
+	if (key != NULL)
+	{
+		change.tableid = Test_table;
+		change.ownerid = Test_table;
+		col->name = "id";
+		col->namelen = 2;
+		col->datatype = CS_CHAR_TYPE;
+		col->value = key;
+		col->valuelen = strlen(key);
+		col++;
+	}
+	col->name = "v";
+	col->namelen = 1;
+	col->datatype = CS_CHAR_TYPE;
+	col->value = value;
+	col->valuelen = strlen(value);
+	change.numcols = (col - cols) + 1;
+	change.columns = cols;
+	return lt_change_encode(buf, &change);
+}
+
+/*
+** test_list()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	List the changes of a buffer as their operation, I, D, B, A or T,
+** 	followed by the value of their "v" column, separated by spaces.
+**
+** Parameters:
+** 	buf		- The buffer.
+** 	list		- Set to the list.
+** 	len		- Length of 'list'.
+**
+** Returns:
+** 	The number of changes, or -1 if the buffer does not decode.
+*/
+
+CS_STATIC CS_INT
+test_list(LT_BUF *buf, CS_CHAR *list, CS_INT len)
+{
+	LT_CHANGE	change;
+	LT_COLUMN	*columns = NULL;
+	LT_COLUMN	*col;
+	CS_INT		maxcols = 0;
+	CS_INT		off = 0;
+	CS_INT		reclen;
+	CS_INT		n = 0;
+	CS_INT		used = 0;
+
+	list[0] = '\0';
+	while (off < buf->len)
+	{
+		reclen = lt_change_decode(buf->data + off, buf->len - off,
+			&change, &columns, &maxcols);
+		if (reclen == 0)
+		{
+			n = -1;
+			break;
+		}
+		col = &change.columns[change.numcols - 1];
+		used += snprintf(list + used, len - used, "%s%c%.*s",
+			(n == 0) ? "" : " ", "?IDBAT"[change.op],
+			(int)col->valuelen, col->value);
+		if (used >= len)
+		{
+			n = -1;
+			break;
+		}
+		off += reclen;
+		n++;
+	}
+	free(columns);
+	return n;
+}
+
+/*
+** test_run()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Compact a buffer and check the list of the net changes.
+**
+** Parameters:
+** 	in		- The changes.
+** 	expected	- The list test_list() is to give of the net
+** 			  changes.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_run(LT_BUF *in, CS_CHAR *expected)
+{
+	LT_COMPACT	compact;
+	LT_BUF		out;
+	CS_CHAR		list[256];
+	CS_INT		nchanges;
+	CS_INT		n;
+
+	memset(&out, 0, sizeof (out));
+	lt_compact_init(&compact, 1);
+	TEST_CHECK(lt_compact_run(&compact, in, &out, &nchanges) ==
+		CS_SUCCEED);
+	n = test_list(&out, list, sizeof (list));
+	TEST_CHECK(n == nchanges);
+	if (!TEST_CHECK(strcmp(list, expected) == 0))
+	{
+		fprintf(stderr, "got \"%s\", expected \"%s\"\n", list,
+			expected);
+	}
+	lt_compact_cleanup(&compact);
+	lt_buf_free(&out);
+	in->len = 0;
+}
+
+/*
+** test_fold()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	An insert and its updates fold into one insert, a delete and an
+** 	insert of the same key into an update, and an insert and a delete
+** 	into nothing.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_fold(CS_VOID)
+{
+	LT_BUF		in;
+
+	memset(&in, 0, sizeof (in));
+	TEST_CHECK(test_add(&in, LT_OP_INSERT, "1", "a") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_DELETE, "2", "b") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_UPDATE_BEFORE, "1", "a") ==
+		CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_UPDATE_AFTER, "1", "c") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_INSERT, "3", "d") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_INSERT, "2", "e") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_DELETE, "3", "d") == CS_SUCCEED);
+	test_run(&in, "Ic Bb Ae");
+	lt_buf_free(&in);
+}
+
+/*
+** test_text()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Text changes are written after the net change of the row changed
+** 	before them, follow a row to its new key, and are dropped with a
+** 	row inserted and deleted again; text changes without a row before
+** 	them stay in place.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_text(CS_VOID)
+{
+	LT_BUF		in;
+
+	memset(&in, 0, sizeof (in));
+	TEST_CHECK(test_add(&in, LT_OP_TEXT, NULL, "t0") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_INSERT, "1", "a") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_TEXT, NULL, "t1") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_INSERT, "2", "b") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_TEXT, NULL, "t2") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_TEXT, NULL, "t3") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_DELETE, "1", "a") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_UPDATE_BEFORE, "2", "b") ==
+		CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_UPDATE_AFTER, "2", "c") == CS_SUCCEED);
+	test_run(&in, "Tt0 Ic Tt2 Tt3");
+
+	TEST_CHECK(test_add(&in, LT_OP_INSERT, "3", "a") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_TEXT, NULL, "t1") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_INSERT, "4", "b") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_TEXT, NULL, "t2") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_UPDATE_BEFORE, "3", "a") ==
+		CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_UPDATE_AFTER, "5", "c") == CS_SUCCEED);
+	TEST_CHECK(test_add(&in, LT_OP_TEXT, NULL, "t3") == CS_SUCCEED);
+	test_run(&in, "Ib Tt2 Ic Tt1 Tt3");
+	lt_buf_free(&in);
+}
+
+/*
+** test_write()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Record a batch.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	batch		- The batch.
+**
+** Returns:
+** 	CS_SUCCEED
+*/
+
+CS_STATIC CS_RETCODE
+test_write(LT_SINK *sink, LT_BATCH *batch)
+{
+	TEST_SINK	*ts = (TEST_SINK *)sink->ctx;
+
+	ts->nbatches++;
+	ts->nxacts = batch->nxacts;
+	ts->xact = batch->xacts[0];
+	ts->nchanges = test_list(&batch->changes, ts->list,
+		sizeof (ts->list));
+	TEST_CHECK(ts->nchanges == batch->nchanges);
+	return CS_SUCCEED;
+}
+
+/*
+** test_batch()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	A batch set to be compacted goes out as one transaction, from the
+** 	BEGINXACT of the first to the commit of the last, holding the net
+** 	changes of all of them; one that is not keeps its transactions.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_batch(CS_VOID)
+{
+	TEST_SINK	ts;
+	LT_BATCHER	batcher;
+	LT_COMPACT	compact;
+	LT_BUF		changes;
+	CS_INT		pass;
+
+	memset(&changes, 0, sizeof (changes));
+	lt_compact_init(&compact, 1);
+	for (pass = 0; pass < 2; pass++)
+	{
+		memset(&ts, 0, sizeof (ts));
+		ts.sink.name = "test";
+		ts.sink.write = test_write;
+		ts.sink.ctx = &ts;
+		lt_batch_init(&batcher, &ts.sink, 3, 0, 0);
+		batcher.compact = (pass == 0) ? &compact : NULL;
+
+		TEST_CHECK(test_add(&changes, LT_OP_INSERT, "1", "a") ==
+			CS_SUCCEED);
+		TEST_CHECK(lt_batch_add(&batcher, 10, 11, 1, 5, &changes,
+			1) == CS_SUCCEED);
+		changes.len = 0;
+		TEST_CHECK(test_add(&changes, LT_OP_UPDATE_BEFORE, "1",
+			"a") == CS_SUCCEED);
+		TEST_CHECK(test_add(&changes, LT_OP_UPDATE_AFTER, "1",
+			"b") == CS_SUCCEED);
+		TEST_CHECK(test_add(&changes, LT_OP_INSERT, "2", "c") ==
+			CS_SUCCEED);
+		TEST_CHECK(lt_batch_add(&batcher, 12, 13, 2, 5, &changes,
+			3) == CS_SUCCEED);
+		changes.len = 0;
+		TEST_CHECK(test_add(&changes, LT_OP_DELETE, "2", "c") ==
+			CS_SUCCEED);
+		TEST_CHECK(lt_batch_add(&batcher, 20, 21, 3, 6, &changes,
+			1) == CS_SUCCEED);
+		changes.len = 0;
+
+		TEST_CHECK(ts.nbatches == 1 && batcher.written == 21);
+		if (pass == 0)
+		{
+			TEST_CHECK(ts.nxacts == 1 && ts.nchanges == 1);
+			TEST_CHECK(strcmp(ts.list, "Ib") == 0);
+			TEST_CHECK(ts.xact.xactid == 10);
+			TEST_CHECK(ts.xact.commitpos == 21);
+			TEST_CHECK(ts.xact.committime == 3);
+			TEST_CHECK(ts.xact.userid == 0);
+			TEST_CHECK(ts.xact.nchanges == 1);
+		}
+		else
+		{
+			TEST_CHECK(ts.nxacts == 3 && ts.nchanges == 5);
+			TEST_CHECK(ts.xact.commitpos == 11);
+			TEST_CHECK(ts.xact.userid == 5);
+		}
+		lt_batch_cleanup(&batcher);
+	}
+	lt_compact_cleanup(&compact);
+	lt_buf_free(&changes);
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (lt_dict_intern("t", 1, &Test_table) != CS_SUCCEED)
+	{
+		return EX_EXIT_FAIL;
+	}
+
+	test_fold();
+	test_text();
+	test_batch();
+	return test_done("testcompact");
+}
@@ -0,0 +1,360 @@
+/*
+** Description
+** -----------
+** 	Tests of the JSON Lines sink of ltjson.c: the escaper, against a
+** 	byte at a time rendering of every byte at every offset of a clean
+** 	run, and on UTF-8 both well and badly formed, and an update written
+** 	through the sink and read back from its file.
+**
+** 	Usage: testjson
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltbatch.h"
+#include "ltdict.h"
+#include "ltjson.h"
+#include "testutils.h"
+
+/*
+** Length of the clean runs single bytes are escaped in; long enough to
+** take the 16 and 8 byte paths of the escaper on both sides.
+*/
+#define TEST_RUNLEN	40
+
+/*
+** test_escaped()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Tell whether a string escapes to the quoted string expected.
+**
+** Parameters:
+** 	str		- The string.
+** 	len		- Its length.
+** 	expected	- The escaped string, without its quotes.
+**
+** Returns:
+** 	CS_TRUE or CS_FALSE.
+*/
+
+CS_STATIC CS_BOOL
+test_escaped(CS_CHAR *str, CS_INT len, CS_CHAR *expected)
+{
+	LT_BUF		out;
+	CS_INT		n = strlen(expected);
+	CS_BOOL		ok;
+
+	memset(&out, 0, sizeof (out));
+	if (lt_json_escape(&out, str, len) != CS_SUCCEED)
+	{
+		return CS_FALSE;
+	}
+	ok = (out.len == n + 2 && out.data[0] == '"' &&
+	      memcmp(out.data + 1, expected, n) == 0 && out.data[n + 1] == '"');
+	lt_buf_free(&out);
+	return ok;
+}
+
+/*
+** test_byte()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Escape one byte the slow way, taking any byte from 0x80 up on its
+** 	own as Latin-1.
+**
+** Parameters:
+** 	c		- The byte.
+** 	out		- Set to its escaped form, null terminated.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_byte(CS_BYTE c, CS_CHAR *out)
+{
+	switch (c)
+	{
+	  case '"':
+		strcpy(out, "\\\"");
+		return;
+	  case '\\':
+		strcpy(out, "\\\\");
+		return;
+	  case '\n':
+		strcpy(out, "\\n");
+		return;
+	  case '\r':
+		strcpy(out, "\\r");
+		return;
+	  case '\t':
+		strcpy(out, "\\t");
+		return;
+	}
+	if (c < 0x20 || c >= 0x80)
+	{
+		sprintf(out, "\\u%04x", (unsigned)c);
+		return;
+	}
+	out[0] = (CS_CHAR)c;
+	out[1] = '\0';
+}
+
+/*
+** test_escape_bytes()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Every byte escapes the same wherever it falls in a clean run.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_escape_bytes(CS_VOID)
+{
+	CS_CHAR		str[TEST_RUNLEN];
+	CS_CHAR		expected[TEST_RUNLEN + 8];
+	CS_CHAR		esc[8];
+	CS_INT		c;
+	CS_INT		i;
+	CS_INT		n;
+	CS_INT		wrong = 0;
+
+	for (c = 0; c < 256; c++)
+	{
+		test_byte((CS_BYTE)c, esc);
+		for (i = 0; i < TEST_RUNLEN; i++)
+		{
+			memset(str, 'x', TEST_RUNLEN);
+			str[i] = (CS_CHAR)c;
+			memset(expected, 'x', i);
+			strcpy(expected + i, esc);
+			n = i + strlen(esc);
+			memset(expected + n, 'x', TEST_RUNLEN - i - 1);
+			expected[n + TEST_RUNLEN - i - 1] = '\0';
+			if (!test_escaped(str, TEST_RUNLEN, expected))
+			{
+				wrong++;
+			}
+		}
+	}
+	TEST_CHECK(wrong == 0);
+}
+
+/*
+** test_escape_utf8()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Well formed UTF-8 is copied as is, and the bytes of overlong forms,
+** 	surrogates, code points past U+10FFFF and cut short sequences are
+** 	each taken as Latin-1.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_escape_utf8(CS_VOID)
+{
+	TEST_CHECK(test_escaped("", 0, ""));
+	TEST_CHECK(test_escaped("a\0b", 3, "a\\u0000b"));
+	TEST_CHECK(test_escaped("say \"hi\"\\\r\n", 11,
+				"say \\\"hi\\\"\\\\\\r\\n"));
+
+	TEST_CHECK(test_escaped("caf\xc3\xa9", 5, "caf\xc3\xa9"));
+	TEST_CHECK(test_escaped("\xe2\x82\xac 5", 5, "\xe2\x82\xac 5"));
+	TEST_CHECK(test_escaped("\xf0\x9f\x98\x80", 4, "\xf0\x9f\x98\x80"));
+	TEST_CHECK(test_escaped("\xf4\x8f\xbf\xbf", 4, "\xf4\x8f\xbf\xbf"));
+	TEST_CHECK(test_escaped("\xed\x9f\xbf", 3, "\xed\x9f\xbf"));
+
+	TEST_CHECK(test_escaped("caf\xe9", 4, "caf\\u00e9"));
+	TEST_CHECK(test_escaped("\xc0\x80", 2, "\\u00c0\\u0080"));
+	TEST_CHECK(test_escaped("\xe0\x9f\xbf", 3, "\\u00e0\\u009f\\u00bf"));
+	TEST_CHECK(test_escaped("\xed\xa0\x80", 3, "\\u00ed\\u00a0\\u0080"));
+	TEST_CHECK(test_escaped("\xf0\x8f\xbf\xbf", 4,
+				"\\u00f0\\u008f\\u00bf\\u00bf"));
+	TEST_CHECK(test_escaped("\xf4\x90\x80\x80", 4,
+				"\\u00f4\\u0090\\u0080\\u0080"));
+	TEST_CHECK(test_escaped("\xf5\x80\x80\x80", 4,
+				"\\u00f5\\u0080\\u0080\\u0080"));
+	TEST_CHECK(test_escaped("\xe2\x82", 2, "\\u00e2\\u0082"));
+	TEST_CHECK(test_escaped("\xe2\x82x", 3, "\\u00e2\\u0082x"));
+	TEST_CHECK(test_escaped("\xc3\xa9\xc3", 3, "\xc3\xa9\\u00c3"));
+}
+
+/*
+** test_escape_append()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	The escaper appends to what the buffer holds.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_escape_append(CS_VOID)
+{
+	LT_BUF		out;
+
+	memset(&out, 0, sizeof (out));
+	TEST_CHECK(lt_buf_append(&out, "{\"k\":", 5) == CS_SUCCEED);
+	TEST_CHECK(lt_json_escape(&out, "v\t", 2) == CS_SUCCEED);
+	TEST_CHECK(out.len == 10 &&
+		   memcmp(out.data, "{\"k\":\"v\\t\"", 10) == 0);
+	lt_buf_free(&out);
+}
+
+/*
+** test_column()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Fill in a column of a row image.
+**
+** Parameters:
+** 	col		- The column.
+** 	name		- Its name.
+** 	datatype	- Its datatype.
+** 	value		- Its value, or NULL for a null column.
+** 	len		- Length of the value.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_column(LT_COLUMN *col, CS_CHAR *name, CS_INT datatype, CS_CHAR *value,
+	    CS_INT len)
+{
+	memset(col, 0, sizeof (*col));
+	col->name = name;
+	col->namelen = strlen(name);
+	col->datatype = datatype;
+	col->indicator = (value == NULL) ? CS_NULLDATA : 0;
+	col->value = value;
+	col->valuelen = (value == NULL) ? 0 : len;
+}
+
+/*
+** test_sink()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	An update of a table with a name to escape is written as one JSON
+** 	line, its before and after images paired, numbers bare and strings
+** 	escaped.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_sink(CS_VOID)
+{
+	LT_SINK		*sink;
+	LT_BATCH	batch;
+	LT_BATCH_XACT	bx;
+	LT_CHANGE	change;
+	LT_COLUMN	cols[3];
+	CS_CHAR		path[256];
+	CS_CHAR		line[512];
+	CS_CHAR		*expected;
+	CS_UINT		tableid;
+	CS_UINT		ownerid;
+	FILE		*fp;
+	CS_INT		n = 0;
+
+	test_path("testjson", path, sizeof (path));
+	remove(path);
+	if (!TEST_CHECK(lt_dict_intern("t\"1", 3, &tableid) == CS_SUCCEED) ||
+	    !TEST_CHECK(lt_dict_intern("dbo", 3, &ownerid) == CS_SUCCEED) ||
+	    !TEST_CHECK(lt_json_open(path, &sink) == CS_SUCCEED))
+	{
+		return;
+	}
+
+	memset(&batch, 0, sizeof (batch));
+	memset(&change, 0, sizeof (change));
+	change.xactid = ((CS_UBIGINT)1 << 32) | 2;
+	change.pos = ((CS_UBIGINT)3 << 32) | 4;
+	change.tableid = tableid;
+	change.ownerid = ownerid;
+	change.columns = cols;
+	change.numcols = 3;
+	test_column(&cols[0], "id", CS_INT_TYPE, "1", 1);
+	test_column(&cols[1], "c", CS_CHAR_TYPE, "a\nb", 3);
+	test_column(&cols[2], "n", CS_INT_TYPE, NULL, 0);
+	change.op = LT_OP_UPDATE_BEFORE;
+	TEST_CHECK(lt_change_encode(&batch.changes, &change) == CS_SUCCEED);
+	test_column(&cols[1], "c", CS_CHAR_TYPE, "caf\xe9", 4);
+	test_column(&cols[2], "n", CS_INT_TYPE, "0x1", 3);
+	change.op = LT_OP_UPDATE_AFTER;
+	TEST_CHECK(lt_change_encode(&batch.changes, &change) == CS_SUCCEED);
+
+	memset(&bx, 0, sizeof (bx));
+	bx.xactid = change.xactid;
+	bx.commitpos = change.pos;
+	bx.len = batch.changes.len;
+	bx.nchanges = 2;
+	batch.xacts = &bx;
+	batch.nxacts = 1;
+	batch.nchanges = 2;
+	batch.lastpos = change.pos;
+	TEST_CHECK(sink->write(sink, &batch) == CS_SUCCEED);
+	TEST_CHECK(sink->close(sink) == CS_SUCCEED);
+	lt_buf_free(&batch.changes);
+
+	expected = "{\"table\":\"t\\\"1\",\"owner\":\"dbo\",\"op\":\"update\","
+		"\"xact\":{\"page\":1,\"row\":2},"
+		"\"pos\":{\"page\":3,\"row\":4},"
+		"\"before\":{\"id\":1,\"c\":\"a\\nb\",\"n\":null},"
+		"\"after\":{\"id\":1,\"c\":\"caf\\u00e9\",\"n\":\"0x1\"}}\n";
+	if (TEST_CHECK((fp = fopen(path, "r")) != NULL))
+	{
+		while (fgets(line, sizeof (line), fp) != NULL)
+		{
+			n++;
+			TEST_CHECK(strcmp(line, expected) == 0);
+		}
+		fclose(fp);
+	}
+	TEST_CHECK(n == 1);
+	remove(path);
+}
+
+int
+main(int argc, char *argv[])
+{
+	test_escape_bytes();
+	test_escape_utf8();
+	test_escape_append();
+	test_sink();
+	return test_done("testjson");
+}
@@ -0,0 +1,1087 @@
+/*
+** Description
+** -----------
+** 	Tests of the scan result path of logtransfer.c, from the results of
+** 	a scan to the transactions handed to the output sink. A synthetic
+** 	capture of interleaved transactions is served by the Client-Library
+** 	stand-in of ltreplay.c to handle_logtransfer_scan_results(), and a
+** 	recording sink checks what comes out of the batcher: the decoded
+** 	column values of the images, the changes of each transaction in
+** 	log order, the transactions in commit order, the changes undone by
+** 	a rollback to a savepoint left out, and a rolled back transaction
+** 	not output at all.
+**
+** 	The capture is then replayed again after a restart from a
+** 	checkpoint taken between its two scans: the transactions committed
+** 	before the checkpoint are not output again, and the one open at the
+** 	checkpoint is output once, with every change it made.
+**
+** 	Last, a JSON Lines sink on stdout is checked to get stdout to itself,
+** 	the display and the messages going to stderr.
+**
+** 	The program is linked with logtransfer.c, its main() renamed.
+**
+** 	Usage: testreplay
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltxact.h"
+#include "ltbatch.h"
+#include "ltckpt.h"
+#include "ltcapture.h"
+#include "ltout.h"
+#include "ltjson.h"
+#include "testutils.h"
+
+/*
+** Log page of every record of the capture; a record is identified by
+** its record number on it, and a transaction by that of its BEGINXACT.
+*/
+#define TEST_PAGE	100
+
+/*
+** Columns of the operation records, of ENDXACT, of the compensation
+** records and of the row images.
+*/
+#define TEST_OPCOLS	10
+#define TEST_ENDCOLS	9
+#define TEST_CLRCOLS	9
+#define TEST_IMAGECOLS	7
+
+/*
+** Most row changes the recording sink keeps, and the longest value.
+*/
+#define TEST_MAXOUT	16
+#define TEST_VALUELEN	40
+
+/*
+** A column of the capture.
+*/
+typedef struct _test_col
+{
+	CS_CHAR		*name;
+	CS_INT		datatype;
+	CS_INT		maxlength;
+	CS_INT		precision;
+	CS_INT		scale;
+} TEST_COL;
+
+CS_STATIC TEST_COL Test_opcols[TEST_OPCOLS] = {
+	{ "operation",	CS_CHAR_TYPE,		20,	0,	0 },
+	{ "xactpage",	CS_INT_TYPE,		4,	0,	0 },
+	{ "xactrow",	CS_INT_TYPE,		4,	0,	0 },
+	{ "status",	CS_CHAR_TYPE,		10,	0,	0 },
+	{ "page",	CS_INT_TYPE,		4,	0,	0 },
+	{ "row",	CS_INT_TYPE,		4,	0,	0 },
+	{ "spare",	CS_CHAR_TYPE,		10,	0,	0 },
+	{ "user",	CS_CHAR_TYPE,		30,	0,	0 },
+	{ "table",	CS_CHAR_TYPE,		30,	0,	0 },
+	{ "owner",	CS_CHAR_TYPE,		30,	0,	0 },
+};
+
+CS_STATIC TEST_COL Test_endcols[TEST_ENDCOLS] = {
+	{ "operation",	CS_CHAR_TYPE,		20,	0,	0 },
+	{ "xactpage",	CS_INT_TYPE,		4,	0,	0 },
+	{ "xactrow",	CS_INT_TYPE,		4,	0,	0 },
+	{ "status",	CS_CHAR_TYPE,		10,	0,	0 },
+	{ "page",	CS_INT_TYPE,		4,	0,	0 },
+	{ "row",	CS_INT_TYPE,		4,	0,	0 },
+	{ "spare",	CS_CHAR_TYPE,		10,	0,	0 },
+	{ "user",	CS_CHAR_TYPE,		30,	0,	0 },
+	{ "committime",	CS_DATETIME_TYPE,	8,	0,	0 },
+};
+
+CS_STATIC TEST_COL Test_clrcols[TEST_CLRCOLS] = {
+	{ "operation",	CS_CHAR_TYPE,		20,	0,	0 },
+	{ "xactpage",	CS_INT_TYPE,		4,	0,	0 },
+	{ "xactrow",	CS_INT_TYPE,		4,	0,	0 },
+	{ "clearpage",	CS_INT_TYPE,		4,	0,	0 },
+	{ "clearrow",	CS_INT_TYPE,		4,	0,	0 },
+	{ "tshigh",	CS_INT_TYPE,		4,	0,	0 },
+	{ "tslow",	CS_INT_TYPE,		4,	0,	0 },
+	{ "page",	CS_INT_TYPE,		4,	0,	0 },
+	{ "row",	CS_INT_TYPE,		4,	0,	0 },
+};
+
+CS_STATIC TEST_COL Test_imagecols[TEST_IMAGECOLS] = {
+	{ "id",		CS_INT_TYPE,		4,	0,	0 },
+	{ "name",	CS_VARCHAR_TYPE,	30,	0,	0 },
+	{ "amount",	CS_NUMERIC_TYPE,	35,	10,	2 },
+	{ "ts",		CS_DATETIME_TYPE,	8,	0,	0 },
+	{ "price",	CS_MONEY_TYPE,		8,	0,	0 },
+	{ "hash",	CS_VARBINARY_TYPE,	8,	0,	0 },
+	{ "flag",	CS_BIT_TYPE,		1,	0,	0 },
+};
+
+/*
+** A log record of the capture. 'xact' is the record number of the
+** transaction's BEGINXACT, 'undone' that of the record a compensation
+** record undoes, and 'id' and 'name' the row of an INSERT or DELETE.
+*/
+typedef struct _test_rec
+{
+	CS_CHAR		*op;
+	CS_INT		row;
+	CS_INT		xact;
+	CS_CHAR		*status;
+	CS_INT		undone;
+	CS_INT		id;
+	CS_CHAR		*name;
+} TEST_REC;
+
+/*
+** The capture: transactions 1 and 2 interleaved, 2 rolling back to a
+** savepoint; 12 rolled back whole; 50, begun before the scan; and 19,
+** left open. Transaction 1 updates its row. The first scan ends after
+** record 15.
+*/
+CS_STATIC TEST_REC Test_recs[] = {
+	{ "0",	1,	1,	"0",	0,	0,	NULL },
+	{ "0",	2,	2,	"0",	0,	0,	NULL },
+	{ "4",	3,	1,	"0",	0,	1,	"one" },
+	{ "4",	4,	2,	"0",	0,	10,	"ten" },
+	{ "18",	5,	2,	"0",	0,	0,	NULL },
+	{ "4",	6,	2,	"0",	0,	11,	"eleven" },
+	{ "26",	7,	2,	"0",	6,	0,	NULL },
+	{ "5",	8,	1,	"4",	0,	1,	"one" },
+	{ "4",	9,	1,	"4",	0,	1,	NULL },
+	{ "4",	10,	2,	"0",	0,	12,	"twelve" },
+	{ "30",	11,	2,	"0",	0,	0,	NULL },
+	{ "0",	12,	12,	"0",	0,	0,	NULL },
+	{ "4",	13,	12,	"0",	0,	20,	"twenty" },
+	{ "26",	14,	12,	"0",	13,	0,	NULL },
+	{ "30",	15,	12,	"0",	0,	0,	NULL },
+	{ "4",	16,	50,	"0",	0,	30,	"thirty" },
+	{ "30",	17,	1,	"0",	0,	0,	NULL },
+	{ "30",	18,	50,	"0",	0,	0,	NULL },
+	{ "0",	19,	19,	"0",	0,	0,	NULL },
+	{ "4",	20,	19,	"0",	0,	40,	"forty" },
+};
+
+#define TEST_NRECS	(CS_INT)(sizeof (Test_recs) / sizeof (Test_recs[0]))
+#define TEST_SCAN1	15
+
+/*
+** A row change expected out of the batcher: the record numbers of its
+** transaction, of the transaction's ENDXACT and of its own record, its
+** operation and the id of its row.
+*/
+typedef struct _test_expect
+{
+	CS_INT		xact;
+	CS_INT		commit;
+	CS_INT		row;
+	CS_INT		op;
+	CS_CHAR		*id;
+} TEST_EXPECT;
+
+CS_STATIC TEST_EXPECT Test_expect[] = {
+	{ 2,	11,	4,	LT_OP_INSERT,		"10" },
+	{ 2,	11,	10,	LT_OP_INSERT,		"12" },
+	{ 1,	17,	3,	LT_OP_INSERT,		"1" },
+	{ 1,	17,	8,	LT_OP_UPDATE_BEFORE,	"1" },
+	{ 1,	17,	9,	LT_OP_UPDATE_AFTER,	"1" },
+	{ 50,	18,	16,	LT_OP_INSERT,		"30" },
+};
+
+#define TEST_NEXPECT	(CS_INT)(sizeof (Test_expect) / sizeof (Test_expect[0]))
+
+/*
+** A row change written to the recording sink.
+*/
+typedef struct _test_out
+{
+	CS_UBIGINT	xactid;
+	CS_UBIGINT	commitpos;
+	CS_BIGINT	committime;
+	CS_UBIGINT	pos;
+	CS_INT		op;
+	CS_CHAR		table[TEST_VALUELEN];
+	CS_INT		numcols;
+	CS_BOOL		null[TEST_IMAGECOLS];
+	CS_CHAR		values[TEST_IMAGECOLS][TEST_VALUELEN];
+} TEST_OUT;
+
+/*
+** The recording sink.
+*/
+typedef struct _test_sink
+{
+	LT_SINK		sink;
+	LT_COLUMN	*columns;
+	CS_INT		maxcols;
+	CS_INT		nout;
+	CS_INT		overflow;
+	TEST_OUT	out[TEST_MAXOUT];
+} TEST_SINK;
+
+CS_STATIC TEST_SINK Test_sink;
+
+/*
+** The globals and routines of logtransfer.c driven.
+*/
+extern CS_CONTEXT	*Cs_context;
+extern CS_BOOL		Ex_display;
+extern LT_XACT_INDEX	Lt_open_xacts;
+extern LT_LOGPOS	Lt_scan_pos;
+extern LT_LOGPOS	Lt_resume_pos;
+extern CS_BOOL		Lt_resuming;
+extern CS_BOOL		Lt_resume_based;
+extern LT_BATCHER	Lt_batcher;
+
+extern CS_RETCODE CS_PUBLIC handle_logtransfer_scan_results(CS_COMMAND *cmd);
+
+/*****************************************************************************
+**
+** capture functions
+**
+*****************************************************************************/
+
+/*
+** test_fmt()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Describe the columns of a result as ct_describe() would.
+**
+** Parameters:
+** 	cols		- The columns.
+** 	numcols		- Their number.
+** 	fmt		- Set to their descriptions.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_fmt(TEST_COL *cols, CS_INT numcols, CS_DATAFMT *fmt)
+{
+	CS_INT		i;
+
+	for (i = 0; i < numcols; i++)
+	{
+		memset(&fmt[i], 0, sizeof (fmt[i]));
+		strncpy(fmt[i].name, cols[i].name, sizeof (fmt[i].name) - 1);
+		fmt[i].namelen = (CS_INT)strlen(fmt[i].name);
+		fmt[i].datatype = cols[i].datatype;
+		fmt[i].format = CS_FMT_UNUSED;
+		fmt[i].maxlength = cols[i].maxlength;
+		fmt[i].precision = cols[i].precision;
+		fmt[i].scale = cols[i].scale;
+		fmt[i].status = CS_CANBENULL;
+	}
+}
+
+/*
+** test_set()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Set the native value of a column of a row.
+**
+** Parameters:
+** 	col		- The column.
+** 	value		- The value, or NULL for a null.
+** 	len		- Its length.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_set(EX_COLUMN_DATA *col, CS_VOID *value, CS_INT len)
+{
+	col->indicator = (value == NULL) ? CS_NULLDATA : 0;
+	col->valuelen = (value == NULL) ? 0 : len;
+	if (value != NULL)
+	{
+		memcpy(col->value, value, len);
+	}
+}
+
+/*
+** test_put()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Write a result of one row to a capture, as the server returns
+** 	each record of a scan.
+**
+** Parameters:
+** 	out		- The capture.
+** 	cols		- The columns.
+** 	numcols		- Their number.
+** 	coldata		- The values.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure of the capture writer.
+*/
+
+CS_STATIC CS_RETCODE
+test_put(LT_CAPTURE_OUT *out, TEST_COL *cols, CS_INT numcols,
+	 EX_COLUMN_DATA *coldata)
+{
+	CS_DATAFMT	fmt[TEST_OPCOLS];
+	CS_RETCODE	retcode;
+
+	test_fmt(cols, numcols, fmt);
+	if ((retcode = lt_capture_put_result(out, CS_ROW_RESULT, 0, numcols,
+					     fmt)) != CS_SUCCEED ||
+	    (retcode = lt_capture_put_row(out, numcols, coldata)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	return lt_capture_put_result(out, CS_CMD_DONE, 0, 0, NULL);
+}
+
+/*
+** test_image()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Fill in the native values of the row image of a record. The
+** 	amount is the id plus a quarter, the time the id's day past
+** 	2023-01-01, the price the id plus a half, and the flag the id's
+** 	lowest bit.
+**
+** Parameters:
+** 	rec		- The record.
+** 	coldata		- The values.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_image(TEST_REC *rec, EX_COLUMN_DATA *coldata)
+{
+	CS_NUMERIC	num;
+	CS_DATETIME	dt;
+	CS_MONEY	mny;
+	CS_BYTE		hash[4];
+	CS_BYTE		bit;
+	CS_INT		amount;
+
+	test_set(&coldata[0], &rec->id, sizeof (rec->id));
+	test_set(&coldata[1], rec->name,
+		 (rec->name == NULL) ? 0 : (CS_INT)strlen(rec->name));
+
+	/*
+	** Numeric(10,2): a sign byte, then 5 bytes of magnitude, most
+	** significant first.
+	*/
+	memset(&num, 0, sizeof (num));
+	num.precision = 10;
+	num.scale = 2;
+	amount = rec->id * 100 + 25;
+	num.array[5] = (CS_BYTE)(amount & 0xff);
+	num.array[4] = (CS_BYTE)((amount >> 8) & 0xff);
+	num.array[3] = (CS_BYTE)((amount >> 16) & 0xff);
+	test_set(&coldata[2], &num, sizeof (num));
+
+	dt.dtdays = 44925 + rec->id;
+	dt.dttime = 300 * 3600;
+	test_set(&coldata[3], &dt, sizeof (dt));
+
+	mny.mnyhigh = 0;
+	mny.mnylow = (CS_UINT)(rec->id * 10000 + 5000);
+	test_set(&coldata[4], &mny, sizeof (mny));
+
+	hash[0] = (CS_BYTE)rec->id;
+	hash[1] = 0xab;
+	hash[2] = 0xcd;
+	hash[3] = 0xef;
+	test_set(&coldata[5], hash, sizeof (hash));
+
+	bit = (CS_BYTE)(rec->id & 1);
+	test_set(&coldata[6], &bit, sizeof (bit));
+}
+
+/*
+** test_record()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Write a log record to a capture, with the result of its row image
+** 	following an INSERT or DELETE.
+**
+** Parameters:
+** 	out		- The capture.
+** 	rec		- The record.
+** 	coldata		- Room for the values of any result.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure of the capture writer.
+*/
+
+CS_STATIC CS_RETCODE
+test_record(LT_CAPTURE_OUT *out, TEST_REC *rec, EX_COLUMN_DATA *coldata)
+{
+	CS_RETCODE	retcode;
+	CS_DATETIME	dt;
+	CS_INT		page = TEST_PAGE;
+	CS_INT		zero = 0;
+
+	test_set(&coldata[0], rec->op, (CS_INT)strlen(rec->op));
+	test_set(&coldata[1], &page, sizeof (page));
+	test_set(&coldata[2], &rec->xact, sizeof (rec->xact));
+
+	if (strcmp(rec->op, "26") == 0)
+	{
+		test_set(&coldata[3], &page, sizeof (page));
+		test_set(&coldata[4], &rec->undone, sizeof (rec->undone));
+		test_set(&coldata[5], &zero, sizeof (zero));
+		test_set(&coldata[6], &zero, sizeof (zero));
+		test_set(&coldata[7], &page, sizeof (page));
+		test_set(&coldata[8], &rec->row, sizeof (rec->row));
+		return test_put(out, Test_clrcols, TEST_CLRCOLS, coldata);
+	}
+
+	test_set(&coldata[3], rec->status, (CS_INT)strlen(rec->status));
+	test_set(&coldata[4], &page, sizeof (page));
+	test_set(&coldata[5], &rec->row, sizeof (rec->row));
+	test_set(&coldata[6], NULL, 0);
+	test_set(&coldata[7], "sa", 2);
+	if (strcmp(rec->op, "30") == 0)
+	{
+		dt.dtdays = 45000;
+		dt.dttime = 300 * 3600;
+		test_set(&coldata[8], &dt, sizeof (dt));
+		return test_put(out, Test_endcols, TEST_ENDCOLS, coldata);
+	}
+	if (strcmp(rec->op, "4") != 0 && strcmp(rec->op, "5") != 0)
+	{
+		test_set(&coldata[8], NULL, 0);
+		test_set(&coldata[9], NULL, 0);
+		return test_put(out, Test_opcols, TEST_OPCOLS, coldata);
+	}
+
+	test_set(&coldata[7], NULL, 0);
+	test_set(&coldata[8], "t", 1);
+	test_set(&coldata[9], "dbo", 3);
+	if ((retcode = test_put(out, Test_opcols, TEST_OPCOLS,
+				coldata)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	test_image(rec, coldata);
+	return test_put(out, Test_imagecols, TEST_IMAGECOLS, coldata);
+}
+
+/*
+** test_capture()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Write the capture of the test records, as two scans.
+**
+** Parameters:
+** 	path		- The capture file.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure of the capture writer.
+*/
+
+CS_STATIC CS_RETCODE
+test_capture(CS_CHAR *path)
+{
+	LT_CAPTURE_OUT	out;
+	EX_COLUMN_DATA	coldata[TEST_OPCOLS];
+	CS_CHAR		values[TEST_OPCOLS][64];
+	CS_RETCODE	retcode;
+	CS_INT		i;
+
+	for (i = 0; i < TEST_OPCOLS; i++)
+	{
+		coldata[i].value = values[i];
+	}
+	if ((retcode = lt_capture_create(path, &out)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	for (i = 0; i < TEST_NRECS && retcode == CS_SUCCEED; i++)
+	{
+		if (i == 0 || i == TEST_SCAN1)
+		{
+			retcode = (i == 0) ? CS_SUCCEED :
+				lt_capture_put_end(&out, CS_END_RESULTS);
+			if (retcode == CS_SUCCEED)
+			{
+				retcode = lt_capture_put_scan(&out);
+			}
+		}
+		if (retcode == CS_SUCCEED)
+		{
+			retcode = test_record(&out, &Test_recs[i], coldata);
+		}
+	}
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = lt_capture_put_end(&out, CS_END_RESULTS);
+	}
+	if (lt_capture_close(&out) != CS_SUCCEED && retcode == CS_SUCCEED)
+	{
+		retcode = CS_FAIL;
+	}
+	return retcode;
+}
+
+/*****************************************************************************
+**
+** sink functions
+**
+*****************************************************************************/
+
+/*
+** test_write()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Record the row changes of a batch.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	batch		- The batch.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a change is malformed.
+*/
+
+CS_STATIC CS_RETCODE
+test_write(LT_SINK *sink, LT_BATCH *batch)
+{
+	TEST_SINK	*ts = (TEST_SINK *)sink->ctx;
+	LT_BATCH_XACT	*bx;
+	LT_CHANGE	change;
+	TEST_OUT	*out;
+	CS_INT		x;
+	CS_INT		off;
+	CS_INT		len;
+	CS_INT		n;
+	CS_INT		i;
+
+	for (x = 0; x < batch->nxacts; x++)
+	{
+		bx = &batch->xacts[x];
+		for (off = bx->offset; off < bx->offset + bx->len; off += len)
+		{
+			len = lt_change_decode(batch->changes.data + off,
+				bx->offset + bx->len - off, &change,
+				&ts->columns, &ts->maxcols);
+			if (len == 0)
+			{
+				return CS_FAIL;
+			}
+			if (ts->nout == TEST_MAXOUT)
+			{
+				ts->overflow++;
+				continue;
+			}
+			out = &ts->out[ts->nout++];
+			memset(out, 0, sizeof (*out));
+			out->xactid = bx->xactid;
+			out->commitpos = bx->commitpos;
+			out->committime = bx->committime;
+			out->pos = change.pos;
+			out->op = change.op;
+			snprintf(out->table, sizeof (out->table), "%.*s.%.*s",
+				 (int)change.ownerlen, change.owner,
+				 (int)change.tablelen, change.table);
+			out->numcols = change.numcols;
+			n = (change.numcols < TEST_IMAGECOLS) ?
+				change.numcols : TEST_IMAGECOLS;
+			for (i = 0; i < n; i++)
+			{
+				out->null[i] = (change.columns[i].indicator ==
+						CS_NULLDATA);
+				snprintf(out->values[i], TEST_VALUELEN, "%.*s",
+					 (int)change.columns[i].valuelen,
+					 change.columns[i].value);
+			}
+		}
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** test_close()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Close the sink; it is not freed.
+**
+** Parameters:
+** 	sink		- The sink.
+**
+** Returns:
+** 	CS_SUCCEED
+*/
+
+CS_STATIC CS_RETCODE
+test_close(LT_SINK *sink)
+{
+	return CS_SUCCEED;
+}
+
+/*****************************************************************************
+**
+** test functions
+**
+*****************************************************************************/
+
+/*
+** test_key()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Make the position key of a record of the test page.
+**
+** Parameters:
+** 	row		- The record number.
+**
+** Returns:
+** 	The key.
+*/
+
+CS_STATIC CS_UBIGINT
+test_key(CS_INT row)
+{
+	LT_LOGPOS	pos;
+
+	pos.page = TEST_PAGE;
+	pos.row = (CS_UINT)row;
+	return LT_LOGPOS_KEY(pos);
+}
+
+/*
+** test_reset()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Start the scan state over, as a new run of the program would, and
+** 	empty the recording sink.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_reset(CS_VOID)
+{
+	lt_xact_cleanup(&Lt_open_xacts);
+	lt_xact_init(&Lt_open_xacts);
+	memset(&Lt_scan_pos, 0, sizeof (Lt_scan_pos));
+	memset(&Lt_resume_pos, 0, sizeof (Lt_resume_pos));
+	Lt_resuming = CS_FALSE;
+	Lt_resume_based = CS_FALSE;
+	Test_sink.nout = 0;
+	Test_sink.overflow = 0;
+}
+
+/*
+** test_scan()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Run the next scan of the capture and write out the transactions it
+** 	committed.
+**
+** Parameters:
+** 	cmd		- The command structure.
+**
+** Returns:
+** 	CS_SUCCEED, or the failure of the scan or the output.
+*/
+
+CS_STATIC CS_RETCODE
+test_scan(CS_COMMAND *cmd)
+{
+	CS_RETCODE	retcode;
+
+	if ((retcode = ct_command(cmd, CS_LANG_CMD,
+			"dbcc logtransfer('scan', 'normal', '')",
+			CS_NULLTERM, CS_UNUSED)) != CS_SUCCEED ||
+	    (retcode = ct_send(cmd)) != CS_SUCCEED ||
+	    (retcode = handle_logtransfer_scan_results(cmd)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	lt_out_flush();
+	return lt_batch_flush(&Lt_batcher);
+}
+
+/*
+** test_output()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Check that the row changes recorded are the expected ones from
+** 	'first' on, in order.
+**
+** Parameters:
+** 	first		- The first expected change.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_output(CS_INT first)
+{
+	TEST_EXPECT	*e;
+	TEST_OUT	*out;
+	CS_INT		i;
+
+	TEST_CHECK(Test_sink.overflow == 0);
+	if (!TEST_CHECK(Test_sink.nout == TEST_NEXPECT - first))
+	{
+		return;
+	}
+	for (i = 0; i < Test_sink.nout; i++)
+	{
+		e = &Test_expect[first + i];
+		out = &Test_sink.out[i];
+		TEST_CHECK(out->xactid == test_key(e->xact));
+		TEST_CHECK(out->commitpos == test_key(e->commit));
+		TEST_CHECK(out->pos == test_key(e->row));
+		TEST_CHECK(out->op == e->op);
+		TEST_CHECK(strcmp(out->table, "dbo.t") == 0);
+		TEST_CHECK(out->numcols == TEST_IMAGECOLS);
+		TEST_CHECK(strcmp(out->values[0], e->id) == 0);
+	}
+}
+
+/*
+** test_decoded()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Check the column values of the update of transaction 1, as
+** 	converted from their native forms, and its commit time.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_decoded(CS_VOID)
+{
+	static CS_CHAR	*before[TEST_IMAGECOLS] = { "1", "one", "1.25",
+		"20230102 01:00:00:000", "1.50", "01abcdef", "1" };
+	TEST_OUT	*out;
+	CS_INT		i;
+
+	if (!TEST_CHECK(Test_sink.nout >= 5))
+	{
+		return;
+	}
+
+	out = &Test_sink.out[3];
+	for (i = 0; i < TEST_IMAGECOLS; i++)
+	{
+		TEST_CHECK(!out->null[i]);
+		TEST_CHECK(strcmp(out->values[i], before[i]) == 0);
+	}
+
+	out = &Test_sink.out[4];
+	TEST_CHECK(out->null[1] && out->values[1][0] == '\0');
+	TEST_CHECK(!out->null[0] && !out->null[2]);
+
+	/*
+	** 45000 days past 1900-01-01, and an hour.
+	*/
+	TEST_CHECK(out->committime ==
+		   ((CS_BIGINT)(45000 - 25567) * 86400 + 3600) * 1000000);
+}
+
+/*
+** test_replay()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Replay the capture in one run, and again in a run restarted from a
+** 	checkpoint taken between its scans.
+**
+** Parameters:
+** 	connection	- The connection, opened on the capture.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_replay(CS_CONNECTION *connection)
+{
+	CS_COMMAND	*cmd;
+	CS_CHAR		path[256];
+	CS_BOOL		loaded = CS_FALSE;
+	LT_XACT		*xact;
+	LT_LOGPOS	begin;
+
+	if (!TEST_CHECK(ct_cmd_alloc(connection, &cmd) == CS_SUCCEED))
+	{
+		return;
+	}
+
+	/*
+	** One run.
+	*/
+	test_reset();
+	TEST_CHECK(test_scan(cmd) == CS_SUCCEED);
+	TEST_CHECK(Test_sink.nout == 2);
+	TEST_CHECK(test_scan(cmd) == CS_SUCCEED);
+	test_output(0);
+	test_decoded();
+	TEST_CHECK(Lt_open_xacts.count == 1);
+	begin.page = TEST_PAGE;
+	begin.row = 19;
+	TEST_CHECK((xact = lt_xact_find(&Lt_open_xacts, &begin)) != NULL &&
+		   xact->nchanges == 1);
+	TEST_CHECK(LT_LOGPOS_KEY(Lt_scan_pos) == test_key(20));
+
+	/*
+	** A run checkpointed after the first scan, and one restarted from
+	** the checkpoint, which scans the log from its start again.
+	*/
+	test_path("testreplay.ckpt", path, sizeof (path));
+	test_reset();
+	ct_close(connection, CS_UNUSED);
+	TEST_CHECK(ct_connect(connection, NULL, 0) == CS_SUCCEED);
+	TEST_CHECK(test_scan(cmd) == CS_SUCCEED);
+	TEST_CHECK(Test_sink.nout == 2 && Lt_open_xacts.count == 1);
+	TEST_CHECK(lt_ckpt_write(path, &Lt_open_xacts,
+				 &Lt_scan_pos) == CS_SUCCEED);
+
+	test_reset();
+	TEST_CHECK(lt_ckpt_load(path, &Lt_open_xacts, &Lt_scan_pos,
+				&loaded) == CS_SUCCEED && loaded);
+	remove(path);
+	TEST_CHECK(Lt_open_xacts.count == 1);
+	TEST_CHECK(LT_LOGPOS_KEY(Lt_scan_pos) == test_key(15));
+	Lt_resume_pos = Lt_scan_pos;
+	Lt_resuming = CS_TRUE;
+
+	ct_close(connection, CS_UNUSED);
+	TEST_CHECK(ct_connect(connection, NULL, 0) == CS_SUCCEED);
+	TEST_CHECK(test_scan(cmd) == CS_SUCCEED);
+	TEST_CHECK(Test_sink.nout == 0);
+	TEST_CHECK(LT_LOGPOS_KEY(Lt_scan_pos) == test_key(15));
+	TEST_CHECK(test_scan(cmd) == CS_SUCCEED);
+	TEST_CHECK(!Lt_resuming);
+	test_output(2);
+	TEST_CHECK(Lt_open_xacts.count == 1);
+
+	ct_cmd_drop(cmd);
+}
+
+/*
+** test_stdout()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Replay the capture, displaying its results, into a JSON Lines sink
+** 	writing to stdout, and check that stdout carries its lines and
+** 	nothing else: the display and the messages go to stderr. Stdout
+** 	stays claimed by the sink, so this is the last test to run.
+**
+** Parameters:
+** 	connection	- The connection, opened on the capture.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_stdout(CS_CONNECTION *connection)
+{
+	CS_COMMAND	*cmd;
+	LT_SINK		*sink;
+	CS_CHAR		path[256];
+	CS_CHAR		errpath[256];
+	CS_CHAR		line[1024];
+	CS_BOOL		display = CS_FALSE;
+	CS_BOOL		message = CS_FALSE;
+	FILE		*fp;
+	CS_INT		n = 0;
+	CS_INT		len;
+	int		err;
+	int		fd;
+	int		efd;
+
+	test_path("testreplay.out", path, sizeof (path));
+	test_path("testreplay.err", errpath, sizeof (errpath));
+	lt_out_flush();
+	fflush(stdout);
+	fflush(stderr);
+	if (!TEST_CHECK((err = dup(STDERR_FILENO)) >= 0))
+	{
+		return;
+	}
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	efd = open(errpath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (!TEST_CHECK(fd >= 0 && efd >= 0 &&
+			dup2(fd, STDOUT_FILENO) >= 0 &&
+			dup2(efd, STDERR_FILENO) >= 0))
+	{
+		close(err);
+		return;
+	}
+	close(fd);
+	close(efd);
+
+	/*
+	** Until stderr is back, the failures of checks go to its file and
+	** are only counted.
+	*/
+	test_reset();
+	lt_batch_cleanup(&Lt_batcher);
+	if (TEST_CHECK(lt_json_open("-", &sink) == CS_SUCCEED))
+	{
+		lt_batch_init(&Lt_batcher, sink, 0, 0, 0);
+		Ex_display = CS_TRUE;
+		ex_msg("testreplay: a message while the sink has stdout");
+		ct_close(connection, CS_UNUSED);
+		TEST_CHECK(ct_connect(connection, NULL, 0) == CS_SUCCEED);
+		if (TEST_CHECK(ct_cmd_alloc(connection, &cmd) == CS_SUCCEED))
+		{
+			TEST_CHECK(test_scan(cmd) == CS_SUCCEED);
+			TEST_CHECK(test_scan(cmd) == CS_SUCCEED);
+			ct_cmd_drop(cmd);
+		}
+		Ex_display = CS_FALSE;
+		lt_batch_cleanup(&Lt_batcher);
+		TEST_CHECK(sink->close(sink) == CS_SUCCEED);
+		lt_batch_init(&Lt_batcher, &Test_sink.sink, 0, 0, 0);
+	}
+	lt_out_flush();
+	fflush(stdout);
+	fflush(stderr);
+	TEST_CHECK(dup2(err, STDERR_FILENO) >= 0);
+	close(err);
+
+	/*
+	** The inserts of 2, the insert and update of 1, and the insert of
+	** 50, one line each.
+	*/
+	if (TEST_CHECK((fp = fopen(path, "r")) != NULL))
+	{
+		while (fgets(line, sizeof (line), fp) != NULL)
+		{
+			n++;
+			len = strlen(line);
+			TEST_CHECK(len > 2 && line[0] == '{' &&
+				   strcmp(line + len - 2, "}\n") == 0);
+		}
+		fclose(fp);
+	}
+	TEST_CHECK(n == 5);
+	remove(path);
+
+	if (TEST_CHECK((fp = fopen(errpath, "r")) != NULL))
+	{
+		while (fgets(line, sizeof (line), fp) != NULL)
+		{
+			display |= (strcmp(line, "ROW RESULTS\n") == 0);
+			message |= (strstr(line, "a message while") != NULL);
+		}
+		fclose(fp);
+	}
+	TEST_CHECK(display && message);
+	remove(errpath);
+}
+
+int
+main(int argc, char *argv[])
+{
+	CS_CONNECTION	*connection;
+	CS_CHAR		path[256];
+	int		out;
+	int		fd;
+
+	/*
+	** The results of the scans are displayed as they are processed;
+	** they go to /dev/null, and only the checks to what was stdout.
+	*/
+	fflush(stdout);
+	if ((out = dup(STDOUT_FILENO)) < 0 ||
+	    (fd = open("/dev/null", O_WRONLY)) < 0 ||
+	    dup2(fd, STDOUT_FILENO) < 0)
+	{
+		ex_error("testreplay: redirecting stdout failed");
+		return EX_EXIT_FAIL;
+	}
+	close(fd);
+
+	Ex_display = CS_FALSE;
+	Test_sink.sink.name = "test";
+	Test_sink.sink.write = test_write;
+	Test_sink.sink.close = test_close;
+	Test_sink.sink.ctx = &Test_sink;
+	lt_xact_init(&Lt_open_xacts);
+	lt_batch_init(&Lt_batcher, &Test_sink.sink, 0, 0, 0);
+
+	test_path("testreplay.capture", path, sizeof (path));
+	if (TEST_CHECK(test_capture(path) == CS_SUCCEED) &&
+	    TEST_CHECK(setenv("LT_REPLAY", path, 1) == 0) &&
+	    TEST_CHECK(ex_init(&Cs_context) == CS_SUCCEED) &&
+	    TEST_CHECK(ex_connect(Cs_context, &connection, "testreplay",
+				  EX_USERNAME, EX_PASSWORD,
+				  EX_SERVER) == CS_SUCCEED))
+	{
+		test_replay(connection);
+		test_stdout(connection);
+		ex_con_cleanup(connection, CS_SUCCEED);
+	}
+	remove(path);
+
+	lt_batch_cleanup(&Lt_batcher);
+	lt_xact_cleanup(&Lt_open_xacts);
+	free(Test_sink.columns);
+
+	lt_out_flush();
+	if (dup2(out, STDOUT_FILENO) < 0)
+	{
+		return EX_EXIT_FAIL;
+	}
+	close(out);
+	return test_done("testreplay");
+}
@@ -0,0 +1,350 @@
+/*
+** Description
+** -----------
+** 	Tests of the segment sink of ltsegment.c: batches written to it
+** 	roll over to a new segment once the open one is full, and read back
+** 	through the codec of ltlz.c whole, compressed or stored, with the
+** 	positions and times of their blocks in the footer of each segment.
+** 	A segment left without a footer is read to its end, and a torn
+** 	last block is reported.
+**
+** 	Usage: testsegment
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltbatch.h"
+#include "ltsink.h"
+#include "ltsegment.h"
+#include "testutils.h"
+
+/*
+** Number of test batches, and of transactions in each at most.
+*/
+#define TEST_NBATCHES	4
+#define TEST_MAXXACTS	2
+
+/*
+** Segments are closed once this long: after two compressed batches, or
+** one stored.
+*/
+#define TEST_MAXBYTES	128
+
+/*
+** A test batch, with the segment and block it is expected in.
+*/
+typedef struct _test_batch
+{
+	LT_BATCH	batch;
+	LT_BATCH_XACT	xacts[TEST_MAXXACTS];
+	CS_INT		segment;
+	CS_BOOL		stored;
+} TEST_BATCH;
+
+/*
+** test_fill()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Set up batch 'n', of 'nxacts' transactions of 'len' bytes of
+** 	changes each. Those of a stored batch do not compress.
+**
+** Parameters:
+** 	tb		- The batch.
+** 	n		- Number of the batch, from 1.
+** 	nxacts		- Number of transactions.
+** 	len		- Length of the changes of each.
+** 	segment		- Number of the segment it goes to, from 1.
+** 	stored		- Whether its block is stored uncompressed.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_MEM_ERROR if a realloc failed.
+*/
+
+CS_STATIC CS_RETCODE
+test_fill(TEST_BATCH *tb, CS_INT n, CS_INT nxacts, CS_INT len,
+	  CS_INT segment, CS_BOOL stored)
+{
+	LT_BATCH_XACT	*bx;
+	CS_UINT		seed = (CS_UINT)n;
+	CS_INT		i;
+	CS_INT		j;
+
+	memset(tb, 0, sizeof (*tb));
+	if (lt_buf_reserve(&tb->batch.changes, nxacts * len) != CS_SUCCEED)
+	{
+		return CS_MEM_ERROR;
+	}
+	tb->batch.xacts = tb->xacts;
+	tb->batch.nxacts = nxacts;
+	tb->batch.maxxacts = TEST_MAXXACTS;
+	for (i = 0; i < nxacts; i++)
+	{
+		bx = &tb->xacts[i];
+		bx->xactid = (CS_UBIGINT)(n * 1000 + i * 10);
+		bx->commitpos = bx->xactid + 5;
+		bx->committime = (CS_BIGINT)(n * 1000000 + i);
+		bx->offset = tb->batch.changes.len;
+		bx->len = len;
+		bx->nchanges = 1;
+		for (j = 0; j < len; j++)
+		{
+			seed = seed * 1103515245 + 12345;
+			tb->batch.changes.data[bx->offset + j] = stored ?
+				(CS_BYTE)(seed >> 16) : (CS_BYTE)('a' + n + i);
+		}
+		tb->batch.changes.len += len;
+		tb->batch.nchanges++;
+		tb->batch.lastpos = bx->commitpos;
+	}
+	tb->segment = segment;
+	tb->stored = stored;
+	return CS_SUCCEED;
+}
+
+/*
+** test_block()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Check a block read back against the batch written to it.
+**
+** Parameters:
+** 	raw		- The batch read back.
+** 	tb		- The batch written.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_block(LT_BUF *raw, TEST_BATCH *tb)
+{
+	LT_BUF		expect;
+
+	memset(&expect, 0, sizeof (expect));
+	if (!TEST_CHECK(lt_sink_encode(&expect, &tb->batch) == CS_SUCCEED))
+	{
+		return;
+	}
+	TEST_CHECK(raw->len == expect.len + tb->batch.changes.len);
+	if (raw->len == expect.len + tb->batch.changes.len)
+	{
+		TEST_CHECK(memcmp(raw->data, expect.data, expect.len) == 0);
+		TEST_CHECK(memcmp(raw->data + expect.len,
+				  tb->batch.changes.data,
+				  tb->batch.changes.len) == 0);
+	}
+	lt_buf_free(&expect);
+}
+
+/*
+** test_segment()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Read a closed segment back, checking its blocks against the
+** 	batches written to it and its footer against their positions and
+** 	times.
+**
+** Parameters:
+** 	path		- Path of the segment.
+** 	tbs		- The batches written.
+** 	segment		- Number of the segment, from 1.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_segment(CS_CHAR *path, TEST_BATCH *tbs, CS_INT segment)
+{
+	LT_SEGMENT_READER	rd;
+	LT_SEGMENT_RANGE	range;
+	LT_BATCH_XACT		*first;
+	LT_BATCH_XACT		*last;
+	LT_BUF			raw;
+	TEST_BATCH		*tb;
+	CS_BIGINT		offset;
+	CS_UINT			flags;
+	CS_UINT			n = 0;
+	CS_INT			i;
+
+	if (!TEST_CHECK(lt_segment_map(path, &rd) == CS_SUCCEED))
+	{
+		return;
+	}
+	memset(&raw, 0, sizeof (raw));
+	for (i = 0; i < TEST_NBATCHES; i++)
+	{
+		tb = &tbs[i];
+		if (tb->segment != segment)
+		{
+			continue;
+		}
+		first = &tb->xacts[0];
+		last = &tb->xacts[tb->batch.nxacts - 1];
+		if (n == 0)
+		{
+			TEST_CHECK(rd.range.firstpos == first->commitpos);
+			TEST_CHECK(rd.range.firsttime == first->committime);
+		}
+
+		TEST_CHECK(lt_segment_index(&rd, n, &offset, &range) ==
+			   CS_SUCCEED);
+		TEST_CHECK(offset == rd.off);
+		TEST_CHECK(range.firstpos == first->commitpos &&
+			   range.lastpos == tb->batch.lastpos);
+		TEST_CHECK(range.firsttime == first->committime &&
+			   range.lasttime == last->committime);
+
+		memcpy(&flags, rd.data + rd.off + sizeof (flags),
+		       sizeof (flags));
+		TEST_CHECK((flags & LT_SEGMENT_STORED) ==
+			   (tb->stored ? LT_SEGMENT_STORED : 0));
+		if (!TEST_CHECK(lt_segment_next(&rd, &raw) == CS_SUCCEED))
+		{
+			break;
+		}
+		test_block(&raw, tb);
+		n++;
+	}
+	TEST_CHECK(n == rd.nblocks);
+	TEST_CHECK(n > 0 && rd.range.lastpos == range.lastpos &&
+		   rd.range.lasttime == range.lasttime);
+	TEST_CHECK(rd.off == rd.end);
+	TEST_CHECK(lt_segment_next(&rd, &raw) == CS_END_DATA);
+	TEST_CHECK(lt_segment_index(&rd, n, &offset, &range) == CS_FAIL);
+	lt_buf_free(&raw);
+	lt_segment_unmap(&rd);
+}
+
+/*
+** test_unfinished()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	A segment cut before its footer is read block by block to its end,
+** 	and one cut inside its last block fails on it.
+**
+** Parameters:
+** 	path		- Path of a closed segment of one block.
+** 	tb		- The batch written to it.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_unfinished(CS_CHAR *path, TEST_BATCH *tb)
+{
+	LT_SEGMENT_READER	rd;
+	LT_BUF			raw;
+	CS_BIGINT		end;
+
+	if (!TEST_CHECK(lt_segment_map(path, &rd) == CS_SUCCEED))
+	{
+		return;
+	}
+	end = rd.end;
+	lt_segment_unmap(&rd);
+	memset(&raw, 0, sizeof (raw));
+
+	TEST_CHECK(truncate(path, end) == 0);
+	if (TEST_CHECK(lt_segment_map(path, &rd) == CS_SUCCEED))
+	{
+		TEST_CHECK(rd.nblocks == 0 && rd.end == end);
+		TEST_CHECK(lt_segment_next(&rd, &raw) == CS_SUCCEED);
+		test_block(&raw, tb);
+		TEST_CHECK(lt_segment_next(&rd, &raw) == CS_END_DATA);
+		lt_segment_unmap(&rd);
+	}
+
+	TEST_CHECK(truncate(path, end - 1) == 0);
+	if (TEST_CHECK(lt_segment_map(path, &rd) == CS_SUCCEED))
+	{
+		TEST_CHECK(lt_segment_next(&rd, &raw) == CS_FAIL);
+		lt_segment_unmap(&rd);
+	}
+	lt_buf_free(&raw);
+}
+
+/*
+** test_rotate()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Batches written to a segment sink go to as many segments as its
+** 	size limit makes, and read back from them.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_rotate(CS_VOID)
+{
+	TEST_BATCH	tbs[TEST_NBATCHES];
+	CS_CHAR		prefix[512];
+	CS_CHAR		path[TEST_NBATCHES][600];
+	LT_SINK		*sink;
+	CS_INT		i;
+
+	test_path("testsegment", prefix, sizeof (prefix));
+	for (i = 0; i < TEST_NBATCHES; i++)
+	{
+		sprintf(path[i], "%s.%06d.lts", prefix, (int)(i + 1));
+		remove(path[i]);
+	}
+	TEST_CHECK(test_fill(&tbs[0], 1, 1, 2000, 1, CS_FALSE) == CS_SUCCEED);
+	TEST_CHECK(test_fill(&tbs[1], 2, 1, 2000, 1, CS_FALSE) == CS_SUCCEED);
+	TEST_CHECK(test_fill(&tbs[2], 3, 1, 8000, 2, CS_TRUE) == CS_SUCCEED);
+	TEST_CHECK(test_fill(&tbs[3], 4, 2, 500, 3, CS_FALSE) == CS_SUCCEED);
+
+	if (TEST_CHECK(lt_segment_open(prefix, TEST_MAXBYTES, 0, &sink) ==
+		       CS_SUCCEED))
+	{
+		for (i = 0; i < TEST_NBATCHES; i++)
+		{
+			TEST_CHECK(sink->write(sink, &tbs[i].batch) ==
+				   CS_SUCCEED);
+		}
+		TEST_CHECK(sink->close(sink) == CS_SUCCEED);
+
+		test_segment(path[0], tbs, 1);
+		test_segment(path[1], tbs, 2);
+		test_segment(path[2], tbs, 3);
+		TEST_CHECK(access(path[3], F_OK) != 0);
+		test_unfinished(path[2], &tbs[3]);
+	}
+
+	for (i = 0; i < TEST_NBATCHES; i++)
+	{
+		lt_buf_free(&tbs[i].batch.changes);
+		remove(path[i]);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	test_rotate();
+	return test_done("testsegment");
+}
@@ -0,0 +1,122 @@
+/*
+** Description
+** -----------
+** 	This file holds the checks shared by the test programs. A failed
+** 	check is reported on stderr with its source location and counted,
+** 	and the test goes on; the program exits with a failure status if
+** 	any check failed.
+**
+** 	Scratch files are made in the directory named by the TMPDIR
+** 	environment variable, or in /tmp, with the process id in their
+** 	names so that runs do not collide.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "testutils.h"
+
+/*
+** Checks made and failed so far.
+*/
+CS_STATIC CS_INT Test_checks;
+CS_STATIC CS_INT Test_failures;
+
+/*
+** test_check()
+**
+** Type of function:
+** 	test api
+**
+** Purpose:
+** 	Count a check, and report it if it failed. Called through
+** 	TEST_CHECK().
+**
+** Parameters:
+** 	ok		- Whether the condition holds.
+** 	cond		- The condition, as written.
+** 	file		- Source file of the check.
+** 	line		- Source line of the check.
+**
+** Returns:
+** 	'ok'
+*/
+
+CS_BOOL CS_PUBLIC
+test_check(CS_BOOL ok, CS_CHAR *cond, CS_CHAR *file, CS_INT line)
+{
+	Test_checks++;
+	if (!ok)
+	{
+		Test_failures++;
+		fprintf(stderr, "%s:%d: check failed: %s\n", file, (int)line,
+			cond);
+		fflush(stderr);
+	}
+	return ok;
+}
+
+/*
+** test_path()
+**
+** Type of function:
+** 	test api
+**
+** Purpose:
+** 	Build the path of a scratch file.
+**
+** Parameters:
+** 	name		- Name of the file, without the process id.
+** 	path		- Set to the path.
+** 	len		- Size of 'path'.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+test_path(CS_CHAR *name, CS_CHAR *path, CS_INT len)
+{
+	CS_CHAR		*dir;
+
+	if ((dir = getenv("TMPDIR")) == NULL || *dir == '\0')
+	{
+		dir = "/tmp";
+	}
+	snprintf(path, len, "%s/%s.%d", dir, name, (int)getpid());
+}
+
+/*
+** test_done()
+**
+** Type of function:
+** 	test api
+**
+** Purpose:
+** 	Report the checks made by a test program.
+**
+** Parameters:
+** 	program		- Name of the program.
+**
+** Returns:
+** 	The exit status of the program: EX_EXIT_SUCCEED if every check
+** 	held, EX_EXIT_FAIL otherwise.
+*/
+
+int CS_PUBLIC
+test_done(CS_CHAR *program)
+{
+	if (Test_failures > 0)
+	{
+		printf("%s: %d of %d checks failed\n", program,
+		       (int)Test_failures, (int)Test_checks);
+		return EX_EXIT_FAIL;
+	}
+	printf("%s: %d checks passed\n", program, (int)Test_checks);
+	return EX_EXIT_SUCCEED;
+}
@@ -0,0 +1,46 @@
+/*
+** Description
+** -----------
+** 	Header file which contains the defines and prototypes for the
+** 	checks shared by the test programs, in testutils.c.
+**
+*/
+
+#ifndef __TESTUTILS_H__
+#define __TESTUTILS_H__
+
+/*****************************************************************************
+**
+** defines and typedefs used
+**
+*****************************************************************************/
+
+/*
+** Check a condition, reporting it with its source location if it does
+** not hold. The test goes on either way.
+*/
+#define TEST_CHECK(_cond)	test_check((_cond) ? CS_TRUE : CS_FALSE, \
+					   #_cond, __FILE__, __LINE__)
+
+/*****************************************************************************
+**
+** protoypes for all public functions
+**
+*****************************************************************************/
+/* testutils.c */
+extern CS_BOOL CS_PUBLIC test_check(
+	CS_BOOL ok,
+	CS_CHAR *cond,
+	CS_CHAR *file,
+	CS_INT line
+	);
+extern CS_VOID CS_PUBLIC test_path(
+	CS_CHAR *name,
+	CS_CHAR *path,
+	CS_INT len
+	);
+extern int CS_PUBLIC test_done(
+	CS_CHAR *program
+	);
+
+#endif /* __TESTUTILS_H__ */
@@ -0,0 +1,760 @@
+/*
+** Description
+** -----------
+** 	Tests of the open transaction index of ltxact.c: the oldest open
+** 	transaction as the log wraps and among transactions that began
+** 	before the scan, the change buffer of a transaction through
+** 	savepoints and the compensation records of rollbacks, and the
+** 	records replayed into a restored transaction.
+**
+** 	Usage: testxact
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctpublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "ltchange.h"
+#include "ltxact.h"
+#include "ltdict.h"
+#include "testutils.h"
+
+/*
+** Most changes buffered by a test transaction.
+*/
+#define TEST_MAXCHANGES	16
+
+/*
+** Id of the table name of the test changes.
+*/
+CS_STATIC CS_UINT Test_table;
+
+/*
+** test_pos()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Make the log position of record 'row' of page 1.
+**
+** Parameters:
+** 	row		- Record number.
+**
+** Returns:
+** 	The position.
+*/
+
+CS_STATIC LT_LOGPOS
+test_pos(CS_UINT row)
+{
+	LT_LOGPOS	pos;
+
+	pos.page = 1;
+	pos.row = row;
+	return pos;
+}
+
+/*
+** test_append_at()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Buffer an insert without columns, made by the record at 'pos'.
+**
+** Parameters:
+** 	xact		- The open transaction.
+** 	pos		- Position of the record.
+**
+** Returns:
+** 	The return code of lt_xact_append().
+*/
+
+CS_STATIC CS_RETCODE
+test_append_at(LT_XACT *xact, LT_LOGPOS pos)
+{
+	LT_CHANGE	change;
+
+	memset(&change, 0, sizeof (change));
+	change.op = LT_OP_INSERT;
+	change.xactid = LT_LOGPOS_KEY(xact->begin);
+	change.pos = LT_LOGPOS_KEY(pos);
+	change.tableid = Test_table;
+	change.ownerid = Test_table;
+	return lt_xact_append(xact, &change);
+}
+
+/*
+** test_append()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Buffer an insert without columns, made by record 'row' of page 1.
+**
+** Parameters:
+** 	xact		- The open transaction.
+** 	row		- Record number.
+**
+** Returns:
+** 	The return code of lt_xact_append().
+*/
+
+CS_STATIC CS_RETCODE
+test_append(LT_XACT *xact, CS_UINT row)
+{
+	return test_append_at(xact, test_pos(row));
+}
+
+/*
+** test_rows()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	List the record numbers of the changes a transaction has buffered.
+**
+** Parameters:
+** 	xact		- The open transaction.
+** 	rows		- Set to the record numbers, oldest first.
+**
+** Returns:
+** 	The number of changes found in the buffer, or -1 if it does not
+** 	decode.
+*/
+
+CS_STATIC CS_INT
+test_rows(LT_XACT *xact, CS_UINT rows[])
+{
+	CS_UBIGINT	pos;
+	CS_INT		offset = 0;
+	CS_INT		reclen;
+	CS_INT		n = 0;
+
+	while (offset < xact->changes.len && n < TEST_MAXCHANGES)
+	{
+		reclen = lt_change_position(xact->changes.data + offset,
+			xact->changes.len - offset, &pos);
+		if (reclen == 0)
+		{
+			return -1;
+		}
+		rows[n++] = LT_LOGPOS_ROW(pos);
+		offset += reclen;
+	}
+	return n;
+}
+
+/*
+** test_expect()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Check that a transaction buffers the changes of records 1 to
+** 	'count', and that its count, change index and last position agree.
+**
+** Parameters:
+** 	xact		- The open transaction.
+** 	count		- Number of changes expected.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_expect(LT_XACT *xact, CS_INT count)
+{
+	CS_UINT		rows[TEST_MAXCHANGES];
+	CS_INT		n;
+	CS_INT		i;
+
+	n = test_rows(xact, rows);
+	TEST_CHECK(n == count);
+	TEST_CHECK(xact->nchanges == count);
+	for (i = 0; i < n && i < count; i++)
+	{
+		TEST_CHECK(rows[i] == (CS_UINT)(i + 1));
+		TEST_CHECK(LT_LOGPOS_ROW(xact->refs[i].pos) ==
+			(CS_UINT)(i + 1));
+	}
+	TEST_CHECK(xact->last.row == (CS_UINT)count);
+}
+
+/*
+** test_walk_page()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	lt_xact_walk() callback listing the BEGINXACT pages.
+**
+** Parameters:
+** 	xact		- The open transaction.
+** 	arg		- Pointer to the next entry of the page list.
+**
+** Returns:
+** 	CS_SUCCEED
+*/
+
+CS_STATIC CS_RETCODE
+test_walk_page(LT_XACT *xact, CS_VOID *arg)
+{
+	CS_UINT		**next = (CS_UINT **)arg;
+
+	*(*next)++ = xact->begin.page;
+	return CS_SUCCEED;
+}
+
+/*
+** test_scan_order()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	The oldest open transaction is the first the scan saw begin, also
+** 	once the log wraps onto lower page ids, and the walk goes in the
+** 	same order; ending transactions at either end or in the middle
+** 	keeps it.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_scan_order(CS_VOID)
+{
+	CS_UINT		pages[] = { 900, 950, 3, 7, 5 };
+	CS_UINT		walked[TEST_MAXCHANGES];
+	CS_UINT		*next;
+	LT_XACT_INDEX	index;
+	LT_LOGPOS	pos;
+	LT_LOGPOS	oldest;
+	CS_INT		i;
+
+	lt_xact_init(&index);
+	TEST_CHECK(!lt_xact_lowwater(&index, &oldest));
+	pos.row = 1;
+	for (i = 0; i < 5; i++)
+	{
+		pos.page = pages[i];
+		TEST_CHECK(lt_xact_begin(&index, &pos, NULL) == CS_SUCCEED);
+	}
+	TEST_CHECK(index.count == 5);
+	TEST_CHECK(lt_xact_lowwater(&index, &oldest) && oldest.page == 900);
+	next = walked;
+	TEST_CHECK(lt_xact_walk(&index, test_walk_page, &next) == CS_SUCCEED);
+	TEST_CHECK(next - walked == 5);
+	for (i = 0; i < 5; i++)
+	{
+		TEST_CHECK(walked[i] == pages[i]);
+	}
+
+	/*
+	** A replayed BEGINXACT does not move the transaction.
+	*/
+	pos.page = 900;
+	TEST_CHECK(lt_xact_begin(&index, &pos, NULL) == CS_SUCCEED);
+	TEST_CHECK(lt_xact_lowwater(&index, &oldest) && oldest.page == 900);
+
+	pos.page = 3;
+	TEST_CHECK(lt_xact_end(&index, &pos, NULL) == CS_SUCCEED);
+	pos.page = 900;
+	TEST_CHECK(lt_xact_end(&index, &pos, NULL) == CS_SUCCEED);
+	TEST_CHECK(lt_xact_lowwater(&index, &oldest) && oldest.page == 950);
+	pos.page = 5;
+	TEST_CHECK(lt_xact_end(&index, &pos, NULL) == CS_SUCCEED);
+	next = walked;
+	TEST_CHECK(lt_xact_walk(&index, test_walk_page, &next) == CS_SUCCEED);
+	TEST_CHECK(next - walked == 2);
+	TEST_CHECK(walked[0] == 950 && walked[1] == 7);
+	TEST_CHECK(lt_xact_find(&index, &pos) == NULL);
+	pos.page = 7;
+	TEST_CHECK(lt_xact_find(&index, &pos) != NULL);
+
+	pos.page = 950;
+	TEST_CHECK(lt_xact_end(&index, &pos, NULL) == CS_SUCCEED);
+	pos.page = 7;
+	TEST_CHECK(lt_xact_end(&index, &pos, NULL) == CS_SUCCEED);
+	TEST_CHECK(!lt_xact_lowwater(&index, &oldest));
+	TEST_CHECK(index.count == 0);
+	lt_xact_cleanup(&index);
+}
+
+/*
+** test_adopted()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Transactions first seen through a change began before the scan
+** 	did: they go ahead of every transaction seen to begin, in the order
+** 	they were adopted, and the oldest of them is the oldest open one.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_adopted(CS_VOID)
+{
+	CS_UINT		walked[TEST_MAXCHANGES];
+	CS_UINT		*next;
+	LT_XACT_INDEX	index;
+	LT_LOGPOS	pos;
+	LT_LOGPOS	oldest;
+
+	lt_xact_init(&index);
+	pos.row = 1;
+	pos.page = 900;
+	TEST_CHECK(lt_xact_begin(&index, &pos, NULL) == CS_SUCCEED);
+	pos.page = 950;
+	TEST_CHECK(lt_xact_adopt(&index, &pos, NULL) == CS_SUCCEED);
+	pos.page = 3;
+	TEST_CHECK(lt_xact_begin(&index, &pos, NULL) == CS_SUCCEED);
+	pos.page = 20;
+	TEST_CHECK(lt_xact_adopt(&index, &pos, NULL) == CS_SUCCEED);
+
+	/*
+	** Already open: neither call moves it.
+	*/
+	pos.page = 3;
+	TEST_CHECK(lt_xact_adopt(&index, &pos, NULL) == CS_SUCCEED);
+	pos.page = 950;
+	TEST_CHECK(lt_xact_begin(&index, &pos, NULL) == CS_SUCCEED);
+
+	TEST_CHECK(lt_xact_lowwater(&index, &oldest) && oldest.page == 950);
+	next = walked;
+	TEST_CHECK(lt_xact_walk(&index, test_walk_page, &next) == CS_SUCCEED);
+	TEST_CHECK(next - walked == 4);
+	TEST_CHECK(walked[0] == 950 && walked[1] == 20 &&
+		   walked[2] == 900 && walked[3] == 3);
+
+	/*
+	** Ending the last adopted one; the next goes after the one left.
+	*/
+	pos.page = 20;
+	TEST_CHECK(lt_xact_end(&index, &pos, NULL) == CS_SUCCEED);
+	pos.page = 7;
+	TEST_CHECK(lt_xact_adopt(&index, &pos, NULL) == CS_SUCCEED);
+	next = walked;
+	TEST_CHECK(lt_xact_walk(&index, test_walk_page, &next) == CS_SUCCEED);
+	TEST_CHECK(next - walked == 4);
+	TEST_CHECK(walked[0] == 950 && walked[1] == 7 &&
+		   walked[2] == 900 && walked[3] == 3);
+
+	/*
+	** Once none is left, the next one adopted leads the list again.
+	*/
+	pos.page = 950;
+	TEST_CHECK(lt_xact_end(&index, &pos, NULL) == CS_SUCCEED);
+	pos.page = 7;
+	TEST_CHECK(lt_xact_end(&index, &pos, NULL) == CS_SUCCEED);
+	TEST_CHECK(lt_xact_lowwater(&index, &oldest) && oldest.page == 900);
+	pos.page = 5;
+	TEST_CHECK(lt_xact_adopt(&index, &pos, NULL) == CS_SUCCEED);
+	TEST_CHECK(lt_xact_lowwater(&index, &oldest) && oldest.page == 5);
+	next = walked;
+	TEST_CHECK(lt_xact_walk(&index, test_walk_page, &next) == CS_SUCCEED);
+	TEST_CHECK(next - walked == 3);
+	TEST_CHECK(walked[0] == 5 && walked[1] == 900 && walked[2] == 3);
+	TEST_CHECK(index.count == 3);
+	lt_xact_cleanup(&index);
+}
+
+/*
+** test_rollback_partial()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	A rollback without savepoints undoes the changes newest first; each
+** 	compensation record discards only the change it undoes, and the
+** 	last one the whole buffer.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_rollback_partial(CS_VOID)
+{
+	LT_XACT_INDEX	index;
+	LT_XACT		*xact;
+	LT_LOGPOS	begin = test_pos(0);
+	LT_LOGPOS	pos;
+	LT_LOGPOS	undone;
+	CS_UINT		row;
+
+	lt_xact_init(&index);
+	TEST_CHECK(lt_xact_begin(&index, &begin, &xact) == CS_SUCCEED);
+	for (row = 1; row <= 5; row++)
+	{
+		TEST_CHECK(test_append(xact, row) == CS_SUCCEED);
+	}
+	test_expect(xact, 5);
+
+	for (row = 5; row >= 1; row--)
+	{
+		pos = test_pos(100 + 5 - row);
+		undone = test_pos(row);
+		lt_xact_rollback(xact, &pos, &undone);
+		test_expect(xact, row - 1);
+	}
+	TEST_CHECK(xact->changes.len == 0);
+	lt_xact_cleanup(&index);
+}
+
+/*
+** test_rollback_savepoint()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	A rollback to a savepoint keeps the changes before it and the mark,
+** 	and changes made after it can be rolled back in turn; a rollback
+** 	past the savepoint pops the mark.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_rollback_savepoint(CS_VOID)
+{
+	LT_XACT_INDEX	index;
+	LT_XACT		*xact;
+	LT_LOGPOS	begin = test_pos(0);
+	LT_LOGPOS	pos;
+	LT_LOGPOS	undone;
+	CS_UINT		rows[TEST_MAXCHANGES];
+
+	lt_xact_init(&index);
+	TEST_CHECK(lt_xact_begin(&index, &begin, &xact) == CS_SUCCEED);
+	TEST_CHECK(test_append(xact, 1) == CS_SUCCEED);
+	TEST_CHECK(test_append(xact, 2) == CS_SUCCEED);
+	pos = test_pos(3);
+	TEST_CHECK(lt_xact_savepoint(xact, &pos) == CS_SUCCEED);
+	TEST_CHECK(test_append(xact, 4) == CS_SUCCEED);
+	TEST_CHECK(test_append(xact, 5) == CS_SUCCEED);
+	TEST_CHECK(xact->nsavepts == 1);
+
+	/*
+	** Roll back to the savepoint, newest first.
+	*/
+	pos = test_pos(10);
+	undone = test_pos(5);
+	lt_xact_rollback(xact, &pos, &undone);
+	TEST_CHECK(test_rows(xact, rows) == 3);
+	TEST_CHECK(xact->last.row == 4);
+	pos = test_pos(11);
+	undone = test_pos(4);
+	lt_xact_rollback(xact, &pos, &undone);
+	test_expect(xact, 2);
+	TEST_CHECK(xact->nsavepts == 1);
+
+	/*
+	** The transaction goes on after the savepoint, then aborts.
+	*/
+	TEST_CHECK(test_append(xact, 12) == CS_SUCCEED);
+	TEST_CHECK(test_rows(xact, rows) == 3);
+	TEST_CHECK(rows[2] == 12);
+	pos = test_pos(13);
+	undone = test_pos(12);
+	lt_xact_rollback(xact, &pos, &undone);
+	test_expect(xact, 2);
+	pos = test_pos(14);
+	undone = test_pos(2);
+	lt_xact_rollback(xact, &pos, &undone);
+	test_expect(xact, 1);
+	TEST_CHECK(xact->nsavepts == 0);
+	pos = test_pos(15);
+	undone = test_pos(1);
+	lt_xact_rollback(xact, &pos, &undone);
+	test_expect(xact, 0);
+	lt_xact_cleanup(&index);
+}
+
+/*
+** test_rollback_unbuffered()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	A compensation record undoing a record that buffered no change
+** 	leaves the buffer as it is.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_rollback_unbuffered(CS_VOID)
+{
+	LT_XACT_INDEX	index;
+	LT_XACT		*xact;
+	LT_LOGPOS	begin = test_pos(0);
+	LT_LOGPOS	pos;
+	LT_LOGPOS	undone;
+
+	lt_xact_init(&index);
+	TEST_CHECK(lt_xact_begin(&index, &begin, &xact) == CS_SUCCEED);
+	TEST_CHECK(test_append(xact, 1) == CS_SUCCEED);
+	TEST_CHECK(test_append(xact, 2) == CS_SUCCEED);
+	pos = test_pos(4);
+	undone = test_pos(3);
+	lt_xact_rollback(xact, &pos, &undone);
+	test_expect(xact, 2);
+	lt_xact_cleanup(&index);
+}
+
+/*
+** test_rollback_wrapped()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Savepoints and compensation records of a transaction during which
+** 	the log wraps onto lower page ids are placed in scan order: a mark
+** 	taken after the wrap is popped by undoing a change made before it.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_rollback_wrapped(CS_VOID)
+{
+	LT_XACT_INDEX	index;
+	LT_XACT		*xact;
+	LT_LOGPOS	pos;
+	LT_LOGPOS	undone;
+	CS_UINT		rows[TEST_MAXCHANGES];
+	CS_UINT		pages[] = { 900, 950, 3, 4 };
+	CS_INT		i;
+
+	lt_xact_init(&index);
+	pos.page = 900;
+	pos.row = 0;
+	TEST_CHECK(lt_xact_begin(&index, &pos, &xact) == CS_SUCCEED);
+	pos.row = 1;
+	for (i = 0; i < 2; i++)
+	{
+		pos.page = pages[i];
+		TEST_CHECK(test_append_at(xact, pos) == CS_SUCCEED);
+	}
+	pos.page = 2;
+	TEST_CHECK(lt_xact_savepoint(xact, &pos) == CS_SUCCEED);
+	for (i = 2; i < 4; i++)
+	{
+		pos.page = pages[i];
+		TEST_CHECK(test_append_at(xact, pos) == CS_SUCCEED);
+	}
+
+	/*
+	** Back to the savepoint: the mark after the wrap is kept.
+	*/
+	pos.page = 5;
+	undone.page = 4;
+	undone.row = 1;
+	lt_xact_rollback(xact, &pos, &undone);
+	TEST_CHECK(xact->nchanges == 3 && xact->last.page == 3);
+	undone.page = 3;
+	lt_xact_rollback(xact, &pos, &undone);
+	TEST_CHECK(xact->nchanges == 2 && xact->last.page == 950);
+	TEST_CHECK(xact->nsavepts == 1);
+
+	/*
+	** Past it: the change before the wrap goes with the mark.
+	*/
+	undone.page = 950;
+	lt_xact_rollback(xact, &pos, &undone);
+	TEST_CHECK(xact->nsavepts == 0);
+	TEST_CHECK(test_rows(xact, rows) == 1);
+	TEST_CHECK(xact->nchanges == 1 && xact->last.page == 900);
+	lt_xact_cleanup(&index);
+}
+
+/*
+** test_reindex()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	The change index is rebuilt from a buffer filled in directly, and a
+** 	buffer that does not hold the number of changes claimed is refused.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_reindex(CS_VOID)
+{
+	LT_XACT_INDEX	index;
+	LT_XACT		*xact;
+	LT_LOGPOS	begin = test_pos(0);
+	LT_LOGPOS	pos;
+	LT_LOGPOS	undone;
+	CS_UINT		row;
+
+	lt_xact_init(&index);
+	TEST_CHECK(lt_xact_begin(&index, &begin, &xact) == CS_SUCCEED);
+	for (row = 1; row <= 3; row++)
+	{
+		TEST_CHECK(test_append(xact, row) == CS_SUCCEED);
+	}
+	memset(xact->refs, 0, xact->nchanges * sizeof (LT_XACT_REF));
+	TEST_CHECK(lt_xact_reindex(xact) == CS_SUCCEED);
+	test_expect(xact, 3);
+
+	pos = test_pos(10);
+	undone = test_pos(3);
+	lt_xact_rollback(xact, &pos, &undone);
+	test_expect(xact, 2);
+
+	xact->nchanges = 3;
+	TEST_CHECK(lt_xact_reindex(xact) == CS_FAIL);
+	xact->changes.len--;
+	xact->nchanges = 2;
+	TEST_CHECK(lt_xact_reindex(xact) == CS_FAIL);
+	lt_xact_cleanup(&index);
+}
+
+/*
+** test_restored()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	Records up to the checkpointed position of a restored transaction
+** 	are replays and are dropped; the first record past it is kept and
+** 	ends the replay.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_restored(CS_VOID)
+{
+	LT_XACT_INDEX	index;
+	LT_XACT		*xact;
+	LT_LOGPOS	begin = test_pos(0);
+	LT_LOGPOS	pos;
+	LT_LOGPOS	undone;
+	CS_UINT		rows[TEST_MAXCHANGES];
+
+	lt_xact_init(&index);
+	TEST_CHECK(lt_xact_begin(&index, &begin, &xact) == CS_SUCCEED);
+	TEST_CHECK(test_append(xact, 1) == CS_SUCCEED);
+	TEST_CHECK(test_append(xact, 2) == CS_SUCCEED);
+	xact->restored = CS_TRUE;
+	xact->last = test_pos(5);
+
+	TEST_CHECK(test_append(xact, 2) == CS_SUCCEED);
+	pos = test_pos(4);
+	undone = test_pos(2);
+	lt_xact_rollback(xact, &pos, &undone);
+	TEST_CHECK(xact->nchanges == 2);
+	TEST_CHECK(xact->restored);
+
+	TEST_CHECK(test_append(xact, 6) == CS_SUCCEED);
+	TEST_CHECK(!xact->restored);
+	TEST_CHECK(test_rows(xact, rows) == 3);
+	TEST_CHECK(rows[2] == 6);
+	TEST_CHECK(xact->nchanges == 3);
+	TEST_CHECK(xact->last.row == 6);
+	lt_xact_cleanup(&index);
+}
+
+/*
+** test_restored_wrapped()
+**
+** Type of function:
+** 	test internal api
+**
+** Purpose:
+** 	The replay into a restored transaction runs in scan order: records
+** 	on lower page ids after the log wrapped are replays up to the
+** 	checkpointed position, and the first record past it ends the replay.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_STATIC CS_VOID
+test_restored_wrapped(CS_VOID)
+{
+	LT_XACT_INDEX	index;
+	LT_XACT		*xact;
+	LT_LOGPOS	pos;
+	LT_LOGPOS	undone;
+
+	lt_xact_init(&index);
+	pos.page = 900;
+	pos.row = 0;
+	TEST_CHECK(lt_xact_begin(&index, &pos, &xact) == CS_SUCCEED);
+	pos.row = 1;
+	TEST_CHECK(test_append_at(xact, pos) == CS_SUCCEED);
+	pos.page = 2;
+	TEST_CHECK(test_append_at(xact, pos) == CS_SUCCEED);
+	xact->restored = CS_TRUE;
+	xact->last.page = 3;
+	xact->last.row = 1;
+
+	pos.page = 950;
+	TEST_CHECK(test_append_at(xact, pos) == CS_SUCCEED);
+	pos.page = 2;
+	TEST_CHECK(test_append_at(xact, pos) == CS_SUCCEED);
+	TEST_CHECK(lt_xact_savepoint(xact, &pos) == CS_SUCCEED);
+	pos.page = 3;
+	undone.page = 2;
+	undone.row = 1;
+	lt_xact_rollback(xact, &pos, &undone);
+	TEST_CHECK(xact->restored);
+	TEST_CHECK(xact->nchanges == 2 && xact->nsavepts == 0);
+
+	pos.page = 4;
+	TEST_CHECK(test_append_at(xact, pos) == CS_SUCCEED);
+	TEST_CHECK(!xact->restored);
+	TEST_CHECK(xact->nchanges == 3 && xact->last.page == 4);
+	lt_xact_cleanup(&index);
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (lt_dict_intern("t", 1, &Test_table) != CS_SUCCEED)
+	{
+		return EX_EXIT_FAIL;
+	}
+
+	test_scan_order();
+	test_adopted();
+	test_rollback_partial();
+	test_rollback_savepoint();
+	test_rollback_unbuffered();
+	test_rollback_wrapped();
+	test_reindex();
+	test_restored();
+	test_restored_wrapped();
+	return test_done("testxact");
+}